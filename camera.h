@@ -106,6 +106,15 @@ public:
         updateCameraVectors();
     }
 
+    // places the camera directly (path replay); angles in degrees like Yaw and Pitch
+    void SetPose(const glm::vec3 &position, float yaw, float pitch)
+    {
+        Position = position;
+        Yaw = yaw;
+        Pitch = pitch;
+        updateCameraVectors();
+    }
+
     // processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
     void ProcessMouseScroll(float yoffset)
     {
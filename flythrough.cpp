@@ -0,0 +1,172 @@
+#include "flythrough.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+const char *PATH_HEADER = "campath 1";
+}
+
+bool CameraPath::load(const std::string &path)
+{
+    std::ifstream in(path);
+    std::string header;
+    if (!in || !std::getline(in, header) || header != PATH_HEADER)
+    {
+        std::cerr << "Camera path: " << path << " is missing or not a camera path" << std::endl;
+        return false;
+    }
+
+    keyframes.clear();
+    CameraKeyframe keyframe;
+    while (in >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z >> keyframe.yaw >> keyframe.pitch)
+    {
+        keyframes.push_back(keyframe);
+    }
+    std::cout << "Camera path: loaded " << keyframes.size() << " steps from " << path << std::endl;
+    return !keyframes.empty();
+}
+
+bool CameraPath::save(const std::string &path) const
+{
+    std::ofstream out(path, std::ios::trunc);
+    out << PATH_HEADER << "\n";
+    for (const CameraKeyframe &keyframe : keyframes)
+    {
+        out << keyframe.position.x << " " << keyframe.position.y << " " << keyframe.position.z << " " << keyframe.yaw
+            << " " << keyframe.pitch << "\n";
+    }
+    if (!out)
+    {
+        std::cerr << "Camera path: failed to write " << path << std::endl;
+        return false;
+    }
+    std::cout << "Camera path: saved " << keyframes.size() << " steps to " << path << std::endl;
+    return true;
+}
+
+void CameraPathRecorder::start(const Camera &camera)
+{
+    path.clear();
+    path.add(camera);
+    accumulated_seconds = 0.0f;
+    recording = true;
+}
+
+void CameraPathRecorder::update(const Camera &camera, float delta_seconds)
+{
+    if (!recording)
+    {
+        return;
+    }
+
+    // A slow frame repeats the pose for the steps it covered, keeping the path on real time
+    accumulated_seconds += delta_seconds;
+    while (accumulated_seconds >= CameraPath::STEP_SECONDS)
+    {
+        path.add(camera);
+        accumulated_seconds -= CameraPath::STEP_SECONDS;
+    }
+}
+
+bool CameraPathRecorder::stop(const std::string &output_path)
+{
+    recording = false;
+    return path.save(output_path);
+}
+
+FlythroughBenchmark::FlythroughBenchmark(CameraPath path) : path(std::move(path))
+{
+    // Recording must not show up in the allocation counts
+    frame_times_ms.reserve(this->path.size());
+    frame_allocations.reserve(this->path.size());
+    timeline.reserve(this->path.size() / SAMPLE_INTERVAL_FRAMES + 1);
+}
+
+void FlythroughBenchmark::applyNextPose(Camera &camera)
+{
+    if (isFinished())
+    {
+        return;
+    }
+    const CameraKeyframe &keyframe = path[next_frame++];
+    camera.SetPose(keyframe.position, keyframe.yaw, keyframe.pitch);
+}
+
+void FlythroughBenchmark::recordFrame(float frame_ms, uint64_t allocations, const VoxelRenderer &renderer)
+{
+    frame_times_ms.push_back(frame_ms);
+    frame_allocations.push_back(allocations);
+    if (frame_times_ms.size() % SAMPLE_INTERVAL_FRAMES == 0)
+    {
+        timeline.push_back({frame_times_ms.size(), renderer.getStreamingStats()});
+    }
+}
+
+float FlythroughBenchmark::getPercentile(const std::vector<float> &sorted, float fraction)
+{
+    if (sorted.empty())
+    {
+        return 0.0f;
+    }
+    size_t index = static_cast<size_t>(fraction * static_cast<float>(sorted.size() - 1) + 0.5f);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+bool FlythroughBenchmark::writeReport(const std::string &report_path, const VoxelRenderer &renderer) const
+{
+    std::vector<float> sorted = frame_times_ms;
+    std::sort(sorted.begin(), sorted.end());
+    float p50 = getPercentile(sorted, 0.50f);
+    float p95 = getPercentile(sorted, 0.95f);
+    float p99 = getPercentile(sorted, 0.99f);
+    float max_ms = sorted.empty() ? 0.0f : sorted.back();
+
+    // Steady frames (nothing streaming in or remeshing) should not allocate at all
+    std::vector<uint64_t> allocations = frame_allocations;
+    std::sort(allocations.begin(), allocations.end());
+    auto allocationPercentile = [&](float fraction)
+    {
+        return allocations.empty() ? 0 : allocations[static_cast<size_t>(fraction * (allocations.size() - 1) + 0.5f)];
+    };
+    size_t allocation_free = std::upper_bound(allocations.begin(), allocations.end(), uint64_t(0)) - allocations.begin();
+
+    std::cout << "FLYTHROUGH RESULTS: " << sorted.size() << " frames, p50 " << p50 << "ms, p95 " << p95 << "ms, p99 "
+              << p99 << "ms, max " << max_ms << "ms; " << allocation_free << " frames without allocations, p50 "
+              << allocationPercentile(0.50f) << ", max " << (allocations.empty() ? 0 : allocations.back())
+              << " allocations" << std::endl;
+
+    std::ofstream out(report_path, std::ios::trunc);
+    out << "{\n  \"frames\": " << sorted.size() << ",\n  \"frame_ms\": {\"p50\": " << p50 << ", \"p95\": " << p95
+        << ", \"p99\": " << p99 << ", \"max\": " << max_ms << "},\n  \"allocations\": {\"zero_frames\": "
+        << allocation_free << ", \"p50\": " << allocationPercentile(0.50f) << ", \"p99\": " << allocationPercentile(0.99f)
+        << ", \"max\": " << (allocations.empty() ? 0 : allocations.back()) << "},\n  \"timeline\": [";
+    for (size_t i = 0; i < timeline.size(); i++)
+    {
+        const StreamingStats &stats = timeline[i].stats;
+        out << (i ? "," : "") << "\n    {\"frame\": " << timeline[i].frame << ", \"loaded_chunks\": " << stats.loaded_chunks
+            << ", \"chunk_load_ms\": " << stats.chunk_load_ms << ", \"generation_queued\": " << stats.generation_queued
+            << ", \"generation_in_flight\": " << stats.generation_in_flight << ", \"need_mesh\": " << stats.chunks_need_mesh
+            << ", \"meshing\": " << stats.chunks_meshing << ", \"uploads_waiting\": " << stats.uploads_waiting << "}";
+    }
+    out << "\n  ],\n  \"pipeline_ms\": {";
+    const PipelineLatency &latency = renderer.getPipelineLatency();
+    for (int stage = 0; stage < static_cast<int>(PipelineStage::Count); stage++)
+    {
+        const LatencyHistogram &histogram = latency.stages[stage];
+        out << (stage ? "," : "") << "\n    \"" << getPipelineStageName(static_cast<PipelineStage>(stage))
+            << "\": {\"chunks\": " << histogram.getCount() << ", \"p50\": " << histogram.getPercentile(0.50f)
+            << ", \"p95\": " << histogram.getPercentile(0.95f) << ", \"p99\": " << histogram.getPercentile(0.99f)
+            << ", \"max\": " << histogram.getMax() << "}";
+    }
+    out << "\n  }\n}\n";
+
+    if (!out)
+    {
+        std::cerr << "Flythrough: failed to write " << report_path << std::endl;
+        return false;
+    }
+    std::cout << "Flythrough report written to " << report_path << std::endl;
+    return true;
+}
@@ -0,0 +1,89 @@
+#ifndef FLYTHROUGH_H
+#define FLYTHROUGH_H
+
+#include "camera.h"
+#include "voxel world/voxel_renderer.h"
+#include <glm/glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Camera pose at one fixed step of a recorded path
+struct CameraKeyframe
+{
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+};
+
+// Camera path sampled at a fixed rate, stored as text (one "x y z yaw pitch" line per step)
+// so paths can be checked in and replayed on any build
+class CameraPath
+{
+public:
+    static constexpr float STEP_SECONDS = 1.0f / 60.0f;
+
+    bool load(const std::string &path);
+    bool save(const std::string &path) const;
+
+    void clear() { keyframes.clear(); }
+    void add(const Camera &camera) { keyframes.push_back({camera.Position, camera.Yaw, camera.Pitch}); }
+    size_t size() const { return keyframes.size(); }
+    const CameraKeyframe &operator[](size_t index) const { return keyframes[index]; }
+
+private:
+    std::vector<CameraKeyframe> keyframes;
+};
+
+// Samples the live camera into a path at STEP_SECONDS, whatever the frame rate
+class CameraPathRecorder
+{
+public:
+    void start(const Camera &camera);
+    void update(const Camera &camera, float delta_seconds);
+    bool stop(const std::string &path); // Writes the path; false if it could not be saved
+
+    bool isRecording() const { return recording; }
+
+private:
+    CameraPath path;
+    float accumulated_seconds = 0.0f;
+    bool recording = false;
+};
+
+// Replays a path one step per frame, so every build streams exactly the same camera
+// sequence, and gathers frame time percentiles and the streaming load along the way
+class FlythroughBenchmark
+{
+public:
+    static constexpr size_t SAMPLE_INTERVAL_FRAMES = 60; // Streaming timeline resolution
+
+    explicit FlythroughBenchmark(CameraPath path);
+
+    bool isFinished() const { return next_frame >= path.size(); }
+    void applyNextPose(Camera &camera); // Before the frame is updated and drawn
+    // allocations: heap allocations made by the frame's update and render (worker threads included)
+    void recordFrame(float frame_ms, uint64_t allocations, const VoxelRenderer &renderer);
+
+    // JSON report of the frame time and allocation percentiles, the streaming timeline and the
+    // renderer's pop-in latency per pipeline stage; false if it could not be written
+    bool writeReport(const std::string &report_path, const VoxelRenderer &renderer) const;
+
+private:
+    struct StreamingSample
+    {
+        size_t frame;
+        StreamingStats stats;
+    };
+
+    CameraPath path;
+    size_t next_frame = 0;
+    std::vector<float> frame_times_ms;
+    std::vector<uint64_t> frame_allocations;
+    std::vector<StreamingSample> timeline;
+
+    static float getPercentile(const std::vector<float> &sorted, float fraction);
+};
+
+#endif // FLYTHROUGH_H
@@ -0,0 +1,217 @@
+#include "frame_capture.h"
+#include "includes/glfw-3.4/glfw-3.4/deps/stb_image_write.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+FrameCapture::~FrameCapture()
+{
+    finish();
+    encoders.reset();
+    for (Readback &readback : ring)
+    {
+        if (readback.buffer != 0)
+        {
+            glDeleteBuffers(1, &readback.buffer);
+        }
+    }
+}
+
+void FrameCapture::requestScreenshot(std::string path)
+{
+    std::error_code error;
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty())
+    {
+        std::filesystem::create_directories(parent, error);
+    }
+    screenshot_path = std::move(path);
+}
+
+bool FrameCapture::startSequence(const std::string &directory)
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error)
+    {
+        std::cerr << "Frame capture: cannot create " << directory << ": " << error.message() << std::endl;
+        return false;
+    }
+    sequence_directory = directory;
+    sequence_frame = 0;
+    return true;
+}
+
+void FrameCapture::endFrame(int width, int height)
+{
+    // Oldest first; fences signal in submission order, so the first one pending ends the scan
+    for (int i = 0; i < RING_SIZE; i++)
+    {
+        Readback &readback = ring[(next_slot + i) % RING_SIZE];
+        if (readback.fence && !collect(readback, false))
+        {
+            break;
+        }
+    }
+
+    if (!screenshot_path.empty())
+    {
+        queueReadback(screenshot_path, width, height);
+        std::cout << "Screenshot: " << screenshot_path << std::endl;
+        screenshot_path.clear();
+    }
+    else if (!sequence_directory.empty())
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%06llu.png", static_cast<unsigned long long>(sequence_frame++));
+        queueReadback(sequence_directory + "/" + name, width, height);
+    }
+}
+
+void FrameCapture::finish()
+{
+    for (int i = 0; i < RING_SIZE; i++)
+    {
+        Readback &readback = ring[(next_slot + i) % RING_SIZE];
+        if (readback.fence)
+        {
+            collect(readback, true);
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(encode_mutex);
+    encode_done.wait(lock, [this]() { return pending_encodes == 0; });
+}
+
+void FrameCapture::queueReadback(const std::string &path, int width, int height)
+{
+    if (width <= 0 || height <= 0)
+    {
+        return;
+    }
+
+    Readback &readback = ring[next_slot];
+    if (readback.fence)
+    {
+        collect(readback, true); // Every buffer still in flight: the GPU is RING_SIZE frames behind
+    }
+    next_slot = (next_slot + 1) % RING_SIZE;
+
+    size_t bytes = static_cast<size_t>(width) * height * 4;
+    if (readback.buffer == 0)
+    {
+        glGenBuffers(1, &readback.buffer);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    if (bytes != readback.capacity)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+        readback.capacity = bytes;
+    }
+
+    // The window's back buffer as presented; RGBA rows need no pack alignment
+    GLint read_framebuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(read_framebuffer));
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.width = width;
+    readback.height = height;
+    readback.path = path;
+    frames_captured++;
+}
+
+bool FrameCapture::collect(Readback &readback, bool wait)
+{
+    GLenum status = glClientWaitSync(readback.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, 0);
+    while (wait && status == GL_TIMEOUT_EXPIRED)
+    {
+        status = glClientWaitSync(readback.fence, 0, 1000000000); // 1 s at a time
+    }
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        return false;
+    }
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+    if (status == GL_WAIT_FAILED)
+    {
+        std::cerr << "Frame capture: fence wait failed, dropping " << readback.path << std::endl;
+        failed_writes++;
+        return true;
+    }
+
+    size_t bytes = static_cast<size_t>(readback.width) * readback.height * 4;
+    std::vector<unsigned char> pixels(bytes);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    const void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(bytes), GL_MAP_READ_BIT);
+    if (mapped)
+    {
+        std::memcpy(pixels.data(), mapped, bytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!mapped)
+    {
+        std::cerr << "Frame capture: cannot map the readback of " << readback.path << std::endl;
+        failed_writes++;
+        return true;
+    }
+
+    {
+        // Backpressure instead of dropping frames when the encoders fall behind
+        std::unique_lock<std::mutex> lock(encode_mutex);
+        encode_done.wait(lock, [this]() { return pending_encodes < MAX_PENDING_ENCODES; });
+        pending_encodes++;
+    }
+    if (!encoders)
+    {
+        // Below the world's workers, which keep streaming while a sequence is encoded
+        JobSystemConfig config;
+        config.thread_count = ENCODER_THREADS;
+        config.lower_priority = true;
+        encoders = std::make_unique<JobSystem>(config);
+    }
+    encoders->submit([this, pixels = std::move(pixels), width = readback.width, height = readback.height,
+                      path = readback.path]() mutable
+                     { encode(std::move(pixels), width, height, path); },
+                     JobPriority::Low);
+    return true;
+}
+
+void FrameCapture::encode(std::vector<unsigned char> pixels, int width, int height, const std::string &path)
+{
+    // GL rows run bottom up; the window's alpha is not the image's
+    std::vector<unsigned char> rgb(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned char *source = pixels.data() + static_cast<size_t>(height - 1 - y) * width * 4;
+        unsigned char *target = rgb.data() + static_cast<size_t>(y) * width * 3;
+        for (int x = 0; x < width; x++)
+        {
+            target[x * 3 + 0] = source[x * 4 + 0];
+            target[x * 3 + 1] = source[x * 4 + 1];
+            target[x * 3 + 2] = source[x * 4 + 2];
+        }
+    }
+
+    if (stbi_write_png(path.c_str(), width, height, 3, rgb.data(), width * 3))
+    {
+        frames_written++;
+    }
+    else
+    {
+        std::cerr << "Frame capture: failed to save " << path << std::endl;
+        failed_writes++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(encode_mutex);
+        pending_encodes--;
+    }
+    encode_done.notify_all();
+}
@@ -0,0 +1,89 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include "voxel world/job_system.h"
+#include <glad/glad/glad.h>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Screenshots and frame sequences of the window without stalling the pipeline.
+//
+// A captured frame is read into one of RING_SIZE pixel pack buffers at the end of the frame
+// (glReadPixels into a buffer returns once the copy is queued) behind a fence. Later frames
+// map the buffers whose fences have signalled, normally two or three frames on, copy the
+// pixels out and hand them to ENCODER_THREADS encoder threads of their own, which flip the
+// rows and write the PNG (stb_image_write). Only when every buffer is still in flight, or
+// MAX_PENDING_ENCODES images wait for an encoder, does endFrame wait: a sequence never drops
+// a frame, so replays captured on two builds can be compared image by image. Main thread,
+// apart from the encoders.
+class FrameCapture
+{
+public:
+    static constexpr int RING_SIZE = 3;
+    static constexpr unsigned int ENCODER_THREADS = 3;
+    static constexpr size_t MAX_PENDING_ENCODES = 12; // About 4 MB each at 1200x800
+
+    FrameCapture() = default;
+    ~FrameCapture(); // Writes whatever is still in flight
+
+    FrameCapture(const FrameCapture &) = delete;
+    FrameCapture &operator=(const FrameCapture &) = delete;
+
+    // The next endFrame captures into path
+    void requestScreenshot(std::string path);
+    // Every endFrame from now on, into directory/frame_000000.png and on (created if missing);
+    // false if the directory could not be created
+    bool startSequence(const std::string &directory);
+    void stopSequence() { sequence_directory.clear(); }
+    bool isRecordingSequence() const { return !sequence_directory.empty(); }
+
+    // After the frame is complete in the window's back buffer, before the swap: queue this
+    // frame's readback if one was asked for and pass finished readbacks to the encoders
+    void endFrame(int width, int height);
+    // Read back and encode everything in flight, waiting for the GPU and the encoders
+    void finish();
+
+    uint64_t getFramesCaptured() const { return frames_captured; }
+    uint64_t getFramesWritten() const { return frames_written.load(std::memory_order_relaxed); }
+    uint64_t getFailedWrites() const { return failed_writes.load(std::memory_order_relaxed); }
+
+private:
+    struct Readback
+    {
+        GLuint buffer = 0;
+        size_t capacity = 0; // Bytes allocated for buffer
+        GLsync fence = nullptr; // Non-null while in flight
+        int width = 0;
+        int height = 0;
+        std::string path;
+    };
+
+    std::array<Readback, RING_SIZE> ring;
+    int next_slot = 0; // Oldest readback, the next one to reuse
+    std::string screenshot_path;
+    std::string sequence_directory;
+    uint64_t sequence_frame = 0;
+    uint64_t frames_captured = 0;
+
+    std::unique_ptr<JobSystem> encoders; // Created by the first capture
+    std::mutex encode_mutex;
+    std::condition_variable encode_done;
+    size_t pending_encodes = 0;
+    std::atomic<uint64_t> frames_written{0};
+    std::atomic<uint64_t> failed_writes{0};
+
+    void queueReadback(const std::string &path, int width, int height);
+    // Maps a signalled readback (waiting for it if wait) and queues its encode; false if its
+    // fence has not signalled and wait is false
+    bool collect(Readback &readback, bool wait);
+    void encode(std::vector<unsigned char> pixels, int width, int height, const std::string &path);
+};
+
+#endif // FRAME_CAPTURE_H
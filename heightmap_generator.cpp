@@ -1,201 +1,278 @@
 #include "heightmap_generator.h"
 #include "voxel world/voxel_noise.h"
+#include "voxel world/job_system.h"
+#include "voxel world/voxel_types.h"
 #include <iostream>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
+#include <mutex>
+#include <thread>
 
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "includes/glfw-3.4/glfw-3.4/deps/stb_image_write.h"
 
-void HeightmapGenerator::generateAllHeightmaps(uint32_t seed, int width, int height)
-{
-    VoxelNoise noise(seed);
-    float scale = 0.005f;
-
-    std::cout << "Generating heightmaps with seed: " << seed << std::endl;
-
-    // Create heightmaps directory if it doesn't exist
-    std::filesystem::create_directories("heightmaps");
+const char *const HeightmapGenerator::LAYER_NAMES[LAYER_COUNT] = {
+    "continental_noise", "erosion_noise", "peaks_valleys_noise", "simplex_noise", "fractal_noise", "final_terrain"};
 
-    // Generate Continental heightmap
-    auto continental = generateContinentalHeightmap(noise, width, height, scale);
-    saveHeightmapAsPNG(continental, width, height, "heightmaps/continental_noise.png");
-
-    // Generate Erosion heightmap
-    auto erosion = generateErosionHeightmap(noise, width, height, scale);
-    saveHeightmapAsPNG(erosion, width, height, "heightmaps/erosion_noise.png");
+namespace
+{
+// Top of the terrain layers; the final terrain of exported tiles is scaled to it
+constexpr float WORLD_HEIGHT = static_cast<float>(CHUNK_HEIGHT * TERRAIN_LAYERS);
 
-    // Generate Peaks and Valleys heightmap
-    auto peaksValleys = generatePeaksValleysHeightmap(noise, width, height, scale);
-    saveHeightmapAsPNG(peaksValleys, width, height, "heightmaps/peaks_valleys_noise.png");
+// Encoded tile ready to write, one grayscale image per layer
+struct EncodedTile
+{
+    int x = 0; // Tile coordinates
+    int y = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<std::vector<unsigned char>> layers;
+};
+
+// Hands finished tiles from the generation jobs to the encoder thread. push blocks while
+// capacity tiles are already waiting, which is what bounds memory during an export.
+class TileQueue
+{
+public:
+    explicit TileQueue(size_t capacity) : capacity(capacity) {}
 
-    // Generate Simplex noise heightmap
-    auto simplex = generateSimplexHeightmap(noise, width, height, scale);
-    saveHeightmapAsPNG(simplex, width, height, "heightmaps/simplex_noise.png");
+    void push(EncodedTile tile)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this]
+                      { return tiles.size() < capacity; });
+        tiles.push_back(std::move(tile));
+        not_empty.notify_one();
+    }
 
-    // Generate Fractal noise heightmap
-    auto fractal = generateFractalHeightmap(noise, width, height, scale);
-    saveHeightmapAsPNG(fractal, width, height, "heightmaps/fractal_noise.png");
+    // False once close() was called and every tile has been taken
+    bool pop(EncodedTile &tile)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this]
+                       { return closed || !tiles.empty(); });
+        if (tiles.empty())
+        {
+            return false;
+        }
+        tile = std::move(tiles.front());
+        tiles.pop_front();
+        not_full.notify_one();
+        return true;
+    }
 
-    // Generate Final terrain heightmap (using splines)
-    auto finalTerrain = generateFinalTerrainHeightmap(noise, width, height, scale);
-    saveHeightmapAsPNG(finalTerrain, width, height, "heightmaps/final_terrain.png");
+    void close()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        closed = true;
+        not_empty.notify_all();
+    }
 
-    std::cout << "All heightmaps generated successfully!" << std::endl;
+private:
+    const size_t capacity;
+    std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+    std::deque<EncodedTile> tiles;
+    bool closed = false;
+};
 }
 
-std::vector<float> HeightmapGenerator::generateContinentalHeightmap(const VoxelNoise &noise, int width, int height, float scale)
+void HeightmapGenerator::generateAllHeightmaps(uint32_t seed, int width, int height)
 {
-    std::vector<float> heightmap(width * height);
+    std::cout << "Generating heightmaps with seed: " << seed << std::endl;
+
+    // Create heightmaps directory if it doesn't exist
+    std::filesystem::create_directories("heightmaps");
 
-    for (int y = 0; y < height; y++)
+    std::array<std::vector<float>, LAYER_COUNT> maps;
+    for (auto &map : maps)
     {
-        for (int x = 0; x < width; x++)
-        {
-            float continental = noise.getContinentalness(x * scale, y * scale);
-            // Normalize from [-1, 1] to [0, 1]
-            heightmap[y * width + x] = (continental + 1.0f) * 0.5f;
-        }
+        map.resize(static_cast<size_t>(width) * height);
     }
-    return heightmap;
-}
-
-std::vector<float> HeightmapGenerator::generateErosionHeightmap(const VoxelNoise &noise, int width, int height, float scale)
-{
-    std::vector<float> heightmap(width * height);
 
-    for (int y = 0; y < height; y++)
+    JobSystem jobs;
+    std::vector<JobSystem::JobHandle> tile_jobs;
+    for (int tile_y = 0; tile_y < height; tile_y += TILE_SIZE)
     {
-        for (int x = 0; x < width; x++)
+        for (int tile_x = 0; tile_x < width; tile_x += TILE_SIZE)
         {
-            float erosion = noise.getErosion(x * scale, y * scale);
-            // Normalize from [-1, 1] to [0, 1]
-            heightmap[y * width + x] = (erosion + 1.0f) * 0.5f;
+            tile_jobs.push_back(jobs.submit([&maps, seed, width, height, tile_x, tile_y]
+                                            {
+                const int tile_width = std::min(TILE_SIZE, width - tile_x);
+                const int tile_height = std::min(TILE_SIZE, height - tile_y);
+                TileLayers tile;
+                generateTile(seed, tile_x, tile_y, tile_width, tile_height, tile);
+                for (int layer = 0; layer < LAYER_COUNT; layer++)
+                {
+                    for (int y = 0; y < tile_height; y++)
+                    {
+                        std::copy_n(tile[layer].begin() + static_cast<size_t>(y) * tile_width, tile_width,
+                                    maps[layer].begin() + static_cast<size_t>(tile_y + y) * width + tile_x);
+                    }
+                } }, JobPriority::Low));
         }
     }
-    return heightmap;
-}
 
-std::vector<float> HeightmapGenerator::generatePeaksValleysHeightmap(const VoxelNoise &noise, int width, int height, float scale)
-{
-    std::vector<float> heightmap(width * height);
-
-    for (int y = 0; y < height; y++)
+    // Each layer is encoded once every tile is in, the layers in parallel
+    for (int layer = 0; layer < LAYER_COUNT; layer++)
     {
-        for (int x = 0; x < width; x++)
-        {
-            float peaksValleys = const_cast<VoxelNoise &>(noise).getPeaksandValleysGenerator(x * scale, y * scale);
-            // Normalize from [-1, 1] to [0, 1]
-            heightmap[y * width + x] = (peaksValleys + 1.0f) * 0.5f;
-        }
+        jobs.submit([&maps, layer, width, height]
+                    {
+            const std::vector<float> &map = maps[layer];
+            float low = 0.0f, high = 1.0f;
+            if (layer == FINAL_TERRAIN && !map.empty())
+            {
+                // Normalized to the map's own range
+                auto bounds = std::minmax_element(map.begin(), map.end());
+                low = *bounds.first;
+                high = *bounds.second;
+            }
+            saveHeightmapAsPNG(floatToGrayscale(map, low, high), width, height,
+                               std::string("heightmaps/") + LAYER_NAMES[layer] + ".png"); },
+                    JobPriority::Low, tile_jobs);
     }
-    return heightmap;
+    jobs.shutdown(); // Runs everything queued, continuations included
+
+    std::cout << "All heightmaps generated successfully!" << std::endl;
 }
 
-std::vector<float> HeightmapGenerator::generateSimplexHeightmap(const VoxelNoise &noise, int width, int height, float scale)
+bool HeightmapGenerator::exportTiledHeightmaps(uint32_t seed, int width, int height)
 {
-    std::vector<float> heightmap(width * height);
+    std::cout << "Exporting " << width << "x" << height << " heightmaps with seed " << seed << " as "
+              << EXPORT_TILE_SIZE << " pixel tiles" << std::endl;
 
-    for (int y = 0; y < height; y++)
+    std::error_code error;
+    for (const char *name : LAYER_NAMES)
     {
-        for (int x = 0; x < width; x++)
+        std::filesystem::create_directories(std::string("heightmaps/tiles/") + name, error);
+        if (error)
         {
-            float simplex = noise.sample2D(x * scale, y * scale);
-            // Normalize from [-1, 1] to [0, 1]
-            heightmap[y * width + x] = (simplex + 1.0f) * 0.5f;
+            std::cout << "Failed to create heightmaps/tiles/" << name << ": " << error.message() << std::endl;
+            return false;
         }
     }
-    return heightmap;
-}
 
-std::vector<float> HeightmapGenerator::generateFractalHeightmap(const VoxelNoise &noise, int width, int height, float scale)
-{
-    std::vector<float> heightmap(width * height);
+    TileQueue queue(MAX_PENDING_TILES);
+    std::atomic<int> failed_writes{0};
+    const int tiles_x = (width + EXPORT_TILE_SIZE - 1) / EXPORT_TILE_SIZE;
+    const int tiles_y = (height + EXPORT_TILE_SIZE - 1) / EXPORT_TILE_SIZE;
+
+    std::thread encoder([&queue, &failed_writes, tiles_x, tiles_y]
+                        {
+        EncodedTile tile;
+        int written = 0;
+        while (queue.pop(tile))
+        {
+            for (int layer = 0; layer < LAYER_COUNT; layer++)
+            {
+                std::string filename = std::string("heightmaps/tiles/") + LAYER_NAMES[layer] + "/" +
+                                       std::to_string(tile.x) + "_" + std::to_string(tile.y) + ".png";
+                if (!stbi_write_png(filename.c_str(), tile.width, tile.height, 1, tile.layers[layer].data(), tile.width))
+                {
+                    std::cout << "Failed to save heightmap tile: " << filename << std::endl;
+                    failed_writes++;
+                }
+            }
+            written++;
+            if (written % 64 == 0)
+            {
+                std::cout << "Wrote " << written << " / " << tiles_x * tiles_y << " tiles" << std::endl;
+            }
+        } });
 
-    for (int y = 0; y < height; y++)
     {
-        for (int x = 0; x < width; x++)
+        JobSystem jobs;
+        for (int tile_y = 0; tile_y < tiles_y; tile_y++)
         {
-            float fractal = noise.fractal2D(x * scale, y * scale);
-            // Normalize from [-1, 1] to [0, 1]
-            heightmap[y * width + x] = (fractal + 1.0f) * 0.5f;
+            for (int tile_x = 0; tile_x < tiles_x; tile_x++)
+            {
+                jobs.submit([&queue, seed, width, height, tile_x, tile_y]
+                            {
+                    EncodedTile tile;
+                    tile.x = tile_x;
+                    tile.y = tile_y;
+                    tile.width = std::min(EXPORT_TILE_SIZE, width - tile_x * EXPORT_TILE_SIZE);
+                    tile.height = std::min(EXPORT_TILE_SIZE, height - tile_y * EXPORT_TILE_SIZE);
+
+                    TileLayers layers;
+                    generateTile(seed, tile_x * EXPORT_TILE_SIZE, tile_y * EXPORT_TILE_SIZE, tile.width, tile.height, layers);
+                    tile.layers.resize(LAYER_COUNT);
+                    for (int layer = 0; layer < LAYER_COUNT; layer++)
+                    {
+                        float high = layer == FINAL_TERRAIN ? WORLD_HEIGHT : 1.0f;
+                        tile.layers[layer] = floatToGrayscale(layers[layer], 0.0f, high);
+                    }
+                    queue.push(std::move(tile)); },
+                            JobPriority::Low);
+            }
         }
+        jobs.shutdown();
     }
-    return heightmap;
+    queue.close();
+    encoder.join();
+
+    if (failed_writes.load() > 0)
+    {
+        std::cout << failed_writes.load() << " heightmap tiles failed to save" << std::endl;
+        return false;
+    }
+    std::cout << "Exported " << tiles_x * tiles_y << " tiles per layer to heightmaps/tiles/" << std::endl;
+    return true;
 }
 
-std::vector<float> HeightmapGenerator::generateFinalTerrainHeightmap(const VoxelNoise &noise, int width, int height, float scale)
+void HeightmapGenerator::generateTile(uint32_t seed, int start_x, int start_y, int width, int height, TileLayers &layers)
 {
-    std::vector<float> heightmap(width * height);
-
-    // Use the same splines as in your terrain generation
-    std::vector<SplinePoint> continentalSpline = {
-        {-1.0f, 30.0f}, // Ocean floors
-        {-0.5f, 50.0f}, // Coastal areas
-        {0.0f, 80.0f},  // Plains
-        {0.3f, 100.0f}, // Hills
-        {0.6f, 130.0f}, // Mountains
-        {1.0f, 160.0f}  // High peaks
-    };
-
-    std::vector<SplinePoint> erosionSpline = {
-        {-1.0f, 0.0f}, // No erosion effect
-        {0.0f, 10.0f}, // Light erosion
-        {0.5f, 25.0f}, // Medium erosion
-        {1.0f, 40.0f}  // Heavy erosion (carves valleys)
-    };
-
-    float minHeight = 1000.0f, maxHeight = -1000.0f;
-
-    for (int y = 0; y < height; y++)
+    const size_t count = static_cast<size_t>(width) * height;
+    for (auto &layer : layers)
     {
-        for (int x = 0; x < width; x++)
-        {
-            float continental = noise.getContinentalness(x * scale, y * scale);
-            float erosion = noise.getErosion(x * scale, y * scale);
+        layer.resize(count);
+    }
+    std::vector<float> erosion_effect(count);
 
-            float baseHeight = const_cast<VoxelNoise &>(noise).evalSpline(continentalSpline, continental);
-            float erosionEffect = const_cast<VoxelNoise &>(noise).evalSpline(erosionSpline, erosion);
-            float terrainHeight = baseHeight - erosionEffect;
+    const VoxelNoise &noise = VoxelNoise::forThread(seed);
+    noise.generateNoiseLayers(start_x, start_y, width, height, layers[CONTINENTAL].data(), layers[EROSION].data(),
+                              layers[PEAKS_VALLEYS].data(), layers[SIMPLEX].data(), layers[FRACTAL].data());
 
-            heightmap[y * width + x] = terrainHeight;
-            minHeight = std::min(minHeight, terrainHeight);
-            maxHeight = std::max(maxHeight, terrainHeight);
-        }
-    }
+    // Same terrain function as chunk generation, mountains included. The blend clamps the
+    // three inputs to [-1, 1], which the grayscale conversion would do anyway.
+    VoxelNoise::blendTerrainHeights(layers[CONTINENTAL].data(), layers[EROSION].data(), layers[PEAKS_VALLEYS].data(),
+                                    erosion_effect.data(), layers[FINAL_TERRAIN].data(), count);
 
-    // Normalize to [0, 1] range
-    for (float &val : heightmap)
+    // Normalize the noise layers from [-1, 1] to [0, 1]
+    for (int layer = 0; layer < FINAL_TERRAIN; layer++)
     {
-        val = (val - minHeight) / (maxHeight - minHeight);
+        for (float &value : layers[layer])
+        {
+            value = (value + 1.0f) * 0.5f;
+        }
     }
-
-    return heightmap;
 }
 
-void HeightmapGenerator::saveHeightmapAsPNG(const std::vector<float> &heightmap, int width, int height, const std::string &filename)
+bool HeightmapGenerator::saveHeightmapAsPNG(const std::vector<unsigned char> &grayscale, int width, int height, const std::string &filename)
 {
-    auto grayscale = floatToGrayscale(heightmap);
-
     if (stbi_write_png(filename.c_str(), width, height, 1, grayscale.data(), width))
     {
         std::cout << "Saved heightmap: " << filename << std::endl;
+        return true;
     }
-    else
-    {
-        std::cout << "Failed to save heightmap: " << filename << std::endl;
-    }
+    std::cout << "Failed to save heightmap: " << filename << std::endl;
+    return false;
 }
 
-std::vector<unsigned char> HeightmapGenerator::floatToGrayscale(const std::vector<float> &heightmap)
+std::vector<unsigned char> HeightmapGenerator::floatToGrayscale(const std::vector<float> &heightmap, float low, float high)
 {
     std::vector<unsigned char> grayscale(heightmap.size());
+    const float scale = high > low ? 1.0f / (high - low) : 0.0f;
 
     for (size_t i = 0; i < heightmap.size(); i++)
     {
         // Clamp to [0, 1] and convert to [0, 255]
-        float val = std::max(0.0f, std::min(1.0f, heightmap[i]));
+        float val = std::max(0.0f, std::min(1.0f, (heightmap[i] - low) * scale));
         grayscale[i] = static_cast<unsigned char>(val * 255.0f);
     }
 
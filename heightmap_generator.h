@@ -2,23 +2,51 @@
 #define HEIGHTMAP_GENERATOR_H
 
 #include "voxel world/voxel_noise.h"
+#include <array>
 #include <vector>
 #include <string>
 
+// Grayscale maps of the terrain noise layers and the final terrain height, one pixel per
+// world column. Every layer is computed in the same pass, a tile per job across the cores,
+// with one GenUniformGrid2D call per layer and tile.
 class HeightmapGenerator
 {
 public:
+    static constexpr int TILE_SIZE = 256;            // Pixels per side of one job's tile
+    static constexpr int EXPORT_TILE_SIZE = 1024;    // Pixels per side of one exported PNG
+    static constexpr size_t MAX_PENDING_TILES = 8;   // Finished tiles waiting for the encoder
+
+    // One PNG per layer in heightmaps/; the whole map is held in memory
     static void generateAllHeightmaps(uint32_t seed, int width = 512, int height = 512);
 
+    // Maps of any size as EXPORT_TILE_SIZE PNG tiles, heightmaps/tiles/<layer>/<x>_<y>.png.
+    // Only the tiles in flight are held in memory and PNG encoding runs on its own thread
+    // while the next tiles are generated. The final terrain is scaled to the world height
+    // rather than the map's range, which is not known until the end. False if anything
+    // failed to write.
+    static bool exportTiledHeightmaps(uint32_t seed, int width, int height);
+
 private:
-    static void saveHeightmapAsPNG(const std::vector<float> &heightmap, int width, int height, const std::string &filename);
-    static std::vector<unsigned char> floatToGrayscale(const std::vector<float> &heightmap);
-    static std::vector<float> generateContinentalHeightmap(const VoxelNoise &noise, int width, int height, float scale);
-    static std::vector<float> generateErosionHeightmap(const VoxelNoise &noise, int width, int height, float scale);
-    static std::vector<float> generatePeaksValleysHeightmap(const VoxelNoise &noise, int width, int height, float scale);
-    static std::vector<float> generateFinalTerrainHeightmap(const VoxelNoise &noise, int width, int height, float scale);
-    static std::vector<float> generateSimplexHeightmap(const VoxelNoise &noise, int width, int height, float scale);
-    static std::vector<float> generateFractalHeightmap(const VoxelNoise &noise, int width, int height, float scale);
+    enum Layer
+    {
+        CONTINENTAL,
+        EROSION,
+        PEAKS_VALLEYS,
+        SIMPLEX,
+        FRACTAL,
+        FINAL_TERRAIN, // Terrain height in blocks, the others normalized noise in [0, 1]
+        LAYER_COUNT
+    };
+    static const char *const LAYER_NAMES[LAYER_COUNT];
+
+    using TileLayers = std::array<std::vector<float>, LAYER_COUNT>;
+
+    // Every layer of the width by height block of columns from (start_x, start_y), row-major
+    static void generateTile(uint32_t seed, int start_x, int start_y, int width, int height, TileLayers &layers);
+
+    static bool saveHeightmapAsPNG(const std::vector<unsigned char> &grayscale, int width, int height, const std::string &filename);
+    // Values from [low, high] to [0, 255], clamped
+    static std::vector<unsigned char> floatToGrayscale(const std::vector<float> &heightmap, float low = 0.0f, float high = 1.0f);
 };
 
 #endif // HEIGHTMAP_GENERATOR_H
@@ -0,0 +1,108 @@
+#include "hitch_monitor.h"
+#include "voxel world/log.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+bool HitchMonitor::endFrame(float frame_ms, const VoxelRenderer &renderer)
+{
+    FrameRecord &record = history[frames_recorded % HISTORY_FRAMES];
+    record.frame = frames_recorded++;
+    record.start_ns = frame_start_ns;
+    record.frame_ms = frame_ms;
+    record.update_ms = renderer.getLastUpdateTime();
+    record.render_ms = renderer.getLastFrameTime();
+    record.gpu_ms = renderer.getGpuFrameTime();
+    record.streaming = renderer.getStreamingStats();
+
+    // Judge frames only against a full window
+    if (frames_recorded < HISTORY_FRAMES)
+    {
+        return false;
+    }
+    updateStatistics();
+
+    bool hitch = frame_ms >= median_ms * HITCH_MEDIAN_FACTOR && frame_ms - median_ms >= MIN_HITCH_MS;
+    if (!hitch || reports_written >= MAX_REPORTS)
+    {
+        return false;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (reports_written > 0 && std::chrono::duration<float>(now - last_report).count() < REPORT_COOLDOWN_SECONDS)
+    {
+        return false;
+    }
+    last_report = now;
+    return writeReport(record);
+}
+
+void HitchMonitor::updateStatistics()
+{
+    std::array<float, HISTORY_FRAMES> times;
+    double sum = 0.0;
+    for (size_t i = 0; i < HISTORY_FRAMES; i++)
+    {
+        times[i] = history[i].frame_ms;
+        sum += times[i];
+    }
+    float mean = static_cast<float>(sum / HISTORY_FRAMES);
+    double variance = 0.0;
+    for (float time : times)
+    {
+        variance += (time - mean) * (time - mean);
+    }
+    stddev_ms = static_cast<float>(std::sqrt(variance / HISTORY_FRAMES));
+
+    std::nth_element(times.begin(), times.begin() + HISTORY_FRAMES / 2, times.end());
+    median_ms = times[HISTORY_FRAMES / 2];
+}
+
+bool HitchMonitor::writeReport(const FrameRecord &hitch)
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::string base = directory + "/hitch_" + std::to_string(reports_written) + "_frame" + std::to_string(hitch.frame);
+    reports_written++;
+
+    // Oldest first
+    std::vector<const FrameRecord *> frames;
+    for (size_t i = 0; i < HISTORY_FRAMES; i++)
+    {
+        frames.push_back(&history[(frames_recorded + i) % HISTORY_FRAMES]);
+    }
+
+    std::ofstream out(base + ".json", std::ios::trunc);
+    out << "{\n  \"frame\": " << hitch.frame << ",\n  \"frame_ms\": " << hitch.frame_ms << ",\n  \"median_ms\": "
+        << median_ms << ",\n  \"stddev_ms\": " << stddev_ms << ",\n  \"frames\": [";
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        const FrameRecord &frame = *frames[i];
+        const StreamingStats &stats = frame.streaming;
+        out << (i ? "," : "") << "\n    {\"frame\": " << frame.frame << ", \"frame_ms\": " << frame.frame_ms
+            << ", \"update_ms\": " << frame.update_ms << ", \"render_ms\": " << frame.render_ms
+            << ", \"gpu_ms\": " << frame.gpu_ms << ", \"loaded_chunks\": " << stats.loaded_chunks
+            << ", \"pending_loads\": " << stats.pending_loads << ", \"generation_queued\": " << stats.generation_queued
+            << ", \"generation_in_flight\": " << stats.generation_in_flight << ", \"need_mesh\": " << stats.chunks_need_mesh
+            << ", \"meshing\": " << stats.chunks_meshing << ", \"uploads_waiting\": " << stats.uploads_waiting
+            << ", \"meshes_uploaded\": " << stats.meshes_uploaded << ", \"bytes_uploaded\": " << stats.bytes_uploaded << "}";
+    }
+    out << "\n  ]\n}\n";
+    if (!out)
+    {
+        Log::write(LogLevel::Error, "Hitch monitor: failed to write " + base + ".json");
+        return false;
+    }
+
+    // Zones from the first frame of the window on, when a capture is running
+    std::string trace_note = " (profiler capture off, no trace)";
+    if (Profiler::isEnabled() && Profiler::writeChromeTrace(base + "_trace.json", frames.front()->start_ns))
+    {
+        trace_note = " and " + base + "_trace.json";
+    }
+    Log::write(LogLevel::Warning, "Hitch: frame " + std::to_string(hitch.frame) + " took " +
+                                      std::to_string(hitch.frame_ms) + "ms (median " + std::to_string(median_ms) +
+                                      "ms), wrote " + base + ".json" + trace_note);
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef HITCH_MONITOR_H
+#define HITCH_MONITOR_H
+
+#include "voxel world/voxel_renderer.h"
+#include "voxel world/profiler.h"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Watches frame pacing and writes a report whenever a frame hitches, so streaming stalls seen in
+// the field can be diagnosed from the files instead of reproduced by hand.
+//
+// A frame is a hitch when it takes HITCH_MEDIAN_FACTOR times the median of the last
+// HISTORY_FRAMES frames and at least MIN_HITCH_MS more than it. Each report holds the timing,
+// queue depths and upload activity of every frame in the window, plus a Chrome trace of the
+// profiler zones recorded over those frames when profiler capture is on.
+class HitchMonitor
+{
+public:
+    static constexpr size_t HISTORY_FRAMES = 240;
+    static constexpr float HITCH_MEDIAN_FACTOR = 2.0f;
+    static constexpr float MIN_HITCH_MS = 8.0f; // A 2 ms frame doubling is not a hitch
+    static constexpr float REPORT_COOLDOWN_SECONDS = 5.0f; // One report per burst of hitches
+    static constexpr int MAX_REPORTS = 20;                  // Per session
+
+    explicit HitchMonitor(std::string directory = "hitches") : directory(std::move(directory)) {}
+
+    void beginFrame() { frame_start_ns = Profiler::now(); }
+    // frame_ms covers the whole frame, swap included; true if a report was written
+    bool endFrame(float frame_ms, const VoxelRenderer &renderer);
+
+    // Over the history window
+    float getMedian() const { return median_ms; }
+    float getStdDev() const { return stddev_ms; }
+
+private:
+    struct FrameRecord
+    {
+        uint64_t frame = 0;
+        uint64_t start_ns = 0; // Profiler clock
+        float frame_ms = 0.0f;
+        float update_ms = 0.0f; // CPU update work
+        float render_ms = 0.0f; // CPU submission
+        float gpu_ms = 0.0f;    // Timed GPU passes, a frame or two late
+        StreamingStats streaming;
+    };
+
+    std::string directory;
+    std::array<FrameRecord, HISTORY_FRAMES> history;
+    uint64_t frames_recorded = 0;
+    uint64_t frame_start_ns = 0;
+    float median_ms = 0.0f;
+    float stddev_ms = 0.0f;
+    int reports_written = 0;
+    std::chrono::steady_clock::time_point last_report;
+
+    void updateStatistics();
+    bool writeReport(const FrameRecord &hitch);
+};
+
+#endif // HITCH_MONITOR_H
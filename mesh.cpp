@@ -1,14 +1,24 @@
 #include "mesh.h"
+#include <cstddef>
 
 Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures){
     this->vertices = vertices;
     this->indices = indices;
     this->textures = textures;
+    index_count = this->indices.size();
 
-    setupMesh();
+    setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data());
 }
 
-void Mesh::setupMesh (){
+Mesh::Mesh(const Vertex *vertex_data, size_t vertex_count, const unsigned int *index_data, size_t index_count,
+           std::vector<Texture> textures){
+    this->textures = textures;
+    this->index_count = index_count;
+
+    setupMesh(vertex_data, vertex_count, index_data);
+}
+
+void Mesh::setupMesh (const Vertex *vertex_data, size_t vertex_count, const unsigned int *index_data){
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
@@ -16,10 +26,10 @@ void Mesh::setupMesh (){
     glBindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(Vertex), vertex_data, GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * sizeof(unsigned int), index_data, GL_STATIC_DRAW);
 
     //vertex positions
     glEnableVertexAttribArray(0);
@@ -33,30 +43,62 @@ void Mesh::setupMesh (){
 
     glBindVertexArray(0);
 
-}
-
-void Mesh::Draw(Shader &shader) 
-{
+    // retrieve texture numbers (the N in diffuse_textureN) once
     unsigned int diffuseNr = 1;
     unsigned int specularNr = 1;
-    for(unsigned int i = 0; i < textures.size(); i++)
+    sampler_names.clear();
+    for(const Texture &texture : textures)
     {
-        glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
-        // retrieve texture number (the N in diffuse_textureN)
         std::string number;
-        std::string name = textures[i].type;
-        if(name == "texture_diffuse")
+        if(texture.type == "texture_diffuse")
             number = std::to_string(diffuseNr++);
-        else if(name == "texture_specular")
+        else if(texture.type == "texture_specular")
             number = std::to_string(specularNr++);
+        sampler_names.push_back("material." + texture.type + number);
+    }
+}
 
-        shader.setInt(("material." + name + number).c_str(), i);
+void Mesh::bindTextures(Shader &shader)
+{
+    for(unsigned int i = 0; i < textures.size(); i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
+        shader.setInt(sampler_names[i], i);
         glBindTexture(GL_TEXTURE_2D, textures[i].id);
     }
     glActiveTexture(GL_TEXTURE0);
+}
+
+void Mesh::Draw(Shader &shader) 
+{
+    bindTextures(shader);
 
     // draw mesh
     glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(index_count), GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
+
+void Mesh::DrawInstanced(Shader &shader, unsigned int instance_buffer, size_t instance_count)
+{
+    if(instance_count == 0)
+        return;
+    bindTextures(shader);
+
+    glBindVertexArray(VAO);
+    if(attached_instance_buffer != instance_buffer)
+    {
+        // a mat4 attribute takes four vec4 locations, one column each, advancing per instance
+        glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+        for(unsigned int column = 0; column < 4; column++)
+        {
+            glEnableVertexAttribArray(3 + column);
+            glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(3 + column, 1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        attached_instance_buffer = instance_buffer;
+    }
+    glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(index_count), GL_UNSIGNED_INT, 0, static_cast<GLsizei>(instance_count));
     glBindVertexArray(0);
 }
@@ -21,17 +21,30 @@ struct Texture {
 
 class Mesh {
     public:
-        // mesh data
+        // mesh data (CPU copies are only kept for meshes built from vectors, i.e. imported ones)
         std::vector<Vertex>       vertices;
         std::vector<unsigned int> indices;
         std::vector<Texture>      textures;
 
         Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
+        // Uploads straight from memory the caller owns, e.g. a mapped mesh cache
+        Mesh(const Vertex *vertex_data, size_t vertex_count, const unsigned int *index_data, size_t index_count,
+             std::vector<Texture> textures);
         void Draw(Shader &shader);
+        // One draw for every instance; instance_buffer holds instance_count model matrices
+        // (attribute locations 3-6, see shaders/model_instanced.vs)
+        void DrawInstanced(Shader &shader, unsigned int instance_buffer, size_t instance_count);
+
+        size_t getIndexCount() const { return index_count; }
 
     private:
         // render data
         unsigned int VAO, VBO, EBO;
-
-        void setupMesh();
-};
\ No newline at end of file
+        size_t index_count;
+        unsigned int attached_instance_buffer = 0;
+        // "material.texture_diffuse1"... per texture, resolved once instead of every draw
+        std::vector<std::string> sampler_names;
+
+        void setupMesh(const Vertex *vertex_data, size_t vertex_count, const unsigned int *index_data);
+        void bindTextures(Shader &shader);
+}; 
@@ -1,10 +1,64 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "model.h"
+#include "texture_loader.h"
+#include "voxel world/file_mapping.h"
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 
 unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma = false);
 
+namespace
+{
+constexpr uint32_t MESH_CACHE_MAGIC = 0x314D5856; // "VXM1"
+
+// Layout: header, one entry per mesh, then per mesh its textures (record + path padded to
+// 4 bytes), vertices and indices
+struct MeshCacheHeader
+{
+    uint32_t magic;
+    uint32_t mesh_count;
+    uint64_t source_size;  // Model file this was imported from; any change re-imports
+    int64_t source_time;
+};
+
+struct MeshCacheEntry
+{
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t texture_count;
+    uint32_t reserved;
+};
+
+struct MeshCacheTexture
+{
+    uint32_t path_size;
+    uint32_t specular; // texture_specular, texture_diffuse otherwise
+};
+
+size_t padded(size_t size)
+{
+    return (size + 3) & ~static_cast<size_t>(3);
+}
+
+bool getSourceStamp(const std::string &path, uint64_t &size, int64_t &time)
+{
+    std::error_code error;
+    size = static_cast<uint64_t>(std::filesystem::file_size(path, error));
+    if (error)
+        return false;
+    time = static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+    return !error;
+}
+}
+
 void Model::loadModel(std::string path)
 {
+    directory = path.substr(0, path.find_last_of('/'));
+    if (loadMeshCache(path))
+        return;
+
     Assimp::Importer import;
     const aiScene *scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
 
@@ -12,9 +66,121 @@ void Model::loadModel(std::string path)
         std::cout << "ERROR::ASSIMP::" << import.GetErrorString() << std::endl;
         return;
     }
-    directory = path.substr(0, path.find_last_of('/'));
 
     processNode(scene->mRootNode, scene);
+    storeMeshCache(path);
+}
+
+bool Model::loadMeshCache(const std::string &path)
+{
+    uint64_t source_size;
+    int64_t source_time;
+    if (!getSourceStamp(path, source_size, source_time))
+        return false;
+
+    FileMapping mapping(path + ".meshcache");
+    MeshCacheHeader header;
+    if (!mapping.data || mapping.size < sizeof(header))
+        return false;
+    std::memcpy(&header, mapping.data, sizeof(header));
+    if (header.magic != MESH_CACHE_MAGIC || header.source_size != source_size || header.source_time != source_time)
+        return false; // Stale: imported again and rewritten
+    size_t offset = sizeof(header);
+    if (mapping.size - offset < static_cast<size_t>(header.mesh_count) * sizeof(MeshCacheEntry))
+        return false;
+    std::vector<MeshCacheEntry> entries(header.mesh_count);
+    std::memcpy(entries.data(), mapping.data + offset, entries.size() * sizeof(MeshCacheEntry));
+    offset += entries.size() * sizeof(MeshCacheEntry);
+
+    // Validate everything first so a truncated cache never leaves a half-loaded model
+    struct MeshData
+    {
+        std::vector<std::pair<std::string, std::string>> textures; // path, type
+        const Vertex *vertex_data;
+        const unsigned int *index_data;
+    };
+    std::vector<MeshData> parsed(entries.size());
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        for (uint32_t t = 0; t < entries[i].texture_count; t++)
+        {
+            MeshCacheTexture texture;
+            if (mapping.size - offset < sizeof(texture))
+                return false;
+            std::memcpy(&texture, mapping.data + offset, sizeof(texture));
+            offset += sizeof(texture);
+            if (mapping.size - offset < padded(texture.path_size))
+                return false;
+            parsed[i].textures.emplace_back(std::string(reinterpret_cast<const char *>(mapping.data + offset), texture.path_size),
+                                            texture.specular ? "texture_specular" : "texture_diffuse");
+            offset += padded(texture.path_size);
+        }
+        size_t vertex_bytes = static_cast<size_t>(entries[i].vertex_count) * sizeof(Vertex);
+        size_t index_bytes = static_cast<size_t>(entries[i].index_count) * sizeof(unsigned int);
+        if (mapping.size - offset < vertex_bytes + index_bytes)
+            return false;
+        parsed[i].vertex_data = reinterpret_cast<const Vertex *>(mapping.data + offset);
+        parsed[i].index_data = reinterpret_cast<const unsigned int *>(mapping.data + offset + vertex_bytes);
+        offset += vertex_bytes + index_bytes;
+    }
+
+    // Uploaded straight from the mapping, no CPU copy
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        std::vector<Texture> textures;
+        for (const auto &[texture_path, type] : parsed[i].textures)
+            textures.push_back(loadTexture(texture_path, type));
+        meshes.emplace_back(parsed[i].vertex_data, entries[i].vertex_count, parsed[i].index_data, entries[i].index_count,
+                            std::move(textures));
+    }
+    return true;
+}
+
+void Model::storeMeshCache(const std::string &path) const
+{
+    MeshCacheHeader header{MESH_CACHE_MAGIC, static_cast<uint32_t>(meshes.size()), 0, 0};
+    if (!getSourceStamp(path, header.source_size, header.source_time))
+        return;
+
+    // Written next to the cache and renamed over it, so a crash never leaves half a file
+    std::string cache_path = path + ".meshcache";
+    std::string temp_path = cache_path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (const Mesh &mesh : meshes)
+        {
+            MeshCacheEntry entry{static_cast<uint32_t>(mesh.vertices.size()), static_cast<uint32_t>(mesh.indices.size()),
+                                 static_cast<uint32_t>(mesh.textures.size()), 0};
+            file.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+        }
+        const char padding[4] = {};
+        for (const Mesh &mesh : meshes)
+        {
+            for (const Texture &texture : mesh.textures)
+            {
+                MeshCacheTexture record{static_cast<uint32_t>(texture.path.size()), texture.type == "texture_specular" ? 1u : 0u};
+                file.write(reinterpret_cast<const char *>(&record), sizeof(record));
+                file.write(texture.path.data(), texture.path.size());
+                file.write(padding, padded(texture.path.size()) - texture.path.size());
+            }
+            file.write(reinterpret_cast<const char *>(mesh.vertices.data()), mesh.vertices.size() * sizeof(Vertex));
+            file.write(reinterpret_cast<const char *>(mesh.indices.data()), mesh.indices.size() * sizeof(unsigned int));
+        }
+        if (!file)
+        {
+            std::cout << "Mesh cache: failed to write " << temp_path << std::endl;
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_path, cache_path, error);
+    if (error)
+    {
+        std::cout << "Mesh cache: failed to replace " << cache_path << ": " << error.message() << std::endl;
+        std::filesystem::remove(temp_path, error);
+    }
 }
 
 void Model::processNode(aiNode *node, const aiScene *scene)
@@ -98,29 +264,33 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, aiTextureType
     {
         aiString str;
         mat->GetTexture(type, i, &str);
-        bool skip = false;
-        for(unsigned int j = 0; j < textures_loaded.size(); j++)
-        {
-            if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-            {
-                textures.push_back(textures_loaded[j]);
-                skip = true;
-                break;
-            }
-        }
-        if(!skip)
-        {   // if texture hasn't been loaded already, load it
-            Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), directory);
-            texture.type = typeName;
-            texture.path = str.C_Str();
-            textures.push_back(texture);
-            textures_loaded.push_back(texture); // add to loaded textures
-        }
+        textures.push_back(loadTexture(str.C_Str(), typeName));
     }
     return textures;
 }
 
+Texture Model::loadTexture(const std::string &path, const std::string &typeName)
+{
+    Texture texture;
+    texture.type = typeName;
+    texture.path = path;
+    if(texture_loader)
+    {
+        texture.id = texture_loader->request(directory + '/' + path);
+        return texture;
+    }
+
+    auto loaded = textures_loaded.find(path);
+    if(loaded != textures_loaded.end())
+    {
+        return loaded->second;
+    }
+    // texture hasn't been loaded already, load it
+    texture.id = TextureFromFile(path.c_str(), directory);
+    textures_loaded.emplace(path, texture); // add to loaded textures
+    return texture;
+}
+
 void Model::Draw(Shader &shader)
 {
     for (unsigned int i = 0; i < meshes.size(); i++){
@@ -128,6 +298,31 @@ void Model::Draw(Shader &shader)
     }
 }
 
+void Model::DrawInstanced(Shader &shader, const glm::mat4 *transforms, size_t count)
+{
+    if (count == 0)
+        return;
+
+    // Shared by every mesh of the model: uploaded once per call
+    if (instance_buffer == 0)
+        glGenBuffers(1, &instance_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+    if (count > instance_capacity)
+    {
+        instance_capacity = count;
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(glm::mat4), transforms, GL_DYNAMIC_DRAW);
+    }
+    else
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::mat4), transforms);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    for (unsigned int i = 0; i < meshes.size(); i++){
+        meshes[i].DrawInstanced(shader, instance_buffer, count);
+    }
+}
+
 
 unsigned int TextureFromFile(const char *path, const std::string &directory, bool gamma)
 {
@@ -6,6 +6,10 @@
 #include <assimp/postprocess.h>
 #include "mesh.h"
 #include <iostream>
+#include <unordered_map>
+#include <vector>
+
+class TextureLoader;
 
 
 class Model
@@ -18,18 +22,42 @@ class Model
         {
             loadModel(path);
         }
+        // Textures stream in through the loader (shared with the other models using it)
+        // instead of being decoded here; meshes draw with a placeholder until theirs land
+        Model(const char *path, TextureLoader &texture_loader, bool gamma = false)
+            : gammaCorrection(gamma), texture_loader(&texture_loader)
+        {
+            loadModel(path);
+        }
         void Draw(Shader &shader);
 
         void DrawMesh(Shader &shader, unsigned int index);
 
+        // Every placement in one draw per mesh; the shader takes the model matrix as a
+        // per-instance attribute (shaders/model_instanced.vs) instead of the "model" uniform
+        void DrawInstanced(Shader &shader, const glm::mat4 *transforms, size_t count);
+        void DrawInstanced(Shader &shader, const std::vector<glm::mat4> &transforms)
+        {
+            DrawInstanced(shader, transforms.data(), transforms.size());
+        }
+
     private:
         std::string directory;
-        std::vector<Texture> textures_loaded;
+        std::unordered_map<std::string, Texture> textures_loaded; // by path, without a loader
         bool gammaCorrection;
+        TextureLoader *texture_loader = nullptr;
+        unsigned int instance_buffer = 0;
+        size_t instance_capacity = 0;
 
         void loadModel(std::string path);
         void processNode(aiNode *node, const aiScene *scene);
         Mesh processMesh(aiMesh *mesh, const aiScene *scene);
         std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type,
                                              std::string typeName);
-};
\ No newline at end of file
+        Texture loadTexture(const std::string &path, const std::string &typeName);
+
+        // Binary copy of the imported meshes next to the model file ("<path>.meshcache"), so
+        // assimp only runs when the model is new or has changed since it was written
+        bool loadMeshCache(const std::string &path);
+        void storeMeshCache(const std::string &path) const;
+};
@@ -0,0 +1,366 @@
+// Terrain noise microbenchmarks.
+//
+// Times the pieces chunk generation is built from: single-sample noise lookups against the
+// batched grid path, the spline evaluators against their lookup tables, and the per-chunk height
+// cache end to end. Each benchmark runs in batches that grow until one takes --min-time
+// seconds and reports the fastest of --repeat such batches, per call and per sample; results
+// go to a JSON or CSV file for comparing builds or generator graph changes.
+//
+// Usage: noise_bench [--seed N] [--filter text] [--min-time seconds] [--repeat N] [--csv] [--output path]
+
+#include "voxel world/voxel_noise.h"
+#include "voxel world/voxel_chunk.h"
+#include "voxel world/height_field_cache.h"
+#include "voxel world/voxel_types.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct BenchOptions
+{
+    uint32_t seed = 12345;
+    std::string filter; // Only benchmarks whose name contains this
+    double min_time = 0.2; // Seconds per timed batch
+    int repeat = 5;
+    bool csv = false;
+    std::string output = "noise_bench.json";
+};
+
+struct MicroResult
+{
+    std::string name;
+    size_t samples_per_call = 0;
+    uint64_t calls = 0; // In the fastest batch
+    double ns_per_call = 0.0;
+
+    double nsPerSample() const { return samples_per_call ? ns_per_call / samples_per_call : 0.0; }
+};
+
+// Results are summed into this so the measured work cannot be optimized away
+volatile float result_sink = 0.0f;
+
+bool parseOptions(int argc, char **argv, BenchOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--seed" && has_value)
+        {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--filter" && has_value)
+        {
+            options.filter = argv[++i];
+        }
+        else if (arg == "--min-time" && has_value)
+        {
+            options.min_time = std::max(0.001, std::atof(argv[++i]));
+        }
+        else if (arg == "--repeat" && has_value)
+        {
+            options.repeat = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--csv")
+        {
+            options.csv = true;
+        }
+        else if (arg == "--output" && has_value)
+        {
+            options.output = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Usage: noise_bench [--seed N] [--filter text] [--min-time seconds] [--repeat N] [--csv] "
+                         "[--output path]"
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+class MicroBenchRunner
+{
+public:
+    explicit MicroBenchRunner(const BenchOptions &options) : options(options) {}
+
+    // body(call) does one call's worth of work; call counts up so inputs can vary per call
+    void run(const std::string &name, size_t samples_per_call, const std::function<void(uint64_t)> &body)
+    {
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos)
+        {
+            return;
+        }
+
+        uint64_t call = 0;
+        body(call++); // Warm up caches, thread-local generators and scratch buffers
+
+        // Grow the batch until it is long enough to time, then keep the fastest batch
+        uint64_t batch = 1;
+        MicroResult result;
+        result.name = name;
+        result.samples_per_call = samples_per_call;
+        for (int pass = 0; pass < options.repeat;)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < batch; i++)
+            {
+                body(call++);
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (seconds < options.min_time)
+            {
+                batch *= 2;
+                continue;
+            }
+
+            double ns_per_call = seconds * 1e9 / static_cast<double>(batch);
+            if (pass == 0 || ns_per_call < result.ns_per_call)
+            {
+                result.ns_per_call = ns_per_call;
+                result.calls = batch;
+            }
+            pass++;
+        }
+
+        std::cout << name << ": " << result.ns_per_call << " ns/call, " << result.nsPerSample() << " ns/sample" << std::endl;
+        results.push_back(result);
+    }
+
+    bool writeResults() const
+    {
+        std::ofstream out(options.output, std::ios::trunc);
+        if (!out)
+        {
+            std::cerr << "Failed to open " << options.output << std::endl;
+            return false;
+        }
+
+        if (options.csv)
+        {
+            out << "benchmark,samples_per_call,calls,ns_per_call,ns_per_sample\n";
+            for (const MicroResult &result : results)
+            {
+                out << result.name << "," << result.samples_per_call << "," << result.calls << "," << result.ns_per_call
+                    << "," << result.nsPerSample() << "\n";
+            }
+        }
+        else
+        {
+            out << "{\n  \"seed\": " << options.seed << ",\n  \"generator_version\": " << VoxelNoise::GENERATOR_VERSION
+                << ",\n  \"results\": [";
+            for (size_t i = 0; i < results.size(); i++)
+            {
+                const MicroResult &result = results[i];
+                out << (i ? "," : "") << "\n    {\"benchmark\": \"" << result.name
+                    << "\", \"samples_per_call\": " << result.samples_per_call << ", \"calls\": " << result.calls
+                    << ", \"ns_per_call\": " << result.ns_per_call << ", \"ns_per_sample\": " << result.nsPerSample() << "}";
+            }
+            out << "\n  ]\n}\n";
+        }
+
+        if (!out)
+        {
+            std::cerr << "Failed to write " << options.output << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    const BenchOptions &options;
+    std::vector<MicroResult> results;
+};
+
+constexpr int GRID_SIDE = 64; // Columns per side of each noise grid call
+constexpr size_t GRID_SAMPLES = static_cast<size_t>(GRID_SIDE) * GRID_SIDE;
+
+// Each call samples a different block of columns so no result is reused
+int getGridOrigin(uint64_t call)
+{
+    return static_cast<int>(call % 1024) * GRID_SIDE;
+}
+
+// Single GenSingle2D lookups per column against one GenUniformGrid2D per layer
+void addNoiseBenchmarks(MicroBenchRunner &runner, VoxelNoise &noise)
+{
+    struct Layer
+    {
+        const char *name;
+        float (*sample)(VoxelNoise &, float, float);
+    };
+    const Layer layers[] = {
+        {"continentalness", [](VoxelNoise &n, float x, float z) { return n.getContinentalness(x, z); }},
+        {"erosion", [](VoxelNoise &n, float x, float z) { return n.getErosion(x, z); }},
+        {"peaks_valleys", [](VoxelNoise &n, float x, float z) { return n.getPeaksandValleysGenerator(x, z); }},
+    };
+    for (const Layer &layer : layers)
+    {
+        runner.run(std::string("noise/single/") + layer.name, GRID_SAMPLES, [&](uint64_t call)
+                   {
+                       int origin = getGridOrigin(call);
+                       float sum = 0.0f;
+                       for (int x = 0; x < GRID_SIDE; x++)
+                       {
+                           for (int z = 0; z < GRID_SIDE; z++)
+                           {
+                               sum += layer.sample(noise, (origin + x) * VoxelNoise::TERRAIN_FREQUENCY,
+                                                   (origin + z) * VoxelNoise::TERRAIN_FREQUENCY);
+                           }
+                       }
+                       result_sink = result_sink + sum; });
+    }
+
+    runner.run("noise/single/terrain_height", GRID_SAMPLES, [&](uint64_t call)
+               {
+                   int origin = getGridOrigin(call);
+                   int sum = 0;
+                   for (int x = 0; x < GRID_SIDE; x++)
+                   {
+                       for (int z = 0; z < GRID_SIDE; z++)
+                       {
+                           sum += noise.sampleTerrainHeight(origin + x, origin + z);
+                       }
+                   }
+                   result_sink = result_sink + static_cast<float>(sum); });
+
+    std::vector<int> heights(GRID_SAMPLES);
+    for (int step : {1, 4})
+    {
+        runner.run("noise/grid/height_field_step" + std::to_string(step), GRID_SAMPLES, [&, step](uint64_t call)
+                   {
+                       noise.generateHeightField(getGridOrigin(call) * step, 0, GRID_SIDE, GRID_SIDE, heights.data(), step);
+                       result_sink = result_sink + static_cast<float>(heights[call % GRID_SAMPLES]); });
+    }
+}
+
+// The scanning and branchless spline evaluators against the lookup tables terrain uses
+template <size_t N>
+void addSplineEvaluatorBenchmarks(MicroBenchRunner &runner, const char *name, const TerrainSpline<N> &spline,
+                                  const VoxelNoise::TerrainLut &lut, const std::vector<float> &inputs,
+                                  std::vector<float> &outputs)
+{
+    runner.run(std::string("spline/scan/") + name, GRID_SAMPLES, [&](uint64_t)
+               {
+                   float sum = 0.0f;
+                   for (float t : inputs)
+                   {
+                       sum += spline.eval(t);
+                   }
+                   result_sink = result_sink + sum; });
+    runner.run(std::string("spline/batch/") + name, GRID_SAMPLES, [&](uint64_t call)
+               {
+                   spline.evalBatch(inputs.data(), outputs.data(), outputs.size());
+                   result_sink = result_sink + outputs[call % GRID_SAMPLES]; });
+    runner.run(std::string("spline/lut/") + name, GRID_SAMPLES, [&](uint64_t call)
+               {
+                   lut.evalBatch(inputs.data(), outputs.data(), outputs.size());
+                   result_sink = result_sink + outputs[call % GRID_SAMPLES]; });
+}
+
+void addSplineBenchmarks(MicroBenchRunner &runner)
+{
+    // Inputs spread over the clamped noise range, like real noise values
+    std::vector<float> inputs(GRID_SAMPLES);
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        inputs[i] = -1.0f + 2.0f * static_cast<float>((i * 2654435761u) % GRID_SAMPLES) / GRID_SAMPLES;
+    }
+    std::vector<float> outputs(GRID_SAMPLES);
+
+    addSplineEvaluatorBenchmarks(runner, "continental", VoxelNoise::CONTINENTAL_SPLINE, VoxelNoise::getContinentalLut(),
+                                 inputs, outputs);
+    addSplineEvaluatorBenchmarks(runner, "erosion", VoxelNoise::EROSION_SPLINE, VoxelNoise::getErosionLut(), inputs, outputs);
+
+    std::vector<float> continental(GRID_SAMPLES), erosion(GRID_SAMPLES), peaks(GRID_SAMPLES), erosion_effect(GRID_SAMPLES);
+    runner.run("spline/blend_terrain_heights", GRID_SAMPLES, [&](uint64_t call)
+               {
+                   // Blending clamps in place, so start from the same inputs every call
+                   std::copy(inputs.begin(), inputs.end(), continental.begin());
+                   std::copy(inputs.rbegin(), inputs.rend(), erosion.begin());
+                   std::copy(inputs.begin(), inputs.end(), peaks.begin());
+                   VoxelNoise::blendTerrainHeights(continental.data(), erosion.data(), peaks.data(), erosion_effect.data(),
+                                                   outputs.data(), outputs.size());
+                   result_sink = result_sink + outputs[call % GRID_SAMPLES]; });
+}
+
+// A chunk's extended height cache end to end (through markRestored, which computes it
+// without writing voxels), then full generation for comparison, in both terrain modes
+void addChunkBenchmarks(MicroBenchRunner &runner, const BenchOptions &options)
+{
+    const size_t cache_samples = static_cast<size_t>(CHUNK_SIZE + 2) * (CHUNK_SIZE + 2);
+    VoxelChunk chunk(glm::ivec3(0));
+
+    runner.run("chunk/extended_noise_cache/direct", cache_samples, [&](uint64_t call)
+               {
+                   chunk.reset(glm::ivec3(static_cast<int>(call % 4096), 0, 0));
+                   chunk.markRestored(options.seed);
+                   result_sink = result_sink + static_cast<float>(chunk.version); });
+
+    // Same columns every call: the cost of a chunk whose height tiles are already resident
+    HeightFieldCache heights(options.seed, 64);
+    runner.run("chunk/extended_noise_cache/height_cache_hit", cache_samples, [&](uint64_t call)
+               {
+                   chunk.reset(glm::ivec3(0, static_cast<int>(call % TERRAIN_LAYERS), 0));
+                   chunk.markRestored(options.seed, &heights);
+                   result_sink = result_sink + static_cast<float>(chunk.version); });
+
+    runner.run("chunk/generate/direct", CHUNK_VOLUME, [&](uint64_t call)
+               {
+                   chunk.reset(glm::ivec3(static_cast<int>(call % 4096), 2, 0));
+                   chunk.generate(options.seed);
+                   result_sink = result_sink + static_cast<float>(chunk.getVoxel(0, 0, 0)); });
+
+    // Density terrain against the height field on the layer holding most of the surface, and
+    // on the cave layer below it
+    const struct
+    {
+        const char *name;
+        TerrainMode mode;
+        int layer;
+    } terrain_cases[] = {
+        {"chunk/generate/heightmap/surface", TerrainMode::Heightmap, 1},
+        {"chunk/generate/density/surface", TerrainMode::Density, 1},
+        {"chunk/generate/heightmap/underground", TerrainMode::Heightmap, 0},
+        {"chunk/generate/density/underground", TerrainMode::Density, 0},
+    };
+    for (const auto &terrain_case : terrain_cases)
+    {
+        runner.run(terrain_case.name, CHUNK_VOLUME, [&](uint64_t call)
+                   {
+                       chunk.reset(glm::ivec3(static_cast<int>(call % 4096), terrain_case.layer, 0));
+                       chunk.generate(options.seed, nullptr, terrain_case.mode);
+                       result_sink = result_sink + static_cast<float>(chunk.getVoxel(0, 0, 0)); });
+    }
+}
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 1;
+    }
+
+    MicroBenchRunner runner(options);
+    VoxelNoise &noise = VoxelNoise::forThread(options.seed);
+    addNoiseBenchmarks(runner, noise);
+    addSplineBenchmarks(runner);
+    addChunkBenchmarks(runner, options);
+
+    if (!runner.writeResults())
+    {
+        return 1;
+    }
+    std::cout << "Results written to " << options.output << std::endl;
+    return 0;
+}
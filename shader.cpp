@@ -84,6 +84,64 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
     glDeleteShader(fragment);
 }
 
+Shader::Shader(const char* computePath) : ID(0)
+{
+    std::string computeCode;
+    std::ifstream cShaderFile;
+    cShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+    try
+    {
+        cShaderFile.open(computePath);
+        std::stringstream cShaderStream;
+        cShaderStream << cShaderFile.rdbuf();
+        cShaderFile.close();
+        computeCode = cShaderStream.str();
+    }
+    catch(const std::ifstream::failure &e)
+    {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << computePath << std::endl;
+        return;
+    }
+
+#ifdef GL_VERSION_4_3
+    const char* cShaderCode = computeCode.c_str();
+    int success;
+    char infoLog[512];
+
+    unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(compute, 1, &cShaderCode, NULL);
+    glCompileShader(compute);
+    glGetShaderiv(compute, GL_COMPILE_STATUS, &success);
+    if(!success)
+    {
+        glGetShaderInfoLog(compute, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED\n" << infoLog << std::endl;
+        glDeleteShader(compute);
+        return;
+    }
+
+    ID = glCreateProgram();
+    glAttachShader(ID, compute);
+    glLinkProgram(ID);
+    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+    if(!success)
+    {
+        glGetProgramInfoLog(ID, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        glDeleteProgram(ID);
+        ID = 0;
+    }
+    glDeleteShader(compute);
+#endif
+}
+
+Shader Shader::fromProgram(unsigned int program)
+{
+    Shader shader;
+    shader.ID = program;
+    return shader;
+}
+
 void Shader::use(){
     glUseProgram(ID);
 }
@@ -14,6 +14,10 @@ class Shader{
 
         // Constructor reads and builds the shader
         Shader(const char* vertexPath, const char* fragmentPath);
+        // Compute-only program (needs OpenGL 4.3); ID stays 0 when unavailable
+        explicit Shader(const char* computePath);
+        // Wrap an already linked program (e.g. one restored from a program binary)
+        static Shader fromProgram(unsigned int program);
         // use/activate the shader
         void use();
         // utility uniforms functions
@@ -22,6 +26,8 @@ class Shader{
         void setVec3(const std::string &name, glm::vec3 value) const;
         void setFloat(const std::string &name, float value) const;
         void setMat4(const std::string &name, const glm::mat4 value) const;
+    private:
+        Shader() : ID(0) {}
 };
 
 #endif
\ No newline at end of file
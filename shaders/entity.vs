@@ -0,0 +1,27 @@
+#version 330 core
+
+// Unit cube vertex (see EntityRenderer::initialize)
+layout (location = 0) in vec3 aPos;    // In [-1, 1]
+layout (location = 1) in vec3 aNormal;
+
+// Per instance (see EntityRenderer::Instance in entity_renderer.h)
+layout (location = 2) in vec3 aCenter;      // World space
+layout (location = 3) in vec3 aHalfExtents;
+layout (location = 4) in vec3 aColor;       // Kind tint
+
+// Uniforms
+uniform mat4 view;
+uniform mat4 projection;
+
+// Output to fragment shader
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 Color;
+
+void main()
+{
+    FragPos = aCenter + aPos * aHalfExtents;
+    Normal = aNormal;
+    Color = aColor;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,32 @@
+#version 330 core
+
+// Input from vertex shader
+in vec3 FragPos;
+in vec3 Normal;
+in vec3 Color;
+
+// Uniforms
+uniform vec3 camera_position;
+uniform float inner_radius; // Voxel chunks are drawn inside this horizontal distance
+
+// Output
+out vec4 FragColor;
+
+// Lighting parameters (same as voxel.fs)
+const vec3 lightPos = vec3(100.0, 200.0, 100.0);
+const vec3 lightColor = vec3(1.0, 1.0, 0.9);
+const vec3 ambientColor = vec3(0.3, 0.3, 0.4);
+
+void main()
+{
+    // Leave the loaded area to the voxel chunks
+    if (distance(FragPos.xz, camera_position.xz) < inner_radius) {
+        discard;
+    }
+
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = normalize(lightPos - FragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+
+    FragColor = vec4(Color * (ambientColor + diff * lightColor), 1.0);
+}
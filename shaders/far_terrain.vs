@@ -0,0 +1,23 @@
+#version 330 core
+
+// Vertex attributes (see FarTerrainVertex in far_terrain.h)
+layout (location = 0) in vec3 aPos;    // World space
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec3 aColor;  // Top block tint
+
+// Uniforms
+uniform mat4 view;
+uniform mat4 projection;
+
+// Output to fragment shader
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 Color;
+
+void main()
+{
+    FragPos = aPos;
+    Normal = aNormal;
+    Color = aColor;
+    gl_Position = projection * view * vec4(aPos, 1.0);
+}
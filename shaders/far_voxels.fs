@@ -0,0 +1,148 @@
+#version 430 core
+
+// Raymarches one column's sparse 64-tree (see SparseVoxelTree): from the camera through the
+// fragment, cell by cell, skipping each empty cell at the level it is empty at (a whole
+// layer, 16 blocks, 4 blocks, then single voxels)
+
+in vec3 WorldPos;
+
+// Uniforms
+uniform mat4 view_projection;
+uniform vec3 camera_position;
+uniform vec3 column_origin;    // World position of the column's grid corner
+uniform vec3 box_min;          // Column grid space, voxel-aligned
+uniform vec3 box_max;
+uniform float inner_radius;    // Voxel chunks are drawn inside this horizontal distance
+uniform int zero_to_one_depth; // glClipControl depth range (reverse-Z)
+
+layout(std430, binding = 0) readonly buffer ColumnTree
+{
+    uint tree[];
+};
+layout(std430, binding = 1) readonly buffer VoxelColors
+{
+    vec4 voxel_colors[]; // Per VoxelID
+};
+
+// Output
+out vec4 FragColor;
+
+// Lighting parameters (same as voxel.fs)
+const vec3 lightPos = vec3(100.0, 200.0, 100.0);
+const vec3 lightColor = vec3(1.0, 1.0, 0.9);
+const vec3 ambientColor = vec3(0.3, 0.3, 0.4);
+
+const uint EMPTY = 0xFFFFFFFFu;
+const int MAX_STEPS = 256;
+
+bool hasBit(uint low, uint high, uint bit)
+{
+    return bit < 32u ? ((low >> bit) & 1u) != 0u : ((high >> (bit - 32u)) & 1u) != 0u;
+}
+
+uint rankOf(uint low, uint high, uint bit)
+{
+    if (bit < 32u)
+    {
+        return uint(bitCount(low & ((1u << bit) - 1u)));
+    }
+    return uint(bitCount(low)) + uint(bitCount(high & ((1u << (bit - 32u)) - 1u)));
+}
+
+// Side of the empty cell holding the voxel, or 0 with the voxel's type if it is kept
+int lookup(ivec3 v, out uint voxel)
+{
+    voxel = 0u;
+    uint node = tree[v.y >> 6];
+    if (node == EMPTY)
+    {
+        return 64;
+    }
+    ivec3 local = ivec3(v.x, v.y & 63, v.z);
+    for (int level = 0; level < 3; level++)
+    {
+        int shift = 4 - 2 * level;
+        ivec3 child = (local >> shift) & 3;
+        uint bit = uint((child.y * 4 + child.z) * 4 + child.x);
+        uint low = tree[node];
+        uint high = tree[node + 1u];
+        if (!hasBit(low, high, bit))
+        {
+            return 1 << shift;
+        }
+        uint rank = rankOf(low, high, bit);
+        if (level == 2)
+        {
+            voxel = tree[tree[node + 2u] + rank];
+            return 0;
+        }
+        node = tree[node + 2u] + 3u * rank;
+    }
+    return 0;
+}
+
+void main()
+{
+    vec3 origin = camera_position - column_origin;
+    vec3 direction = normalize(WorldPos - camera_position);
+    direction = mix(direction, vec3(1.0e-6), equal(direction, vec3(0.0))); // No infinite slabs
+    vec3 inverse_direction = 1.0 / direction;
+
+    // Into the box (or from the camera, inside it)
+    vec3 t_low = (box_min - origin) * inverse_direction;
+    vec3 t_high = (box_max - origin) * inverse_direction;
+    vec3 t_near = min(t_low, t_high);
+    vec3 t_far = max(t_low, t_high);
+    float t = max(max(max(t_near.x, t_near.y), t_near.z), 0.0);
+    float t_end = min(min(t_far.x, t_far.y), t_far.z);
+    if (t >= t_end)
+    {
+        discard;
+    }
+    vec3 normal = t_near.x >= max(t_near.y, t_near.z) ? vec3(-sign(direction.x), 0.0, 0.0)
+                : t_near.y >= t_near.z               ? vec3(0.0, -sign(direction.y), 0.0)
+                                                     : vec3(0.0, 0.0, -sign(direction.z));
+
+    ivec3 low_voxel = ivec3(box_min);
+    ivec3 high_voxel = ivec3(box_max) - 1;
+    uint voxel = 0u;
+    bool hit = false;
+    for (int i = 0; i < MAX_STEPS && t < t_end; i++)
+    {
+        // Nudged into the cell the ray is entering
+        ivec3 v = clamp(ivec3(floor(origin + direction * (t + 1.0e-3))), low_voxel, high_voxel);
+        int size = lookup(v, voxel);
+        if (size == 0)
+        {
+            hit = true;
+            break;
+        }
+
+        // Out of the empty cell
+        vec3 cell_min = vec3((v / size) * size);
+        vec3 t_exit = (cell_min + step(0.0, direction) * float(size) - origin) * inverse_direction;
+        t = min(min(t_exit.x, t_exit.y), t_exit.z);
+        normal = t_exit.x <= min(t_exit.y, t_exit.z) ? vec3(-sign(direction.x), 0.0, 0.0)
+               : t_exit.y <= t_exit.z               ? vec3(0.0, -sign(direction.y), 0.0)
+                                                    : vec3(0.0, 0.0, -sign(direction.z));
+    }
+    if (!hit)
+    {
+        discard;
+    }
+
+    // Leave the loaded area to the voxel chunks
+    vec3 position = column_origin + origin + direction * t;
+    if (distance(position.xz, camera_position.xz) < inner_radius)
+    {
+        discard;
+    }
+
+    vec4 clip = view_projection * vec4(position, 1.0);
+    float depth = clip.z / clip.w;
+    gl_FragDepth = zero_to_one_depth != 0 ? depth : depth * 0.5 + 0.5;
+
+    vec3 lightDir = normalize(lightPos - position);
+    float diff = max(dot(normal, lightDir), 0.0);
+    FragColor = vec4(voxel_colors[voxel].rgb * (ambientColor + diff * lightColor), 1.0);
+}
@@ -0,0 +1,28 @@
+#version 430 core
+
+// The box of one column's surface voxels, 36 vertices from gl_VertexID (no vertex buffer);
+// counter-clockwise seen from outside, drawn with front faces culled
+
+uniform mat4 view_projection;
+uniform vec3 column_origin; // World position of the column's grid corner
+uniform vec3 box_min;       // Column grid space
+uniform vec3 box_max;
+
+out vec3 WorldPos;
+
+const int CUBE_INDICES[36] = int[36](
+    0, 4, 6, 0, 6, 2,  // -X
+    1, 3, 7, 1, 7, 5,  // +X
+    0, 1, 5, 0, 5, 4,  // -Y
+    2, 6, 7, 2, 7, 3,  // +Y
+    0, 2, 3, 0, 3, 1,  // -Z
+    4, 5, 7, 4, 7, 6); // +Z
+
+void main()
+{
+    // Corner bits: 1 = +x, 2 = +y, 4 = +z
+    int corner = CUBE_INDICES[gl_VertexID];
+    vec3 position = mix(box_min, box_max, vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1));
+    WorldPos = column_origin + position;
+    gl_Position = view_projection * vec4(WorldPos, 1.0);
+}
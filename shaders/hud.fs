@@ -0,0 +1,16 @@
+#version 330 core
+
+in vec2 TexCoord;
+in vec4 Color;
+
+uniform sampler2D glyphs; // R8 coverage
+
+out vec4 FragColor;
+
+void main()
+{
+    float alpha = texture(glyphs, TexCoord).r * Color.a;
+    if (alpha <= 0.0)
+        discard;
+    FragColor = vec4(Color.rgb, alpha);
+}
@@ -0,0 +1,20 @@
+#version 330 core
+
+// One screen rectangle per instance, corners from gl_VertexID (a triangle strip of four)
+layout(location = 0) in vec4 rect; // x, y, width, height in pixels from the top left
+layout(location = 1) in vec4 uv_rect; // u0, v0, u1, v1 in the glyph atlas
+layout(location = 2) in vec4 color;
+
+uniform vec2 screen_size;
+
+out vec2 TexCoord;
+out vec4 Color;
+
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 pixel = rect.xy + corner * rect.zw;
+    TexCoord = mix(uv_rect.xy, uv_rect.zw, corner);
+    Color = color;
+    gl_Position = vec4(pixel.x / screen_size.x * 2.0 - 1.0, 1.0 - pixel.y / screen_size.y * 2.0, 0.0, 1.0);
+}
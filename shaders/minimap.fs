@@ -0,0 +1,90 @@
+#version 330 core
+
+// Input from vertex shader
+in vec2 MapPos;
+
+// Uniforms
+uniform sampler2D heights;  // Ring-addressed terrain heights + 1 (0: no tile yet) and biomes, see minimap.h
+uniform vec2 camera_xz;
+uniform float view_radius;  // World blocks from the center to the edge
+uniform vec2 heading;       // Camera direction on the xz plane
+uniform float water_level;
+
+// Output
+out vec4 FragColor;
+
+// Biome values of voxel_types.h
+const int BIOME_BEACH = 1;
+const int BIOME_DESERT = 3;
+const int BIOME_MOUNTAINS = 4;
+
+vec2 texelAt(ivec2 world)
+{
+    ivec2 size = textureSize(heights, 0);
+    return floor(texelFetch(heights, world & (size - 1), 0).rg * 65535.0 + 0.5);
+}
+
+float heightAt(ivec2 world)
+{
+    return texelAt(world).r - 1.0;
+}
+
+// Distance from p to the segment a-b
+float segmentDistance(vec2 p, vec2 a, vec2 b)
+{
+    vec2 ab = b - a;
+    float t = clamp(dot(p - a, ab) / dot(ab, ab), 0.0, 1.0);
+    return length(p - a - ab * t);
+}
+
+void main()
+{
+    // Round map with a dark rim
+    float radius = length(MapPos);
+    if (radius > 1.0) {
+        discard;
+    }
+    if (radius > 0.97) {
+        FragColor = vec4(0.05, 0.05, 0.05, 0.9);
+        return;
+    }
+
+    // North up: screen up is -z, the direction a camera at yaw -90 looks
+    ivec2 world = ivec2(floor(camera_xz + vec2(MapPos.x, -MapPos.y) * view_radius));
+    vec2 texel = texelAt(world);
+    float height = texel.r - 1.0;
+    int biome = int(texel.g);
+    vec3 color;
+    if (height < 0.0) {
+        color = vec3(0.12); // Not generated yet
+    } else if (height <= water_level) {
+        float depth = clamp((water_level - height) / 30.0, 0.0, 1.0);
+        color = mix(vec3(0.25, 0.45, 0.8), vec3(0.08, 0.18, 0.45), depth);
+    } else {
+        // Tinted by the column's biome, with snow on the highest rock
+        if (biome == BIOME_BEACH) {
+            color = vec3(0.86, 0.81, 0.64);
+        } else if (biome == BIOME_DESERT) {
+            color = vec3(0.82, 0.72, 0.47);
+        } else if (biome == BIOME_MOUNTAINS) {
+            color = height < 160.0 ? vec3(0.49) : vec3(0.92);
+        } else {
+            color = mix(vec3(0.37, 0.62, 0.21), vec3(0.3, 0.45, 0.2), clamp((height - water_level) / (110.0 - water_level), 0.0, 1.0));
+        }
+
+        // Hillshade from the slope towards the north-west
+        float west = heightAt(world - ivec2(1, 0));
+        float north = heightAt(world - ivec2(0, 1));
+        if (west >= 0.0 && north >= 0.0) {
+            color *= clamp(1.0 + 0.08 * ((height - west) + (height - north)), 0.6, 1.3);
+        }
+    }
+
+    // Camera marker: a short line along the heading from the center
+    vec2 tip = vec2(heading.x, -heading.y) * 0.08;
+    if (segmentDistance(MapPos, vec2(0.0), tip) < 0.015 || radius < 0.025) {
+        color = vec3(1.0, 0.2, 0.2);
+    }
+
+    FragColor = vec4(color, 0.9);
+}
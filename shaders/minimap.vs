@@ -0,0 +1,14 @@
+#version 330 core
+
+// Screen-space quad from gl_VertexID (no vertex attributes)
+uniform vec4 rect; // left, bottom, right, top in normalized device coordinates
+
+// Position inside the map, [-1, 1] on both axes, +y pointing up the screen
+out vec2 MapPos;
+
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    MapPos = corner * 2.0 - 1.0;
+    gl_Position = vec4(mix(rect.xy, rect.zw, corner), 0.0, 1.0);
+}
@@ -0,0 +1,24 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+// per instance (see Model::DrawInstanced), takes locations 3 to 6
+layout (location = 3) in mat4 aModel;
+
+out vec2 TexCoords;
+out vec3 Normal;
+out vec3 FragPos;
+
+
+uniform mat4 view;
+uniform mat4 projection;
+
+
+void main()
+{
+	// same as vertex.vs with the model matrix of this instance
+	gl_Position = projection * view * aModel * vec4(aPos, 1.0);
+	TexCoords = vec2(aTexCoord.x, aTexCoord.y);
+	FragPos = vec3(aModel * vec4(aPos, 1.0));
+	Normal = mat3(transpose(inverse(aModel))) * aNormal;
+}
@@ -0,0 +1,21 @@
+#version 330 core
+
+// Resolve of the weighted blended translucent pass (TranslucencyTarget::resolve), drawn with
+// glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA): the average translucent color covers
+// the scene by 1 - revealage.
+
+uniform sampler2D accumulation;
+uniform sampler2D revealage;
+
+out vec4 FragColor;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float revealed = texelFetch(revealage, pixel, 0).r;
+    if (revealed >= 1.0) {
+        discard; // No translucent fragment here
+    }
+    vec4 sum = texelFetch(accumulation, pixel, 0);
+    FragColor = vec4(sum.rgb / clamp(sum.a, 1e-4, 5e4), revealed);
+}
@@ -1,58 +1,114 @@
 #version 330 core
 
 // Input from vertex shader
-in vec3 FragPos;
-in vec3 Normal;
+in float Shade;
 in vec2 TexCoord;
 in float TextureId;
 in float DebugFlag;
+in vec3 WorldPos;
+flat in vec3 Normal;
 
 // Uniforms
-uniform sampler2D texture_atlas;
+uniform sampler2DArray block_textures; // One layer per texture id
 uniform float time;
-uniform int renderPass; // 0 for opaque pass, 1 for transparent pass
+uniform int renderPass; // 0 for the alpha-tested (cutout) pass, 1 for transparent pass
 
-// Output
-out vec4 FragColor;
+// Sun shadows (ShadowCascades): texture-space matrices and normal offsets, nearest first
+uniform sampler2DArrayShadow shadow_maps;
+uniform mat4 shadow_matrices[3];
+uniform float shadow_offsets[3];
+uniform int shadow_cascade_count; // 0 without shadows
+uniform vec3 sun_direction;       // Toward the sun
 
-// Lighting parameters
-const vec3 lightPos = vec3(100.0, 200.0, 100.0);
-const vec3 lightColor = vec3(1.0, 1.0, 0.9);
-const vec3 ambientColor = vec3(0.3, 0.3, 0.4);
+const float SHADOW_SHADE = 0.6; // Brightness out of the sun
 
-void main()
+// Sun factor of the baked shade: 1 in the sun, SHADOW_SHADE in shadow or facing away.
+// The nearest cascade holding the point is sampled; past the last one everything is lit.
+float sunLight()
 {
-    int textureIndex = int(TextureId);
-    
-    // Determine if the current fragment belongs to a transparent block (water)
-    bool is_transparent = (textureIndex >= 10 && textureIndex <= 41);
+    if (shadow_cascade_count == 0)
+    {
+        return 1.0;
+    }
+    float facing = dot(Normal, sun_direction);
+    if (facing <= 0.0)
+    {
+        return SHADOW_SHADE;
+    }
+    for (int i = 0; i < shadow_cascade_count; i++)
+    {
+        vec3 p = (shadow_matrices[i] * vec4(WorldPos + Normal * shadow_offsets[i], 1.0)).xyz;
+        if (all(greaterThan(p, vec3(0.0))) && all(lessThan(p, vec3(1.0))))
+        {
+            float lit = texture(shadow_maps, vec4(p.xy, float(i), p.z));
+            return mix(SHADOW_SHADE, 1.0, lit * smoothstep(0.0, 0.2, facing));
+        }
+    }
+    return 1.0;
+}
 
-    // Early discard for better performance
-    if (renderPass == 0 && is_transparent) { // Opaque pass: discard transparent fragments
-        discard;
+// Block lights (ClusteredLights): the lights reaching each froxel, by screen tile and slice
+uniform samplerBuffer cluster_lights;  // Position and radius, then color, per light
+uniform usamplerBuffer cluster_ranges; // First index and count per froxel
+uniform usamplerBuffer cluster_indices;
+uniform int cluster_light_count;       // 0 without lights
+uniform vec2 cluster_tile_size;        // Pixels
+uniform vec2 cluster_depth;            // CLUSTER_NEAR, then slices per log of depth over it
+
+const ivec3 CLUSTER_GRID = ivec3(16, 9, 24); // ClusteredLights::GRID_X, GRID_Y, GRID_Z
+
+// Light added to the baked shade by the point lights of this fragment's froxel
+vec3 clusterLight()
+{
+    if (cluster_light_count == 0)
+    {
+        return vec3(0.0);
     }
-    if (renderPass == 1 && !is_transparent) { // Transparent pass: discard opaque fragments
-        discard;
+    float depth = 1.0 / gl_FragCoord.w; // Eye depth with either depth convention
+    int slice = max(int(floor(log(depth / cluster_depth.x) * cluster_depth.y)), 0);
+    if (slice >= CLUSTER_GRID.z)
+    {
+        return vec3(0.0);
     }
+    // Side-by-side views share the grid: its columns repeat across the target
+    ivec2 tile = ivec2(gl_FragCoord.xy / cluster_tile_size);
+    tile = clamp(ivec2(tile.x % CLUSTER_GRID.x, tile.y), ivec2(0), CLUSTER_GRID.xy - 1);
+    uvec2 range = texelFetch(cluster_ranges, (slice * CLUSTER_GRID.y + tile.y) * CLUSTER_GRID.x + tile.x).rg;
 
-    // Calculate texture coordinates for atlas
-    const float tileSize = 1.0 / 9.0;
-    const float tileHeightSize = 1.0 / 5.0;
+    vec3 sum = vec3(0.0);
+    for (uint i = 0u; i < range.y; i++)
+    {
+        int light = int(texelFetch(cluster_indices, int(range.x + i)).r);
+        vec4 sphere = texelFetch(cluster_lights, light * 2);
+        vec3 toLight = sphere.xyz - WorldPos;
+        float distance = length(toLight);
+        float falloff = clamp(1.0 - distance / sphere.w, 0.0, 1.0);
+        float facing = distance > 0.0 ? max(dot(Normal, toLight / distance), 0.0) : 1.0;
+        sum += texelFetch(cluster_lights, light * 2 + 1).rgb * (falloff * falloff * facing);
+    }
+    return sum;
+}
+
+// Output
+out vec4 FragColor;
+
+void main()
+{
+    int textureIndex = int(TextureId);
     
+    // Each pass only submits its own index range (see ChunkMesh::renderOpaque/renderTranslucent),
+    // so no per-fragment pass filtering is needed here
+    bool is_transparent = (renderPass == 1);
+
     // Handle water animation more efficiently
-    if (textureIndex >= 10 && textureIndex <= 41) {
+    if (is_transparent) {
         // Use faster animation calculation
         int animFrame = int(time * 2.0) & 31; // Bitwise AND for modulo with power of 2
         textureIndex = 10 + animFrame;
     }
     
-    // Calculate tile position in atlas
-    int tilesPerRow = 9;
-    int tileX = textureIndex % tilesPerRow;
-    int tileY = textureIndex / tilesPerRow;
-    vec2 atlasCoord = vec2(tileX * tileSize, tileY * tileHeightSize) + TexCoord * vec2(tileSize, tileHeightSize);
-    
-    vec4 texColor = texture(texture_atlas, atlasCoord);
+    // Layers wrap on their own, so merged quads spanning several voxels just repeat the tile
+    vec4 texColor = texture(block_textures, vec3(TexCoord, float(textureIndex)));
     
     // Early alpha test for better performance
     if (texColor.a < 0.1) {
@@ -64,13 +120,6 @@ void main()
         texColor.a = 0.75;
     }
     
-    // Optimized lighting calculation
-    vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(lightPos - FragPos);
-    float diff = max(dot(norm, lightDir), 0.0);
-    
-    // Combine lighting more efficiently
-    vec3 result = texColor.rgb * (ambientColor + diff * lightColor);
-    
-    FragColor = vec4(result, texColor.a);
+    // Light was baked per vertex (voxel.vs)
+    FragColor = vec4(texColor.rgb * (Shade * sunLight() + clusterLight()), texColor.a);
 }
\ No newline at end of file
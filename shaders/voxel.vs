@@ -1,37 +1,135 @@
 #version 330 core
 
 // Vertex attributes
-layout (location = 0) in vec3 aPos;        // Position
-layout (location = 1) in vec3 aNormal;     // Normal
-layout (location = 2) in vec2 aTexCoord;   // Texture coordinates
-layout (location = 3) in float aTextureId; // Texture ID
-layout (location = 4) in float aDebugFlag; // Debug flag
+layout (location = 0) in uint aPacked;      // Packed corner/face/texture (see VoxelVertex in chunk_mesh.h), or
+                                            // FACE_RECORD_SENTINEL when no vertex array feeds it
+layout (location = 1) in vec3 aChunkOrigin; // Per-draw chunk origin: instanced on the arena path, a
+                                            // constant attribute value set per draw with per-chunk VAOs
+layout (location = 2) in vec3 aRegionOffset; // Chunk offset from aChunkOrigin in a packed region (RegionBatcher),
+                                             // in chunks; the generic value (0, 0, 0) everywhere else
 
 // Uniforms
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+// Side-by-side multi-view (VoxelRenderer::setStereo): every draw has one instance per view and
+// gl_InstanceID picks the view; below 2 (programs that never set it) the draws use view
+uniform int view_count;
+uniform mat4 eye_views[2]; // Left, right
+uniform usamplerBuffer face_records; // MeshFormat::Faces: one word per quad (VoxelVertex::faceRecord)
 
 // Output to fragment shader
-out vec3 FragPos;
-out vec3 Normal;
+out float Shade; // Baked light level and corner occlusion times the face's directional shade
 out vec2 TexCoord;
 out float TextureId;
 out float DebugFlag;
+out vec3 WorldPos;    // For the shadow lookup (ShadowCascades)
+flat out vec3 Normal;
+
+// The depth pre-pass and the GL_EQUAL color pass both run this shader; positions must match bit for bit
+invariant gl_Position;
+
+// Fixed shade per face direction, FACE_FRONT..FACE_BOTTOM: tops brightest, undersides darkest
+const float faceShade[6] = float[6](0.8, 0.8, 0.6, 0.6, 1.0, 0.5);
+
+// Normal per face direction, FACE_FRONT..FACE_BOTTOM (FACE_NORMALS in voxel_chunk.h)
+const vec3 faceNormal[6] = vec3[6](vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0), vec3(1.0, 0.0, 0.0),
+                                   vec3(-1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0), vec3(0.0, -1.0, 0.0));
+
+// Brightness per light level below 15 (voxel_light.h), never quite black
+const float LIGHT_FALLOFF = 0.8;
+const float MIN_BRIGHTNESS = 0.05;
+
+// Brightness per ambient occlusion level, 0 (sides and diagonal all solid) to 3 (open)
+const float occlusionShade[4] = float[4](0.5, 0.65, 0.8, 1.0);
+
+// Texture slots skip the water frames after the base one (VoxelVertex::textureSlot)
+const uint WATER_TEXTURE_FIRST = 10u;
+const uint SKIPPED_WATER_FRAMES = 31u;
+
+// Generic attribute value of draws without a vertex array (FACE_RECORD_SENTINEL in chunk_mesh.h)
+const uint FACE_RECORD_SENTINEL = 0x80000000u;
+
+// CHUNK_SIZE, CHUNK_HEIGHT, CHUNK_SIZE (voxel_types.h)
+const vec3 CHUNK_EXTENT = vec3(16.0, 64.0, 16.0);
+
+// Corners of each face template as x/y/z bits (set = +0.5 side), in ChunkMesh::FACE_VERTICES order
+const uint faceCorners[24] = uint[24](
+    4u, 5u, 7u, 6u,
+    1u, 0u, 2u, 3u,
+    5u, 1u, 3u, 7u,
+    0u, 4u, 6u, 2u,
+    6u, 7u, 3u, 2u,
+    0u, 1u, 5u, 4u
+);
 
 void main()
 {
-    // Transform position to world space
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    
-    // Transform normal to world space (assuming uniform scaling)
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    
-    // Pass through texture coordinates and ID
-    TexCoord = aTexCoord;
-    TextureId = aTextureId;
-    DebugFlag = aDebugFlag; // FIX: Actually pass through the debug flag
+    uint x, y, z, textureId, debugFlag, light, occlusion;
+    int face;
+    if (aPacked == FACE_RECORD_SENTINEL)
+    {
+        // The shared quad pattern makes vertex id 4 * record + corner
+        uint record = texelFetch(face_records, gl_VertexID >> 2).r;
+        face = int((record >> 14) & 7u);
+        textureId = (record >> 17) & 15u;
+        debugFlag = 0u;
+        light = record >> 28;
+        occlusion = 3u; // Records carry no occlusion
+
+        // Stretch the face template over the record's extent; u/v are x/y, z/y or x/z by face
+        uint extentU = ((record >> 21) & 15u) + 1u;
+        uint extentV = ((record >> 25) & 7u) + 1u;
+        uvec3 extent = face < 2 ? uvec3(extentU, extentV, 1u) : (face < 4 ? uvec3(1u, extentV, extentU) : uvec3(extentU, 1u, extentV));
+        uint corner = faceCorners[face * 4 + (gl_VertexID & 3)];
+        x = (record & 15u) + (corner & 1u) * extent.x;
+        y = ((record >> 4) & 63u) + ((corner >> 1) & 1u) * extent.y;
+        z = ((record >> 10) & 15u) + ((corner >> 2) & 1u) * extent.z;
+    }
+    else
+    {
+        // Unpack the vertex word
+        x = aPacked & 31u;
+        y = (aPacked >> 5) & 127u;
+        z = (aPacked >> 12) & 31u;
+        face = int((aPacked >> 17) & 7u);
+        textureId = (aPacked >> 20) & 15u;
+        occlusion = (aPacked >> 24) & 3u;
+        debugFlag = (aPacked >> 26) & 1u;
+        light = (aPacked >> 27) & 15u;
+    }
+    textureId += textureId > WATER_TEXTURE_FIRST ? SKIPPED_WATER_FRAMES : 0u;
+
+    // Lattice corner back to voxel-centered space, then to world space
+    vec3 worldPos = vec3(x, y, z) - 0.5 + aChunkOrigin + aRegionOffset * CHUNK_EXTENT;
+    Shade = faceShade[face] * occlusionShade[occlusion] * max(pow(LIGHT_FALLOFF, 15.0 - float(light)), MIN_BRIGHTNESS);
+
+    // UVs follow the face template orientation; the fragment shader repeats them per voxel
+    vec3 p = vec3(x, y, z);
+    if (face == 0)      TexCoord = vec2(p.x, p.y);  // Front (+Z)
+    else if (face == 1) TexCoord = vec2(-p.x, p.y); // Back (-Z)
+    else if (face == 2) TexCoord = vec2(-p.z, p.y); // Right (+X)
+    else if (face == 3) TexCoord = vec2(p.z, p.y);  // Left (-X)
+    else if (face == 4) TexCoord = vec2(p.x, -p.z); // Top (+Y)
+    else                TexCoord = vec2(p.x, p.z);  // Bottom (-Y)
+
+    TextureId = float(textureId);
+    DebugFlag = float(debugFlag);
+    WorldPos = worldPos;
+    Normal = faceNormal[face];
     
     // Final position
-    gl_Position = projection * view * vec4(FragPos, 1.0);
-}
\ No newline at end of file
+    if (view_count < 2)
+    {
+        gl_Position = projection * view * vec4(worldPos, 1.0);
+    }
+    else
+    {
+        // Squeezed into the view's half of the target and clipped at the middle
+        // (GL_CLIP_DISTANCE0 is enabled while the views draw)
+        vec4 position = projection * eye_views[gl_InstanceID] * vec4(worldPos, 1.0);
+        float side = gl_InstanceID == 0 ? -1.0 : 1.0;
+        position.x = position.x * 0.5 + side * 0.5 * position.w;
+        gl_ClipDistance[0] = side * position.x;
+        gl_Position = position;
+    }
+}
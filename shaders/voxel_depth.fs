@@ -0,0 +1,8 @@
+#version 330 core
+
+// Depth pre-pass of the opaque range: color writes are masked off and nothing is sampled,
+// so only depth reaches the framebuffer
+
+void main()
+{
+}
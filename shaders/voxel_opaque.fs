@@ -0,0 +1,101 @@
+#version 330 core
+
+// Fully opaque geometry only (MeshPass::Opaque). Without the alpha test this shader never
+// discards, so the driver keeps early depth testing; with the depth pre-pass it runs with
+// GL_EQUAL and shades each visible pixel once. Cutout and water faces go through voxel.fs.
+
+// Input from vertex shader
+in float Shade;
+in vec2 TexCoord;
+in float TextureId;
+in float DebugFlag;
+in vec3 WorldPos;
+flat in vec3 Normal;
+
+// Uniforms
+uniform sampler2DArray block_textures; // One layer per texture id
+
+// Sun shadows, as in voxel.fs (ShadowCascades)
+uniform sampler2DArrayShadow shadow_maps;
+uniform mat4 shadow_matrices[3];
+uniform float shadow_offsets[3];
+uniform int shadow_cascade_count; // 0 without shadows
+uniform vec3 sun_direction;       // Toward the sun
+
+const float SHADOW_SHADE = 0.6; // Brightness out of the sun
+
+// Sun factor of the baked shade: 1 in the sun, SHADOW_SHADE in shadow or facing away.
+// The nearest cascade holding the point is sampled; past the last one everything is lit.
+float sunLight()
+{
+    if (shadow_cascade_count == 0)
+    {
+        return 1.0;
+    }
+    float facing = dot(Normal, sun_direction);
+    if (facing <= 0.0)
+    {
+        return SHADOW_SHADE;
+    }
+    for (int i = 0; i < shadow_cascade_count; i++)
+    {
+        vec3 p = (shadow_matrices[i] * vec4(WorldPos + Normal * shadow_offsets[i], 1.0)).xyz;
+        if (all(greaterThan(p, vec3(0.0))) && all(lessThan(p, vec3(1.0))))
+        {
+            float lit = texture(shadow_maps, vec4(p.xy, float(i), p.z));
+            return mix(SHADOW_SHADE, 1.0, lit * smoothstep(0.0, 0.2, facing));
+        }
+    }
+    return 1.0;
+}
+
+// Block lights, as in voxel.fs (ClusteredLights)
+uniform samplerBuffer cluster_lights;  // Position and radius, then color, per light
+uniform usamplerBuffer cluster_ranges; // First index and count per froxel
+uniform usamplerBuffer cluster_indices;
+uniform int cluster_light_count;       // 0 without lights
+uniform vec2 cluster_tile_size;        // Pixels
+uniform vec2 cluster_depth;            // CLUSTER_NEAR, then slices per log of depth over it
+
+const ivec3 CLUSTER_GRID = ivec3(16, 9, 24); // ClusteredLights::GRID_X, GRID_Y, GRID_Z
+
+// Light added to the baked shade by the point lights of this fragment's froxel
+vec3 clusterLight()
+{
+    if (cluster_light_count == 0)
+    {
+        return vec3(0.0);
+    }
+    float depth = 1.0 / gl_FragCoord.w; // Eye depth with either depth convention
+    int slice = max(int(floor(log(depth / cluster_depth.x) * cluster_depth.y)), 0);
+    if (slice >= CLUSTER_GRID.z)
+    {
+        return vec3(0.0);
+    }
+    // Side-by-side views share the grid: its columns repeat across the target
+    ivec2 tile = ivec2(gl_FragCoord.xy / cluster_tile_size);
+    tile = clamp(ivec2(tile.x % CLUSTER_GRID.x, tile.y), ivec2(0), CLUSTER_GRID.xy - 1);
+    uvec2 range = texelFetch(cluster_ranges, (slice * CLUSTER_GRID.y + tile.y) * CLUSTER_GRID.x + tile.x).rg;
+
+    vec3 sum = vec3(0.0);
+    for (uint i = 0u; i < range.y; i++)
+    {
+        int light = int(texelFetch(cluster_indices, int(range.x + i)).r);
+        vec4 sphere = texelFetch(cluster_lights, light * 2);
+        vec3 toLight = sphere.xyz - WorldPos;
+        float distance = length(toLight);
+        float falloff = clamp(1.0 - distance / sphere.w, 0.0, 1.0);
+        float facing = distance > 0.0 ? max(dot(Normal, toLight / distance), 0.0) : 1.0;
+        sum += texelFetch(cluster_lights, light * 2 + 1).rgb * (falloff * falloff * facing);
+    }
+    return sum;
+}
+
+// Output
+out vec4 FragColor;
+
+void main()
+{
+    vec3 texColor = texture(block_textures, vec3(TexCoord, TextureId)).rgb;
+    FragColor = vec4(texColor * (Shade * sunLight() + clusterLight()), 1.0); // Light baked per vertex (voxel.vs)
+}
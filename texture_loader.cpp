@@ -0,0 +1,162 @@
+#include "texture_loader.h"
+#include "voxel world/job_system.h"
+#include <stb_image.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+TextureLoader::TextureLoader(JobSystem &job_system)
+    : job_system(job_system)
+{
+}
+
+TextureLoader::~TextureLoader()
+{
+    // Jobs reference this object: wait for them before anything goes away
+    {
+        std::unique_lock<std::mutex> lock(result_mutex);
+        jobs_idle.wait(lock, [this]
+                       { return jobs_in_flight == 0; });
+    }
+
+    for (auto &[path, entry] : textures)
+    {
+        glDeleteTextures(1, &entry.id);
+    }
+}
+
+GLuint TextureLoader::request(const std::string &path)
+{
+    auto it = textures.find(path);
+    if (it != textures.end())
+    {
+        return it->second.id;
+    }
+
+    // Placeholder until the image arrives; sampled like the real one so nothing rebinds
+    Entry entry;
+    glGenTextures(1, &entry.id);
+    const unsigned char grey[4] = {128, 128, 128, 255};
+    glBindTexture(GL_TEXTURE_2D, entry.id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    textures.emplace(path, entry);
+    queued.push_back(path);
+    pending++;
+    startDecodes();
+    return entry.id;
+}
+
+bool TextureLoader::isReady(const std::string &path) const
+{
+    auto it = textures.find(path);
+    return it != textures.end() && it->second.ready;
+}
+
+void TextureLoader::startDecodes()
+{
+    size_t started = 0;
+    for (; started < queued.size(); started++)
+    {
+        {
+            std::unique_lock<std::mutex> lock(result_mutex);
+            if (jobs_in_flight >= MAX_JOBS_IN_FLIGHT)
+            {
+                break;
+            }
+            jobs_in_flight++;
+        }
+
+        job_system.submit([this, path = queued[started]]
+                          {
+                              Decoded image;
+                              image.path = path;
+                              decode(image);
+
+                              std::unique_lock<std::mutex> lock(result_mutex);
+                              results.push_back(std::move(image));
+                              if (--jobs_in_flight == 0)
+                              {
+                                  jobs_idle.notify_all();
+                              } },
+                          JobPriority::Low);
+    }
+    queued.erase(queued.begin(), queued.begin() + static_cast<std::ptrdiff_t>(started));
+}
+
+void TextureLoader::decode(Decoded &image)
+{
+    // stbi_set_flip_vertically_on_load is global state shared with other loaders: flip here
+    unsigned char *data = stbi_load(image.path.c_str(), &image.width, &image.height, &image.components, 0);
+    if (!data)
+    {
+        return;
+    }
+
+    size_t row_bytes = static_cast<size_t>(image.width) * image.components;
+    image.pixels.resize(row_bytes * image.height);
+    for (int y = 0; y < image.height; y++)
+    {
+        std::memcpy(image.pixels.data() + (image.height - 1 - y) * row_bytes, data + y * row_bytes, row_bytes);
+    }
+    stbi_image_free(data);
+}
+
+size_t TextureLoader::update(size_t budget_bytes)
+{
+    startDecodes();
+
+    std::vector<Decoded> finished;
+    {
+        std::unique_lock<std::mutex> lock(result_mutex);
+        size_t bytes = 0;
+        size_t count = 0;
+        while (count < results.size() && (count == 0 || bytes + results[count].pixels.size() <= budget_bytes))
+        {
+            bytes += results[count].pixels.size();
+            count++;
+        }
+        finished.assign(std::make_move_iterator(results.begin()), std::make_move_iterator(results.begin() + count));
+        results.erase(results.begin(), results.begin() + count);
+    }
+
+    size_t uploaded = 0;
+    for (const Decoded &image : finished)
+    {
+        Entry &entry = textures[image.path];
+        pending--;
+        if (image.pixels.empty())
+        {
+            std::cout << "Texture failed to load at path: " << image.path << std::endl;
+            continue; // Keeps the placeholder
+        }
+        upload(image, entry.id);
+        entry.ready = true;
+        uploaded += image.pixels.size();
+    }
+    return uploaded;
+}
+
+void TextureLoader::upload(const Decoded &image, GLuint id)
+{
+    GLenum format = GL_RGB; // Default to RGB
+    if (image.components == 1)
+        format = GL_RED;
+    else if (image.components == 4)
+        format = GL_RGBA;
+
+    glBindTexture(GL_TEXTURE_2D, id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Rows are tightly packed
+    glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
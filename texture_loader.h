@@ -0,0 +1,73 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include "glad/glad/glad.h"
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class JobSystem;
+
+// Image textures for models, decoded on the job system and uploaded under a per-frame budget.
+//
+// request() hands out the GL texture right away: it starts as a single grey texel and gets
+// its image once the decode is done and update() reaches it, so a model can be drawn (and
+// its meshes built) while its textures stream in. Textures are cached by path for every
+// model sharing the loader; a path is decoded once and its texture lives as long as the
+// loader, which must go before the GL context does.
+class TextureLoader
+{
+public:
+    static constexpr int MAX_JOBS_IN_FLIGHT = 8; // Decodes waiting beyond that stay queued here
+
+    explicit TextureLoader(JobSystem &job_system);
+    ~TextureLoader();
+
+    TextureLoader(const TextureLoader &) = delete;
+    TextureLoader &operator=(const TextureLoader &) = delete;
+
+    // Main thread
+    GLuint request(const std::string &path);
+    // Starts queued decodes and uploads finished ones until budget_bytes of pixels went out
+    // (at least one, so a texture larger than the budget still lands); returns the bytes
+    size_t update(size_t budget_bytes);
+
+    bool isReady(const std::string &path) const;
+    size_t getPendingCount() const { return pending; } // Requested, not uploaded yet
+    size_t getTextureCount() const { return textures.size(); }
+
+private:
+    struct Entry
+    {
+        GLuint id = 0;
+        bool ready = false;
+    };
+
+    struct Decoded
+    {
+        std::string path;
+        std::vector<unsigned char> pixels; // Bottom row first, as GL expects; empty on failure
+        int width = 0;
+        int height = 0;
+        int components = 0;
+    };
+
+    JobSystem &job_system;
+    std::unordered_map<std::string, Entry> textures;
+    std::vector<std::string> queued; // Waiting for a job slot
+    size_t pending = 0;
+
+    std::mutex result_mutex;
+    std::condition_variable jobs_idle;
+    std::vector<Decoded> results;
+    int jobs_in_flight = 0;
+
+    void startDecodes();
+    static void decode(Decoded &image);
+    void upload(const Decoded &image, GLuint id);
+};
+
+#endif // TEXTURE_LOADER_H
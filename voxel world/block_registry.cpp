@@ -0,0 +1,151 @@
+#include "block_registry.h"
+#include "voxel_chunk.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// The registry until load() replaces it, and the names a data file must start with
+constexpr BlockRegistry::BlockRegistry()
+{
+    clear();
+    //   Name Flags  Top Bottom Sides  Opacity Emission  Colour
+    add({"Air", FLAG_TRANSPARENT | FLAG_CULLS_SAME, 0, 0, 0, 0, 0, {0, 0, 0}});
+    add({"Stone", FLAG_SOLID, 1, 1, 1, 15, 0, {125, 125, 125}});           // stone.png
+    add({"Dirt", FLAG_SOLID, 2, 2, 2, 15, 0, {134, 96, 67}});              // dirt.png
+    add({"Grass", FLAG_SOLID, 3, 2, 4, 15, 0, {95, 159, 53}});             // grass_top, dirt, grass_side
+    add({"Cobblestone", FLAG_SOLID, 5, 5, 5, 15, 0, {110, 110, 110}});
+    add({"Wood", FLAG_SOLID, 6, 6, 7, 15, 0, {104, 82, 50}});              // oak_log_top, oak_log_top, oak_log
+    add({"Leaves", FLAG_SOLID | FLAG_TRANSPARENT | FLAG_CULLS_SAME, 8, 8, 8, 1, 0, {60, 100, 40}});
+    add({"Sand", FLAG_SOLID, 9, 9, 9, 15, 0, {219, 207, 163}});
+    add({"Water", FLAG_TRANSPARENT | FLAG_CULLS_SAME, 10, 10, 10, 1, 0, {50, 90, 180}}); // Animated, base frame
+    add({"Glass", FLAG_SOLID | FLAG_TRANSPARENT | FLAG_CULLS_SAME, 42, 42, 42, 0, 0, {200, 220, 230}}); // After the water frames
+    add({"Iron", FLAG_SOLID, 43, 43, 43, 15, 0, {200, 200, 200}});
+}
+
+constexpr void BlockRegistry::clear()
+{
+    type_count = 0;
+    for (int type = 0; type < MAX_TYPES; type++)
+    {
+        // Unregistered: transparent, non-solid, blocking light
+        flags[type] = FLAG_TRANSPARENT;
+        light_opacity[type] = 15;
+        light_emission[type] = 0;
+        for (auto &textures : face_textures)
+        {
+            textures[type] = 0;
+        }
+        map_colors[type] = {0, 0, 0};
+        names[type] = {'U', 'n', 'k', 'n', 'o', 'w', 'n', '\0'};
+    }
+}
+
+constexpr void BlockRegistry::add(const BlockDefinition &block)
+{
+    const int type = type_count++;
+    flags[type] = block.flags;
+    light_opacity[type] = block.light_opacity;
+    light_emission[type] = block.light_emission;
+    for (int face = 0; face < 6; face++)
+    {
+        face_textures[face][type] = face == FACE_TOP ? block.texture_top : face == FACE_BOTTOM ? block.texture_bottom
+                                                                                                : block.texture_sides;
+    }
+    map_colors[type] = {block.color[0], block.color[1], block.color[2]};
+    names[type] = {};
+    for (int i = 0; i < MAX_NAME_LENGTH && block.name[i] != '\0'; i++)
+    {
+        names[type][i] = block.name[i];
+    }
+}
+
+constinit BlockRegistry BlockRegistry::active;
+
+bool BlockRegistry::load(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "Block registry: cannot open " << path << ", keeping the built-in types" << std::endl;
+        return false;
+    }
+
+    // Defaults for the built-in names to check against
+    const BlockRegistry built_in;
+    BlockRegistry loaded;
+    loaded.clear();
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line))
+    {
+        line_number++;
+        std::istringstream fields(line);
+        std::string name;
+        if (!(fields >> name) || name[0] == '#')
+        {
+            continue;
+        }
+
+        // name solid transparent culls_same top bottom sides opacity emission red green blue
+        int values[11];
+        bool valid = true;
+        for (int &value : values)
+        {
+            valid = valid && static_cast<bool>(fields >> value);
+        }
+        valid = valid && name.size() <= static_cast<size_t>(MAX_NAME_LENGTH);
+        for (int i = 3; valid && i < 6; i++)
+        {
+            valid = values[i] >= 0 && values[i] < BLOCK_TEXTURE_LAYERS;
+        }
+        for (int i = 6; valid && i < 8; i++)
+        {
+            valid = values[i] >= 0 && values[i] <= 15;
+        }
+        for (int i = 8; valid && i < 11; i++)
+        {
+            valid = values[i] >= 0 && values[i] <= 255;
+        }
+        if (!valid)
+        {
+            std::cerr << "Block registry: bad block on line " << line_number << " of " << path << std::endl;
+            return false;
+        }
+        if (loaded.type_count == UNKNOWN_TYPE)
+        {
+            std::cerr << "Block registry: " << path << " has more than " << UNKNOWN_TYPE << " types" << std::endl;
+            return false;
+        }
+        if (loaded.type_count < VOXEL_COUNT && name != built_in.getName(static_cast<VoxelID>(loaded.type_count)))
+        {
+            std::cerr << "Block registry: " << path << " line " << line_number << " is " << name << ", expected built-in type "
+                      << built_in.getName(static_cast<VoxelID>(loaded.type_count)) << std::endl;
+            return false;
+        }
+
+        BlockDefinition block{};
+        block.name = name.c_str();
+        block.flags = static_cast<uint8_t>((values[0] ? FLAG_SOLID : 0) | (values[1] ? FLAG_TRANSPARENT : 0) |
+                                           (values[2] ? FLAG_CULLS_SAME : 0));
+        block.texture_top = static_cast<uint8_t>(values[3]);
+        block.texture_bottom = static_cast<uint8_t>(values[4]);
+        block.texture_sides = static_cast<uint8_t>(values[5]);
+        block.light_opacity = static_cast<uint8_t>(values[6]);
+        block.light_emission = static_cast<uint8_t>(values[7]);
+        for (int i = 0; i < 3; i++)
+        {
+            block.color[i] = static_cast<uint8_t>(values[8 + i]);
+        }
+        loaded.add(block);
+    }
+
+    if (loaded.type_count < VOXEL_COUNT)
+    {
+        std::cerr << "Block registry: " << path << " is missing built-in types" << std::endl;
+        return false;
+    }
+    active = loaded;
+    return true;
+}
@@ -0,0 +1,103 @@
+#ifndef BLOCK_REGISTRY_H
+#define BLOCK_REGISTRY_H
+
+#include "voxel_types.h"
+#include <array>
+#include <cstdint>
+#include <string>
+
+// Block types and their properties, indexed by VoxelID.
+//
+// The built-in types of VoxelType are registered by default; load() replaces them with the
+// types of a data file (blocks.txt), which must list the built-ins first and in order
+// (generation places them by id) and may add more after them. The hot properties live in
+// dense byte tables, and the texture layer of every face in one table per face direction,
+// so the meshers and kernels look a type up with one load and never branch on the id: ids
+// at or past UNKNOWN_TYPE all read the last slot, which no type takes: transparent,
+// non-solid and blocking light. Ids are checked against getTypeCount() where they enter
+// the world (saves, the stream protocol, server commands).
+//
+// One registry for the process: load before any world or renderer exists; afterwards it is
+// only read, from every thread.
+class BlockRegistry
+{
+public:
+    // The occupancy kernels look opacity up in a 16-byte shuffle table
+    static constexpr int MAX_TYPES = 16;
+    static constexpr int UNKNOWN_TYPE = MAX_TYPES - 1; // Slot of every unregistered id
+    static constexpr int MAX_NAME_LENGTH = 23;
+
+    // Bits of getFlags
+    static constexpr uint8_t FLAG_SOLID = 1;       // Collides (isVoxelSolid)
+    static constexpr uint8_t FLAG_TRANSPARENT = 2; // Neighbor faces show through it
+    static constexpr uint8_t FLAG_CULLS_SAME = 4;  // Transparent: faces between two of this type are hidden
+
+    static const BlockRegistry &get() { return active; }
+
+    // Replace the registered types with those of a data file; false (types unchanged, the
+    // reason on stderr) if it cannot be read or does not start with the built-ins
+    static bool load(const std::string &path);
+
+    static int slot(VoxelID voxel) { return voxel < UNKNOWN_TYPE ? voxel : UNKNOWN_TYPE; }
+
+    int getTypeCount() const { return type_count; }
+    bool isRegistered(int voxel) const { return voxel >= 0 && voxel < type_count; }
+
+    uint8_t getFlags(VoxelID voxel) const { return flags[slot(voxel)]; }
+    int getLightOpacity(VoxelID voxel) const { return light_opacity[slot(voxel)]; }
+    int getLightEmission(VoxelID voxel) const { return light_emission[slot(voxel)]; }
+    int getFaceTexture(VoxelID voxel, int face_direction) const { return face_textures[face_direction][slot(voxel)]; }
+    const uint8_t *getMapColor(VoxelID voxel) const { return map_colors[slot(voxel)].data(); } // RGB
+    const char *getName(VoxelID voxel) const { return names[slot(voxel)].data(); }
+
+private:
+    static BlockRegistry active;
+
+    int type_count = 0;
+    std::array<uint8_t, MAX_TYPES> flags{};
+    std::array<uint8_t, MAX_TYPES> light_opacity{};
+    std::array<uint8_t, MAX_TYPES> light_emission{};
+    std::array<std::array<uint8_t, MAX_TYPES>, 6> face_textures{}; // [FaceDirection][VoxelID]
+    std::array<std::array<uint8_t, 3>, MAX_TYPES> map_colors{};     // Far terrain colour of the top
+    std::array<std::array<char, MAX_NAME_LENGTH + 1>, MAX_TYPES> names{};
+
+    struct BlockDefinition
+    {
+        const char *name;
+        uint8_t flags;
+        uint8_t texture_top;
+        uint8_t texture_bottom;
+        uint8_t texture_sides;
+        uint8_t light_opacity; // Light levels lost passing through (15: blocks light, see voxel_light.h)
+        uint8_t light_emission;
+        uint8_t color[3];
+    };
+
+    constexpr BlockRegistry();
+    constexpr void add(const BlockDefinition &block);
+    constexpr void clear();
+};
+
+inline bool isVoxelSolid(VoxelID voxel)
+{
+    return (BlockRegistry::get().getFlags(voxel) & BlockRegistry::FLAG_SOLID) != 0;
+}
+
+inline bool isVoxelTransparent(VoxelID voxel)
+{
+    return (BlockRegistry::get().getFlags(voxel) & BlockRegistry::FLAG_TRANSPARENT) != 0;
+}
+
+// A neighbor of either type gives every voxel the same faces and occlusion when meshing:
+// the same type, or two opaque ones
+inline bool isSameForMeshing(VoxelID a, VoxelID b)
+{
+    return a == b || (!isVoxelTransparent(a) && !isVoxelTransparent(b));
+}
+
+inline const char *getVoxelName(VoxelID voxel)
+{
+    return BlockRegistry::get().getName(voxel);
+}
+
+#endif // BLOCK_REGISTRY_H
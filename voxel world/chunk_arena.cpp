@@ -0,0 +1,370 @@
+#include "chunk_arena.h"
+#include "hiz_culler.h"
+#include "chunk_mesh.h"
+#include "gl_render_backend.h"
+#include <iostream>
+#include <algorithm>
+
+RangeAllocator::RangeAllocator(size_t capacity)
+    : capacity(capacity), used(0)
+{
+    if (capacity > 0)
+    {
+        free_blocks[0] = capacity;
+    }
+}
+
+bool RangeAllocator::allocate(size_t size, ArenaRange &out)
+{
+    if (size == 0)
+    {
+        return false;
+    }
+
+    for (auto it = free_blocks.begin(); it != free_blocks.end(); ++it)
+    {
+        if (it->second < size)
+        {
+            continue;
+        }
+
+        out.offset = it->first;
+        out.size = size;
+
+        // Keep the remainder of the block free
+        size_t remaining = it->second - size;
+        size_t remaining_offset = it->first + size;
+        free_blocks.erase(it);
+        if (remaining > 0)
+        {
+            free_blocks[remaining_offset] = remaining;
+        }
+
+        used += size;
+        return true;
+    }
+    return false;
+}
+
+void RangeAllocator::release(const ArenaRange &range)
+{
+    if (!range.isValid())
+    {
+        return;
+    }
+
+    auto next = free_blocks.emplace(range.offset, range.size).first;
+    used -= range.size;
+
+    // Merge with the following block
+    auto after = std::next(next);
+    if (after != free_blocks.end() && next->first + next->second == after->first)
+    {
+        next->second += after->second;
+        free_blocks.erase(after);
+    }
+
+    // Merge with the preceding block
+    if (next != free_blocks.begin())
+    {
+        auto before = std::prev(next);
+        if (before->first + before->second == next->first)
+        {
+            before->second += next->second;
+            free_blocks.erase(next);
+        }
+    }
+}
+
+void RangeAllocator::grow(size_t new_capacity)
+{
+    if (new_capacity <= capacity)
+    {
+        return;
+    }
+    // The new tail is added as a released block so it merges with a free block at the old end
+    size_t added = new_capacity - capacity;
+    used += added;
+    release({capacity, added});
+    capacity = new_capacity;
+}
+
+bool ChunkArena::isSupported()
+{
+#ifdef GL_VERSION_4_3
+    return GLAD_GL_VERSION_4_3 != 0;
+#else
+    return false;
+#endif
+}
+
+ChunkArena::ChunkArena(size_t vertex_capacity)
+    : vao(0), face_vao(0), face_texture(0), vertex_buffer(0), origin_buffer(0), layer_range_buffer(0), indirect_buffer(0),
+      origin_divisor(1), vertex_allocator(vertex_capacity), last_batch_size(0), last_face_batch_size(0)
+{
+    glGenVertexArrays(1, &vao);
+    glGenVertexArrays(1, &face_vao);
+    glGenTextures(1, &face_texture);
+    RenderBackend &backend = RenderBackend::get();
+    vertex_buffer = backend.createBuffer();
+    origin_buffer = backend.createBuffer();
+    layer_range_buffer = backend.createBuffer();
+    indirect_buffer = backend.createBuffer();
+    backend.allocateBuffer(vertex_buffer, vertex_capacity * sizeof(VoxelVertex));
+
+    setupVertexArray();
+
+    std::cout << "Chunk arena: " << (getCapacityBytes() / (1024 * 1024)) << " MB reserved for "
+              << vertex_capacity << " vertices" << std::endl;
+}
+
+ChunkArena::~ChunkArena()
+{
+    glDeleteVertexArrays(1, &vao);
+    glDeleteVertexArrays(1, &face_vao);
+    glDeleteTextures(1, &face_texture);
+    RenderBackend &backend = RenderBackend::get();
+    backend.destroyBuffer(vertex_buffer);
+    backend.destroyBuffer(origin_buffer);
+    backend.destroyBuffer(layer_range_buffer);
+    backend.destroyBuffer(indirect_buffer);
+}
+
+void ChunkArena::setupVertexArray()
+{
+    glBindVertexArray(vao);
+
+    // Packed vertex word, same layout as the per-chunk VAOs
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+    glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(VoxelVertex), (void *)offsetof(VoxelVertex, data));
+    glEnableVertexAttribArray(0);
+
+    // Per-draw chunk origin, advanced once per draw's instances (base_instance picks the entry)
+    glBindBuffer(GL_ARRAY_BUFFER, origin_buffer);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
+    glVertexAttribDivisor(1, origin_divisor);
+    glEnableVertexAttribArray(1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, GLRenderBackend::getQuadIndexBuffer());
+
+    // Face record draws: same origins, records fetched by vertex id
+    glBindVertexArray(face_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, origin_buffer);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
+    glVertexAttribDivisor(1, origin_divisor);
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, GLRenderBackend::getQuadIndexBuffer());
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Re-pointed whenever the vertex buffer is replaced by a larger one
+    glBindTexture(GL_TEXTURE_BUFFER, face_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, vertex_buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+bool ChunkArena::allocateOrGrow(RangeAllocator &allocator, GLuint &buffer, size_t element_size, size_t count, ArenaRange &out)
+{
+    if (allocator.allocate(count, out))
+    {
+        return true;
+    }
+
+    // Out of space: double the buffer and copy the live contents across
+    size_t old_capacity = allocator.getCapacity();
+    size_t new_capacity = std::max(old_capacity * 2, old_capacity + count);
+
+    RenderBackend &backend = RenderBackend::get();
+    GLuint new_buffer = backend.createBuffer();
+    if (!backend.allocateBuffer(new_buffer, new_capacity * element_size))
+    {
+        std::cerr << "Chunk arena: failed to grow buffer to " << new_capacity * element_size << " bytes" << std::endl;
+        backend.destroyBuffer(new_buffer);
+        return false;
+    }
+
+    backend.copyBuffer(buffer, 0, new_buffer, 0, old_capacity * element_size);
+    backend.destroyBuffer(buffer);
+    buffer = new_buffer;
+    allocator.grow(new_capacity);
+    setupVertexArray();
+
+    std::cout << "Chunk arena grown to " << new_capacity << " elements" << std::endl;
+    return allocator.allocate(count, out);
+}
+
+bool ChunkArena::upload(const std::vector<VoxelVertex> &vertices, ArenaRange &vertex_range,
+                        GLuint source_buffer, size_t source_offset)
+{
+    if (vertices.empty())
+    {
+        return false;
+    }
+
+    // The old range stays allocated (and drawn) until the new data is in place, so a failed
+    // allocation leaves the previous mesh intact
+    ArenaRange new_vertices;
+    if (!allocateOrGrow(vertex_allocator, vertex_buffer, sizeof(VoxelVertex), vertices.size(), new_vertices))
+    {
+        return false;
+    }
+    release(vertex_range);
+    vertex_range = new_vertices;
+
+    size_t vertex_bytes = vertices.size() * sizeof(VoxelVertex);
+    RenderBackend &backend = RenderBackend::get();
+    if (source_buffer != 0)
+    {
+        // Staged by a worker: the driver only queues a GPU-side copy
+        backend.copyBuffer(source_buffer, source_offset, vertex_buffer, vertex_range.offset * sizeof(VoxelVertex), vertex_bytes);
+    }
+    else
+    {
+        backend.updateBuffer(vertex_buffer, vertex_range.offset * sizeof(VoxelVertex), vertices.data(), vertex_bytes);
+    }
+    return true;
+}
+
+bool ChunkArena::reserve(size_t vertex_count, ArenaRange &out)
+{
+    return vertex_count > 0 && allocateOrGrow(vertex_allocator, vertex_buffer, sizeof(VoxelVertex), vertex_count, out);
+}
+
+void ChunkArena::release(ArenaRange &vertex_range)
+{
+    vertex_allocator.release(vertex_range);
+    vertex_range = ArenaRange();
+}
+
+void ChunkArena::beginBatch()
+{
+    commands.clear();
+    face_commands.clear();
+    origins.clear();
+    layer_ranges.clear();
+}
+
+void ChunkArena::addDraw(size_t first_vertex, size_t quad_count, const glm::vec3 &origin, const glm::vec2 &layer_range)
+{
+    addQuadCommands(commands, first_vertex, quad_count, origin, layer_range);
+}
+
+void ChunkArena::addFaceDraw(size_t first_record, size_t record_count, const glm::vec3 &origin, const glm::vec2 &layer_range)
+{
+    // Vertex ids 4 * record + corner: voxel.vs fetches the record by id
+    addQuadCommands(face_commands, first_record * 4, record_count, origin, layer_range);
+}
+
+void ChunkArena::addQuadCommands(std::vector<DrawElementsIndirectCommand> &target, size_t first_vertex_id, size_t quad_count,
+                                 const glm::vec3 &origin, const glm::vec2 &layer_range)
+{
+    // Pattern indices 4k.. plus base_vertex give vertex ids first_vertex_id + 4k + corner
+    for (size_t quad = 0; quad < quad_count; quad += QUAD_PATTERN_QUADS)
+    {
+        DrawElementsIndirectCommand command;
+        command.count = static_cast<GLuint>(std::min(quad_count - quad, QUAD_PATTERN_QUADS) * 6);
+        command.instance_count = static_cast<GLuint>(ChunkMesh::getViewCount());
+        command.first_index = 0;
+        command.base_vertex = static_cast<GLint>(first_vertex_id + quad * 4);
+        command.base_instance = static_cast<GLuint>(origins.size());
+        target.push_back(command);
+        origins.push_back(origin);
+        layer_ranges.push_back(layer_range);
+    }
+}
+
+size_t ChunkArena::flushBatch(HiZCuller *occlusion)
+{
+    last_batch_size = 0;
+    last_face_batch_size = 0;
+    if (commands.empty() && face_commands.empty())
+    {
+        return 0;
+    }
+
+#ifdef GL_VERSION_4_3
+    // Orphan and refill the per-frame buffers
+    RenderBackend &backend = RenderBackend::get();
+    backend.streamBuffer(origin_buffer, origins.data(), origins.size() * sizeof(glm::vec3));
+
+    // Both lists in one buffer so the occlusion test covers them in a single dispatch
+    size_t total_commands = commands.size() + face_commands.size();
+    commands.insert(commands.end(), face_commands.begin(), face_commands.end());
+    backend.streamBuffer(indirect_buffer, commands.data(), total_commands * sizeof(DrawElementsIndirectCommand));
+
+    if (occlusion)
+    {
+        backend.streamBuffer(layer_range_buffer, layer_ranges.data(), layer_ranges.size() * sizeof(glm::vec2));
+        occlusion->cullDraws(indirect_buffer, origin_buffer, layer_range_buffer, total_commands);
+    }
+
+    last_face_batch_size = face_commands.size();
+    last_batch_size = total_commands - last_face_batch_size;
+    drawBatch(last_batch_size, last_face_batch_size);
+#endif
+
+    size_t submitted = last_batch_size + last_face_batch_size;
+    beginBatch();
+    return submitted;
+}
+
+size_t ChunkArena::redrawBatch()
+{
+    drawBatch(last_batch_size, last_face_batch_size);
+    return last_batch_size + last_face_batch_size;
+}
+
+void ChunkArena::drawBatch(size_t command_count, size_t face_command_count)
+{
+#ifdef GL_VERSION_4_3
+    if (command_count == 0 && face_command_count == 0)
+    {
+        return;
+    }
+
+    // One origin per draw however many views it has instances for
+    GLuint views = static_cast<GLuint>(ChunkMesh::getViewCount());
+    if (views != origin_divisor)
+    {
+        origin_divisor = views;
+        for (GLuint array : {vao, face_vao})
+        {
+            glBindVertexArray(array);
+            glVertexAttribDivisor(1, origin_divisor);
+        }
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+    if (command_count > 0)
+    {
+        glBindVertexArray(vao);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, nullptr, static_cast<GLsizei>(command_count), 0);
+    }
+
+    // Face records after the corner draws; during a format switch this splits the
+    // translucent back-to-front order into two runs, which only lasts until the remesh
+    if (face_command_count > 0)
+    {
+        glActiveTexture(GL_TEXTURE0 + FACE_RECORD_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, face_texture);
+        glBindVertexArray(face_vao);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT,
+                                   reinterpret_cast<const void *>(command_count * sizeof(DrawElementsIndirectCommand)),
+                                   static_cast<GLsizei>(face_command_count), 0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+#endif
+}
+
+size_t ChunkArena::getUsedBytes() const
+{
+    return vertex_allocator.getUsed() * sizeof(VoxelVertex);
+}
+
+size_t ChunkArena::getCapacityBytes() const
+{
+    return vertex_allocator.getCapacity() * sizeof(VoxelVertex);
+}
@@ -0,0 +1,129 @@
+#ifndef CHUNK_ARENA_H
+#define CHUNK_ARENA_H
+
+#include <glm/glm/glm.hpp>
+#include <glad/glad/glad.h>
+#include <map>
+#include <vector>
+#include <cstddef>
+
+struct VoxelVertex;
+class HiZCuller;
+
+// Element range inside an arena buffer
+struct ArenaRange
+{
+    size_t offset = 0;
+    size_t size = 0;
+
+    bool isValid() const { return size > 0; }
+};
+
+// First-fit free-list allocator over a linear range of elements; freed neighbors coalesce
+class RangeAllocator
+{
+public:
+    explicit RangeAllocator(size_t capacity);
+
+    bool allocate(size_t size, ArenaRange &out);
+    void release(const ArenaRange &range);
+    void grow(size_t new_capacity);
+
+    size_t getCapacity() const { return capacity; }
+    size_t getUsed() const { return used; }
+
+private:
+    std::map<size_t, size_t> free_blocks; // offset -> size
+    size_t capacity;
+    size_t used;
+};
+
+// Layout consumed by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+};
+
+// One shared vertex buffer holding every chunk mesh (GL 4.3+).
+//
+// Meshes store no indices: every draw reads the shared 16-bit quad pattern
+// (GLRenderBackend::getQuadIndexBuffer) from its start, and base_vertex moves it to the draw's first
+// quad. Each draw's chunk origin is an instanced attribute (location 1) selected by
+// base_instance, so a whole pass is one glMultiDrawElementsIndirect call with no per-chunk
+// state changes. The buffer doubles when full. MeshFormat::Faces meshes keep records instead
+// of corners; their draws go through a second vertex array with no vertex attribute and read
+// the records through a buffer texture, as a second multi-draw call of the same pass.
+// Buffers, uploads, growth copies and the per-batch streams go through the RenderBackend;
+// the vertex arrays and indirect draws are OpenGL.
+class ChunkArena
+{
+public:
+    // True when the loaded context provides multi-draw indirect
+    static bool isSupported();
+
+    explicit ChunkArena(size_t vertex_capacity);
+    ~ChunkArena();
+
+    ChunkArena(const ChunkArena &) = delete;
+    ChunkArena &operator=(const ChunkArena &) = delete;
+
+    // Copy mesh data into a newly allocated range, then release the range passed in and replace
+    // it; on failure it is left as it was. With a source buffer the data is copied on the GPU
+    // from it (at source_offset) instead of from the vector
+    bool upload(const std::vector<VoxelVertex> &vertices, ArenaRange &vertex_range,
+                GLuint source_buffer = 0, size_t source_offset = 0);
+    void release(ArenaRange &vertex_range);
+    // Allocate a range for vertices written on the GPU (GpuMesher), growing the buffer if needed
+    bool reserve(size_t vertex_count, ArenaRange &out);
+    // Vertex storage; replaced when the arena grows
+    GLuint getVertexBuffer() const { return vertex_buffer; }
+
+    // Draw batching: collect commands for one pass, then submit them in a single call.
+    // With an occlusion culler the uploaded commands are filtered on the GPU before drawing.
+    void beginBatch();
+    // layer_range: the vertical extent of the draw's geometry relative to the origin (y of the
+    // lowest and highest face plane), which the occlusion test bounds its box with. Draws of
+    // more than QUAD_PATTERN_QUADS quads become several commands.
+    void addDraw(size_t first_vertex, size_t quad_count, const glm::vec3 &origin, const glm::vec2 &layer_range);
+    void addFaceDraw(size_t first_record, size_t record_count, const glm::vec3 &origin,
+                     const glm::vec2 &layer_range); // MeshFormat::Faces
+    size_t flushBatch(HiZCuller *occlusion = nullptr);
+    // Submit the last flushed batch again from the same (already culled) indirect buffer,
+    // e.g. the color pass that follows a depth pre-pass
+    size_t redrawBatch();
+
+    size_t getUsedBytes() const;
+    size_t getCapacityBytes() const;
+
+private:
+    GLuint vao;
+    GLuint face_vao;     // Origins and the quad index pattern only; attribute 0 left generic
+    GLuint face_texture; // R32UI buffer texture over vertex_buffer
+    GLuint vertex_buffer;
+    GLuint origin_buffer;
+    GLuint layer_range_buffer; // Per-draw layer_range, for the occlusion test only
+    GLuint indirect_buffer;
+    GLuint origin_divisor; // Instances per origin: the view count of the draws
+
+    RangeAllocator vertex_allocator;
+
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<DrawElementsIndirectCommand> face_commands; // Uploaded right after commands
+    std::vector<glm::vec3> origins;                         // Shared by both lists (base_instance)
+    std::vector<glm::vec2> layer_ranges;                    // Same order as origins
+    size_t last_batch_size; // Commands still in indirect_buffer from the last flush
+    size_t last_face_batch_size;
+
+    // Commands for quad_count quads from vertex id first_vertex_id, split to fit the pattern
+    void addQuadCommands(std::vector<DrawElementsIndirectCommand> &target, size_t first_vertex_id, size_t quad_count,
+                         const glm::vec3 &origin, const glm::vec2 &layer_range);
+    void drawBatch(size_t command_count, size_t face_command_count);
+    bool allocateOrGrow(RangeAllocator &allocator, GLuint &buffer, size_t element_size, size_t count, ArenaRange &out);
+    void setupVertexArray();
+};
+
+#endif // CHUNK_ARENA_H
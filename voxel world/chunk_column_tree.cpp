@@ -0,0 +1,170 @@
+#include "chunk_column_tree.h"
+#include <algorithm>
+#include <bit>
+#include <climits>
+
+namespace
+{
+constexpr int LEAF_LEVEL = std::countr_zero(static_cast<unsigned>(ChunkColumnTree::LEAF_COLUMNS));
+static_assert(std::has_single_bit(static_cast<unsigned>(ChunkColumnTree::LEAF_COLUMNS)),
+              "Leaves are squares of the quadtree");
+
+// The low 16 bits of value, one in every other bit
+uint32_t spreadBits(uint32_t value)
+{
+    value &= 0xFFFF;
+    value = (value | (value << 8)) & 0x00FF00FF;
+    value = (value | (value << 4)) & 0x0F0F0F0F;
+    value = (value | (value << 2)) & 0x33333333;
+    value = (value | (value << 1)) & 0x55555555;
+    return value;
+}
+} // namespace
+
+void ChunkColumnTree::clear()
+{
+    nodes.clear();
+    members.clear();
+    codes.clear();
+    boxes.clear();
+}
+
+void ChunkColumnTree::build(const std::vector<std::pair<glm::ivec3, VoxelChunk *>> &chunks, const ChunkBoundsSoA &bounds,
+                            const glm::vec3 &half_extents)
+{
+    clear();
+    this->half_extents = half_extents;
+    if (chunks.empty())
+    {
+        return;
+    }
+
+    // Columns relative to the lowest corner, x in the even bits of the code and z in the odd
+    int min_x = INT_MAX;
+    int min_z = INT_MAX;
+    for (const auto &[chunk_pos, chunk] : chunks)
+    {
+        min_x = std::min(min_x, chunk_pos.x);
+        min_z = std::min(min_z, chunk_pos.z);
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> order(chunks.size());
+    uint32_t span = 0;
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        uint32_t x = std::min(static_cast<uint32_t>(chunks[i].first.x - min_x), 0xFFFFu);
+        uint32_t z = std::min(static_cast<uint32_t>(chunks[i].first.z - min_z), 0xFFFFu);
+        span = std::max(span, std::max(x, z));
+        order[i] = {spreadBits(x) | (spreadBits(z) << 1), static_cast<uint32_t>(i)};
+    }
+    std::sort(order.begin(), order.end());
+
+    members.reserve(order.size());
+    codes.reserve(order.size());
+    for (const auto &[code, index] : order)
+    {
+        members.push_back(index);
+        codes.push_back(code);
+        boxes.push(glm::vec3(bounds.center_x[index], bounds.center_y[index], bounds.center_z[index]),
+                   bounds.half_y[index]);
+    }
+
+    int level = std::bit_width(span);
+    buildNode(0, static_cast<uint32_t>(members.size()), std::max(level, LEAF_LEVEL));
+}
+
+uint32_t ChunkColumnTree::buildNode(uint32_t first, uint32_t last, int level)
+{
+    uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+
+    Node node;
+    node.first = first;
+    node.count = last - first;
+    node.children.fill(NO_CHILD);
+    node.is_leaf = level <= LEAF_LEVEL;
+    node.min = glm::vec3(boxes.center_x[first], boxes.center_y[first], boxes.center_z[first]);
+    node.max = node.min;
+    for (uint32_t i = first; i < last; i++)
+    {
+        glm::vec3 center(boxes.center_x[i], boxes.center_y[i], boxes.center_z[i]);
+        glm::vec3 half(half_extents.x, boxes.half_y[i], half_extents.z);
+        node.min = glm::min(node.min, center - half);
+        node.max = glm::max(node.max, center + half);
+    }
+
+    // Members are in code order, so each quadrant is the next run sharing its two bits
+    if (!node.is_leaf)
+    {
+        const int shift = 2 * (level - 1);
+        uint32_t begin = first;
+        for (uint32_t quadrant = 0; quadrant < 4; quadrant++)
+        {
+            uint32_t end = begin;
+            while (end < last && ((codes[end] >> shift) & 3u) == quadrant)
+            {
+                end++;
+            }
+            if (end > begin)
+            {
+                node.children[quadrant] = buildNode(begin, end, level - 1);
+            }
+            begin = end;
+        }
+    }
+
+    nodes[index] = node; // Children were appended after it
+    return index;
+}
+
+size_t ChunkColumnTree::cull(const Frustum &frustum, uint8_t *visible)
+{
+    std::fill(visible, visible + members.size(), 0);
+    boxes_tested = 0;
+    size_t visible_count = 0;
+    if (!nodes.empty())
+    {
+        cullNode(0, frustum, visible, visible_count);
+    }
+    return visible_count;
+}
+
+void ChunkColumnTree::cullNode(uint32_t index, const Frustum &frustum, uint8_t *visible, size_t &visible_count)
+{
+    const Node &node = nodes[index];
+    switch (frustum.classifyBox((node.min + node.max) * 0.5f, (node.max - node.min) * 0.5f))
+    {
+    case Frustum::Containment::Outside:
+        return;
+    case Frustum::Containment::Inside:
+        for (uint32_t i = node.first; i < node.first + node.count; i++)
+        {
+            visible[members[i]] = 1;
+        }
+        visible_count += node.count;
+        return;
+    case Frustum::Containment::Intersecting:
+        break;
+    }
+
+    if (!node.is_leaf)
+    {
+        for (uint32_t child : node.children)
+        {
+            if (child != NO_CHILD)
+            {
+                cullNode(child, frustum, visible, visible_count);
+            }
+        }
+        return;
+    }
+
+    leaf_visible.resize(node.count);
+    visible_count += frustum.cullBoxes(boxes.center_x.data() + node.first, boxes.center_y.data() + node.first,
+                                       boxes.center_z.data() + node.first, boxes.half_y.data() + node.first,
+                                       node.count, half_extents, leaf_visible.data());
+    for (uint32_t i = 0; i < node.count; i++)
+    {
+        visible[members[node.first + i]] = leaf_visible[i];
+    }
+    boxes_tested += node.count;
+}
@@ -0,0 +1,67 @@
+#ifndef CHUNK_COLUMN_TREE_H
+#define CHUNK_COLUMN_TREE_H
+
+#include "frustum.h"
+#include "voxel_types.h"
+#include <glm/glm/glm.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class VoxelChunk;
+
+// Quadtree over the chunk columns of a set of boxes (the renderer's cull candidates), for
+// frustum culling that grows with what is on screen rather than with the render distance.
+//
+// Boxes are sorted by the Morton code of their column and split into squares of columns, down
+// to LEAF_COLUMNS across; every node holds the bounds of the boxes below it, so its height only
+// spans the layers their meshes occupy. A node outside the frustum rejects its whole subtree
+// and one inside accepts it, and only leaves straddling a plane test their boxes, in bulk
+// from a copy kept contiguous in tree order. Rebuilt whenever the boxes change; the results
+// come back in the order the boxes were given.
+class ChunkColumnTree
+{
+public:
+    static constexpr int LEAF_COLUMNS = 4; // Chunk columns per leaf side
+
+    // Boxes as the renderer gathers them: per chunk a center and half height (bounds.half_y),
+    // with the fixed horizontal half extents
+    void build(const std::vector<std::pair<glm::ivec3, VoxelChunk *>> &chunks, const ChunkBoundsSoA &bounds,
+               const glm::vec3 &half_extents);
+    void clear();
+
+    // Writes 1 (visible) or 0 (culled) per box, in build order, and returns the visible count
+    size_t cull(const Frustum &frustum, uint8_t *visible);
+
+    size_t getNodeCount() const { return nodes.size(); }
+    size_t getBoxesTestedLastCull() const { return boxes_tested; } // Boxes in straddling leaves
+
+private:
+    static constexpr uint32_t NO_CHILD = UINT32_MAX;
+
+    struct Node
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+        uint32_t first; // Range of members (and boxes) below the node
+        uint32_t count;
+        std::array<uint32_t, 4> children; // Quadrants, NO_CHILD where empty
+        bool is_leaf;
+    };
+
+    glm::vec3 half_extents{0.0f};
+    std::vector<Node> nodes; // Root first
+    std::vector<uint32_t> members; // Box index per tree position
+    std::vector<uint32_t> codes; // Morton code of each member's column, same order
+    ChunkBoundsSoA boxes; // Member boxes in tree order
+    std::vector<uint8_t> leaf_visible; // Scratch for one leaf's bulk test
+    size_t boxes_tested = 0;
+
+    // Node for members [first, last), all in one square of 2^level columns
+    uint32_t buildNode(uint32_t first, uint32_t last, int level);
+    void cullNode(uint32_t index, const Frustum &frustum, uint8_t *visible, size_t &visible_count);
+};
+
+#endif // CHUNK_COLUMN_TREE_H
@@ -0,0 +1,62 @@
+#include "chunk_grid.h"
+#include "voxel_chunk.h"
+#include <algorithm>
+
+ChunkGrid::ChunkGrid()
+    : radius(0), side(1), layer_radius(0), layer_side(1), center(0)
+{
+    slots.assign(1, nullptr);
+}
+
+void ChunkGrid::resize(int new_radius, int new_layer_radius)
+{
+    radius = std::max(0, new_radius);
+    side = radius * 2 + 1;
+    layer_radius = std::max(0, new_layer_radius);
+    layer_side = layer_radius * 2 + 1;
+    slots.assign(static_cast<size_t>(side) * layer_side * side, nullptr);
+}
+
+void ChunkGrid::setCenter(const glm::ivec3 &new_center)
+{
+    center = new_center;
+}
+
+void ChunkGrid::clear()
+{
+    std::fill(slots.begin(), slots.end(), nullptr);
+}
+
+VoxelChunk *ChunkGrid::get(const glm::ivec3 &chunk_pos) const
+{
+    if (!contains(chunk_pos))
+    {
+        return nullptr;
+    }
+
+    VoxelChunk *chunk = slots[slotIndex(chunk_pos)];
+    return (chunk && chunk->position == chunk_pos) ? chunk : nullptr;
+}
+
+void ChunkGrid::insert(VoxelChunk *chunk)
+{
+    if (chunk && contains(chunk->position))
+    {
+        slots[slotIndex(chunk->position)] = chunk;
+    }
+}
+
+void ChunkGrid::erase(const VoxelChunk *chunk)
+{
+    if (!chunk)
+    {
+        return;
+    }
+
+    // Only clear the slot if it still refers to this chunk (it may have been reused)
+    VoxelChunk *&slot = slots[slotIndex(chunk->position)];
+    if (slot == chunk)
+    {
+        slot = nullptr;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef CHUNK_GRID_H
+#define CHUNK_GRID_H
+
+#include "voxel_types.h"
+#include <glm/glm/glm.hpp>
+#include <vector>
+
+class VoxelChunk;
+
+// Fixed-size toroidal window of chunk pointers centered on the player, in every axis (the
+// world has no height limit).
+//
+// Slots are addressed by chunk coordinate modulo the window size, so lookups are pure index
+// math and a move only invalidates slots that wrap around. Each slot is checked against the
+// stored chunk's position, which rejects stale entries left behind by a re-center. The grid
+// does not own chunks; coordinates outside the window return nullptr and callers fall back.
+class ChunkGrid
+{
+public:
+    ChunkGrid();
+
+    // Size the window to cover `radius` chunks around the center in X/Z and `layer_radius`
+    // layers above and below it (drops all entries)
+    void resize(int radius, int layer_radius);
+    void setCenter(const glm::ivec3 &center);
+    void clear();
+
+    bool contains(const glm::ivec3 &chunk_pos) const
+    {
+        return chunk_pos.y >= center.y - layer_radius && chunk_pos.y <= center.y + layer_radius &&
+               chunk_pos.x >= center.x - radius && chunk_pos.x <= center.x + radius &&
+               chunk_pos.z >= center.z - radius && chunk_pos.z <= center.z + radius;
+    }
+
+    // nullptr when the chunk is not loaded or lies outside the window
+    VoxelChunk *get(const glm::ivec3 &chunk_pos) const;
+
+    void insert(VoxelChunk *chunk);
+    void erase(const VoxelChunk *chunk);
+
+    int getRadius() const { return radius; }
+    int getSide() const { return side; }
+    int getLayerRadius() const { return layer_radius; }
+
+private:
+    int radius;
+    int side;
+    int layer_radius;
+    int layer_side;
+    glm::ivec3 center;
+    std::vector<VoxelChunk *> slots;
+
+    static int wrap(int value, int size)
+    {
+        int m = value % size;
+        return m < 0 ? m + size : m;
+    }
+
+    size_t slotIndex(const glm::ivec3 &chunk_pos) const
+    {
+        return (static_cast<size_t>(wrap(chunk_pos.x, side)) * layer_side + wrap(chunk_pos.y, layer_side)) * side +
+               wrap(chunk_pos.z, side);
+    }
+};
+
+#endif // CHUNK_GRID_H
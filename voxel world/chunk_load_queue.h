@@ -0,0 +1,191 @@
+#ifndef CHUNK_LOAD_QUEUE_H
+#define CHUNK_LOAD_QUEUE_H
+
+#include <glm/glm/glm.hpp>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+// Min-priority queue of chunk positions with an index map, so entries can be updated or
+// cancelled in O(log n) instead of rebuilding the queue.
+//
+// Hash is a template parameter to reuse the world's Vec3Hash without a header cycle.
+template <typename Hash>
+class ChunkLoadQueue
+{
+public:
+    bool empty() const { return heap.empty(); }
+    size_t size() const { return heap.size(); }
+    bool contains(const glm::ivec3 &pos) const { return index.find(pos) != index.end(); }
+
+    // Insert, or move an existing entry to a new priority (keeping when it was first queued)
+    void push(const glm::ivec3 &pos, float priority)
+    {
+        auto it = index.find(pos);
+        if (it != index.end())
+        {
+            size_t i = it->second;
+            float old_priority = heap[i].priority;
+            heap[i].priority = priority;
+            if (priority < old_priority)
+                siftUp(i);
+            else
+                siftDown(i);
+            return;
+        }
+
+        heap.push_back({priority, pos, std::chrono::steady_clock::now()});
+        index[pos] = heap.size() - 1;
+        siftUp(heap.size() - 1);
+    }
+
+    // Insert, or lower an existing entry's priority (wanted by several, the nearest counts)
+    void pushMin(const glm::ivec3 &pos, float priority)
+    {
+        auto it = index.find(pos);
+        if (it == index.end() || priority < heap[it->second].priority)
+        {
+            push(pos, priority);
+        }
+    }
+
+    // Cancel an entry; returns false if it was not queued
+    bool erase(const glm::ivec3 &pos)
+    {
+        auto it = index.find(pos);
+        if (it == index.end())
+        {
+            return false;
+        }
+
+        size_t i = it->second;
+        index.erase(it);
+        size_t last = heap.size() - 1;
+        if (i != last)
+        {
+            heap[i] = heap[last];
+            index[heap[i].position] = i;
+            heap.pop_back();
+            siftDown(i);
+            siftUp(i);
+        }
+        else
+        {
+            heap.pop_back();
+        }
+        return true;
+    }
+
+    const glm::ivec3 &top() const { return heap.front().position; }
+
+    glm::ivec3 pop(std::chrono::steady_clock::time_point *queued_at = nullptr)
+    {
+        glm::ivec3 pos = heap.front().position;
+        if (queued_at)
+        {
+            *queued_at = heap.front().queued_at;
+        }
+        erase(pos);
+        return pos;
+    }
+
+    // Drop every entry the predicate accepts; O(n) heapify. Returns the number removed.
+    size_t eraseIf(const std::function<bool(const glm::ivec3 &)> &predicate)
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < heap.size(); i++)
+        {
+            if (predicate(heap[i].position))
+            {
+                index.erase(heap[i].position);
+            }
+            else
+            {
+                heap[kept++] = heap[i];
+            }
+        }
+        size_t removed = heap.size() - kept;
+        heap.resize(kept);
+        for (size_t i = 0; i < heap.size(); i++)
+        {
+            index[heap[i].position] = i;
+        }
+        for (size_t i = heap.size() / 2; i-- > 0;)
+        {
+            siftDown(i);
+        }
+        return removed;
+    }
+
+    // Recompute every priority at once (e.g. after the center moved); O(n) heapify
+    void reprioritize(const std::function<float(const glm::ivec3 &)> &priority_of)
+    {
+        for (auto &entry : heap)
+        {
+            entry.priority = priority_of(entry.position);
+        }
+        for (size_t i = heap.size() / 2; i-- > 0;)
+        {
+            siftDown(i);
+        }
+    }
+
+    void clear()
+    {
+        heap.clear();
+        index.clear();
+    }
+
+private:
+    struct Entry
+    {
+        float priority;
+        glm::ivec3 position;
+        std::chrono::steady_clock::time_point queued_at;
+    };
+
+    std::vector<Entry> heap;
+    std::unordered_map<glm::ivec3, size_t, Hash> index;
+
+    void swapEntries(size_t a, size_t b)
+    {
+        std::swap(heap[a], heap[b]);
+        index[heap[a].position] = a;
+        index[heap[b].position] = b;
+    }
+
+    void siftUp(size_t i)
+    {
+        while (i > 0)
+        {
+            size_t parent = (i - 1) / 2;
+            if (heap[parent].priority <= heap[i].priority)
+                break;
+            swapEntries(i, parent);
+            i = parent;
+        }
+    }
+
+    void siftDown(size_t i)
+    {
+        size_t count = heap.size();
+        while (true)
+        {
+            size_t smallest = i;
+            size_t left = i * 2 + 1;
+            size_t right = left + 1;
+            if (left < count && heap[left].priority < heap[smallest].priority)
+                smallest = left;
+            if (right < count && heap[right].priority < heap[smallest].priority)
+                smallest = right;
+            if (smallest == i)
+                break;
+            swapEntries(i, smallest);
+            i = smallest;
+        }
+    }
+};
+
+#endif // CHUNK_LOAD_QUEUE_H
@@ -1,9 +1,137 @@
 #include "chunk_mesh.h"
+#include "chunk_visibility.h"
 #include "voxel_chunk.h"
+#include "chunk_snapshot.h"
+#include "chunk_occupancy.h"
+#include "gpu_mesher.h"
+#include "profiler.h"
+#include "log.h"
+#include <algorithm>
 #include <iostream>
 #include <cstring>
 #include <chrono>
 #include <string>
+#include <array>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+    std::atomic<int> g_meshing_mode{static_cast<int>(MeshingMode::Naive)};
+    std::atomic<int> g_mesh_format{static_cast<int>(MeshFormat::Indexed)};
+    int g_view_count = 1;
+
+    inline int countTrailingZeros64(uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+
+    // Calls emit(first, count) for every run of consecutive direction buckets selected by the
+    // mask, starting at first_index
+    template <typename Emit>
+    size_t forEachDirectionRun(const std::array<uint32_t, 6> &counts, size_t first_index, uint8_t directions, Emit emit)
+    {
+        size_t submitted = 0;
+        size_t run_start = first_index;
+        size_t run_count = 0;
+        size_t cursor = first_index;
+        for (int face = 0; face < 6; face++)
+        {
+            if ((directions >> face) & 1)
+            {
+                if (run_count == 0)
+                {
+                    run_start = cursor;
+                }
+                run_count += counts[face];
+            }
+            else if (run_count > 0)
+            {
+                emit(run_start, run_count);
+                submitted += run_count;
+                run_count = 0;
+            }
+            cursor += counts[face];
+        }
+        if (run_count > 0)
+        {
+            emit(run_start, run_count);
+            submitted += run_count;
+        }
+        return submitted;
+    }
+
+}
+
+const char *getMeshingModeName(MeshingMode mode)
+{
+    switch (mode)
+    {
+    case MeshingMode::Naive:
+        return "Naive";
+    case MeshingMode::Greedy:
+        return "Greedy";
+    case MeshingMode::Binary:
+        return "Binary";
+    case MeshingMode::BinaryGreedy:
+        return "BinaryGreedy";
+    default:
+        return "Unknown";
+    }
+}
+
+void ChunkMesh::setMeshingMode(MeshingMode mode)
+{
+    g_meshing_mode.store(static_cast<int>(mode));
+}
+
+MeshingMode ChunkMesh::getMeshingMode()
+{
+    return static_cast<MeshingMode>(g_meshing_mode.load());
+}
+
+const char *getMeshFormatName(MeshFormat format)
+{
+    switch (format)
+    {
+    case MeshFormat::Indexed:
+        return "Indexed";
+    case MeshFormat::Faces:
+        return "Faces";
+    default:
+        return "Unknown";
+    }
+}
+
+void ChunkMesh::setMeshFormat(MeshFormat format)
+{
+    g_mesh_format.store(static_cast<int>(format));
+}
+
+MeshFormat ChunkMesh::getMeshFormat()
+{
+    return static_cast<MeshFormat>(g_mesh_format.load());
+}
+
+void ChunkMesh::setViewCount(int count)
+{
+    g_view_count = std::max(1, count);
+}
+
+int ChunkMesh::getViewCount()
+{
+    return g_view_count;
+}
 
 // Face vertex definitions (relative to cube center at origin)
 const glm::vec3 ChunkMesh::FACE_VERTICES[6][4] = {
@@ -50,117 +178,193 @@ const glm::vec3 ChunkMesh::FACE_VERTICES[6][4] = {
         glm::vec3(-0.5f, -0.5f, 0.5f)   // top-left
     }};
 
-// Face normals
-const glm::vec3 ChunkMesh::FACE_NORMALS[6] = {
-    glm::vec3(0.0f, 0.0f, 1.0f),  // FACE_FRONT
-    glm::vec3(0.0f, 0.0f, -1.0f), // FACE_BACK
-    glm::vec3(1.0f, 0.0f, 0.0f),  // FACE_RIGHT
-    glm::vec3(-1.0f, 0.0f, 0.0f), // FACE_LEFT
-    glm::vec3(0.0f, 1.0f, 0.0f),  // FACE_TOP
-    glm::vec3(0.0f, -1.0f, 0.0f)  // FACE_BOTTOM
-};
-
-// Texture coordinates
-const glm::vec2 ChunkMesh::FACE_TEX_COORDS[4] = {
-    glm::vec2(0.0f, 0.0f), // bottom-left
-    glm::vec2(1.0f, 0.0f), // bottom-right
-    glm::vec2(1.0f, 1.0f), // top-right
-    glm::vec2(0.0f, 1.0f)  // top-left
-};
-
 ChunkMesh::ChunkMesh()
-    : VAO(0), VBO(0), EBO(0), is_built(false), is_uploaded(false), vertex_count(0), index_count(0)
+    : vertex_buffer(0), geometry(0), geometry_format(MeshFormat::Indexed), vbo_capacity(0), is_built(false), is_uploaded(false), vertex_count(0),
+      opaque_index_count(0), cutout_index_count(0), translucent_index_count(0), direction_counts{}, face_count(0),
+      face_connectivity(FACE_CONNECTIVITY_ALL), min_occupied_y(0), max_occupied_y(CHUNK_HEIGHT - 1), lod(0), format(MeshFormat::Indexed), arena(nullptr), arena_opaque_count(0), arena_cutout_count(0),
+      arena_translucent_count(0), arena_direction_counts{},
+      current_chunk(nullptr)
+{
+}
+
+std::atomic<size_t> ChunkMesh::gpu_buffer_bytes{0};
+
+MeshBufferPool &MeshBufferPool::instance()
+{
+    static MeshBufferPool pool;
+    return pool;
+}
+
+size_t MeshBufferPool::getPooledBytes()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    size_t bytes = 0;
+    for (const auto &buffer : vertex_buffers)
+    {
+        bytes += buffer.capacity() * sizeof(VoxelVertex);
+    }
+    return bytes;
+}
+
+void MeshBufferPool::acquire(std::vector<VoxelVertex> &vertices)
+{
+    if (vertices.capacity() > 0)
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!vertex_buffers.empty())
+    {
+        vertices.swap(vertex_buffers.back());
+        vertex_buffers.pop_back();
+    }
+}
+
+void MeshBufferPool::release(std::vector<VoxelVertex> &vertices)
 {
+    vertices.clear();
+    if (vertices.capacity() > 0)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (vertex_buffers.size() < MAX_POOLED)
+        {
+            vertex_buffers.emplace_back(std::move(vertices));
+        }
+    }
+    std::vector<VoxelVertex>().swap(vertices);
 }
 
 ChunkMesh::~ChunkMesh()
 {
     cleanupGL();
+    releaseCpuData();
+    MeshBufferPool &pool = MeshBufferPool::instance();
+    pool.release(cutout_faces);
+    pool.release(translucent_faces);
+}
+
+void ChunkMesh::releaseCpuData()
+{
+    MeshBufferPool &pool = MeshBufferPool::instance();
+    pool.release(vertices);
 }
 
-void ChunkMesh::buildMesh(const VoxelChunk &chunk)
+void ChunkMesh::buildMesh(const ChunkSnapshot &chunk, int lod, const MeshSectionRebuild *rebuild)
 {
+    PROFILE_ZONE("ChunkMesh::buildMesh");
     auto total_start = std::chrono::high_resolution_clock::now();
 
     current_chunk = &chunk;
     clear();
+    this->lod = std::max(0, std::min(lod, MAX_MESH_LOD));
+    format = getMeshFormat();
+    bake_occlusion = format == MeshFormat::Indexed && this->lod == 0;
 
-    auto setup_start = std::chrono::high_resolution_clock::now();
+    // Uniform air chunks have nothing to emit
+    if (chunk.isUniform() && chunk.getUniformVoxel() == VOXEL_AIR)
+    {
+        markEmpty();
+        return;
+    }
 
-    const VoxelID *data = chunk.voxels.data();
-    int solid_voxel_count = 0;
+    // Reuse vectors released by uploaded meshes
+    MeshBufferPool &pool = MeshBufferPool::instance();
+    pool.acquire(vertices);
+    pool.acquire(cutout_faces);
+    pool.acquire(translucent_faces);
 
-    auto idx = [&](int x, int y, int z)
-    { return x * CHUNK_HEIGHT * CHUNK_SIZE + y * CHUNK_SIZE + z; };
+    auto setup_start = std::chrono::high_resolution_clock::now();
+
+    // Decode the palette storage once up front so the loops below read a flat array, plus
+    // a padded copy so lookups across the border never leave the buffer
+    thread_local std::array<VoxelID, CHUNK_VOLUME> decoded_voxels;
+    thread_local std::array<VoxelID, ChunkSnapshot::PADDED_VOLUME> padded_voxels;
+    chunk.decodeVoxels(decoded_voxels.data());
+    chunk.decodePadded(decoded_voxels.data(), padded_voxels.data());
+    const VoxelID *data = decoded_voxels.data();
+    const VoxelID *padded = padded_voxels.data();
+    thread_local std::array<uint8_t, ChunkSnapshot::PADDED_VOLUME> padded_light_values;
+    chunk.decodePaddedLight(padded_light_values.data());
+    padded_light = padded_light_values.data();
 
-    // Quick count of solid voxels
-    for (int i = 0; i < CHUNK_VOLUME; ++i)
+    if (chunk.isUniform())
     {
-        if (data[i] != VOXEL_AIR)
-        {
-            solid_voxel_count++;
-        }
+        face_connectivity = isVoxelTransparent(chunk.getUniformVoxel()) ? FACE_CONNECTIVITY_ALL : FACE_CONNECTIVITY_NONE;
     }
+    else
+    {
+        face_connectivity = computeFaceConnectivity(data);
+    }
+    // One vectorized pass: the non-air count sizes the buffers, the column masks let the
+    // binary mesher skip empty columns
+    thread_local ChunkOccupancy occupancy_summary;
+    summarizeOccupancy(data, occupancy_summary);
+    occupancy = &occupancy_summary;
 
     // Reserve based on actual solid voxels (max 6 faces per voxel, 4 vertices per face)
-    int estimated_vertices = std::min(solid_voxel_count * 24, CHUNK_VOLUME / 4);
-    vertices.reserve(estimated_vertices);
-    indices.reserve(estimated_vertices * 3 / 2); // Rough estimate for indices
+    int estimated_vertices = std::min(occupancy_summary.non_air_count * 24, CHUNK_VOLUME / 4);
+    vertices.reserve(format == MeshFormat::Faces ? estimated_vertices / 4 : estimated_vertices); // One record per face
 
     auto setup_end = std::chrono::high_resolution_clock::now();
 
-    auto inLocal = [](int x, int y, int z)
-    { return x >= 0 && x < CHUNK_SIZE && y >= 0 && y < CHUNK_HEIGHT && z >= 0 && z < CHUNK_SIZE; };
-
     auto loop_start = std::chrono::high_resolution_clock::now();
-    int faces_processed = 0;
-    int neighbor_lookups = 0;
-
-    for (int x = 0; x < CHUNK_SIZE; ++x)
-        for (int y = 0; y < CHUNK_HEIGHT; ++y)
-            for (int z = 0; z < CHUNK_SIZE; ++z)
-            {
-                VoxelID voxel = data[idx(x, y, z)];
-                if (voxel == VOXEL_AIR)
-                    continue;
-
-                bool voxel_transparent = VOXEL_INFO[voxel].is_transparent;
-                glm::vec3 basePos(x, y, z);
-
-                auto emitFaceIfVisible = [&](int nx, int ny, int nz, int faceDir)
-                {
-                    VoxelID neighborVoxel;
-                    if (inLocal(nx, ny, nz))
-                    {
-                        neighborVoxel = data[idx(nx, ny, nz)];
-                    }
-                    else
-                    {
-                        neighbor_lookups++;
-                        // Predict neighbor using cross-chunk lookup
-                        neighborVoxel = chunk.getVoxelWithNeighbors(nx, ny, nz);
-                    }
-                    faces_processed++;
-                    if (shouldRenderFaceOptimized(chunk, x, y, z, faceDir, voxel))
-                        addFaceOptimized(basePos, faceDir, voxel, x, y, z);
-                };
 
-                emitFaceIfVisible(x, y, z + 1, FACE_FRONT);
-                emitFaceIfVisible(x, y, z - 1, FACE_BACK);
-                emitFaceIfVisible(x + 1, y, z, FACE_RIGHT);
-                emitFaceIfVisible(x - 1, y, z, FACE_LEFT);
-                emitFaceIfVisible(x, y + 1, z, FACE_TOP);
-                emitFaceIfVisible(x, y - 1, z, FACE_BOTTOM);
-            }
+    // Faces come from non-air voxels only, so the layers outside the occupied range are
+    // never walked and the geometry stays within them (whole lod cells when downsampled)
+    MeshingMode mode = getMeshingMode();
+    int cell = 1 << this->lod;
+    min_occupied_y = occupancy_summary.min_y / cell * cell;
+    max_occupied_y = (occupancy_summary.max_y / cell + 1) * cell - 1;
+    if (occupancy_summary.non_air_count == 0)
+    {
+        min_occupied_y = 0; // Non-uniform but emptied: nothing to emit
+        max_occupied_y = CHUNK_HEIGHT - 1;
+        if (rebuild)
+        {
+            buildSections(data, padded, mode, *rebuild);
+        }
+    }
+    else if (this->lod > 0)
+    {
+        buildDownsampled(data, padded, cell);
+    }
+    else if (rebuild)
+    {
+        buildSections(data, padded, mode, *rebuild);
+    }
+    else
+    {
+        section_min_y = min_occupied_y;
+        section_max_y = max_occupied_y + 1;
+        buildLayers(data, padded, mode);
+        section_min_y = 0;
+        section_max_y = CHUNK_HEIGHT;
+    }
 
     auto loop_end = std::chrono::high_resolution_clock::now();
 
     auto finalize_start = std::chrono::high_resolution_clock::now();
+    // Append the cutout and translucent ranges after the opaque one so a single buffer serves
+    // every pass; each quad draws six pattern indices
+    size_t vertices_per_quad = format == MeshFormat::Faces ? 1 : 4;
+    opaque_index_count = vertices.size() / vertices_per_quad * 6;
+    cutout_index_count = cutout_faces.size() / vertices_per_quad * 6;
+    translucent_index_count = translucent_faces.size() / vertices_per_quad * 6;
+    vertices.insert(vertices.end(), cutout_faces.begin(), cutout_faces.end());
+    vertices.insert(vertices.end(), translucent_faces.begin(), translucent_faces.end());
+    cutout_faces.clear();
+    translucent_faces.clear();
+    groupByDirection();
+
     vertex_count = vertices.size();
-    index_count = indices.size();
     is_built = true;
     is_uploaded = false;
     current_chunk = nullptr;
+    padded_light = nullptr;
+    if (vertices.empty())
+    {
+        releaseCpuData(); // Nothing will be uploaded to release it later
+    }
     auto finalize_end = std::chrono::high_resolution_clock::now();
 
     auto total_end = std::chrono::high_resolution_clock::now();
@@ -171,25 +375,28 @@ void ChunkMesh::buildMesh(const VoxelChunk &chunk)
     float finalize_time = std::chrono::duration<float, std::milli>(finalize_end - finalize_start).count();
     float total_time = std::chrono::duration<float, std::milli>(total_end - total_start).count();
 
-    // Only log if total time is significant - and use thread-safe logging
+    // Slow builds go into the periodic summary; the breakdown is only formatted for debug logging
     if (total_time > 5.0f)
     {
-        // Create a single string to avoid interleaved output
+        Log::recordSlow("mesh builds", total_time);
+    }
+    if (total_time > 5.0f && Log::isEnabled(LogLevel::Debug))
+    {
         std::string log_message =
             "MESH BUILD TIMING for chunk (" + std::to_string(chunk.position.x) + ", " +
-            std::to_string(chunk.position.y) + ", " + std::to_string(chunk.position.z) + "):\n" +
-            "  Solid voxels: " + std::to_string(solid_voxel_count) + "\n" +
+            std::to_string(chunk.position.y) + ", " + std::to_string(chunk.position.z) + ") [" +
+            getMeshingModeName(mode) + ", LOD " + std::to_string(this->lod) + "]:\n" +
+            "  Solid voxels: " + std::to_string(occupancy_summary.non_air_count) + "\n" +
             "  Reserved vertices: " + std::to_string(estimated_vertices) + "\n" +
             "  Setup: " + std::to_string(setup_time) + "ms\n" +
             "  Main Loop: " + std::to_string(loop_time) + "ms\n" +
             "  Finalize: " + std::to_string(finalize_time) + "ms\n" +
             "  TOTAL: " + std::to_string(total_time) + "ms\n" +
-            "  Faces processed: " + std::to_string(faces_processed) + "\n" +
-            "  Neighbor lookups: " + std::to_string(neighbor_lookups) + "\n" +
-            "  Vertices generated: " + std::to_string(vertex_count) + "\n" +
-            "  Indices generated: " + std::to_string(index_count) + "\n";
+            "  Visible faces: " + std::to_string(face_count) + " -> quads: " +
+            std::to_string((opaque_index_count + cutout_index_count + translucent_index_count) / 6) + "\n" +
+            "  Vertices generated: " + std::to_string(vertex_count);
 
-        std::cout << log_message << std::endl;
+        Log::write(LogLevel::Debug, std::move(log_message));
     }
 }
 
@@ -197,12 +404,101 @@ void ChunkMesh::clear()
 {
     // just clear them to avoid reallocations
     vertices.clear();
-    indices.clear();
+    cutout_faces.clear();
+    translucent_faces.clear();
 
     vertex_count = 0;
-    index_count = 0;
+    opaque_index_count = 0;
+    cutout_index_count = 0;
+    translucent_index_count = 0;
+    direction_counts = {};
+    face_count = 0;
+    face_connectivity = FACE_CONNECTIVITY_ALL;
+    min_occupied_y = 0;
+    max_occupied_y = CHUNK_HEIGHT - 1;
+    lod = 0;
+    format = MeshFormat::Indexed;
+    sections.reset();
     is_built = false;
     current_chunk = nullptr;
+    padded_light = nullptr;
+}
+
+void ChunkMesh::markEmpty()
+{
+    clear();
+    is_built = true;
+    is_uploaded = false;
+}
+
+void ChunkMesh::adoptGeometry(ChunkMesh &built)
+{
+    // The worker's mesh is the back buffer: it is discarded afterwards, so a swap is just a
+    // cheap move. The GPU copy of the previous build stays allocated until the upload replaces it
+    vertices.swap(built.vertices);
+    cutout_faces.clear();
+    translucent_faces.clear();
+
+    vertex_count = built.vertex_count;
+    opaque_index_count = built.opaque_index_count;
+    cutout_index_count = built.cutout_index_count;
+    translucent_index_count = built.translucent_index_count;
+    direction_counts = built.direction_counts;
+    face_count = built.face_count;
+    face_connectivity = built.face_connectivity;
+    min_occupied_y = built.min_occupied_y;
+    max_occupied_y = built.max_occupied_y;
+    lod = built.lod;
+    format = built.format;
+    sections = std::move(built.sections);
+    is_built = built.is_built;
+    is_uploaded = false;
+
+    if (built.isInArena())
+    {
+        // Meshed on the GPU: the placement moves over and replaces this mesh's copy at once
+        deleteBuffers();
+        releaseArena();
+        arena = built.arena;
+        arena_vertices = built.arena_vertices;
+        arena_opaque_count = opaque_index_count;
+        arena_cutout_count = cutout_index_count;
+        arena_translucent_count = translucent_index_count;
+        arena_direction_counts = direction_counts;
+        is_uploaded = true;
+        built.arena = nullptr;
+        built.arena_vertices = ArenaRange();
+    }
+}
+
+void ChunkMesh::adoptGpuGeometry(ChunkArena &target, const GpuMeshOutput &output)
+{
+    clear();
+    std::array<size_t, 3> pass_quads{};
+    for (int pass = 0; pass < 3; pass++)
+    {
+        for (int face = 0; face < 6; face++)
+        {
+            direction_counts[pass][face] = output.quad_counts[pass][face] * 6;
+            pass_quads[pass] += output.quad_counts[pass][face];
+        }
+    }
+    opaque_index_count = pass_quads[0] * 6;
+    cutout_index_count = pass_quads[1] * 6;
+    translucent_index_count = pass_quads[2] * 6;
+    size_t quads = pass_quads[0] + pass_quads[1] + pass_quads[2];
+    vertex_count = quads * 4;
+    face_count = quads; // One quad per face, as the naive mesher
+    face_connectivity = output.face_connectivity;
+    min_occupied_y = output.min_occupied_y;
+    max_occupied_y = output.max_occupied_y;
+    is_built = true;
+    is_uploaded = false;
+    if (output.range.isValid())
+    {
+        arena = &target;
+        arena_vertices = output.range;
+    }
 }
 
 void ChunkMesh::uploadToGPU()
@@ -212,53 +508,39 @@ void ChunkMesh::uploadToGPU()
         return;
     }
 
+    PROFILE_ZONE("ChunkMesh::uploadToGPU");
     auto upload_start = std::chrono::high_resolution_clock::now();
 
+    // Moving out of the arena (fallback path)
+    releaseArena();
+
     // Generate buffers if needed
-    if (VAO == 0)
+    RenderBackend &backend = RenderBackend::get();
+    if (vertex_buffer == 0)
     {
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        vertex_buffer = backend.createBuffer();
     }
 
-    // Bind VAO
-    glBindVertexArray(VAO);
-
     auto buffer_upload_start = std::chrono::high_resolution_clock::now();
-    // Upload vertex data
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(VoxelVertex), vertices.data(), GL_STATIC_DRAW);
-
-    // Upload index data
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    // Rewrite existing storage when the new data fits instead of reallocating it
+    size_t vertex_bytes = vertices.size() * sizeof(VoxelVertex);
+    size_t capacity = backend.writeBuffer(vertex_buffer, vertices.data(), vertex_bytes, vbo_capacity);
+    gpu_buffer_bytes += capacity - vbo_capacity;
+    vbo_capacity = capacity;
     auto buffer_upload_end = std::chrono::high_resolution_clock::now();
 
+    // The layout only changes with the mesh format
     auto attrib_setup_start = std::chrono::high_resolution_clock::now();
-    // Set vertex attributes
-    // Position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VoxelVertex), (void *)offsetof(VoxelVertex, position));
-    glEnableVertexAttribArray(0);
-
-    // Normal
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VoxelVertex), (void *)offsetof(VoxelVertex, normal));
-    glEnableVertexAttribArray(1);
-
-    // Texture coordinates
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VoxelVertex), (void *)offsetof(VoxelVertex, texCoord));
-    glEnableVertexAttribArray(2);
-
-    // Texture ID
-    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(VoxelVertex), (void *)offsetof(VoxelVertex, textureId));
-    glEnableVertexAttribArray(3);
-
-    // Debug flag (NEW)
-    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(VoxelVertex), (void *)offsetof(VoxelVertex, debugFlag));
-    glEnableVertexAttribArray(4);
-
-    // Unbind
-    glBindVertexArray(0);
+    if (geometry != 0 && geometry_format != format)
+    {
+        backend.destroyGeometry(geometry);
+        geometry = 0;
+    }
+    if (geometry == 0)
+    {
+        geometry = backend.createGeometry(vertex_buffer, format);
+        geometry_format = format;
+    }
     auto attrib_setup_end = std::chrono::high_resolution_clock::now();
 
     is_uploaded = true;
@@ -270,124 +552,1051 @@ void ChunkMesh::uploadToGPU()
     float attrib_time = std::chrono::duration<float, std::milli>(attrib_setup_end - attrib_setup_start).count();
     float total_upload_time = std::chrono::duration<float, std::milli>(upload_end - upload_start).count();
 
-    if (total_upload_time > 3.0f) // Log uploads that take more than 3ms
+    if (total_upload_time > 3.0f && Log::isEnabled(LogLevel::Debug)) // Uploads that take more than 3ms
     {
-        std::cout << "DETAILED GPU UPLOAD TIMING:" << std::endl;
-        std::cout << "  Buffer upload: " << buffer_time << "ms" << std::endl;
-        std::cout << "  Attribute setup: " << attrib_time << "ms" << std::endl;
-        std::cout << "  Total upload: " << total_upload_time << "ms" << std::endl;
-        std::cout << "  Data size: " << (vertices.size() * sizeof(VoxelVertex) + indices.size() * sizeof(GLuint)) / 1024.0f << " KB" << std::endl;
+        Log::write(LogLevel::Debug, "DETAILED GPU UPLOAD TIMING:\n  Buffer upload: " + std::to_string(buffer_time) +
+                                        "ms\n  Attribute setup: " + std::to_string(attrib_time) +
+                                        "ms\n  Total upload: " + std::to_string(total_upload_time) +
+                                        "ms\n  Data size: " + std::to_string(getUploadBytes() / 1024.0f) + " KB");
     }
+
+    releaseCpuData();
 }
 
-void ChunkMesh::render() const
+void ChunkMesh::writeUploadData(void *destination) const
+{
+    std::memcpy(destination, vertices.data(), vertices.size() * sizeof(VoxelVertex));
+}
+
+bool ChunkMesh::uploadToArena(ChunkArena &target, GLuint staging_buffer, size_t staging_offset)
 {
-    if (!is_uploaded || VAO == 0 || indices.empty())
+    if (!is_built || vertices.empty())
     {
-        return;
+        return false;
+    }
+
+    // The previous copy, in the arena or in its own buffers, is only dropped once the new one
+    // is in place: a failed upload falls back to uploadToGPU without losing it first
+    if (!target.upload(vertices, arena_vertices, staging_buffer, staging_offset))
+    {
+        return false;
     }
+    // A mesh lives either in its own buffers or in the arena, never both
+    deleteBuffers();
 
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    arena = &target;
+    arena_opaque_count = opaque_index_count;
+    arena_cutout_count = cutout_index_count;
+    arena_translucent_count = translucent_index_count;
+    arena_direction_counts = direction_counts;
+    is_uploaded = true;
+    releaseCpuData();
+    return true;
 }
 
-void ChunkMesh::cleanupGL()
+size_t ChunkMesh::queueArenaDraw(ChunkArena &target, MeshPass pass, const glm::vec3 &origin, uint8_t directions) const
+{
+    if (!is_uploaded || !isInArena())
+    {
+        return 0;
+    }
+
+    size_t first_index = getRangeStart(pass, arena_opaque_count, arena_cutout_count);
+    const std::array<uint32_t, 6> &counts = arena_direction_counts[static_cast<int>(pass)];
+    const glm::vec2 layer_range(min_occupied_y - 0.5f, max_occupied_y + 0.5f);
+    if (format == MeshFormat::Faces)
+    {
+        return forEachDirectionRun(counts, first_index, directions, [&](size_t first, size_t count)
+                                   { target.addFaceDraw(arena_vertices.offset + first / 6, count / 6, origin, layer_range); });
+    }
+    return forEachDirectionRun(counts, first_index, directions, [&](size_t first, size_t count)
+                               { target.addDraw(arena_vertices.offset + first / 6 * 4, count / 6, origin, layer_range); });
+}
+
+size_t ChunkMesh::getRangeStart(MeshPass pass, size_t opaque_count, size_t cutout_count) const
+{
+    // Ranges follow MeshPass order
+    size_t first_index = 0;
+    if (pass != MeshPass::Opaque)
+    {
+        first_index += opaque_count;
+    }
+    if (pass == MeshPass::Translucent)
+    {
+        first_index += cutout_count;
+    }
+    return first_index;
+}
+
+size_t ChunkMesh::getCpuMemoryUsage() const
+{
+    size_t bytes = (vertices.capacity() + cutout_faces.capacity() + translucent_faces.capacity()) * sizeof(VoxelVertex);
+    if (sections)
+    {
+        for (const auto &section : sections->sections)
+        {
+            if (!section)
+            {
+                continue;
+            }
+            for (const auto &quads : section->quads)
+            {
+                bytes += quads.capacity() * sizeof(VoxelVertex);
+            }
+        }
+    }
+    return bytes;
+}
+
+size_t ChunkMesh::getIndexCount(MeshPass pass) const
 {
-    if (VAO != 0)
+    switch (pass)
     {
-        glDeleteVertexArrays(1, &VAO);
-        VAO = 0;
+    case MeshPass::Opaque:
+        return opaque_index_count;
+    case MeshPass::Cutout:
+        return cutout_index_count;
+    default:
+        return translucent_index_count;
     }
-    if (VBO != 0)
+}
+
+size_t ChunkMesh::getArenaIndexCount(MeshPass pass) const
+{
+    switch (pass)
     {
-        glDeleteBuffers(1, &VBO);
-        VBO = 0;
+    case MeshPass::Opaque:
+        return arena_opaque_count;
+    case MeshPass::Cutout:
+        return arena_cutout_count;
+    default:
+        return arena_translucent_count;
     }
-    if (EBO != 0)
+}
+
+void ChunkMesh::releaseArena()
+{
+    if (arena != nullptr)
     {
-        glDeleteBuffers(1, &EBO);
-        EBO = 0;
+        arena->release(arena_vertices);
+        arena = nullptr;
     }
+    arena_opaque_count = 0;
+    arena_cutout_count = 0;
+    arena_translucent_count = 0;
+    arena_direction_counts = {};
+}
+
+void ChunkMesh::recycle()
+{
+    releaseArena();
+    clear();
+    releaseCpuData();
+    MeshBufferPool &pool = MeshBufferPool::instance();
+    pool.release(cutout_faces);
+    pool.release(translucent_faces);
     is_uploaded = false;
 }
 
-bool ChunkMesh::shouldRenderFaceOptimized(const VoxelChunk &chunk, int x, int y, int z,
-                                          int face_direction, VoxelID current_voxel) const
-{
-    // Compute neighbor position (face_direction: 0 F,1 B,2 R,3 L,4 T,5 Btm)
-    int nx = x, ny = y, nz = z;
-    switch (face_direction)
-    {
-    case FACE_FRONT:
-        nz++;
-        break;
-    case FACE_BACK:
-        nz--;
-        break;
-    case FACE_RIGHT:
-        nx++;
-        break;
-    case FACE_LEFT:
-        nx--;
-        break;
-    case FACE_TOP:
-        ny++;
-        break;
-    case FACE_BOTTOM:
-        ny--;
-        break;
-    }
-
-    VoxelID neighbor_voxel = chunk.getVoxelSafe(nx, ny, nz);
-    bool current_transparent = VOXEL_INFO[current_voxel].is_transparent;
-    bool neighbor_transparent = VOXEL_INFO[neighbor_voxel].is_transparent;
+void ChunkMesh::render() const
+{
+    const RenderBackend::QuadRun run{0, (opaque_index_count + cutout_index_count + translucent_index_count) / 6};
+    drawRuns(&run, 1);
+}
 
-    // Special handling for water to reduce overdraw:
-    //  - Only show TOP, BOTTOM and SIDE faces when neighbor is AIR
-    //  - Hides side faces against solids and other water -> "slimmer" edges
-    if (current_voxel == VOXEL_WATER)
+size_t ChunkMesh::renderRange(MeshPass pass, uint8_t directions) const
+{
+    if (!is_uploaded || geometry == 0)
     {
-        if (neighbor_voxel == VOXEL_AIR) // only expose to air
-            return true;
-        return false; // neighbor is water or any non-air block
+        return 0;
     }
+    // The selected buckets as one draw list
+    std::array<RenderBackend::QuadRun, 6> runs;
+    size_t run_count = 0;
+    size_t first_index = getRangeStart(pass, opaque_index_count, cutout_index_count);
+    size_t submitted = forEachDirectionRun(direction_counts[static_cast<int>(pass)], first_index, directions,
+                                           [&](size_t first, size_t count) { runs[run_count++] = {first / 6, count / 6}; });
+    drawRuns(runs.data(), run_count);
+    return submitted;
+}
 
-    // Opaque block: render face if neighbor is transparent (air or transparent type)
-    if (!current_transparent)
-        return neighbor_transparent;
+uint8_t ChunkMesh::getFacingDirections(const glm::vec3 &camera_local, int min_y, int max_y)
+{
+    // Face planes lie inside the chunk bounds [-0.5, size - 0.5] on every axis, and between
+    // the occupied layers vertically
+    const glm::vec3 bounds_min(-0.5f, min_y - 0.5f, -0.5f);
+    const glm::vec3 bounds_max(CHUNK_SIZE - 0.5f, max_y + 0.5f, CHUNK_SIZE - 0.5f);
+
+    uint8_t directions = 0;
+    if (camera_local.z > bounds_min.z)
+        directions |= 1 << FACE_FRONT;
+    if (camera_local.z < bounds_max.z)
+        directions |= 1 << FACE_BACK;
+    if (camera_local.x > bounds_min.x)
+        directions |= 1 << FACE_RIGHT;
+    if (camera_local.x < bounds_max.x)
+        directions |= 1 << FACE_LEFT;
+    if (camera_local.y > bounds_min.y)
+        directions |= 1 << FACE_TOP;
+    if (camera_local.y < bounds_max.y)
+        directions |= 1 << FACE_BOTTOM;
+    return directions;
+}
+
+void ChunkMesh::groupByDirection()
+{
+    thread_local std::vector<VoxelVertex> scratch_quads;
 
-    // Transparent (non-water) block: render unless neighbor is same type (remove internal faces)
-    return current_voxel != neighbor_voxel;
+    // Quads keep their build order inside a bucket; a quad is four corners or one record
+    size_t vertices_per_quad = format == MeshFormat::Faces ? 1 : 4;
+    int face_shift = format == MeshFormat::Faces ? 14 : 17;
+    auto faceOf = [face_shift](const VoxelVertex &vertex) { return (vertex.data >> face_shift) & 7u; };
+    size_t first_vertex = 0;
+    for (int pass = 0; pass < 3; pass++)
+    {
+        size_t count = getIndexCount(static_cast<MeshPass>(pass));
+        std::array<uint32_t, 6> &counts = direction_counts[pass];
+        counts.fill(0);
+        if (count == 0)
+        {
+            continue;
+        }
+
+        size_t quads = count / 6;
+        auto begin = vertices.begin() + first_vertex;
+        scratch_quads.assign(begin, begin + quads * vertices_per_quad);
+        for (size_t quad = 0; quad < quads; quad++)
+        {
+            counts[faceOf(scratch_quads[quad * vertices_per_quad])] += 6;
+        }
+        std::array<size_t, 6> next{};
+        for (int face = 1; face < 6; face++)
+        {
+            next[face] = next[face - 1] + counts[face - 1] / 6 * vertices_per_quad;
+        }
+        for (size_t quad = 0; quad < quads; quad++)
+        {
+            auto source = scratch_quads.begin() + quad * vertices_per_quad;
+            size_t &target = next[faceOf(*source)];
+            std::copy(source, source + vertices_per_quad, begin + target);
+            target += vertices_per_quad;
+        }
+        first_vertex += quads * vertices_per_quad;
+    }
 }
 
-void ChunkMesh::addFaceOptimized(const glm::vec3 &position, int face_direction, VoxelID voxel_type, int chunk_x, int chunk_y, int chunk_z)
+void ChunkMesh::drawRuns(const RenderBackend::QuadRun *runs, size_t run_count) const
 {
-    GLuint base_index = static_cast<GLuint>(vertices.size());
+    if (!is_uploaded || geometry == 0)
+    {
+        return;
+    }
+    RenderBackend::get().drawGeometry(geometry, runs, run_count, g_view_count);
+}
 
-    // Optimize texture ID lookup with direct array access
-    float texture_id = 0.0f;
-    if (voxel_type < VOXEL_COUNT)
+std::vector<VoxelVertex> &ChunkMesh::quadsFor(int texture_id)
+{
+    if (isTranslucentTexture(texture_id))
     {
-        const VoxelInfo &info = VOXEL_INFO[voxel_type];
-        texture_id = (face_direction == 4) ? info.texture_top : (face_direction == 5) ? info.texture_bottom
-                                                                                      : info.texture_sides;
+        return translucent_faces;
     }
+    return isAlphaTestedTexture(texture_id) ? cutout_faces : vertices;
+}
 
-    // Simplified debug flag (remove for production)
-    float debug_flag = 0.0f;
+void ChunkMesh::addFaceRecords(const glm::ivec3 &min, const glm::ivec3 &max, int face_direction, int texture_id, int light)
+{
+    // In-plane axes of the record layout (see VoxelVertex::faceRecord)
+    int u_axis = face_direction == FACE_RIGHT || face_direction == FACE_LEFT ? 2 : 0;
+    int v_axis = face_direction == FACE_TOP || face_direction == FACE_BOTTOM ? 2 : 1;
+    int n_axis = 3 - u_axis - v_axis;
 
-    // Pre-calculate vertex data to avoid repeated calculations
-    const glm::vec3 *face_verts = FACE_VERTICES[face_direction];
-    const glm::vec3 &normal = FACE_NORMALS[face_direction];
+    // A record spans one voxel along the normal: keep the layer the face lies on (LOD cells
+    // are thicker than that; front/right/top faces are on their max side)
+    bool positive = face_direction == FACE_FRONT || face_direction == FACE_RIGHT || face_direction == FACE_TOP;
+    glm::ivec3 layer = min;
+    layer[n_axis] = positive ? max[n_axis] : min[n_axis];
 
-    // Add vertices directly without temporary objects
-    vertices.emplace_back(position + face_verts[0], normal, FACE_TEX_COORDS[0], texture_id, debug_flag);
-    vertices.emplace_back(position + face_verts[1], normal, FACE_TEX_COORDS[1], texture_id, debug_flag);
-    vertices.emplace_back(position + face_verts[2], normal, FACE_TEX_COORDS[2], texture_id, debug_flag);
-    vertices.emplace_back(position + face_verts[3], normal, FACE_TEX_COORDS[3], texture_id, debug_flag);
+    // Quads longer than the extent bits split into several records
+    std::vector<VoxelVertex> &target = quadsFor(texture_id);
+    for (int u = min[u_axis]; u <= max[u_axis]; u += VoxelVertex::MAX_RECORD_EXTENT_U)
+    {
+        for (int v = min[v_axis]; v <= max[v_axis]; v += VoxelVertex::MAX_RECORD_EXTENT_V)
+        {
+            glm::ivec3 start = layer;
+            start[u_axis] = u;
+            start[v_axis] = v;
+            int extent_u = std::min(max[u_axis] - u + 1, VoxelVertex::MAX_RECORD_EXTENT_U);
+            int extent_v = std::min(max[v_axis] - v + 1, VoxelVertex::MAX_RECORD_EXTENT_V);
+            target.push_back(VoxelVertex::faceRecord(start.x, start.y, start.z, face_direction, texture_id, extent_u, extent_v, light));
+        }
+    }
+}
 
-    // Add indices in one go
-    indices.insert(indices.end(), {base_index + 0, base_index + 1, base_index + 2,
-                                   base_index + 2, base_index + 3, base_index + 0});
+void ChunkMesh::cleanupGL()
+{
+    deleteBuffers();
+    releaseArena();
+    is_uploaded = false;
+}
+
+void ChunkMesh::deleteBuffers()
+{
+    RenderBackend &backend = RenderBackend::get();
+    if (geometry != 0)
+    {
+        backend.destroyGeometry(geometry);
+        geometry = 0;
+    }
+    if (vertex_buffer != 0)
+    {
+        backend.destroyBuffer(vertex_buffer);
+        vertex_buffer = 0;
+        gpu_buffer_bytes -= vbo_capacity;
+        vbo_capacity = 0;
+    }
+}
+
+bool ChunkMesh::isFaceVisible(VoxelID current_voxel, VoxelID neighbor_voxel)
+{
+    const BlockRegistry &blocks = BlockRegistry::get();
+    uint8_t current_flags = blocks.getFlags(current_voxel);
+    bool current_transparent = (current_flags & BlockRegistry::FLAG_TRANSPARENT) != 0;
+    bool neighbor_transparent = isVoxelTransparent(neighbor_voxel);
+
+    // Special handling for water to reduce overdraw:
+    //  - Only show TOP, BOTTOM and SIDE faces when neighbor is AIR
+    //  - Hides side faces against solids and other water -> "slimmer" edges
+    if (current_voxel == VOXEL_WATER)
+    {
+        if (neighbor_voxel == VOXEL_AIR) // only expose to air
+            return true;
+        return false; // neighbor is water or any non-air block
+    }
+
+    // Opaque block: render face if neighbor is transparent (air or transparent type)
+    if (!current_transparent)
+        return neighbor_transparent;
+
+    // Transparent (non-water) block: render unless neighbor is same type (remove internal
+    // faces), for the types that cull them
+    return current_voxel != neighbor_voxel || (current_flags & BlockRegistry::FLAG_CULLS_SAME) == 0;
+}
+
+int ChunkMesh::faceLight(int x, int y, int z) const
+{
+    return getCombinedLight(padded_light[ChunkSnapshot::paddedIndex(x, y, z)]);
+}
+
+int ChunkMesh::faceOcclusion(const VoxelID *padded, const glm::ivec3 &across, int face_direction) const
+{
+    if (!bake_occlusion)
+    {
+        return VoxelVertex::UNOCCLUDED;
+    }
+
+    auto occludes = [padded](const glm::ivec3 &p)
+    { return !isVoxelTransparent(padded[ChunkSnapshot::paddedIndex(p.x, p.y, p.z)]) ? 1 : 0; };
+
+    // In-plane neighbors of `across` stay inside the padded copy: faces belong to interior voxels
+    const glm::ivec3 &normal = ::FACE_NORMALS[face_direction];
+    int occlusion = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        // Step towards the corner along each in-plane axis
+        glm::ivec3 side_a(0), side_b(0);
+        bool first_axis = true;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (normal[axis] == 0)
+            {
+                (first_axis ? side_a : side_b)[axis] = FACE_VERTICES[face_direction][i][axis] > 0.0f ? 1 : -1;
+                first_axis = false;
+            }
+        }
+
+        int a = occludes(across + side_a);
+        int b = occludes(across + side_b);
+        int level = (a && b) ? 0 : 3 - a - b - occludes(across + side_a + side_b); // Both sides hide the diagonal
+        occlusion |= level << (2 * i);
+    }
+    return occlusion;
+}
+
+int ChunkMesh::firstCorner(int occlusion)
+{
+    int corner_sum_02 = (occlusion & 3) + ((occlusion >> 4) & 3);
+    int corner_sum_13 = ((occlusion >> 2) & 3) + ((occlusion >> 6) & 3);
+    return corner_sum_02 >= corner_sum_13 ? 0 : 1;
+}
+
+void ChunkMesh::addFaceOptimized(int face_direction, VoxelID voxel_type, int chunk_x, int chunk_y, int chunk_z,
+                                 int light, int occlusion)
+{
+    int texture_id = static_cast<int>(getFaceTextureId(voxel_type, face_direction));
+    if (format == MeshFormat::Faces)
+    {
+        quadsFor(texture_id).push_back(VoxelVertex::faceRecord(chunk_x, chunk_y, chunk_z, face_direction, texture_id, 1, 1, light));
+        return;
+    }
+
+    // Template corners are +-0.5 around the voxel center, i.e. the voxel or the next lattice point
+    std::vector<VoxelVertex> &target = quadsFor(texture_id);
+    const glm::vec3 *face_verts = FACE_VERTICES[face_direction];
+    int first = firstCorner(occlusion);
+    for (int n = 0; n < 4; n++)
+    {
+        int i = (first + n) & 3;
+        target.emplace_back(chunk_x + (face_verts[i].x > 0.0f), chunk_y + (face_verts[i].y > 0.0f),
+                            chunk_z + (face_verts[i].z > 0.0f), face_direction, texture_id, light, (occlusion >> (2 * i)) & 3);
+    }
+}
+
+float ChunkMesh::getFaceTextureId(VoxelID voxel_type, int face_direction)
+{
+    return static_cast<float>(BlockRegistry::get().getFaceTexture(voxel_type, face_direction));
+}
+
+void ChunkMesh::buildLayers(const VoxelID *data, const VoxelID *padded, MeshingMode mode)
+{
+    if (mode == MeshingMode::Greedy)
+    {
+        buildGreedy(data, padded);
+    }
+    else if (mode == MeshingMode::Binary || mode == MeshingMode::BinaryGreedy)
+    {
+        buildBinary(data, padded, mode == MeshingMode::BinaryGreedy);
+    }
+    else
+    {
+        buildNaive(data, padded);
+    }
+}
+
+void ChunkMesh::buildNaive(const VoxelID *data, const VoxelID *padded)
+{
+    auto idx = [](int x, int y, int z)
+    { return ChunkIndexing::index(x, y, z); };
+
+    for (int x = 0; x < CHUNK_SIZE; ++x)
+        for (int y = section_min_y; y < section_max_y; ++y)
+            for (int z = 0; z < CHUNK_SIZE; ++z)
+            {
+                VoxelID voxel = data[idx(x, y, z)];
+                if (voxel == VOXEL_AIR)
+                    continue;
+
+
+                auto emitFaceIfVisible = [&](int nx, int ny, int nz, int faceDir)
+                {
+                    VoxelID neighborVoxel = padded[ChunkSnapshot::paddedIndex(nx, ny, nz)];
+                    if (isFaceVisible(voxel, neighborVoxel))
+                    {
+                        addFaceOptimized(faceDir, voxel, x, y, z, faceLight(nx, ny, nz),
+                                         faceOcclusion(padded, glm::ivec3(nx, ny, nz), faceDir));
+                        face_count++;
+                    }
+                };
+
+                emitFaceIfVisible(x, y, z + 1, FACE_FRONT);
+                emitFaceIfVisible(x, y, z - 1, FACE_BACK);
+                emitFaceIfVisible(x + 1, y, z, FACE_RIGHT);
+                emitFaceIfVisible(x - 1, y, z, FACE_LEFT);
+                emitFaceIfVisible(x, y + 1, z, FACE_TOP);
+                emitFaceIfVisible(x, y - 1, z, FACE_BOTTOM);
+            }
+}
+
+void ChunkMesh::buildSections(const VoxelID *data, const VoxelID *padded, MeshingMode mode, const MeshSectionRebuild &rebuild)
+{
+    const MeshSections *previous = rebuild.previous.get();
+    bool can_reuse = previous && previous->mode == mode && previous->format == format;
+
+    auto built = std::make_shared<MeshSections>();
+    built->mode = mode;
+    built->format = format;
+    for (int section = 0; section < MESH_SECTION_COUNT; section++)
+    {
+        if (can_reuse && !(rebuild.dirty_sections & (1u << section)) && previous->sections[section])
+        {
+            built->sections[section] = previous->sections[section];
+            continue;
+        }
+
+        face_count = 0;
+        section_min_y = std::max(section * MESH_SECTION_HEIGHT, occupancy->min_y);
+        section_max_y = std::min((section + 1) * MESH_SECTION_HEIGHT, occupancy->max_y + 1);
+        if (section_min_y < section_max_y)
+        {
+            buildLayers(data, padded, mode);
+        }
+
+        auto geometry = std::make_shared<MeshSectionGeometry>();
+        captureSection(*geometry);
+        built->sections[section] = std::move(geometry);
+    }
+    section_min_y = 0;
+    section_max_y = CHUNK_HEIGHT;
+
+    // Same layout a whole-chunk build leaves behind for buildMesh to finish
+    face_count = 0;
+    for (const auto &section : built->sections)
+    {
+        appendSection(*section);
+    }
+    sections = std::move(built);
+}
+
+void ChunkMesh::captureSection(MeshSectionGeometry &section)
+{
+    section.quads[0].assign(vertices.begin(), vertices.end());
+    section.quads[1].assign(cutout_faces.begin(), cutout_faces.end());
+    section.quads[2].assign(translucent_faces.begin(), translucent_faces.end());
+    section.face_count = face_count;
+
+    vertices.clear();
+    cutout_faces.clear();
+    translucent_faces.clear();
+}
+
+void ChunkMesh::appendSection(const MeshSectionGeometry &section)
+{
+    // Quads need no rebasing: the shared pattern indexes them relative to where they land
+    face_count += section.face_count;
+    vertices.insert(vertices.end(), section.quads[0].begin(), section.quads[0].end());
+    cutout_faces.insert(cutout_faces.end(), section.quads[1].begin(), section.quads[1].end());
+    translucent_faces.insert(translucent_faces.end(), section.quads[2].begin(), section.quads[2].end());
+}
+
+uint32_t ChunkMesh::greedyKey(int texture_id, int light, int occlusion)
+{
+    return static_cast<uint32_t>(texture_id + 1) | (static_cast<uint32_t>(light) << 8) | (static_cast<uint32_t>(occlusion) << 12);
+}
+
+void ChunkMesh::buildGreedy(const VoxelID *data, const VoxelID *padded)
+{
+    const glm::ivec3 lo(0, section_min_y, 0);
+    const glm::ivec3 hi(CHUNK_SIZE, section_max_y, CHUNK_SIZE);
+
+    auto idx = [](int x, int y, int z)
+    { return ChunkIndexing::index(x, y, z); };
+
+    // Mask entries hold the greedyKey of a visible face (0 = no face)
+    std::vector<uint32_t> mask;
+
+    for (int face = 0; face < 6; face++)
+    {
+        glm::ivec3 normal = ::FACE_NORMALS[face];
+        int n_axis = normal.x != 0 ? 0 : (normal.y != 0 ? 1 : 2);
+        int u_axis = (n_axis + 1) % 3;
+        int v_axis = (n_axis + 2) % 3;
+        int du = hi[u_axis] - lo[u_axis];
+        int dv = hi[v_axis] - lo[v_axis];
+        mask.assign(du * dv, 0);
+
+        for (int slice = lo[n_axis]; slice < hi[n_axis]; slice++)
+        {
+            // Build the visibility mask for this slice
+            bool any_face = false;
+            for (int v = 0; v < dv; v++)
+            {
+                for (int u = 0; u < du; u++)
+                {
+                    glm::ivec3 p;
+                    p[n_axis] = slice;
+                    p[u_axis] = lo[u_axis] + u;
+                    p[v_axis] = lo[v_axis] + v;
+
+                    uint32_t key = 0;
+                    VoxelID voxel = data[idx(p.x, p.y, p.z)];
+                    if (voxel != VOXEL_AIR)
+                    {
+                        glm::ivec3 np = p + normal;
+                        VoxelID neighbor = padded[ChunkSnapshot::paddedIndex(np.x, np.y, np.z)];
+                        if (isFaceVisible(voxel, neighbor))
+                        {
+                            key = greedyKey(static_cast<int>(getFaceTextureId(voxel, face)), faceLight(np.x, np.y, np.z),
+                                            faceOcclusion(padded, np, face));
+                            face_count++;
+                            any_face = true;
+                        }
+                    }
+                    mask[u + v * du] = key;
+                }
+            }
+
+            if (!any_face)
+            {
+                continue;
+            }
+
+            greedyMergeSlice(mask, du, dv, n_axis, u_axis, v_axis, slice, face, lo);
+        }
+    }
+}
+
+void ChunkMesh::greedyMergeSlice(std::vector<uint32_t> &mask, int du, int dv, int n_axis, int u_axis, int v_axis, int slice, int face,
+                                 const glm::ivec3 &origin)
+{
+    // Merge runs of equal keys (texture, light and occlusion) into rectangles, clearing the mask as we go
+    for (int v = 0; v < dv; v++)
+    {
+        for (int u = 0; u < du;)
+        {
+            uint32_t key = mask[u + v * du];
+            if (key == 0)
+            {
+                u++;
+                continue;
+            }
+
+            int width = 1;
+            while (u + width < du && mask[u + width + v * du] == key)
+            {
+                width++;
+            }
+
+            int height = 1;
+            bool can_grow = true;
+            while (v + height < dv && can_grow)
+            {
+                for (int k = 0; k < width; k++)
+                {
+                    if (mask[u + k + (v + height) * du] != key)
+                    {
+                        can_grow = false;
+                        break;
+                    }
+                }
+                if (can_grow)
+                {
+                    height++;
+                }
+            }
+
+            glm::ivec3 quad_min, quad_max;
+            quad_min[n_axis] = quad_max[n_axis] = slice;
+            quad_min[u_axis] = origin[u_axis] + u;
+            quad_max[u_axis] = origin[u_axis] + u + width - 1;
+            quad_min[v_axis] = origin[v_axis] + v;
+            quad_max[v_axis] = origin[v_axis] + v + height - 1;
+            addQuad(quad_min, quad_max, face, static_cast<float>((key & 0xFF) - 1), (key >> 8) & 15, key >> 12);
+
+            for (int h = 0; h < height; h++)
+            {
+                for (int k = 0; k < width; k++)
+                {
+                    mask[u + k + (v + h) * du] = 0;
+                }
+            }
+            u += width;
+        }
+    }
+}
+
+void ChunkMesh::buildBinary(const VoxelID *data, const VoxelID *padded, bool greedy)
+{
+    static_assert(CHUNK_HEIGHT == 64, "Binary mesher packs one column into a 64-bit mask");
+
+    constexpr int PADDED = CHUNK_SIZE + 2;
+    constexpr int COLUMNS = PADDED * PADDED;
+    auto col = [](int x, int z)
+    { return (x + 1) * PADDED + (z + 1); };
+    auto idx = [](int x, int y, int z)
+    { return ChunkIndexing::index(x, y, z); };
+
+    // Per-type column masks over the padded footprint, plus the voxel just above/below each
+    // interior column (from the vertical neighbors or terrain prediction)
+    const BlockRegistry &blocks = BlockRegistry::get();
+    const int type_count = blocks.getTypeCount();
+    thread_local std::array<std::array<uint64_t, COLUMNS>, BlockRegistry::MAX_TYPES> type_masks;
+    thread_local std::array<uint64_t, COLUMNS> opaque_masks;
+    thread_local std::array<VoxelID, COLUMNS> above_voxels;
+    thread_local std::array<VoxelID, COLUMNS> below_voxels;
+
+    for (auto &masks : type_masks)
+    {
+        masks.fill(0);
+    }
+
+    uint32_t present_types = 0; // Types present inside the chunk (bit per VoxelID)
+    for (int x = -1; x <= CHUNK_SIZE; x++)
+    {
+        for (int z = -1; z <= CHUNK_SIZE; z++)
+        {
+            bool border_x = x < 0 || x == CHUNK_SIZE;
+            bool border_z = z < 0 || z == CHUNK_SIZE;
+            if (border_x && border_z)
+            {
+                continue; // Corners are never face neighbors
+            }
+
+            int c = col(x, z);
+            if (!border_x && !border_z)
+            {
+                above_voxels[c] = padded[ChunkSnapshot::paddedIndex(x, CHUNK_HEIGHT, z)];
+                below_voxels[c] = padded[ChunkSnapshot::paddedIndex(x, -1, z)];
+                int summary_column = ChunkOccupancy::columnIndex(x, z);
+                if ((occupancy->opaque_columns[summary_column] | occupancy->transparent_columns[summary_column]) == 0)
+                {
+                    // All air: no need to walk it
+                    type_masks[VOXEL_AIR][c] = ~uint64_t(0);
+                    present_types |= 1u << VOXEL_AIR;
+                    continue;
+                }
+
+                const VoxelID *column = data + idx(x, 0, z);
+                for (int y = 0; y < CHUNK_HEIGHT; y++)
+                {
+                    int voxel = BlockRegistry::slot(column[ChunkIndexing::offsetY(y)]);
+                    type_masks[voxel][c] |= uint64_t(1) << y;
+                    present_types |= 1u << voxel;
+                }
+            }
+            else
+            {
+                for (int y = 0; y < CHUNK_HEIGHT; y++)
+                {
+                    int voxel = BlockRegistry::slot(padded[ChunkSnapshot::paddedIndex(x, y, z)]);
+                    type_masks[voxel][c] |= uint64_t(1) << y;
+                }
+            }
+        }
+    }
+
+    // Opacity masks combine every non-transparent type
+    opaque_masks.fill(0);
+    for (int type = 0; type < type_count; type++)
+    {
+        if (isVoxelTransparent(static_cast<VoxelID>(type)))
+        {
+            continue;
+        }
+        for (int c = 0; c < COLUMNS; c++)
+        {
+            opaque_masks[c] |= type_masks[type][c];
+        }
+    }
+
+    // Neighbor mask of `masks` for an interior column in a face direction. Vertical faces shift
+    // the column and pull in the boundary bit from the voxel above/below.
+    auto neighborMask = [&](const std::array<uint64_t, COLUMNS> &masks, int x, int z, int face, bool above_set, bool below_set) -> uint64_t
+    {
+        switch (face)
+        {
+        case FACE_FRONT:
+            return masks[col(x, z + 1)];
+        case FACE_BACK:
+            return masks[col(x, z - 1)];
+        case FACE_RIGHT:
+            return masks[col(x + 1, z)];
+        case FACE_LEFT:
+            return masks[col(x - 1, z)];
+        case FACE_TOP:
+            return (masks[col(x, z)] >> 1) | (uint64_t(above_set) << 63);
+        default:
+            return (masks[col(x, z)] << 1) | uint64_t(below_set);
+        }
+    };
+
+    const glm::ivec3 lo(0, section_min_y, 0);
+    const glm::ivec3 hi(CHUNK_SIZE, section_max_y, CHUNK_SIZE);
+    std::vector<uint32_t> slice_mask;
+
+    // Faces are only emitted for voxels in [section_min_y, section_max_y)
+    uint64_t layer_bits = (~uint64_t(0) >> (CHUNK_HEIGHT - (section_max_y - section_min_y))) << section_min_y;
+
+    // Visible face bits per interior column and present type, for one face direction at a time
+    thread_local std::array<std::array<uint64_t, CHUNK_SIZE * CHUNK_SIZE>, BlockRegistry::MAX_TYPES> visible;
+
+    for (int face = 0; face < 6; face++)
+    {
+        uint32_t face_types = 0;
+        for (int type = 1; type < type_count; type++)
+        {
+            if (!(present_types & (1u << type)))
+            {
+                continue;
+            }
+
+            bool is_water = type == VOXEL_WATER;
+            uint8_t type_flags = blocks.getFlags(static_cast<VoxelID>(type));
+            bool is_opaque = (type_flags & BlockRegistry::FLAG_TRANSPARENT) == 0;
+            bool culls_same = (type_flags & BlockRegistry::FLAG_CULLS_SAME) != 0;
+            uint64_t any = 0;
+
+            for (int x = 0; x < CHUNK_SIZE; x++)
+            {
+                for (int z = 0; z < CHUNK_SIZE; z++)
+                {
+                    int c = col(x, z);
+                    uint64_t self = type_masks[type][c];
+                    uint64_t bits = 0;
+                    if (self != 0)
+                    {
+                        VoxelID above = above_voxels[c];
+                        VoxelID below = below_voxels[c];
+                        if (is_opaque)
+                        {
+                            // Opaque: visible against any transparent neighbor
+                            bits = self & ~neighborMask(opaque_masks, x, z, face,
+                                                        !isVoxelTransparent(above), !isVoxelTransparent(below));
+                        }
+                        else if (is_water)
+                        {
+                            // Water: only faces exposed to air
+                            bits = self & neighborMask(type_masks[VOXEL_AIR], x, z, face, above == VOXEL_AIR, below == VOXEL_AIR);
+                        }
+                        else if (culls_same)
+                        {
+                            // Other transparent blocks: hide faces between equal types
+                            bits = self & ~neighborMask(type_masks[type], x, z, face, above == type, below == type);
+                        }
+                        else
+                        {
+                            bits = self;
+                        }
+                    }
+                    bits &= layer_bits;
+                    visible[type][x * CHUNK_SIZE + z] = bits;
+                    any |= bits;
+                }
+            }
+
+            if (any != 0)
+            {
+                face_types |= 1u << type;
+            }
+        }
+
+        if (face_types == 0)
+        {
+            continue;
+        }
+
+        if (!greedy)
+        {
+            // Emit one quad per set bit
+            for (int type = 1; type < type_count; type++)
+            {
+                if (!(face_types & (1u << type)))
+                {
+                    continue;
+                }
+                for (int x = 0; x < CHUNK_SIZE; x++)
+                {
+                    for (int z = 0; z < CHUNK_SIZE; z++)
+                    {
+                        uint64_t bits = visible[type][x * CHUNK_SIZE + z];
+                        while (bits)
+                        {
+                            int y = countTrailingZeros64(bits);
+                            bits &= bits - 1;
+                            glm::ivec3 across = glm::ivec3(x, y, z) + ::FACE_NORMALS[face];
+                            addFaceOptimized(face, static_cast<VoxelID>(type), x, y, z,
+                                             faceLight(across.x, across.y, across.z), faceOcclusion(padded, across, face));
+                            face_count++;
+                        }
+                    }
+                }
+            }
+            continue;
+        }
+
+        // Greedy: rebuild per-slice texture masks from the visible bits and merge
+        glm::ivec3 normal = ::FACE_NORMALS[face];
+        int n_axis = normal.x != 0 ? 0 : (normal.y != 0 ? 1 : 2);
+        int u_axis = (n_axis + 1) % 3;
+        int v_axis = (n_axis + 2) % 3;
+        int du = hi[u_axis] - lo[u_axis];
+        int dv = hi[v_axis] - lo[v_axis];
+        slice_mask.assign(du * dv, 0);
+
+        for (int slice = lo[n_axis]; slice < hi[n_axis]; slice++)
+        {
+            bool any_face = false;
+            for (int v = 0; v < dv; v++)
+            {
+                for (int u = 0; u < du; u++)
+                {
+                    glm::ivec3 p;
+                    p[n_axis] = slice;
+                    p[u_axis] = lo[u_axis] + u;
+                    p[v_axis] = lo[v_axis] + v;
+
+                    uint32_t key = 0;
+                    uint64_t bit = uint64_t(1) << p.y;
+                    int column = p.x * CHUNK_SIZE + p.z;
+                    for (int type = 1; type < type_count; type++)
+                    {
+                        if ((face_types & (1u << type)) && (visible[type][column] & bit))
+                        {
+                            glm::ivec3 across = p + normal;
+                            key = greedyKey(static_cast<int>(getFaceTextureId(static_cast<VoxelID>(type), face)),
+                                            faceLight(across.x, across.y, across.z), faceOcclusion(padded, across, face));
+                            face_count++;
+                            any_face = true;
+                            break;
+                        }
+                    }
+                    slice_mask[u + v * du] = key;
+                }
+            }
+
+            if (any_face)
+            {
+                greedyMergeSlice(slice_mask, du, dv, n_axis, u_axis, v_axis, slice, face, lo);
+            }
+        }
+    }
+}
+
+void ChunkMesh::buildDownsampled(const VoxelID *data, const VoxelID *padded, int cell)
+{
+    const int cells_x = CHUNK_SIZE / cell;
+    const int cells_y = CHUNK_HEIGHT / cell;
+    const int cells_z = CHUNK_SIZE / cell;
+    const int cell_volume = cell * cell * cell;
+
+    auto idx = [](int x, int y, int z)
+    { return ChunkIndexing::index(x, y, z); };
+    auto cellIndex = [&](int cx, int cy, int cz)
+    { return (cx * cells_y + cy) * cells_z + cz; };
+
+    // Each cell takes the majority type of its voxels. Voxels with air above vote once per
+    // voxel of cell height, so surface blocks (grass, sand) keep the terrain's colour.
+    // Interior cells need at least half their voxels filled. Cells on the chunk boundary
+    // turn solid if any voxel is: they then cover everything the real voxels cover, so
+    // a neighbor at a different level that culled a face against them never shows a gap.
+    thread_local std::vector<VoxelID> cells;
+    cells.assign(static_cast<size_t>(cells_x * cells_y * cells_z), VOXEL_AIR);
+
+    // Cells outside the occupied layers stay air
+    const int first_cell_y = occupancy->min_y / cell;
+    const int last_cell_y = occupancy->max_y / cell;
+
+    for (int cx = 0; cx < cells_x; cx++)
+        for (int cy = first_cell_y; cy <= last_cell_y; cy++)
+            for (int cz = 0; cz < cells_z; cz++)
+            {
+                std::array<int, BlockRegistry::MAX_TYPES> votes{};
+                int filled = 0;
+                for (int dx = 0; dx < cell; dx++)
+                    for (int dy = 0; dy < cell; dy++)
+                        for (int dz = 0; dz < cell; dz++)
+                        {
+                            int x = cx * cell + dx, y = cy * cell + dy, z = cz * cell + dz;
+                            VoxelID voxel = data[idx(x, y, z)];
+                            if (voxel == VOXEL_AIR || !BlockRegistry::get().isRegistered(voxel))
+                            {
+                                continue;
+                            }
+                            bool exposed = y + 1 == CHUNK_HEIGHT || data[idx(x, y + 1, z)] == VOXEL_AIR;
+                            votes[voxel] += exposed ? cell : 1;
+                            filled++;
+                        }
+
+                bool boundary = cx == 0 || cy == 0 || cz == 0 ||
+                                cx == cells_x - 1 || cy == cells_y - 1 || cz == cells_z - 1;
+                if (filled == 0 || (!boundary && filled * 2 < cell_volume))
+                {
+                    continue;
+                }
+
+                VoxelID majority = VOXEL_AIR;
+                for (int type = 1; type < BlockRegistry::MAX_TYPES; type++)
+                {
+                    if (votes[type] > votes[majority])
+                    {
+                        majority = static_cast<VoxelID>(type);
+                    }
+                }
+                cells[cellIndex(cx, cy, cz)] = majority;
+            }
+
+    for (int cx = 0; cx < cells_x; cx++)
+        for (int cy = first_cell_y; cy <= last_cell_y; cy++)
+            for (int cz = 0; cz < cells_z; cz++)
+            {
+                VoxelID voxel = cells[cellIndex(cx, cy, cz)];
+                if (voxel == VOXEL_AIR)
+                {
+                    continue;
+                }
+
+                glm::ivec3 min(cx * cell, cy * cell, cz * cell);
+                glm::ivec3 max = min + glm::ivec3(cell - 1);
+                for (int face = 0; face < 6; face++)
+                {
+                    glm::ivec3 normal = ::FACE_NORMALS[face];
+                    int nx = cx + normal.x, ny = cy + normal.y, nz = cz + normal.z;
+
+                    // The voxel layer across the face
+                    glm::ivec3 lo = min, hi = max;
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        if (normal[axis] != 0)
+                        {
+                            lo[axis] = hi[axis] = normal[axis] > 0 ? max[axis] + 1 : min[axis] - 1;
+                        }
+                    }
+
+                    bool visible = false;
+                    if (nx >= 0 && nx < cells_x && ny >= 0 && ny < cells_y && nz >= 0 && nz < cells_z)
+                    {
+                        visible = isFaceVisible(voxel, cells[cellIndex(nx, ny, nz)]);
+                    }
+                    else
+                    {
+                        // Chunk border: the neighbor may be at any level, so test its real
+                        // voxels across the face and show the whole face if any exposes it
+                        for (int x = lo.x; x <= hi.x && !visible; x++)
+                            for (int y = lo.y; y <= hi.y && !visible; y++)
+                                for (int z = lo.z; z <= hi.z && !visible; z++)
+                                {
+                                    visible = isFaceVisible(voxel, padded[ChunkSnapshot::paddedIndex(x, y, z)]);
+                                }
+                    }
+
+                    if (visible)
+                    {
+                        // Lit by the brightest voxel across: cells stand in for voxels that may be solid
+                        int light = 0;
+                        for (int x = lo.x; x <= hi.x; x++)
+                            for (int y = lo.y; y <= hi.y; y++)
+                                for (int z = lo.z; z <= hi.z; z++)
+                                {
+                                    light = std::max(light, faceLight(x, y, z));
+                                }
+                        addQuad(min, max, face, getFaceTextureId(voxel, face), light);
+                        face_count += static_cast<size_t>(cell * cell); // Voxel faces the quad stands in for
+                    }
+                }
+            }
+}
+
+void ChunkMesh::addQuad(const glm::ivec3 &min, const glm::ivec3 &max, int face_direction, float texture_id, int light, int occlusion)
+{
+    if (format == MeshFormat::Faces)
+    {
+        addFaceRecords(min, max, face_direction, static_cast<int>(texture_id), light);
+        return;
+    }
+
+    std::vector<VoxelVertex> &target = quadsFor(static_cast<int>(texture_id));
+    const glm::vec3 *face_verts = FACE_VERTICES[face_direction];
+
+    // Stretch the unit face template over the box: -0.5 corners snap to min, +0.5 to max + 1,
+    // which keeps the template's winding order. The shader tiles UVs per voxel from position.
+    int first = firstCorner(occlusion);
+    for (int n = 0; n < 4; n++)
+    {
+        int i = (first + n) & 3;
+        glm::ivec3 corner;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            corner[axis] = face_verts[i][axis] < 0.0f ? min[axis] : max[axis] + 1;
+        }
+        target.emplace_back(corner.x, corner.y, corner.z, face_direction, static_cast<int>(texture_id), light,
+                            (occlusion >> (2 * i)) & 3);
+    }
 }
@@ -2,61 +2,283 @@
 #define CHUNK_MESH_H
 
 #include "voxel_types.h"
+#include "voxel_light.h"
+#include "chunk_arena.h"
+#include "render_backend.h"
 #include <glm/glm/glm.hpp>
+#include <array>
+#include <atomic>
+#include <memory>
 #include <vector>
+#include <mutex>
 #include <glad/glad/glad.h>
 
 // Forward declaration
-class VoxelChunk;
+class ChunkSnapshot;
+struct ChunkOccupancy;
+struct GpuMeshOutput;
 
-// Vertex structure for voxel rendering
+// Mesher selection (switchable at runtime through ChunkMesh::setMeshingMode)
+enum class MeshingMode
+{
+    Naive = 0,        // One quad per visible voxel face
+    Greedy = 1,       // Coplanar faces with the same texture and light merged into larger quads
+    Binary = 2,       // Visibility from 64-bit column masks, one quad per face
+    BinaryGreedy = 3, // Column-mask visibility feeding the greedy merger
+    Count
+};
+
+const char *getMeshingModeName(MeshingMode mode);
+
+// Geometry layout buildMesh emits (switchable at runtime through ChunkMesh::setMeshFormat)
+enum class MeshFormat
+{
+    Indexed = 0, // Four VoxelVertex corners per quad, drawn through the shared quad pattern
+    Faces = 1,   // One face record per quad, expanded to corners in the vertex shader
+    Count
+};
+
+const char *getMeshFormatName(MeshFormat format);
+
+// Texture unit MeshFormat::Faces draws read their records from (0: block textures, 1: Hi-Z)
+constexpr GLint FACE_RECORD_TEXTURE_UNIT = 2;
+// Quads the shared 16-bit quad index pattern covers (vertex ids up to 65535); draws of more
+// quads are split into several of at most this many
+constexpr size_t QUAD_PATTERN_QUADS = 16384;
+// Generic value of vertex attribute 0 while no array feeds it: voxel.vs then pulls face records
+constexpr GLuint FACE_RECORD_SENTINEL = 0x80000000u;
+
+// Direction masks: one bit per FaceDirection (voxel_chunk.h)
+constexpr uint8_t ALL_FACE_DIRECTIONS = 0x3F;
+
+// Quad ranges of a mesh, stored in this order in one vertex buffer. Inside each range the
+// quads are grouped by face direction, so back-facing directions can be skipped as a whole.
+enum class MeshPass
+{
+    Opaque = 0,      // Fully opaque textures (no alpha test)
+    Cutout = 1,      // Alpha-tested textures (leaves, glass)
+    Translucent = 2, // Blended water
+};
+
+// Coarsest detail level buildMesh accepts; level n meshes cells of 2^n voxels per axis
+constexpr int MAX_MESH_LOD = 2;
+static_assert(CHUNK_SIZE % (1 << MAX_MESH_LOD) == 0 && CHUNK_HEIGHT % (1 << MAX_MESH_LOD) == 0,
+              "Chunk dimensions must divide into the coarsest LOD cells");
+
+// Packed vertex for voxel rendering (4 bytes, decoded in shaders/voxel.vs)
+//
+// Corners are stored as chunk-local lattice coordinates (voxel center + 0.5), so every
+// value is a small integer: x/z in [0, CHUNK_SIZE], y in [0, CHUNK_HEIGHT].
+//   bits  0-4   x          bits 17-19  face direction (normal)
+//   bits  5-11  y          bits 20-23  texture slot (textureSlot)
+//   bits 12-16  z          bits 24-25  ambient occlusion (0 = darkest, 3 = open)
+//                          bit  26     debug flag
+//                          bits 27-30  light level
+// UVs are not stored; the shader derives them from the position and face. The light level
+// is getCombinedLight of the voxel the face looks into. Bit 31 stays clear, which keeps
+// every vertex word apart from FACE_RECORD_SENTINEL.
 struct VoxelVertex
 {
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec2 texCoord;
-    float textureId;
-    float debugFlag; // NEW: 0 = normal, 1 = should be culled but isn't
-
-    VoxelVertex(const glm::vec3 &pos, const glm::vec3 &norm, const glm::vec2 &tex, float texId, float debug)
-        : position(pos), normal(norm), texCoord(tex), textureId(texId), debugFlag(debug) {}
+    uint32_t data;
+
+    VoxelVertex(int x, int y, int z, int face_direction, int texture_id, int light = MAX_LIGHT, int occlusion = 3, bool debug = false)
+        : data(static_cast<uint32_t>(x) | (static_cast<uint32_t>(y) << 5) | (static_cast<uint32_t>(z) << 12) |
+               (static_cast<uint32_t>(face_direction) << 17) | (static_cast<uint32_t>(textureSlot(texture_id)) << 20) |
+               (static_cast<uint32_t>(occlusion) << 24) | (static_cast<uint32_t>(debug) << 26) |
+               (static_cast<uint32_t>(light) << 27)) {}
+
+    // Corner occlusion of a whole quad, two bits per FACE_VERTICES corner (corner i in bits
+    // 2i-2i+1), as ChunkMesh::faceOcclusion returns it
+    static constexpr int UNOCCLUDED = 0xFF;
+
+    // The shader picks the water frame itself, so texture slots skip the other frames and a
+    // texture fits four bits
+    static constexpr int textureSlot(int texture_id)
+    {
+        return texture_id > WATER_TEXTURE_LAST ? texture_id - (WATER_TEXTURE_LAST - WATER_TEXTURE_FIRST) : texture_id;
+    }
+
+    // Face record of MeshFormat::Faces: one word per quad, kept in the same vectors and buffers.
+    // (x, y, z) is the quad's first voxel and u/v its in-plane axes: x/y for front/back,
+    // z/y for right/left, x/z for top/bottom.
+    //   bits  0-3   x          bits 14-16  face direction
+    //   bits  4-9   y          bits 17-20  texture slot (textureSlot)
+    //   bits 10-13  z          bits 21-24  extent along u - 1
+    //                          bits 25-27  extent along v - 1
+    //                          bits 28-31  light level
+    // Records have no room for corner occlusion: MeshFormat::Faces draws without it.
+    static constexpr int MAX_RECORD_EXTENT_U = 16;
+    static constexpr int MAX_RECORD_EXTENT_V = 8;
+
+    static VoxelVertex faceRecord(int x, int y, int z, int face_direction, int texture_id, int extent_u, int extent_v, int light)
+    {
+        VoxelVertex record(0, 0, 0, 0, 0);
+        record.data = static_cast<uint32_t>(x) | (static_cast<uint32_t>(y) << 4) | (static_cast<uint32_t>(z) << 10) |
+                      (static_cast<uint32_t>(face_direction) << 14) | (static_cast<uint32_t>(textureSlot(texture_id)) << 17) |
+                      (static_cast<uint32_t>(extent_u - 1) << 21) | (static_cast<uint32_t>(extent_v - 1) << 25) |
+                      (static_cast<uint32_t>(light) << 28);
+        return record;
+    }
+};
+static_assert(sizeof(VoxelVertex) == 4, "VoxelVertex must stay packed");
+static_assert(CHUNK_SIZE < 32 && CHUNK_HEIGHT < 128, "Chunk dimensions exceed the packed vertex position bits");
+static_assert(CHUNK_SIZE <= 16 && CHUNK_HEIGHT <= 64 && CHUNK_SIZE <= VoxelVertex::MAX_RECORD_EXTENT_U,
+              "Chunk dimensions exceed the face record bits");
+static_assert(VoxelVertex::textureSlot(BLOCK_TEXTURE_LAYERS - 1) < 16, "Texture slots exceed four bits");
+
+// Thread-safe free list of mesh vectors. Uploaded meshes hand their CPU copies back here
+// and the next build picks them up again, so rebuilds reuse capacity instead of allocating.
+class MeshBufferPool
+{
+public:
+    static MeshBufferPool &instance();
+
+    // Swap a pooled vector into an empty one (no-op if it already has capacity)
+    void acquire(std::vector<VoxelVertex> &vertices);
+
+    // Take the vector's storage, leaving it empty with no capacity
+    void release(std::vector<VoxelVertex> &vertices);
+
+    size_t getPooledBytes(); // Capacity held by pooled vectors
+
+private:
+    static constexpr size_t MAX_POOLED = 64; // Extra buffers are freed
+
+    std::mutex mutex;
+    std::vector<std::vector<VoxelVertex>> vertex_buffers;
+};
+
+// Geometry of one mesh section: per-pass quads, four corners each (Indexed) or one record (Faces)
+struct MeshSectionGeometry
+{
+    std::array<std::vector<VoxelVertex>, 3> quads; // [MeshPass]
+    size_t face_count = 0;
+};
+
+// Section geometry of a sectioned build. Immutable once built: the mesh and the next job
+// share it, and sections that did not change are shared by later builds.
+struct MeshSections
+{
+    MeshingMode mode;
+    MeshFormat format;
+    std::array<std::shared_ptr<const MeshSectionGeometry>, MESH_SECTION_COUNT> sections;
+};
+
+// Sectioned build request: remesh dirty_sections and reuse the rest from previous (when it
+// was built the same way); quads never cross a section boundary
+struct MeshSectionRebuild
+{
+    std::shared_ptr<const MeshSections> previous;
+    uint8_t dirty_sections = ALL_MESH_SECTIONS;
 };
 
 class ChunkMesh
 {
 public:
-    // OpenGL buffer objects
-    GLuint VAO, VBO, EBO;
+    // Backend objects of the per-chunk path (indices come from the shared quad pattern)
+    RenderBackend::Buffer vertex_buffer;
+    RenderBackend::Geometry geometry;
+    MeshFormat geometry_format; // Layout geometry was created for
+    size_t vbo_capacity;        // Allocated bytes, reused by later uploads that fit
 
-    // Mesh data
-    std::vector<VoxelVertex> vertices;
-    std::vector<GLuint> indices;
+    // Mesh data (CPU copy; returned to MeshBufferPool once uploaded, counts below stay valid).
+    // Quads are four consecutive corners, or one record for MeshFormat::Faces.
+    std::vector<VoxelVertex> vertices;          // Opaque, cutout and translucent ranges in MeshPass order
+    std::vector<VoxelVertex> cutout_faces;      // Build-time staging of the cutout quads
+    std::vector<VoxelVertex> translucent_faces; // Build-time staging of the translucent quads
 
     // State tracking
     bool is_built;
     bool is_uploaded;
     size_t vertex_count;
-    size_t index_count;
+    // Range sizes in drawn indices, six per quad from the shared quad pattern
+    size_t opaque_index_count;
+    size_t cutout_index_count;
+    size_t translucent_index_count;
+    std::array<std::array<uint32_t, 6>, 3> direction_counts; // [MeshPass][FaceDirection] indices per bucket
+    size_t face_count; // Visible voxel faces before merging (equals quads for the naive mesher)
+    uint16_t face_connectivity; // Faces joined through see-through voxels (computeFaceConnectivity)
+    int min_occupied_y;         // Layers the geometry lies in: faces within [min - 0.5, max + 0.5]
+    int max_occupied_y;
+    int lod;                    // Detail level the geometry was built at (0 = full resolution)
+    MeshFormat format;          // Layout of vertices: corners, or face records
+    std::shared_ptr<const MeshSections> sections; // Kept by sectioned builds (edited chunks), else null
+
+    // Shared arena placement (multi-draw path); counts are captured at upload so drawing
+    // never reads ranges a worker is rebuilding
+    ChunkArena *arena;
+    ArenaRange arena_vertices;
+    size_t arena_opaque_count;
+    size_t arena_cutout_count;
+    size_t arena_translucent_count;
+    std::array<std::array<uint32_t, 6>, 3> arena_direction_counts;
 
 public:
     ChunkMesh();
     ~ChunkMesh();
 
     // Mesh building
-    void buildMesh(const VoxelChunk &chunk);
+    // lod in [0, MAX_MESH_LOD]; a rebuild request (lod 0 only) builds section by section
+    void buildMesh(const ChunkSnapshot &chunk, int lod = 0, const MeshSectionRebuild *rebuild = nullptr);
     void clear();
+    void markEmpty(); // Built with no geometry; GL buffers are kept for reuse
+    void adoptGeometry(ChunkMesh &built); // Take CPU data (or an arena placement) from a built mesh (main thread)
+    // Describe a GpuMesher build: full detail corners already in the arena (main thread)
+    void adoptGpuGeometry(ChunkArena &target, const GpuMeshOutput &output);
 
     // OpenGL operations
     void uploadToGPU();
-    void render() const;
+    bool uploadToArena(ChunkArena &target, GLuint staging_buffer = 0, size_t staging_offset = 0); // False if the arena cannot fit the mesh (use uploadToGPU)
+    size_t getUploadBytes() const { return vertex_count * sizeof(VoxelVertex); }
+    void writeUploadData(void *destination) const; // The vertices, getUploadBytes() long
+    // Draw calls return the indices submitted; directions selects face direction buckets
+    size_t queueArenaDraw(ChunkArena &target, MeshPass pass, const glm::vec3 &origin,
+                          uint8_t directions = ALL_FACE_DIRECTIONS) const;
+    void releaseArena(); // Return arena ranges (main thread only)
+    void recycle();      // Drop all geometry but keep GL objects for the next chunk (main thread only)
+    void render() const; // Every range
+    size_t renderRange(MeshPass pass, uint8_t directions = ALL_FACE_DIRECTIONS) const;
 
     // State queries
-    bool isEmpty() const { return vertices.empty(); }
+    bool isEmpty() const { return vertex_count == 0; }
     bool isBuilt() const { return is_built; }
     bool isUploaded() const { return is_uploaded; }
-    bool hasData() const { return is_built && !vertices.empty(); } // Check if mesh has vertex data (but hasn't been uploaded yet)
+    bool hasOpaque() const { return opaque_index_count > 0; }
+    bool hasCutout() const { return cutout_index_count > 0; }
+    bool hasTranslucent() const { return translucent_index_count > 0; }
+    size_t getIndexCount(MeshPass pass) const;      // CPU/per-chunk buffer counts
+    size_t getArenaIndexCount(MeshPass pass) const; // Counts captured at arena upload
+    bool isInArena() const { return arena != nullptr && arena_vertices.isValid(); }
+    bool hasData() const { return is_built && !vertices.empty(); } // CPU data present (built, not uploaded yet)
+
+    // Memory accounting: CPU vector capacity of this mesh (sections included), and the
+    // per-chunk VBO storage of every mesh as allocated by uploadToGPU
+    size_t getCpuMemoryUsage() const;
+    static size_t getGpuBufferBytes() { return gpu_buffer_bytes.load(std::memory_order_relaxed); }
+
+    // Global mesher selection used by buildMesh
+    static void setMeshingMode(MeshingMode mode);
+    static MeshingMode getMeshingMode();
+    static void setMeshFormat(MeshFormat format);
+    static MeshFormat getMeshFormat();
+
+    // Instances of every chunk draw (per-chunk, region and arena): one per view of a
+    // multi-view frame, voxel.vs picking the view by gl_InstanceID; 1 otherwise. Main thread only.
+    static void setViewCount(int count);
+    static int getViewCount();
+
+    // Directions whose faces can point at a camera at camera_local (relative to the chunk
+    // origin, i.e. the center of voxel 0,0,0): a direction is dropped once the camera is
+    // behind every face plane it can have, judged against the chunk bounds (vertically the
+    // layers min_y..max_y the geometry occupies)
+    static uint8_t getFacingDirections(const glm::vec3 &camera_local, int min_y = 0, int max_y = CHUNK_HEIGHT - 1);
+
+    // Block texture of a voxel type's face (top, bottom or sides)
+    static float getFaceTextureId(VoxelID voxel_type, int face_direction);
 
 private:
+    static std::atomic<size_t> gpu_buffer_bytes;
+
     // Face generation
     void addFace(const glm::vec3 &position, int face_direction, VoxelID voxel_type, int chunk_x, int chunk_y, int chunk_z);
 
@@ -64,16 +286,80 @@ private:
 
     // OpenGL cleanup
     void cleanupGL();
+    void deleteBuffers(); // The mesh's own buffer and geometry, not its arena ranges
+
+    // Hand the CPU vectors back to the pool after a successful upload
+    void releaseCpuData();
+
+    // Pass range a quad with this texture is emitted into
+    std::vector<VoxelVertex> &quadsFor(int texture_id);
+    void drawRuns(const RenderBackend::QuadRun *runs, size_t run_count) const;
+    size_t getRangeStart(MeshPass pass, size_t opaque_count, size_t cutout_count) const;
+
+    // Counting-sort the quads of every pass range by face direction (fills direction_counts)
+    void groupByDirection();
 
     // Face vertex data
     static const glm::vec3 FACE_VERTICES[6][4];
-    static const glm::vec3 FACE_NORMALS[6];
-    static const glm::vec2 FACE_TEX_COORDS[4];
-    const VoxelChunk* current_chunk; // Add this member variable
+    const ChunkSnapshot *current_chunk;
+    const uint8_t *padded_light = nullptr; // ChunkSnapshot::decodePaddedLight output during a build
+    const ChunkOccupancy *occupancy = nullptr; // summarizeOccupancy of the voxels during a build
+
+    // Light level of a face looking into padded voxel (x, y, z)
+    int faceLight(int x, int y, int z) const;
+
+    // Ambient occlusion of a face looking into padded voxel `across`, packed per corner like
+    // VoxelVertex::UNOCCLUDED: each corner darkens with the opaque voxels on its two sides and
+    // its diagonal in the layer across. Indexed lod 0 builds only (bake_occlusion).
+    bool bake_occlusion = false;
+    int faceOcclusion(const VoxelID *padded, const glm::ivec3 &across, int face_direction) const;
 
     // Optimized versions
-    bool shouldRenderFaceOptimized(const VoxelChunk &chunk, int x, int y, int z, int face_direction, VoxelID current_voxel) const;
-    void addFaceOptimized(const glm::vec3 &position, int face_direction, VoxelID voxel_type, int chunk_x, int chunk_y, int chunk_z);
+    void addFaceOptimized(int face_direction, VoxelID voxel_type, int chunk_x, int chunk_y, int chunk_z,
+                          int light, int occlusion);
+
+    // Face visibility rule shared by all meshers
+    static bool isFaceVisible(VoxelID current_voxel, VoxelID neighbor_voxel);
+
+    // Meshers read the decoded chunk (data, coordsToIndex order) and, across the border,
+    // the padded copy (ChunkSnapshot::paddedIndex). At lod 0 they emit the faces of voxels in
+    // layers [section_min_y, section_max_y) only.
+    int section_min_y = 0;
+    int section_max_y = CHUNK_HEIGHT;
+    void buildLayers(const VoxelID *data, const VoxelID *padded, MeshingMode mode); // Selected lod 0 mesher
+    void buildNaive(const VoxelID *data, const VoxelID *padded);
+
+    // Sectioned build: mesh or reuse every section, then lay them out like a whole-chunk build
+    void buildSections(const VoxelID *data, const VoxelID *padded, MeshingMode mode, const MeshSectionRebuild &rebuild);
+    void captureSection(MeshSectionGeometry &section); // Move the build output into section
+    void appendSection(const MeshSectionGeometry &section);
+
+    // Greedy mesher: merges visible faces slice by slice; mask covers [origin, origin + (du, dv))
+    // along the u and v axes. Mask keys are texture id + 1 with the face's light level in
+    // bits 8-11 and its corner occlusion in bits 12-19 (greedyKey), so only equally lit faces
+    // merge. A lattice corner's occlusion is shared by the faces meeting there, so equal
+    // corners along a run are constant across it and the merged quad keeps them exactly.
+    static uint32_t greedyKey(int texture_id, int light, int occlusion);
+    void buildGreedy(const VoxelID *data, const VoxelID *padded);
+    void greedyMergeSlice(std::vector<uint32_t> &mask, int du, int dv, int n_axis, int u_axis, int v_axis, int slice, int face,
+                          const glm::ivec3 &origin);
+
+    // Binary mesher: per-column opacity masks (CHUNK_HEIGHT == 64 bits) with a one-voxel border
+    void buildBinary(const VoxelID *data, const VoxelID *padded, bool greedy);
+
+    // Downsampled mesher for lod > 0: one cube per cell of cell^3 voxels
+    void buildDownsampled(const VoxelID *data, const VoxelID *padded, int cell);
+
+    // Emit one quad covering voxels [min, max] (inclusive) on the given face; UVs repeat per voxel
+    void addQuad(const glm::ivec3 &min, const glm::ivec3 &max, int face_direction, float texture_id, int light,
+                 int occlusion = VoxelVertex::UNOCCLUDED);
+    // Corner the quad's corners are emitted from: the shared pattern splits quads along the
+    // diagonal from the first corner, so starting at corner 1 instead splits along the one
+    // with the brighter corners and occlusion interpolates the same way on every quad
+    static int firstCorner(int occlusion);
+
+    // MeshFormat::Faces
+    void addFaceRecords(const glm::ivec3 &min, const glm::ivec3 &max, int face_direction, int texture_id, int light);
 };
 
 #endif // CHUNK_MESH_H
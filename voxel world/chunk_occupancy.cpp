@@ -0,0 +1,390 @@
+#include "chunk_occupancy.h"
+#include "block_registry.h"
+#include <algorithm>
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VOXEL_OCCUPANCY_SSE2 1 // Baseline of every x86-64 build
+#else
+#define VOXEL_OCCUPANCY_SSE2 0
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+    static_assert(BlockRegistry::MAX_TYPES == 16 && BlockRegistry::UNKNOWN_TYPE == 15,
+                  "The vector kernels look opacity up in a 16-entry byte table, clamping ids to 15");
+
+    inline int countBits64(uint64_t value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(value);
+#else
+        value = value - ((value >> 1) & 0x5555555555555555ULL);
+        value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+        value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return static_cast<int>((value * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+
+    // Lowest and highest set bit of a non-zero mask
+    inline int lowestBit64(uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+
+    inline int highestBit64(uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<int>(index);
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
+
+    // 0xFF for the opaque types, one byte per registry slot; unregistered ids (slot 15 and
+    // every id clamped to it) count as transparent, like isVoxelTransparent
+    struct OpacityTable
+    {
+        alignas(16) uint8_t bytes[16] = {};
+
+        OpacityTable()
+        {
+            for (int type = 0; type < BlockRegistry::MAX_TYPES; type++)
+            {
+                bytes[type] = isVoxelTransparent(static_cast<VoxelID>(type)) ? 0 : 0xFF;
+            }
+        }
+    };
+
+    const OpacityTable &getOpacityTable()
+    {
+        static const OpacityTable table;
+        return table;
+    }
+
+    // The transparent types besides air, for the SSE2 kernel (no byte shuffle to look opacity
+    // up with): one comparison each
+    struct TransparentTypes
+    {
+        VoxelID types[BlockRegistry::MAX_TYPES] = {};
+        int count = 0;
+
+        TransparentTypes()
+        {
+            const int type_count = BlockRegistry::get().getTypeCount();
+            for (int type = 1; type < type_count; type++)
+            {
+                if (isVoxelTransparent(static_cast<VoxelID>(type)))
+                {
+                    types[count++] = static_cast<VoxelID>(type);
+                }
+            }
+        }
+    };
+
+    const TransparentTypes &getTransparentTypes()
+    {
+        static const TransparentTypes types;
+        return types;
+    }
+
+    // Non-air and opaque bits of 32 contiguous voxels, bit i for voxels[i]
+    inline void maskBlock(const VoxelID *voxels, uint32_t &non_air, uint32_t &opaque)
+    {
+        static_assert(sizeof(VoxelID) == 2, "The vector kernels load 16-bit voxel ids");
+#if defined(__AVX2__)
+        // Clamp to 15 (an id the table leaves transparent) before narrowing to bytes, so every
+        // id lands in the table and none saturates into another
+        const __m256i table = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(getOpacityTable().bytes)));
+        const __m256i largest = _mm256_set1_epi16(15);
+        __m256i low = _mm256_min_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(voxels)), largest);
+        __m256i high = _mm256_min_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(voxels + 16)), largest);
+        // packus interleaves the 128-bit lanes; the permute puts the bytes back in order
+        __m256i ids = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+        __m256i air = _mm256_cmpeq_epi8(ids, _mm256_setzero_si256());
+        non_air = ~static_cast<uint32_t>(_mm256_movemask_epi8(air));
+        opaque = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_shuffle_epi8(table, ids)));
+#elif defined(__SSE4_1__)
+        const __m128i table = _mm_load_si128(reinterpret_cast<const __m128i *>(getOpacityTable().bytes));
+        const __m128i largest = _mm_set1_epi16(15);
+        uint32_t halves_air[2];
+        uint32_t halves_opaque[2];
+        for (int half = 0; half < 2; half++)
+        {
+            const __m128i *source = reinterpret_cast<const __m128i *>(voxels + half * 16);
+            __m128i low = _mm_min_epu16(_mm_loadu_si128(source), largest);
+            __m128i high = _mm_min_epu16(_mm_loadu_si128(source + 1), largest);
+            __m128i ids = _mm_packus_epi16(low, high);
+            halves_air[half] = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ids, _mm_setzero_si128())));
+            halves_opaque[half] = static_cast<uint32_t>(_mm_movemask_epi8(_mm_shuffle_epi8(table, ids)));
+        }
+        non_air = ~(halves_air[0] | halves_air[1] << 16);
+        opaque = halves_opaque[0] | halves_opaque[1] << 16;
+#elif VOXEL_OCCUPANCY_SSE2
+        // Transparent: air, ids past the table (saturating subtraction leaves them non-zero) and
+        // each transparent type
+        const TransparentTypes &transparent_types = getTransparentTypes();
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i last_type = _mm_set1_epi16(static_cast<short>(BlockRegistry::get().getTypeCount() - 1));
+        uint32_t halves_air[2];
+        uint32_t halves_transparent[2];
+        for (int half = 0; half < 2; half++)
+        {
+            __m128i lanes[2];
+            __m128i transparent[2];
+            for (int part = 0; part < 2; part++)
+            {
+                lanes[part] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(voxels + half * 16 + part * 8));
+                transparent[part] = _mm_or_si128(_mm_cmpeq_epi16(lanes[part], zero),
+                                                 _mm_xor_si128(_mm_cmpeq_epi16(_mm_subs_epu16(lanes[part], last_type), zero),
+                                                               _mm_set1_epi16(-1)));
+                for (int i = 0; i < transparent_types.count; i++)
+                {
+                    __m128i type = _mm_set1_epi16(static_cast<short>(transparent_types.types[i]));
+                    transparent[part] = _mm_or_si128(transparent[part], _mm_cmpeq_epi16(lanes[part], type));
+                }
+            }
+            __m128i air = _mm_packs_epi16(_mm_cmpeq_epi16(lanes[0], zero), _mm_cmpeq_epi16(lanes[1], zero));
+            halves_air[half] = static_cast<uint32_t>(_mm_movemask_epi8(air));
+            halves_transparent[half] = static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(transparent[0], transparent[1])));
+        }
+        non_air = ~(halves_air[0] | halves_air[1] << 16);
+        opaque = ~(halves_transparent[0] | halves_transparent[1] << 16);
+#else
+        const uint8_t *table = getOpacityTable().bytes;
+        non_air = 0;
+        opaque = 0;
+        for (int i = 0; i < 32; i++)
+        {
+            VoxelID voxel = voxels[i];
+            non_air |= static_cast<uint32_t>(voxel != VOXEL_AIR) << i;
+            opaque |= static_cast<uint32_t>(voxel < 16 && table[voxel] != 0) << i;
+        }
+#endif
+    }
+
+    // Turn 64 rows along z (bit z of rows[y]) into 16 columns along y (bit y of columns[z])
+#if VOXEL_OCCUPANCY_SSE2
+    // 16 rows at a time: narrowed to bytes (z 0-7, then 8-15), movemask reads bit 7 of every
+    // row and doubling the bytes brings the next bit up
+    void transposeRows(const uint16_t *rows, uint64_t *columns)
+    {
+        for (int z = 0; z < CHUNK_SIZE; z++)
+        {
+            columns[z] = 0;
+        }
+        const __m128i low_byte = _mm_set1_epi16(0xFF);
+        for (int group = 0; group < CHUNK_HEIGHT / 16; group++)
+        {
+            const __m128i *source = reinterpret_cast<const __m128i *>(rows + group * 16);
+            __m128i first = _mm_loadu_si128(source);
+            __m128i second = _mm_loadu_si128(source + 1);
+            __m128i halves[2] = {_mm_packus_epi16(_mm_and_si128(first, low_byte), _mm_and_si128(second, low_byte)),
+                                 _mm_packus_epi16(_mm_srli_epi16(first, 8), _mm_srli_epi16(second, 8))};
+            for (int half = 0; half < 2; half++)
+            {
+                __m128i bits = halves[half];
+                for (int z = 7; z >= 0; z--)
+                {
+                    columns[half * 8 + z] |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(bits))) << (group * 16);
+                    bits = _mm_add_epi8(bits, bits);
+                }
+            }
+        }
+    }
+#else
+    // As 8x8 bit blocks transposed in a register each
+    void transposeRows(const uint16_t *rows, uint64_t *columns)
+    {
+        for (int z = 0; z < CHUNK_SIZE; z++)
+        {
+            columns[z] = 0;
+        }
+        for (int z_block = 0; z_block < CHUNK_SIZE / 8; z_block++)
+        {
+            for (int y_block = 0; y_block < CHUNK_HEIGHT / 8; y_block++)
+            {
+                // Byte i: row y_block * 8 + i, bit j: z_block * 8 + j
+                uint64_t block = 0;
+                for (int i = 0; i < 8; i++)
+                {
+                    block |= static_cast<uint64_t>((rows[y_block * 8 + i] >> (z_block * 8)) & 0xFF) << (i * 8);
+                }
+                uint64_t swap = (block ^ (block >> 7)) & 0x00AA00AA00AA00AAULL;
+                block ^= swap ^ (swap << 7);
+                swap = (block ^ (block >> 14)) & 0x0000CCCC0000CCCCULL;
+                block ^= swap ^ (swap << 14);
+                swap = (block ^ (block >> 28)) & 0x00000000F0F0F0F0ULL;
+                block ^= swap ^ (swap << 28);
+                for (int j = 0; j < 8; j++)
+                {
+                    columns[z_block * 8 + j] |= ((block >> (j * 8)) & 0xFF) << (y_block * 8);
+                }
+            }
+        }
+    }
+#endif
+}
+
+void ChunkOccupancy::fillUniform(VoxelID voxel)
+{
+    bool is_air = voxel == VOXEL_AIR;
+    bool is_opaque = !isVoxelTransparent(voxel);
+    non_air_count = is_air ? 0 : CHUNK_VOLUME;
+    opaque_count = is_opaque ? CHUNK_VOLUME : 0;
+    opaque_columns.fill(is_opaque ? ~uint64_t(0) : 0);
+    transparent_columns.fill(!is_air && !is_opaque ? ~uint64_t(0) : 0);
+    min_y = is_air ? CHUNK_HEIGHT : 0;
+    max_y = is_air ? -1 : CHUNK_HEIGHT - 1;
+}
+
+void ChunkOccupancy::update(int x, int y, int z, VoxelID from, VoxelID to)
+{
+    int column = columnIndex(x, z);
+    uint64_t bit = uint64_t(1) << y;
+    opaque_columns[column] &= ~bit;
+    transparent_columns[column] &= ~bit;
+    non_air_count += static_cast<int>(to != VOXEL_AIR) - static_cast<int>(from != VOXEL_AIR);
+    opaque_count += static_cast<int>(!isVoxelTransparent(to)) - static_cast<int>(!isVoxelTransparent(from));
+    if (!isVoxelTransparent(to))
+    {
+        opaque_columns[column] |= bit;
+    }
+    else if (to != VOXEL_AIR)
+    {
+        transparent_columns[column] |= bit;
+    }
+
+    if (to != VOXEL_AIR)
+    {
+        min_y = std::min(min_y, y);
+        max_y = std::max(max_y, y);
+    }
+    else if (y == min_y || y == max_y)
+    {
+        updateRange(); // The range may shrink
+    }
+}
+
+void ChunkOccupancy::updateRange()
+{
+    uint64_t layers = 0;
+    for (size_t column = 0; column < opaque_columns.size(); column++)
+    {
+        layers |= opaque_columns[column] | transparent_columns[column];
+    }
+    min_y = layers ? lowestBit64(layers) : CHUNK_HEIGHT;
+    max_y = layers ? highestBit64(layers) : -1;
+}
+
+void summarizeOccupancy(const VoxelID *voxels, ChunkOccupancy &out)
+{
+    using Layout = ChunkIndexing;
+    uint64_t *opaque_columns = out.opaque_columns.data();
+    uint64_t *transparent_columns = out.transparent_columns.data();
+
+    if constexpr (Layout::LINEAR && Layout::offsetY(1) == 1)
+    {
+        // Columns are contiguous: two blocks make a column
+        for (int column = 0; column < CHUNK_SIZE * CHUNK_SIZE; column++)
+        {
+            int x = column / CHUNK_SIZE;
+            int z = column % CHUNK_SIZE;
+            const VoxelID *source = voxels + Layout::index(x, 0, z);
+            uint32_t non_air[2];
+            uint32_t opaque[2];
+            maskBlock(source, non_air[0], opaque[0]);
+            maskBlock(source + 32, non_air[1], opaque[1]);
+            uint64_t non_air_bits = non_air[0] | static_cast<uint64_t>(non_air[1]) << 32;
+            opaque_columns[column] = opaque[0] | static_cast<uint64_t>(opaque[1]) << 32;
+            transparent_columns[column] = non_air_bits & ~opaque_columns[column];
+        }
+    }
+    else if constexpr (Layout::LINEAR && Layout::offsetZ(1) == 1)
+    {
+        // Rows along z are contiguous: a block is two rows, transposed into columns per x
+        static_assert(CHUNK_SIZE == 16, "Two rows along z make a 32-voxel block");
+        uint16_t non_air_rows[CHUNK_HEIGHT];
+        uint16_t opaque_rows[CHUNK_HEIGHT];
+        uint16_t transparent_rows[CHUNK_HEIGHT];
+        for (int x = 0; x < CHUNK_SIZE; x++)
+        {
+            for (int y = 0; y < CHUNK_HEIGHT; y += 2)
+            {
+                uint32_t non_air;
+                uint32_t opaque;
+                maskBlock(voxels + Layout::index(x, y, 0), non_air, opaque);
+                non_air_rows[y] = static_cast<uint16_t>(non_air);
+                non_air_rows[y + 1] = static_cast<uint16_t>(non_air >> 16);
+                opaque_rows[y] = static_cast<uint16_t>(opaque);
+                opaque_rows[y + 1] = static_cast<uint16_t>(opaque >> 16);
+            }
+            for (int y = 0; y < CHUNK_HEIGHT; y++)
+            {
+                transparent_rows[y] = static_cast<uint16_t>(non_air_rows[y] & ~opaque_rows[y]);
+            }
+            transposeRows(opaque_rows, opaque_columns + ChunkOccupancy::columnIndex(x, 0));
+            transposeRows(transparent_rows, transparent_columns + ChunkOccupancy::columnIndex(x, 0));
+        }
+    }
+    else
+    {
+        // No contiguous axis (Morton): voxel by voxel
+        for (int x = 0; x < CHUNK_SIZE; x++)
+        {
+            for (int z = 0; z < CHUNK_SIZE; z++)
+            {
+                const VoxelID *column = voxels + Layout::index(x, 0, z);
+                uint64_t opaque = 0;
+                uint64_t transparent = 0;
+                for (int y = 0; y < CHUNK_HEIGHT; y++)
+                {
+                    VoxelID voxel = column[Layout::offsetY(y)];
+                    bool is_opaque = !isVoxelTransparent(voxel);
+                    opaque |= static_cast<uint64_t>(is_opaque) << y;
+                    transparent |= static_cast<uint64_t>(!is_opaque && voxel != VOXEL_AIR) << y;
+                }
+                int index = ChunkOccupancy::columnIndex(x, z);
+                opaque_columns[index] = opaque;
+                transparent_columns[index] = transparent;
+            }
+        }
+    }
+
+    int opaque_count = 0;
+    int transparent_count = 0;
+    for (int column = 0; column < CHUNK_SIZE * CHUNK_SIZE; column++)
+    {
+        opaque_count += countBits64(opaque_columns[column]);
+        transparent_count += countBits64(transparent_columns[column]);
+    }
+    out.opaque_count = opaque_count;
+    out.non_air_count = opaque_count + transparent_count;
+    out.updateRange();
+}
+
+const char *getOccupancyKernelName()
+{
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSE4_1__)
+    return "sse4.1";
+#elif VOXEL_OCCUPANCY_SSE2
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,57 @@
+#ifndef CHUNK_OCCUPANCY_H
+#define CHUNK_OCCUPANCY_H
+
+#include "voxel_types.h"
+#include <array>
+#include <cstdint>
+
+// What fills a chunk
+enum class ChunkFill : uint8_t
+{
+    Empty, // Only air
+    Opaque, // Only opaque voxels (of any types)
+    Mixed
+};
+
+// One-pass summary of a chunk's voxels: the non-air count, and per column (x, z) a 64-bit
+// mask over y of its opaque voxels and of its transparent non-air ones (water, leaves,
+// glass), the masks the binary mesher works on. Air is the bits in neither. The layers
+// holding anything bound the loops of the meshers and the boxes of culling.
+struct ChunkOccupancy
+{
+    static_assert(CHUNK_HEIGHT == 64, "Occupancy packs one column into a 64-bit mask");
+
+    int non_air_count = 0;
+    int opaque_count = 0;
+    int min_y = CHUNK_HEIGHT; // Lowest and highest layer with a non-air voxel; max_y < min_y when empty
+    int max_y = -1;
+    std::array<uint64_t, CHUNK_SIZE * CHUNK_SIZE> opaque_columns;
+    std::array<uint64_t, CHUNK_SIZE * CHUNK_SIZE> transparent_columns;
+
+    static int columnIndex(int x, int z) { return x * CHUNK_SIZE + z; }
+
+    ChunkFill getFill() const
+    {
+        return non_air_count == 0              ? ChunkFill::Empty
+               : opaque_count == CHUNK_VOLUME ? ChunkFill::Opaque
+                                              : ChunkFill::Mixed;
+    }
+
+    // Every voxel is `voxel`
+    void fillUniform(VoxelID voxel);
+    // Account for one voxel changing from `from` to `to` (from != to)
+    void update(int x, int y, int z, VoxelID from, VoxelID to);
+
+    // Recompute min_y / max_y from the column masks
+    void updateRange();
+};
+
+// Summarize CHUNK_VOLUME decoded voxels (ChunkIndexing order). Vectorized with AVX2 or
+// SSE4.1 when the build targets them (VOXEL_SIMD in CMake), else with SSE2 on x86 and
+// scalar elsewhere; the result is the same either way.
+void summarizeOccupancy(const VoxelID *voxels, ChunkOccupancy &out);
+
+// Instruction set summarizeOccupancy was compiled for: "avx2", "sse4.1", "sse2" or "scalar"
+const char *getOccupancyKernelName();
+
+#endif // CHUNK_OCCUPANCY_H
@@ -0,0 +1,233 @@
+#include "chunk_protocol.h"
+#include "palette_storage.h"
+#include "block_registry.h"
+
+namespace
+{
+void writeVarint(std::vector<unsigned char> &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+bool readVarint(const unsigned char *&data, const unsigned char *end, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && data < end; shift += 7)
+    {
+        unsigned char byte = *data++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void writePosition(std::vector<unsigned char> &out, const glm::ivec3 &position)
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        int32_t value = position[axis];
+        writeVarint(out, (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31)); // Zigzag
+    }
+}
+
+bool readPosition(const unsigned char *&data, const unsigned char *end, glm::ivec3 &position)
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        uint64_t value = 0;
+        if (!readVarint(data, end, value) || value > UINT32_MAX)
+        {
+            return false;
+        }
+        uint32_t bits = static_cast<uint32_t>(value);
+        position[axis] = static_cast<int32_t>((bits >> 1) ^ (0u - (bits & 1)));
+    }
+    return true;
+}
+
+// Frames a message: the payload is built in body, then appended with its header
+class MessageWriter
+{
+public:
+    MessageWriter(std::vector<unsigned char> &out, StreamMessage type) : out(out), type(type)
+    {
+        body.clear();
+    }
+
+    ~MessageWriter()
+    {
+        out.push_back(static_cast<unsigned char>(type));
+        writeVarint(out, body.size());
+        out.insert(out.end(), body.begin(), body.end());
+    }
+
+    std::vector<unsigned char> &payload() { return body; }
+
+private:
+    static thread_local std::vector<unsigned char> body;
+    std::vector<unsigned char> &out;
+    StreamMessage type;
+};
+
+thread_local std::vector<unsigned char> MessageWriter::body;
+}
+
+void ChunkProtocol::writeHello(std::vector<unsigned char> &out, uint32_t seed, TerrainMode mode)
+{
+    MessageWriter message(out, StreamMessage::Hello);
+    writeVarint(message.payload(), seed);
+    writeVarint(message.payload(), static_cast<uint64_t>(mode));
+}
+
+void ChunkProtocol::writeChunkData(std::vector<unsigned char> &out, const glm::ivec3 &chunk_pos, uint64_t revision,
+                                   const PaletteStorage &voxels)
+{
+    MessageWriter message(out, StreamMessage::ChunkData);
+    writePosition(message.payload(), chunk_pos);
+    writeVarint(message.payload(), revision);
+    voxels.encodeRuns(message.payload()); // The rest of the payload
+}
+
+void ChunkProtocol::writeChunkReuse(std::vector<unsigned char> &out, const glm::ivec3 &chunk_pos, uint64_t revision)
+{
+    MessageWriter message(out, StreamMessage::ChunkReuse);
+    writePosition(message.payload(), chunk_pos);
+    writeVarint(message.payload(), revision);
+}
+
+void ChunkProtocol::writeChunkDelta(std::vector<unsigned char> &out, const glm::ivec3 &chunk_pos, uint64_t base_revision,
+                                    uint64_t revision, const std::vector<ChunkDeltaEdit> &edits)
+{
+    MessageWriter message(out, StreamMessage::ChunkDelta);
+    writePosition(message.payload(), chunk_pos);
+    writeVarint(message.payload(), base_revision);
+    writeVarint(message.payload(), revision);
+    writeVarint(message.payload(), edits.size());
+    for (const ChunkDeltaEdit &edit : edits)
+    {
+        writeVarint(message.payload(), edit.index);
+        writeVarint(message.payload(), edit.voxel);
+    }
+}
+
+void ChunkProtocol::writeChunkUnload(std::vector<unsigned char> &out, const glm::ivec3 &chunk_pos)
+{
+    MessageWriter message(out, StreamMessage::ChunkUnload);
+    writePosition(message.payload(), chunk_pos);
+}
+
+void ChunkProtocol::writeCachedChunks(std::vector<unsigned char> &out, const std::vector<CachedChunkEntry> &chunks)
+{
+    MessageWriter message(out, StreamMessage::CachedChunks);
+    writeVarint(message.payload(), chunks.size());
+    for (const CachedChunkEntry &chunk : chunks)
+    {
+        writePosition(message.payload(), chunk.position);
+        writeVarint(message.payload(), chunk.revision);
+    }
+}
+
+void ChunkProtocol::writeChunkRequest(std::vector<unsigned char> &out, const glm::ivec3 &chunk_pos)
+{
+    MessageWriter message(out, StreamMessage::ChunkRequest);
+    writePosition(message.payload(), chunk_pos);
+}
+
+ChunkProtocol::ReadStatus ChunkProtocol::readMessage(const unsigned char *data, size_t size, size_t &offset,
+                                                     Message &message)
+{
+    const unsigned char *cursor = data + offset;
+    const unsigned char *end = data + size;
+    if (cursor >= end)
+    {
+        return ReadStatus::Incomplete;
+    }
+    StreamMessage type = static_cast<StreamMessage>(*cursor++);
+
+    // A length cut off by the end of the buffer is incomplete; one longer than a varint is not
+    uint64_t length = 0;
+    const unsigned char *length_start = cursor;
+    if (!readVarint(cursor, end, length))
+    {
+        return cursor - length_start >= 10 ? ReadStatus::Malformed : ReadStatus::Incomplete;
+    }
+    if (length > MAX_MESSAGE_SIZE)
+    {
+        return ReadStatus::Malformed;
+    }
+    if (static_cast<size_t>(end - cursor) < length)
+    {
+        return ReadStatus::Incomplete;
+    }
+    const unsigned char *payload_end = cursor + length;
+
+    message.type = type;
+    message.edits.clear();
+    message.cached.clear();
+    bool valid = true;
+    uint64_t value = 0;
+    switch (type)
+    {
+    case StreamMessage::Hello:
+        valid = readVarint(cursor, payload_end, value) && value <= UINT32_MAX;
+        message.seed = static_cast<uint32_t>(value);
+        valid = valid && readVarint(cursor, payload_end, value) && value <= static_cast<uint64_t>(TerrainMode::Density);
+        message.mode = static_cast<TerrainMode>(value);
+        break;
+    case StreamMessage::ChunkData:
+        valid = readPosition(cursor, payload_end, message.position) && readVarint(cursor, payload_end, message.revision);
+        message.runs = cursor;
+        message.runs_size = static_cast<size_t>(payload_end - cursor);
+        cursor = payload_end;
+        break;
+    case StreamMessage::ChunkReuse:
+        valid = readPosition(cursor, payload_end, message.position) && readVarint(cursor, payload_end, message.revision);
+        break;
+    case StreamMessage::ChunkDelta:
+        valid = readPosition(cursor, payload_end, message.position) &&
+                readVarint(cursor, payload_end, message.base_revision) &&
+                readVarint(cursor, payload_end, message.revision) && readVarint(cursor, payload_end, value) &&
+                value <= static_cast<uint64_t>(payload_end - cursor) / 2; // Two bytes per edit at least
+        for (uint64_t i = 0; valid && i < value; i++)
+        {
+            uint64_t index = 0;
+            uint64_t voxel = 0;
+            valid = readVarint(cursor, payload_end, index) && index < CHUNK_VOLUME &&
+                    readVarint(cursor, payload_end, voxel) &&
+                    voxel < static_cast<uint64_t>(BlockRegistry::get().getTypeCount());
+            message.edits.push_back({static_cast<uint16_t>(index), static_cast<VoxelID>(voxel)});
+        }
+        break;
+    case StreamMessage::ChunkUnload:
+    case StreamMessage::ChunkRequest:
+        valid = readPosition(cursor, payload_end, message.position);
+        break;
+    case StreamMessage::CachedChunks:
+        valid = readVarint(cursor, payload_end, value) && value <= static_cast<uint64_t>(payload_end - cursor) / 4;
+        for (uint64_t i = 0; valid && i < value; i++)
+        {
+            CachedChunkEntry entry;
+            valid = readPosition(cursor, payload_end, entry.position) && readVarint(cursor, payload_end, entry.revision);
+            message.cached.push_back(entry);
+        }
+        break;
+    default:
+        cursor = payload_end; // Unknown to this version
+        break;
+    }
+
+    if (!valid || cursor != payload_end)
+    {
+        return ReadStatus::Malformed;
+    }
+    offset = static_cast<size_t>(payload_end - data);
+    return ReadStatus::Ok;
+}
@@ -0,0 +1,95 @@
+#ifndef CHUNK_PROTOCOL_H
+#define CHUNK_PROTOCOL_H
+
+#include "voxel_types.h"
+#include "density_terrain.h"
+#include <glm/glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class PaletteStorage;
+
+// Messages of a chunk stream between a server and its clients (ChunkStreamServer,
+// ChunkStreamClient), independent of the transport that carries the bytes.
+//
+// A message is a type byte, a varint payload length and the payload. Integers are varints,
+// coordinates zigzag encoded; chunk voxels travel as the PaletteStorage run encoding region
+// files use, so a terrain chunk is typically a few hundred bytes.
+//
+// Every chunk has a revision on the server: the session's base revision until it is edited,
+// then a new one for every tick it changes in. A chunk the client reported in its cache at
+// the current revision is announced with ChunkReuse instead of resent. Edits travel as one
+// ChunkDelta per chunk and tick, naming the revision they apply to; a client holding another
+// revision answers with ChunkRequest and gets the whole chunk.
+enum class StreamMessage : uint8_t
+{
+    // Server to client
+    Hello = 1,       // seed, terrain mode
+    ChunkData = 2,   // position, revision, voxel runs
+    ChunkReuse = 3,  // position, revision: the cached copy at that revision is current
+    ChunkDelta = 4,  // position, base revision, revision, edits
+    ChunkUnload = 5, // position
+
+    // Client to server
+    CachedChunks = 6, // position and revision of every chunk the client has cached
+    ChunkRequest = 7  // position: send it whole (evicted from the cache, or a delta missed)
+};
+
+// One voxel of a ChunkDelta, at VoxelChunk::coordsToIndex
+struct ChunkDeltaEdit
+{
+    uint16_t index;
+    VoxelID voxel;
+};
+
+struct CachedChunkEntry
+{
+    glm::ivec3 position;
+    uint64_t revision;
+};
+
+class ChunkProtocol
+{
+public:
+    static constexpr size_t MAX_MESSAGE_SIZE = 1u << 20; // Far above any real chunk or delta
+
+    // Decoded message; only the fields of its type are set, runs point into the read buffer
+    struct Message
+    {
+        StreamMessage type = StreamMessage::Hello;
+        glm::ivec3 position{0};
+        uint64_t revision = 0;
+        uint64_t base_revision = 0;
+        uint32_t seed = 0;
+        TerrainMode mode = TerrainMode::Heightmap;
+        const unsigned char *runs = nullptr;
+        size_t runs_size = 0;
+        std::vector<ChunkDeltaEdit> edits;
+        std::vector<CachedChunkEntry> cached;
+    };
+
+    enum class ReadStatus
+    {
+        Ok,
+        Incomplete, // More bytes needed; nothing consumed
+        Malformed
+    };
+
+    // Append one message to out
+    static void writeHello(std::vector<unsigned char> &out, uint32_t seed, TerrainMode mode);
+    static void writeChunkData(std::vector<unsigned char> &out, const glm::ivec3 &chunk_pos, uint64_t revision,
+                               const PaletteStorage &voxels);
+    static void writeChunkReuse(std::vector<unsigned char> &out, const glm::ivec3 &chunk_pos, uint64_t revision);
+    static void writeChunkDelta(std::vector<unsigned char> &out, const glm::ivec3 &chunk_pos, uint64_t base_revision,
+                                uint64_t revision, const std::vector<ChunkDeltaEdit> &edits);
+    static void writeChunkUnload(std::vector<unsigned char> &out, const glm::ivec3 &chunk_pos);
+    static void writeCachedChunks(std::vector<unsigned char> &out, const std::vector<CachedChunkEntry> &chunks);
+    static void writeChunkRequest(std::vector<unsigned char> &out, const glm::ivec3 &chunk_pos);
+
+    // Decode the message starting at data + offset and move offset past it. Unknown types
+    // decode as Ok with only type set, so newer peers can add messages.
+    static ReadStatus readMessage(const unsigned char *data, size_t size, size_t &offset, Message &message);
+};
+
+#endif // CHUNK_PROTOCOL_H
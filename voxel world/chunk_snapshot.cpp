@@ -0,0 +1,165 @@
+#include "chunk_snapshot.h"
+#include "voxel_chunk.h"
+#include <algorithm>
+
+namespace
+{
+// Position of a voxel in the layer two chunks share across a face in direction dir, from its
+// two in-plane coordinates (identical on both sides)
+int layerIndex(int dir, const glm::ivec3 &pos)
+{
+    if (dir == NEIGHBOR_FRONT || dir == NEIGHBOR_BACK)
+    {
+        return pos.x * CHUNK_HEIGHT + pos.y;
+    }
+    if (dir == NEIGHBOR_RIGHT || dir == NEIGHBOR_LEFT)
+    {
+        return pos.y * CHUNK_SIZE + pos.z;
+    }
+    return pos.x * CHUNK_SIZE + pos.z;
+}
+
+// The neighbor's light on its side facing back towards the chunk (direction dir from it)
+void captureLayer(const VoxelChunk &neighbor, int dir, std::vector<uint8_t> &out)
+{
+    const bool z_face = dir == NEIGHBOR_FRONT || dir == NEIGHBOR_BACK;
+    const bool x_face = dir == NEIGHBOR_RIGHT || dir == NEIGHBOR_LEFT;
+    out.resize(z_face ? CHUNK_SIZE * CHUNK_HEIGHT : (x_face ? CHUNK_HEIGHT * CHUNK_SIZE : CHUNK_SIZE * CHUNK_SIZE));
+
+    // The neighbor's layer is the one adjacent to the chunk: local 0 when it lies on the
+    // positive side, the far end otherwise
+    const bool positive = dir == NEIGHBOR_FRONT || dir == NEIGHBOR_RIGHT || dir == NEIGHBOR_TOP;
+    const int depth = positive ? 0 : (z_face || x_face ? CHUNK_SIZE - 1 : CHUNK_HEIGHT - 1);
+    const int extent_a = x_face ? CHUNK_HEIGHT : CHUNK_SIZE;
+    const int extent_b = z_face ? CHUNK_HEIGHT : CHUNK_SIZE;
+    for (int a = 0; a < extent_a; a++)
+    {
+        for (int b = 0; b < extent_b; b++)
+        {
+            glm::ivec3 pos = z_face ? glm::ivec3(a, b, depth) : (x_face ? glm::ivec3(depth, a, b) : glm::ivec3(a, depth, b));
+            out[layerIndex(dir, pos)] = neighbor.light.get(VoxelChunk::coordsToIndex(pos.x, pos.y, pos.z));
+        }
+    }
+}
+}
+
+ChunkSnapshot::ChunkSnapshot(std::shared_ptr<const VoxelChunk> chunk)
+    : position(chunk->position), version(chunk->version), source(std::move(chunk)), voxels(source->voxels),
+      light(source->light)
+{
+    for (int dir = 0; dir < 6; dir++)
+    {
+        if (const VoxelChunk *neighbor = source->getNeighbor(dir))
+        {
+            neighbor_voxels[dir].emplace(neighbor->voxels);
+            captureLayer(*neighbor, dir, neighbor_light[dir]);
+        }
+    }
+}
+
+uint8_t ChunkSnapshot::getPredictedFaces() const
+{
+    uint8_t faces = 0;
+    for (int dir = 0; dir < 6; dir++)
+    {
+        faces |= neighbor_voxels[dir] ? 0u : 1u << dir;
+    }
+    return faces;
+}
+
+void ChunkSnapshot::decodePadded(const VoxelID *decoded, VoxelID *out) const
+{
+    // Interior: one z row at a time
+    for (int x = 0; x < CHUNK_SIZE; x++)
+    {
+        for (int y = 0; y < CHUNK_HEIGHT; y++)
+        {
+            ChunkIndexing::copyRowZ(decoded + VoxelChunk::coordsToIndex(x, y, 0), out + paddedIndex(x, y, 0));
+        }
+    }
+
+    // The predicted shell first; edges and corners (two or three coordinates outside) always
+    // stay predicted, as in VoxelChunk::getVoxelWithNeighbors
+    uint8_t predicted = getPredictedFaces();
+    source->predictShell(out, predicted & ((1u << NEIGHBOR_TOP) | (1u << NEIGHBOR_BOTTOM)));
+
+    // Then the faces of loaded neighbors from their copies
+    for (int dir = 0; dir < 6; dir++)
+    {
+        if (!neighbor_voxels[dir])
+        {
+            continue;
+        }
+        const PaletteStorage &neighbor = *neighbor_voxels[dir];
+        const bool vertical = dir == NEIGHBOR_TOP || dir == NEIGHBOR_BOTTOM;
+        for (int a = 0; a < CHUNK_SIZE; a++)
+        {
+            for (int b = 0; b < (vertical ? CHUNK_SIZE : CHUNK_HEIGHT); b++)
+            {
+                glm::ivec3 shell = dir == NEIGHBOR_FRONT  ? glm::ivec3(a, b, CHUNK_SIZE)
+                                   : dir == NEIGHBOR_BACK  ? glm::ivec3(a, b, -1)
+                                   : dir == NEIGHBOR_RIGHT ? glm::ivec3(CHUNK_SIZE, b, a)
+                                   : dir == NEIGHBOR_LEFT  ? glm::ivec3(-1, b, a)
+                                   : dir == NEIGHBOR_TOP   ? glm::ivec3(a, CHUNK_HEIGHT, b)
+                                                           : glm::ivec3(a, -1, b);
+                glm::ivec3 inside;
+                VoxelChunk::borderNeighbor(shell.x, shell.y, shell.z, inside);
+                out[paddedIndex(shell.x, shell.y, shell.z)] = neighbor.get(VoxelChunk::coordsToIndex(inside.x, inside.y, inside.z));
+            }
+        }
+    }
+}
+
+void ChunkSnapshot::decodePaddedLight(uint8_t *out) const
+{
+    thread_local std::array<uint8_t, CHUNK_VOLUME> decoded;
+    light.decodeAll(decoded.data());
+    for (int x = 0; x < CHUNK_SIZE; x++)
+    {
+        for (int y = 0; y < CHUNK_HEIGHT; y++)
+        {
+            ChunkIndexing::copyRowZ(decoded.data() + VoxelChunk::coordsToIndex(x, y, 0), out + paddedIndex(x, y, 0));
+        }
+    }
+
+    auto shell = [&](int x, int y, int z)
+    {
+        glm::ivec3 neighbor_pos;
+        int dir = VoxelChunk::borderNeighbor(x, y, z, neighbor_pos);
+        if (dir < 0 || !VoxelChunk::isLocal(neighbor_pos.x, neighbor_pos.y, neighbor_pos.z))
+        {
+            return; // Edge or corner
+        }
+        if (!neighbor_light[dir].empty())
+        {
+            out[paddedIndex(x, y, z)] = neighbor_light[dir][layerIndex(dir, neighbor_pos)];
+        }
+        else
+        {
+            glm::ivec3 inside = glm::clamp(glm::ivec3(x, y, z), glm::ivec3(0), glm::ivec3(CHUNK_SIZE - 1, CHUNK_HEIGHT - 1, CHUNK_SIZE - 1));
+            out[paddedIndex(x, y, z)] = decoded[VoxelChunk::coordsToIndex(inside.x, inside.y, inside.z)];
+        }
+    };
+
+    for (int x = 0; x < CHUNK_SIZE; x++)
+    {
+        for (int y = 0; y < CHUNK_HEIGHT; y++)
+        {
+            shell(x, y, -1);
+            shell(x, y, CHUNK_SIZE);
+        }
+        for (int z = 0; z < CHUNK_SIZE; z++)
+        {
+            shell(x, -1, z);
+            shell(x, CHUNK_HEIGHT, z);
+        }
+    }
+    for (int y = 0; y < CHUNK_HEIGHT; y++)
+    {
+        for (int z = 0; z < CHUNK_SIZE; z++)
+        {
+            shell(-1, y, z);
+            shell(CHUNK_SIZE, y, z);
+        }
+    }
+}
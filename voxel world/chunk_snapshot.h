@@ -0,0 +1,68 @@
+#ifndef CHUNK_SNAPSHOT_H
+#define CHUNK_SNAPSHOT_H
+
+#include "voxel_types.h"
+#include "palette_storage.h"
+#include "voxel_light.h"
+#include <glm/glm/glm.hpp>
+#include <array>
+#include <memory>
+#include <optional>
+#include <vector>
+
+class VoxelChunk;
+
+// Read-only copy of everything a mesh job looks at, captured on the main thread.
+//
+// Workers mesh from the snapshot instead of the live chunk, so edits, neighbor relinking
+// and unloading never race with a build. The voxel copies share their words with the chunk
+// and its neighbors until one of them is edited (see PaletteStorage), so a snapshot costs
+// little more than the light it copies. Unloaded neighbors fall back to the source
+// chunk's terrain prediction, whose caches do not change after generation; the handle
+// keeps that chunk alive until the job lets go of it.
+//
+// Meshers read a padded copy: the chunk plus a one voxel shell taken from the neighbors
+// (or predicted), so lookups across the border are plain array reads. Light is padded the
+// same way, from the layer each neighbor shares with the chunk.
+class ChunkSnapshot
+{
+public:
+    static constexpr int PADDED_SIZE = CHUNK_SIZE + 2;
+    static constexpr int PADDED_HEIGHT = CHUNK_HEIGHT + 2;
+    static constexpr int PADDED_VOLUME = PADDED_SIZE * PADDED_HEIGHT * PADDED_SIZE;
+
+    explicit ChunkSnapshot(std::shared_ptr<const VoxelChunk> chunk);
+
+    // Index into a padded buffer, x-major like VoxelChunk::coordsToIndex; x, y, z in [-1, SIZE]
+    static int paddedIndex(int x, int y, int z)
+    {
+        return ((x + 1) * PADDED_HEIGHT + (y + 1)) * PADDED_SIZE + (z + 1);
+    }
+
+    // Chunk position in world chunk coordinates
+    glm::ivec3 position;
+    // VoxelChunk::version of the source when captured: behind it once the chunk is edited
+    uint64_t version;
+
+    void decodeVoxels(VoxelID *out) const { voxels.decodeAll(out); }
+    // Fill PADDED_VOLUME voxels from decoded (decodeVoxels output) and the neighbor shell,
+    // with the values VoxelChunk::getVoxelWithNeighbors would return
+    void decodePadded(const VoxelID *decoded, VoxelID *out) const;
+    // Faces (bit per NeighborDirection) with no neighbor loaded, whose shell is predicted
+    uint8_t getPredictedFaces() const;
+    // Fill PADDED_VOLUME light values: the chunk's, and on the six shell faces the loaded
+    // neighbors' (the chunk's own border layer where none is). Edges and corners of the shell
+    // are left unspecified; no face reads them.
+    void decodePaddedLight(uint8_t *out) const;
+    bool isUniform() const { return voxels.isUniform(); }
+    VoxelID getUniformVoxel() const { return voxels.getPalette()[0]; }
+
+private:
+    std::shared_ptr<const VoxelChunk> source;
+    PaletteStorage voxels;
+    std::array<std::optional<PaletteStorage>, 6> neighbor_voxels; // Empty if not loaded
+    LightStorage light;
+    std::array<std::vector<uint8_t>, 6> neighbor_light; // Shared layer (layerIndex order), empty if not loaded
+};
+
+#endif // CHUNK_SNAPSHOT_H
@@ -0,0 +1,150 @@
+#include "chunk_stream_client.h"
+#include "log.h"
+#include <algorithm>
+#include <string>
+
+ChunkStreamClient::ChunkStreamClient(VoxelWorld &world, size_t cache_limit)
+    : world(world), cache_limit(cache_limit)
+{
+    world.setRemoteChunks(true);
+}
+
+bool ChunkStreamClient::receive(const unsigned char *data, size_t size)
+{
+    input.insert(input.end(), data, data + size);
+
+    size_t offset = 0;
+    ChunkProtocol::Message message;
+    while (true)
+    {
+        ChunkProtocol::ReadStatus status = ChunkProtocol::readMessage(input.data(), input.size(), offset, message);
+        if (status == ChunkProtocol::ReadStatus::Incomplete)
+        {
+            break;
+        }
+        if (status == ChunkProtocol::ReadStatus::Malformed || !handle(message))
+        {
+            Log::write(LogLevel::Error, "Chunk stream: dropping a malformed stream from the server");
+            input.clear();
+            return false;
+        }
+    }
+    input.erase(input.begin(), input.begin() + static_cast<std::ptrdiff_t>(offset));
+    return true;
+}
+
+void ChunkStreamClient::announceCache()
+{
+    std::vector<CachedChunkEntry> entries;
+    entries.reserve(cache.size());
+    for (const auto &[chunk_pos, chunk] : cache)
+    {
+        entries.push_back({chunk_pos, chunk.revision});
+    }
+    ChunkProtocol::writeCachedChunks(output, entries);
+}
+
+void ChunkStreamClient::takeOutput(std::vector<unsigned char> &out)
+{
+    out.insert(out.end(), output.begin(), output.end());
+    output.clear();
+}
+
+bool ChunkStreamClient::handle(const ChunkProtocol::Message &message)
+{
+    const glm::ivec3 &chunk_pos = message.position;
+    switch (message.type)
+    {
+    case StreamMessage::Hello:
+        if (message.seed != world.getSeed())
+        {
+            Log::write(LogLevel::Error, "Chunk stream: the server runs seed " + std::to_string(message.seed) +
+                                            ", this world " + std::to_string(world.getSeed()));
+            return false;
+        }
+        world.setTerrainMode(message.mode);
+        has_hello = true;
+        break;
+
+    case StreamMessage::ChunkData:
+        if (!world.receiveChunk(chunk_pos, message.runs, message.runs_size))
+        {
+            return false;
+        }
+        revisions[chunk_pos] = message.revision;
+        cache.erase(chunk_pos);
+        break;
+
+    case StreamMessage::ChunkReuse:
+    {
+        auto cached = cache.find(chunk_pos);
+        if (cached == cache.end() || cached->second.revision != message.revision ||
+            !world.receiveChunk(chunk_pos, cached->second.runs.data(), cached->second.runs.size()))
+        {
+            // Evicted since it was announced
+            ChunkProtocol::writeChunkRequest(output, chunk_pos);
+            break;
+        }
+        revisions[chunk_pos] = message.revision;
+        cache.erase(cached);
+        break;
+    }
+
+    case StreamMessage::ChunkDelta:
+    {
+        auto held = revisions.find(chunk_pos);
+        if (held == revisions.end() || held->second != message.base_revision || !world.isChunkLoaded(chunk_pos))
+        {
+            ChunkProtocol::writeChunkRequest(output, chunk_pos);
+            break;
+        }
+        glm::ivec3 origin = VoxelWorld::chunkToWorld(chunk_pos);
+        edits.clear();
+        for (const ChunkDeltaEdit &edit : message.edits)
+        {
+            glm::ivec3 local(ChunkIndexing::getX(edit.index), ChunkIndexing::getY(edit.index), ChunkIndexing::getZ(edit.index));
+            edits.push_back({origin + local, edit.voxel});
+        }
+        world.applyEdits(edits);
+        held->second = message.revision;
+        break;
+    }
+
+    case StreamMessage::ChunkUnload:
+    {
+        auto held = revisions.find(chunk_pos);
+        if (held != revisions.end())
+        {
+            cacheChunk(chunk_pos, held->second);
+            revisions.erase(held);
+        }
+        world.unloadChunk(chunk_pos);
+        break;
+    }
+
+    default:
+        break; // Client to server messages, or newer ones
+    }
+    return true;
+}
+
+void ChunkStreamClient::cacheChunk(const glm::ivec3 &chunk_pos, uint64_t revision)
+{
+    const VoxelChunk *chunk = world.getChunk(chunk_pos);
+    if (!chunk || cache_limit == 0)
+    {
+        return;
+    }
+    if (cache.size() >= cache_limit && cache.find(chunk_pos) == cache.end())
+    {
+        auto oldest = std::min_element(cache.begin(), cache.end(), [](const auto &a, const auto &b)
+                                       { return a.second.last_used < b.second.last_used; });
+        cache.erase(oldest);
+    }
+
+    CachedChunk &entry = cache[chunk_pos];
+    entry.revision = revision;
+    entry.last_used = ++use_counter;
+    entry.runs.clear();
+    chunk->voxels.encodeRuns(entry.runs);
+}
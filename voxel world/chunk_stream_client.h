@@ -0,0 +1,66 @@
+#ifndef CHUNK_STREAM_CLIENT_H
+#define CHUNK_STREAM_CLIENT_H
+
+#include "chunk_protocol.h"
+#include "voxel_world.h"
+#include <glm/glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Client half of the chunk stream (see chunk_protocol.h): fills a world from a server instead
+// of generating it.
+//
+// The world is switched to remote chunks (VoxelWorld::setRemoteChunks) and received chunks
+// go through VoxelWorld::receiveChunk, so they are linked, lit and meshed like generated
+// ones; deltas become one VoxelWorld::applyEdits batch. Chunks the server unloads are kept
+// encoded in a cache of up to cache_limit chunks (least recently used go first), reported
+// with announceCache and reused when the server says they are still current.
+//
+// The world has to be created with the seed of the server's Hello: it still predicts the
+// borders of chunks not received yet from the terrain noise.
+class ChunkStreamClient
+{
+public:
+    static constexpr size_t DEFAULT_CACHE_CHUNKS = 4096;
+
+    explicit ChunkStreamClient(VoxelWorld &world, size_t cache_limit = DEFAULT_CACHE_CHUNKS);
+
+    // Main thread. Bytes from the server, any split; false once the stream is malformed or
+    // the server runs another seed (the connection should then be dropped)
+    bool receive(const unsigned char *data, size_t size);
+
+    // Tell the server which chunks are cached (e.g. right after connecting)
+    void announceCache();
+
+    // Append the bytes queued for the server since the last call
+    void takeOutput(std::vector<unsigned char> &out);
+
+    bool hasHello() const { return has_hello; }
+    size_t getCachedChunkCount() const { return cache.size(); }
+
+private:
+    struct CachedChunk
+    {
+        uint64_t revision;
+        uint64_t last_used;
+        std::vector<unsigned char> runs; // PaletteStorage run encoding
+    };
+
+    VoxelWorld &world;
+    size_t cache_limit;
+    bool has_hello = false;
+    uint64_t use_counter = 0;
+
+    std::unordered_map<glm::ivec3, uint64_t, Vec3Hash> revisions; // Of the chunks in the world
+    std::unordered_map<glm::ivec3, CachedChunk, Vec3Hash> cache;
+    std::vector<unsigned char> input; // Start of an incomplete message
+    std::vector<unsigned char> output;
+    std::vector<VoxelEdit> edits;
+
+    bool handle(const ChunkProtocol::Message &message);
+    void cacheChunk(const glm::ivec3 &chunk_pos, uint64_t revision);
+};
+
+#endif // CHUNK_STREAM_CLIENT_H
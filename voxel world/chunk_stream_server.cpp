@@ -0,0 +1,256 @@
+#include "chunk_stream_server.h"
+#include "profiler.h"
+#include <random>
+
+ChunkStreamServer::ChunkStreamServer(VoxelWorld &world) : world(world), render_distance(world.getRenderDistance())
+{
+    // Low bits left free for this session's edits
+    std::random_device random;
+    base_revision = ((static_cast<uint64_t>(random()) << 32) ^ random()) & ~0xFFFFFFull;
+    next_revision = base_revision + 1;
+    world.setEditListener([this](const glm::ivec3 &position, VoxelID voxel)
+                          { voxelChanged(position, voxel); });
+}
+
+ChunkStreamServer::~ChunkStreamServer()
+{
+    world.setEditListener(nullptr);
+    for (const auto &[client, state] : clients)
+    {
+        world.removeViewer(client);
+    }
+}
+
+uint32_t ChunkStreamServer::connect(const glm::vec3 &position)
+{
+    uint32_t client = world.addViewer(position);
+    Client &state = clients[client];
+    state.center = VoxelWorld::worldToChunk(position);
+    ChunkProtocol::writeHello(state.output, world.getSeed(), world.getTerrainMode());
+    return client;
+}
+
+void ChunkStreamServer::disconnect(uint32_t client)
+{
+    if (clients.erase(client) > 0)
+    {
+        world.removeViewer(client);
+    }
+}
+
+void ChunkStreamServer::move(uint32_t client, const glm::vec3 &position)
+{
+    auto it = clients.find(client);
+    if (it == clients.end())
+    {
+        return;
+    }
+    world.moveViewer(client, position);
+    glm::ivec3 center_chunk = VoxelWorld::worldToChunk(position);
+    if (center_chunk != it->second.center)
+    {
+        it->second.center = center_chunk;
+        it->second.moved = true;
+        it->second.complete = false;
+    }
+}
+
+bool ChunkStreamServer::receive(uint32_t client, const unsigned char *data, size_t size)
+{
+    auto it = clients.find(client);
+    if (it == clients.end())
+    {
+        return false;
+    }
+    Client &state = it->second;
+    state.input.insert(state.input.end(), data, data + size);
+
+    size_t offset = 0;
+    ChunkProtocol::Message message;
+    while (true)
+    {
+        ChunkProtocol::ReadStatus status = ChunkProtocol::readMessage(state.input.data(), state.input.size(), offset, message);
+        if (status == ChunkProtocol::ReadStatus::Malformed)
+        {
+            state.input.clear();
+            return false;
+        }
+        if (status == ChunkProtocol::ReadStatus::Incomplete)
+        {
+            break;
+        }
+        handle(state, message);
+    }
+    state.input.erase(state.input.begin(), state.input.begin() + static_cast<std::ptrdiff_t>(offset));
+    return true;
+}
+
+void ChunkStreamServer::handle(Client &client, const ChunkProtocol::Message &message)
+{
+    switch (message.type)
+    {
+    case StreamMessage::CachedChunks:
+        for (const CachedChunkEntry &entry : message.cached)
+        {
+            if (client.loaded.find(entry.position) == client.loaded.end() && client.cached.size() < MAX_CACHED_PER_CLIENT)
+            {
+                client.cached[entry.position] = entry.revision;
+            }
+        }
+        break;
+    case StreamMessage::ChunkRequest:
+        // Sent again by the next update, in distance order with the rest
+        client.loaded.erase(message.position);
+        client.cached.erase(message.position);
+        client.complete = false;
+        break;
+    default:
+        break; // Server to client messages, or newer ones
+    }
+}
+
+void ChunkStreamServer::update()
+{
+    PROFILE_ZONE("ChunkStreamServer::update");
+    sendDeltas();
+    bool resized = world.getRenderDistance() != render_distance;
+    render_distance = world.getRenderDistance();
+    for (auto &[id, client] : clients)
+    {
+        if (resized)
+        {
+            client.moved = true;
+            client.complete = false;
+        }
+        unloadLeaving(client);
+        sendMissing(client);
+    }
+}
+
+void ChunkStreamServer::takeOutput(uint32_t client, std::vector<unsigned char> &out)
+{
+    auto it = clients.find(client);
+    if (it == clients.end())
+    {
+        return;
+    }
+    std::vector<unsigned char> &output = it->second.output;
+    out.insert(out.end(), output.begin(), output.end());
+    stats.bytes_sent += output.size();
+    output.clear();
+}
+
+uint64_t ChunkStreamServer::getRevision(const glm::ivec3 &chunk_pos) const
+{
+    auto it = revisions.find(chunk_pos);
+    return it != revisions.end() ? it->second : base_revision;
+}
+
+void ChunkStreamServer::voxelChanged(const glm::ivec3 &position, VoxelID voxel)
+{
+    glm::ivec3 local = VoxelWorld::worldToLocal(position);
+    tick_edits[VoxelWorld::worldToChunk(position)].push_back(
+        {static_cast<uint16_t>(VoxelChunk::coordsToIndex(local.x, local.y, local.z)), voxel});
+}
+
+void ChunkStreamServer::sendDeltas()
+{
+    for (const auto &[chunk_pos, edits] : tick_edits)
+    {
+        uint64_t base = getRevision(chunk_pos);
+        uint64_t revision = next_revision++;
+        revisions[chunk_pos] = revision;
+
+        // Clients caching the old revision find out when the chunk comes back into range
+        for (auto &[id, client] : clients)
+        {
+            auto held = client.loaded.find(chunk_pos);
+            if (held != client.loaded.end() && held->second == base)
+            {
+                ChunkProtocol::writeChunkDelta(client.output, chunk_pos, base, revision, edits);
+                held->second = revision;
+                stats.deltas_sent++;
+            }
+        }
+    }
+    tick_edits.clear();
+}
+
+void ChunkStreamServer::unloadLeaving(Client &client)
+{
+    if (!client.moved)
+    {
+        return;
+    }
+    client.moved = false;
+
+    int distance = world.getRenderDistance();
+    for (auto it = client.loaded.begin(); it != client.loaded.end();)
+    {
+        if (VoxelWorld::isKeepOffset(it->first - client.center, distance))
+        {
+            ++it;
+            continue;
+        }
+        ChunkProtocol::writeChunkUnload(client.output, it->first);
+        if (client.cached.size() < MAX_CACHED_PER_CLIENT)
+        {
+            client.cached[it->first] = it->second;
+        }
+        it = client.loaded.erase(it);
+    }
+}
+
+void ChunkStreamServer::sendMissing(Client &client)
+{
+    if (client.complete)
+    {
+        return;
+    }
+
+    size_t budget = chunks_per_tick;
+    bool missing = false;
+    for (const glm::ivec3 &offset : world.getLoadOffsets())
+    {
+        glm::ivec3 chunk_pos = client.center + offset;
+        if (client.loaded.find(chunk_pos) != client.loaded.end())
+        {
+            continue;
+        }
+        if (world.isChunkImplicit(chunk_pos))
+        {
+            continue; // Never stored; the client predicts it from the terrain like the server
+        }
+        const VoxelChunk *chunk = world.getChunk(chunk_pos);
+        if (!chunk || !chunk->is_generated)
+        {
+            missing = true; // Still generating on the server
+            continue;
+        }
+        if (budget == 0)
+        {
+            missing = true;
+            break;
+        }
+        budget--;
+
+        uint64_t revision = getRevision(chunk_pos);
+        auto cached = client.cached.find(chunk_pos);
+        if (cached != client.cached.end() && cached->second == revision)
+        {
+            ChunkProtocol::writeChunkReuse(client.output, chunk_pos, revision);
+            stats.chunks_reused++;
+        }
+        else
+        {
+            ChunkProtocol::writeChunkData(client.output, chunk_pos, revision, chunk->voxels);
+            stats.chunks_sent++;
+        }
+        if (cached != client.cached.end())
+        {
+            client.cached.erase(cached);
+        }
+        client.loaded[chunk_pos] = revision;
+    }
+    client.complete = !missing;
+}
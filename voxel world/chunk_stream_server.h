@@ -0,0 +1,96 @@
+#ifndef CHUNK_STREAM_SERVER_H
+#define CHUNK_STREAM_SERVER_H
+
+#include "chunk_protocol.h"
+#include "voxel_world.h"
+#include <glm/glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Server half of the chunk stream (see chunk_protocol.h): keeps every connected client's
+// world in step with the server's.
+//
+// Each client is a viewer of the world (VoxelWorld::addViewer), so the server loads what its
+// clients need. Per client, the chunks it holds and the revision it holds them at are
+// tracked: chunks of its load range go out nearest first once the server has them, a budget
+// per tick, and the ones leaving its keep range are unloaded there (the client caches them).
+// Voxel changes, wherever they come from (commands, water), are collected through the world's
+// edit listener and sent once per tick as a delta per chunk to the clients holding it.
+// Output is a byte stream per client for the transport to send.
+class ChunkStreamServer
+{
+public:
+    static constexpr size_t DEFAULT_CHUNKS_PER_TICK = 16; // Whole chunks sent per client and tick
+    static constexpr size_t MAX_CACHED_PER_CLIENT = 8192; // Client cache entries remembered
+
+    struct Stats
+    {
+        uint64_t chunks_sent = 0;
+        uint64_t chunks_reused = 0; // Announced from the client cache instead of sent
+        uint64_t deltas_sent = 0;
+        uint64_t bytes_sent = 0;
+    };
+
+    explicit ChunkStreamServer(VoxelWorld &world); // Takes the world's edit listener
+    ~ChunkStreamServer();
+
+    ChunkStreamServer(const ChunkStreamServer &) = delete;
+    ChunkStreamServer &operator=(const ChunkStreamServer &) = delete;
+
+    // Main thread. A new client viewing the world from position; returns its id
+    uint32_t connect(const glm::vec3 &position);
+    void disconnect(uint32_t client);
+    void move(uint32_t client, const glm::vec3 &position);
+
+    // Bytes from the client (CachedChunks, ChunkRequest), any split; false once the stream
+    // is malformed, the client should then be disconnected
+    bool receive(uint32_t client, const unsigned char *data, size_t size);
+
+    // Main thread, every tick after VoxelWorld::updateViewers: this tick's deltas, unloads,
+    // then chunks to send
+    void update();
+
+    // Append the bytes queued for a client since the last call
+    void takeOutput(uint32_t client, std::vector<unsigned char> &out);
+
+    void setChunksPerTick(size_t chunks) { chunks_per_tick = chunks > 0 ? chunks : 1; }
+    size_t getClientCount() const { return clients.size(); }
+    const Stats &getStats() const { return stats; }
+
+private:
+    struct Client
+    {
+        glm::ivec3 center;
+        bool complete = false; // Holds every chunk of its load range the server has loaded
+        bool moved = true;     // Its keep range needs checking for unloads
+        std::unordered_map<glm::ivec3, uint64_t, Vec3Hash> loaded; // Sent and not unloaded, at revision
+        std::unordered_map<glm::ivec3, uint64_t, Vec3Hash> cached; // Unloaded or reported cached
+        std::vector<unsigned char> input;                          // Start of an incomplete message
+        std::vector<unsigned char> output;
+    };
+
+    VoxelWorld &world;
+    size_t chunks_per_tick = DEFAULT_CHUNKS_PER_TICK;
+    int render_distance; // Ranges the clients were last checked against
+    Stats stats;
+
+    // Revisions start at a base unique to this session, so a client cache from another
+    // session (or another world on the same seed) never matches
+    uint64_t base_revision;
+    uint64_t next_revision;
+    std::unordered_map<glm::ivec3, uint64_t, Vec3Hash> revisions; // Chunks edited this session
+
+    std::unordered_map<uint32_t, Client> clients; // By viewer id
+    std::unordered_map<glm::ivec3, std::vector<ChunkDeltaEdit>, Vec3Hash> tick_edits;
+
+    uint64_t getRevision(const glm::ivec3 &chunk_pos) const;
+    void voxelChanged(const glm::ivec3 &position, VoxelID voxel);
+    void handle(Client &client, const ChunkProtocol::Message &message);
+    void sendDeltas();
+    void unloadLeaving(Client &client);
+    void sendMissing(Client &client);
+};
+
+#endif // CHUNK_STREAM_SERVER_H
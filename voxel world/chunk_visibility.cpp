@@ -0,0 +1,184 @@
+#include "chunk_visibility.h"
+#include "voxel_chunk.h"
+#include "voxel_world.h"
+#include <algorithm>
+
+uint16_t computeFaceConnectivity(const VoxelID *voxels)
+{
+    constexpr int SIZE = CHUNK_SIZE;
+    constexpr int HEIGHT = CHUNK_HEIGHT;
+
+    // Reused per thread, so meshing workers do not allocate per chunk
+    thread_local std::vector<uint8_t> visited;
+    thread_local std::vector<int> stack;
+    visited.assign(CHUNK_VOLUME, 0);
+
+    uint16_t connectivity = FACE_CONNECTIVITY_NONE;
+    for (int start = 0; start < CHUNK_VOLUME && connectivity != FACE_CONNECTIVITY_ALL; start++)
+    {
+        if (visited[start] || !isVoxelTransparent(voxels[start]))
+        {
+            continue;
+        }
+
+        // Flood one see-through region and collect the chunk faces it touches
+        int touched = 0;
+        visited[start] = 1;
+        stack.clear();
+        stack.push_back(start);
+        while (!stack.empty())
+        {
+            int index = stack.back();
+            stack.pop_back();
+
+            int x = ChunkIndexing::getX(index);
+            int y = ChunkIndexing::getY(index);
+            int z = ChunkIndexing::getZ(index);
+
+            auto visit = [&](bool inside, int neighbor, int face)
+            {
+                if (!inside)
+                {
+                    touched |= 1 << face;
+                }
+                else if (!visited[neighbor] && isVoxelTransparent(voxels[neighbor]))
+                {
+                    visited[neighbor] = 1;
+                    stack.push_back(neighbor);
+                }
+            };
+
+            visit(z + 1 < SIZE, ChunkIndexing::index(x, y, z + 1), FACE_FRONT);
+            visit(z > 0, ChunkIndexing::index(x, y, z - 1), FACE_BACK);
+            visit(x + 1 < SIZE, ChunkIndexing::index(x + 1, y, z), FACE_RIGHT);
+            visit(x > 0, ChunkIndexing::index(x - 1, y, z), FACE_LEFT);
+            visit(y + 1 < HEIGHT, ChunkIndexing::index(x, y + 1, z), FACE_TOP);
+            visit(y > 0, ChunkIndexing::index(x, y - 1, z), FACE_BOTTOM);
+        }
+
+        for (int a = 0; a < 6; a++)
+        {
+            for (int b = a + 1; b < 6; b++)
+            {
+                if ((touched >> a & 1) && (touched >> b & 1))
+                {
+                    connectivity |= static_cast<uint16_t>(1u << faceConnectionBit(a, b));
+                }
+            }
+        }
+    }
+    return connectivity;
+}
+
+bool ChunkVisibility::update(const VoxelWorld &world, const glm::vec3 &camera_position)
+{
+    clearReached();
+    frontier.clear();
+
+    const VoxelChunk *start = world.getChunk(VoxelWorld::worldToChunk(camera_position));
+    active = start != nullptr;
+    if (!active)
+    {
+        return false;
+    }
+
+    insertReached(start);
+    frontier.push_back({start, -1, 0});
+
+    // Breadth-first: frontier is consumed front to back while new steps are appended
+    for (size_t next = 0; next < frontier.size(); next++)
+    {
+        Step step = frontier[next];
+        for (int dir = 0; dir < 6; dir++)
+        {
+            // Neighbor directions come in +/- pairs: 0/1, 2/3, 4/5
+            int opposite = dir ^ 1;
+            if (step.directions & (1 << opposite))
+            {
+                continue;
+            }
+            if (step.entry_face >= 0 && !facesConnected(step.chunk->face_connectivity, step.entry_face, dir))
+            {
+                continue;
+            }
+
+            const VoxelChunk *neighbor = step.chunk->getNeighbor(dir);
+            if (!neighbor || !insertReached(neighbor))
+            {
+                continue;
+            }
+            frontier.push_back({neighbor, opposite, static_cast<uint8_t>(step.directions | (1 << dir))});
+        }
+    }
+    return true;
+}
+
+size_t ChunkVisibility::getSlot(const VoxelChunk *chunk, size_t slot_count)
+{
+    // Chunks are at least 16-byte aligned; the multiply spreads the rest over the high bits
+    uint64_t hash = (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(chunk)) >> 4) * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>(hash >> 32) & (slot_count - 1);
+}
+
+void ChunkVisibility::clearReached()
+{
+    if (reached.empty())
+    {
+        reached.resize(MIN_REACHED_SLOTS, nullptr);
+    }
+    else if (reached_count > 0)
+    {
+        std::fill(reached.begin(), reached.end(), nullptr);
+    }
+    reached_count = 0;
+}
+
+bool ChunkVisibility::isReached(const VoxelChunk *chunk) const
+{
+    if (reached_count == 0)
+    {
+        return false;
+    }
+    for (size_t slot = getSlot(chunk, reached.size());; slot = (slot + 1) & (reached.size() - 1))
+    {
+        if (reached[slot] == chunk)
+        {
+            return true;
+        }
+        if (!reached[slot])
+        {
+            return false;
+        }
+    }
+}
+
+bool ChunkVisibility::insertReached(const VoxelChunk *chunk)
+{
+    if ((reached_count + 1) * 2 > reached.size())
+    {
+        // Grows with the world only: the larger table is kept from then on
+        std::vector<const VoxelChunk *> previous(std::max(MIN_REACHED_SLOTS, reached.size() * 2), nullptr);
+        previous.swap(reached);
+        reached_count = 0;
+        for (const VoxelChunk *old : previous)
+        {
+            if (old)
+            {
+                insertReached(old);
+            }
+        }
+    }
+
+    size_t slot = getSlot(chunk, reached.size());
+    while (reached[slot])
+    {
+        if (reached[slot] == chunk)
+        {
+            return false;
+        }
+        slot = (slot + 1) & (reached.size() - 1);
+    }
+    reached[slot] = chunk;
+    reached_count++;
+    return true;
+}
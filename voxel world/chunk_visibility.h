@@ -0,0 +1,71 @@
+#ifndef CHUNK_VISIBILITY_H
+#define CHUNK_VISIBILITY_H
+
+#include "voxel_types.h"
+#include <glm/glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+class VoxelChunk;
+class VoxelWorld;
+
+// Bit of the 15-bit connectivity mask for two different faces (FaceDirection order)
+inline int faceConnectionBit(int a, int b)
+{
+    if (a > b)
+    {
+        int t = a;
+        a = b;
+        b = t;
+    }
+    return a * (11 - a) / 2 + (b - a - 1);
+}
+
+inline bool facesConnected(uint16_t connectivity, int a, int b)
+{
+    return (connectivity >> faceConnectionBit(a, b)) & 1;
+}
+
+// Which pairs of chunk faces can see each other through see-through voxels (anything
+// isVoxelTransparent), found by flood-filling every see-through region once.
+// voxels is a full chunk in VoxelChunk::coordsToIndex order.
+uint16_t computeFaceConnectivity(const VoxelID *voxels);
+
+// Cave/occlusion culling: a breadth-first walk from the camera's chunk through chunk
+// neighbors, only leaving a chunk through a face connected to the one it was entered by,
+// and never stepping back toward the camera. Chunks it cannot reach are hidden behind
+// opaque terrain.
+class ChunkVisibility
+{
+public:
+    // Returns false (everything counts as visible) when the camera's chunk is not loaded
+    bool update(const VoxelWorld &world, const glm::vec3 &camera_position);
+
+    void disable() { active = false; clearReached(); } // Every chunk counts as visible
+    bool isVisible(const VoxelChunk *chunk) const { return !active || isReached(chunk); }
+    size_t getReachedCount() const { return reached_count; }
+
+private:
+    struct Step
+    {
+        const VoxelChunk *chunk;
+        int entry_face;     // -1 for the camera's chunk
+        uint8_t directions; // Directions travelled so far (bit per NeighborDirection)
+    };
+
+    static constexpr size_t MIN_REACHED_SLOTS = 1024;
+
+    bool active = false;
+    // Open-addressed set of the reached chunks (null slots are free, kept at most half full);
+    // it keeps its slots across walks, so a walk over as many chunks as before allocates nothing
+    std::vector<const VoxelChunk *> reached;
+    size_t reached_count = 0;
+    std::vector<Step> frontier;
+
+    static size_t getSlot(const VoxelChunk *chunk, size_t slot_count);
+    void clearReached();
+    bool isReached(const VoxelChunk *chunk) const;
+    bool insertReached(const VoxelChunk *chunk); // False if it was already there
+};
+
+#endif // CHUNK_VISIBILITY_H
@@ -0,0 +1,327 @@
+#include "clustered_lights.h"
+#include "voxel_world.h"
+#include "voxel_light.h"
+#include "block_registry.h"
+#include "profiler.h"
+#include "../shader.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+ClusteredLights::ClusteredLights(JobSystem &job_system)
+    : job_system(job_system), light_buffer(0), range_buffer(0), index_buffer(0), light_texture(0), range_texture(0),
+      index_texture(0), bin_view(1.0f), bin_focal(0.0f), tile_size(1.0f), bounds_focal(0.0f), uploaded_light_count(0),
+      bin_frame(0), bin_claimed(0), bin_pending(false)
+{
+}
+
+ClusteredLights::~ClusteredLights()
+{
+    // The job references this object
+    finish();
+    while (bin_job && !JobSystem::isDone(bin_job))
+    {
+        std::this_thread::yield();
+    }
+
+    GLuint textures[] = {light_texture, range_texture, index_texture};
+    GLuint buffers[] = {light_buffer, range_buffer, index_buffer};
+    glDeleteTextures(3, textures);
+    glDeleteBuffers(3, buffers);
+}
+
+bool ClusteredLights::initialize()
+{
+    GLuint buffers[3];
+    GLuint textures[3];
+    glGenBuffers(3, buffers);
+    glGenTextures(3, textures);
+    light_buffer = buffers[0];
+    range_buffer = buffers[1];
+    index_buffer = buffers[2];
+    light_texture = textures[0];
+    range_texture = textures[1];
+    index_texture = textures[2];
+
+    const GLenum formats[] = {GL_RGBA32F, GL_RG32UI, GL_R16UI};
+    for (int i = 0; i < 3; i++)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    std::cout << "Block lights: " << GRID_X << "x" << GRID_Y << "x" << GRID_Z << " clusters, up to " << MAX_LIGHTS
+              << " lights within " << LIGHT_RANGE << " blocks" << std::endl;
+    return glGetError() == GL_NO_ERROR;
+}
+
+void ClusteredLights::gather(const VoxelWorld &world, const glm::vec3 &camera_position)
+{
+    PROFILE_ZONE("ClusteredLights::gather");
+    finish(); // Never while the job reads the lights
+
+    candidates.clear();
+    const glm::ivec3 center = VoxelWorld::worldToChunk(camera_position);
+    const int reach_xz = static_cast<int>(std::ceil(LIGHT_RANGE / CHUNK_SIZE));
+    const int reach_y = static_cast<int>(std::ceil(LIGHT_RANGE / CHUNK_HEIGHT));
+    const BlockRegistry &registry = BlockRegistry::get();
+    for (int dx = -reach_xz; dx <= reach_xz; dx++)
+    {
+        for (int dz = -reach_xz; dz <= reach_xz; dz++)
+        {
+            for (int dy = -reach_y; dy <= reach_y; dy++)
+            {
+                const glm::ivec3 chunk_pos = center + glm::ivec3(dx, dy, dz);
+                const VoxelChunk *chunk = world.getChunk(chunk_pos);
+                if (!chunk)
+                {
+                    continue;
+                }
+                for (const VoxelEmitter &emitter : chunk->getEmitters())
+                {
+                    // Voxel centers: mesh vertices sit half a block around them
+                    const glm::vec3 position(chunk_pos.x * CHUNK_SIZE + ChunkIndexing::getX(emitter.index),
+                                             chunk_pos.y * CHUNK_HEIGHT + ChunkIndexing::getY(emitter.index),
+                                             chunk_pos.z * CHUNK_SIZE + ChunkIndexing::getZ(emitter.index));
+                    const float distance = glm::distance(position, camera_position);
+                    if (distance > LIGHT_RANGE)
+                    {
+                        continue;
+                    }
+
+                    // The block's map color at full brightness, scaled by its level
+                    const int emission = getLightEmission(emitter.voxel);
+                    const uint8_t *rgb = registry.getMapColor(emitter.voxel);
+                    glm::vec3 color(rgb[0], rgb[1], rgb[2]);
+                    color = color / std::max({color.x, color.y, color.z, 1.0f}) * (static_cast<float>(emission) / MAX_LIGHT);
+                    candidates.push_back({distance, glm::vec4(position, emission + 0.5f), glm::vec4(color, 0.0f)});
+                }
+            }
+        }
+    }
+
+    if (candidates.size() > MAX_LIGHTS)
+    {
+        std::nth_element(candidates.begin(), candidates.begin() + MAX_LIGHTS, candidates.end(),
+                         [](const Candidate &a, const Candidate &b) { return a.distance < b.distance; });
+        candidates.resize(MAX_LIGHTS);
+    }
+    lights.clear();
+    for (const Candidate &candidate : candidates)
+    {
+        lights.push_back(candidate.sphere);
+        lights.push_back(candidate.color);
+    }
+}
+
+float ClusteredLights::sliceDepth(int slice)
+{
+    // The first slice also takes everything nearer than CLUSTER_NEAR
+    if (slice == 0)
+    {
+        return 0.0f;
+    }
+    return CLUSTER_NEAR * std::pow(CLUSTER_FAR / CLUSTER_NEAR, static_cast<float>(slice) / GRID_Z);
+}
+
+bool ClusteredLights::claim(uint64_t frame)
+{
+    uint64_t claimed = bin_claimed.load();
+    while (claimed < frame)
+    {
+        if (bin_claimed.compare_exchange_weak(claimed, frame))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ClusteredLights::schedule(const glm::mat4 &view, const glm::mat4 &projection, int viewport_width, int viewport_height)
+{
+    finish();
+    if (lights.empty() || viewport_width <= 0 || viewport_height <= 0)
+    {
+        uploaded_light_count = 0;
+        return;
+    }
+
+    bin_view = view;
+    bin_focal = glm::vec2(projection[0][0], projection[1][1]);
+    tile_size = glm::vec2(viewport_width, viewport_height) / glm::vec2(GRID_X, GRID_Y);
+    const uint64_t frame = ++bin_frame;
+    bin_pending = true;
+    auto pass = [this, frame]()
+    {
+        if (claim(frame))
+        {
+            bin();
+        }
+    };
+    if (bin_job && JobSystem::isDone(bin_job))
+    {
+        job_system.resubmit(bin_job, pass, JobPriority::High);
+    }
+    else
+    {
+        bin_job = job_system.submit(pass, JobPriority::High);
+    }
+}
+
+void ClusteredLights::bin()
+{
+    PROFILE_ZONE("ClusteredLights::bin");
+    if (bin_focal != bounds_focal)
+    {
+        // View-space extent of each tile column and row per slice: the NDC edges scaled out
+        // to both slice depths (the projection is symmetric)
+        tile_x_bounds.resize(static_cast<size_t>(GRID_Z) * GRID_X);
+        tile_y_bounds.resize(static_cast<size_t>(GRID_Z) * GRID_Y);
+        for (int slice = 0; slice < GRID_Z; slice++)
+        {
+            const float near_depth = sliceDepth(slice);
+            const float far_depth = sliceDepth(slice + 1);
+            auto extent = [&](int tile, int tiles, float focal)
+            {
+                const float low = -1.0f + 2.0f * tile / tiles;
+                const float high = -1.0f + 2.0f * (tile + 1) / tiles;
+                return glm::vec2(std::min(low * near_depth, low * far_depth), std::max(high * near_depth, high * far_depth)) / focal;
+            };
+            for (int x = 0; x < GRID_X; x++)
+            {
+                tile_x_bounds[slice * GRID_X + x] = extent(x, GRID_X, bin_focal.x);
+            }
+            for (int y = 0; y < GRID_Y; y++)
+            {
+                tile_y_bounds[slice * GRID_Y + y] = extent(y, GRID_Y, bin_focal.y);
+            }
+        }
+        bounds_focal = bin_focal;
+    }
+
+    // Every froxel whose box the light's sphere reaches
+    const float slice_scale = GRID_Z / std::log(CLUSTER_FAR / CLUSTER_NEAR);
+    auto sliceOf = [slice_scale](float depth)
+    {
+        return depth <= CLUSTER_NEAR ? 0 : std::min(static_cast<int>(std::log(depth / CLUSTER_NEAR) * slice_scale), GRID_Z - 1);
+    };
+    auto outside = [](float value, const glm::vec2 &range)
+    {
+        return value < range.x ? range.x - value : value > range.y ? value - range.y : 0.0f;
+    };
+    pairs.clear();
+    const size_t light_count = lights.size() / 2;
+    for (size_t light = 0; light < light_count && pairs.size() < MAX_LIGHT_INDICES; light++)
+    {
+        const glm::vec4 &sphere = lights[light * 2];
+        const glm::vec3 center = glm::vec3(bin_view * glm::vec4(glm::vec3(sphere), 1.0f));
+        const float radius_squared = sphere.w * sphere.w;
+        const float depth = -center.z;
+        if (depth + sphere.w < 0.0f || depth - sphere.w > CLUSTER_FAR)
+        {
+            continue;
+        }
+        const int last_slice = sliceOf(std::min(depth + sphere.w, CLUSTER_FAR));
+        for (int slice = sliceOf(depth - sphere.w); slice <= last_slice; slice++)
+        {
+            const float dz = outside(depth, glm::vec2(sliceDepth(slice), sliceDepth(slice + 1)));
+            for (int y = 0; y < GRID_Y; y++)
+            {
+                const float dy = outside(center.y, tile_y_bounds[slice * GRID_Y + y]);
+                if (dz * dz + dy * dy > radius_squared)
+                {
+                    continue;
+                }
+                for (int x = 0; x < GRID_X; x++)
+                {
+                    const float dx = outside(center.x, tile_x_bounds[slice * GRID_X + x]);
+                    if (dz * dz + dy * dy + dx * dx <= radius_squared)
+                    {
+                        const uint32_t froxel = static_cast<uint32_t>((slice * GRID_Y + y) * GRID_X + x);
+                        pairs.push_back(froxel << 16 | static_cast<uint32_t>(light));
+                    }
+                }
+            }
+        }
+    }
+
+    // Counting sort by froxel: each froxel's lights end up contiguous
+    const size_t kept = std::min(pairs.size(), MAX_LIGHT_INDICES);
+    ranges.assign(static_cast<size_t>(CLUSTERS) * 2, 0);
+    for (size_t i = 0; i < kept; i++)
+    {
+        ranges[(pairs[i] >> 16) * 2 + 1]++;
+    }
+    uint32_t offset = 0;
+    for (int froxel = 0; froxel < CLUSTERS; froxel++)
+    {
+        ranges[froxel * 2] = offset;
+        offset += ranges[froxel * 2 + 1];
+        ranges[froxel * 2 + 1] = 0;
+    }
+    indices.resize(kept);
+    for (size_t i = 0; i < kept; i++)
+    {
+        const uint32_t froxel = pairs[i] >> 16;
+        indices[ranges[froxel * 2] + ranges[froxel * 2 + 1]++] = static_cast<uint16_t>(pairs[i] & 0xFFFF);
+    }
+}
+
+void ClusteredLights::finish()
+{
+    if (!bin_pending)
+    {
+        return;
+    }
+    bin_pending = false;
+
+    // Workers busy with long generation jobs may not have started it: then it runs here
+    if (claim(bin_frame))
+    {
+        bin();
+    }
+    while (!JobSystem::isDone(bin_job))
+    {
+        std::this_thread::yield();
+    }
+
+    uploaded_light_count = indices.empty() ? 0 : lights.size() / 2;
+    if (uploaded_light_count == 0)
+    {
+        return;
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, light_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, lights.size() * sizeof(glm::vec4), lights.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, range_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, ranges.size() * sizeof(uint32_t), ranges.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, index_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLights::bindTextures() const
+{
+    glActiveTexture(GL_TEXTURE0 + CLUSTER_LIGHT_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, light_texture);
+    glActiveTexture(GL_TEXTURE0 + CLUSTER_RANGE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, range_texture);
+    glActiveTexture(GL_TEXTURE0 + CLUSTER_INDEX_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, index_texture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void ClusteredLights::setUniforms(const Shader &program) const
+{
+    program.setInt("cluster_light_count", static_cast<int>(uploaded_light_count));
+    if (uploaded_light_count > 0)
+    {
+        glUniform2f(glGetUniformLocation(program.ID, "cluster_tile_size"), tile_size.x, tile_size.y);
+        glUniform2f(glGetUniformLocation(program.ID, "cluster_depth"), CLUSTER_NEAR,
+                    GRID_Z / std::log(CLUSTER_FAR / CLUSTER_NEAR));
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef CLUSTERED_LIGHTS_H
+#define CLUSTERED_LIGHTS_H
+
+#include "job_system.h"
+#include <glm/glm/glm.hpp>
+#include <glad/glad/glad.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Shader;
+class VoxelWorld;
+
+// Texture units of the cluster buffers, after the shadow maps (shadow_cascades.h)
+constexpr GLint CLUSTER_LIGHT_TEXTURE_UNIT = 5;
+constexpr GLint CLUSTER_RANGE_TEXTURE_UNIT = 6;
+constexpr GLint CLUSTER_INDEX_TEXTURE_UNIT = 7;
+
+// Point lights of the emitting voxels (block registry emission), shaded per fragment through
+// a clustered light list, so a fragment only loops over the lights that can reach it.
+//
+// The view frustum is cut into GRID_X x GRID_Y screen tiles and GRID_Z depth slices,
+// exponentially spaced from CLUSTER_NEAR to CLUSTER_FAR (froxels). Each frame the main thread
+// gathers the MAX_LIGHTS nearest emitters within LIGHT_RANGE from the chunks' emitter lists
+// (VoxelChunk::getEmitters, kept current as voxels are set), and a worker job bins every
+// light's sphere into the froxels it touches: a count per froxel, then one index list in
+// froxel order. The lists reach the shaders as texture buffers (GL 3.3), with the light
+// positions and colors. A light's radius is its emission level in blocks, as far as its flood
+// filled block light reaches; unlike that light, these pass through walls and add color and
+// a smooth falloff on top of it. Main thread, apart from the binning job.
+class ClusteredLights
+{
+public:
+    static constexpr int GRID_X = 16;
+    static constexpr int GRID_Y = 9;
+    static constexpr int GRID_Z = 24;
+    static constexpr int CLUSTERS = GRID_X * GRID_Y * GRID_Z;
+    static constexpr float CLUSTER_NEAR = 0.5f; // Blocks; nearer fragments fall in the first slice
+    static constexpr float CLUSTER_FAR = 128.0f;
+    static constexpr float LIGHT_RANGE = 96.0f; // From the camera; farther emitters are not gathered
+    static constexpr size_t MAX_LIGHTS = 512;
+    static constexpr size_t MAX_LIGHT_INDICES = 32768; // Froxel-light pairs kept per frame
+
+    explicit ClusteredLights(JobSystem &job_system);
+    ~ClusteredLights();
+
+    ClusteredLights(const ClusteredLights &) = delete;
+    ClusteredLights &operator=(const ClusteredLights &) = delete;
+
+    // Texture buffers
+    bool initialize();
+
+    // After the frame's chunk changes (VoxelRenderer::update): collect the lights around the camera
+    void gather(const VoxelWorld &world, const glm::vec3 &camera_position);
+
+    // Bin the gathered lights for this view on a worker (render: after the draw lists), then
+    // take the result and upload it before the first shaded pass
+    void schedule(const glm::mat4 &view, const glm::mat4 &projection, int viewport_width, int viewport_height);
+    void finish();
+
+    // Receivers: the buffers on their units and the lookup uniforms of voxel.fs and friends
+    void bindTextures() const;
+    void setUniforms(const Shader &program) const;
+
+    size_t getLightCount() const { return lights.size() / 2; }
+    size_t getIndexCount() const { return indices.size(); }
+
+private:
+    JobSystem &job_system;
+    GLuint light_buffer, range_buffer, index_buffer;
+    GLuint light_texture, range_texture, index_texture;
+
+    struct Candidate
+    {
+        float distance;
+        glm::vec4 sphere; // Position and radius
+        glm::vec4 color;
+    };
+
+    // Two texels per light: position and radius, then color; written by gather
+    std::vector<glm::vec4> lights;
+    std::vector<Candidate> candidates;
+
+    // Binning input and output; the job owns them between schedule and finish
+    glm::mat4 bin_view;
+    glm::vec2 bin_focal; // projection[0][0], projection[1][1]
+    glm::vec2 tile_size; // Pixels
+    std::vector<glm::vec2> tile_x_bounds; // Froxel view-space extent per (slice, tile column)
+    std::vector<glm::vec2> tile_y_bounds; // And per (slice, tile row)
+    glm::vec2 bounds_focal;               // The tile bounds were computed for this focal length
+    std::vector<uint32_t> pairs;          // Froxel << 16 | light
+    std::vector<uint32_t> ranges;         // First index and count per froxel
+    std::vector<uint16_t> indices;
+    size_t uploaded_light_count; // 0: the shaders skip the lookup
+
+    JobSystem::JobHandle bin_job; // Resubmitted once done
+    uint64_t bin_frame;
+    std::atomic<uint64_t> bin_claimed;
+    bool bin_pending;
+
+    bool claim(uint64_t frame);
+    void bin();
+    static float sliceDepth(int slice);
+};
+
+#endif // CLUSTERED_LIGHTS_H
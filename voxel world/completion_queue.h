@@ -0,0 +1,70 @@
+#ifndef COMPLETION_QUEUE_H
+#define COMPLETION_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// Lock-free multi-producer, single-consumer handoff of heap nodes (Node has a `Node *next`).
+//
+// Producers push with one compare-and-swap on the head and never wait on the consumer; the
+// consumer takes the whole list with one exchange and gets it back in push order. The queue
+// owns nodes between push and takeAll, and deletes any left over when destroyed.
+template <typename Node>
+class CompletionQueue
+{
+public:
+    CompletionQueue() = default;
+    ~CompletionQueue() { clear(); }
+
+    CompletionQueue(const CompletionQueue &) = delete;
+    CompletionQueue &operator=(const CompletionQueue &) = delete;
+
+    // Any thread; takes ownership of a node allocated with new
+    void push(Node *node)
+    {
+        count.fetch_add(1, std::memory_order_relaxed); // First, so takeAll never drops it below zero
+        node->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // Consumer only: every node pushed so far, oldest first (null if none), linked through
+    // next. The caller owns them afterwards.
+    Node *takeAll()
+    {
+        Node *newest = head.exchange(nullptr, std::memory_order_acquire);
+        Node *oldest = nullptr;
+        size_t taken = 0;
+        while (newest != nullptr)
+        {
+            Node *next = newest->next;
+            newest->next = oldest;
+            oldest = newest;
+            newest = next;
+            taken++;
+        }
+        count.fetch_sub(taken, std::memory_order_relaxed);
+        return oldest;
+    }
+
+    // Consumer only
+    void clear()
+    {
+        for (Node *node = takeAll(); node != nullptr;)
+        {
+            Node *next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    // Approximate while producers are pushing
+    size_t size() const { return count.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<Node *> head{nullptr};
+    std::atomic<size_t> count{0};
+};
+
+#endif // COMPLETION_QUEUE_H
@@ -0,0 +1,143 @@
+#ifndef COROUTINE_TASK_H
+#define COROUTINE_TASK_H
+
+#include "completion_queue.h"
+#include "job_system.h"
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+
+// Fire-and-forget coroutine: it starts running when called and frees its frame when it
+// returns. Its body moves between threads by awaiting resumeOn (a job system worker) and
+// MainThreadQueue::nextFrame. Exceptions must be caught inside; one escaping terminates.
+class Task
+{
+public:
+    struct promise_type
+    {
+        Task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// Shared flag telling a task its result is no longer wanted; copies share the flag. Tasks
+// check it at their suspension points (the awaits below return false once it is set).
+class CancelToken
+{
+public:
+    CancelToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void cancel() const { flag->store(true, std::memory_order_release); }
+    bool isCancelled() const { return flag->load(std::memory_order_acquire); }
+    bool operator==(const CancelToken &other) const { return flag == other.flag; }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag;
+};
+
+// co_await resumeOn(jobs, priority, token): continue on a worker as a job of that priority;
+// the result is false if the token was cancelled by the time the job runs. Only await it
+// while the job system is running (jobs submitted after shutdown never run).
+class JobAwaiter
+{
+public:
+    JobAwaiter(JobSystem &jobs, JobPriority priority, CancelToken token)
+        : jobs(jobs), priority(priority), token(std::move(token)) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        jobs.submit([handle]
+                    { handle.resume(); },
+                    priority);
+    }
+    bool await_resume() const { return !token.isCancelled(); }
+
+private:
+    JobSystem &jobs;
+    JobPriority priority;
+    CancelToken token;
+};
+
+inline JobAwaiter resumeOn(JobSystem &jobs, JobPriority priority, CancelToken token)
+{
+    return JobAwaiter(jobs, priority, std::move(token));
+}
+
+// Coroutines waiting for the main thread, resumed there by resumeAll (once a frame). Awaiting
+// nextFrame from any thread suspends until the next resumeAll call, in await order.
+class MainThreadQueue
+{
+public:
+    MainThreadQueue() = default;
+    MainThreadQueue(const MainThreadQueue &) = delete;
+    MainThreadQueue &operator=(const MainThreadQueue &) = delete;
+
+    class Awaiter
+    {
+    public:
+        explicit Awaiter(MainThreadQueue &queue) : queue(queue) {}
+
+        bool await_ready() const noexcept { return false; }
+        // The coroutine may run on the main thread as soon as it is posted: nothing of the
+        // awaiter is touched after that
+        void await_suspend(std::coroutine_handle<> handle) { queue.posted.push(new Resumption{handle}); }
+        void await_resume() const noexcept {}
+
+    private:
+        MainThreadQueue &queue;
+    };
+
+    Awaiter nextFrame() { return Awaiter(*this); }
+
+    // Main thread: resume what was posted before this call, oldest first, until budget_ms has
+    // passed (at least one is resumed); the rest keep their place for the next call. Returns
+    // the number resumed.
+    size_t resumeAll(float budget_ms = 1.0e9f)
+    {
+        for (Resumption *node = posted.takeAll(); node != nullptr;)
+        {
+            Resumption *next = node->next;
+            ready.push_back(node->handle);
+            delete node;
+            node = next;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        size_t resumed = 0;
+        for (size_t count = ready.size(); resumed < count; resumed++)
+        {
+            if (resumed > 0 &&
+                std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() >= budget_ms)
+            {
+                break;
+            }
+            // Popped first: the coroutine may await nextFrame again and post itself
+            std::coroutine_handle<> handle = ready.front();
+            ready.pop_front();
+            handle.resume();
+        }
+        return resumed;
+    }
+
+    // Approximate while other threads post
+    size_t size() const { return posted.size() + ready.size(); }
+
+private:
+    struct Resumption
+    {
+        std::coroutine_handle<> handle;
+        Resumption *next = nullptr;
+    };
+
+    CompletionQueue<Resumption> posted; // Any thread
+    std::deque<std::coroutine_handle<>> ready; // Main thread: taken, not resumed yet (budget)
+};
+
+#endif // COROUTINE_TASK_H
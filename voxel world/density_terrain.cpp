@@ -0,0 +1,267 @@
+#include "density_terrain.h"
+#include "block_registry.h"
+#include "chunk_snapshot.h"
+#include "voxel_noise.h"
+#include "profiler.h"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+constexpr int STEP = DensityTerrain::LATTICE_STEP;
+static_assert(CHUNK_SIZE % STEP == 0 && CHUNK_HEIGHT % STEP == 0, "Chunks must start on lattice points");
+
+constexpr int PADDED_SIZE = ChunkSnapshot::PADDED_SIZE;
+
+// A ground voxel's material depends on the MATERIAL_DEPTH voxels above it, so ground is
+// resolved that far above the top of the shell
+constexpr int MATERIAL_DEPTH = SURFACE_DEPTH;
+constexpr int GROUND_MIN_Y = -1;
+constexpr int GROUND_MAX_Y = CHUNK_HEIGHT + MATERIAL_DEPTH;
+constexpr int GROUND_HEIGHT = GROUND_MAX_Y - GROUND_MIN_Y + 1;
+
+// Lattice points at local (i - 1) * STEP: from one step before the shell to past GROUND_MAX_Y
+constexpr int LATTICE_SIZE = CHUNK_SIZE / STEP + 3;
+constexpr int LATTICE_HEIGHT = CHUNK_HEIGHT / STEP + 3;
+constexpr int LATTICE_POINTS = LATTICE_SIZE * LATTICE_HEIGHT * LATTICE_SIZE;
+static_assert(GROUND_MAX_Y <= (LATTICE_HEIGHT - 2) * STEP, "Lattice must cover the ground range");
+
+int latticeIndex(int x, int y, int z)
+{
+    return (z * LATTICE_HEIGHT + y) * LATTICE_SIZE + x; // GenUniformGrid3D order
+}
+
+int groundIndex(int x, int y, int z)
+{
+    return ((x + 1) * GROUND_HEIGHT + (y - GROUND_MIN_Y)) * PADDED_SIZE + (z + 1);
+}
+
+// The corners of one lattice cell; their trilinear blend stays in [min_value, max_value]
+struct LatticeCell
+{
+    float corners[8]; // Bit 0: +x, bit 1: +y, bit 2: +z
+    float min_value;
+    float max_value;
+
+    LatticeCell(const float *lattice, int cell_x, int cell_y, int cell_z)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            corners[i] = lattice[latticeIndex(cell_x + (i & 1), cell_y + ((i >> 1) & 1), cell_z + (i >> 2))];
+        }
+        auto bounds = std::minmax_element(corners, corners + 8);
+        min_value = *bounds.first;
+        max_value = *bounds.second;
+    }
+
+    // Blend along x and y (position inside the cell in [0, 1)), leaving the two values a z
+    // row runs between: sample(fz) is z0 + fz * (z1 - z0)
+    void blendRow(float fx, float fy, float &z0, float &z1) const
+    {
+        float x00 = corners[0] + fx * (corners[1] - corners[0]);
+        float x10 = corners[2] + fx * (corners[3] - corners[2]);
+        float x01 = corners[4] + fx * (corners[5] - corners[4]);
+        float x11 = corners[6] + fx * (corners[7] - corners[6]);
+        z0 = x00 + fy * (x10 - x00);
+        z1 = x01 + fy * (x11 - x01);
+    }
+};
+
+// Local voxel range of lattice cell index cell along one axis, clipped to [low, high]; empty
+// when first > last
+void cellRange(int cell, int low, int high, int &first, int &last)
+{
+    first = std::max((cell - 1) * STEP, low);
+    last = std::min(cell * STEP - 1, high);
+}
+
+// Per worker thread, reused across chunks
+struct DensityScratch
+{
+    std::vector<float> overhang = std::vector<float>(LATTICE_POINTS);
+    std::vector<float> caves = std::vector<float>(LATTICE_POINTS);
+    std::vector<uint8_t> ground = std::vector<uint8_t>(PADDED_SIZE * GROUND_HEIGHT * PADDED_SIZE);
+};
+}
+
+void DensityTerrain::generate(uint32_t seed, const glm::ivec3 &chunk_pos, const int *heights, const uint8_t *biomes,
+                              VoxelID *out)
+{
+    PROFILE_ZONE("DensityTerrain::generate");
+    thread_local DensityScratch scratch;
+
+    const glm::ivec3 origin = chunk_pos * glm::ivec3(CHUNK_SIZE, CHUNK_HEIGHT, CHUNK_SIZE);
+    auto height = [heights](int x, int z)
+    { return heights[(x + 1) * PADDED_SIZE + (z + 1)]; };
+    auto height_bounds = std::minmax_element(heights, heights + PADDED_SIZE * PADDED_SIZE);
+
+    // Below the lowest the surface can be pushed down everything is ground; caves only reach
+    // down to CAVE_MIN_Y. Fields that cannot change the result are not sampled.
+    const bool needs_overhang = origin.y + GROUND_MAX_Y >= *height_bounds.first - OVERHANG_AMPLITUDE;
+    const bool needs_caves = origin.y + CHUNK_HEIGHT >= CAVE_MIN_Y;
+    const glm::ivec3 lattice_start = origin / STEP - 1;
+    VoxelNoise::forThread(seed).generateDensityLattice(lattice_start.x, lattice_start.y, lattice_start.z, LATTICE_SIZE,
+                                                       LATTICE_HEIGHT, LATTICE_SIZE, STEP,
+                                                       needs_overhang ? scratch.overhang.data() : nullptr,
+                                                       needs_caves ? scratch.caves.data() : nullptr);
+
+    // Ground, a cell at a time
+    uint8_t *ground = scratch.ground.data();
+    if (!needs_overhang)
+    {
+        std::fill(scratch.ground.begin(), scratch.ground.end(), 1);
+    }
+    for (int cell_x = 0; needs_overhang && cell_x + 1 < LATTICE_SIZE; cell_x++)
+    {
+        int x_first, x_last;
+        cellRange(cell_x, -1, CHUNK_SIZE, x_first, x_last);
+        for (int cell_z = 0; cell_z + 1 < LATTICE_SIZE; cell_z++)
+        {
+            int z_first, z_last;
+            cellRange(cell_z, -1, CHUNK_SIZE, z_first, z_last);
+            if (x_first > x_last || z_first > z_last)
+            {
+                continue;
+            }
+
+            int min_height = height(x_first, z_first);
+            int max_height = min_height;
+            for (int x = x_first; x <= x_last; x++)
+            {
+                for (int z = z_first; z <= z_last; z++)
+                {
+                    min_height = std::min(min_height, height(x, z));
+                    max_height = std::max(max_height, height(x, z));
+                }
+            }
+
+            for (int cell_y = 0; cell_y + 1 < LATTICE_HEIGHT; cell_y++)
+            {
+                int y_first, y_last;
+                cellRange(cell_y, GROUND_MIN_Y, GROUND_MAX_Y, y_first, y_last);
+                if (y_first > y_last)
+                {
+                    continue;
+                }
+
+                LatticeCell cell(scratch.overhang.data(), cell_x, cell_y, cell_z);
+                const int bottom_y = origin.y + y_first;
+                const int top_y = origin.y + y_last;
+                const bool all_ground = min_height - top_y + OVERHANG_AMPLITUDE * cell.min_value > 0.0f;
+                const bool no_ground = max_height - bottom_y + OVERHANG_AMPLITUDE * cell.max_value <= 0.0f;
+
+                for (int x = x_first; x <= x_last; x++)
+                {
+                    const float fx = static_cast<float>(x - (cell_x - 1) * STEP) / STEP;
+                    for (int y = y_first; y <= y_last; y++)
+                    {
+                        uint8_t *row = ground + groundIndex(x, y, 0);
+                        if (all_ground || no_ground)
+                        {
+                            std::fill(row + z_first, row + z_last + 1, all_ground);
+                            continue;
+                        }
+                        const float fy = static_cast<float>(y - (cell_y - 1) * STEP) / STEP;
+                        float z0, z1;
+                        cell.blendRow(fx, fy, z0, z1);
+                        for (int z = z_first; z <= z_last; z++)
+                        {
+                            const float fz = static_cast<float>(z - (cell_z - 1) * STEP) / STEP;
+                            float density = height(x, z) - (origin.y + y) + OVERHANG_AMPLITUDE * (z0 + fz * (z1 - z0));
+                            row[z] = density > 0.0f;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Materials from the ground above each voxel, top down a z row at a time: the column
+    // biome's top block on the surface, its filler below, stone from MATERIAL_DEPTH down.
+    // Ground the overhangs push under the beach line is layered as beach whatever the column
+    // is, and water fills open space up to the water line.
+    uint8_t depth[PADDED_SIZE * PADDED_SIZE] = {}; // Ground voxels directly above, capped
+    for (int y = GROUND_MAX_Y; y >= GROUND_MIN_Y; y--)
+    {
+        const VoxelID open = origin.y + y <= WATER_LEVEL ? VOXEL_WATER : VOXEL_AIR;
+        const bool beach = origin.y + y <= WATER_LEVEL + BEACH_HEIGHT;
+        for (int x = -1; x <= CHUNK_SIZE; x++)
+        {
+            const uint8_t *ground_row = ground + groundIndex(x, y, -1);
+            const uint8_t *biome_row = biomes + (x + 1) * PADDED_SIZE;
+            uint8_t *depth_row = depth + (x + 1) * PADDED_SIZE;
+            if (y <= CHUNK_HEIGHT)
+            {
+                VoxelID *row = out + ChunkSnapshot::paddedIndex(x, y, -1);
+                for (int z = 0; z < PADDED_SIZE; z++)
+                {
+                    Biome biome = beach ? BIOME_BEACH : static_cast<Biome>(biome_row[z]);
+                    row[z] = ground_row[z] ? getBiomeLayer(biome, depth_row[z]) : open;
+                }
+            }
+            for (int z = 0; z < PADDED_SIZE; z++)
+            {
+                depth_row[z] = ground_row[z] ? static_cast<uint8_t>(std::min(depth_row[z] + 1, MATERIAL_DEPTH)) : 0;
+            }
+        }
+    }
+
+    if (!needs_caves)
+    {
+        return;
+    }
+
+    // Caves through ground, keeping a seal under water so the sea floor stays closed
+    for (int cell_x = 0; cell_x + 1 < LATTICE_SIZE; cell_x++)
+    {
+        int x_first, x_last;
+        cellRange(cell_x, -1, CHUNK_SIZE, x_first, x_last);
+        for (int cell_y = 0; cell_y + 1 < LATTICE_HEIGHT; cell_y++)
+        {
+            int y_first, y_last;
+            cellRange(cell_y, std::max(-1, CAVE_MIN_Y - origin.y), CHUNK_HEIGHT, y_first, y_last);
+            for (int cell_z = 0; cell_z + 1 < LATTICE_SIZE; cell_z++)
+            {
+                int z_first, z_last;
+                cellRange(cell_z, -1, CHUNK_SIZE, z_first, z_last);
+                if (x_first > x_last || y_first > y_last || z_first > z_last)
+                {
+                    continue;
+                }
+
+                LatticeCell cell(scratch.caves.data(), cell_x, cell_y, cell_z);
+                if (cell.max_value <= CAVE_THRESHOLD)
+                {
+                    continue;
+                }
+                const bool all_cave = cell.min_value > CAVE_THRESHOLD;
+
+                for (int x = x_first; x <= x_last; x++)
+                {
+                    const float fx = static_cast<float>(x - (cell_x - 1) * STEP) / STEP;
+                    for (int y = y_first; y <= y_last; y++)
+                    {
+                        const float fy = static_cast<float>(y - (cell_y - 1) * STEP) / STEP;
+                        float z0, z1;
+                        cell.blendRow(fx, fy, z0, z1);
+                        VoxelID *row = out + ChunkSnapshot::paddedIndex(x, y, 0);
+                        for (int z = z_first; z <= z_last; z++)
+                        {
+                            const int column_height = height(x, z);
+                            if (!isVoxelSolid(row[z]) ||
+                                (column_height <= WATER_LEVEL && origin.y + y >= column_height - SEA_FLOOR_SEAL))
+                            {
+                                continue;
+                            }
+                            const float fz = static_cast<float>(z - (cell_z - 1) * STEP) / STEP;
+                            if (all_cave || z0 + fz * (z1 - z0) > CAVE_THRESHOLD)
+                            {
+                                row[z] = VOXEL_AIR;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
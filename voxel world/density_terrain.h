@@ -0,0 +1,51 @@
+#ifndef DENSITY_TERRAIN_H
+#define DENSITY_TERRAIN_H
+
+#include "voxel_types.h"
+#include <glm/glm/glm.hpp>
+#include <cstdint>
+
+enum class TerrainMode
+{
+    Heightmap, // Columns filled up to the terrain height
+    Density    // The height field bent into overhangs by 3D noise, with caves carved out
+};
+
+// 3D density terrain of one chunk.
+//
+// A voxel is ground where (height - y) + OVERHANG_AMPLITUDE * overhang(x, y, z) > 0, height
+// being the 2D terrain height of its column: the surface moves up or down by up to
+// OVERHANG_AMPLITUDE blocks, and folds into overhangs and arches where the noise changes
+// faster than y. Ground is layered by the ground above it with the layers of its column's
+// biome, as the height field is, and water fills the rest up to WATER_LEVEL. Caves then carve
+// air through ground where the cave noise is above CAVE_THRESHOLD.
+//
+// Both fields are sampled with GenUniformGrid3D on a world-aligned lattice every LATTICE_STEP
+// voxels and trilinearly upsampled. An upsampled value never leaves the range of its cell's
+// corners, so a cell whose range cannot cross the surface (or the cave threshold) is filled
+// whole without evaluating its voxels. As the lattice is world aligned, the one voxel shell
+// generated around a chunk is exactly what its neighbors generate there.
+class DensityTerrain
+{
+public:
+    static constexpr int LATTICE_STEP = 4;
+    static constexpr float OVERHANG_AMPLITUDE = 12.0f; // Blocks the surface can move
+    static constexpr float CAVE_THRESHOLD = 0.45f;
+    static constexpr int CAVE_MIN_Y = 8;     // Caves stay clear of the world floor
+    static constexpr int SEA_FLOOR_SEAL = 4; // Ground kept over caves under water
+
+    // Fill out (ChunkSnapshot::PADDED_VOLUME voxels in paddedIndex order: the chunk and a one
+    // voxel shell) for the chunk at chunk_pos. heights and biomes are the chunk's extended
+    // terrain heights and column biomes, (CHUNK_SIZE + 2) squared, x-major from local (-1, -1).
+    static void generate(uint32_t seed, const glm::ivec3 &chunk_pos, const int *heights, const uint8_t *biomes,
+                         VoxelID *out);
+
+    // A chunk starting at world height bottom_y is air, shell included, over columns no
+    // higher than max_height: no noise needs sampling
+    static bool isAboveTerrain(int bottom_y, int max_height)
+    {
+        return bottom_y - 1 >= max_height + OVERHANG_AMPLITUDE && bottom_y - 1 > WATER_LEVEL;
+    }
+};
+
+#endif // DENSITY_TERRAIN_H
@@ -0,0 +1,336 @@
+#include "edit_journal.h"
+#include "voxel_world.h"
+#include "block_registry.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+void writeVarint(std::vector<unsigned char> &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+bool readVarint(const unsigned char *&data, const unsigned char *end, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && data < end; shift += 7)
+    {
+        unsigned char byte = *data++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void writeSigned(std::vector<unsigned char> &out, int64_t value)
+{
+    writeVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63)); // Zigzag
+}
+
+bool readSigned(const unsigned char *&data, const unsigned char *end, int64_t &value)
+{
+    uint64_t raw = 0;
+    if (!readVarint(data, end, raw))
+    {
+        return false;
+    }
+    value = static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+    return true;
+}
+
+int localIndex(const glm::ivec3 &local)
+{
+    return (local.x * CHUNK_HEIGHT + local.y) * CHUNK_SIZE + local.z;
+}
+
+glm::ivec3 localFromIndex(int index)
+{
+    return glm::ivec3(index / (CHUNK_HEIGHT * CHUNK_SIZE), (index / CHUNK_SIZE) % CHUNK_HEIGHT, index % CHUNK_SIZE);
+}
+}
+
+void EditJournal::record(const glm::ivec3 &position, VoxelID old_voxel, VoxelID new_voxel)
+{
+    pending.push_back({VoxelWorld::worldToChunk(position),
+                       static_cast<uint16_t>(localIndex(VoxelWorld::worldToLocal(position))), old_voxel, new_voxel});
+}
+
+void EditJournal::commit()
+{
+    if (pending.empty())
+    {
+        return;
+    }
+
+    dropRedo();
+    // Edit calls already work chunk by chunk; stable so changes of a position keep their order
+    std::stable_sort(pending.begin(), pending.end(), [](const Change &a, const Change &b)
+                     {
+                         if (a.chunk_pos.x != b.chunk_pos.x)
+                             return a.chunk_pos.x < b.chunk_pos.x;
+                         if (a.chunk_pos.y != b.chunk_pos.y)
+                             return a.chunk_pos.y < b.chunk_pos.y;
+                         return a.chunk_pos.z < b.chunk_pos.z; });
+
+    operation_offsets.push_back(data.size());
+    size_t groups = 1;
+    for (size_t i = 1; i < pending.size(); i++)
+    {
+        groups += pending[i].chunk_pos != pending[i - 1].chunk_pos ? 1 : 0;
+    }
+    writeVarint(data, groups);
+
+    glm::ivec3 previous_chunk(0);
+    for (size_t first = 0, last = 0; first < pending.size(); first = last)
+    {
+        const glm::ivec3 chunk_pos = pending[first].chunk_pos;
+        while (last < pending.size() && pending[last].chunk_pos == chunk_pos)
+        {
+            last++;
+        }
+        for (int axis = 0; axis < 3; axis++)
+        {
+            writeSigned(data, static_cast<int64_t>(chunk_pos[axis]) - previous_chunk[axis]);
+        }
+        previous_chunk = chunk_pos;
+
+        writeVarint(data, last - first);
+        int previous_index = 0;
+        for (size_t i = first; i < last; i++)
+        {
+            writeSigned(data, pending[i].local_index - previous_index);
+            writeVarint(data, pending[i].old_voxel);
+            writeVarint(data, pending[i].new_voxel);
+            previous_index = pending[i].local_index;
+        }
+    }
+    applied = operation_offsets.size();
+    pending.clear();
+}
+
+void EditJournal::append(const EditJournal &other)
+{
+    if (other.applied == 0)
+    {
+        return;
+    }
+    dropRedo();
+    const size_t base = data.size();
+    for (size_t operation = 0; operation < other.applied; operation++)
+    {
+        operation_offsets.push_back(base + other.operation_offsets[operation]);
+    }
+    data.insert(data.end(), other.data.begin(), other.data.begin() + static_cast<std::ptrdiff_t>(other.operationEnd(other.applied - 1)));
+    applied = operation_offsets.size();
+}
+
+void EditJournal::dropRedo()
+{
+    // The redo tail is gone once something new happens
+    if (applied < operation_offsets.size())
+    {
+        data.resize(operation_offsets[applied]);
+        operation_offsets.resize(applied);
+    }
+}
+
+bool EditJournal::decodeOperation(const unsigned char *bytes, size_t size, std::vector<Change> &out)
+{
+    const unsigned char *end = bytes + size;
+    const uint64_t type_count = static_cast<uint64_t>(BlockRegistry::get().getTypeCount());
+    uint64_t groups = 0;
+    if (!readVarint(bytes, end, groups) || groups == 0)
+    {
+        return false;
+    }
+
+    glm::ivec3 chunk_pos(0);
+    for (uint64_t group = 0; group < groups; group++)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            int64_t delta = 0;
+            if (!readSigned(bytes, end, delta) || delta < INT32_MIN || delta > INT32_MAX)
+            {
+                return false;
+            }
+            chunk_pos[axis] = static_cast<int>(static_cast<int64_t>(chunk_pos[axis]) + delta);
+        }
+
+        uint64_t count = 0;
+        if (!readVarint(bytes, end, count) || count == 0 || count > static_cast<uint64_t>(end - bytes))
+        {
+            return false;
+        }
+        int64_t index = 0;
+        for (uint64_t i = 0; i < count; i++)
+        {
+            int64_t delta = 0;
+            uint64_t old_voxel = 0;
+            uint64_t new_voxel = 0;
+            if (!readSigned(bytes, end, delta) || !readVarint(bytes, end, old_voxel) || !readVarint(bytes, end, new_voxel))
+            {
+                return false;
+            }
+            index += delta;
+            if (index < 0 || index >= CHUNK_VOLUME || old_voxel >= type_count || new_voxel >= type_count)
+            {
+                return false;
+            }
+            out.push_back({chunk_pos, static_cast<uint16_t>(index), static_cast<VoxelID>(old_voxel),
+                           static_cast<VoxelID>(new_voxel)});
+        }
+    }
+    return bytes == end;
+}
+
+void EditJournal::toEdits(const std::vector<Change> &changes, bool undo, std::vector<VoxelEdit> &edits)
+{
+    for (size_t i = 0; i < changes.size(); i++)
+    {
+        const Change &change = undo ? changes[changes.size() - 1 - i] : changes[i];
+        glm::ivec3 position = VoxelWorld::chunkToWorld(change.chunk_pos) + localFromIndex(change.local_index);
+        edits.push_back({position, undo ? change.old_voxel : change.new_voxel});
+    }
+}
+
+bool EditJournal::takeUndo(std::vector<VoxelEdit> &edits)
+{
+    if (applied == 0)
+    {
+        return false;
+    }
+    std::vector<Change> changes;
+    const size_t operation = applied - 1;
+    decodeOperation(data.data() + operation_offsets[operation], operationEnd(operation) - operation_offsets[operation],
+                    changes); // Written by commit or checked by load
+    toEdits(changes, true, edits);
+    applied--;
+    return true;
+}
+
+bool EditJournal::takeRedo(std::vector<VoxelEdit> &edits)
+{
+    if (applied == operation_offsets.size())
+    {
+        return false;
+    }
+    std::vector<Change> changes;
+    decodeOperation(data.data() + operation_offsets[applied], operationEnd(applied) - operation_offsets[applied], changes);
+    toEdits(changes, false, edits);
+    applied++;
+    return true;
+}
+
+void EditJournal::collectApplied(std::vector<VoxelEdit> &edits) const
+{
+    std::vector<Change> changes;
+    for (size_t operation = 0; operation < applied; operation++)
+    {
+        decodeOperation(data.data() + operation_offsets[operation],
+                        operationEnd(operation) - operation_offsets[operation], changes);
+    }
+    toEdits(changes, false, edits);
+}
+
+bool EditJournal::save(const std::string &path) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cerr << "Edit journal: cannot write " << path << std::endl;
+        return false;
+    }
+
+    // Magic, operation count, then each operation as its byte length and bytes
+    std::vector<unsigned char> header;
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        header.push_back(static_cast<unsigned char>(JOURNAL_MAGIC >> shift));
+    }
+    writeVarint(header, applied);
+    file.write(reinterpret_cast<const char *>(header.data()), static_cast<std::streamsize>(header.size()));
+    for (size_t operation = 0; operation < applied; operation++)
+    {
+        std::vector<unsigned char> length;
+        writeVarint(length, operationEnd(operation) - operation_offsets[operation]);
+        file.write(reinterpret_cast<const char *>(length.data()), static_cast<std::streamsize>(length.size()));
+        file.write(reinterpret_cast<const char *>(data.data() + operation_offsets[operation]),
+                   static_cast<std::streamsize>(operationEnd(operation) - operation_offsets[operation]));
+    }
+    return static_cast<bool>(file.flush());
+}
+
+bool EditJournal::load(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const unsigned char *cursor = bytes.data();
+    const unsigned char *end = cursor + bytes.size();
+
+    uint32_t magic = 0;
+    for (int shift = 0; shift < 32 && cursor < end; shift += 8)
+    {
+        magic |= static_cast<uint32_t>(*cursor++) << shift;
+    }
+    uint64_t operations = 0;
+    if (magic != JOURNAL_MAGIC || !readVarint(cursor, end, operations) || operations > bytes.size())
+    {
+        std::cerr << "Edit journal: " << path << " is not a journal" << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> loaded_data;
+    std::vector<size_t> loaded_offsets;
+    std::vector<Change> changes;
+    for (uint64_t operation = 0; operation < operations; operation++)
+    {
+        uint64_t length = 0;
+        if (!readVarint(cursor, end, length) || length > static_cast<uint64_t>(end - cursor) ||
+            !decodeOperation(cursor, static_cast<size_t>(length), changes))
+        {
+            std::cerr << "Edit journal: bad operation " << operation << " in " << path << std::endl;
+            return false;
+        }
+        loaded_offsets.push_back(loaded_data.size());
+        loaded_data.insert(loaded_data.end(), cursor, cursor + length);
+        cursor += length;
+        changes.clear();
+    }
+    if (cursor != end)
+    {
+        std::cerr << "Edit journal: trailing bytes in " << path << std::endl;
+        return false;
+    }
+
+    data = std::move(loaded_data);
+    operation_offsets = std::move(loaded_offsets);
+    applied = operation_offsets.size();
+    pending.clear();
+    return true;
+}
+
+void EditJournal::clear()
+{
+    data.clear();
+    operation_offsets.clear();
+    applied = 0;
+    pending.clear();
+}
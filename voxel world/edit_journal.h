@@ -0,0 +1,85 @@
+#ifndef EDIT_JOURNAL_H
+#define EDIT_JOURNAL_H
+
+#include "voxel_types.h"
+#include <glm/glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct VoxelEdit;
+
+// History of the voxels edits changed, as operations (one per VoxelWorld edit call: a
+// setVoxel, applyEdits or fill) that can be undone, redone and replayed.
+//
+// record() collects the changes of the operation in progress and commit() appends them to
+// one byte stream, grouped by chunk: per chunk, its position as a delta from the previous
+// chunk of the operation, then each change as the zigzag varint delta of its local index
+// from the previous change and the old and new VoxelID as varints. A box fill writes
+// neighboring indices, so most changes take three bytes. Local indices are x-major
+// ((x * CHUNK_HEIGHT + y) * CHUNK_SIZE + z) whatever the chunk layout, so saved journals
+// stay readable.
+//
+// Appending after an undo drops the operations that could have been redone. Main thread,
+// like edits.
+class EditJournal
+{
+public:
+    // One changed voxel of the operation in progress
+    void record(const glm::ivec3 &position, VoxelID old_voxel, VoxelID new_voxel);
+    // End the operation in progress (nothing if it changed nothing)
+    void commit();
+
+    // The edits that undo the last applied operation (newest change first, so the oldest
+    // value of a position lands last) or redo the next one, for VoxelWorld::applyEdits; false
+    // if there is none
+    bool takeUndo(std::vector<VoxelEdit> &edits);
+    bool takeRedo(std::vector<VoxelEdit> &edits);
+    // Every applied operation's changes in order, for replaying onto the generated world
+    void collectApplied(std::vector<VoxelEdit> &edits) const;
+
+    // The applied operations, as a file of their own (the redo tail is not written); load
+    // replaces the journal, false (journal untouched) if the file is unreadable or malformed
+    bool save(const std::string &path) const;
+    bool load(const std::string &path);
+
+    // Append another journal's applied operations (e.g. an edit recorded over several
+    // frames) as the newest ones
+    void append(const EditJournal &other);
+    void clear();
+
+    size_t getOperationCount() const { return operation_offsets.size(); }
+    size_t getAppliedCount() const { return applied; }
+    size_t getMemoryUsage() const
+    {
+        return data.capacity() + operation_offsets.capacity() * sizeof(size_t) + pending.capacity() * sizeof(Change);
+    }
+
+private:
+    static constexpr uint32_t JOURNAL_MAGIC = 0x314A5856; // "VXJ1"
+
+    struct Change
+    {
+        glm::ivec3 chunk_pos;
+        uint16_t local_index;
+        VoxelID old_voxel;
+        VoxelID new_voxel;
+    };
+
+    std::vector<unsigned char> data;      // Encoded operations, back to back
+    std::vector<size_t> operation_offsets; // Start of each operation in data
+    size_t applied = 0;                    // Operations not undone; the rest can be redone
+    std::vector<Change> pending;           // Operation in progress
+
+    void dropRedo();
+    size_t operationEnd(size_t operation) const
+    {
+        return operation + 1 < operation_offsets.size() ? operation_offsets[operation + 1] : data.size();
+    }
+    // Append one operation's changes in encoded order; false if the bytes are malformed
+    static bool decodeOperation(const unsigned char *bytes, size_t size, std::vector<Change> &out);
+    static void toEdits(const std::vector<Change> &changes, bool undo, std::vector<VoxelEdit> &edits);
+};
+
+#endif // EDIT_JOURNAL_H
@@ -0,0 +1,197 @@
+#include "entity_renderer.h"
+#include "entity_store.h"
+#include "startup_cache.h"
+#include "../shader.h"
+#include <glm/glm/gtc/type_ptr.hpp>
+#include <iostream>
+#include <string>
+
+namespace
+{
+constexpr GLsizei CUBE_INDEX_COUNT = 36;
+
+struct CubeVertex
+{
+    float position[3];
+    float normal[3];
+};
+}
+
+EntityRenderer::EntityRenderer()
+    : vao(0), cube_buffer(0), index_buffer(0), instance_buffer(0), uniform_view(-1), uniform_projection(-1),
+      entities_rendered_last_frame(0)
+{
+}
+
+EntityRenderer::~EntityRenderer()
+{
+    if (vao != 0)
+    {
+        glDeleteVertexArrays(1, &vao);
+    }
+    GLuint buffers[] = {cube_buffer, index_buffer, instance_buffer};
+    for (GLuint buffer : buffers)
+    {
+        if (buffer != 0)
+        {
+            glDeleteBuffers(1, &buffer);
+        }
+    }
+    if (shader)
+    {
+        glDeleteProgram(shader->ID);
+    }
+}
+
+bool EntityRenderer::initialize()
+{
+    // Same search order as the voxel shaders
+    StartupCache cache;
+    for (const char *directory : {"shaders/", "voxel world/"})
+    {
+        shader = cache.loadShader("entity", std::string(directory) + "entity.vs",
+                                  std::string(directory) + "entity.fs");
+        if (shader)
+        {
+            break;
+        }
+    }
+    if (!shader)
+    {
+        std::cerr << "Entity renderer: shaders not found" << std::endl;
+        return false;
+    }
+
+    uniform_view = glGetUniformLocation(shader->ID, "view");
+    uniform_projection = glGetUniformLocation(shader->ID, "projection");
+
+    // Four vertices per face so each face keeps its own normal; counter-clockwise from outside
+    std::vector<CubeVertex> vertices;
+    std::vector<GLushort> indices;
+    vertices.reserve(24);
+    indices.reserve(CUBE_INDEX_COUNT);
+    for (int axis = 0; axis < 3; axis++)
+    {
+        for (float side : {-1.0f, 1.0f})
+        {
+            int u = (axis + 1) % 3;
+            int v = (axis + 2) % 3;
+            GLushort first = static_cast<GLushort>(vertices.size());
+            const float corners[4][2] = {{-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f}};
+            for (const auto &corner : corners)
+            {
+                CubeVertex vertex = {};
+                vertex.position[axis] = side;
+                vertex.position[u] = corner[0];
+                vertex.position[v] = side > 0.0f ? corner[1] : -corner[1];
+                vertex.normal[axis] = side;
+                vertices.push_back(vertex);
+            }
+            indices.insert(indices.end(), {first, static_cast<GLushort>(first + 1), static_cast<GLushort>(first + 2),
+                                           first, static_cast<GLushort>(first + 2), static_cast<GLushort>(first + 3)});
+        }
+    }
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &cube_buffer);
+    glGenBuffers(1, &index_buffer);
+    glGenBuffers(1, &instance_buffer);
+    glBindVertexArray(vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, cube_buffer);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(CubeVertex), vertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(CubeVertex), (void *)offsetof(CubeVertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(CubeVertex), (void *)offsetof(CubeVertex, normal));
+    glEnableVertexAttribArray(1);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), (void *)offsetof(Instance, center));
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), (void *)offsetof(Instance, half_extents));
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), (void *)offsetof(Instance, color));
+    glEnableVertexAttribArray(4);
+    glVertexAttribDivisor(4, 1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void EntityRenderer::render(const EntityStore &entities, const glm::mat4 &view, const glm::mat4 &projection, const Frustum &frustum)
+{
+    render(entities.getKinds(), entities.getPositions(), entities.getKindIndices(), view, projection, frustum);
+}
+
+void EntityRenderer::render(const std::vector<EntityKind> &kinds, const std::vector<glm::vec3> &positions,
+                            const std::vector<uint16_t> &kind_indices, const glm::mat4 &view, const glm::mat4 &projection,
+                            const Frustum &frustum)
+{
+    entities_rendered_last_frame = 0;
+    if (!shader || positions.empty())
+    {
+        return;
+    }
+
+    // Positions are bottom centers: lift them by the kind's half height
+    kind_bounds.resize(kinds.size());
+    for (ChunkBoundsSoA &bounds : kind_bounds)
+    {
+        bounds.clear();
+    }
+    for (size_t slot = 0; slot < positions.size(); slot++)
+    {
+        uint16_t kind = kind_indices[slot];
+        kind_bounds[kind].push(positions[slot] + glm::vec3(0.0f, kinds[kind].half_extents.y, 0.0f));
+    }
+
+    instances.clear();
+    for (size_t kind = 0; kind < kinds.size(); kind++)
+    {
+        ChunkBoundsSoA &bounds = kind_bounds[kind];
+        if (bounds.size() == 0)
+        {
+            continue;
+        }
+        const glm::vec3 &half_extents = kinds[kind].half_extents;
+        bounds.visible.resize(bounds.size());
+        frustum.cullBoxes(bounds.center_x.data(), bounds.center_y.data(), bounds.center_z.data(), bounds.size(),
+                          half_extents, bounds.visible.data());
+
+        for (size_t i = 0; i < bounds.size(); i++)
+        {
+            if (!bounds.visible[i])
+            {
+                continue;
+            }
+            const glm::vec3 &color = kinds[kind].color;
+            instances.push_back({{bounds.center_x[i], bounds.center_y[i], bounds.center_z[i]},
+                                 {half_extents.x, half_extents.y, half_extents.z},
+                                 {color.x, color.y, color.z}});
+        }
+    }
+    if (instances.empty())
+    {
+        return;
+    }
+
+    shader->use();
+    glUniformMatrix4fv(uniform_view, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(uniform_projection, 1, GL_FALSE, glm::value_ptr(projection));
+
+    // Orphan and refill: the instance count changes every frame
+    glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Instance), instances.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindVertexArray(vao);
+    glDrawElementsInstanced(GL_TRIANGLES, CUBE_INDEX_COUNT, GL_UNSIGNED_SHORT, nullptr, static_cast<GLsizei>(instances.size()));
+    glBindVertexArray(0);
+    entities_rendered_last_frame = instances.size();
+}
@@ -0,0 +1,65 @@
+#ifndef ENTITY_RENDERER_H
+#define ENTITY_RENDERER_H
+
+#include "frustum.h"
+#include <glm/glm/glm.hpp>
+#include <glad/glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class EntityStore;
+class Shader;
+struct EntityKind;
+
+// Draws the entities of an EntityStore as lit boxes the size of their collision box, tinted
+// by their kind.
+//
+// Entities are frustum-culled like chunks, in bulk from contiguous centers (one batch per
+// kind, which shares the half extents), and the survivors go out as one instanced draw of a
+// unit cube with a center, half extents and color per instance.
+class EntityRenderer
+{
+public:
+    EntityRenderer();
+    ~EntityRenderer();
+
+    EntityRenderer(const EntityRenderer &) = delete;
+    EntityRenderer &operator=(const EntityRenderer &) = delete;
+
+    // Load the shaders and the shared cube
+    bool initialize();
+
+    // Main thread, in the opaque pass (depth test enabled)
+    void render(const EntityStore &entities, const glm::mat4 &view, const glm::mat4 &projection, const Frustum &frustum);
+    // The same from copies of the store's components (positions and kind_indices by slot)
+    void render(const std::vector<EntityKind> &kinds, const std::vector<glm::vec3> &positions,
+                const std::vector<uint16_t> &kind_indices, const glm::mat4 &view, const glm::mat4 &projection,
+                const Frustum &frustum);
+
+    size_t getEntitiesRendered() const { return entities_rendered_last_frame; }
+
+private:
+    struct Instance
+    {
+        float center[3];
+        float half_extents[3];
+        float color[3];
+    };
+
+    std::unique_ptr<Shader> shader;
+    GLuint vao;
+    GLuint cube_buffer;
+    GLuint index_buffer;
+    GLuint instance_buffer;
+    GLint uniform_view;
+    GLint uniform_projection;
+    size_t entities_rendered_last_frame;
+
+    // Per kind, rebuilt every frame
+    std::vector<ChunkBoundsSoA> kind_bounds;
+    std::vector<Instance> instances;
+};
+
+#endif // ENTITY_RENDERER_H
@@ -0,0 +1,424 @@
+#include "entity_store.h"
+#include "profiler.h"
+#include "log.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+namespace
+{
+void writeFloats(std::vector<unsigned char> &out, const glm::vec3 &value)
+{
+    size_t offset = out.size();
+    out.resize(offset + sizeof(float) * 3);
+    std::memcpy(out.data() + offset, &value.x, sizeof(float));
+    std::memcpy(out.data() + offset + sizeof(float), &value.y, sizeof(float));
+    std::memcpy(out.data() + offset + sizeof(float) * 2, &value.z, sizeof(float));
+}
+
+glm::vec3 readFloats(const unsigned char *data)
+{
+    glm::vec3 value;
+    std::memcpy(&value.x, data, sizeof(float));
+    std::memcpy(&value.y, data + sizeof(float), sizeof(float));
+    std::memcpy(&value.z, data + sizeof(float) * 2, sizeof(float));
+    return value;
+}
+
+// Saved entity: kind, position, velocity
+constexpr size_t SAVED_ENTITY_SIZE = sizeof(uint16_t) + sizeof(float) * 6;
+}
+
+EntityStore::EntityStore(VoxelWorld &world, std::string directory, JobSystem &job_system)
+    : world(world), storage(std::move(directory), job_system), last_tick(std::chrono::steady_clock::now())
+{
+}
+
+uint16_t EntityStore::addKind(const EntityKind &kind)
+{
+    kinds.push_back(kind);
+    return static_cast<uint16_t>(kinds.size() - 1);
+}
+
+EntityID EntityStore::spawn(uint16_t kind, const glm::vec3 &position, const glm::vec3 &velocity)
+{
+    if (kind >= kinds.size())
+    {
+        return INVALID_ENTITY;
+    }
+    EntityID id = next_id++;
+    uint32_t slot = addSlot(id, kind, position, velocity);
+    addToBucket(slot, VoxelWorld::worldToChunk(position));
+    return id;
+}
+
+bool EntityStore::despawn(EntityID entity)
+{
+    auto it = slot_of.find(entity);
+    if (it == slot_of.end())
+    {
+        return false;
+    }
+    removeSlot(it->second);
+    return true;
+}
+
+glm::vec3 EntityStore::getPosition(EntityID entity) const
+{
+    auto it = slot_of.find(entity);
+    return it != slot_of.end() ? positions[it->second] : glm::vec3(0.0f);
+}
+
+glm::vec3 EntityStore::getVelocity(EntityID entity) const
+{
+    auto it = slot_of.find(entity);
+    return it != slot_of.end() ? velocities[it->second] : glm::vec3(0.0f);
+}
+
+bool EntityStore::isOnGround(EntityID entity) const
+{
+    auto it = slot_of.find(entity);
+    return it != slot_of.end() && (flags[it->second] & FLAG_ON_GROUND);
+}
+
+void EntityStore::setPosition(EntityID entity, const glm::vec3 &position)
+{
+    auto it = slot_of.find(entity);
+    if (it == slot_of.end())
+    {
+        return;
+    }
+    uint32_t slot = it->second;
+    positions[slot] = position;
+    flags[slot] &= static_cast<uint8_t>(~FLAG_ON_GROUND);
+    removeFromBucket(slot);
+    addToBucket(slot, VoxelWorld::worldToChunk(position));
+}
+
+void EntityStore::setVelocity(EntityID entity, const glm::vec3 &velocity)
+{
+    auto it = slot_of.find(entity);
+    if (it != slot_of.end())
+    {
+        velocities[it->second] = velocity;
+    }
+}
+
+void EntityStore::queryBox(const glm::vec3 &min_corner, const glm::vec3 &max_corner, std::vector<EntityID> &out) const
+{
+    // Boxes reach at most their largest half extent past the chunk their position is in
+    float reach = 0.0f;
+    for (const EntityKind &kind : kinds)
+    {
+        reach = std::max({reach, kind.half_extents.x, kind.half_extents.z, kind.half_extents.y * 2.0f});
+    }
+    glm::ivec3 first = VoxelWorld::worldToChunk(min_corner - glm::vec3(reach));
+    glm::ivec3 last = VoxelWorld::worldToChunk(max_corner + glm::vec3(reach));
+
+    for (int x = first.x; x <= last.x; x++)
+    {
+        for (int y = first.y; y <= last.y; y++)
+        {
+            for (int z = first.z; z <= last.z; z++)
+            {
+                auto it = buckets.find(glm::ivec3(x, y, z));
+                if (it == buckets.end())
+                {
+                    continue;
+                }
+                for (uint32_t slot : it->second.slots)
+                {
+                    const glm::vec3 &position = positions[slot];
+                    const glm::vec3 &half = kinds[kind_indices[slot]].half_extents;
+                    if (position.x + half.x >= min_corner.x && position.x - half.x <= max_corner.x &&
+                        position.y + half.y * 2.0f >= min_corner.y && position.y <= max_corner.y &&
+                        position.z + half.z >= min_corner.z && position.z - half.z <= max_corner.z)
+                    {
+                        out.push_back(ids[slot]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void EntityStore::update()
+{
+    auto now = std::chrono::steady_clock::now();
+    pending_seconds = std::min(pending_seconds + std::chrono::duration<float>(now - last_tick).count(),
+                               TICK_SECONDS * MAX_TICKS_PER_UPDATE);
+    last_tick = now;
+    if (ids.empty())
+    {
+        pending_seconds = 0.0f;
+        return;
+    }
+    while (pending_seconds >= TICK_SECONDS)
+    {
+        pending_seconds -= TICK_SECONDS;
+        tick(TICK_SECONDS);
+    }
+}
+
+void EntityStore::tick(float seconds)
+{
+    PROFILE_ZONE("EntityStore::tick");
+
+    // Entities of chunks not loaded yet stay where they are; the sweeps read around the others
+    simulated.clear();
+    for (const auto &[chunk_pos, bucket] : buckets)
+    {
+        if (!bucket.slots.empty() && world.isChunkLoaded(chunk_pos))
+        {
+            world.touchChunk(chunk_pos);
+            simulated.insert(simulated.end(), bucket.slots.begin(), bucket.slots.end());
+        }
+    }
+
+    sweeps.resize(simulated.size());
+    for (size_t i = 0; i < simulated.size(); i++)
+    {
+        uint32_t slot = simulated[i];
+        const EntityKind &kind = kinds[kind_indices[slot]];
+        glm::vec3 &velocity = velocities[slot];
+        velocity.y -= kind.gravity * seconds;
+
+        const glm::vec3 &position = positions[slot];
+        glm::vec3 half = kind.half_extents;
+        sweeps[i].min = position - glm::vec3(half.x, 0.0f, half.z);
+        sweeps[i].max = position + glm::vec3(half.x, half.y * 2.0f, half.z);
+        sweeps[i].motion = velocity * seconds;
+    }
+    world.sweepBoxes(sweeps, results);
+
+    for (size_t i = 0; i < simulated.size(); i++)
+    {
+        uint32_t slot = simulated[i];
+        const VoxelSweepResult &result = results[i];
+        glm::vec3 &velocity = velocities[slot];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (result.blocked_axes & (1u << axis))
+            {
+                velocity[axis] = 0.0f;
+            }
+        }
+        if (result.on_ground)
+        {
+            flags[slot] |= FLAG_ON_GROUND;
+            velocity.x *= GROUND_FRICTION;
+            velocity.z *= GROUND_FRICTION;
+            if (std::abs(velocity.x) + std::abs(velocity.z) < 1e-3f)
+            {
+                velocity.x = 0.0f;
+                velocity.z = 0.0f;
+            }
+        }
+        else
+        {
+            flags[slot] &= static_cast<uint8_t>(~FLAG_ON_GROUND);
+        }
+
+        // Resting entities end here, without a bucket lookup
+        if (result.motion == glm::vec3(0.0f))
+        {
+            continue;
+        }
+        glm::vec3 &position = positions[slot];
+        position += result.motion;
+        glm::ivec3 chunk_pos = VoxelWorld::worldToChunk(position);
+        if (chunk_pos != chunks[slot])
+        {
+            removeFromBucket(slot);
+            addToBucket(slot, chunk_pos);
+        }
+        else
+        {
+            buckets.find(chunk_pos)->second.dirty = true;
+        }
+    }
+}
+
+void EntityStore::chunkLoaded(const glm::ivec3 &chunk_pos)
+{
+    if (world.isRemoteChunks() || buckets.find(chunk_pos) != buckets.end())
+    {
+        return; // Entities placed there meanwhile already brought the saved ones back
+    }
+    Bucket &bucket = getBucket(chunk_pos);
+    if (bucket.slots.empty() && !bucket.dirty)
+    {
+        buckets.erase(chunk_pos); // Kept only for chunks with entities
+    }
+}
+
+void EntityStore::chunkUnloaded(const glm::ivec3 &chunk_pos)
+{
+    auto it = buckets.find(chunk_pos);
+    if (it == buckets.end())
+    {
+        return;
+    }
+    saveBucket(chunk_pos, it->second);
+    while (!it->second.slots.empty())
+    {
+        removeSlot(it->second.slots.back());
+    }
+    buckets.erase(it);
+}
+
+void EntityStore::saveAll()
+{
+    for (auto it = buckets.begin(); it != buckets.end();)
+    {
+        saveBucket(it->first, it->second);
+        if (it->second.slots.empty() && !world.isChunkLoaded(it->first))
+        {
+            it = buckets.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+uint32_t EntityStore::addSlot(EntityID id, uint16_t kind, const glm::vec3 &position, const glm::vec3 &velocity)
+{
+    uint32_t slot = static_cast<uint32_t>(ids.size());
+    ids.push_back(id);
+    positions.push_back(position);
+    velocities.push_back(velocity);
+    kind_indices.push_back(kind);
+    flags.push_back(0);
+    chunks.push_back(glm::ivec3(0));
+    bucket_indices.push_back(0);
+    slot_of[id] = slot;
+    return slot;
+}
+
+void EntityStore::removeSlot(uint32_t slot)
+{
+    removeFromBucket(slot);
+    slot_of.erase(ids[slot]);
+
+    uint32_t last = static_cast<uint32_t>(ids.size() - 1);
+    if (slot != last)
+    {
+        ids[slot] = ids[last];
+        positions[slot] = positions[last];
+        velocities[slot] = velocities[last];
+        kind_indices[slot] = kind_indices[last];
+        flags[slot] = flags[last];
+        chunks[slot] = chunks[last];
+        bucket_indices[slot] = bucket_indices[last];
+        slot_of[ids[slot]] = slot;
+        buckets.find(chunks[slot])->second.slots[bucket_indices[slot]] = slot;
+    }
+    ids.pop_back();
+    positions.pop_back();
+    velocities.pop_back();
+    kind_indices.pop_back();
+    flags.pop_back();
+    chunks.pop_back();
+    bucket_indices.pop_back();
+}
+
+EntityStore::Bucket &EntityStore::getBucket(const glm::ivec3 &chunk_pos)
+{
+    auto it = buckets.find(chunk_pos);
+    if (it != buckets.end())
+    {
+        return it->second;
+    }
+    Bucket &bucket = buckets[chunk_pos]; // Map nodes stay put while loading adds to it
+    loadBucket(chunk_pos);
+    return bucket;
+}
+
+void EntityStore::addToBucket(uint32_t slot, const glm::ivec3 &chunk_pos)
+{
+    Bucket &bucket = getBucket(chunk_pos);
+    chunks[slot] = chunk_pos;
+    bucket_indices[slot] = static_cast<uint32_t>(bucket.slots.size());
+    bucket.slots.push_back(slot);
+    bucket.dirty = true;
+}
+
+void EntityStore::removeFromBucket(uint32_t slot)
+{
+    Bucket &bucket = buckets.find(chunks[slot])->second;
+    uint32_t index = bucket_indices[slot];
+    uint32_t moved = bucket.slots.back();
+    bucket.slots[index] = moved;
+    bucket_indices[moved] = index;
+    bucket.slots.pop_back();
+    bucket.dirty = true;
+}
+
+void EntityStore::saveBucket(const glm::ivec3 &chunk_pos, Bucket &bucket)
+{
+    if (!bucket.dirty || world.isRemoteChunks())
+    {
+        return;
+    }
+
+    // Version, count, then kind, position and velocity per entity. An empty bucket is saved
+    // too: it replaces the entities saved before.
+    blob.clear();
+    blob.push_back(SAVE_VERSION);
+    uint32_t count = static_cast<uint32_t>(bucket.slots.size());
+    blob.insert(blob.end(), reinterpret_cast<const unsigned char *>(&count),
+                reinterpret_cast<const unsigned char *>(&count) + sizeof(count));
+    for (uint32_t slot : bucket.slots)
+    {
+        uint16_t kind = kind_indices[slot];
+        blob.insert(blob.end(), reinterpret_cast<const unsigned char *>(&kind),
+                    reinterpret_cast<const unsigned char *>(&kind) + sizeof(kind));
+        writeFloats(blob, positions[slot]);
+        writeFloats(blob, velocities[slot]);
+    }
+    if (storage.storeBlob(chunk_pos, blob))
+    {
+        bucket.dirty = false;
+    }
+}
+
+void EntityStore::loadBucket(const glm::ivec3 &chunk_pos)
+{
+    if (world.isRemoteChunks() || !storage.loadBlob(chunk_pos, blob))
+    {
+        return;
+    }
+
+    uint32_t count = 0;
+    if (blob.size() >= 1 + sizeof(count))
+    {
+        std::memcpy(&count, blob.data() + 1, sizeof(count));
+    }
+    const size_t header = 1 + sizeof(count);
+    if (blob.size() < header || blob[0] != SAVE_VERSION || blob.size() != header + count * SAVED_ENTITY_SIZE)
+    {
+        Log::write(LogLevel::Warning, "Entity store: dropping unreadable entities of chunk (" +
+                                          std::to_string(chunk_pos.x) + ", " + std::to_string(chunk_pos.y) + ", " +
+                                          std::to_string(chunk_pos.z) + ")");
+        return;
+    }
+
+    // Saved entities take fresh ids; those of kinds this session did not register are dropped
+    const unsigned char *entity = blob.data() + header;
+    for (uint32_t i = 0; i < count; i++, entity += SAVED_ENTITY_SIZE)
+    {
+        uint16_t kind = 0;
+        std::memcpy(&kind, entity, sizeof(kind));
+        if (kind >= kinds.size())
+        {
+            continue;
+        }
+        uint32_t slot = addSlot(next_id++, kind, readFloats(entity + sizeof(kind)),
+                                readFloats(entity + sizeof(kind) + sizeof(float) * 3));
+        addToBucket(slot, chunk_pos);
+    }
+    buckets.find(chunk_pos)->second.dirty = false;
+}
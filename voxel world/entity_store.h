@@ -0,0 +1,131 @@
+#ifndef ENTITY_STORE_H
+#define ENTITY_STORE_H
+
+#include "voxel_world.h"
+#include "region_storage.h"
+#include <glm/glm/glm.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class JobSystem;
+
+using EntityID = uint32_t;
+constexpr EntityID INVALID_ENTITY = 0;
+
+// What every entity of a kind shares
+struct EntityKind
+{
+    glm::vec3 half_extents{0.3f, 0.9f, 0.3f}; // Collision box; the position is its bottom center
+    float gravity = 28.0f;                    // Blocks per second squared, 0 floats
+    glm::vec3 color{1.0f};                    // Tint of the drawn box (see EntityRenderer)
+};
+
+// Dynamic entities (mobs, dropped items) living in the world's chunks.
+//
+// Components are kept as parallel arrays indexed by a dense slot; removing an entity moves
+// the last one into its slot, so every per-tick pass is a loop over contiguous arrays. Slots
+// are also bucketed by the chunk the entity stands in: the bucket is the spatial index for
+// neighborhood queries, and what unloads and saves with the chunk (in its own region files
+// next to the voxels', a blob per chunk). Chunks that load bring their saved entities back.
+//
+// Each tick applies gravity to every entity of a loaded chunk, resolves all of them against
+// the voxels as one VoxelWorld::sweepBoxes batch and rebuckets only those that crossed a
+// chunk border, so the cost stays linear in the entity count. Entities placed in a chunk that
+// is not loaded wait there, frozen, until it loads. Ids are valid for the session only.
+//
+// Kinds are saved by index: register them in the same order every session. Remote worlds
+// (VoxelWorld::setRemoteChunks) neither save nor load entities.
+class EntityStore
+{
+public:
+    static constexpr float TICK_SECONDS = 1.0f / 30.0f;
+    static constexpr int MAX_TICKS_PER_UPDATE = 4; // Past that a stalled frame slows entities down
+    static constexpr float GROUND_FRICTION = 0.6f; // Horizontal velocity kept per tick on the ground
+
+    EntityStore(VoxelWorld &world, std::string directory, JobSystem &job_system);
+
+    EntityStore(const EntityStore &) = delete;
+    EntityStore &operator=(const EntityStore &) = delete;
+
+    uint16_t addKind(const EntityKind &kind);
+    const std::vector<EntityKind> &getKinds() const { return kinds; }
+
+    // Main thread
+    EntityID spawn(uint16_t kind, const glm::vec3 &position, const glm::vec3 &velocity = glm::vec3(0.0f));
+    bool despawn(EntityID entity);
+    bool isValid(EntityID entity) const { return slot_of.find(entity) != slot_of.end(); }
+    glm::vec3 getPosition(EntityID entity) const;
+    glm::vec3 getVelocity(EntityID entity) const;
+    bool isOnGround(EntityID entity) const;
+    void setPosition(EntityID entity, const glm::vec3 &position);
+    void setVelocity(EntityID entity, const glm::vec3 &velocity);
+
+    // Broadphase: entities whose box overlaps the inclusive world box, appended to out. Only
+    // the buckets of the chunks the box covers are looked at.
+    void queryBox(const glm::vec3 &min_corner, const glm::vec3 &max_corner, std::vector<EntityID> &out) const;
+
+    // Main thread, every frame: runs the ticks that are due
+    void update();
+    void tick(float seconds);
+
+    // Called by the world as chunks come and go (main thread)
+    void chunkLoaded(const glm::ivec3 &chunk_pos);
+    void chunkUnloaded(const glm::ivec3 &chunk_pos);
+    void saveAll(); // Every bucket with changes, entities stay
+    void flush() { storage.flush(); } // Waits for the saves written so far
+
+    // Components by slot, for drawing; valid until the next change
+    size_t getCount() const { return ids.size(); }
+    const std::vector<glm::vec3> &getPositions() const { return positions; }
+    const std::vector<uint16_t> &getKindIndices() const { return kind_indices; }
+    size_t getSimulatedCount() const { return simulated.size(); } // Last tick
+
+private:
+    static constexpr uint8_t SAVE_VERSION = 1;
+    static constexpr uint8_t FLAG_ON_GROUND = 1;
+
+    struct Bucket
+    {
+        std::vector<uint32_t> slots;
+        bool dirty = false; // Differs from what is saved
+    };
+
+    VoxelWorld &world;
+    RegionStorage storage;
+    std::vector<EntityKind> kinds;
+    EntityID next_id = 1;
+    std::chrono::steady_clock::time_point last_tick;
+    float pending_seconds = 0.0f;
+
+    // Components, by slot
+    std::vector<EntityID> ids;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> velocities;
+    std::vector<uint16_t> kind_indices;
+    std::vector<uint8_t> flags;
+    std::vector<glm::ivec3> chunks;        // Bucket the entity is in
+    std::vector<uint32_t> bucket_indices;  // Its index in that bucket's slots
+
+    std::unordered_map<EntityID, uint32_t> slot_of;
+    std::unordered_map<glm::ivec3, Bucket, Vec3Hash> buckets;
+
+    // Per tick
+    std::vector<uint32_t> simulated;
+    std::vector<VoxelSweep> sweeps;
+    std::vector<VoxelSweepResult> results;
+    std::vector<unsigned char> blob;
+
+    uint32_t addSlot(EntityID id, uint16_t kind, const glm::vec3 &position, const glm::vec3 &velocity);
+    void removeSlot(uint32_t slot);
+    Bucket &getBucket(const glm::ivec3 &chunk_pos); // Brings saved entities back on first use
+    void addToBucket(uint32_t slot, const glm::ivec3 &chunk_pos);
+    void removeFromBucket(uint32_t slot);
+    void saveBucket(const glm::ivec3 &chunk_pos, Bucket &bucket);
+    void loadBucket(const glm::ivec3 &chunk_pos);
+};
+
+#endif // ENTITY_STORE_H
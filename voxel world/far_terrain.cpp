@@ -0,0 +1,362 @@
+#include "far_terrain.h"
+#include "block_registry.h"
+#include "frustum.h"
+#include "job_system.h"
+#include "startup_cache.h"
+#include "voxel_noise.h"
+#include "../shader.h"
+#include <glm/glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+
+namespace
+{
+constexpr GLsizei TILE_INDEX_COUNT = (FarTerrain::TILE_SAMPLES - 1) * (FarTerrain::TILE_SAMPLES - 1) * 6;
+static_assert(FarTerrain::TILE_SAMPLES * FarTerrain::TILE_SAMPLES <= 65536, "Tile indices must fit GLushort");
+static_assert(FarTerrain::TILE_SIZE % FarTerrain::SAMPLE_SPACING == 0, "Samples must land on tile edges");
+
+// Block VoxelChunk::generate puts on top of a column of this terrain height and biome
+VoxelID getSurfaceVoxel(int terrain_height, Biome biome)
+{
+    return terrain_height <= WATER_LEVEL ? VOXEL_WATER : getBiomeLayer(biome, 0);
+}
+
+// Rendered height of that block's top face (voxel y spans [y - 0.5, y + 0.5])
+float getSurfaceHeight(int terrain_height)
+{
+    return terrain_height <= WATER_LEVEL ? WATER_LEVEL + 0.5f : terrain_height - 0.5f;
+}
+}
+
+FarTerrain::FarTerrain(uint32_t seed, JobSystem &job_system)
+    : seed(seed), job_system(job_system), index_buffer(0), uniform_view(-1), uniform_projection(-1),
+      uniform_camera_position(-1), uniform_inner_radius(-1), center_tile(0), inner_radius(0.0f),
+      outer_radius(0.0f), ring_valid(false), tiles_rendered_last_frame(0), jobs_in_flight(0)
+{
+}
+
+FarTerrain::~FarTerrain()
+{
+    // Jobs reference this object: wait for them before anything goes away
+    {
+        std::unique_lock<std::mutex> lock(result_mutex);
+        jobs_idle.wait(lock, [this]
+                       { return jobs_in_flight == 0; });
+    }
+
+    for (auto &[coord, tile] : tiles)
+    {
+        releaseTile(tile);
+    }
+    if (index_buffer != 0)
+    {
+        glDeleteBuffers(1, &index_buffer);
+    }
+    if (shader)
+    {
+        glDeleteProgram(shader->ID);
+    }
+}
+
+bool FarTerrain::initialize()
+{
+    // Same search order as the voxel shaders
+    StartupCache cache;
+    for (const char *directory : {"shaders/", "voxel world/"})
+    {
+        shader = cache.loadShader("far_terrain", std::string(directory) + "far_terrain.vs",
+                                  std::string(directory) + "far_terrain.fs");
+        if (shader)
+        {
+            break;
+        }
+    }
+    if (!shader)
+    {
+        std::cerr << "Far terrain: shaders not found" << std::endl;
+        return false;
+    }
+
+    uniform_view = glGetUniformLocation(shader->ID, "view");
+    uniform_projection = glGetUniformLocation(shader->ID, "projection");
+    uniform_camera_position = glGetUniformLocation(shader->ID, "camera_position");
+    uniform_inner_radius = glGetUniformLocation(shader->ID, "inner_radius");
+
+    // Every tile has the same grid topology; x-major vertices, counter-clockwise from above
+    std::vector<GLushort> indices;
+    indices.reserve(TILE_INDEX_COUNT);
+    for (int x = 0; x + 1 < TILE_SAMPLES; x++)
+    {
+        for (int z = 0; z + 1 < TILE_SAMPLES; z++)
+        {
+            GLushort corner = static_cast<GLushort>(x * TILE_SAMPLES + z);
+            GLushort next_x = static_cast<GLushort>(corner + TILE_SAMPLES);
+            indices.insert(indices.end(), {corner, static_cast<GLushort>(corner + 1), next_x,
+                                           next_x, static_cast<GLushort>(corner + 1), static_cast<GLushort>(next_x + 1)});
+        }
+    }
+
+    glGenBuffers(1, &index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    std::cout << "Far terrain: " << TILE_SIZE << "-block tiles, one sample every " << SAMPLE_SPACING
+              << " blocks" << std::endl;
+    return true;
+}
+
+void FarTerrain::update(const glm::vec3 &camera_position, float inner, float outer)
+{
+    glm::ivec2 tile(static_cast<int>(std::floor(camera_position.x / TILE_SIZE)),
+                    static_cast<int>(std::floor(camera_position.z / TILE_SIZE)));
+
+    // The ring only changes when the camera crosses a tile edge or the radii change
+    if (!ring_valid || tile != center_tile || inner != inner_radius || outer != outer_radius)
+    {
+        center_tile = tile;
+        inner_radius = inner;
+        outer_radius = outer;
+        rebuildRing();
+        ring_valid = true;
+    }
+
+    uploadResults();
+    requestTiles();
+}
+
+void FarTerrain::rebuildRing()
+{
+    // Distances from the center tile's middle. The camera can be anywhere in that tile, so
+    // the inner edge keeps one extra tile; the shader cuts the hole exactly.
+    const glm::vec2 center((center_tile.x + 0.5f) * TILE_SIZE, (center_tile.y + 0.5f) * TILE_SIZE);
+    const float keep_inside = std::max(0.0f, inner_radius - TILE_SIZE);
+    const int reach = static_cast<int>(std::ceil(outer_radius / TILE_SIZE)) + 1;
+
+    std::vector<std::pair<float, glm::ivec2>> ring;
+    for (int dx = -reach; dx <= reach; dx++)
+    {
+        for (int dz = -reach; dz <= reach; dz++)
+        {
+            glm::ivec2 coord = center_tile + glm::ivec2(dx, dz);
+            glm::vec2 tile_min = glm::vec2(coord) * static_cast<float>(TILE_SIZE);
+            glm::vec2 tile_max = tile_min + static_cast<float>(TILE_SIZE);
+
+            glm::vec2 nearest = glm::clamp(center, tile_min, tile_max);
+            glm::vec2 farthest(std::abs(center.x - tile_min.x) > std::abs(center.x - tile_max.x) ? tile_min.x : tile_max.x,
+                               std::abs(center.y - tile_min.y) > std::abs(center.y - tile_max.y) ? tile_min.y : tile_max.y);
+
+            float near_distance = glm::distance(center, nearest);
+            if (near_distance <= outer_radius && glm::distance(center, farthest) >= keep_inside)
+            {
+                ring.emplace_back(near_distance, coord);
+            }
+        }
+    }
+
+    std::sort(ring.begin(), ring.end(), [](const auto &a, const auto &b)
+              { return a.first < b.first; });
+    wanted.clear();
+    for (const auto &[distance, coord] : ring)
+    {
+        wanted.push_back(coord);
+    }
+
+    // Drop tiles that left the ring; results of their jobs are ignored when they arrive
+    std::unordered_set<glm::ivec2, TileHash> keep(wanted.begin(), wanted.end());
+    for (auto it = tiles.begin(); it != tiles.end();)
+    {
+        if (keep.count(it->first) == 0)
+        {
+            releaseTile(it->second);
+            it = tiles.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void FarTerrain::requestTiles()
+{
+    for (const glm::ivec2 &coord : wanted)
+    {
+        if (tiles.count(coord) != 0)
+        {
+            continue;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(result_mutex);
+            if (jobs_in_flight >= MAX_JOBS_IN_FLIGHT)
+            {
+                return;
+            }
+            jobs_in_flight++;
+        }
+
+        tiles.emplace(coord, Tile());
+        job_system.submit([this, coord]
+                          {
+                              TileResult result;
+                              generateTile(coord, result);
+
+                              std::unique_lock<std::mutex> lock(result_mutex);
+                              results.push_back(std::move(result));
+                              if (--jobs_in_flight == 0)
+                              {
+                                  jobs_idle.notify_all();
+                              } },
+                          JobPriority::Low);
+    }
+}
+
+void FarTerrain::uploadResults()
+{
+    std::vector<TileResult> finished;
+    {
+        std::unique_lock<std::mutex> lock(result_mutex);
+        size_t count = std::min(results.size(), static_cast<size_t>(MAX_UPLOADS_PER_FRAME));
+        finished.assign(std::make_move_iterator(results.begin()), std::make_move_iterator(results.begin() + count));
+        results.erase(results.begin(), results.begin() + count);
+    }
+
+    for (TileResult &result : finished)
+    {
+        auto it = tiles.find(result.coord);
+        if (it == tiles.end() || it->second.ready)
+        {
+            continue; // Left the ring while generating
+        }
+
+        Tile &tile = it->second;
+        glGenVertexArrays(1, &tile.VAO);
+        glGenBuffers(1, &tile.VBO);
+        glBindVertexArray(tile.VAO);
+
+        glBindBuffer(GL_ARRAY_BUFFER, tile.VBO);
+        glBufferData(GL_ARRAY_BUFFER, result.vertices.size() * sizeof(FarTerrainVertex), result.vertices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(FarTerrainVertex), (void *)offsetof(FarTerrainVertex, x));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_BYTE, GL_TRUE, sizeof(FarTerrainVertex), (void *)offsetof(FarTerrainVertex, normal));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(FarTerrainVertex), (void *)offsetof(FarTerrainVertex, color));
+        glEnableVertexAttribArray(2);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+
+        glBindVertexArray(0);
+
+        tile.min_y = result.min_y;
+        tile.max_y = result.max_y;
+        tile.ready = true;
+    }
+}
+
+void FarTerrain::releaseTile(Tile &tile)
+{
+    if (tile.VAO != 0)
+    {
+        glDeleteVertexArrays(1, &tile.VAO);
+        tile.VAO = 0;
+    }
+    if (tile.VBO != 0)
+    {
+        glDeleteBuffers(1, &tile.VBO);
+        tile.VBO = 0;
+    }
+    tile.ready = false;
+}
+
+void FarTerrain::generateTile(const glm::ivec2 &coord, TileResult &result) const
+{
+    // One sample of border on every side so edge normals see across the tile boundary
+    constexpr int GRID = TILE_SAMPLES + 2;
+    thread_local std::vector<int> heights;
+    thread_local std::vector<uint8_t> biomes;
+    heights.resize(GRID * GRID);
+    biomes.resize(GRID * GRID);
+
+    const int start_x = coord.x * TILE_SIZE - SAMPLE_SPACING;
+    const int start_z = coord.y * TILE_SIZE - SAMPLE_SPACING;
+    VoxelNoise::forThread(seed).generateHeightField(start_x, start_z, GRID, GRID, heights.data(), SAMPLE_SPACING,
+                                                    biomes.data());
+
+    auto surface = [&](int x, int z)
+    { return getSurfaceHeight(heights[x * GRID + z]); };
+
+    result.coord = coord;
+    result.vertices.clear();
+    result.vertices.reserve(TILE_SAMPLES * TILE_SAMPLES);
+    result.min_y = 1.0e9f;
+    result.max_y = -1.0e9f;
+
+    for (int x = 1; x <= TILE_SAMPLES; x++)
+    {
+        for (int z = 1; z <= TILE_SAMPLES; z++)
+        {
+            int height = heights[x * GRID + z];
+            float y = getSurfaceHeight(height) - SINK_DEPTH;
+            glm::vec3 normal = glm::normalize(glm::vec3(surface(x - 1, z) - surface(x + 1, z), 2.0f * SAMPLE_SPACING,
+                                                        surface(x, z - 1) - surface(x, z + 1)));
+            const uint8_t *color = BlockRegistry::get().getMapColor(getSurfaceVoxel(height, static_cast<Biome>(biomes[x * GRID + z])));
+
+            FarTerrainVertex vertex;
+            vertex.x = static_cast<float>(start_x + x * SAMPLE_SPACING);
+            vertex.y = y;
+            vertex.z = static_cast<float>(start_z + z * SAMPLE_SPACING);
+            vertex.normal[0] = static_cast<int8_t>(normal.x * 127.0f);
+            vertex.normal[1] = static_cast<int8_t>(normal.y * 127.0f);
+            vertex.normal[2] = static_cast<int8_t>(normal.z * 127.0f);
+            vertex.normal[3] = 0;
+            vertex.color[0] = color[0];
+            vertex.color[1] = color[1];
+            vertex.color[2] = color[2];
+            vertex.color[3] = 255;
+            result.vertices.push_back(vertex);
+
+            result.min_y = std::min(result.min_y, y);
+            result.max_y = std::max(result.max_y, y);
+        }
+    }
+}
+
+void FarTerrain::render(const glm::mat4 &view, const glm::mat4 &projection, const Frustum &frustum)
+{
+    tiles_rendered_last_frame = 0;
+    if (!shader || tiles.empty())
+    {
+        return;
+    }
+
+    shader->use();
+    glUniformMatrix4fv(uniform_view, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(uniform_projection, 1, GL_FALSE, glm::value_ptr(projection));
+    glm::vec3 camera_position = glm::vec3(glm::inverse(view)[3]);
+    glUniform3f(uniform_camera_position, camera_position.x, camera_position.y, camera_position.z);
+    glUniform1f(uniform_inner_radius, inner_radius);
+
+    const float half_size = TILE_SIZE * 0.5f;
+    for (const auto &[coord, tile] : tiles)
+    {
+        if (!tile.ready)
+        {
+            continue;
+        }
+
+        glm::vec3 center(coord.x * TILE_SIZE + half_size, (tile.min_y + tile.max_y) * 0.5f, coord.y * TILE_SIZE + half_size);
+        glm::vec3 half_extents(half_size, (tile.max_y - tile.min_y) * 0.5f + 1.0f, half_size);
+        if (!frustum.isBoxVisible(center, half_extents))
+        {
+            continue;
+        }
+
+        glBindVertexArray(tile.VAO);
+        glDrawElements(GL_TRIANGLES, TILE_INDEX_COUNT, GL_UNSIGNED_SHORT, nullptr);
+        tiles_rendered_last_frame++;
+    }
+    glBindVertexArray(0);
+}
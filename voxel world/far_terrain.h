@@ -0,0 +1,128 @@
+#ifndef FAR_TERRAIN_H
+#define FAR_TERRAIN_H
+
+#include "voxel_types.h"
+#include <glm/glm/glm.hpp>
+#include <glad/glad/glad.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class Frustum;
+class JobSystem;
+class Shader;
+
+// Heightfield vertex of the far terrain (20 bytes, world-space position)
+struct FarTerrainVertex
+{
+    float x, y, z;
+    int8_t normal[4];  // Normalized, w unused
+    uint8_t color[4];  // Top block tint, a unused
+};
+static_assert(sizeof(FarTerrainVertex) == 20, "FarTerrainVertex must stay packed");
+
+// Low-resolution terrain drawn past the voxel render distance.
+//
+// Tiles are sampled straight from the terrain height function (no voxel chunks exist out
+// there) on a coarse grid and tinted by the block that generation would put on top. They
+// are kept in a ring around the camera: tiles entering the ring are generated on the job
+// system, tiles leaving it are dropped, so moving only touches the ring's edges. The
+// surface sits slightly below the real terrain and fragments inside the voxel radius are
+// discarded, so voxel chunks always win where both exist.
+class FarTerrain
+{
+public:
+    static constexpr int TILE_SIZE = 128;     // World blocks per tile side (8 chunks)
+    static constexpr int SAMPLE_SPACING = 4;  // Blocks between height samples
+    static constexpr int TILE_SAMPLES = TILE_SIZE / SAMPLE_SPACING + 1; // Vertices per side; edges are shared
+    static constexpr float SINK_DEPTH = 2.0f; // Keeps the surface under voxel terrain that overlaps it
+
+    FarTerrain(uint32_t seed, JobSystem &job_system);
+    ~FarTerrain();
+
+    FarTerrain(const FarTerrain &) = delete;
+    FarTerrain &operator=(const FarTerrain &) = delete;
+
+    // Load shaders and the index buffer shared by every tile
+    bool initialize();
+
+    // Main thread: keep tiles between the two radii (world blocks) around the camera,
+    // request missing ones and upload finished ones
+    void update(const glm::vec3 &camera_position, float inner_radius, float outer_radius);
+
+    // Main thread: draw the ready tiles that pass the frustum test (depth test enabled)
+    void render(const glm::mat4 &view, const glm::mat4 &projection, const Frustum &frustum);
+
+    size_t getTileCount() const { return tiles.size(); }
+    size_t getTilesRendered() const { return tiles_rendered_last_frame; }
+    size_t getTrianglesRendered() const { return tiles_rendered_last_frame * TRIANGLES_PER_TILE; }
+
+private:
+    static constexpr int MAX_JOBS_IN_FLIGHT = 8; // Low priority; keeps the ring from crowding chunk work
+    static constexpr int MAX_UPLOADS_PER_FRAME = 4;
+    static constexpr size_t TRIANGLES_PER_TILE = static_cast<size_t>(TILE_SAMPLES - 1) * (TILE_SAMPLES - 1) * 2;
+
+    struct TileHash
+    {
+        std::size_t operator()(const glm::ivec2 &v) const
+        {
+            uint64_t h = static_cast<uint64_t>(static_cast<uint32_t>(v.x)) * 0x9E3779B185EBCA87ull;
+            h ^= static_cast<uint64_t>(static_cast<uint32_t>(v.y)) * 0xC2B2AE3D27D4EB4Full;
+            h ^= h >> 29;
+            return static_cast<std::size_t>(h);
+        }
+    };
+
+    struct Tile
+    {
+        GLuint VAO = 0;
+        GLuint VBO = 0;
+        float min_y = 0.0f;
+        float max_y = 0.0f;
+        bool ready = false; // False while its job is in flight
+    };
+
+    struct TileResult
+    {
+        glm::ivec2 coord;
+        std::vector<FarTerrainVertex> vertices;
+        float min_y;
+        float max_y;
+    };
+
+    const uint32_t seed;
+    JobSystem &job_system;
+    std::unique_ptr<Shader> shader;
+    GLuint index_buffer;
+    GLint uniform_view;
+    GLint uniform_projection;
+    GLint uniform_camera_position;
+    GLint uniform_inner_radius;
+
+    // Main thread only
+    std::unordered_map<glm::ivec2, Tile, TileHash> tiles;
+    std::vector<glm::ivec2> wanted; // Tiles of the current ring, nearest first
+    glm::ivec2 center_tile;
+    float inner_radius;
+    float outer_radius;
+    bool ring_valid;
+    size_t tiles_rendered_last_frame;
+
+    // Finished jobs, handed to the main thread
+    std::mutex result_mutex;
+    std::condition_variable jobs_idle;
+    std::vector<TileResult> results;
+    int jobs_in_flight;
+
+    void rebuildRing();
+    void requestTiles();
+    void uploadResults();
+    void releaseTile(Tile &tile);
+    void generateTile(const glm::ivec2 &coord, TileResult &result) const;
+};
+
+#endif // FAR_TERRAIN_H
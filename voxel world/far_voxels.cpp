@@ -0,0 +1,379 @@
+#include "far_voxels.h"
+#include "voxel_chunk.h"
+#include "block_registry.h"
+#include "frustum.h"
+#include "job_system.h"
+#include "startup_cache.h"
+#include "voxel_noise.h"
+#include "log.h"
+#include "../shader.h"
+#include <glm/glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+
+bool FarVoxels::isSupported()
+{
+#ifdef GL_VERSION_4_3
+    return GLAD_GL_VERSION_4_3 != 0;
+#else
+    return false;
+#endif
+}
+
+FarVoxels::FarVoxels(uint32_t seed, JobSystem &job_system)
+    : seed(seed), job_system(job_system), color_buffer(0), empty_vao(0), uniform_view_projection(-1),
+      uniform_camera_position(-1), uniform_column_origin(-1), uniform_box_min(-1), uniform_box_max(-1),
+      uniform_inner_radius(-1), uniform_zero_to_one_depth(-1), center_column(0), inner_radius(0.0f),
+      outer_radius(0.0f), terrain_mode(TerrainMode::Heightmap), epoch(0), ring_valid(false),
+      columns_rendered_last_frame(0), uploaded_bytes(0), jobs_in_flight(0)
+{
+}
+
+FarVoxels::~FarVoxels()
+{
+    // Jobs reference this object: wait for them before anything goes away
+    {
+        std::unique_lock<std::mutex> lock(result_mutex);
+        jobs_idle.wait(lock, [this]
+                       { return jobs_in_flight == 0; });
+    }
+
+    for (auto &[coord, column] : columns)
+    {
+        releaseColumn(column);
+    }
+    if (color_buffer != 0)
+    {
+        glDeleteBuffers(1, &color_buffer);
+    }
+    if (empty_vao != 0)
+    {
+        glDeleteVertexArrays(1, &empty_vao);
+    }
+    if (shader)
+    {
+        glDeleteProgram(shader->ID);
+    }
+}
+
+bool FarVoxels::initialize()
+{
+    // Same search order as the voxel shaders
+    StartupCache cache;
+    for (const char *directory : {"shaders/", "voxel world/"})
+    {
+        shader = cache.loadShader("far_voxels", std::string(directory) + "far_voxels.vs",
+                                  std::string(directory) + "far_voxels.fs");
+        if (shader)
+        {
+            break;
+        }
+    }
+    if (!shader)
+    {
+        std::cerr << "Far voxels: shaders not found" << std::endl;
+        return false;
+    }
+
+    uniform_view_projection = glGetUniformLocation(shader->ID, "view_projection");
+    uniform_camera_position = glGetUniformLocation(shader->ID, "camera_position");
+    uniform_column_origin = glGetUniformLocation(shader->ID, "column_origin");
+    uniform_box_min = glGetUniformLocation(shader->ID, "box_min");
+    uniform_box_max = glGetUniformLocation(shader->ID, "box_max");
+    uniform_inner_radius = glGetUniformLocation(shader->ID, "inner_radius");
+    uniform_zero_to_one_depth = glGetUniformLocation(shader->ID, "zero_to_one_depth");
+
+    // Map colors of every registered type, indexed by VoxelID
+    const BlockRegistry &registry = BlockRegistry::get();
+    std::vector<glm::vec4> colors(static_cast<size_t>(registry.getTypeCount()));
+    for (size_t voxel = 0; voxel < colors.size(); voxel++)
+    {
+        const uint8_t *color = registry.getMapColor(static_cast<VoxelID>(voxel));
+        colors[voxel] = glm::vec4(color[0], color[1], color[2], 255.0f) / 255.0f;
+    }
+    glGenBuffers(1, &color_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, color_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, colors.size() * sizeof(glm::vec4), colors.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glGenVertexArrays(1, &empty_vao);
+
+    std::cout << "Far voxels: " << COLUMN_SIZE << "-block columns, raymarched sparse 64-trees" << std::endl;
+    return true;
+}
+
+void FarVoxels::update(const glm::vec3 &camera_position, float inner, float outer, TerrainMode mode)
+{
+    if (mode != terrain_mode)
+    {
+        // Everything was generated for the other terrain
+        terrain_mode = mode;
+        epoch++;
+        for (auto &[coord, column] : columns)
+        {
+            releaseColumn(column);
+        }
+        columns.clear();
+        ring_valid = false;
+    }
+
+    glm::ivec2 column(static_cast<int>(std::floor(camera_position.x / COLUMN_SIZE)),
+                      static_cast<int>(std::floor(camera_position.z / COLUMN_SIZE)));
+
+    // The ring only changes when the camera crosses a column edge or the radii change
+    if (!ring_valid || column != center_column || inner != inner_radius || outer != outer_radius)
+    {
+        center_column = column;
+        inner_radius = inner;
+        outer_radius = outer;
+        rebuildRing();
+        ring_valid = true;
+    }
+
+    uploadResults();
+    requestColumns();
+}
+
+void FarVoxels::rebuildRing()
+{
+    // Distances from the center column's middle, as FarTerrain::rebuildRing does: the inner
+    // edge keeps one extra column and the shader cuts the hole exactly
+    const glm::vec2 center((center_column.x + 0.5f) * COLUMN_SIZE, (center_column.y + 0.5f) * COLUMN_SIZE);
+    const float keep_inside = std::max(0.0f, inner_radius - COLUMN_SIZE);
+    const int reach = static_cast<int>(std::ceil(outer_radius / COLUMN_SIZE)) + 1;
+
+    std::vector<std::pair<float, glm::ivec2>> ring;
+    for (int dx = -reach; dx <= reach; dx++)
+    {
+        for (int dz = -reach; dz <= reach; dz++)
+        {
+            glm::ivec2 coord = center_column + glm::ivec2(dx, dz);
+            glm::vec2 column_min = glm::vec2(coord) * static_cast<float>(COLUMN_SIZE);
+            glm::vec2 column_max = column_min + static_cast<float>(COLUMN_SIZE);
+
+            glm::vec2 nearest = glm::clamp(center, column_min, column_max);
+            glm::vec2 farthest(std::abs(center.x - column_min.x) > std::abs(center.x - column_max.x) ? column_min.x : column_max.x,
+                               std::abs(center.y - column_min.y) > std::abs(center.y - column_max.y) ? column_min.y : column_max.y);
+
+            float near_distance = glm::distance(center, nearest);
+            if (near_distance <= outer_radius && glm::distance(center, farthest) >= keep_inside)
+            {
+                ring.emplace_back(near_distance, coord);
+            }
+        }
+    }
+
+    std::sort(ring.begin(), ring.end(), [](const auto &a, const auto &b)
+              { return a.first < b.first; });
+    wanted.clear();
+    for (const auto &[distance, coord] : ring)
+    {
+        wanted.push_back(coord);
+    }
+
+    // Drop columns that left the ring; results of their jobs are ignored when they arrive
+    std::unordered_set<glm::ivec2, ColumnHash> keep(wanted.begin(), wanted.end());
+    for (auto it = columns.begin(); it != columns.end();)
+    {
+        if (keep.count(it->first) == 0)
+        {
+            releaseColumn(it->second);
+            it = columns.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void FarVoxels::requestColumns()
+{
+    for (const glm::ivec2 &coord : wanted)
+    {
+        if (columns.count(coord) != 0)
+        {
+            continue;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(result_mutex);
+            if (jobs_in_flight >= MAX_JOBS_IN_FLIGHT)
+            {
+                return;
+            }
+            jobs_in_flight++;
+        }
+
+        columns.emplace(coord, Column());
+        job_system.submit([this, coord, mode = terrain_mode, job_epoch = epoch]
+                          {
+                              ColumnResult result{coord, job_epoch, SparseVoxelTree()};
+                              buildColumn(coord, mode, result.tree);
+
+                              std::unique_lock<std::mutex> lock(result_mutex);
+                              results.push_back(std::move(result));
+                              if (--jobs_in_flight == 0)
+                              {
+                                  jobs_idle.notify_all();
+                              } },
+                          JobPriority::Low);
+    }
+}
+
+void FarVoxels::uploadResults()
+{
+    std::vector<ColumnResult> finished;
+    {
+        std::unique_lock<std::mutex> lock(result_mutex);
+        size_t count = std::min(results.size(), static_cast<size_t>(MAX_UPLOADS_PER_FRAME));
+        finished.assign(std::make_move_iterator(results.begin()), std::make_move_iterator(results.begin() + count));
+        results.erase(results.begin(), results.begin() + count);
+    }
+
+    for (ColumnResult &result : finished)
+    {
+        auto it = columns.find(result.coord);
+        if (result.epoch != epoch || it == columns.end() || it->second.ready)
+        {
+            continue; // Left the ring (or the terrain changed) while building
+        }
+
+        Column &column = it->second;
+        column.ready = true;
+        if (result.tree.getVoxelCount() == 0)
+        {
+            continue; // Nothing to draw
+        }
+
+        const std::vector<uint32_t> &words = result.tree.getWords();
+        glGenBuffers(1, &column.buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, column.buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, words.size() * sizeof(uint32_t), words.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        column.bytes = words.size() * sizeof(uint32_t);
+        column.min_y = result.tree.getMinY();
+        column.max_y = result.tree.getMaxY();
+        uploaded_bytes += column.bytes;
+    }
+}
+
+void FarVoxels::releaseColumn(Column &column)
+{
+    if (column.buffer != 0)
+    {
+        glDeleteBuffers(1, &column.buffer);
+        column.buffer = 0;
+        uploaded_bytes -= column.bytes;
+        column.bytes = 0;
+    }
+    column.ready = false;
+}
+
+void FarVoxels::buildColumn(const glm::ivec2 &coord, TerrainMode mode, SparseVoxelTree &tree) const
+{
+    // Heights of the column and of a one-block ring around it (the tree's border estimate)
+    constexpr int GRID = COLUMN_SIZE + 2;
+    thread_local std::vector<int> heights;
+    heights.resize(GRID * GRID);
+    const int start_x = coord.x * COLUMN_SIZE;
+    const int start_z = coord.y * COLUMN_SIZE;
+    VoxelNoise::forThread(seed).generateHeightField(start_x - 1, start_z - 1, GRID, GRID, heights.data());
+
+    // Caves of the rock far under the surface are never seen from out here. Density terrain
+    // can carve below its heights, so all of it is generated.
+    const int lowest = *std::min_element(heights.begin(), heights.end());
+    const int first_layer = mode == TerrainMode::Heightmap ? std::max(0, (lowest - SKIPPED_DEPTH) / CHUNK_HEIGHT) : 0;
+
+    // One chunk per worker, reset for every position, like voxel_pregen; each layer's
+    // storages are kept (copies share their words)
+    thread_local std::unique_ptr<VoxelChunk> chunk;
+    std::vector<PaletteStorage> storages;
+    storages.reserve(SparseVoxelTree::CHUNKS);
+    std::array<const PaletteStorage *, SparseVoxelTree::CHUNKS> chunks{};
+    for (int layer = first_layer; layer < SparseVoxelTree::LAYERS; layer++)
+    {
+        for (int cx = 0; cx < 4; cx++)
+        {
+            for (int cz = 0; cz < 4; cz++)
+            {
+                glm::ivec3 position(coord.x * 4 + cx, layer, coord.y * 4 + cz);
+                if (chunk)
+                {
+                    chunk->reset(position);
+                }
+                else
+                {
+                    chunk = std::make_unique<VoxelChunk>(position);
+                }
+
+                try
+                {
+                    chunk->generate(seed, nullptr, mode);
+                }
+                catch (const std::exception &e)
+                {
+                    Log::writeLimited(LogLevel::Error, "Chunk generation failures", std::string("Chunk generation failed: ") + e.what());
+                    continue; // Counts as rock
+                }
+                storages.push_back(chunk->voxels);
+                chunks[(layer * 4 + cx) * 4 + cz] = &storages.back();
+            }
+        }
+    }
+
+    tree.build(chunks.data(), heights.data());
+}
+
+void FarVoxels::render(const glm::mat4 &view, const glm::mat4 &projection, const Frustum &frustum, bool zero_to_one_depth)
+{
+    columns_rendered_last_frame = 0;
+    if (!shader || columns.empty())
+    {
+        return;
+    }
+
+    shader->use();
+    glm::mat4 view_projection = projection * view;
+    glUniformMatrix4fv(uniform_view_projection, 1, GL_FALSE, glm::value_ptr(view_projection));
+    glm::vec3 camera_position = glm::vec3(glm::inverse(view)[3]);
+    glUniform3f(uniform_camera_position, camera_position.x, camera_position.y, camera_position.z);
+    glUniform1f(uniform_inner_radius, inner_radius);
+    glUniform1i(uniform_zero_to_one_depth, zero_to_one_depth ? 1 : 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, color_buffer);
+    glBindVertexArray(empty_vao);
+
+    // Back faces: they are there whether the camera is outside the box or inside it
+    glCullFace(GL_FRONT);
+    for (const auto &[coord, column] : columns)
+    {
+        if (column.buffer == 0)
+        {
+            continue;
+        }
+
+        // Voxel y spans [y - 0.5, y + 0.5]
+        glm::vec3 origin(coord.x * COLUMN_SIZE - 0.5f, -0.5f, coord.y * COLUMN_SIZE - 0.5f);
+        glm::vec3 box_min(0.0f, static_cast<float>(column.min_y), 0.0f);
+        glm::vec3 box_max(static_cast<float>(COLUMN_SIZE), static_cast<float>(column.max_y), static_cast<float>(COLUMN_SIZE));
+        if (!frustum.isBoxVisible(origin + (box_min + box_max) * 0.5f, (box_max - box_min) * 0.5f))
+        {
+            continue;
+        }
+
+        glUniform3fv(uniform_column_origin, 1, glm::value_ptr(origin));
+        glUniform3fv(uniform_box_min, 1, glm::value_ptr(box_min));
+        glUniform3fv(uniform_box_max, 1, glm::value_ptr(box_max));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, column.buffer);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        columns_rendered_last_frame++;
+    }
+    glCullFace(GL_BACK);
+
+    glBindVertexArray(0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+}
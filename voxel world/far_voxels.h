@@ -0,0 +1,130 @@
+#ifndef FAR_VOXELS_H
+#define FAR_VOXELS_H
+
+#include "voxel_types.h"
+#include "sparse_voxel_tree.h"
+#include "density_terrain.h"
+#include <glm/glm/glm.hpp>
+#include <glad/glad/glad.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class Frustum;
+class JobSystem;
+class Shader;
+
+// Raymarched voxels drawn past the voxel render distance, the alternative to FarTerrain's
+// heightfield (GL 4.3: the trees are shader storage buffers).
+//
+// The ring around the camera is made of 64-block world columns. A job generates a column's
+// chunks layer by layer like the world does (VoxelChunk::generate, on the world's seed and
+// terrain mode, without touching the world), keeps their palette storages (uniform chunks,
+// most of them, stay a single value) and folds the surface voxels into a SparseVoxelTree.
+// Layers well below the lowest terrain height are not generated. Each tree is uploaded to
+// its own storage buffer; drawing a column rasterizes the box of its voxels and
+// far_voxels.fs walks the tree from the camera through every fragment, writing the hit's
+// depth. Edits saved in region files are not shown, as with the heightfield.
+class FarVoxels
+{
+public:
+    static constexpr int COLUMN_SIZE = SparseVoxelTree::SIZE;
+
+    static bool isSupported();
+
+    FarVoxels(uint32_t seed, JobSystem &job_system);
+    ~FarVoxels();
+
+    FarVoxels(const FarVoxels &) = delete;
+    FarVoxels &operator=(const FarVoxels &) = delete;
+
+    // Load shaders and the voxel color table (after the block registry)
+    bool initialize();
+
+    // Main thread: keep columns between the two radii (world blocks) around the camera,
+    // request missing ones and upload finished ones; a new terrain mode drops every column
+    void update(const glm::vec3 &camera_position, float inner_radius, float outer_radius, TerrainMode mode);
+
+    // Main thread: raymarch the ready columns that pass the frustum test (depth test enabled);
+    // zero_to_one_depth matches the glClipControl depth range in use
+    void render(const glm::mat4 &view, const glm::mat4 &projection, const Frustum &frustum, bool zero_to_one_depth);
+
+    size_t getColumnCount() const { return columns.size(); }
+    size_t getColumnsRendered() const { return columns_rendered_last_frame; }
+    size_t getMemoryUsage() const { return uploaded_bytes; } // Storage buffer bytes
+
+private:
+    static constexpr int MAX_JOBS_IN_FLIGHT = 4; // Low priority; a column is 128 chunk generations
+    static constexpr int MAX_UPLOADS_PER_FRAME = 4;
+    static constexpr int SKIPPED_DEPTH = 16; // Layers ending this far under the lowest terrain are rock
+
+    struct ColumnHash
+    {
+        std::size_t operator()(const glm::ivec2 &v) const
+        {
+            uint64_t h = static_cast<uint64_t>(static_cast<uint32_t>(v.x)) * 0x9E3779B185EBCA87ull;
+            h ^= static_cast<uint64_t>(static_cast<uint32_t>(v.y)) * 0xC2B2AE3D27D4EB4Full;
+            h ^= h >> 29;
+            return static_cast<std::size_t>(h);
+        }
+    };
+
+    struct Column
+    {
+        GLuint buffer = 0;
+        size_t bytes = 0;
+        int min_y = 0; // Kept voxels, column grid space (max exclusive)
+        int max_y = 0;
+        bool ready = false; // False while its job is in flight
+    };
+
+    struct ColumnResult
+    {
+        glm::ivec2 coord;
+        uint32_t epoch;
+        SparseVoxelTree tree;
+    };
+
+    const uint32_t seed;
+    JobSystem &job_system;
+    std::unique_ptr<Shader> shader;
+    GLuint color_buffer;
+    GLuint empty_vao; // The box comes from gl_VertexID
+    GLint uniform_view_projection;
+    GLint uniform_camera_position;
+    GLint uniform_column_origin;
+    GLint uniform_box_min;
+    GLint uniform_box_max;
+    GLint uniform_inner_radius;
+    GLint uniform_zero_to_one_depth;
+
+    // Main thread only
+    std::unordered_map<glm::ivec2, Column, ColumnHash> columns;
+    std::vector<glm::ivec2> wanted; // Columns of the current ring, nearest first
+    glm::ivec2 center_column;
+    float inner_radius;
+    float outer_radius;
+    TerrainMode terrain_mode;
+    uint32_t epoch; // Bumped when every column is dropped; older results are ignored
+    bool ring_valid;
+    size_t columns_rendered_last_frame;
+    size_t uploaded_bytes;
+
+    // Finished jobs, handed to the main thread
+    std::mutex result_mutex;
+    std::condition_variable jobs_idle;
+    std::vector<ColumnResult> results;
+    int jobs_in_flight;
+
+    void rebuildRing();
+    void requestColumns();
+    void uploadResults();
+    void releaseColumn(Column &column);
+    void buildColumn(const glm::ivec2 &coord, TerrainMode mode, SparseVoxelTree &tree) const;
+};
+
+#endif // FAR_VOXELS_H
@@ -0,0 +1,79 @@
+#include "file_mapping.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+FileMapping::FileMapping(const std::string &path)
+{
+#ifdef _WIN32
+    mapping = nullptr;
+    // Shared for writing so other handles can keep appending
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    LARGE_INTEGER file_size{};
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+        return;
+    }
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        return;
+    }
+    data = static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    size = data ? static_cast<size_t>(file_size.QuadPart) : 0;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return;
+    }
+    void *view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps its own reference
+    if (view != MAP_FAILED)
+    {
+        data = static_cast<const unsigned char *>(view);
+        size = static_cast<size_t>(info.st_size);
+    }
+#endif
+}
+
+FileMapping::~FileMapping()
+{
+#ifdef _WIN32
+    if (data)
+    {
+        UnmapViewOfFile(data);
+    }
+    if (mapping)
+    {
+        CloseHandle(mapping);
+    }
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file);
+    }
+#else
+    if (data)
+    {
+        munmap(const_cast<unsigned char *>(data), size);
+    }
+#endif
+}
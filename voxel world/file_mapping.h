@@ -0,0 +1,29 @@
+#ifndef FILE_MAPPING_H
+#define FILE_MAPPING_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file (mmap / CreateFileMapping); data is null if the file is
+// missing, empty or cannot be mapped. Other handles may keep writing to the file, which
+// this view sees through the shared page cache, up to its original size.
+class FileMapping
+{
+public:
+    explicit FileMapping(const std::string &path);
+    ~FileMapping();
+
+    FileMapping(const FileMapping &) = delete;
+    FileMapping &operator=(const FileMapping &) = delete;
+
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+
+private:
+#ifdef _WIN32
+    void *file;    // HANDLE
+    void *mapping; // HANDLE
+#endif
+};
+
+#endif // FILE_MAPPING_H
@@ -0,0 +1,229 @@
+#include "fluid_simulator.h"
+#include "profiler.h"
+#include <algorithm>
+
+namespace
+{
+const glm::ivec3 SIDE_DIRECTIONS[4] = {glm::ivec3(0, 0, 1), glm::ivec3(0, 0, -1), glm::ivec3(1, 0, 0), glm::ivec3(-1, 0, 0)};
+const glm::ivec3 UP(0, 1, 0);
+
+uint16_t localIndex(const glm::ivec3 &position)
+{
+    glm::ivec3 local = VoxelWorld::worldToLocal(position);
+    return static_cast<uint16_t>(VoxelChunk::coordsToIndex(local.x, local.y, local.z));
+}
+}
+
+FluidSimulator::FluidSimulator(VoxelWorld &world) : world(world), last_tick(std::chrono::steady_clock::now())
+{
+}
+
+void FluidSimulator::voxelEdited(const glm::ivec3 &position)
+{
+    // Whatever was written replaces the flow: placed water is a source
+    setLevel(position, 0);
+    edited.push_back(position);
+}
+
+void FluidSimulator::chunkUnloaded(const glm::ivec3 &chunk_pos)
+{
+    // Active cells in it are dropped when their turn comes
+    flow_levels.erase(chunk_pos);
+}
+
+size_t FluidSimulator::getFlowingCellCount() const
+{
+    size_t count = 0;
+    for (const auto &[chunk_pos, levels] : flow_levels)
+    {
+        count += levels.size();
+    }
+    return count;
+}
+
+void FluidSimulator::update()
+{
+    if (isIdle())
+    {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<float>(now - last_tick).count() < TICK_SECONDS)
+    {
+        return;
+    }
+    last_tick = now;
+    tick();
+}
+
+void FluidSimulator::tick()
+{
+    PROFILE_ZONE("FluidSimulator::tick");
+
+    // Edits only matter where water can react to them
+    for (const glm::ivec3 &position : edited)
+    {
+        bool near_water = world.getVoxel(position) == VOXEL_WATER || world.getVoxel(position + UP) == VOXEL_WATER ||
+                          world.getVoxel(position - UP) == VOXEL_WATER;
+        for (int i = 0; i < 4 && !near_water; i++)
+        {
+            near_water = world.getVoxel(position + SIDE_DIRECTIONS[i]) == VOXEL_WATER;
+        }
+        if (near_water)
+        {
+            activateAround(position);
+        }
+    }
+    edited.clear();
+
+    // Cells activated while this tick runs wait for the next one, so water moves one cell per tick
+    changes.clear();
+    size_t count = std::min(cell_budget, active.size());
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::ivec3 position = active.front();
+        active.pop_front();
+        queued.erase(position);
+        if (!isLoaded(position))
+        {
+            continue;
+        }
+        world.touchChunk(VoxelWorld::worldToChunk(position));
+
+        VoxelID voxel = world.getVoxel(position);
+        if (voxel != VOXEL_AIR && voxel != VOXEL_WATER)
+        {
+            continue;
+        }
+        int level = getLevel(position, voxel);
+        if (level == SOURCE_LEVEL)
+        {
+            continue;
+        }
+        int supported = getSupportedLevel(position);
+        if (supported != level)
+        {
+            changes.push_back({position, supported, (level == 0) != (supported == 0)});
+        }
+    }
+
+    // Voxel changes as one batch; the edits wake their neighborhood for the next tick
+    edits.clear();
+    for (const Change &change : changes)
+    {
+        if (change.voxel_changed)
+        {
+            edits.push_back({change.position, change.level > 0 ? VOXEL_WATER : VOXEL_AIR});
+        }
+    }
+    if (!edits.empty())
+    {
+        world.applyEdits(edits);
+    }
+
+    for (const Change &change : changes)
+    {
+        setLevel(change.position, change.level);
+        if (!change.voxel_changed)
+        {
+            activateAround(change.position); // Same voxel, so no edit announces it
+        }
+    }
+}
+
+void FluidSimulator::activate(const glm::ivec3 &position)
+{
+    if (queued.insert(position).second)
+    {
+        active.push_back(position);
+    }
+}
+
+void FluidSimulator::activateAround(const glm::ivec3 &position)
+{
+    activate(position);
+    activate(position + UP);
+    activate(position - UP);
+    for (const glm::ivec3 &side : SIDE_DIRECTIONS)
+    {
+        activate(position + side);
+    }
+}
+
+int FluidSimulator::getLevel(const glm::ivec3 &position, VoxelID voxel) const
+{
+    if (voxel != VOXEL_WATER)
+    {
+        return 0;
+    }
+    auto chunk = flow_levels.find(VoxelWorld::worldToChunk(position));
+    if (chunk == flow_levels.end())
+    {
+        return SOURCE_LEVEL;
+    }
+    auto cell = chunk->second.find(localIndex(position));
+    return cell != chunk->second.end() ? cell->second : SOURCE_LEVEL;
+}
+
+void FluidSimulator::setLevel(const glm::ivec3 &position, int level)
+{
+    glm::ivec3 chunk_pos = VoxelWorld::worldToChunk(position);
+    if (level > 0 && level < SOURCE_LEVEL)
+    {
+        flow_levels[chunk_pos][localIndex(position)] = static_cast<uint8_t>(level);
+        return;
+    }
+
+    auto chunk = flow_levels.find(chunk_pos);
+    if (chunk != flow_levels.end())
+    {
+        chunk->second.erase(localIndex(position));
+        if (chunk->second.empty())
+        {
+            flow_levels.erase(chunk);
+        }
+    }
+}
+
+int FluidSimulator::getSupportedLevel(const glm::ivec3 &position)
+{
+    // Water above always falls in at full strength
+    glm::ivec3 above = position + UP;
+    if (isLoaded(above) && world.getVoxel(above) == VOXEL_WATER)
+    {
+        return FALLING_LEVEL;
+    }
+
+    int supported = 0;
+    for (const glm::ivec3 &side : SIDE_DIRECTIONS)
+    {
+        glm::ivec3 neighbor = position + side;
+        if (!isLoaded(neighbor))
+        {
+            continue;
+        }
+        int level = getLevel(neighbor, world.getVoxel(neighbor));
+        if (level <= supported + 1)
+        {
+            continue;
+        }
+
+        // Water that can fall does not spread sideways; unloaded ground counts as solid
+        glm::ivec3 below = neighbor - UP;
+        if (isLoaded(below))
+        {
+            VoxelID below_voxel = world.getVoxel(below);
+            if (below_voxel == VOXEL_AIR || (below_voxel == VOXEL_WATER && getLevel(below, below_voxel) != SOURCE_LEVEL))
+            {
+                continue;
+            }
+        }
+        supported = level - 1;
+    }
+    return supported;
+}
+
+bool FluidSimulator::isLoaded(const glm::ivec3 &position) const
+{
+    return world.isChunkLoaded(VoxelWorld::worldToChunk(position));
+}
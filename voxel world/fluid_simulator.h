@@ -0,0 +1,81 @@
+#ifndef FLUID_SIMULATOR_H
+#define FLUID_SIMULATOR_H
+
+#include "voxel_world.h"
+#include <glm/glm/glm.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Flowing water, simulated only where something changed.
+//
+// Water placed by terrain or edits is a source and never drains. Flowing water is the same
+// VOXEL_WATER voxel with a level kept here: water falling onto a cell gives FALLING_LEVEL,
+// and one that cannot fall spreads to its sides one level lower per step. Each tick
+// re-evaluates a bounded number of active cells (edited voxels next to water and the
+// neighbors of whatever the previous tick changed), writes the changes as one
+// VoxelWorld::applyEdits batch (one remesh and one relight per touched chunk) and goes idle
+// once nothing is left to settle. Cells in unloaded chunks act as walls.
+//
+// Levels are not saved: flowing water in a chunk that unloads comes back as still sources.
+class FluidSimulator
+{
+public:
+    static constexpr int SOURCE_LEVEL = 8;
+    static constexpr int FALLING_LEVEL = SOURCE_LEVEL - 1;
+    static constexpr size_t DEFAULT_CELL_BUDGET = 1024; // Active cells evaluated per tick
+    static constexpr float TICK_SECONDS = 0.2f;         // Water spreads one cell per tick
+
+    explicit FluidSimulator(VoxelWorld &world);
+
+    // Main thread. A voxel of the world changed (VoxelWorld edits call this); cheap, the
+    // neighborhood is only looked at on the next tick
+    void voxelEdited(const glm::ivec3 &position);
+    void chunkUnloaded(const glm::ivec3 &chunk_pos);
+
+    // Main thread, every frame: runs a tick when one is due and there is work
+    void update();
+    void tick();
+
+    bool isIdle() const { return active.empty() && edited.empty(); }
+    size_t getActiveCellCount() const { return active.size(); }
+    size_t getFlowingCellCount() const;
+    void setCellBudget(size_t cells) { cell_budget = cells > 0 ? cells : 1; }
+    size_t getCellBudget() const { return cell_budget; }
+
+private:
+    // A cell this tick decided to change; written after every cell was evaluated
+    struct Change
+    {
+        glm::ivec3 position;
+        int level; // 0 drains the cell
+        bool voxel_changed;
+    };
+
+    VoxelWorld &world;
+    size_t cell_budget = DEFAULT_CELL_BUDGET;
+    std::chrono::steady_clock::time_point last_tick;
+
+    std::vector<glm::ivec3> edited; // Since the last tick
+    std::deque<glm::ivec3> active;  // Oldest first
+    std::unordered_set<glm::ivec3, Vec3Hash> queued; // Cells in active
+
+    // Levels of flowing cells by chunk, then VoxelChunk::coordsToIndex
+    std::unordered_map<glm::ivec3, std::unordered_map<uint16_t, uint8_t>, Vec3Hash> flow_levels;
+
+    std::vector<Change> changes;
+    std::vector<VoxelEdit> edits;
+
+    void activate(const glm::ivec3 &position);
+    void activateAround(const glm::ivec3 &position); // The cell and its six neighbors
+    int getLevel(const glm::ivec3 &position, VoxelID voxel) const; // 0 if not water
+    void setLevel(const glm::ivec3 &position, int level); // 0 or SOURCE_LEVEL forget it
+    int getSupportedLevel(const glm::ivec3 &position); // Level the neighbors feed into a cell
+    bool isLoaded(const glm::ivec3 &position) const;
+};
+
+#endif // FLUID_SIMULATOR_H
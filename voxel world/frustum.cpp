@@ -0,0 +1,125 @@
+#include "frustum.h"
+#include <cmath>
+
+void Frustum::update(const glm::mat4 &view_projection, bool zero_to_one_depth)
+{
+    // Gribb-Hartmann: each plane is the fourth row plus or minus one of the other rows.
+    // glm is column-major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i]).
+    const glm::mat4 &m = view_projection;
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    glm::vec4 planes[PLANE_COUNT] = {
+        row3 + row0, // Left
+        row3 - row0, // Right
+        row3 + row1, // Bottom
+        row3 - row1, // Top
+        zero_to_one_depth ? row2 : row3 + row2, // Near
+        row3 - row2  // Far
+    };
+
+    for (int i = 0; i < PLANE_COUNT; i++)
+    {
+        float length = std::sqrt(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+        float inv_length = length > 0.0f ? 1.0f / length : 0.0f;
+        normal_x[i] = planes[i].x * inv_length;
+        normal_y[i] = planes[i].y * inv_length;
+        normal_z[i] = planes[i].z * inv_length;
+        distance[i] = planes[i].w * inv_length; // A degenerate plane (zero normal) keeps everything
+    }
+}
+
+bool Frustum::isBoxVisible(const glm::vec3 &center, const glm::vec3 &half_extents) const
+{
+    uint8_t visible = 0;
+    cullBoxes(&center.x, &center.y, &center.z, 1, half_extents, &visible);
+    return visible != 0;
+}
+
+Frustum::Containment Frustum::classifyBox(const glm::vec3 &center, const glm::vec3 &half_extents) const
+{
+    Containment containment = Containment::Inside;
+    for (int p = 0; p < PLANE_COUNT; p++)
+    {
+        float signed_distance = normal_x[p] * center.x + normal_y[p] * center.y + normal_z[p] * center.z + distance[p];
+        float radius = std::fabs(normal_x[p]) * half_extents.x + std::fabs(normal_y[p]) * half_extents.y +
+                       std::fabs(normal_z[p]) * half_extents.z;
+        if (signed_distance + radius < 0.0f)
+        {
+            return Containment::Outside;
+        }
+        if (signed_distance - radius < 0.0f)
+        {
+            containment = Containment::Intersecting;
+        }
+    }
+    return containment;
+}
+
+size_t Frustum::cullBoxes(const float *center_x, const float *center_y, const float *center_z, size_t count,
+                          const glm::vec3 &half_extents, uint8_t *visible) const
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        visible[i] = 1;
+    }
+
+    // Plane-outer loop: the extents are shared, so each plane's projected radius is a constant
+    // and the inner loop is a straight multiply-add over the center arrays
+    for (int p = 0; p < PLANE_COUNT; p++)
+    {
+        const float nx = normal_x[p];
+        const float ny = normal_y[p];
+        const float nz = normal_z[p];
+        const float d = distance[p];
+        const float radius = std::fabs(nx) * half_extents.x + std::fabs(ny) * half_extents.y + std::fabs(nz) * half_extents.z;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            float signed_distance = nx * center_x[i] + ny * center_y[i] + nz * center_z[i] + d;
+            visible[i] &= static_cast<uint8_t>(signed_distance + radius >= 0.0f);
+        }
+    }
+
+    size_t visible_count = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        visible_count += visible[i];
+    }
+    return visible_count;
+}
+
+size_t Frustum::cullBoxes(const float *center_x, const float *center_y, const float *center_z, const float *half_y,
+                          size_t count, const glm::vec3 &half_extents, uint8_t *visible) const
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        visible[i] = 1;
+    }
+
+    // As above, the vertical part of the radius read per box
+    for (int p = 0; p < PLANE_COUNT; p++)
+    {
+        const float nx = normal_x[p];
+        const float ny = normal_y[p];
+        const float nz = normal_z[p];
+        const float d = distance[p];
+        const float radius_xz = std::fabs(nx) * half_extents.x + std::fabs(nz) * half_extents.z;
+        const float abs_ny = std::fabs(ny);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            float signed_distance = nx * center_x[i] + ny * center_y[i] + nz * center_z[i] + d;
+            visible[i] &= static_cast<uint8_t>(signed_distance + radius_xz + abs_ny * half_y[i] >= 0.0f);
+        }
+    }
+
+    size_t visible_count = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        visible_count += visible[i];
+    }
+    return visible_count;
+}
@@ -0,0 +1,95 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// View frustum as six planes extracted from a view-projection matrix.
+//
+// Planes are kept in structure-of-arrays form and boxes are tested in bulk from contiguous
+// center arrays, so the per-box loop has no branches and vectorizes. All boxes in a batch
+// share the same half extents (every chunk has the same bounds), or the same horizontal
+// ones with a height per box (chunks trimmed to the layers their mesh occupies).
+class Frustum
+{
+public:
+    enum Plane
+    {
+        PLANE_LEFT = 0,
+        PLANE_RIGHT,
+        PLANE_BOTTOM,
+        PLANE_TOP,
+        PLANE_NEAR,
+        PLANE_FAR,
+        PLANE_COUNT
+    };
+
+    enum class Containment
+    {
+        Outside,
+        Intersecting,
+        Inside
+    };
+
+    // Extract normalized planes (normals point inward) from projection * view. With a [0, 1]
+    // clip depth range (glClipControl) the near plane is z >= 0 instead of z >= -w; for a
+    // reverse-Z infinite projection that is the far plane at infinity, which tests nothing.
+    void update(const glm::mat4 &view_projection, bool zero_to_one_depth = false);
+
+    // Single box test
+    bool isBoxVisible(const glm::vec3 &center, const glm::vec3 &half_extents) const;
+    // Whether a box is entirely outside, straddles a plane or is entirely inside, for
+    // hierarchical tests that accept or reject everything a box bounds at once
+    Containment classifyBox(const glm::vec3 &center, const glm::vec3 &half_extents) const;
+
+    // Bulk test: writes 1 (visible) or 0 (culled) per box and returns the visible count
+    size_t cullBoxes(const float *center_x, const float *center_y, const float *center_z, size_t count,
+                     const glm::vec3 &half_extents, uint8_t *visible) const;
+    // Same, with half_y per box (half_extents.y is ignored)
+    size_t cullBoxes(const float *center_x, const float *center_y, const float *center_z, const float *half_y,
+                     size_t count, const glm::vec3 &half_extents, uint8_t *visible) const;
+
+private:
+    float normal_x[PLANE_COUNT];
+    float normal_y[PLANE_COUNT];
+    float normal_z[PLANE_COUNT];
+    float distance[PLANE_COUNT];
+};
+
+// Contiguous chunk centers (and half heights, when pushed with one) for bulk frustum tests
+struct ChunkBoundsSoA
+{
+    std::vector<float> center_x;
+    std::vector<float> center_y;
+    std::vector<float> center_z;
+    std::vector<float> half_y;
+    std::vector<uint8_t> visible;
+
+    void clear()
+    {
+        center_x.clear();
+        center_y.clear();
+        center_z.clear();
+        half_y.clear();
+        visible.clear();
+    }
+
+    void push(const glm::vec3 &center)
+    {
+        center_x.push_back(center.x);
+        center_y.push_back(center.y);
+        center_z.push_back(center.z);
+    }
+
+    void push(const glm::vec3 &center, float half_height)
+    {
+        push(center);
+        half_y.push_back(half_height);
+    }
+
+    size_t size() const { return center_x.size(); }
+};
+
+#endif // FRUSTUM_H
@@ -0,0 +1,241 @@
+#include "gl_render_backend.h"
+#include "chunk_mesh.h"
+#include "startup_cache.h"
+#include "../shader.h"
+#include <algorithm>
+
+namespace
+{
+GLuint g_quad_index_buffer = 0;
+}
+
+RenderBackend::Buffer GLRenderBackend::createBuffer()
+{
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    return buffer;
+}
+
+size_t GLRenderBackend::writeBuffer(Buffer buffer, const void *data, size_t bytes, size_t capacity)
+{
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    if (bytes <= capacity)
+    {
+        if (data)
+        {
+            glBufferSubData(GL_COPY_WRITE_BUFFER, 0, bytes, data);
+        }
+    }
+    else
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, bytes, data, GL_DYNAMIC_DRAW);
+        capacity = bytes;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return capacity;
+}
+
+void GLRenderBackend::copyBuffer(Buffer source, size_t source_offset, Buffer target, size_t target_offset, size_t bytes)
+{
+    glBindBuffer(GL_COPY_READ_BUFFER, source);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, target);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, source_offset, target_offset, bytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GLRenderBackend::destroyBuffer(Buffer buffer)
+{
+    if (buffer != 0)
+    {
+        glDeleteBuffers(1, &buffer);
+    }
+}
+
+bool GLRenderBackend::allocateBuffer(Buffer buffer, size_t bytes)
+{
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW);
+    bool allocated = glGetError() != GL_OUT_OF_MEMORY;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return allocated;
+}
+
+void GLRenderBackend::updateBuffer(Buffer buffer, size_t offset, const void *data, size_t bytes)
+{
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GLRenderBackend::readBuffer(Buffer buffer, size_t offset, void *data, size_t bytes)
+{
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, offset, bytes, data);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void GLRenderBackend::streamBuffer(Buffer buffer, const void *data, size_t bytes)
+{
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, bytes, data, GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void *GLRenderBackend::mapPersistentBuffer(Buffer buffer, size_t bytes)
+{
+    void *mapped = nullptr;
+#ifdef GL_VERSION_4_4
+    if (GLAD_GL_VERSION_4_4)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, bytes, nullptr, flags);
+        mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bytes, flags);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+#endif
+    return mapped;
+}
+
+RenderBackend::Geometry GLRenderBackend::createGeometry(Buffer vertices, MeshFormat format, Buffer region_offsets)
+{
+    GeometryObjects objects{0, 0};
+    glGenVertexArrays(1, &objects.vertex_array);
+    glBindVertexArray(objects.vertex_array);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, getQuadIndexBuffer());
+    if (format == MeshFormat::Faces)
+    {
+        // No vertex array: attribute 0 reads the generic sentinel and voxel.vs pulls the
+        // records through a buffer texture
+        glGenTextures(1, &objects.record_texture);
+        glBindTexture(GL_TEXTURE_BUFFER, objects.record_texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, vertices);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    else
+    {
+        // Packed position/face/texture word, read as an integer attribute
+        glBindBuffer(GL_ARRAY_BUFFER, vertices);
+        glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(VoxelVertex), (void *)offsetof(VoxelVertex, data));
+        glEnableVertexAttribArray(0);
+    }
+    if (region_offsets != 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, region_offsets);
+        glVertexAttribPointer(2, 3, GL_UNSIGNED_BYTE, GL_FALSE, 4, (void *)0);
+        glEnableVertexAttribArray(2);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (!free_geometries.empty())
+    {
+        Geometry geometry = free_geometries.back();
+        free_geometries.pop_back();
+        geometries[geometry - 1] = objects;
+        return geometry;
+    }
+    geometries.push_back(objects);
+    return static_cast<Geometry>(geometries.size());
+}
+
+void GLRenderBackend::destroyGeometry(Geometry geometry)
+{
+    if (geometry == 0)
+    {
+        return;
+    }
+    GeometryObjects &objects = geometries[geometry - 1];
+    glDeleteVertexArrays(1, &objects.vertex_array);
+    if (objects.record_texture != 0)
+    {
+        glDeleteTextures(1, &objects.record_texture);
+    }
+    objects = {0, 0};
+    free_geometries.push_back(geometry);
+}
+
+void GLRenderBackend::setDrawOrigin(const glm::vec3 &origin)
+{
+    // Chunk VAOs leave the origin attribute disabled, so draws read this constant value;
+    // three floats per draw instead of a matrix uniform
+    glVertexAttrib3f(1, origin.x, origin.y, origin.z);
+}
+
+void GLRenderBackend::drawGeometry(Geometry geometry, const QuadRun *runs, size_t run_count, int instances)
+{
+    if (geometry == 0 || run_count == 0)
+    {
+        return;
+    }
+
+    const GeometryObjects &objects = geometries[geometry - 1];
+    glBindVertexArray(objects.vertex_array);
+    if (objects.record_texture != 0)
+    {
+        glActiveTexture(GL_TEXTURE0 + FACE_RECORD_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, objects.record_texture);
+    }
+    // Pattern indices 4k.. plus base_vertex give vertex ids 4 * (first quad + k) + corner:
+    // the corners themselves, or for records the id voxel.vs fetches the record by
+    for (size_t i = 0; i < run_count; i++)
+    {
+        size_t end = runs[i].first_quad + runs[i].quad_count;
+        for (size_t quad = runs[i].first_quad; quad < end; quad += QUAD_PATTERN_QUADS)
+        {
+            size_t quads = std::min(end - quad, QUAD_PATTERN_QUADS);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(quads * 6), GL_UNSIGNED_SHORT, nullptr,
+                                              instances, static_cast<GLint>(quad * 4));
+        }
+    }
+    if (objects.record_texture != 0)
+    {
+        glActiveTexture(GL_TEXTURE0);
+    }
+    glBindVertexArray(0);
+}
+
+std::unique_ptr<Shader> GLRenderBackend::loadPipeline(const std::string &name, const std::string &vertex_path,
+                                                      const std::string &fragment_path)
+{
+    // Restored from the program binary cache when the sources and driver are unchanged
+    StartupCache cache;
+    return cache.loadShader(name, vertex_path, fragment_path);
+}
+
+void GLRenderBackend::releaseShared()
+{
+    if (g_quad_index_buffer != 0)
+    {
+        glDeleteBuffers(1, &g_quad_index_buffer);
+        g_quad_index_buffer = 0;
+    }
+}
+
+GLuint GLRenderBackend::getQuadIndexBuffer()
+{
+    if (g_quad_index_buffer != 0)
+    {
+        return g_quad_index_buffer;
+    }
+
+    std::vector<GLushort> pattern(QUAD_PATTERN_QUADS * 6);
+    for (size_t quad = 0; quad < QUAD_PATTERN_QUADS; quad++)
+    {
+        GLushort base = static_cast<GLushort>(quad * 4);
+        GLushort *target = pattern.data() + quad * 6;
+        target[0] = static_cast<GLushort>(base + 0);
+        target[1] = static_cast<GLushort>(base + 1);
+        target[2] = static_cast<GLushort>(base + 2);
+        target[3] = static_cast<GLushort>(base + 2);
+        target[4] = static_cast<GLushort>(base + 3);
+        target[5] = static_cast<GLushort>(base + 0);
+    }
+
+    glGenBuffers(1, &g_quad_index_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, g_quad_index_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, pattern.size() * sizeof(GLushort), pattern.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return g_quad_index_buffer;
+}
@@ -0,0 +1,56 @@
+#ifndef GL_RENDER_BACKEND_H
+#define GL_RENDER_BACKEND_H
+
+#include "render_backend.h"
+#include <glad/glad/glad.h>
+#include <vector>
+
+// RenderBackend over OpenGL 3.3. Buffers are buffer objects, a geometry is a vertex array
+// (and for face records a buffer texture over its vertices) with the quad index pattern
+// bound, and pipelines are programs restored through the StartupCache. Contents reused in
+// place (writeBuffer within capacity) go through glBufferSubData, streamed ones are orphaned
+// with glBufferData and persistent mappings need OpenGL 4.4 (glBufferStorage). Objects are
+// left to the context at exit: call releaseShared while it is current.
+class GLRenderBackend : public RenderBackend
+{
+public:
+    const char *getName() const override { return "OpenGL 3.3"; }
+
+    Buffer createBuffer() override;
+    size_t writeBuffer(Buffer buffer, const void *data, size_t bytes, size_t capacity = 0) override;
+    void copyBuffer(Buffer source, size_t source_offset, Buffer target, size_t target_offset, size_t bytes) override;
+    void destroyBuffer(Buffer buffer) override;
+    bool allocateBuffer(Buffer buffer, size_t bytes) override;
+    void updateBuffer(Buffer buffer, size_t offset, const void *data, size_t bytes) override;
+    void readBuffer(Buffer buffer, size_t offset, void *data, size_t bytes) override;
+    void streamBuffer(Buffer buffer, const void *data, size_t bytes) override;
+    void *mapPersistentBuffer(Buffer buffer, size_t bytes) override;
+
+    Geometry createGeometry(Buffer vertices, MeshFormat format, Buffer region_offsets = 0) override;
+    void destroyGeometry(Geometry geometry) override;
+
+    void setDrawOrigin(const glm::vec3 &origin) override;
+    void drawGeometry(Geometry geometry, const QuadRun *runs, size_t run_count, int instances) override;
+
+    std::unique_ptr<Shader> loadPipeline(const std::string &name, const std::string &vertex_path,
+                                         const std::string &fragment_path) override;
+
+    void releaseShared() override;
+
+    // 16-bit index pattern 0,1,2, 2,3,0 per quad for QUAD_PATTERN_QUADS quads, shared by
+    // every chunk draw: base_vertex picks the first quad's corners (or 4 * first record).
+    // Also bound by the multi-draw arena.
+    static GLuint getQuadIndexBuffer();
+
+private:
+    struct GeometryObjects
+    {
+        GLuint vertex_array;   // 0: free slot
+        GLuint record_texture; // MeshFormat::Faces only
+    };
+
+    std::vector<GeometryObjects> geometries; // By handle - 1
+    std::vector<Geometry> free_geometries;
+};
+
+#endif // GL_RENDER_BACKEND_H
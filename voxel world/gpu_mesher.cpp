@@ -0,0 +1,261 @@
+#include "gpu_mesher.h"
+#include "chunk_mesh.h"
+#include "chunk_snapshot.h"
+#include "chunk_occupancy.h"
+#include "chunk_visibility.h"
+#include "voxel_light.h"
+#include "render_backend.h"
+#include "../shader.h"
+#include <iostream>
+
+namespace
+{
+constexpr int MESH_GROUP = 4;       // local_size of gpu_mesh.comp on each axis
+constexpr size_t BUCKET_COUNT = 18; // MeshPass x FaceDirection
+
+// Mirrors VoxelFaces in gpu_mesh.comp
+struct GpuVoxelFaces
+{
+    uint32_t words[6];   // Face direction and texture slot bits of the vertex word (VoxelVertex)
+    uint32_t passes;     // MeshPass per face direction, two bits each
+    uint32_t transparent;
+    uint32_t culls_same; // BlockRegistry::FLAG_CULLS_SAME
+};
+
+std::unique_ptr<Shader> loadComputeShader(const char *name)
+{
+    // Same search order as the voxel shaders
+    for (const char *directory : {"shaders/", "voxel world/"})
+    {
+        auto shader = std::make_unique<Shader>((std::string(directory) + name).c_str());
+        if (shader->ID != 0)
+        {
+            return shader;
+        }
+    }
+    return nullptr;
+}
+}
+
+bool GpuMesher::isSupported()
+{
+#ifdef GL_VERSION_4_3
+    return GLAD_GL_VERSION_4_3 != 0;
+#else
+    return false;
+#endif
+}
+
+GpuMesher::GpuMesher() : voxel_table(0), builds_completed(0)
+{
+#ifdef GL_VERSION_4_3
+    // What buildMesh looks up per voxel type, resolved once: the shader never sees texture ids
+    const int type_count = BlockRegistry::get().getTypeCount();
+    std::vector<GpuVoxelFaces> table(static_cast<size_t>(type_count));
+    for (int voxel = 0; voxel < type_count; voxel++)
+    {
+        GpuVoxelFaces &faces = table[voxel];
+        faces.passes = 0;
+        for (int face = 0; face < 6; face++)
+        {
+            int texture_id = static_cast<int>(ChunkMesh::getFaceTextureId(static_cast<VoxelID>(voxel), face));
+            faces.words[face] = VoxelVertex(0, 0, 0, face, texture_id, 0, 0).data;
+            MeshPass pass = isTranslucentTexture(texture_id)   ? MeshPass::Translucent
+                            : isAlphaTestedTexture(texture_id) ? MeshPass::Cutout
+                                                               : MeshPass::Opaque;
+            faces.passes |= static_cast<uint32_t>(pass) << (2 * face);
+        }
+        uint8_t flags = BlockRegistry::get().getFlags(static_cast<VoxelID>(voxel));
+        faces.transparent = (flags & BlockRegistry::FLAG_TRANSPARENT) != 0 ? 1 : 0;
+        faces.culls_same = (flags & BlockRegistry::FLAG_CULLS_SAME) != 0 ? 1 : 0;
+    }
+    RenderBackend &backend = RenderBackend::get();
+    voxel_table = backend.createBuffer();
+    backend.writeBuffer(voxel_table, table.data(), table.size() * sizeof(GpuVoxelFaces));
+
+    for (size_t i = 0; i < slots.size(); i++)
+    {
+        slots[i].voxel_buffer = backend.createBuffer();
+        backend.allocateBuffer(slots[i].voxel_buffer, ChunkSnapshot::PADDED_VOLUME * sizeof(uint32_t));
+        slots[i].counter_buffer = backend.createBuffer();
+        backend.allocateBuffer(slots[i].counter_buffer, 2 * BUCKET_COUNT * sizeof(GLuint));
+        free_slots.push_back(slots.size() - 1 - i);
+    }
+#endif
+}
+
+GpuMesher::~GpuMesher()
+{
+    for (Build &build : builds)
+    {
+        glDeleteSync(build.counted);
+    }
+    RenderBackend &backend = RenderBackend::get();
+    for (Slot &slot : slots)
+    {
+        backend.destroyBuffer(slot.voxel_buffer);
+        backend.destroyBuffer(slot.counter_buffer);
+    }
+    backend.destroyBuffer(voxel_table);
+}
+
+bool GpuMesher::loadShaders()
+{
+    mesh_shader = loadComputeShader("gpu_mesh.comp");
+    if (!mesh_shader)
+    {
+        std::cerr << "GPU meshing: failed to load compute shader" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool GpuMesher::prepareInput(const ChunkSnapshot &chunk, GpuMeshInput &out)
+{
+    if (chunk.isUniform() && chunk.getUniformVoxel() == VOXEL_AIR)
+    {
+        return false;
+    }
+
+    thread_local std::array<VoxelID, CHUNK_VOLUME> decoded_voxels;
+    thread_local std::array<VoxelID, ChunkSnapshot::PADDED_VOLUME> padded_voxels;
+    thread_local std::array<uint8_t, ChunkSnapshot::PADDED_VOLUME> padded_light;
+    chunk.decodeVoxels(decoded_voxels.data());
+
+    thread_local ChunkOccupancy occupancy;
+    summarizeOccupancy(decoded_voxels.data(), occupancy);
+    if (occupancy.non_air_count == 0)
+    {
+        return false;
+    }
+
+    chunk.decodePadded(decoded_voxels.data(), padded_voxels.data());
+    chunk.decodePaddedLight(padded_light.data());
+    out.voxels.resize(ChunkSnapshot::PADDED_VOLUME);
+    for (int i = 0; i < ChunkSnapshot::PADDED_VOLUME; i++)
+    {
+        out.voxels[i] = padded_voxels[i] | (static_cast<uint32_t>(getCombinedLight(padded_light[i])) << 16);
+    }
+
+    if (chunk.isUniform())
+    {
+        out.face_connectivity = isVoxelTransparent(chunk.getUniformVoxel()) ? FACE_CONNECTIVITY_ALL : FACE_CONNECTIVITY_NONE;
+    }
+    else
+    {
+        out.face_connectivity = computeFaceConnectivity(decoded_voxels.data());
+    }
+    out.min_occupied_y = occupancy.min_y;
+    out.max_occupied_y = occupancy.max_y;
+    return true;
+}
+
+bool GpuMesher::submit(const GpuMeshInput &input)
+{
+    if (free_slots.empty() || !mesh_shader)
+    {
+        return false;
+    }
+
+#ifdef GL_VERSION_4_3
+    size_t slot_index = free_slots.back();
+    free_slots.pop_back();
+    const Slot &slot = slots[slot_index];
+
+    const GLuint zero[BUCKET_COUNT] = {};
+    RenderBackend &backend = RenderBackend::get();
+    backend.updateBuffer(slot.voxel_buffer, 0, input.voxels.data(), input.voxels.size() * sizeof(uint32_t));
+    backend.updateBuffer(slot.counter_buffer, 0, zero, sizeof(zero));
+
+    dispatch(slot, false, 0);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT); // The readback in poll sees the counts
+
+    builds.push_back({slot_index, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), input.face_connectivity,
+                      input.min_occupied_y, input.max_occupied_y});
+    return true;
+#else
+    return false;
+#endif
+}
+
+size_t GpuMesher::poll(ChunkArena &arena, std::vector<GpuMeshOutput> &finished)
+{
+    size_t emitted = 0;
+#ifdef GL_VERSION_4_3
+    while (!builds.empty())
+    {
+        Build &build = builds.front();
+        if (glClientWaitSync(build.counted, 0, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            break;
+        }
+        const Slot &slot = slots[build.slot];
+
+        GpuMeshOutput output;
+        RenderBackend &backend = RenderBackend::get();
+        backend.readBuffer(slot.counter_buffer, 0, output.quad_counts.data(), BUCKET_COUNT * sizeof(GLuint));
+
+        // Cursors start at each bucket's first vertex: the layout groupByDirection gives CPU builds
+        std::array<GLuint, BUCKET_COUNT> cursors;
+        size_t total_quads = 0;
+        for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++)
+        {
+            cursors[bucket] = static_cast<GLuint>(total_quads * 4);
+            total_quads += output.quad_counts[bucket / 6][bucket % 6];
+        }
+        if (total_quads > 0)
+        {
+            if (!arena.reserve(total_quads * 4, output.range))
+            {
+                break; // Retried next frame with the counts still in place
+            }
+            for (GLuint &cursor : cursors)
+            {
+                cursor += static_cast<GLuint>(output.range.offset);
+            }
+            backend.updateBuffer(slot.counter_buffer, BUCKET_COUNT * sizeof(GLuint), cursors.data(), sizeof(cursors));
+            dispatch(slot, true, arena.getVertexBuffer());
+            // Draws read the vertices; an arena growth copies them
+            glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+        }
+
+        output.face_connectivity = build.face_connectivity;
+        output.min_occupied_y = build.min_occupied_y;
+        output.max_occupied_y = build.max_occupied_y;
+        finished.push_back(output);
+
+        glDeleteSync(build.counted);
+        free_slots.push_back(build.slot);
+        builds.pop_front();
+        builds_completed++;
+        emitted++;
+    }
+#endif
+    return emitted;
+}
+
+void GpuMesher::dispatch(const Slot &slot, bool emit, GLuint vertex_buffer)
+{
+#ifdef GL_VERSION_4_3
+    GLint previous_program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+
+    glUseProgram(mesh_shader->ID);
+    mesh_shader->setBool("emit", emit);
+    glUniform1ui(glGetUniformLocation(mesh_shader->ID, "voxel_type_count"), static_cast<GLuint>(BlockRegistry::get().getTypeCount()));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, slot.voxel_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, voxel_table);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, slot.counter_buffer);
+    if (emit)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, vertex_buffer);
+    }
+    glDispatchCompute(CHUNK_SIZE / MESH_GROUP, CHUNK_HEIGHT / MESH_GROUP, CHUNK_SIZE / MESH_GROUP);
+
+    for (GLuint binding = 0; binding < 4; binding++)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+    }
+    glUseProgram(static_cast<GLuint>(previous_program));
+#endif
+}
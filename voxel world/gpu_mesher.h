@@ -0,0 +1,107 @@
+#ifndef GPU_MESHER_H
+#define GPU_MESHER_H
+
+#include "voxel_types.h"
+#include "chunk_arena.h"
+#include <glad/glad/glad.h>
+#include <array>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+class Shader;
+class ChunkSnapshot;
+
+// What a mesh job hands the GPU mesher: the padded voxels of the chunk, each word a VoxelID
+// with the combined light of that voxel in bits 16-19 (ChunkSnapshot::paddedIndex order),
+// plus the summaries the CPU build would have computed. Built on a worker.
+struct GpuMeshInput
+{
+    std::vector<uint32_t> voxels; // ChunkSnapshot::PADDED_VOLUME words
+    uint16_t face_connectivity = 0;
+    int min_occupied_y = 0;
+    int max_occupied_y = CHUNK_HEIGHT - 1;
+};
+
+// A finished GPU build: its vertices are in the arena at range, sorted like a CPU build's
+// by MeshPass, then by face direction
+struct GpuMeshOutput
+{
+    ArenaRange range; // Invalid if no face is visible
+    std::array<std::array<uint32_t, 6>, 3> quad_counts{}; // [MeshPass][FaceDirection]
+    uint16_t face_connectivity = 0;
+    int min_occupied_y = 0;
+    int max_occupied_y = CHUNK_HEIGHT - 1;
+};
+
+// Compute-shader meshing backend (GL 4.3) for full-detail MeshFormat::Indexed builds.
+//
+// A build is two dispatches of gpu_mesh.comp over the padded voxels. The first only counts
+// the visible faces of every pass and direction bucket with atomic counters; its counts are
+// read back behind a fence a frame or so later, without stalling. Then the arena range is
+// allocated and the second dispatch emits the faces straight into the arena vertex buffer:
+// each face takes its slot from an atomic cursor of its bucket, so the buffer is compacted
+// and bucketed as it is written and never goes through the CPU. Faces are per voxel,
+// like MeshingMode::Naive, with baked light and corner occlusion.
+//
+// Builds complete in submission order. ChunkMesh::buildMesh stays the fallback (and does
+// LOD, sectioned and face record builds). Buffers and their uploads and readbacks go through
+// the RenderBackend; the dispatches, barriers and fences are OpenGL. Main thread only, apart
+// from prepareInput.
+class GpuMesher
+{
+public:
+    static bool isSupported();
+
+    // Builds submitted and not emitted yet, each holding a voxel buffer
+    static constexpr size_t MAX_BUILDS_IN_FLIGHT = 8;
+
+    GpuMesher();
+    ~GpuMesher();
+
+    GpuMesher(const GpuMesher &) = delete;
+    GpuMesher &operator=(const GpuMesher &) = delete;
+
+    bool loadShaders();
+
+    // Any thread: decode the snapshot for submit; false if the chunk has nothing to mesh
+    // (the CPU build is then just as fast)
+    static bool prepareInput(const ChunkSnapshot &chunk, GpuMeshInput &out);
+
+    // Upload the voxels and dispatch the count pass; false while MAX_BUILDS_IN_FLIGHT are out
+    bool submit(const GpuMeshInput &input);
+    // Emit every build whose counts have arrived, oldest first, into finished (appended);
+    // stops at the first still counting or one the arena has no room for. Returns the count.
+    size_t poll(ChunkArena &arena, std::vector<GpuMeshOutput> &finished);
+
+    size_t getBuildsInFlight() const { return builds.size(); }
+    size_t getBuildsCompleted() const { return builds_completed; }
+
+private:
+    // Per in-flight build: its voxels, and counters (18 counts, then 18 cursors)
+    struct Slot
+    {
+        GLuint voxel_buffer = 0;
+        GLuint counter_buffer = 0;
+    };
+    struct Build
+    {
+        size_t slot;
+        GLsync counted;
+        uint16_t face_connectivity;
+        int min_occupied_y;
+        int max_occupied_y;
+    };
+
+    std::unique_ptr<Shader> mesh_shader;
+    GLuint voxel_table; // GpuVoxelFaces per VoxelID
+    std::array<Slot, MAX_BUILDS_IN_FLIGHT> slots;
+    std::vector<size_t> free_slots;
+    std::deque<Build> builds; // Submission order
+    size_t builds_completed;
+
+    void dispatch(const Slot &slot, bool emit, GLuint vertex_buffer);
+};
+
+#endif // GPU_MESHER_H
@@ -0,0 +1,70 @@
+#include "gpu_timer.h"
+
+GpuTimer::GpuTimer()
+{
+    for (PassQueries &pass : passes)
+    {
+        glGenQueries(QUERIES_PER_PASS, pass.queries.data());
+    }
+}
+
+GpuTimer::~GpuTimer()
+{
+    for (PassQueries &pass : passes)
+    {
+        glDeleteQueries(QUERIES_PER_PASS, pass.queries.data());
+    }
+}
+
+void GpuTimer::begin(GpuPass pass_id)
+{
+    PassQueries &pass = passes[static_cast<int>(pass_id)];
+    collect(pass);
+    if (pass.pending[pass.next])
+    {
+        pass.active = -1; // Oldest query is still in flight: skip rather than wait for it
+        return;
+    }
+
+    pass.active = pass.next;
+    pass.next = (pass.next + 1) % QUERIES_PER_PASS;
+    glBeginQuery(GL_TIME_ELAPSED, pass.queries[pass.active]);
+}
+
+void GpuTimer::end(GpuPass pass_id)
+{
+    PassQueries &pass = passes[static_cast<int>(pass_id)];
+    if (pass.active < 0)
+    {
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    pass.pending[pass.active] = true;
+    pass.active = -1;
+}
+
+void GpuTimer::collect(PassQueries &pass)
+{
+    // Oldest first, so last_ms ends on the newest finished frame
+    for (int i = 0; i < QUERIES_PER_PASS; i++)
+    {
+        int index = (pass.next + i) % QUERIES_PER_PASS;
+        if (!pass.pending[index])
+        {
+            continue;
+        }
+
+        GLint available = 0;
+        glGetQueryObjectiv(pass.queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            break; // Later queries finish after this one
+        }
+
+        GLuint64 elapsed_ns = 0;
+        glGetQueryObjectui64v(pass.queries[index], GL_QUERY_RESULT, &elapsed_ns);
+        pass.last_ms = static_cast<float>(elapsed_ns) / 1000000.0f;
+        pass.pending[index] = false;
+    }
+}
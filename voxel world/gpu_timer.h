@@ -0,0 +1,55 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad/glad.h>
+#include <array>
+
+// Render phases timed on the GPU
+enum class GpuPass
+{
+    Opaque,      // Depth pre-pass, opaque, cutout and far terrain
+    Transparent, // Back-to-front translucent draws
+    Upload,      // Mesh buffer uploads and staging copies
+    Count
+};
+
+// GL_TIME_ELAPSED queries around each render phase (core since GL 3.3).
+//
+// Every phase cycles through a few query objects, so a result is read a frame or two after
+// it was issued and only once the GPU reports it available: reading never stalls the
+// pipeline. A phase whose queries are all still in flight skips being timed that frame.
+// Main thread only.
+class GpuTimer
+{
+public:
+    static constexpr int QUERIES_PER_PASS = 3;
+
+    GpuTimer();
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer &) = delete;
+    GpuTimer &operator=(const GpuTimer &) = delete;
+
+    // Brackets one phase; phases must not overlap (one GL_TIME_ELAPSED query at a time)
+    void begin(GpuPass pass);
+    void end(GpuPass pass);
+
+    // Milliseconds of the newest completed measurement (0 before the first)
+    float getTime(GpuPass pass) const { return passes[static_cast<int>(pass)].last_ms; }
+
+private:
+    struct PassQueries
+    {
+        std::array<GLuint, QUERIES_PER_PASS> queries{};
+        std::array<bool, QUERIES_PER_PASS> pending{}; // Issued, result not read yet
+        int next = 0;    // Query the next begin uses (oldest)
+        int active = -1; // Query between begin and end
+        float last_ms = 0.0f;
+    };
+
+    std::array<PassQueries, static_cast<int>(GpuPass::Count)> passes;
+
+    void collect(PassQueries &pass); // Reads every available result without waiting
+};
+
+#endif // GPU_TIMER_H
@@ -0,0 +1,20 @@
+#ifndef HEADLESS_MESH_H
+#define HEADLESS_MESH_H
+
+#include <cstddef>
+
+// Stand-in for ChunkMesh in builds without OpenGL (VOXEL_HEADLESS=1, the dedicated server).
+//
+// Nothing renders there, so no chunk ever gets a mesh and these are only the calls the chunk
+// and world code make on one they might hold. Include it instead of chunk_mesh.h; a target
+// links one or the other, never both.
+class ChunkMesh
+{
+public:
+    bool isBuilt() const { return false; }
+    void markEmpty() {}
+    void recycle() {}
+    size_t getCpuMemoryUsage() const { return 0; }
+};
+
+#endif // HEADLESS_MESH_H
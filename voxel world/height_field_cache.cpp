@@ -0,0 +1,256 @@
+#include "height_field_cache.h"
+#include "height_tile_store.h"
+#include "voxel_noise.h"
+#include <algorithm>
+
+namespace
+{
+int floorDiv(int value, int divisor)
+{
+    int quotient = value / divisor;
+    return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? quotient - 1 : quotient;
+}
+}
+
+HeightFieldCache::HeightFieldCache(uint32_t seed, size_t capacity)
+    : seed(seed), capacity(std::max<size_t>(1, capacity))
+{
+}
+
+HeightFieldCache::TileHandle HeightFieldCache::acquire(const glm::ivec2 &column)
+{
+    glm::ivec2 block_origin(floorDiv(column.x, TILE_BATCH) * TILE_BATCH, floorDiv(column.y, TILE_BATCH) * TILE_BATCH);
+    std::shared_ptr<HeightTile> tile;
+    std::shared_ptr<HeightTileStore> store;
+    // Tiles of the block this miss added besides its own, filled after it
+    std::vector<std::pair<glm::ivec2, std::shared_ptr<HeightTile>>> batch;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        store = disk_store;
+        auto it = tiles.find(column);
+        if (it != tiles.end())
+        {
+            lru.splice(lru.begin(), lru, it->second.lru_position);
+            tile = it->second.tile;
+        }
+        else
+        {
+            tile = std::make_shared<HeightTile>();
+            lru.push_front(column);
+            tiles.emplace(column, Entry{tile, lru.begin()});
+
+            // Cached tiles, ready or being filled by another miss, are left alone
+            for (int dx = 0; dx < TILE_BATCH; dx++)
+            {
+                for (int dz = 0; dz < TILE_BATCH; dz++)
+                {
+                    glm::ivec2 other = block_origin + glm::ivec2(dx, dz);
+                    if (other != column && tiles.find(other) == tiles.end())
+                    {
+                        auto other_tile = std::make_shared<HeightTile>();
+                        lru.push_front(other);
+                        tiles.emplace(other, Entry{other_tile, lru.begin()});
+                        batch.emplace_back(other, std::move(other_tile));
+                    }
+                }
+            }
+            evictOverflow();
+        }
+    }
+
+    // Noise runs outside the cache lock; other threads wanting a tile wait on it alone. The
+    // block is generated on first use, so tiles all found on disk never run the noise.
+    std::vector<int> block_heights;
+    std::vector<uint8_t> block_biomes;
+    auto fill = [&](const glm::ivec2 &at, HeightTile &target)
+    {
+        if (store && store->load(at, target))
+        {
+            return true;
+        }
+        if (batch.empty())
+        {
+            generateTile(at, target);
+        }
+        else
+        {
+            if (block_heights.empty())
+            {
+                generateBlock(block_origin, block_heights, block_biomes);
+            }
+            const int block_size = TILE_BATCH * CHUNK_SIZE;
+            glm::ivec2 offset = (at - block_origin) * CHUNK_SIZE;
+            for (int x = 0; x < CHUNK_SIZE; x++)
+            {
+                size_t source = static_cast<size_t>(offset.x + x) * block_size + offset.y;
+                std::copy_n(block_heights.begin() + source, CHUNK_SIZE, target.heights.begin() + x * CHUNK_SIZE);
+                std::copy_n(block_biomes.begin() + source, CHUNK_SIZE, target.biomes.begin() + x * CHUNK_SIZE);
+            }
+        }
+        if (store)
+        {
+            store->store(at, target);
+        }
+        return false;
+    };
+
+    bool generated_here = false;
+    std::call_once(tile->computed, [&]
+                   {
+                       if (fill(column, *tile))
+                       {
+                           loaded.fetch_add(1, std::memory_order_relaxed);
+                       }
+                       tile->ready.store(true, std::memory_order_release);
+                       generated_here = true; });
+    if (generated_here)
+    {
+        recordArrival(column);
+    }
+
+    // One at a time: a thread never waits on a tile while holding another's once_flag. A
+    // neighbor acquired directly meanwhile is filled by that caller instead, identically.
+    for (auto &[other, other_tile] : batch)
+    {
+        bool filled_here = false;
+        std::call_once(other_tile->computed, [&]
+                       {
+                           fill(other, *other_tile);
+                           other_tile->ready.store(true, std::memory_order_release);
+                           filled_here = true; });
+        if (filled_here)
+        {
+            recordArrival(other);
+        }
+    }
+
+    (generated_here ? misses : hits).fetch_add(1, std::memory_order_relaxed);
+    return tile;
+}
+
+void HeightFieldCache::recordArrival(const glm::ivec2 &column)
+{
+    if (!track_arrivals.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(arrival_mutex);
+    if (arrivals.size() == MAX_PENDING_ARRIVALS)
+    {
+        arrivals.pop_front();
+        arrivals_dropped = true;
+    }
+    arrivals.push_back(column);
+}
+
+HeightFieldCache::TileHandle HeightFieldCache::peek(const glm::ivec2 &column)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = tiles.find(column);
+    if (it == tiles.end() || !it->second.tile->ready.load(std::memory_order_acquire))
+    {
+        return nullptr;
+    }
+    return it->second.tile;
+}
+
+int HeightFieldCache::getHeight(int world_x, int world_z)
+{
+    glm::ivec2 column(floorDiv(world_x, CHUNK_SIZE), floorDiv(world_z, CHUNK_SIZE));
+    if (TileHandle tile = peek(column))
+    {
+        return tile->get(world_x - column.x * CHUNK_SIZE, world_z - column.y * CHUNK_SIZE);
+    }
+
+    // A single lookup is not worth a whole tile
+    return VoxelNoise::forThread(seed).sampleTerrainHeight(world_x, world_z);
+}
+
+Biome HeightFieldCache::getBiome(int world_x, int world_z)
+{
+    glm::ivec2 column(floorDiv(world_x, CHUNK_SIZE), floorDiv(world_z, CHUNK_SIZE));
+    if (TileHandle tile = peek(column))
+    {
+        return tile->getBiome(world_x - column.x * CHUNK_SIZE, world_z - column.y * CHUNK_SIZE);
+    }
+    return VoxelNoise::forThread(seed).sampleBiome(world_x, world_z);
+}
+
+void HeightFieldCache::setCapacity(size_t tile_count)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    capacity = std::max<size_t>(1, tile_count);
+    evictOverflow();
+}
+
+void HeightFieldCache::setDiskStore(std::shared_ptr<HeightTileStore> store)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    disk_store = std::move(store);
+}
+
+void HeightFieldCache::clear()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    tiles.clear();
+    lru.clear();
+}
+
+size_t HeightFieldCache::size()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return tiles.size();
+}
+
+void HeightFieldCache::setArrivalTracking(bool enabled)
+{
+    track_arrivals.store(enabled);
+    if (!enabled)
+    {
+        std::unique_lock<std::mutex> lock(arrival_mutex);
+        arrivals.clear();
+        arrivals_dropped = false;
+    }
+}
+
+bool HeightFieldCache::takeArrivals(std::vector<glm::ivec2> &columns)
+{
+    std::unique_lock<std::mutex> lock(arrival_mutex);
+    columns.assign(arrivals.begin(), arrivals.end());
+    arrivals.clear();
+    bool complete = !arrivals_dropped;
+    arrivals_dropped = false;
+    return complete;
+}
+
+void HeightFieldCache::takeStats(uint64_t &hit_count, uint64_t &miss_count, uint64_t &loaded_count)
+{
+    hit_count = hits.exchange(0);
+    miss_count = misses.exchange(0);
+    loaded_count = loaded.exchange(0);
+}
+
+void HeightFieldCache::evictOverflow()
+{
+    while (tiles.size() > capacity)
+    {
+        tiles.erase(lru.back());
+        lru.pop_back();
+    }
+}
+
+void HeightFieldCache::generateTile(const glm::ivec2 &column, HeightTile &tile) const
+{
+    VoxelNoise::forThread(seed).generateHeightField(column.x * CHUNK_SIZE, column.y * CHUNK_SIZE,
+                                                    CHUNK_SIZE, CHUNK_SIZE, tile.heights.data(), 1, tile.biomes.data());
+}
+
+void HeightFieldCache::generateBlock(const glm::ivec2 &block_origin, std::vector<int> &heights,
+                                     std::vector<uint8_t> &biomes) const
+{
+    const int block_size = TILE_BATCH * CHUNK_SIZE;
+    heights.resize(static_cast<size_t>(block_size) * block_size);
+    biomes.resize(heights.size());
+    VoxelNoise::forThread(seed).generateHeightField(block_origin.x * CHUNK_SIZE, block_origin.y * CHUNK_SIZE,
+                                                    block_size, block_size, heights.data(), 1, biomes.data());
+}
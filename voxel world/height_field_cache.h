@@ -0,0 +1,126 @@
+#ifndef HEIGHT_FIELD_CACHE_H
+#define HEIGHT_FIELD_CACHE_H
+
+#include "voxel_types.h"
+#include <glm/glm/glm.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class HeightTileStore;
+
+// Terrain heights and biomes of one 16x16 chunk column, shared by every chunk stacked in it
+struct HeightTile
+{
+    std::array<int, CHUNK_SIZE * CHUNK_SIZE> heights{}; // x-major: heights[x * CHUNK_SIZE + z]
+    std::array<uint8_t, CHUNK_SIZE * CHUNK_SIZE> biomes{}; // Biome per column, same order
+
+    std::once_flag computed;        // The first reader fills the tile, concurrent ones wait
+    std::atomic<bool> ready{false}; // Set once heights are valid
+
+    int get(int x, int z) const { return heights[x * CHUNK_SIZE + z]; }
+    Biome getBiome(int x, int z) const { return static_cast<Biome>(biomes[x * CHUNK_SIZE + z]); }
+};
+
+// World-level cache of terrain height tiles keyed by chunk (x, z).
+//
+// The eight chunks of a column and the borders of its four neighbors all read the same
+// tile, so each column is run through the noise generators once. Tiles are handed out as
+// shared pointers so eviction never invalidates a reader; least recently used tiles are
+// dropped once the cache holds more than its capacity (sized from the load radius).
+// With a disk store attached, misses are read back from it before falling back to noise,
+// and generated tiles are added to it.
+//
+// A miss fills the whole aligned TILE_BATCH x TILE_BATCH block of columns around it: the
+// missing tiles of the block come out of one generateHeightField call, whose fixed cost is
+// then paid once per block instead of once per column. Grid positions are the integer
+// column times the frequency, so a batched tile is the tile generated alone.
+class HeightFieldCache
+{
+public:
+    using TileHandle = std::shared_ptr<const HeightTile>;
+
+    // Columns per side of the blocks a miss generates together
+    static constexpr int TILE_BATCH = 4;
+
+    explicit HeightFieldCache(uint32_t seed, size_t capacity = 1024);
+
+    // Any thread: the tile for a chunk column, generating it on a miss
+    TileHandle acquire(const glm::ivec2 &column);
+
+    // Any thread: the tile only if it is already generated (no noise work, no LRU update)
+    TileHandle peek(const glm::ivec2 &column);
+
+    // Any thread: height or biome of a world column, from a cached tile or sampled directly
+    int getHeight(int world_x, int world_z);
+    Biome getBiome(int world_x, int world_z);
+
+    void setCapacity(size_t tiles);
+    void clear();
+
+    // Any thread; null detaches. Tiles already being filled finish with the previous store.
+    void setDiskStore(std::shared_ptr<HeightTileStore> store);
+
+    // Any thread. While on, columns whose tiles become ready are recorded for takeArrivals;
+    // off by default so nothing piles up without a reader.
+    void setArrivalTracking(bool enabled);
+    // Columns whose tiles became ready since the previous call, oldest first. False if more
+    // than MAX_PENDING_ARRIVALS arrived in between and the oldest were dropped.
+    bool takeArrivals(std::vector<glm::ivec2> &columns);
+
+    uint32_t getSeed() const { return seed; }
+    size_t size();
+
+    // Hits/misses since the previous call; loaded counts the misses served by the disk store
+    void takeStats(uint64_t &hits, uint64_t &misses, uint64_t &loaded);
+
+private:
+    struct IVec2Hash
+    {
+        std::size_t operator()(const glm::ivec2 &v) const
+        {
+            uint64_t h = static_cast<uint64_t>(static_cast<uint32_t>(v.x)) * 0x9E3779B185EBCA87ull;
+            h ^= static_cast<uint64_t>(static_cast<uint32_t>(v.y)) * 0xC2B2AE3D27D4EB4Full;
+            h ^= h >> 29;
+            return static_cast<std::size_t>(h);
+        }
+    };
+
+    struct Entry
+    {
+        std::shared_ptr<HeightTile> tile;
+        std::list<glm::ivec2>::iterator lru_position;
+    };
+
+    const uint32_t seed;
+    std::mutex mutex;
+    size_t capacity;
+    std::list<glm::ivec2> lru; // Most recently used first
+    std::unordered_map<glm::ivec2, Entry, IVec2Hash> tiles;
+    std::shared_ptr<HeightTileStore> disk_store; // Guarded by mutex
+
+    static constexpr size_t MAX_PENDING_ARRIVALS = 4096;
+    std::atomic<bool> track_arrivals{false};
+    std::mutex arrival_mutex; // Separate from mutex: recorded by generating threads
+    std::deque<glm::ivec2> arrivals;
+    bool arrivals_dropped = false;
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> loaded{0};
+
+    void evictOverflow(); // Caller holds mutex
+    void generateTile(const glm::ivec2 &column, HeightTile &tile) const;
+    // Heights and biomes of the block at block_origin (a column), x-major over its
+    // TILE_BATCH * CHUNK_SIZE world columns per side
+    void generateBlock(const glm::ivec2 &block_origin, std::vector<int> &heights, std::vector<uint8_t> &biomes) const;
+    void recordArrival(const glm::ivec2 &column);
+};
+
+#endif // HEIGHT_FIELD_CACHE_H
@@ -0,0 +1,159 @@
+#include "height_tile_store.h"
+#include "height_field_cache.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+HeightTileStore::HeightTileStore(std::string directory, uint64_t generator_key)
+    : directory(std::move(directory)), generator_key(generator_key)
+{
+}
+
+glm::ivec2 HeightTileStore::getRegionCoord(const glm::ivec2 &column)
+{
+    auto region = [](int c)
+    { return c >= 0 ? c / REGION_SIZE : (c + 1) / REGION_SIZE - 1; };
+    return glm::ivec2(region(column.x), region(column.y));
+}
+
+size_t HeightTileStore::getSlot(const glm::ivec2 &column)
+{
+    glm::ivec2 local = column - getRegionCoord(column) * REGION_SIZE;
+    return static_cast<size_t>(local.x) * REGION_SIZE + static_cast<size_t>(local.y);
+}
+
+std::string HeightTileStore::getPath(const glm::ivec2 &region) const
+{
+    return directory + "h." + std::to_string(region.x) + "." + std::to_string(region.y) + ".vxt";
+}
+
+bool HeightTileStore::load(const glm::ivec2 &column, HeightTile &tile)
+{
+    std::array<char, TILE_BYTES> stored;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        File &file = openFile(getRegionCoord(column));
+        size_t slot = getSlot(column);
+        if (!file.stream.is_open() || (file.header.present[slot / 8] & (1u << (slot % 8))) == 0)
+        {
+            return false;
+        }
+
+        file.stream.clear();
+        file.stream.seekg(static_cast<std::streamoff>(sizeof(Header) + slot * TILE_BYTES));
+        if (!file.stream.read(stored.data(), TILE_BYTES))
+        {
+            return false;
+        }
+    }
+
+    std::array<int16_t, CHUNK_SIZE * CHUNK_SIZE> heights;
+    std::memcpy(heights.data(), stored.data(), HEIGHT_BYTES);
+    std::copy(heights.begin(), heights.end(), tile.heights.begin());
+    std::memcpy(tile.biomes.data(), stored.data() + HEIGHT_BYTES, tile.biomes.size());
+    return std::all_of(tile.biomes.begin(), tile.biomes.end(), [](uint8_t biome)
+                       { return biome < BIOME_COUNT; });
+}
+
+void HeightTileStore::store(const glm::ivec2 &column, const HeightTile &tile)
+{
+    std::array<int16_t, CHUNK_SIZE * CHUNK_SIZE> heights;
+    for (size_t i = 0; i < heights.size(); i++)
+    {
+        if (tile.heights[i] < std::numeric_limits<int16_t>::min() || tile.heights[i] > std::numeric_limits<int16_t>::max())
+        {
+            return; // Not representable; the column keeps being generated
+        }
+        heights[i] = static_cast<int16_t>(tile.heights[i]);
+    }
+    std::array<char, TILE_BYTES> stored;
+    std::memcpy(stored.data(), heights.data(), HEIGHT_BYTES);
+    std::memcpy(stored.data() + HEIGHT_BYTES, tile.biomes.data(), tile.biomes.size());
+
+    std::unique_lock<std::mutex> lock(mutex);
+    glm::ivec2 region = getRegionCoord(column);
+    File &file = openFile(region);
+    if (!file.stream.is_open() && !createFile(region, file))
+    {
+        return;
+    }
+
+    // Heights and biomes first, then the bitmap byte marking the slot
+    size_t slot = getSlot(column);
+    uint8_t &present = file.header.present[slot / 8];
+    uint8_t updated = static_cast<uint8_t>(present | (1u << (slot % 8)));
+    file.stream.clear();
+    file.stream.seekp(static_cast<std::streamoff>(sizeof(Header) + slot * TILE_BYTES));
+    file.stream.write(stored.data(), TILE_BYTES);
+    file.stream.seekp(static_cast<std::streamoff>(offsetof(Header, present) + slot / 8));
+    file.stream.write(reinterpret_cast<const char *>(&updated), 1);
+    file.stream.flush();
+    if (!file.stream)
+    {
+        std::cerr << "Height tile store: failed to write " << getPath(region) << std::endl;
+        return;
+    }
+    present = updated;
+}
+
+HeightTileStore::File &HeightTileStore::openFile(const glm::ivec2 &region)
+{
+    auto it = files.find(region);
+    if (it != files.end())
+    {
+        return *it->second;
+    }
+    if (files.size() >= MAX_OPEN_FILES)
+    {
+        files.clear();
+    }
+
+    auto file = std::make_unique<File>();
+    file->header = Header{STORE_MAGIC, 0, generator_key, {}};
+
+    std::string path = getPath(region);
+    file->stream.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (file->stream.is_open())
+    {
+        Header header;
+        if (!file->stream.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != STORE_MAGIC ||
+            header.key != generator_key)
+        {
+            // Another generator's heights; rebuilt from scratch by the next store
+            file->stream.close();
+        }
+        else
+        {
+            file->header = header;
+        }
+    }
+
+    return *files.emplace(region, std::move(file)).first->second;
+}
+
+bool HeightTileStore::createFile(const glm::ivec2 &region, File &file)
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    // Every slot is allocated up front, so stores only ever overwrite
+    std::string path = getPath(region);
+    {
+        std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+        std::vector<char> contents(sizeof(Header) + SLOTS * TILE_BYTES, 0);
+        file.header = Header{STORE_MAGIC, 0, generator_key, {}};
+        std::copy(reinterpret_cast<const char *>(&file.header),
+                  reinterpret_cast<const char *>(&file.header) + sizeof(Header), contents.begin());
+        if (!stream || !stream.write(contents.data(), static_cast<std::streamsize>(contents.size())))
+        {
+            std::cerr << "Height tile store: failed to create " << path << std::endl;
+            return false;
+        }
+    }
+
+    file.stream.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    return file.stream.is_open();
+}
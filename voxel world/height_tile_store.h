@@ -0,0 +1,82 @@
+#ifndef HEIGHT_TILE_STORE_H
+#define HEIGHT_TILE_STORE_H
+
+#include "voxel_types.h"
+#include <glm/glm/glm.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct HeightTile;
+
+// Height tiles persisted across sessions, so a world that was visited before is generated
+// without running the noise at all.
+//
+// Tiles are grouped into files of REGION_SIZE x REGION_SIZE chunk columns with a fixed slot
+// per column (heights as int16), a header holding the generator key and a bitmap of the
+// slots written; biomes follow the heights as one byte per column. A file whose key differs
+// (other seed, changed generator) is discarded and rebuilt. Thread-safe; tiles are written from the thread that generated them.
+class HeightTileStore
+{
+public:
+    static constexpr int REGION_SIZE = 32; // Chunk columns per file side
+
+    HeightTileStore(std::string directory, uint64_t generator_key);
+
+    HeightTileStore(const HeightTileStore &) = delete;
+    HeightTileStore &operator=(const HeightTileStore &) = delete;
+
+    // False if the column was never stored (tile untouched)
+    bool load(const glm::ivec2 &column, HeightTile &tile);
+    void store(const glm::ivec2 &column, const HeightTile &tile);
+
+private:
+    static constexpr uint32_t STORE_MAGIC = 0x32545856; // "VXT2" (VXT1 had no biomes)
+    static constexpr int MAX_OPEN_FILES = 16;
+    static constexpr int SLOTS = REGION_SIZE * REGION_SIZE;
+    static constexpr size_t HEIGHT_BYTES = CHUNK_SIZE * CHUNK_SIZE * sizeof(int16_t);
+    static constexpr size_t TILE_BYTES = HEIGHT_BYTES + CHUNK_SIZE * CHUNK_SIZE;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t reserved;
+        uint64_t key;
+        std::array<uint8_t, SLOTS / 8> present;
+    };
+
+    struct File
+    {
+        std::fstream stream; // Closed until the first store when the file does not exist
+        Header header;
+    };
+
+    struct RegionHash
+    {
+        std::size_t operator()(const glm::ivec2 &v) const
+        {
+            uint64_t h = static_cast<uint64_t>(static_cast<uint32_t>(v.x)) * 0x9E3779B185EBCA87ull;
+            h ^= static_cast<uint64_t>(static_cast<uint32_t>(v.y)) * 0xC2B2AE3D27D4EB4Full;
+            h ^= h >> 29;
+            return static_cast<std::size_t>(h);
+        }
+    };
+
+    const std::string directory;
+    const uint64_t generator_key;
+    std::mutex mutex; // Guards files and all I/O
+    std::unordered_map<glm::ivec2, std::unique_ptr<File>, RegionHash> files;
+
+    static glm::ivec2 getRegionCoord(const glm::ivec2 &column);
+    static size_t getSlot(const glm::ivec2 &column);
+    std::string getPath(const glm::ivec2 &region) const;
+    File &openFile(const glm::ivec2 &region); // mutex held
+    bool createFile(const glm::ivec2 &region, File &file);
+};
+
+#endif // HEIGHT_TILE_STORE_H
@@ -0,0 +1,245 @@
+#include "hiz_culler.h"
+#include "voxel_types.h"
+#include "../shader.h"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+constexpr int DOWNSAMPLE_GROUP = 8; // local_size of hiz_downsample.comp
+constexpr int CULL_GROUP = 64;      // local_size of hiz_cull.comp
+constexpr GLint HIZ_TEXTURE_UNIT = 1; // Unit 0 holds the block atlas
+
+std::unique_ptr<Shader> loadComputeShader(const char *name)
+{
+    // Same search order as the voxel shaders
+    for (const char *directory : {"shaders/", "voxel world/"})
+    {
+        auto shader = std::make_unique<Shader>((std::string(directory) + name).c_str());
+        if (shader->ID != 0)
+        {
+            return shader;
+        }
+    }
+    return nullptr;
+}
+}
+
+bool HiZCuller::isSupported()
+{
+#ifdef GL_VERSION_4_3
+    return GLAD_GL_VERSION_4_3 != 0;
+#else
+    return false;
+#endif
+}
+
+HiZCuller::HiZCuller()
+    : depth_texture(0), hiz_texture(0), width(0), height(0), levels(0), captured_view_projection(1.0f),
+      has_depth(false), reverse_depth(false), counter_buffers{0, 0}, counter_index(0), occluded_last_frame(0)
+{
+#ifdef GL_VERSION_4_3
+    const GLuint zero = 0;
+    glGenBuffers(2, counter_buffers);
+    for (GLuint buffer : counter_buffers)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), &zero, GL_DYNAMIC_READ);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+#endif
+}
+
+HiZCuller::~HiZCuller()
+{
+    releaseTextures();
+    glDeleteBuffers(2, counter_buffers);
+}
+
+bool HiZCuller::loadShaders()
+{
+    downsample_shader = loadComputeShader("hiz_downsample.comp");
+    cull_shader = loadComputeShader("hiz_cull.comp");
+    if (!downsample_shader || !cull_shader)
+    {
+        std::cerr << "Hi-Z culling: failed to load compute shaders" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void HiZCuller::releaseTextures()
+{
+    if (depth_texture != 0)
+    {
+        glDeleteTextures(1, &depth_texture);
+        depth_texture = 0;
+    }
+    if (hiz_texture != 0)
+    {
+        glDeleteTextures(1, &hiz_texture);
+        hiz_texture = 0;
+    }
+    width = height = levels = 0;
+    has_depth = false;
+}
+
+void HiZCuller::resize(int new_width, int new_height)
+{
+    releaseTextures();
+    width = new_width;
+    height = new_height;
+    levels = 1;
+    for (int size = std::max(width, height); size > 1; size >>= 1)
+    {
+        levels++;
+    }
+
+#ifdef GL_VERSION_4_3
+    glGenTextures(1, &depth_texture);
+    glBindTexture(GL_TEXTURE_2D, depth_texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+    glGenTextures(1, &hiz_texture);
+    glBindTexture(GL_TEXTURE_2D, hiz_texture);
+    glTexStorage2D(GL_TEXTURE_2D, levels, GL_R32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+#endif
+}
+
+void HiZCuller::beginFrame()
+{
+#ifdef GL_VERSION_4_3
+    // This buffer was last written two frames ago, so reading it back does not wait on the GPU
+    counter_index ^= 1;
+    GLuint count = 0;
+    const GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counter_buffers[counter_index]);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &count);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    occluded_last_frame = count;
+#endif
+}
+
+void HiZCuller::cullDraws(GLuint indirect_buffer, GLuint origin_buffer, GLuint layer_range_buffer, size_t draw_count)
+{
+    if (!has_depth || !cull_shader || draw_count == 0)
+    {
+        return;
+    }
+
+#ifdef GL_VERSION_4_3
+    GLint previous_program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+
+    glUseProgram(cull_shader->ID);
+    glActiveTexture(GL_TEXTURE0 + HIZ_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, hiz_texture);
+    cull_shader->setInt("hiz", HIZ_TEXTURE_UNIT);
+    cull_shader->setInt("hiz_levels", levels);
+    cull_shader->setMat4("view_projection", captured_view_projection);
+    cull_shader->setBool("reverse_depth", reverse_depth);
+    // Mesh vertices span voxel center -0.5..+0.5 (see VoxelRenderer::cullChunks); the
+    // vertical extent comes per draw from the layer ranges
+    cull_shader->setVec3("box_min_offset", glm::vec3(-0.5f));
+    cull_shader->setVec3("box_max_offset", glm::vec3(CHUNK_SIZE - 0.5f, CHUNK_HEIGHT - 0.5f, CHUNK_SIZE - 0.5f));
+    glUniform1ui(glGetUniformLocation(cull_shader->ID, "draw_count"), static_cast<GLuint>(draw_count));
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, indirect_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, origin_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, counter_buffers[counter_index]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, layer_range_buffer);
+
+    GLuint groups = static_cast<GLuint>((draw_count + CULL_GROUP - 1) / CULL_GROUP);
+    glDispatchCompute(groups, 1, 1);
+
+    // The draw that follows reads the commands as indirect parameters
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    for (GLuint binding = 0; binding < 4; binding++)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glUseProgram(static_cast<GLuint>(previous_program));
+#endif
+}
+
+void HiZCuller::setReverseDepth(bool reverse)
+{
+    if (reverse != reverse_depth)
+    {
+        reverse_depth = reverse;
+        has_depth = false;
+    }
+}
+
+void HiZCuller::captureDepth(const glm::mat4 &view_projection)
+{
+    if (!downsample_shader)
+    {
+        return;
+    }
+
+#ifdef GL_VERSION_4_3
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if (viewport[2] <= 0 || viewport[3] <= 0)
+    {
+        return;
+    }
+    if (viewport[2] != width || viewport[3] != height)
+    {
+        resize(viewport[2], viewport[3]);
+    }
+
+    GLint previous_program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+    glActiveTexture(GL_TEXTURE0 + HIZ_TEXTURE_UNIT);
+
+    // Depth of the currently bound (default) framebuffer
+    glBindTexture(GL_TEXTURE_2D, depth_texture);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, viewport[0], viewport[1], width, height);
+
+    glUseProgram(downsample_shader->ID);
+    downsample_shader->setInt("source", HIZ_TEXTURE_UNIT);
+    downsample_shader->setBool("reverse_depth", reverse_depth);
+
+    int level_width = width;
+    int level_height = height;
+    for (int level = 0; level < levels; level++)
+    {
+        bool copy = level == 0;
+        downsample_shader->setBool("copy_depth", copy);
+        if (!copy)
+        {
+            // Reduce level - 1 of the pyramid into this level
+            glBindTexture(GL_TEXTURE_2D, hiz_texture);
+            downsample_shader->setInt("source_level", level - 1);
+            glUniform2i(glGetUniformLocation(downsample_shader->ID, "source_size"), level_width, level_height);
+            level_width = std::max(1, level_width / 2);
+            level_height = std::max(1, level_height / 2);
+        }
+
+        glBindImageTexture(0, hiz_texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((level_width + DOWNSAMPLE_GROUP - 1) / DOWNSAMPLE_GROUP,
+                          (level_height + DOWNSAMPLE_GROUP - 1) / DOWNSAMPLE_GROUP, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glUseProgram(static_cast<GLuint>(previous_program));
+
+    captured_view_projection = view_projection;
+    has_depth = true;
+#endif
+}
@@ -0,0 +1,69 @@
+#ifndef HIZ_CULLER_H
+#define HIZ_CULLER_H
+
+#include <glm/glm/glm.hpp>
+#include <glad/glad/glad.h>
+#include <memory>
+#include <cstddef>
+
+class Shader;
+
+// GPU occlusion culling for the opaque multi-draw batch (GL 4.3 compute).
+//
+// After the opaque pass the depth buffer is copied and reduced into a max-depth (Hi-Z)
+// pyramid. The next frame's batch is tested against it on the GPU: a compute pass projects
+// each chunk's box (trimmed to the layers its mesh occupies) with the captured view-projection and zeroes the instance count of the
+// indirect commands it finds fully hidden, before glMultiDrawElementsIndirect reads them.
+// Testing against the previous frame can hide a chunk for one frame right after it becomes
+// disoccluded. With reverse-Z (see SceneTarget) "farthest" is the smallest depth instead.
+class HiZCuller
+{
+public:
+    static bool isSupported();
+
+    HiZCuller();
+    ~HiZCuller();
+
+    HiZCuller(const HiZCuller &) = delete;
+    HiZCuller &operator=(const HiZCuller &) = delete;
+
+    bool loadShaders();
+
+    // Start of a frame: collect the occluded count of an earlier frame without stalling
+    void beginFrame();
+
+    // Opaque batch commands/origins/layer ranges as uploaded by ChunkArena::flushBatch
+    void cullDraws(GLuint indirect_buffer, GLuint origin_buffer, GLuint layer_range_buffer, size_t draw_count);
+
+    // After the opaque pass: copy the bound depth buffer and rebuild the pyramid
+    void captureDepth(const glm::mat4 &view_projection);
+    // Depth convention of the captured buffers; a change drops the current pyramid
+    void setReverseDepth(bool reverse);
+
+    size_t getOccludedCount() const { return occluded_last_frame; }
+    bool hasDepth() const { return has_depth; }
+
+private:
+    std::unique_ptr<Shader> downsample_shader;
+    std::unique_ptr<Shader> cull_shader;
+
+    GLuint depth_texture; // Copy of the depth buffer
+    GLuint hiz_texture;   // R32F pyramid
+    int width;
+    int height;
+    int levels;
+
+    glm::mat4 captured_view_projection;
+    bool has_depth;
+    bool reverse_depth;
+
+    // Double-buffered so the count is read a frame after the GPU wrote it
+    GLuint counter_buffers[2];
+    int counter_index;
+    size_t occluded_last_frame;
+
+    void resize(int new_width, int new_height);
+    void releaseTextures();
+};
+
+#endif // HIZ_CULLER_H
@@ -0,0 +1,410 @@
+#include "job_system.h"
+#include "profiler.h"
+#include "log.h"
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+// Worker index of the calling thread within its pool (-1 outside any pool)
+thread_local const JobSystem *tls_job_system = nullptr;
+thread_local int tls_worker_index = -1;
+
+#if defined(__linux__)
+constexpr int WORKER_NICE_OFFSET = 5; // Niceness added to workers (per thread on Linux)
+#endif
+
+void lowerThreadPriority()
+{
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__)
+    pid_t thread_id = static_cast<pid_t>(syscall(SYS_gettid));
+    errno = 0;
+    int nice_value = getpriority(PRIO_PROCESS, thread_id);
+    if (errno == 0)
+    {
+        setpriority(PRIO_PROCESS, thread_id, std::min(nice_value + WORKER_NICE_OFFSET, 19));
+    }
+#endif
+}
+
+// Restrict the calling thread to cores [first, last); false where the platform has no affinity API
+bool setThreadCores(unsigned int first, unsigned int last)
+{
+#ifdef _WIN32
+    DWORD_PTR mask = 0;
+    for (unsigned int core = first; core < last && core < sizeof(DWORD_PTR) * 8; core++)
+    {
+        mask |= DWORD_PTR(1) << core;
+    }
+    return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    for (unsigned int core = first; core < last && core < CPU_SETSIZE; core++)
+    {
+        CPU_SET(core, &cores);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores) == 0;
+#else
+    (void)first;
+    (void)last;
+    return false;
+#endif
+}
+}
+
+unsigned int JobSystem::getDefaultWorkerCount(unsigned int reserved_threads)
+{
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    return cores > reserved_threads ? cores - reserved_threads : 1u;
+}
+
+JobSystem::JobSystem(unsigned int thread_count)
+    : JobSystem(JobSystemConfig{thread_count})
+{
+}
+
+JobSystem::JobSystem(const JobSystemConfig &config)
+    : config(config), stats_sampled_at(std::chrono::steady_clock::now())
+{
+    unsigned int thread_count = config.thread_count;
+    if (thread_count == 0)
+    {
+        thread_count = getDefaultWorkerCount(config.reserved_threads);
+    }
+
+    // Isolation only makes sense with a core left over for the workers
+    unsigned int cores = std::thread::hardware_concurrency();
+    this->config.isolate_caller = config.isolate_caller && cores > 1 && setThreadCores(0, 1);
+
+    std::cout << "Starting " << thread_count << " job system worker threads";
+    if (config.thread_count == 0 && config.reserved_threads > 0)
+    {
+        std::cout << " (" << cores << " cores, " << config.reserved_threads << " reserved)";
+    }
+    std::cout << std::endl;
+
+    workers.reserve(thread_count);
+    for (unsigned int i = 0; i < thread_count; ++i)
+    {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    // Threads start only once every deque exists, since they steal from each other
+    for (unsigned int i = 0; i < thread_count; ++i)
+    {
+        workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    shutdown();
+}
+
+void JobSystem::shutdown()
+{
+    {
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        if (stopping)
+        {
+            return;
+        }
+        stopping = true;
+    }
+    wake_condition.notify_all();
+
+    for (auto &worker : workers)
+    {
+        if (worker->thread.joinable())
+        {
+            worker->thread.join();
+        }
+    }
+}
+
+bool JobSystem::isStopping()
+{
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    return stopping;
+}
+
+JobSystem::JobHandle JobSystem::submit(JobFunction function, JobPriority priority)
+{
+    auto job = std::make_shared<Job>();
+    job->function = std::move(function);
+    job->priority = priority;
+    schedule(job);
+    return job;
+}
+
+JobSystem::JobHandle JobSystem::submit(JobFunction function, JobPriority priority,
+                                       const std::vector<JobHandle> &dependencies)
+{
+    auto job = std::make_shared<Job>();
+    job->function = std::move(function);
+    job->priority = priority;
+
+    // One extra count held by this call, so dependencies finishing during registration
+    // cannot queue the job before every one of them has been seen
+    job->unfinished_dependencies.store(static_cast<int>(dependencies.size()) + 1);
+    for (const JobHandle &dependency : dependencies)
+    {
+        bool already_finished = true;
+        if (dependency)
+        {
+            std::unique_lock<std::mutex> lock(dependency->mutex);
+            if (!dependency->finished)
+            {
+                dependency->continuations.push_back(job);
+                already_finished = false;
+            }
+        }
+        if (already_finished)
+        {
+            job->unfinished_dependencies.fetch_sub(1);
+        }
+    }
+
+    if (job->unfinished_dependencies.fetch_sub(1) == 1)
+    {
+        schedule(job);
+    }
+    return job;
+}
+
+void JobSystem::resubmit(const JobHandle &job, JobFunction function, JobPriority priority)
+{
+    {
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->finished = false;
+    }
+    job->function = std::move(function);
+    job->priority = priority;
+    schedule(job);
+}
+
+bool JobSystem::isDone(const JobHandle &job)
+{
+    if (!job)
+    {
+        return true;
+    }
+    std::unique_lock<std::mutex> lock(job->mutex);
+    return job->finished;
+}
+
+void JobSystem::schedule(JobHandle job)
+{
+    // Continuations stay on the worker that finished their last dependency
+    unsigned int target;
+    if (tls_job_system == this && tls_worker_index >= 0)
+    {
+        target = static_cast<unsigned int>(tls_worker_index);
+    }
+    else
+    {
+        target = next_worker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    }
+
+    Worker &worker = *workers[target];
+    int priority = static_cast<int>(job->priority);
+    {
+        std::unique_lock<std::mutex> lock = lockWorker(worker);
+        worker.queues[priority].push_back(std::move(job));
+        worker.queued.fetch_add(1);
+        pending_jobs.fetch_add(1);
+    }
+
+    // A worker going to sleep bumps sleeping_workers before re-checking pending_jobs, so
+    // either it sees this job or we see it and take the lock to wake it
+    if (sleeping_workers.load() > 0)
+    {
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        wake_condition.notify_one();
+    }
+}
+
+std::unique_lock<std::mutex> JobSystem::lockWorker(Worker &worker)
+{
+    std::unique_lock<std::mutex> lock(worker.mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        lock_contentions.fetch_add(1, std::memory_order_relaxed);
+        lock.lock();
+    }
+    return lock;
+}
+
+JobSystem::JobHandle JobSystem::popFrom(Worker &worker, int priority, bool from_back)
+{
+    if (worker.queued.load() == 0)
+    {
+        return nullptr;
+    }
+
+    std::unique_lock<std::mutex> lock = lockWorker(worker);
+    std::deque<JobHandle> &queue = worker.queues[priority];
+    if (queue.empty())
+    {
+        return nullptr;
+    }
+
+    JobHandle job;
+    if (from_back)
+    {
+        job = std::move(queue.back());
+        queue.pop_back();
+    }
+    else
+    {
+        job = std::move(queue.front());
+        queue.pop_front();
+    }
+    worker.queued.fetch_sub(1);
+    pending_jobs.fetch_sub(1);
+    return job;
+}
+
+JobSystem::JobHandle JobSystem::takeJob(unsigned int index)
+{
+    const unsigned int count = static_cast<unsigned int>(workers.size());
+    for (int priority = 0; priority < PRIORITY_COUNT; priority++)
+    {
+        if (JobHandle job = popFrom(*workers[index], priority, false))
+        {
+            return job;
+        }
+
+        for (unsigned int offset = 1; offset < count; offset++)
+        {
+            if (JobHandle job = popFrom(*workers[(index + offset) % count], priority, true))
+            {
+                jobs_stolen.fetch_add(1, std::memory_order_relaxed);
+                return job;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::execute(const JobHandle &job)
+{
+    try
+    {
+        PROFILE_ZONE("Job");
+        job->function();
+    }
+    catch (const std::exception &e)
+    {
+        Log::writeLimited(LogLevel::Error, "Job failures", std::string("Job failed: ") + e.what());
+    }
+    catch (...)
+    {
+        Log::writeLimited(LogLevel::Error, "Job failures", "Job failed with unknown error");
+    }
+    job->function = nullptr; // Release captured state now rather than with the last handle
+    jobs_executed.fetch_add(1, std::memory_order_relaxed);
+
+    std::vector<JobHandle> ready;
+    {
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->finished = true;
+        ready.swap(job->continuations);
+    }
+    for (JobHandle &continuation : ready)
+    {
+        if (continuation->unfinished_dependencies.fetch_sub(1) == 1)
+        {
+            schedule(std::move(continuation));
+        }
+    }
+}
+
+void JobSystem::workerLoop(unsigned int index)
+{
+    tls_job_system = this;
+    tls_worker_index = static_cast<int>(index);
+    Profiler::setThreadName("Worker " + std::to_string(index));
+    Worker &self = *workers[index];
+
+    if (config.lower_priority)
+    {
+        lowerThreadPriority();
+    }
+    if (config.isolate_caller)
+    {
+        setThreadCores(1, std::thread::hardware_concurrency());
+    }
+
+    while (true)
+    {
+        if (JobHandle job = takeJob(index))
+        {
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        sleeping_workers.fetch_add(1);
+        auto idle_start = std::chrono::steady_clock::now();
+        wake_condition.wait(lock, [this]
+                            { return stopping || pending_jobs.load() > 0; });
+        sleeping_workers.fetch_sub(1);
+        self.idle_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now() - idle_start)
+                                   .count(),
+                               std::memory_order_relaxed);
+
+        // Queued work is drained before exiting so nothing waiting on it is left hanging
+        if (stopping && pending_jobs.load() == 0)
+        {
+            return;
+        }
+    }
+}
+
+JobSystemStats JobSystem::getStats()
+{
+    JobSystemStats stats;
+    stats.workers = getWorkerCount();
+    stats.queued = pending_jobs.load();
+    stats.jobs_executed = jobs_executed.exchange(0);
+    stats.jobs_stolen = jobs_stolen.exchange(0);
+    stats.lock_contentions = lock_contentions.exchange(0);
+
+    uint64_t idle_ns = 0;
+    for (auto &worker : workers)
+    {
+        idle_ns += worker->idle_ns.exchange(0);
+    }
+    stats.idle_ms = static_cast<float>(idle_ns / 1.0e6);
+
+    auto now = std::chrono::steady_clock::now();
+    float period_ms = std::chrono::duration<float, std::milli>(now - stats_sampled_at).count();
+    stats_sampled_at = now;
+    if (period_ms > 0.0f && stats.workers > 0)
+    {
+        stats.idle_fraction = std::min(1.0f, stats.idle_ms / (period_ms * stats.workers));
+    }
+    return stats;
+}
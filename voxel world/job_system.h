@@ -0,0 +1,135 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Scheduling class of a job; workers always look for higher priority work first
+enum class JobPriority
+{
+    High = 0,   // Latency sensitive (e.g. remeshing an edited chunk)
+    Normal = 1, // Meshing
+    Low = 2,    // Generation and other background work
+    Count
+};
+
+// Counters sampled by JobSystem::getStats (reset on every call)
+struct JobSystemStats
+{
+    unsigned int workers = 0;
+    size_t queued = 0;             // Jobs waiting in worker deques right now
+    uint64_t jobs_executed = 0;
+    uint64_t jobs_stolen = 0;      // Taken from another worker's deque
+    uint64_t lock_contentions = 0; // Deque locks that were already held when requested
+    float idle_ms = 0.0f;          // Time workers spent asleep, summed over workers
+    float idle_fraction = 0.0f;    // idle_ms / (workers * sampled period)
+};
+
+// How a pool sizes and schedules its threads
+struct JobSystemConfig
+{
+    unsigned int thread_count = 0;     // 0: one worker per hardware core, less reserved_threads
+    unsigned int reserved_threads = 0; // Cores left to the creating thread (render, driver)
+    bool lower_priority = false;       // Run workers below the OS priority of the creating thread
+    bool isolate_caller = false;       // Pin the creating thread to the first core and workers off it
+};
+
+// Fixed pool of worker threads shared by generation and meshing.
+//
+// Every worker owns one deque per priority. Jobs submitted from outside the pool are
+// spread round-robin; jobs submitted from a job go to the submitting worker. Owners take
+// from the front (submission order), idle workers steal from the back of other deques.
+// Jobs may depend on other jobs and are only queued once all of them have finished.
+class JobSystem
+{
+public:
+    using JobFunction = std::function<void()>;
+
+    struct Job;
+    using JobHandle = std::shared_ptr<Job>;
+
+    // thread_count 0 means one worker per hardware core
+    explicit JobSystem(unsigned int thread_count = 0);
+    explicit JobSystem(const JobSystemConfig &config);
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // Queue a job; with dependencies it runs after every one of them has finished
+    JobHandle submit(JobFunction function, JobPriority priority = JobPriority::Normal);
+    JobHandle submit(JobFunction function, JobPriority priority, const std::vector<JobHandle> &dependencies);
+    // Queue a finished job again without allocating (for jobs that recur every frame); it
+    // must not be waited on by other jobs
+    void resubmit(const JobHandle &job, JobFunction function, JobPriority priority = JobPriority::Normal);
+    static bool isDone(const JobHandle &job);
+
+    // Finish every queued job, then join the workers (called by the destructor)
+    void shutdown();
+
+    // True once shutdown() has begun; jobs submitted after that never run
+    bool isStopping();
+
+    unsigned int getWorkerCount() const { return static_cast<unsigned int>(workers.size()); }
+    // Workers a config with thread_count 0 starts: hardware cores less the reserved ones, at least 1
+    static unsigned int getDefaultWorkerCount(unsigned int reserved_threads);
+    JobSystemStats getStats();
+
+private:
+    static constexpr int PRIORITY_COUNT = static_cast<int>(JobPriority::Count);
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::array<std::deque<JobHandle>, PRIORITY_COUNT> queues;
+        std::atomic<size_t> queued{0}; // Lets thieves skip empty workers without locking
+        std::atomic<uint64_t> idle_ns{0};
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    JobSystemConfig config;
+    std::atomic<unsigned int> next_worker{0}; // Round-robin target for external submissions
+
+    // Sleeping workers wait here; submitters only notify when someone is asleep
+    std::mutex wake_mutex;
+    std::condition_variable wake_condition;
+    std::atomic<size_t> pending_jobs{0};
+    std::atomic<unsigned int> sleeping_workers{0};
+    bool stopping = false;
+
+    std::atomic<uint64_t> jobs_executed{0};
+    std::atomic<uint64_t> jobs_stolen{0};
+    std::atomic<uint64_t> lock_contentions{0};
+    std::chrono::steady_clock::time_point stats_sampled_at;
+
+    void workerLoop(unsigned int index);
+    void schedule(JobHandle job);
+    void execute(const JobHandle &job);
+    JobHandle takeJob(unsigned int index);
+    JobHandle popFrom(Worker &worker, int priority, bool from_back);
+    std::unique_lock<std::mutex> lockWorker(Worker &worker);
+};
+
+struct JobSystem::Job
+{
+    JobFunction function;
+    JobPriority priority = JobPriority::Normal;
+    std::atomic<int> unfinished_dependencies{0};
+
+    // Guards finished/continuations so a dependency cannot complete mid-registration
+    std::mutex mutex;
+    bool finished = false;
+    std::vector<JobHandle> continuations;
+};
+
+#endif // JOB_SYSTEM_H
@@ -0,0 +1,74 @@
+#include "latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+
+void LatencyHistogram::record(float milliseconds)
+{
+    uint64_t microseconds = static_cast<uint64_t>(std::max(0.0f, milliseconds) * 1000.0f);
+    counts[getBucket(microseconds)]++;
+    count++;
+    sum_ms += milliseconds;
+    max_ms = std::max(max_ms, milliseconds);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    for (int bucket = 0; bucket < BUCKETS; bucket++)
+    {
+        counts[bucket] += other.counts[bucket];
+    }
+    count += other.count;
+    sum_ms += other.sum_ms;
+    max_ms = std::max(max_ms, other.max_ms);
+}
+
+float LatencyHistogram::getPercentile(float fraction) const
+{
+    if (count == 0)
+    {
+        return 0.0f;
+    }
+
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(count))));
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < BUCKETS; bucket++)
+    {
+        seen += counts[bucket];
+        if (seen >= rank)
+        {
+            // The bucket edge can overshoot the largest value actually recorded
+            return std::min(max_ms, static_cast<float>(getBucketUpper(bucket)) / 1000.0f);
+        }
+    }
+    return max_ms;
+}
+
+int LatencyHistogram::getBucket(uint64_t microseconds)
+{
+    microseconds = std::min<uint64_t>(microseconds, (uint64_t(1) << (RANGES + SUB_BUCKET_BITS - 1)) - 1);
+    if (microseconds < SUB_BUCKETS)
+    {
+        return static_cast<int>(microseconds); // Range 0 is linear, one microsecond per bucket
+    }
+
+    int top_bit = 63;
+    while (!(microseconds >> top_bit))
+    {
+        top_bit--;
+    }
+    int range = top_bit - SUB_BUCKET_BITS + 1;
+    int sub_bucket = static_cast<int>((microseconds >> (top_bit - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return range * SUB_BUCKETS + sub_bucket;
+}
+
+uint64_t LatencyHistogram::getBucketUpper(int bucket)
+{
+    int range = bucket / SUB_BUCKETS;
+    uint64_t sub_bucket = static_cast<uint64_t>(bucket % SUB_BUCKETS);
+    if (range == 0)
+    {
+        return sub_bucket;
+    }
+    uint64_t width = uint64_t(1) << (range - 1);
+    return (SUB_BUCKETS + sub_bucket) * width + width - 1;
+}
@@ -0,0 +1,37 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <cstdint>
+
+// Log-linear latency histogram in the style of HdrHistogram: every power-of-two range of
+// microseconds is split into SUB_BUCKETS linear buckets, so any value from 1 us to hours is
+// kept to within 1/SUB_BUCKETS of itself in fixed memory, and recording is a few integer ops.
+class LatencyHistogram
+{
+public:
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int RANGES = 32; // Values are clamped below 2^34 us (about 4.7 hours)
+    static constexpr int BUCKETS = RANGES * SUB_BUCKETS;
+
+    void record(float milliseconds);
+    void merge(const LatencyHistogram &other);
+    void clear() { *this = LatencyHistogram(); }
+
+    uint64_t getCount() const { return count; }
+    float getMax() const { return max_ms; }
+    float getMean() const { return count ? static_cast<float>(sum_ms / count) : 0.0f; }
+    float getPercentile(float fraction) const; // Upper edge of the bucket holding it, in ms
+
+private:
+    std::array<uint32_t, BUCKETS> counts{};
+    uint64_t count = 0;
+    double sum_ms = 0.0;
+    float max_ms = 0.0f;
+
+    static int getBucket(uint64_t microseconds);
+    static uint64_t getBucketUpper(int bucket); // Inclusive, in microseconds
+};
+
+#endif // LATENCY_HISTOGRAM_H
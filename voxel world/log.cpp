@@ -0,0 +1,248 @@
+#include "log.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct LogEntry
+{
+    uint64_t sequence;
+    LogLevel level;
+    const char *key; // nullptr when not rate-limited
+    std::string message;
+};
+
+struct SlowSample
+{
+    const char *stat;
+    float ms;
+};
+
+// Filled by its owning thread; the mutex is only ever contended by the writer swapping it out
+struct ThreadBuffer
+{
+    std::mutex mutex;
+    std::vector<LogEntry> entries;
+    std::vector<SlowSample> samples;
+};
+
+std::atomic<int> min_level{static_cast<int>(LogLevel::Info)};
+std::atomic<uint64_t> next_sequence{0};
+
+class LogWriter
+{
+public:
+    LogWriter() : thread([this]
+                         { run(); })
+    {
+    }
+
+    ~LogWriter()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+
+    ThreadBuffer &getThreadBuffer()
+    {
+        // Buffers are never freed, so a thread that exited still gets its last messages out
+        thread_local ThreadBuffer *buffer = nullptr;
+        if (!buffer)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffer = buffers.back().get();
+        }
+        return *buffer;
+    }
+
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        uint64_t request = ++flush_requested;
+        wake.notify_one();
+        flushed.wait(lock, [&]
+                     { return flush_completed >= request || stopping; });
+    }
+
+private:
+    std::mutex mutex; // Guards buffers and the flush/stop state
+    std::condition_variable wake;
+    std::condition_variable flushed;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    uint64_t flush_requested = 0;
+    uint64_t flush_completed = 0;
+    bool stopping = false;
+
+    // Writer thread state
+    std::vector<LogEntry> entries;
+    std::map<std::string, std::vector<float>> slow_samples;
+    std::map<std::string, int> key_counts; // Messages printed per key this interval
+    std::map<std::string, int> suppressed;
+
+    std::thread thread;
+
+    void run()
+    {
+        auto interval_start = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            wake.wait_for(lock, std::chrono::milliseconds(100), [this]
+                          { return stopping || flush_requested > flush_completed; });
+            bool stop = stopping;
+            uint64_t request = flush_requested;
+            std::vector<ThreadBuffer *> snapshot;
+            for (const auto &buffer : buffers)
+            {
+                snapshot.push_back(buffer.get());
+            }
+            lock.unlock();
+
+            drain(snapshot);
+            auto now = std::chrono::steady_clock::now();
+            if (stop || std::chrono::duration<float>(now - interval_start).count() >= Log::SUMMARY_INTERVAL_SECONDS)
+            {
+                writeSummary(std::chrono::duration<float>(now - interval_start).count());
+                interval_start = now;
+            }
+
+            lock.lock();
+            flush_completed = request;
+            flushed.notify_all();
+            if (stop)
+            {
+                return;
+            }
+        }
+    }
+
+    void drain(const std::vector<ThreadBuffer *> &snapshot)
+    {
+        entries.clear();
+        for (ThreadBuffer *buffer : snapshot)
+        {
+            std::unique_lock<std::mutex> lock(buffer->mutex);
+            std::move(buffer->entries.begin(), buffer->entries.end(), std::back_inserter(entries));
+            buffer->entries.clear();
+            for (const SlowSample &sample : buffer->samples)
+            {
+                slow_samples[sample.stat].push_back(sample.ms);
+            }
+            buffer->samples.clear();
+        }
+        if (entries.empty())
+        {
+            return;
+        }
+
+        // Per-thread buffers interleave back into call order
+        std::sort(entries.begin(), entries.end(), [](const LogEntry &a, const LogEntry &b)
+                  { return a.sequence < b.sequence; });
+        bool wrote_error = false;
+        for (const LogEntry &entry : entries)
+        {
+            if (entry.key && key_counts[entry.key]++ >= Log::MAX_MESSAGES_PER_KEY)
+            {
+                suppressed[entry.key]++;
+                continue;
+            }
+            bool error = entry.level >= LogLevel::Warning;
+            (error ? std::cerr : std::cout) << entry.message << '\n';
+            wrote_error |= error;
+        }
+        std::cout.flush();
+        if (wrote_error)
+        {
+            std::cerr.flush();
+        }
+    }
+
+    void writeSummary(float interval_seconds)
+    {
+        for (auto &[stat, samples] : slow_samples)
+        {
+            if (samples.empty())
+            {
+                continue;
+            }
+            std::sort(samples.begin(), samples.end());
+            size_t p95 = std::min(samples.size() - 1, static_cast<size_t>(samples.size() * 0.95f));
+            std::cout << "Slow " << stat << ": " << samples.size() << " in " << static_cast<int>(interval_seconds + 0.5f)
+                      << "s, p95 " << samples[p95] << "ms, max " << samples.back() << "ms\n";
+            samples.clear();
+        }
+        for (const auto &[key, count] : suppressed)
+        {
+            std::cout << key << ": " << count << " more messages suppressed\n";
+        }
+        suppressed.clear();
+        key_counts.clear();
+        std::cout.flush();
+    }
+};
+
+LogWriter &getWriter()
+{
+    static LogWriter writer;
+    return writer;
+}
+
+void enqueue(LogLevel level, const char *key, std::string message)
+{
+    if (!Log::isEnabled(level))
+    {
+        return;
+    }
+    ThreadBuffer &buffer = getWriter().getThreadBuffer();
+    uint64_t sequence = next_sequence.fetch_add(1, std::memory_order_relaxed);
+    std::unique_lock<std::mutex> lock(buffer.mutex);
+    buffer.entries.push_back({sequence, level, key, std::move(message)});
+}
+}
+
+void Log::setLevel(LogLevel level)
+{
+    min_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+bool Log::isEnabled(LogLevel level)
+{
+    return static_cast<int>(level) >= min_level.load(std::memory_order_relaxed);
+}
+
+void Log::write(LogLevel level, std::string message)
+{
+    enqueue(level, nullptr, std::move(message));
+}
+
+void Log::writeLimited(LogLevel level, const char *key, std::string message)
+{
+    enqueue(level, key, std::move(message));
+}
+
+void Log::recordSlow(const char *stat, float ms)
+{
+    ThreadBuffer &buffer = getWriter().getThreadBuffer();
+    std::unique_lock<std::mutex> lock(buffer.mutex);
+    buffer.samples.push_back({stat, ms});
+}
+
+void Log::flush()
+{
+    getWriter().flush();
+}
@@ -0,0 +1,41 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <string>
+
+enum class LogLevel
+{
+    Debug,
+    Info,
+    Warning,
+    Error
+};
+
+// Asynchronous logger for the generation and meshing hot paths.
+//
+// write() only appends to the calling thread's buffer; a background thread prints everything
+// in call order (Info and below to stdout, warnings and errors to stderr), so a worker never
+// waits on the console. Messages under a rate-limit key print at most MAX_MESSAGES_PER_KEY
+// times per summary interval and the rest are counted. recordSlow() prints nothing per event:
+// every SUMMARY_INTERVAL_SECONDS the writer reports each stat as a count, p95 and max.
+class Log
+{
+public:
+    static constexpr int MAX_MESSAGES_PER_KEY = 5;
+    static constexpr float SUMMARY_INTERVAL_SECONDS = 5.0f;
+
+    static void setLevel(LogLevel level);
+    static bool isEnabled(LogLevel level); // Check first when a message is costly to format
+
+    static void write(LogLevel level, std::string message);
+    // key names the kind of message (a string literal) for rate limiting
+    static void writeLimited(LogLevel level, const char *key, std::string message);
+
+    // One slow event; stat is a string literal in plural ("mesh builds")
+    static void recordSlow(const char *stat, float ms);
+
+    // Blocks until everything written so far has been printed
+    static void flush();
+};
+
+#endif // LOG_H
@@ -0,0 +1,179 @@
+#include "metrics_exporter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <utility>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace
+{
+void writeValue(std::ostream &out, double value)
+{
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.10g", value);
+    out << text << '\n';
+}
+
+double getResidentBytes()
+{
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0;
+    size_t resident = 0;
+    if (statm >> pages >> resident)
+    {
+        return static_cast<double>(resident) * static_cast<double>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    return 0.0;
+}
+} // namespace
+
+MetricsExporter::MetricsExporter(std::string path, float interval_seconds)
+    : path(std::move(path)), interval_seconds(std::max(0.1f, interval_seconds))
+{
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+}
+
+MetricsExporter::Metric MetricsExporter::addCounter(const std::string &name, const std::string &help)
+{
+    return add(name, help, Type::Counter, 1);
+}
+
+MetricsExporter::Metric MetricsExporter::addGauge(const std::string &name, const std::string &help)
+{
+    return add(name, help, Type::Gauge, 1);
+}
+
+MetricsExporter::Metric MetricsExporter::addSummary(const std::string &name, const std::string &help)
+{
+    return add(name, help, Type::Summary, SUMMARY_VALUES);
+}
+
+MetricsExporter::Metric MetricsExporter::add(const std::string &name, const std::string &help, Type type,
+                                             size_t value_count)
+{
+    entries.push_back({name, help, type, values.size()});
+    for (size_t i = 0; i < value_count; i++)
+    {
+        values.emplace_back(0.0);
+    }
+    return entries.size() - 1;
+}
+
+void MetricsExporter::set(Metric metric, double value)
+{
+    values[entries[metric].first_value].store(value, std::memory_order_relaxed);
+}
+
+void MetricsExporter::setSummary(Metric metric, const LatencyHistogram &histogram)
+{
+    size_t first = entries[metric].first_value;
+    for (size_t i = 0; i < QUANTILE_COUNT; i++)
+    {
+        values[first + i].store(histogram.getPercentile(QUANTILES[i]), std::memory_order_relaxed);
+    }
+    values[first + QUANTILE_COUNT].store(static_cast<double>(histogram.getMean()) * histogram.getCount(),
+                                         std::memory_order_relaxed);
+    values[first + QUANTILE_COUNT + 1].store(static_cast<double>(histogram.getCount()), std::memory_order_relaxed);
+}
+
+bool MetricsExporter::start()
+{
+    if (writer.joinable())
+    {
+        return true;
+    }
+    if (!writeFile())
+    {
+        std::cerr << "Metrics: cannot write " << path << std::endl;
+        return false;
+    }
+    stopping = false;
+    writer = std::thread([this]() { run(); });
+    return true;
+}
+
+void MetricsExporter::stop()
+{
+    if (!writer.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex);
+        stopping = true;
+    }
+    stop_requested.notify_one();
+    writer.join();
+}
+
+void MetricsExporter::run()
+{
+    const auto interval = std::chrono::duration<float>(interval_seconds);
+    std::unique_lock<std::mutex> lock(stop_mutex);
+    while (!stop_requested.wait_for(lock, interval, [this]() { return stopping; }))
+    {
+        lock.unlock();
+        writeFile();
+        lock.lock();
+    }
+    lock.unlock();
+    writeFile(); // The final values, once the owner has stopped publishing
+}
+
+bool MetricsExporter::writeFile() const
+{
+    static const char *const TYPE_NAMES[] = {"counter", "gauge", "summary"}; // By Type
+
+    // Beside the file, so the rename cannot cross file systems
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        if (!out)
+        {
+            return false;
+        }
+        for (const Entry &entry : entries)
+        {
+            out << "# HELP " << entry.name << ' ' << entry.help << '\n';
+            out << "# TYPE " << entry.name << ' ' << TYPE_NAMES[static_cast<int>(entry.type)] << '\n';
+            if (entry.type != Type::Summary)
+            {
+                out << entry.name << ' ';
+                writeValue(out, values[entry.first_value].load(std::memory_order_relaxed));
+                continue;
+            }
+            for (size_t i = 0; i < QUANTILE_COUNT; i++)
+            {
+                out << entry.name << "{quantile=\"" << QUANTILES[i] << "\"} ";
+                writeValue(out, values[entry.first_value + i].load(std::memory_order_relaxed));
+            }
+            out << entry.name << "_sum ";
+            writeValue(out, values[entry.first_value + QUANTILE_COUNT].load(std::memory_order_relaxed));
+            out << entry.name << "_count ";
+            writeValue(out, values[entry.first_value + QUANTILE_COUNT + 1].load(std::memory_order_relaxed));
+        }
+        out << "# HELP process_resident_memory_bytes Resident memory size in bytes.\n";
+        out << "# TYPE process_resident_memory_bytes gauge\n";
+        out << "process_resident_memory_bytes ";
+        writeValue(out, getResidentBytes());
+        if (!out)
+        {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
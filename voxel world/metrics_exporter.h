@@ -0,0 +1,88 @@
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include "latency_histogram.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Metrics of a long-running process as a Prometheus text file (exposition format 0.0.4), for
+// the node exporter's textfile collector or anything else that reads the format.
+//
+// The owner declares its metrics once, before start, then publishes into them whenever it
+// samples its counters, typically once per tick. Every value is an atomic written with a
+// relaxed store; a writer thread of the exporter's own wakes every interval, loads them all
+// and replaces the file (written beside it and renamed, so a reader never sees half a file).
+// Nothing but those atomics is shared: the writer takes no lock a tick or worker thread
+// uses, and a slow disk only makes the file late. process_resident_memory_bytes is added by
+// the exporter itself.
+class MetricsExporter
+{
+public:
+    using Metric = size_t; // Returned by the add functions
+
+    static constexpr float DEFAULT_INTERVAL_SECONDS = 5.0f;
+
+    explicit MetricsExporter(std::string path, float interval_seconds = DEFAULT_INTERVAL_SECONDS);
+    ~MetricsExporter(); // Stops, writing the file a last time
+
+    MetricsExporter(const MetricsExporter &) = delete;
+    MetricsExporter &operator=(const MetricsExporter &) = delete;
+
+    // Names follow Prometheus rules ([a-zA-Z_:][a-zA-Z0-9_:]*, counters ending in _total)
+    Metric addCounter(const std::string &name, const std::string &help);
+    Metric addGauge(const std::string &name, const std::string &help);
+    // Latency summary in milliseconds: quantiles 0.5, 0.9 and 0.99, _sum and _count
+    Metric addSummary(const std::string &name, const std::string &help);
+
+    // Any thread; a counter takes the running total, not an increment
+    void set(Metric metric, double value);
+    void setSummary(Metric metric, const LatencyHistogram &histogram);
+
+    // Starts the writer; false (with the reason on stderr) if the file cannot be written
+    bool start();
+    void stop();
+
+    const std::string &getPath() const { return path; }
+
+private:
+    enum class Type
+    {
+        Counter,
+        Gauge,
+        Summary
+    };
+
+    static constexpr size_t QUANTILE_COUNT = 3;
+    static constexpr float QUANTILES[QUANTILE_COUNT] = {0.5f, 0.9f, 0.99f};
+    static constexpr size_t SUMMARY_VALUES = QUANTILE_COUNT + 2; // Quantiles, sum, count
+
+    struct Entry
+    {
+        std::string name;
+        std::string help;
+        Type type;
+        size_t first_value; // Into values; a summary holds SUMMARY_VALUES in a row
+    };
+
+    std::string path;
+    float interval_seconds;
+    std::vector<Entry> entries; // Fixed once started
+    std::deque<std::atomic<double>> values; // Stable addresses, one per published number
+
+    std::thread writer;
+    std::mutex stop_mutex; // Between stop and the writer only
+    std::condition_variable stop_requested;
+    bool stopping = false;
+
+    Metric add(const std::string &name, const std::string &help, Type type, size_t value_count);
+    void run();
+    bool writeFile() const;
+};
+
+#endif // METRICS_EXPORTER_H
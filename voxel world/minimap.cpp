@@ -0,0 +1,274 @@
+#include "minimap.h"
+#include "height_field_cache.h"
+#include "profiler.h"
+#include "startup_cache.h"
+#include "../shader.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace
+{
+constexpr GLint MINIMAP_TEXTURE_UNIT = 3; // Clear of the block textures and face records
+
+// Stored heights are offset by one so 0 can mean "no tile yet"
+GLushort encodeHeight(int height)
+{
+    return static_cast<GLushort>(std::min(65535, std::max(1, height + 1)));
+}
+
+int floorDiv(int value, int divisor)
+{
+    int quotient = value / divisor;
+    return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? quotient - 1 : quotient;
+}
+
+int ringIndex(int column)
+{
+    return ((column % Minimap::MAP_COLUMNS) + Minimap::MAP_COLUMNS) % Minimap::MAP_COLUMNS;
+}
+}
+
+Minimap::Minimap(HeightFieldCache &heights)
+    : heights(heights), texture(0), vao(0), uniform_rect(-1), uniform_camera(-1), uniform_view_radius(-1),
+      uniform_heading(-1), uniform_water_level(-1), view_radius(192.0f),
+      slots(static_cast<size_t>(MAP_COLUMNS) * MAP_COLUMNS), center_column(0), window_valid(false),
+      upload_buffer(CHUNK_SIZE * CHUNK_SIZE * 2)
+{
+}
+
+Minimap::~Minimap()
+{
+    heights.setArrivalTracking(false);
+    if (texture != 0)
+    {
+        glDeleteTextures(1, &texture);
+    }
+    if (vao != 0)
+    {
+        glDeleteVertexArrays(1, &vao);
+    }
+    if (shader)
+    {
+        glDeleteProgram(shader->ID);
+    }
+}
+
+bool Minimap::initialize()
+{
+    // Same search order as the voxel shaders
+    StartupCache cache;
+    for (const char *directory : {"shaders/", "voxel world/"})
+    {
+        shader = cache.loadShader("minimap", std::string(directory) + "minimap.vs", std::string(directory) + "minimap.fs");
+        if (shader)
+        {
+            break;
+        }
+    }
+    if (!shader)
+    {
+        std::cerr << "Minimap: shaders not found" << std::endl;
+        return false;
+    }
+
+    uniform_rect = glGetUniformLocation(shader->ID, "rect");
+    uniform_camera = glGetUniformLocation(shader->ID, "camera_xz");
+    uniform_view_radius = glGetUniformLocation(shader->ID, "view_radius");
+    uniform_heading = glGetUniformLocation(shader->ID, "heading");
+    uniform_water_level = glGetUniformLocation(shader->ID, "water_level");
+    shader->use();
+    glUniform1i(glGetUniformLocation(shader->ID, "heights"), MINIMAP_TEXTURE_UNIT);
+
+    // Zeroed up front: every block reads as "no tile yet" until written
+    std::vector<GLushort> zeros(static_cast<size_t>(TEXTURE_SIZE) * TEXTURE_SIZE * 2, 0);
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16, TEXTURE_SIZE, TEXTURE_SIZE, 0, GL_RG, GL_UNSIGNED_SHORT, zeros.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenVertexArrays(1, &vao);
+
+    heights.setArrivalTracking(true);
+    return true;
+}
+
+void Minimap::setViewRadius(float blocks)
+{
+    view_radius = std::max(static_cast<float>(CHUNK_SIZE), std::min(blocks, TEXTURE_SIZE * 0.5f - CHUNK_SIZE));
+}
+
+Minimap::Slot &Minimap::getSlot(const glm::ivec2 &column)
+{
+    return slots[static_cast<size_t>(ringIndex(column.x)) * MAP_COLUMNS + ringIndex(column.y)];
+}
+
+bool Minimap::isInWindow(const glm::ivec2 &column) const
+{
+    glm::ivec2 offset = column - center_column;
+    return offset.x >= -MAP_COLUMNS / 2 && offset.x < MAP_COLUMNS / 2 && offset.y >= -MAP_COLUMNS / 2 &&
+           offset.y < MAP_COLUMNS / 2;
+}
+
+void Minimap::queueWindow()
+{
+    for (int dx = -MAP_COLUMNS / 2; dx < MAP_COLUMNS / 2; dx++)
+    {
+        for (int dz = -MAP_COLUMNS / 2; dz < MAP_COLUMNS / 2; dz++)
+        {
+            glm::ivec2 column = center_column + glm::ivec2(dx, dz);
+            const Slot &slot = getSlot(column);
+            if (!slot.assigned || slot.column != column)
+            {
+                pending.push_back(column);
+            }
+        }
+    }
+}
+
+void Minimap::update(const glm::vec3 &camera_position)
+{
+    if (!shader)
+    {
+        return;
+    }
+    PROFILE_ZONE("Minimap::update");
+
+    glm::ivec2 column(floorDiv(static_cast<int>(std::floor(camera_position.x)), CHUNK_SIZE),
+                      floorDiv(static_cast<int>(std::floor(camera_position.z)), CHUNK_SIZE));
+    if (!window_valid || column != center_column)
+    {
+        center_column = column;
+        window_valid = true;
+        queueWindow(); // Only the columns that just scrolled in hold someone else's block
+    }
+
+    if (!heights.takeArrivals(arrivals))
+    {
+        // Some arrivals were dropped: any block still waiting may have its tile by now
+        for (int dx = -MAP_COLUMNS / 2; dx < MAP_COLUMNS / 2; dx++)
+        {
+            for (int dz = -MAP_COLUMNS / 2; dz < MAP_COLUMNS / 2; dz++)
+            {
+                glm::ivec2 waiting = center_column + glm::ivec2(dx, dz);
+                if (!getSlot(waiting).filled)
+                {
+                    pending.push_back(waiting);
+                }
+            }
+        }
+    }
+    for (const glm::ivec2 &arrived : arrivals)
+    {
+        pending.push_back(arrived);
+    }
+
+    int uploads = 0;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    while (!pending.empty() && uploads < MAX_UPLOADS_PER_FRAME)
+    {
+        glm::ivec2 next = pending.front();
+        pending.pop_front();
+        const Slot &slot = getSlot(next);
+        if (!isInWindow(next) || (slot.assigned && slot.column == next && slot.filled))
+        {
+            continue;
+        }
+        writeColumn(next);
+        uploads++;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Minimap::writeColumn(const glm::ivec2 &column)
+{
+    Slot &slot = getSlot(column);
+    HeightFieldCache::TileHandle tile = heights.peek(column);
+    if (!tile)
+    {
+        // Not generated (or already evicted): clear what the block showed before
+        bool holds_other = slot.assigned && slot.column != column && slot.filled;
+        slot = Slot{column, true, false};
+        if (!holds_other)
+        {
+            return;
+        }
+        std::fill(upload_buffer.begin(), upload_buffer.end(), 0);
+    }
+    else
+    {
+        // Texel rows run along x, one row per z; height then biome
+        for (int z = 0; z < CHUNK_SIZE; z++)
+        {
+            for (int x = 0; x < CHUNK_SIZE; x++)
+            {
+                upload_buffer[(z * CHUNK_SIZE + x) * 2] = encodeHeight(tile->get(x, z));
+                upload_buffer[(z * CHUNK_SIZE + x) * 2 + 1] = tile->getBiome(x, z);
+            }
+        }
+        slot = Slot{column, true, true};
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, ringIndex(column.x) * CHUNK_SIZE, ringIndex(column.y) * CHUNK_SIZE, CHUNK_SIZE,
+                    CHUNK_SIZE, GL_RG, GL_UNSIGNED_SHORT, upload_buffer.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void Minimap::render(const glm::vec3 &camera_position, float yaw)
+{
+    if (!shader)
+    {
+        return;
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if (viewport[2] <= 2 * SCREEN_MARGIN + SCREEN_SIZE || viewport[3] <= 2 * SCREEN_MARGIN + SCREEN_SIZE)
+    {
+        return; // Window too small to spare the corner
+    }
+
+    // Top right corner in normalized device coordinates
+    float right = 1.0f - 2.0f * SCREEN_MARGIN / viewport[2];
+    float top = 1.0f - 2.0f * SCREEN_MARGIN / viewport[3];
+    float left = right - 2.0f * SCREEN_SIZE / viewport[2];
+    float bottom = top - 2.0f * SCREEN_SIZE / viewport[3];
+
+    GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean face_culling = glIsEnabled(GL_CULL_FACE);
+    GLboolean blending = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Camera::Yaw is measured from +x towards +z
+    float radians = yaw * 3.14159265f / 180.0f;
+    shader->use();
+    glUniform4f(uniform_rect, left, bottom, right, top);
+    glUniform2f(uniform_camera, camera_position.x, camera_position.z);
+    glUniform1f(uniform_view_radius, view_radius);
+    glUniform2f(uniform_heading, std::cos(radians), std::sin(radians));
+    glUniform1f(uniform_water_level, static_cast<float>(WATER_LEVEL));
+    glActiveTexture(GL_TEXTURE0 + MINIMAP_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    if (depth_test)
+        glEnable(GL_DEPTH_TEST);
+    if (face_culling)
+        glEnable(GL_CULL_FACE);
+    if (!blending)
+        glDisable(GL_BLEND);
+}
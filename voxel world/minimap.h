@@ -0,0 +1,87 @@
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include "voxel_types.h"
+#include <glm/glm/glm.hpp>
+#include <glad/glad/glad.h>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <vector>
+
+class HeightFieldCache;
+class Shader;
+
+// Top-down map of the terrain around the camera, drawn in the top right corner.
+//
+// It is fed the height tiles generation already puts in the HeightFieldCache, so the map
+// costs no noise work and is tinted by the same column biomes the terrain was built from. Every chunk column owns a 16x16 block of a ring-addressed texture
+// (world column modulo MAP_COLUMNS): a block is written with glTexSubImage2D when its tile
+// arrives or when its column scrolls into the window, and never rewritten while it stays,
+// so the map keeps columns the cache has since evicted.
+class Minimap
+{
+public:
+    static constexpr int MAP_COLUMNS = 64; // Chunk columns per texture side
+    static constexpr int TEXTURE_SIZE = MAP_COLUMNS * CHUNK_SIZE;
+    static constexpr int MAX_UPLOADS_PER_FRAME = 256; // Column blocks written per update
+    static constexpr int SCREEN_SIZE = 256;           // Pixels across
+    static constexpr int SCREEN_MARGIN = 16;          // Pixels to the window corner
+    static_assert((TEXTURE_SIZE & (TEXTURE_SIZE - 1)) == 0, "The shader wraps texels with a mask");
+
+    explicit Minimap(HeightFieldCache &heights);
+    ~Minimap();
+
+    Minimap(const Minimap &) = delete;
+    Minimap &operator=(const Minimap &) = delete;
+
+    // Load the shader and allocate the texture; turns on the cache's arrival tracking
+    bool initialize();
+
+    // Main thread: follow the camera and write the column blocks that arrived
+    void update(const glm::vec3 &camera_position);
+
+    // Main thread, over the finished frame; yaw in degrees (Camera::Yaw)
+    void render(const glm::vec3 &camera_position, float yaw);
+
+    // Blocks from the camera to the edge of the map, at most half the texture
+    void setViewRadius(float blocks);
+    float getViewRadius() const { return view_radius; }
+
+    size_t getPendingUploads() const { return pending.size(); }
+
+private:
+    // The column a texture block holds; filled is false while it waits for its tile
+    struct Slot
+    {
+        glm::ivec2 column{0};
+        bool assigned = false;
+        bool filled = false;
+    };
+
+    HeightFieldCache &heights;
+    std::unique_ptr<Shader> shader;
+    GLuint texture;
+    GLuint vao; // No attributes: the quad comes from gl_VertexID
+    GLint uniform_rect;
+    GLint uniform_camera;
+    GLint uniform_view_radius;
+    GLint uniform_heading;
+    GLint uniform_water_level;
+    float view_radius;
+
+    // Main thread only
+    std::vector<Slot> slots; // MAP_COLUMNS squared, by ring position
+    glm::ivec2 center_column;
+    bool window_valid;
+    std::deque<glm::ivec2> pending; // Columns to (re)write, oldest first
+    std::vector<glm::ivec2> arrivals;
+    std::vector<GLushort> upload_buffer; // Height and biome per texel
+
+    Slot &getSlot(const glm::ivec2 &column);
+    bool isInWindow(const glm::ivec2 &column) const;
+    void queueWindow(); // Every column of the window whose block holds something else
+    void writeColumn(const glm::ivec2 &column);
+};
+
+#endif // MINIMAP_H
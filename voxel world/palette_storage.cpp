@@ -0,0 +1,512 @@
+#include "palette_storage.h"
+#include "block_registry.h"
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+void writeVarint(std::vector<unsigned char> &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+bool readVarint(const unsigned char *&data, const unsigned char *end, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && data < end; shift += 7)
+    {
+        unsigned char byte = *data++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+}
+
+PaletteStorage::PaletteStorage(size_t entry_count, VoxelID initial)
+    : entry_count(entry_count), bits_per_entry(0), entry_mask(0)
+{
+    palette.push_back(initial);
+}
+
+VoxelID PaletteStorage::set(int index, VoxelID voxel)
+{
+    unpack();
+    VoxelID previous = get(index);
+    if (previous == voxel)
+    {
+        return previous;
+    }
+
+    uint64_t palette_index = static_cast<uint64_t>(findOrAddPaletteEntry(voxel));
+
+    int bit = index * bits_per_entry;
+    uint64_t &word = ownWords(getWordCount())[bit >> 6];
+    int shift = bit & 63;
+    word = (word & ~(entry_mask << shift)) | (palette_index << shift);
+
+    return previous;
+}
+
+void PaletteStorage::setStrided(size_t first, size_t count, size_t stride, VoxelID voxel)
+{
+    if (!packed_runs.empty())
+    {
+        unpack();
+    }
+    if (count == 0 || (bits_per_entry == 0 && palette[0] == voxel))
+    {
+        return;
+    }
+
+    uint64_t palette_index = static_cast<uint64_t>(findOrAddPaletteEntry(voxel));
+    const size_t bits = static_cast<size_t>(bits_per_entry);
+    uint64_t *data = ownWords(getWordCount());
+    for (size_t i = 0, index = first; i < count; i++, index += stride)
+    {
+        size_t bit = index * bits;
+        uint64_t &word = data[bit >> 6];
+        int shift = static_cast<int>(bit & 63);
+        word = (word & ~(entry_mask << shift)) | (palette_index << shift);
+    }
+}
+
+void PaletteStorage::fill(VoxelID voxel)
+{
+    std::vector<unsigned char>().swap(packed_runs);
+    palette.clear();
+    palette.push_back(voxel);
+    words.reset();
+    word_capacity = 0;
+    bits_per_entry = 0;
+    entry_mask = 0;
+}
+
+void PaletteStorage::reset(VoxelID voxel)
+{
+    std::vector<unsigned char>().swap(packed_runs);
+    palette.clear();
+    palette.push_back(voxel);
+    if (words.use_count() > 1)
+    {
+        words.reset(); // Still read through a copy: leave the words to it
+        word_capacity = 0;
+    }
+    bits_per_entry = 0;
+    entry_mask = 0;
+}
+
+void PaletteStorage::assign(const VoxelID *values)
+{
+    // Palette in order of first use; neighboring entries are mostly equal, so only changes
+    // are looked up
+    reset(values[0]);
+    VoxelID last = values[0];
+    for (size_t i = 1; i < entry_count; i++)
+    {
+        if (values[i] != last)
+        {
+            last = values[i];
+            if (std::find(palette.begin(), palette.end(), last) == palette.end())
+            {
+                palette.push_back(last);
+            }
+        }
+    }
+    if (palette.size() == 1)
+    {
+        return; // Uniform
+    }
+
+    int new_bits = 1;
+    while ((size_t(1) << new_bits) < palette.size())
+    {
+        new_bits *= 2;
+    }
+    resize(new_bits);
+
+    // Words start zeroed, so entries are OR-ed in
+    const size_t bits = static_cast<size_t>(bits_per_entry);
+    uint64_t index = 0;
+    last = palette[0];
+    for (size_t i = 0; i < entry_count; i++)
+    {
+        if (values[i] != last)
+        {
+            last = values[i];
+            index = static_cast<uint64_t>(std::find(palette.begin(), palette.end(), last) - palette.begin());
+        }
+        words[(i * bits) >> 6] |= index << ((i * bits) & 63);
+    }
+}
+
+int PaletteStorage::findOrAddPaletteEntry(VoxelID voxel)
+{
+    // Palettes are tiny (a handful of types per chunk), so a linear scan beats hashing
+    for (size_t i = 0; i < palette.size(); i++)
+    {
+        if (palette[i] == voxel)
+        {
+            return static_cast<int>(i);
+        }
+    }
+
+    palette.push_back(voxel);
+
+    // Grow index width once the palette no longer fits
+    if (palette.size() > (size_t(1) << bits_per_entry))
+    {
+        int new_bits = bits_per_entry == 0 ? 1 : bits_per_entry * 2;
+        resize(new_bits);
+    }
+
+    return static_cast<int>(palette.size() - 1);
+}
+
+void PaletteStorage::resize(int new_bits)
+{
+    // Repacked in place, last entry first: entry i moves from bit i*old to i*new >= i*old,
+    // so every write lands above the old entries that are still unread. Reusing the
+    // words (and their capacity after PaletteStorage::reset) avoids reallocating per growth.
+    size_t old_bits = static_cast<size_t>(bits_per_entry);
+    uint64_t old_mask = entry_mask;
+    uint64_t new_mask = (uint64_t(1) << new_bits) - 1;
+    size_t old_count = getWordCount();
+    size_t new_count = (entry_count * new_bits + 63) / 64;
+    uint64_t *data = ownWords(new_count);
+
+    // A 0-bit storage implicitly holds index 0 everywhere, which zeroed words already represent
+    std::fill(data + old_count, data + new_count, 0);
+    if (old_bits > 0)
+    {
+        for (size_t i = entry_count; i-- > 0;)
+        {
+            size_t old_bit = i * old_bits;
+            uint64_t value = (data[old_bit >> 6] >> (old_bit & 63)) & old_mask;
+
+            size_t new_bit = i * new_bits;
+            uint64_t &word = data[new_bit >> 6];
+            int shift = static_cast<int>(new_bit & 63);
+            word = (word & ~(new_mask << shift)) | (value << shift);
+        }
+    }
+
+    bits_per_entry = new_bits;
+    entry_mask = new_mask;
+}
+
+template <int BITS>
+void PaletteStorage::decodePacked(VoxelID *out) const
+{
+    constexpr int entries_per_word = 64 / BITS;
+    constexpr uint64_t mask = (uint64_t(1) << BITS) - 1;
+    const VoxelID *lookup = palette.data();
+
+    size_t full_words = entry_count / entries_per_word;
+    for (size_t w = 0; w < full_words; w++)
+    {
+        uint64_t word = words[w];
+        for (int j = 0; j < entries_per_word; j++)
+        {
+            *out++ = lookup[word & mask];
+            word >>= BITS;
+        }
+    }
+
+    // Tail for sizes that are not a multiple of the word capacity
+    size_t remaining = entry_count - full_words * entries_per_word;
+    if (remaining > 0)
+    {
+        uint64_t word = words[full_words];
+        for (size_t j = 0; j < remaining; j++)
+        {
+            *out++ = lookup[word & mask];
+            word >>= BITS;
+        }
+    }
+}
+
+void PaletteStorage::decodeAll(VoxelID *out) const
+{
+    if (!packed_runs.empty())
+    {
+        // Written by pack, so well formed: the palette, then (length, index) pairs
+        const unsigned char *data = packed_runs.data();
+        const unsigned char *end = data + packed_runs.size();
+        uint64_t value = 0;
+        readVarint(data, end, value);
+        for (uint64_t i = 0; i < value; i++)
+        {
+            uint64_t skipped = 0;
+            readVarint(data, end, skipped);
+        }
+        VoxelID *out_end = out + entry_count;
+        while (out < out_end)
+        {
+            uint64_t length = 0;
+            uint64_t index = 0;
+            readVarint(data, end, length);
+            readVarint(data, end, index);
+            out = std::fill_n(out, static_cast<size_t>(length), palette[static_cast<size_t>(index)]);
+        }
+        return;
+    }
+
+    switch (bits_per_entry)
+    {
+    case 0:
+        std::fill(out, out + entry_count, palette[0]);
+        break;
+    case 1:
+        decodePacked<1>(out);
+        break;
+    case 2:
+        decodePacked<2>(out);
+        break;
+    case 4:
+        decodePacked<4>(out);
+        break;
+    case 8:
+        decodePacked<8>(out);
+        break;
+    default:
+        decodePacked<16>(out);
+        break;
+    }
+}
+
+void PaletteStorage::encodeRuns(std::vector<unsigned char> &out) const
+{
+    if (!packed_runs.empty())
+    {
+        out.insert(out.end(), packed_runs.begin(), packed_runs.end());
+        return;
+    }
+
+    writeVarint(out, palette.size());
+    for (VoxelID voxel : palette)
+    {
+        writeVarint(out, voxel);
+    }
+
+    // Terrain is layered and mostly air or stone, so runs are long; entries never straddle
+    // words because every width divides 64
+    const size_t bits = static_cast<size_t>(bits_per_entry);
+    uint64_t run_index = 0;
+    size_t run_length = 0;
+    for (size_t i = 0; i < entry_count; i++)
+    {
+        uint64_t index = bits == 0 ? 0 : (words[(i * bits) >> 6] >> ((i * bits) & 63)) & entry_mask;
+        if (run_length > 0 && index != run_index)
+        {
+            writeVarint(out, run_length);
+            writeVarint(out, run_index);
+            run_length = 0;
+        }
+        run_index = index;
+        run_length++;
+    }
+    if (run_length > 0)
+    {
+        writeVarint(out, run_length);
+        writeVarint(out, run_index);
+    }
+}
+
+bool PaletteStorage::decodeRuns(const unsigned char *data, size_t size)
+{
+    const unsigned char *end = data + size;
+    uint64_t palette_size = 0;
+    if (!readVarint(data, end, palette_size) || palette_size == 0 || palette_size > entry_count)
+    {
+        return false;
+    }
+
+    std::vector<VoxelID> saved_palette(static_cast<size_t>(palette_size));
+    for (VoxelID &voxel : saved_palette)
+    {
+        uint64_t value = 0;
+        if (!readVarint(data, end, value) || value >= static_cast<uint64_t>(BlockRegistry::get().getTypeCount()))
+        {
+            return false;
+        }
+        voxel = static_cast<VoxelID>(value);
+    }
+
+    // First pass validates the runs and keeps only the palette entries they use, in order
+    // of first use, so the packed width matches what the chunk actually holds
+    thread_local std::vector<std::pair<size_t, uint64_t>> runs;
+    runs.clear();
+    std::vector<int> remap(saved_palette.size(), -1);
+    std::vector<VoxelID> used_palette;
+    size_t total = 0;
+    while (total < entry_count)
+    {
+        uint64_t length = 0;
+        uint64_t index = 0;
+        if (!readVarint(data, end, length) || !readVarint(data, end, index) || length == 0 ||
+            length > entry_count - total || index >= palette_size)
+        {
+            return false;
+        }
+        int &mapped = remap[static_cast<size_t>(index)];
+        if (mapped < 0)
+        {
+            mapped = static_cast<int>(used_palette.size());
+            used_palette.push_back(saved_palette[static_cast<size_t>(index)]);
+        }
+        runs.emplace_back(static_cast<size_t>(length), static_cast<uint64_t>(mapped));
+        total += static_cast<size_t>(length);
+    }
+    if (data != end)
+    {
+        return false;
+    }
+
+    reset(used_palette[0]);
+    if (used_palette.size() == 1)
+    {
+        return true; // Uniform
+    }
+    int new_bits = 1;
+    while ((size_t(1) << new_bits) < used_palette.size())
+    {
+        new_bits *= 2;
+    }
+    palette = std::move(used_palette);
+    resize(new_bits);
+
+    // Words start zeroed, so entries are OR-ed in; whole words of a run take a replicated pattern
+    const size_t bits = static_cast<size_t>(bits_per_entry);
+    const size_t entries_per_word = 64 / bits;
+    size_t first = 0;
+    for (const auto &[length, index] : runs)
+    {
+        size_t i = first;
+        size_t run_end = first + length;
+        for (; i < run_end && i % entries_per_word != 0; i++)
+        {
+            words[(i * bits) >> 6] |= index << ((i * bits) & 63);
+        }
+        if (index != 0 && run_end - i >= entries_per_word)
+        {
+            uint64_t pattern = 0;
+            for (size_t j = 0; j < entries_per_word; j++)
+            {
+                pattern |= index << (j * bits);
+            }
+            for (; i + entries_per_word <= run_end; i += entries_per_word)
+            {
+                words[i / entries_per_word] = pattern;
+            }
+        }
+        else if (index == 0)
+        {
+            i += (run_end - i) / entries_per_word * entries_per_word; // Already zero
+        }
+        for (; i < run_end; i++)
+        {
+            words[(i * bits) >> 6] |= index << ((i * bits) & 63);
+        }
+        first = run_end;
+    }
+    return true;
+}
+
+bool PaletteStorage::pack()
+{
+    if (bits_per_entry == 0)
+    {
+        return false;
+    }
+    std::vector<unsigned char> runs;
+    encodeRuns(runs);
+    if (runs.size() >= word_capacity * sizeof(uint64_t))
+    {
+        return false;
+    }
+
+    // The palette is encodeRuns', so decodeAll can index it while packed
+    runs.shrink_to_fit();
+    packed_runs = std::move(runs);
+    words.reset(); // Copies that share them keep theirs
+    word_capacity = 0;
+    bits_per_entry = 0;
+    entry_mask = 0;
+    return true;
+}
+
+VoxelID PaletteStorage::getPacked(int index) const
+{
+    // Same layout as decodeAll reads: skip the palette, then count off the runs
+    const unsigned char *data = packed_runs.data();
+    const unsigned char *end = data + packed_runs.size();
+    uint64_t value = 0;
+    readVarint(data, end, value);
+    for (uint64_t i = 0; i < value; i++)
+    {
+        uint64_t skipped = 0;
+        readVarint(data, end, skipped);
+    }
+    uint64_t remaining = static_cast<uint64_t>(index);
+    while (data < end)
+    {
+        uint64_t length = 0;
+        uint64_t palette_index = 0;
+        readVarint(data, end, length);
+        readVarint(data, end, palette_index);
+        if (remaining < length)
+        {
+            return palette[static_cast<size_t>(palette_index)];
+        }
+        remaining -= length;
+    }
+    return palette[0];
+}
+
+void PaletteStorage::unpack()
+{
+    if (packed_runs.empty())
+    {
+        return;
+    }
+    PaletteStorage restored(entry_count);
+    restored.decodeRuns(packed_runs.data(), packed_runs.size());
+    bits_per_entry = restored.bits_per_entry;
+    entry_mask = restored.entry_mask;
+    palette = std::move(restored.palette);
+    words = std::move(restored.words);
+    word_capacity = restored.word_capacity;
+    std::vector<unsigned char>().swap(packed_runs);
+}
+
+size_t PaletteStorage::getMemoryUsage() const
+{
+    return sizeof(*this) + palette.capacity() * sizeof(VoxelID) + word_capacity * sizeof(uint64_t) +
+           packed_runs.capacity();
+}
+
+uint64_t *PaletteStorage::ownWords(size_t count)
+{
+    if (words.use_count() > 1 || count > word_capacity)
+    {
+        std::shared_ptr<uint64_t[]> owned = std::make_shared_for_overwrite<uint64_t[]>(count);
+        std::copy_n(words.get(), std::min(getWordCount(), count), owned.get());
+        words = std::move(owned);
+        word_capacity = count;
+    }
+    else
+    {
+        // Copies that shared the words only let go of them; their reads come before our writes
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return words.get();
+}
@@ -0,0 +1,104 @@
+#ifndef PALETTE_STORAGE_H
+#define PALETTE_STORAGE_H
+
+#include "voxel_types.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+// Palette-compressed voxel storage for one chunk.
+//
+// Each entry stores an index into a small per-chunk palette of VoxelIDs. Indices are
+// bit-packed into 64-bit words at 1/2/4/8 bits per entry (16 as a last resort), growing
+// as new voxel types are written. A palette with a single entry needs no index data at all.
+//
+// Idle chunks can be packed further (pack): the index words are swapped for the run
+// encoding of encodeRuns until the owner unpacks them, explicitly or by writing. Const
+// access never modifies the storage: get walks the runs of a packed storage (slow, owners
+// unpack what they read per voxel), and encodeRuns and decodeAll read them directly.
+//
+// Copies are copy-on-write: they share the index words until one of them writes, and only
+// a write to words that another copy still holds copies them. Snapshots of a chunk (mesh
+// jobs, saves) therefore cost a palette copy, and an edit pays for the copy only while such
+// a snapshot is still out. Shared words are never written, so copies may be read on
+// different threads.
+class PaletteStorage
+{
+public:
+    explicit PaletteStorage(size_t entry_count, VoxelID initial = VOXEL_AIR);
+
+    // Single-entry access
+    VoxelID get(int index) const
+    {
+        if (bits_per_entry == 0)
+        {
+            return packed_runs.empty() ? palette[0] : getPacked(index);
+        }
+        int bit = index * bits_per_entry;
+        uint64_t word = words[bit >> 6];
+        return palette[(word >> (bit & 63)) & entry_mask];
+    }
+
+    // Returns the previous value at index
+    VoxelID set(int index, VoxelID voxel);
+
+    // Write one value to count entries, first + i * stride (e.g. a vertical run in a chunk).
+    // The palette lookup happens once for the whole run.
+    void setStrided(size_t first, size_t count, size_t stride, VoxelID voxel);
+
+    // Reset every entry to a single value (releases index storage)
+    void fill(VoxelID voxel);
+
+    // Same as fill, but keeps the allocated storage for the next writes (pooled chunks)
+    void reset(VoxelID voxel);
+
+    // Replace the contents from a flat array of size() entries, packed once at the final
+    // width instead of growing as new types appear
+    void assign(const VoxelID *values);
+
+    // Bulk decode all entries into a flat VoxelID array of size()
+    void decodeAll(VoxelID *out) const;
+
+    // Compact serialized form (region files): the palette, then runs of equal palette
+    // indices in entry order, all as varints. Appends to out.
+    void encodeRuns(std::vector<unsigned char> &out) const;
+    // Replace the contents from encodeRuns output; false (contents unspecified) if malformed
+    bool decodeRuns(const unsigned char *data, size_t size);
+
+    // Replace the index words with their run encoding until unpack or the next write; false
+    // (left as is) if uniform, packed already or the runs would not be smaller
+    bool pack();
+    void unpack(); // Back to index words (nothing if not packed)
+    bool isPacked() const { return !packed_runs.empty(); }
+
+    // State queries
+    size_t size() const { return entry_count; }
+    bool isUniform() const { return bits_per_entry == 0 && packed_runs.empty(); }
+    int getBitsPerEntry() const { return bits_per_entry; } // 0 while packed
+    size_t getPaletteSize() const { return palette.size(); }
+    const std::vector<VoxelID> &getPalette() const { return palette; }
+    size_t getMemoryUsage() const;
+
+private:
+    size_t entry_count;
+    int bits_per_entry;
+    uint64_t entry_mask;
+    std::vector<VoxelID> palette; // Kept while packed
+    std::shared_ptr<uint64_t[]> words; // Shared with copies until written (ownWords)
+    size_t word_capacity = 0;
+    std::vector<unsigned char> packed_runs; // encodeRuns output while packed, else empty
+
+    VoxelID getPacked(int index) const; // From the runs, leaving them packed
+    size_t getWordCount() const { return (entry_count * static_cast<size_t>(bits_per_entry) + 63) / 64; }
+    // The index words for writing, count of them with the current ones in front: copied
+    // first if another copy shares them or they are too few
+    uint64_t *ownWords(size_t count);
+    int findOrAddPaletteEntry(VoxelID voxel);
+    void resize(int new_bits);
+
+    template <int BITS>
+    void decodePacked(VoxelID *out) const;
+};
+
+#endif // PALETTE_STORAGE_H
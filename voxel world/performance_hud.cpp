@@ -0,0 +1,327 @@
+#include "performance_hud.h"
+#include "startup_cache.h"
+#include "../shader.h"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+constexpr GLint HUD_TEXTURE_UNIT = 3; // The minimap's: both draw over the finished frame and unbind it
+
+// 5x7 glyphs of ASCII 32 ('space') to 95 ('_'), one byte per row from the top, bit 4 leftmost
+constexpr int GLYPH_WIDTH = 5;
+constexpr int GLYPH_HEIGHT = 7;
+constexpr int FIRST_GLYPH = 32;
+constexpr int GLYPH_COUNT = 64;
+constexpr uint8_t FONT_GLYPHS[GLYPH_COUNT][GLYPH_HEIGHT] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // space
+    {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04}, // !
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // "
+    {0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A}, // #
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // $
+    {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, // %
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // &
+    {0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00}, // '
+    {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}, // (
+    {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}, // )
+    {0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00}, // *
+    {0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00}, // +
+    {0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08}, // ,
+    {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}, // -
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}, // .
+    {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // /
+    {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, // 0
+    {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 1
+    {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, // 2
+    {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}, // 3
+    {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, // 4
+    {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}, // 5
+    {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, // 6
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // 7
+    {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, // 8
+    {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}, // 9
+    {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}, // :
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // ;
+    {0x01, 0x02, 0x04, 0x08, 0x04, 0x02, 0x01}, // <
+    {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00}, // =
+    {0x10, 0x08, 0x04, 0x02, 0x04, 0x08, 0x10}, // >
+    {0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}, // ?
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // @
+    {0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // A
+    {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}, // B
+    {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}, // C
+    {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}, // D
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}, // E
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}, // F
+    {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}, // G
+    {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // H
+    {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // I
+    {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}, // J
+    {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // K
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}, // L
+    {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}, // M
+    {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, // N
+    {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // O
+    {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}, // P
+    {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}, // Q
+    {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}, // R
+    {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}, // S
+    {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // T
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // U
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}, // V
+    {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}, // W
+    {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}, // X
+    {0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04}, // Y
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}, // Z
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // [
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // backslash
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // ]
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // ^
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F}, // _
+};
+
+// Atlas of 6x8 texel cells (a glyph and a blank column and row), 16 to a row; the cell after
+// the last glyph is solid
+constexpr int CELL_WIDTH = GLYPH_WIDTH + 1;
+constexpr int CELL_HEIGHT = GLYPH_HEIGHT + 1;
+constexpr int ATLAS_COLUMNS = 16;
+constexpr int SOLID_CELL = GLYPH_COUNT;
+constexpr int ATLAS_ROWS = (GLYPH_COUNT + 1 + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+constexpr int ATLAS_WIDTH = ATLAS_COLUMNS * CELL_WIDTH;
+constexpr int ATLAS_HEIGHT = ATLAS_ROWS * CELL_HEIGHT;
+
+constexpr uint32_t rgba(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+{
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+constexpr uint32_t TEXT_COLOR = rgba(230, 230, 230, 255);
+constexpr uint32_t PANEL_COLOR = rgba(0, 0, 0, 160);
+constexpr uint32_t GUIDE_COLOR = rgba(255, 255, 255, 90);
+constexpr uint32_t GPU_COLOR = rgba(90, 160, 255, 255);
+} // namespace
+
+PerformanceHud::PerformanceHud() : atlas(0), vao(0), instance_buffer(0), uniform_screen_size(-1), graph_next(0)
+{
+    quads.reserve(MAX_QUADS);
+}
+
+PerformanceHud::~PerformanceHud()
+{
+    if (atlas != 0)
+    {
+        glDeleteTextures(1, &atlas);
+    }
+    if (instance_buffer != 0)
+    {
+        glDeleteBuffers(1, &instance_buffer);
+    }
+    if (vao != 0)
+    {
+        glDeleteVertexArrays(1, &vao);
+    }
+    if (shader)
+    {
+        glDeleteProgram(shader->ID);
+    }
+}
+
+bool PerformanceHud::initialize()
+{
+    // Same search order as the voxel shaders
+    StartupCache cache;
+    for (const char *directory : {"shaders/", "voxel world/"})
+    {
+        shader = cache.loadShader("hud", std::string(directory) + "hud.vs", std::string(directory) + "hud.fs");
+        if (shader)
+        {
+            break;
+        }
+    }
+    if (!shader)
+    {
+        std::cerr << "Performance HUD: shaders not found" << std::endl;
+        return false;
+    }
+    uniform_screen_size = glGetUniformLocation(shader->ID, "screen_size");
+    shader->use();
+    glUniform1i(glGetUniformLocation(shader->ID, "glyphs"), HUD_TEXTURE_UNIT);
+
+    std::vector<uint8_t> texels(static_cast<size_t>(ATLAS_WIDTH) * ATLAS_HEIGHT, 0);
+    for (int glyph = 0; glyph <= GLYPH_COUNT; glyph++)
+    {
+        int cell_x = (glyph % ATLAS_COLUMNS) * CELL_WIDTH;
+        int cell_y = (glyph / ATLAS_COLUMNS) * CELL_HEIGHT;
+        for (int row = 0; row < CELL_HEIGHT; row++)
+        {
+            for (int column = 0; column < CELL_WIDTH; column++)
+            {
+                bool set = glyph == SOLID_CELL ||
+                           (row < GLYPH_HEIGHT && column < GLYPH_WIDTH &&
+                            (FONT_GLYPHS[glyph][row] >> (GLYPH_WIDTH - 1 - column)) & 1);
+                texels[static_cast<size_t>(cell_y + row) * ATLAS_WIDTH + cell_x + column] = set ? 255 : 0;
+            }
+        }
+    }
+    glGenTextures(1, &atlas);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Per-instance rectangle, atlas rectangle and color; the corners come from gl_VertexID
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &instance_buffer);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+    glBufferData(GL_ARRAY_BUFFER, MAX_QUADS * sizeof(Quad), nullptr, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Quad), reinterpret_cast<void *>(offsetof(Quad, x)));
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Quad), reinterpret_cast<void *>(offsetof(Quad, u0)));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Quad), reinterpret_cast<void *>(offsetof(Quad, color)));
+    for (GLuint attribute = 0; attribute < 3; attribute++)
+    {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void PerformanceHud::recordFrame(float cpu, float gpu)
+{
+    cpu_ms[graph_next] = cpu;
+    gpu_ms[graph_next] = gpu;
+    graph_next = (graph_next + 1) % GRAPH_FRAMES;
+}
+
+bool PerformanceHud::needsText() const
+{
+    return std::chrono::duration<float>(std::chrono::steady_clock::now() - text_updated_at).count() >= TEXT_REFRESH_SECONDS;
+}
+
+void PerformanceHud::setText(std::vector<std::string> text)
+{
+    lines = std::move(text);
+    text_updated_at = std::chrono::steady_clock::now();
+}
+
+void PerformanceHud::addRect(float x, float y, float width, float height, uint32_t color)
+{
+    if (quads.size() >= MAX_QUADS)
+    {
+        return;
+    }
+    // Inside the solid cell, clear of its edges
+    const float u = ((SOLID_CELL % ATLAS_COLUMNS) * CELL_WIDTH + CELL_WIDTH * 0.5f) / ATLAS_WIDTH;
+    const float v = ((SOLID_CELL / ATLAS_COLUMNS) * CELL_HEIGHT + CELL_HEIGHT * 0.5f) / ATLAS_HEIGHT;
+    quads.push_back({x, y, width, height, u, v, u, v, color});
+}
+
+void PerformanceHud::addText(float x, float y, const std::string &text, uint32_t color)
+{
+    const float advance = CELL_WIDTH * GLYPH_SCALE;
+    for (char character : text)
+    {
+        int code = (character >= 'a' && character <= 'z') ? character - 'a' + 'A' : character;
+        int glyph = code - FIRST_GLYPH;
+        if (glyph > 0 && glyph < GLYPH_COUNT && quads.size() < MAX_QUADS)
+        {
+            float u0 = static_cast<float>((glyph % ATLAS_COLUMNS) * CELL_WIDTH) / ATLAS_WIDTH;
+            float v0 = static_cast<float>((glyph / ATLAS_COLUMNS) * CELL_HEIGHT) / ATLAS_HEIGHT;
+            quads.push_back({x, y, GLYPH_WIDTH * GLYPH_SCALE, GLYPH_HEIGHT * GLYPH_SCALE, u0, v0,
+                             u0 + static_cast<float>(GLYPH_WIDTH) / ATLAS_WIDTH,
+                             v0 + static_cast<float>(GLYPH_HEIGHT) / ATLAS_HEIGHT, color});
+        }
+        x += advance; // Spaces and characters outside the font leave a gap
+    }
+}
+
+void PerformanceHud::render()
+{
+    if (!shader)
+    {
+        return;
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if (viewport[2] <= 0 || viewport[3] <= 0)
+    {
+        return;
+    }
+
+    // Panel: the text, then the graph with a line at 60 frames per second
+    const float padding = 6.0f;
+    const float line_height = (GLYPH_HEIGHT + 2) * GLYPH_SCALE;
+    const float bar_width = 2.0f;
+    size_t longest = 0;
+    for (const std::string &line : lines)
+    {
+        longest = std::max(longest, line.size());
+    }
+    const float text_width = static_cast<float>(longest * CELL_WIDTH * GLYPH_SCALE);
+    const float graph_width = GRAPH_FRAMES * bar_width;
+    const float left = SCREEN_MARGIN + padding;
+    const float top = SCREEN_MARGIN + padding;
+    const float graph_bottom = top + lines.size() * line_height + padding + GRAPH_HEIGHT;
+
+    quads.clear();
+    addRect(SCREEN_MARGIN, SCREEN_MARGIN, std::max(text_width, graph_width) + 2 * padding,
+            graph_bottom + padding - SCREEN_MARGIN, PANEL_COLOR);
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        addText(left, top + i * line_height, lines[i], TEXT_COLOR);
+    }
+
+    auto barHeight = [](float ms) { return std::min(ms, GRAPH_MAX_MS) / GRAPH_MAX_MS * GRAPH_HEIGHT; };
+    addRect(left, graph_bottom - barHeight(1000.0f / 60.0f), graph_width, 1.0f, GUIDE_COLOR);
+    for (int i = 0; i < GRAPH_FRAMES; i++)
+    {
+        int sample = (graph_next + i) % GRAPH_FRAMES; // Oldest on the left
+        float x = left + i * bar_width;
+        float cpu = cpu_ms[sample];
+        uint32_t color = cpu <= 1000.0f / 60.0f ? rgba(80, 200, 80, 220)
+                                                : (cpu <= 1000.0f / 30.0f ? rgba(230, 200, 60, 220) : rgba(230, 70, 60, 220));
+        float height = barHeight(cpu);
+        addRect(x, graph_bottom - height, bar_width, height, color);
+        if (gpu_ms[sample] > 0.0f)
+        {
+            addRect(x, graph_bottom - barHeight(gpu_ms[sample]) - 1.0f, bar_width, 2.0f, GPU_COLOR);
+        }
+    }
+
+    GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean face_culling = glIsEnabled(GL_CULL_FACE);
+    GLboolean blending = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    shader->use();
+    glUniform2f(uniform_screen_size, static_cast<float>(viewport[2]), static_cast<float>(viewport[3]));
+    glActiveTexture(GL_TEXTURE0 + HUD_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(quads.size() * sizeof(Quad)), quads.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(quads.size()));
+    glBindVertexArray(0);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    if (depth_test)
+        glEnable(GL_DEPTH_TEST);
+    if (face_culling)
+        glEnable(GL_CULL_FACE);
+    if (!blending)
+        glDisable(GL_BLEND);
+}
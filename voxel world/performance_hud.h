@@ -0,0 +1,77 @@
+#ifndef PERFORMANCE_HUD_H
+#define PERFORMANCE_HUD_H
+
+#include <glad/glad/glad.h>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Shader;
+
+// On-screen statistics in the top left corner: lines of text over a frame time graph.
+//
+// Everything is one instanced draw of screen rectangles: glyphs sample a fixed atlas of a
+// built-in 5x7 font (upper case; lower case draws as upper case), and the graph bars and
+// panel backgrounds sample its solid cell. The instance buffer is allocated once and
+// refilled with glBufferSubData each frame. The graph takes every frame; the text is only
+// rebuilt every TEXT_REFRESH_SECONDS so it stays readable (see needsText). Main thread only.
+class PerformanceHud
+{
+public:
+    static constexpr int GRAPH_FRAMES = 160;
+    static constexpr float GRAPH_MAX_MS = 33.3f;   // Top of the graph
+    static constexpr int GRAPH_HEIGHT = 64;        // Pixels
+    static constexpr int GLYPH_SCALE = 2;          // Screen pixels per font pixel
+    static constexpr int SCREEN_MARGIN = 16;       // Pixels to the window corner
+    static constexpr size_t MAX_QUADS = 4096;
+    static constexpr float TEXT_REFRESH_SECONDS = 0.25f;
+
+    PerformanceHud();
+    ~PerformanceHud();
+
+    PerformanceHud(const PerformanceHud &) = delete;
+    PerformanceHud &operator=(const PerformanceHud &) = delete;
+
+    // Load the shader, build the glyph atlas and allocate the instance buffer
+    bool initialize();
+
+    // One frame's CPU (update and render) and GPU time, for the graph
+    void recordFrame(float cpu_ms, float gpu_ms);
+    // True once the text is due again; setText then replaces it
+    bool needsText() const;
+    void setText(std::vector<std::string> lines);
+
+    // Main thread, over the finished frame
+    void render();
+
+private:
+    // One screen rectangle, in pixels from the top left, and what it samples
+    struct Quad
+    {
+        float x, y, width, height;
+        float u0, v0, u1, v1;
+        uint32_t color; // RGBA8
+    };
+
+    std::unique_ptr<Shader> shader;
+    GLuint atlas;
+    GLuint vao;
+    GLuint instance_buffer;
+    GLint uniform_screen_size;
+
+    std::array<float, GRAPH_FRAMES> cpu_ms{};
+    std::array<float, GRAPH_FRAMES> gpu_ms{};
+    int graph_next; // Oldest sample, the next one overwritten
+    std::vector<std::string> lines;
+    std::chrono::steady_clock::time_point text_updated_at;
+    std::vector<Quad> quads; // Rebuilt every frame
+
+    void addRect(float x, float y, float width, float height, uint32_t color);
+    void addText(float x, float y, const std::string &text, uint32_t color);
+};
+
+#endif // PERFORMANCE_HUD_H
@@ -0,0 +1,186 @@
+#include "profiler.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+struct ProfileEvent
+{
+    const char *name;
+    uint64_t start_ns;
+    uint64_t end_ns;
+};
+
+// Written only by its owning thread; head counts every event ever recorded
+struct ThreadBuffer
+{
+    std::array<ProfileEvent, Profiler::EVENTS_PER_THREAD> events;
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> cleared_at{0}; // Events before this index were cleared
+    uint32_t thread_id = 0;
+    std::string thread_name; // Guarded by the registry mutex
+};
+
+// Buffers are never freed: a trace can be written after the threads that filled them exited
+struct BufferRegistry
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+BufferRegistry &getRegistry()
+{
+    static BufferRegistry registry;
+    return registry;
+}
+
+const std::chrono::steady_clock::time_point clock_start = std::chrono::steady_clock::now();
+
+ThreadBuffer &getThreadBuffer()
+{
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (!buffer)
+    {
+        // Only the first event of each thread registers, everything after is lock-free
+        BufferRegistry &registry = getRegistry();
+        std::unique_lock<std::mutex> lock(registry.mutex);
+        registry.buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = registry.buffers.back().get();
+        buffer->thread_id = static_cast<uint32_t>(registry.buffers.size());
+        buffer->thread_name = "Thread " + std::to_string(buffer->thread_id);
+    }
+    return *buffer;
+}
+
+// Nanoseconds as microseconds with three decimals, without float rounding on long captures
+void writeMicroseconds(std::ostream &out, uint64_t ns)
+{
+    uint64_t fraction = ns % 1000;
+    out << ns / 1000 << '.' << (fraction < 100 ? "0" : "") << (fraction < 10 ? "0" : "") << fraction;
+}
+
+void writeEscaped(std::ostream &out, const std::string &text)
+{
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out << '\\' << c;
+        }
+        else if (static_cast<unsigned char>(c) >= 0x20)
+        {
+            out << c;
+        }
+    }
+}
+}
+
+std::atomic<bool> Profiler::capture_enabled{false};
+
+void Profiler::setThreadName(const std::string &name)
+{
+    ThreadBuffer &buffer = getThreadBuffer();
+    std::unique_lock<std::mutex> lock(getRegistry().mutex);
+    buffer.thread_name = name;
+}
+
+uint64_t Profiler::now()
+{
+    // Offset by one so a valid timestamp is never 0 (ProfileZone's "not capturing" marker)
+    return static_cast<uint64_t>(
+               std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - clock_start).count()) +
+           1;
+}
+
+void Profiler::record(const char *name, uint64_t start_ns, uint64_t end_ns)
+{
+    ThreadBuffer &buffer = getThreadBuffer();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head & (EVENTS_PER_THREAD - 1)] = ProfileEvent{name, start_ns, end_ns};
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+bool Profiler::writeChromeTrace(const std::string &path, uint64_t since_ns)
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+    {
+        std::cerr << "Profiler: failed to open " << path << std::endl;
+        return false;
+    }
+
+    BufferRegistry &registry = getRegistry();
+    std::unique_lock<std::mutex> lock(registry.mutex);
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    size_t event_count = 0;
+    std::vector<ProfileEvent> events;
+    for (const auto &buffer : registry.buffers)
+    {
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread_id
+            << ",\"args\":{\"name\":\"";
+        writeEscaped(out, buffer->thread_name);
+        out << "\"}}";
+        first = false;
+
+        // Copy the live window, then drop whatever the owner overwrote while we copied
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t begin = std::max(head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0,
+                                  buffer->cleared_at.load(std::memory_order_relaxed));
+        events.clear();
+        for (uint64_t i = begin; i < head; i++)
+        {
+            events.push_back(buffer->events[i & (EVENTS_PER_THREAD - 1)]);
+        }
+        uint64_t head_after = buffer->head.load(std::memory_order_acquire);
+        uint64_t valid_from = head_after > EVENTS_PER_THREAD ? head_after - EVENTS_PER_THREAD : 0;
+        size_t overwritten = valid_from > begin ? static_cast<size_t>(std::min<uint64_t>(valid_from - begin, events.size())) : 0;
+
+        for (size_t i = overwritten; i < events.size(); i++)
+        {
+            const ProfileEvent &event = events[i];
+            if (event.end_ns < since_ns)
+            {
+                continue;
+            }
+            event_count++;
+
+            // Complete events; Chrome expects microseconds
+            out << ",\n{\"name\":\"";
+            writeEscaped(out, event.name);
+            out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_id << ",\"ts\":";
+            writeMicroseconds(out, event.start_ns);
+            out << ",\"dur\":";
+            writeMicroseconds(out, event.end_ns - event.start_ns);
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+
+    if (!out)
+    {
+        std::cerr << "Profiler: failed to write " << path << std::endl;
+        return false;
+    }
+    std::cout << "Profiler: wrote " << event_count << " events from " << registry.buffers.size() << " threads to " << path
+              << std::endl;
+    return true;
+}
+
+void Profiler::clear()
+{
+    BufferRegistry &registry = getRegistry();
+    std::unique_lock<std::mutex> lock(registry.mutex);
+    for (const auto &buffer : registry.buffers)
+    {
+        // The owner keeps writing at its head; later dumps just start from here
+        buffer->cleared_at.store(buffer->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
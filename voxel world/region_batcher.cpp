@@ -0,0 +1,330 @@
+#include "region_batcher.h"
+#include "render_backend.h"
+#include "voxel_chunk.h"
+#include <algorithm>
+
+RegionBatcher::~RegionBatcher()
+{
+    clear();
+}
+
+glm::ivec2 RegionBatcher::getRegion(const glm::ivec3 &chunk_pos)
+{
+    auto floorDiv = [](int value)
+    { return (value >= 0 ? value : value - (REGION_COLUMNS - 1)) / REGION_COLUMNS; };
+    return glm::ivec2(floorDiv(chunk_pos.x), floorDiv(chunk_pos.z));
+}
+
+bool RegionBatcher::isBatchable(const VoxelChunk &chunk)
+{
+    // Own buffers with corners (records are fetched by vertex id and cannot be moved)
+    const ChunkMesh *mesh = chunk.mesh.get();
+    return mesh && mesh->isUploaded() && mesh->geometry != 0 && !mesh->isInArena() && mesh->format == MeshFormat::Indexed;
+}
+
+void RegionBatcher::setMembers(const std::vector<std::pair<glm::ivec3, VoxelChunk *>> &chunks)
+{
+    std::unordered_map<glm::ivec2, std::vector<Member>, IVec2Hash> grouped;
+    for (const auto &[chunk_pos, chunk] : chunks)
+    {
+        if (isBatchable(*chunk))
+        {
+            grouped[getRegion(chunk_pos)].push_back({chunk_pos, chunk});
+        }
+    }
+
+    Clock::time_point now = Clock::now();
+    for (auto it = regions.begin(); it != regions.end();)
+    {
+        if (grouped.find(it->first) == grouped.end())
+        {
+            releaseBuffers(it->second);
+            it = regions.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    for (auto &[key, members] : grouped)
+    {
+        // Map order shifts as chunks come and go; by position it only changes with the members
+        std::sort(members.begin(), members.end(), [](const Member &a, const Member &b)
+                  { return std::tie(a.position.x, a.position.y, a.position.z) < std::tie(b.position.x, b.position.y, b.position.z); });
+        Region &region = regions[key];
+        if (region.members != members)
+        {
+            region.members = std::move(members);
+            region.packed = false;
+            region.last_change = now;
+        }
+    }
+}
+
+void RegionBatcher::markChanged(const glm::ivec3 &chunk_pos)
+{
+    auto it = regions.find(getRegion(chunk_pos));
+    if (it != regions.end())
+    {
+        it->second.packed = false;
+        it->second.last_change = Clock::now();
+    }
+}
+
+size_t RegionBatcher::update(size_t max_packs)
+{
+    Clock::time_point now = Clock::now();
+    size_t packed = 0;
+    for (auto &[key, region] : regions)
+    {
+        if (packed >= max_packs)
+        {
+            break;
+        }
+        if (!region.packed && std::chrono::duration<float>(now - region.last_change).count() >= REGION_SETTLE_SECONDS)
+        {
+            pack(key, region);
+            packed++;
+        }
+    }
+    return packed;
+}
+
+void RegionBatcher::pack(const glm::ivec2 &key, Region &region)
+{
+    // Layout: the opaque then the cutout range, each by face direction, with the members in
+    // the same order inside every bucket
+    region.direction_counts = {};
+    region.min_chunk_y = region.members.front().position.y;
+    region.max_chunk_y = region.min_chunk_y;
+    for (const Member &member : region.members)
+    {
+        region.min_chunk_y = std::min(region.min_chunk_y, member.position.y);
+        region.max_chunk_y = std::max(region.max_chunk_y, member.position.y);
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (int face = 0; face < 6; face++)
+            {
+                region.direction_counts[pass][face] += member.chunk->mesh->direction_counts[pass][face];
+            }
+        }
+    }
+
+    std::array<std::array<size_t, 6>, 2> cursor{}; // Next vertex of each bucket
+    size_t total_vertices = 0;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int face = 0; face < 6; face++)
+        {
+            cursor[pass][face] = total_vertices;
+            total_vertices += region.direction_counts[pass][face] / 6 * 4;
+        }
+    }
+    region.packed = true;
+    if (total_vertices == 0)
+    {
+        releaseBuffers(region); // Translucent geometry only: nothing drawn by the region
+        return;
+    }
+
+    RenderBackend &backend = RenderBackend::get();
+    if (region.geometry == 0)
+    {
+        region.vertex_buffer = backend.createBuffer();
+        region.offset_buffer = backend.createBuffer();
+    }
+    size_t bytes = total_vertices * (sizeof(VoxelVertex) + 4);
+    gpu_bytes += bytes - region.buffer_bytes;
+    region.buffer_bytes = bytes;
+
+    // Members' ranges are copied buffer to buffer; only the offsets come from here
+    std::vector<uint8_t> offsets(total_vertices * 4, 0);
+    backend.writeBuffer(region.vertex_buffer, nullptr, total_vertices * sizeof(VoxelVertex));
+    for (const Member &member : region.members)
+    {
+        const ChunkMesh &mesh = *member.chunk->mesh;
+        const uint8_t offset[3] = {static_cast<uint8_t>(member.position.x - key.x * REGION_COLUMNS),
+                                   static_cast<uint8_t>(member.position.y - region.min_chunk_y),
+                                   static_cast<uint8_t>(member.position.z - key.y * REGION_COLUMNS)};
+        size_t source = 0; // The mesh's vertices follow the same pass and direction order
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (int face = 0; face < 6; face++)
+            {
+                size_t count = mesh.direction_counts[pass][face] / 6 * 4;
+                if (count == 0)
+                {
+                    continue;
+                }
+                size_t &target = cursor[pass][face];
+                backend.copyBuffer(mesh.vertex_buffer, source * sizeof(VoxelVertex), region.vertex_buffer,
+                                   target * sizeof(VoxelVertex), count * sizeof(VoxelVertex));
+                for (size_t vertex = target; vertex < target + count; vertex++)
+                {
+                    std::copy(offset, offset + 3, offsets.begin() + vertex * 4);
+                }
+                target += count;
+                source += count;
+            }
+        }
+    }
+    backend.writeBuffer(region.offset_buffer, offsets.data(), offsets.size());
+    if (region.geometry == 0)
+    {
+        region.geometry = backend.createGeometry(region.vertex_buffer, MeshFormat::Indexed, region.offset_buffer);
+    }
+}
+
+void RegionBatcher::beginFrame()
+{
+    for (const Region *region : visible_regions)
+    {
+        const_cast<Region *>(region)->visible = false;
+    }
+    visible_regions.clear();
+}
+
+bool RegionBatcher::claim(const glm::ivec3 &chunk_pos)
+{
+    auto it = regions.find(getRegion(chunk_pos));
+    if (it == regions.end() || !it->second.packed)
+    {
+        return false;
+    }
+    // Members are exactly the batchable drawable chunks, so a packed region holds this one
+    // unless it is drawn per chunk anyway (Faces format or arena)
+    Region &region = it->second;
+    if (!std::binary_search(region.members.begin(), region.members.end(), Member{chunk_pos, nullptr},
+                            [](const Member &a, const Member &b)
+                            { return std::tie(a.position.x, a.position.y, a.position.z) < std::tie(b.position.x, b.position.y, b.position.z); }))
+    {
+        return false;
+    }
+    if (!region.visible)
+    {
+        region.visible = true;
+        visible_regions.push_back(&region);
+    }
+    return true;
+}
+
+size_t RegionBatcher::draw(MeshPass pass, const glm::vec3 &camera_position, bool direction_culling) const
+{
+    if (pass == MeshPass::Translucent)
+    {
+        return 0;
+    }
+
+    RenderBackend &backend = RenderBackend::get();
+    size_t submitted = 0;
+    for (const Region *region : visible_regions)
+    {
+        if (region->geometry == 0)
+        {
+            continue;
+        }
+        glm::ivec2 key = getRegion(region->members.front().position);
+        glm::vec3 origin(key.x * REGION_COLUMNS * CHUNK_SIZE, region->min_chunk_y * CHUNK_HEIGHT, key.y * REGION_COLUMNS * CHUNK_SIZE);
+
+        // Same planes as ChunkMesh::getFacingDirections, around the whole region
+        uint8_t directions = ALL_FACE_DIRECTIONS;
+        if (direction_culling)
+        {
+            glm::vec3 local = camera_position - origin;
+            const glm::vec3 bounds_max(REGION_COLUMNS * CHUNK_SIZE - 0.5f,
+                                       (region->max_chunk_y - region->min_chunk_y + 1) * CHUNK_HEIGHT - 0.5f,
+                                       REGION_COLUMNS * CHUNK_SIZE - 0.5f);
+            directions = 0;
+            if (local.z > -0.5f)
+                directions |= 1 << FACE_FRONT;
+            if (local.z < bounds_max.z)
+                directions |= 1 << FACE_BACK;
+            if (local.x > -0.5f)
+                directions |= 1 << FACE_RIGHT;
+            if (local.x < bounds_max.x)
+                directions |= 1 << FACE_LEFT;
+            if (local.y > -0.5f)
+                directions |= 1 << FACE_TOP;
+            if (local.y < bounds_max.y)
+                directions |= 1 << FACE_BOTTOM;
+        }
+
+        backend.setDrawOrigin(origin);
+
+        // The cutout range follows the opaque one; selected neighbouring buckets form one run
+        size_t cursor = 0;
+        if (pass == MeshPass::Cutout)
+        {
+            for (uint32_t count : region->direction_counts[0])
+            {
+                cursor += count / 6;
+            }
+        }
+        std::array<RenderBackend::QuadRun, 6> runs;
+        size_t run_total = 0;
+        size_t run_start = cursor;
+        size_t run_count = 0;
+        for (int face = 0; face < 6; face++)
+        {
+            size_t quads = region->direction_counts[static_cast<int>(pass)][face] / 6;
+            if ((directions >> face) & 1)
+            {
+                if (run_count == 0)
+                {
+                    run_start = cursor;
+                }
+                run_count += quads;
+            }
+            else if (run_count > 0)
+            {
+                runs[run_total++] = {run_start, run_count};
+                submitted += run_count * 6;
+                run_count = 0;
+            }
+            cursor += quads;
+        }
+        if (run_count > 0)
+        {
+            runs[run_total++] = {run_start, run_count};
+            submitted += run_count * 6;
+        }
+        backend.drawGeometry(region->geometry, runs.data(), run_total, ChunkMesh::getViewCount());
+    }
+    return submitted;
+}
+
+void RegionBatcher::clear()
+{
+    for (auto &[key, region] : regions)
+    {
+        releaseBuffers(region);
+    }
+    regions.clear();
+    visible_regions.clear();
+}
+
+size_t RegionBatcher::getPackedRegionCount() const
+{
+    size_t packed = 0;
+    for (const auto &[key, region] : regions)
+    {
+        packed += region.packed && region.geometry != 0;
+    }
+    return packed;
+}
+
+void RegionBatcher::releaseBuffers(Region &region)
+{
+    if (region.geometry != 0)
+    {
+        RenderBackend &backend = RenderBackend::get();
+        backend.destroyGeometry(region.geometry);
+        backend.destroyBuffer(region.vertex_buffer);
+        backend.destroyBuffer(region.offset_buffer);
+        region.geometry = 0;
+        region.vertex_buffer = 0;
+        region.offset_buffer = 0;
+    }
+    gpu_bytes -= region.buffer_bytes;
+    region.buffer_bytes = 0;
+}
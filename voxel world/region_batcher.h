@@ -0,0 +1,111 @@
+#ifndef REGION_BATCHER_H
+#define REGION_BATCHER_H
+
+#include "chunk_mesh.h"
+#include <glm/glm/glm.hpp>
+#include <glad/glad/glad.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class VoxelChunk;
+
+// Region batching for the per-chunk draw path (no multi-draw arena, GL < 4.3), where every
+// visible chunk otherwise costs a draw call and a state change per pass.
+//
+// The meshes of REGION_COLUMNS x REGION_COLUMNS chunk columns are packed into one vertex
+// buffer per region, laid out by pass and face direction, and drawn as one call per direction
+// run and pass. A second vertex attribute (location 2) gives every vertex its chunk's offset
+// from the region origin, in chunks. Packing copies the members' own buffers on the GPU; those
+// stay allocated, so a split region draws from them again at once.
+//
+// Repacking is lazy. A member's mesh upload or a change of members splits the region back
+// into per-chunk draws at once, and it is only packed again REGION_SETTLE_SECONDS after its
+// last change. Regions being edited or streamed in therefore stay split and cost no repacks.
+//
+// A packed region draws all its members whenever one of them is visible. Translucent ranges
+// stay per chunk, back to front, and MeshFormat::Faces meshes are never batched.
+// Main thread only.
+class RegionBatcher
+{
+public:
+    static constexpr int REGION_COLUMNS = 4;
+    static constexpr float REGION_SETTLE_SECONDS = 2.0f;
+
+    RegionBatcher() = default;
+    ~RegionBatcher();
+
+    RegionBatcher(const RegionBatcher &) = delete;
+    RegionBatcher &operator=(const RegionBatcher &) = delete;
+
+    // The drawable chunks as VoxelRenderer culls them; regions whose members changed split
+    void setMembers(const std::vector<std::pair<glm::ivec3, VoxelChunk *>> &chunks);
+    // The chunk's mesh was replaced (uploaded again or emptied): its region splits
+    void markChanged(const glm::ivec3 &chunk_pos);
+    // Pack up to max_packs regions that have settled; returns the number packed
+    size_t update(size_t max_packs);
+
+    // Each frame: beginFrame, claim every visible chunk (true if its region draws it instead),
+    // then draw the opaque and cutout passes of the claimed regions
+    void beginFrame();
+    bool claim(const glm::ivec3 &chunk_pos);
+    // Returns the indices submitted; directions are culled against the region bounds
+    size_t draw(MeshPass pass, const glm::vec3 &camera_position, bool direction_culling) const;
+
+    void clear();
+    size_t getRegionCount() const { return regions.size(); }
+    size_t getPackedRegionCount() const;
+    size_t getGpuBytes() const { return gpu_bytes; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Member
+    {
+        glm::ivec3 position;
+        VoxelChunk *chunk;
+
+        bool operator==(const Member &other) const { return position == other.position && chunk == other.chunk; }
+    };
+
+    struct Region
+    {
+        std::vector<Member> members; // By position
+        bool packed = false;
+        bool visible = false;
+        Clock::time_point last_change;
+        int min_chunk_y = 0;
+        int max_chunk_y = 0;
+
+        RenderBackend::Geometry geometry = 0;
+        RenderBackend::Buffer vertex_buffer = 0;
+        RenderBackend::Buffer offset_buffer = 0; // Four bytes per vertex: chunk offset x, y, z from the region origin
+        size_t buffer_bytes = 0;  // Both buffers
+        std::array<std::array<uint32_t, 6>, 2> direction_counts{}; // [Opaque, Cutout][FaceDirection] indices
+    };
+
+    struct IVec2Hash
+    {
+        std::size_t operator()(const glm::ivec2 &v) const
+        {
+            uint64_t h = static_cast<uint64_t>(static_cast<uint32_t>(v.x)) * 0x9E3779B185EBCA87ull;
+            h ^= static_cast<uint64_t>(static_cast<uint32_t>(v.y)) * 0xC2B2AE3D27D4EB4Full;
+            h ^= h >> 29;
+            return static_cast<std::size_t>(h);
+        }
+    };
+
+    std::unordered_map<glm::ivec2, Region, IVec2Hash> regions;
+    std::vector<const Region *> visible_regions;
+    size_t gpu_bytes = 0;
+
+    static glm::ivec2 getRegion(const glm::ivec3 &chunk_pos);
+    static bool isBatchable(const VoxelChunk &chunk);
+    void pack(const glm::ivec2 &key, Region &region);
+    void releaseBuffers(Region &region);
+};
+
+#endif // REGION_BATCHER_H
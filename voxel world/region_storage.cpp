@@ -0,0 +1,508 @@
+#include "region_storage.h"
+#include "palette_storage.h"
+#include "job_system.h"
+#include "file_mapping.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+struct RegionHeader
+{
+    uint32_t magic;
+    uint32_t reserved;
+};
+}
+
+RegionStorage::RegionStorage(std::string directory, JobSystem &job_system)
+    : directory(std::move(directory)), job_system(job_system)
+{
+}
+
+RegionStorage::~RegionStorage()
+{
+    flush();
+}
+
+size_t RegionStorage::getTableSize()
+{
+    return static_cast<size_t>(REGION_SIZE) * REGION_SIZE * REGION_LAYERS;
+}
+
+size_t RegionStorage::getHeaderSectors()
+{
+    size_t header_bytes = sizeof(RegionHeader) + getTableSize() * sizeof(TableEntry);
+    return (header_bytes + SECTOR_SIZE - 1) / SECTOR_SIZE;
+}
+
+glm::ivec3 RegionStorage::getRegionCoord(const glm::ivec3 &chunk_pos)
+{
+    // Floor division for negative coordinates
+    auto region = [](int c, int size)
+    { return c >= 0 ? c / size : (c + 1) / size - 1; };
+    return glm::ivec3(region(chunk_pos.x, REGION_SIZE), region(chunk_pos.y, REGION_LAYERS), region(chunk_pos.z, REGION_SIZE));
+}
+
+size_t RegionStorage::getTableIndex(const glm::ivec3 &chunk_pos)
+{
+    glm::ivec3 local = chunk_pos - getRegionCoord(chunk_pos) * glm::ivec3(REGION_SIZE, REGION_LAYERS, REGION_SIZE);
+    return (static_cast<size_t>(local.x) * REGION_SIZE + local.z) * REGION_LAYERS + static_cast<size_t>(local.y);
+}
+
+std::string RegionStorage::getRegionPath(const glm::ivec3 &region) const
+{
+    // The layers 0..REGION_LAYERS-1 keep the name they had when they were the whole world
+    std::string name = "r." + std::to_string(region.x) + "." + std::to_string(region.z);
+    if (region.y != 0)
+    {
+        name += "." + std::to_string(region.y);
+    }
+    return directory + name + ".vxr";
+}
+
+bool RegionStorage::store(const glm::ivec3 &chunk_pos, const PaletteStorage &voxels)
+{
+    // The copy shares the chunk's words until its next edit, far cheaper than encoding,
+    // which the writer does
+    return queue(chunk_pos, PendingChunk{std::make_shared<const PaletteStorage>(voxels), nullptr, false});
+}
+
+bool RegionStorage::queue(const glm::ivec3 &chunk_pos, PendingChunk chunk)
+{
+    bool inline_write = job_system.isStopping(); // Nothing would run a job any more
+    {
+        std::unique_lock<std::mutex> lock(pending_mutex);
+        pending[chunk_pos] = std::move(chunk);
+        if (writer_scheduled)
+        {
+            return true; // The running writer picks it up in its next batch
+        }
+        writer_scheduled = true;
+    }
+
+    if (inline_write)
+    {
+        writePending();
+    }
+    else
+    {
+        job_system.submit([this]
+                          { writePending(); },
+                          JobPriority::Low);
+    }
+    return true;
+}
+
+bool RegionStorage::storeBlob(const glm::ivec3 &chunk_pos, std::vector<unsigned char> blob)
+{
+    if (blob.empty() || blob.size() > MAX_BLOB_SIZE)
+    {
+        return false;
+    }
+    return queue(chunk_pos, PendingChunk{nullptr, std::make_shared<const std::vector<unsigned char>>(std::move(blob)), false});
+}
+
+bool RegionStorage::load(const glm::ivec3 &chunk_pos, PaletteStorage &voxels)
+{
+
+    // Unwritten copies first: they are newer than anything on disk
+    Snapshot snapshot;
+    {
+        std::unique_lock<std::mutex> lock(pending_mutex);
+        auto it = pending.find(chunk_pos);
+        if (it != pending.end())
+        {
+            snapshot = it->second.voxels;
+        }
+    }
+    if (snapshot)
+    {
+        voxels = *snapshot;
+        return true;
+    }
+
+    std::shared_ptr<const FileMapping> mapping;
+    const unsigned char *payload = nullptr;
+    size_t payload_size = 0;
+    thread_local std::vector<unsigned char> data;
+    if (!findSaved(chunk_pos, mapping, payload, payload_size, data))
+    {
+        return false;
+    }
+
+    if (!voxels.decodeRuns(payload, payload_size))
+    {
+        std::cerr << "Region storage: corrupt chunk (" << chunk_pos.x << ", " << chunk_pos.y << ", "
+                  << chunk_pos.z << "), regenerating it" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool RegionStorage::contains(const glm::ivec3 &chunk_pos)
+{
+    {
+        std::unique_lock<std::mutex> lock(pending_mutex);
+        if (pending.count(chunk_pos) != 0)
+        {
+            return true;
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(file_mutex);
+    Region &region = openRegion(getRegionCoord(chunk_pos));
+    return region.table[getTableIndex(chunk_pos)].sector != 0 && region.file.is_open();
+}
+
+bool RegionStorage::loadBlob(const glm::ivec3 &chunk_pos, std::vector<unsigned char> &blob)
+{
+    {
+        std::unique_lock<std::mutex> lock(pending_mutex);
+        auto it = pending.find(chunk_pos);
+        if (it != pending.end() && it->second.blob)
+        {
+            blob = *it->second.blob;
+            return true;
+        }
+    }
+
+    std::shared_ptr<const FileMapping> mapping;
+    const unsigned char *payload = nullptr;
+    size_t payload_size = 0;
+    thread_local std::vector<unsigned char> data;
+    if (!findSaved(chunk_pos, mapping, payload, payload_size, data))
+    {
+        return false;
+    }
+    blob.assign(payload, payload + payload_size);
+    return true;
+}
+
+bool RegionStorage::findSaved(const glm::ivec3 &chunk_pos, std::shared_ptr<const FileMapping> &mapping,
+                              const unsigned char *&payload, size_t &payload_size, std::vector<unsigned char> &data)
+{
+    // Only the table lookup and a possible remap happen under the lock
+    std::unique_lock<std::mutex> lock(file_mutex);
+    Region &region = openRegion(getRegionCoord(chunk_pos));
+    TableEntry entry = region.table[getTableIndex(chunk_pos)];
+    if (entry.sector == 0 || !region.file.is_open())
+    {
+        return false;
+    }
+
+    size_t offset = static_cast<size_t>(entry.sector) * SECTOR_SIZE;
+    if (!region.mapping || region.mapping->size < offset + entry.size)
+    {
+        region.mapping = std::make_shared<const FileMapping>(getRegionPath(getRegionCoord(chunk_pos)));
+    }
+
+    if (region.mapping->size >= offset + entry.size)
+    {
+        mapping = region.mapping;
+        payload = mapping->data + offset;
+        payload_size = entry.size;
+    }
+    else if (readChunk(region, entry, data)) // Mapping unavailable
+    {
+        payload = data.data();
+        payload_size = data.size();
+    }
+    else
+    {
+        std::cerr << "Region storage: failed to read chunk (" << chunk_pos.x << ", " << chunk_pos.y << ", "
+                  << chunk_pos.z << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool RegionStorage::readChunk(Region &region, const TableEntry &entry, std::vector<unsigned char> &data)
+{
+    data.resize(entry.size);
+    region.file.clear();
+    region.file.seekg(static_cast<std::streamoff>(entry.sector) * SECTOR_SIZE);
+    return static_cast<bool>(region.file.read(reinterpret_cast<char *>(data.data()),
+                                              static_cast<std::streamsize>(data.size())));
+}
+
+void RegionStorage::flush()
+{
+    std::unique_lock<std::mutex> lock(pending_mutex);
+    writer_idle.wait(lock, [this]
+                     { return !writer_scheduled; });
+}
+
+size_t RegionStorage::getPendingWriteCount()
+{
+    std::unique_lock<std::mutex> lock(pending_mutex);
+    return pending.size();
+}
+
+RegionStorage::Region &RegionStorage::openRegion(const glm::ivec3 &coord)
+{
+    auto it = regions.find(coord);
+    if (it != regions.end())
+    {
+        return *it->second;
+    }
+
+    // Regions are only touched around the player, so dropping them all is rare and cheap
+    if (regions.size() >= MAX_OPEN_REGIONS)
+    {
+        regions.clear();
+    }
+
+    auto region = std::make_unique<Region>();
+    region->table.assign(getTableSize(), TableEntry{0, 0});
+    region->used_sectors.assign(getHeaderSectors(), true);
+
+    std::string path = getRegionPath(coord);
+    region->file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (region->file.is_open())
+    {
+        RegionHeader header{};
+        bool valid = region->file.read(reinterpret_cast<char *>(&header), sizeof(header)) &&
+                     header.magic == REGION_MAGIC &&
+                     region->file.read(reinterpret_cast<char *>(region->table.data()),
+                                       static_cast<std::streamsize>(region->table.size() * sizeof(TableEntry)));
+        if (!valid)
+        {
+            // Recreated on the next write; the chunks it held regenerate
+            std::cerr << "Region storage: ignoring unreadable region file " << path << std::endl;
+            region->file.close();
+            region->table.assign(getTableSize(), TableEntry{0, 0});
+        }
+    }
+
+    for (TableEntry &entry : region->table)
+    {
+        if (entry.sector == 0)
+        {
+            continue;
+        }
+        if (entry.sector < getHeaderSectors() || entry.size == 0 || entry.size > MAX_BLOB_SIZE)
+        {
+            entry = TableEntry{0, 0}; // Damaged entry; that chunk regenerates
+            continue;
+        }
+        size_t end = entry.sector + (entry.size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        if (region->used_sectors.size() < end)
+        {
+            region->used_sectors.resize(end, false);
+        }
+        std::fill(region->used_sectors.begin() + entry.sector, region->used_sectors.begin() + end, true);
+    }
+
+    return *regions.emplace(coord, std::move(region)).first->second;
+}
+
+bool RegionStorage::createRegionFile(const glm::ivec3 &coord, Region &region)
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    std::string path = getRegionPath(coord);
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        RegionHeader header{REGION_MAGIC, 0};
+        std::vector<char> header_sectors(getHeaderSectors() * SECTOR_SIZE, 0);
+        std::copy(reinterpret_cast<const char *>(&header), reinterpret_cast<const char *>(&header) + sizeof(header),
+                  header_sectors.begin());
+        if (!file || !file.write(header_sectors.data(), static_cast<std::streamsize>(header_sectors.size())))
+        {
+            std::cerr << "Region storage: failed to create " << path << std::endl;
+            return false;
+        }
+    }
+
+    region.file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    return region.file.is_open();
+}
+
+uint32_t RegionStorage::allocateSectors(Region &region, uint32_t count)
+{
+    // First fit; a run reaching the end of the file may extend past it
+    std::vector<bool> &used = region.used_sectors;
+    size_t run_start = used.size();
+    size_t run_length = 0;
+    for (size_t i = getHeaderSectors(); i < used.size(); i++)
+    {
+        if (used[i])
+        {
+            run_length = 0;
+            continue;
+        }
+        if (run_length++ == 0)
+        {
+            run_start = i;
+        }
+        if (run_length == count)
+        {
+            break;
+        }
+    }
+    if (run_length < count && run_start + run_length != used.size())
+    {
+        run_start = used.size();
+    }
+
+    if (used.size() < run_start + count)
+    {
+        used.resize(run_start + count, false);
+    }
+    std::fill(used.begin() + run_start, used.begin() + run_start + count, true);
+    return static_cast<uint32_t>(run_start);
+}
+
+void RegionStorage::writePending()
+{
+    struct Write
+    {
+        glm::ivec3 region;
+        glm::ivec3 position;
+        Snapshot voxels;
+        Blob saved_blob;
+        std::vector<unsigned char> blob;
+        bool written = false;
+    };
+    std::vector<Write> batch;
+
+    while (true)
+    {
+        batch.clear();
+        {
+            std::unique_lock<std::mutex> lock(pending_mutex);
+            for (const auto &[position, chunk] : pending)
+            {
+                if (!chunk.attempted)
+                {
+                    batch.push_back({getRegionCoord(position), position, chunk.voxels, chunk.blob, {}, false});
+                }
+            }
+            if (batch.empty())
+            {
+                writer_scheduled = false;
+                writer_idle.notify_all();
+                return;
+            }
+        }
+
+        // Encoded before taking the file lock, so loads never wait on it
+        for (Write &write : batch)
+        {
+            if (write.voxels)
+            {
+                write.voxels->encodeRuns(write.blob);
+            }
+            else
+            {
+                write.blob = *write.saved_blob;
+            }
+        }
+        std::sort(batch.begin(), batch.end(), [](const Write &a, const Write &b)
+                  {
+                      if (a.region.x != b.region.x)
+                      {
+                          return a.region.x < b.region.x;
+                      }
+                      return a.region.z != b.region.z ? a.region.z < b.region.z : a.region.y < b.region.y;
+                  });
+
+        {
+            std::unique_lock<std::mutex> file_lock(file_mutex);
+            for (size_t first = 0, last = 0; first < batch.size(); first = last)
+            {
+                glm::ivec3 coord = batch[first].region;
+                while (last < batch.size() && batch[last].region == coord)
+                {
+                    last++;
+                }
+
+                // One flush per region and batch; each chunk's data goes out ahead of its
+                // table entry
+                Region &region = openRegion(coord);
+                bool ok = region.file.is_open() || createRegionFile(coord, region);
+                for (size_t i = first; ok && i < last; i++)
+                {
+                    ok = writeChunk(region, batch[i].position, batch[i].blob);
+                    batch[i].written = ok;
+                }
+                if (ok && region.file.flush())
+                {
+                    continue;
+                }
+
+                std::cerr << "Region storage: failed to write " << (last - first) << " chunks to "
+                          << getRegionPath(coord) << std::endl;
+                for (size_t i = first; i < last; i++)
+                {
+                    batch[i].written = false;
+                }
+                regions.erase(coord); // Sector bookkeeping is reread from the file next time
+            }
+        }
+
+        // Copies replaced by a newer store meanwhile stay for the next batch
+        std::unique_lock<std::mutex> lock(pending_mutex);
+        for (const Write &write : batch)
+        {
+            auto it = pending.find(write.position);
+            if (it == pending.end() || it->second.voxels != write.voxels || it->second.blob != write.saved_blob)
+            {
+                continue;
+            }
+            if (write.written)
+            {
+                pending.erase(it);
+            }
+            else
+            {
+                it->second.attempted = true;
+            }
+        }
+    }
+}
+
+bool RegionStorage::writeChunk(Region &region, const glm::ivec3 &chunk_pos, const std::vector<unsigned char> &blob)
+{
+    TableEntry &entry = region.table[getTableIndex(chunk_pos)];
+    uint32_t sectors = static_cast<uint32_t>((blob.size() + SECTOR_SIZE - 1) / SECTOR_SIZE);
+    uint32_t old_sectors = static_cast<uint32_t>((entry.size + SECTOR_SIZE - 1) / SECTOR_SIZE);
+
+    // Shrinking or same size rewrites in place; growing moves the blob before the old
+    // sectors are released, so the table never points at partly overwritten data
+    uint32_t sector = entry.sector;
+    if (sector == 0 || sectors > old_sectors)
+    {
+        sector = allocateSectors(region, sectors);
+        if (entry.sector != 0)
+        {
+            std::fill(region.used_sectors.begin() + entry.sector,
+                      region.used_sectors.begin() + entry.sector + old_sectors, false);
+        }
+    }
+    else if (sectors < old_sectors)
+    {
+        std::fill(region.used_sectors.begin() + sector + sectors,
+                  region.used_sectors.begin() + sector + old_sectors, false);
+    }
+
+    // Padded to whole sectors so a blob at the end of the file never leaves a gap behind it
+    static const char padding[SECTOR_SIZE] = {};
+    TableEntry updated{sector, static_cast<uint32_t>(blob.size())};
+    std::streamoff table_offset = static_cast<std::streamoff>(sizeof(RegionHeader) +
+                                                              getTableIndex(chunk_pos) * sizeof(TableEntry));
+    region.file.clear();
+    region.file.seekp(static_cast<std::streamoff>(sector) * SECTOR_SIZE);
+    region.file.write(reinterpret_cast<const char *>(blob.data()), static_cast<std::streamsize>(blob.size()));
+    region.file.write(padding, static_cast<std::streamsize>(sectors * SECTOR_SIZE - blob.size()));
+    region.file.seekp(table_offset);
+    region.file.write(reinterpret_cast<const char *>(&updated), sizeof(updated));
+    if (!region.file)
+    {
+        return false;
+    }
+    entry = updated;
+    return true;
+}
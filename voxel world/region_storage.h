@@ -0,0 +1,144 @@
+#ifndef REGION_STORAGE_H
+#define REGION_STORAGE_H
+
+#include "voxel_types.h"
+#include <glm/glm/glm.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class JobSystem;
+class PaletteStorage;
+class FileMapping;
+
+// Saved chunks on disk, grouped into region files of REGION_SIZE x REGION_SIZE chunk columns,
+// REGION_LAYERS layers tall (the world has no height limit; each band of layers has files of
+// its own).
+//
+// A region file starts with an offset table (one entry per chunk of the region, in
+// sectors) followed by the chunk blobs, each the PaletteStorage run encoding (or, in storage
+// kept for other per-chunk data, a storeBlob blob). A blob that outgrows its sectors moves to
+// the first free run large enough, so rewriting an edited chunk never shifts other entries.
+//
+// store() only copies the chunk's storage; a single background writer encodes queued
+// chunks and writes them grouped by region file, one flush per file and batch. Queued
+// copies stay readable until their write lands, so a chunk can be reloaded right after
+// unloading. load() may be called from any thread: saved blobs are decoded straight out of
+// a read-only mapping of the region file, outside the file lock, so bursts of loads are
+// bounded by decoding rather than by reads.
+class RegionStorage
+{
+public:
+    static constexpr int REGION_SIZE = 32;     // Chunk columns per region side
+    static constexpr int REGION_LAYERS = 8;    // Chunk layers per region file
+    static constexpr size_t SECTOR_SIZE = 512; // Allocation unit for blobs (a typical edited chunk is 1-3)
+
+    RegionStorage(std::string directory, JobSystem &job_system);
+    ~RegionStorage(); // Waits for pending writes
+
+    RegionStorage(const RegionStorage &) = delete;
+    RegionStorage &operator=(const RegionStorage &) = delete;
+
+    // Queue a copy of a chunk's voxels for writing, replacing any older queued copy. Once the
+    // job system is stopping the write happens on the calling thread.
+    bool store(const glm::ivec3 &chunk_pos, const PaletteStorage &voxels);
+
+    // Fill voxels from the saved chunk; false if none is saved (voxels untouched) or it is
+    // unreadable
+    bool load(const glm::ivec3 &chunk_pos, PaletteStorage &voxels);
+
+    // Any thread: whether a chunk is saved or queued, from the offset table (nothing decoded)
+    bool contains(const glm::ivec3 &chunk_pos);
+
+    // The same for an opaque blob instead of voxels, for data saved per chunk in storage of
+    // its own (entities). Blobs must not be empty; a newer store replaces the blob.
+    bool storeBlob(const glm::ivec3 &chunk_pos, std::vector<unsigned char> blob);
+    bool loadBlob(const glm::ivec3 &chunk_pos, std::vector<unsigned char> &blob);
+
+    // Block until every queued write has been attempted (failed ones stay queued in memory)
+    void flush();
+
+    size_t getPendingWriteCount();
+
+private:
+    static constexpr uint32_t REGION_MAGIC = 0x31525856; // "VXR1"
+    static constexpr int MAX_OPEN_REGIONS = 16;
+    static constexpr uint32_t MAX_BLOB_SIZE = 1u << 20; // Far above any real chunk encoding
+
+    struct TableEntry
+    {
+        uint32_t sector; // First sector of the blob, 0 if the chunk is not saved
+        uint32_t size;   // Blob bytes
+    };
+
+    struct Region
+    {
+        std::fstream file; // Closed until the first write when the file does not exist yet
+        std::vector<TableEntry> table;
+        std::vector<bool> used_sectors; // Header sectors included
+        // Remapped once the file grows past it; loads decoding from the old view keep it alive.
+        // Writes still go through the fstream: both views share the OS page cache, so a
+        // flushed write is visible through the mapping (only its size goes stale).
+        std::shared_ptr<const FileMapping> mapping;
+    };
+
+    struct ChunkHash
+    {
+        std::size_t operator()(const glm::ivec3 &v) const
+        {
+            uint64_t h = static_cast<uint64_t>(static_cast<uint32_t>(v.x)) * 0x9E3779B185EBCA87ull;
+            h ^= static_cast<uint64_t>(static_cast<uint32_t>(v.y)) * 0xC2B2AE3D27D4EB4Full;
+            h ^= static_cast<uint64_t>(static_cast<uint32_t>(v.z)) * 0x165667B19E3779F9ull;
+            h ^= h >> 29;
+            return static_cast<std::size_t>(h);
+        }
+    };
+
+    using Snapshot = std::shared_ptr<const PaletteStorage>;
+    using Blob = std::shared_ptr<const std::vector<unsigned char>>;
+
+    struct PendingChunk
+    {
+        Snapshot voxels; // Encoded by the writer; null for a storeBlob blob
+        Blob blob;
+        bool attempted = false; // Write failed; kept so this session still reads it back
+    };
+
+    const std::string directory;
+    JobSystem &job_system;
+
+    // Chunks not yet written; a newer store of the same position replaces the copy
+    std::mutex pending_mutex;
+    std::condition_variable writer_idle;
+    std::unordered_map<glm::ivec3, PendingChunk, ChunkHash> pending;
+    bool writer_scheduled = false; // A writer job is queued or running
+
+    // Region files and their tables; all file I/O happens under this lock
+    std::mutex file_mutex;
+    std::unordered_map<glm::ivec3, std::unique_ptr<Region>, ChunkHash> regions;
+
+    static size_t getTableSize();
+    static size_t getHeaderSectors();
+    static glm::ivec3 getRegionCoord(const glm::ivec3 &chunk_pos);
+    static size_t getTableIndex(const glm::ivec3 &chunk_pos);
+    std::string getRegionPath(const glm::ivec3 &region) const;
+
+    Region &openRegion(const glm::ivec3 &coord); // file_mutex held
+    bool createRegionFile(const glm::ivec3 &coord, Region &region);
+    uint32_t allocateSectors(Region &region, uint32_t count);
+    bool queue(const glm::ivec3 &chunk_pos, PendingChunk chunk);
+    // The saved blob, from the mapping or read into data; false if none is saved
+    bool findSaved(const glm::ivec3 &chunk_pos, std::shared_ptr<const FileMapping> &mapping,
+                   const unsigned char *&payload, size_t &payload_size, std::vector<unsigned char> &data);
+    bool readChunk(Region &region, const TableEntry &entry, std::vector<unsigned char> &data); // No mapping
+    void writePending(); // Writer loop: batches until nothing new is queued
+    bool writeChunk(Region &region, const glm::ivec3 &chunk_pos, const std::vector<unsigned char> &blob);
+};
+
+#endif // REGION_STORAGE_H
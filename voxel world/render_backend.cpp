@@ -0,0 +1,24 @@
+#include "render_backend.h"
+#include "gl_render_backend.h"
+
+namespace
+{
+std::unique_ptr<RenderBackend> &getInstalled()
+{
+    static std::unique_ptr<RenderBackend> backend = std::make_unique<GLRenderBackend>();
+    return backend;
+}
+} // namespace
+
+RenderBackend &RenderBackend::get()
+{
+    return *getInstalled();
+}
+
+void RenderBackend::install(std::unique_ptr<RenderBackend> backend)
+{
+    if (backend)
+    {
+        getInstalled() = std::move(backend);
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef RENDER_BACKEND_H
+#define RENDER_BACKEND_H
+
+#include <glm/glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class Shader;
+enum class MeshFormat; // chunk_mesh.h
+
+// Seam between chunk rendering and the graphics API: buffers, chunk geometry, its draw lists
+// and the chunk pipelines. ChunkMesh and RegionBatcher (the per-chunk path) only talk to the
+// installed backend; GLRenderBackend implements it over OpenGL 3.3. The multi-draw arena,
+// staging ring and GPU mesher are GL 4.3+ fast paths: their buffers and every transfer into
+// or out of them go through the backend as well, but their vertex arrays, indirect draws,
+// compute dispatches and fences are OpenGL, so they need a backend whose buffers are GL
+// buffer objects (GLRenderBackend, or one built on it).
+//
+// Handles are opaque names, 0 meaning none. Calls are main thread only unless a backend
+// says otherwise.
+class RenderBackend
+{
+public:
+    using Buffer = uint32_t;
+    using Geometry = uint32_t;
+
+    // Quads first_quad.. of a geometry, in quads from its first vertex (or record)
+    struct QuadRun
+    {
+        size_t first_quad;
+        size_t quad_count;
+    };
+
+    // The backend in use; GLRenderBackend unless another was installed
+    static RenderBackend &get();
+    // Before any buffer or geometry is created; the previous backend's objects are not migrated
+    static void install(std::unique_ptr<RenderBackend> backend);
+
+    virtual ~RenderBackend() = default;
+
+    virtual const char *getName() const = 0;
+
+    // Buffers. writeBuffer replaces the contents (data may be null to only allocate): storage
+    // of capacity bytes is reused when bytes fits, else reallocated. Returns the capacity now.
+    virtual Buffer createBuffer() = 0;
+    virtual size_t writeBuffer(Buffer buffer, const void *data, size_t bytes, size_t capacity = 0) = 0;
+    virtual void copyBuffer(Buffer source, size_t source_offset, Buffer target, size_t target_offset, size_t bytes) = 0;
+    virtual void destroyBuffer(Buffer buffer) = 0; // Also unmaps it
+
+    // New storage of bytes with undefined contents; false when out of memory
+    virtual bool allocateBuffer(Buffer buffer, size_t bytes) = 0;
+    // Writes within the storage, and reads that wait for the GPU's writes before them
+    virtual void updateBuffer(Buffer buffer, size_t offset, const void *data, size_t bytes) = 0;
+    virtual void readBuffer(Buffer buffer, size_t offset, void *data, size_t bytes) = 0;
+    // Contents refilled every batch: new storage each time, draws still reading the old
+    // contents are not waited on
+    virtual void streamBuffer(Buffer buffer, const void *data, size_t bytes) = 0;
+    // Immutable storage of bytes mapped for writes until the buffer is destroyed, coherent,
+    // writable from any thread; null when the backend cannot map persistently
+    virtual void *mapPersistentBuffer(Buffer buffer, size_t bytes) = 0;
+
+    // Chunk geometry: vertices in a mesh format's layout over the shared quad index pattern.
+    // region_offsets adds one four-byte chunk offset per vertex (aRegionOffset, RegionBatcher).
+    virtual Geometry createGeometry(Buffer vertices, MeshFormat format, Buffer region_offsets = 0) = 0;
+    virtual void destroyGeometry(Geometry geometry) = 0;
+
+    // Draw lists: the runs of one geometry as one submission, each quad instances times (one
+    // per view, see ChunkMesh::setViewCount), at the origin set before it
+    virtual void setDrawOrigin(const glm::vec3 &origin) = 0;
+    virtual void drawGeometry(Geometry geometry, const QuadRun *runs, size_t run_count, int instances) = 0;
+
+    // Chunk pipelines: vertex/fragment pairs, null if the sources are missing
+    virtual std::unique_ptr<Shader> loadPipeline(const std::string &name, const std::string &vertex_path,
+                                                 const std::string &fragment_path) = 0;
+
+    // Objects shared by every geometry (the quad index pattern), at renderer cleanup
+    virtual void releaseShared() = 0;
+};
+
+#endif // RENDER_BACKEND_H
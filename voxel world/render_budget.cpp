@@ -0,0 +1,70 @@
+#include "render_budget.h"
+#include <algorithm>
+#include <cmath>
+
+bool RenderBudgetController::update(int &render_distance, float &lod_scale, size_t cpu_bytes, size_t gpu_bytes,
+                                    float frame_ms)
+{
+    if (cooldown > 0)
+    {
+        cooldown--;
+        return false;
+    }
+
+    float memory_ratio = std::max(getRatio(cpu_bytes, budget.max_cpu_bytes), getRatio(gpu_bytes, budget.max_gpu_bytes));
+    float frame_ratio = budget.target_frame_ms > 0.0f ? frame_ms / budget.target_frame_ms : 0.0f;
+
+    bool over = memory_ratio > 1.0f || frame_ratio > 1.1f;
+    // Growing is only worth it when one more ring of chunks would still fit: memory scales
+    // with the square of the distance
+    float grown = static_cast<float>(render_distance + 1) / static_cast<float>(std::max(1, render_distance));
+    bool under = memory_ratio * grown * grown < 0.9f && frame_ratio < 0.75f;
+
+    over_samples = over ? over_samples + 1 : 0;
+    under_samples = under ? under_samples + 1 : 0;
+
+    int distance = render_distance;
+    float scale = lod_scale;
+    if (over_samples >= SHRINK_SAMPLES)
+    {
+        if (memory_ratio > 1.0f)
+        {
+            // Jump straight to the distance the budget supports, at least one step
+            int fitting = static_cast<int>(std::floor(render_distance / std::sqrt(memory_ratio)));
+            distance = std::min(render_distance - 1, fitting);
+        }
+        else if (scale > MIN_LOD_SCALE)
+        {
+            scale = std::max(MIN_LOD_SCALE, scale - LOD_SCALE_STEP);
+        }
+        else
+        {
+            distance = render_distance - 1;
+        }
+    }
+    else if (under_samples >= GROW_SAMPLES)
+    {
+        // Undo in reverse order: distance first while the LOD is coarse, then detail
+        if (render_distance < budget.max_render_distance)
+        {
+            distance = render_distance + 1;
+        }
+        else if (scale < 1.0f)
+        {
+            scale = std::min(1.0f, scale + LOD_SCALE_STEP);
+        }
+    }
+
+    distance = std::clamp(distance, budget.min_render_distance, std::max(budget.min_render_distance, budget.max_render_distance));
+    if (distance == render_distance && scale == lod_scale)
+    {
+        return false;
+    }
+
+    render_distance = distance;
+    lod_scale = scale;
+    over_samples = 0;
+    under_samples = 0;
+    cooldown = COOLDOWN_SAMPLES;
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef RENDER_BUDGET_H
+#define RENDER_BUDGET_H
+
+#include <cstddef>
+
+// Limits the render distance controller keeps the world within (0 bytes: no limit)
+struct RenderBudget
+{
+    size_t max_cpu_bytes = 0;
+    size_t max_gpu_bytes = 0;
+    float target_frame_ms = 16.6f; // CPU or GPU frame work, whichever is higher
+    int min_render_distance = 4;
+    int max_render_distance = 16;
+};
+
+// Picks the render distance and LOD scale that keep memory and frame work within a budget.
+//
+// Fed one sample per evaluation (about a second of frames). Over budget for a couple of
+// samples in a row shrinks, clearly under budget for several samples grows, and every change
+// waits out a cooldown while streaming settles, so the setting does not oscillate. Memory
+// pressure shrinks the distance directly (usage grows with its square); frame-time pressure
+// first coarsens the LOD distances, then cuts the render distance.
+class RenderBudgetController
+{
+public:
+    static constexpr int SHRINK_SAMPLES = 2;
+    static constexpr int GROW_SAMPLES = 5;
+    static constexpr int COOLDOWN_SAMPLES = 3;
+    static constexpr float MIN_LOD_SCALE = 0.5f;
+    static constexpr float LOD_SCALE_STEP = 0.25f;
+
+    explicit RenderBudgetController(const RenderBudget &budget) : budget(budget) {}
+
+    const RenderBudget &getBudget() const { return budget; }
+
+    // One sample of current usage; updates render_distance and lod_scale in place and
+    // returns true if either changed
+    bool update(int &render_distance, float &lod_scale, size_t cpu_bytes, size_t gpu_bytes, float frame_ms);
+
+private:
+    RenderBudget budget;
+    int over_samples = 0;
+    int under_samples = 0;
+    int cooldown = 0;
+
+    // Usage over its limit (>1 over budget, 0 without a limit)
+    static float getRatio(size_t used, size_t limit)
+    {
+        return limit > 0 ? static_cast<float>(used) / static_cast<float>(limit) : 0.0f;
+    }
+};
+
+#endif // RENDER_BUDGET_H
@@ -0,0 +1,55 @@
+#include "resolution_scaler.h"
+#include <algorithm>
+#include <cmath>
+
+bool ResolutionScaler::update(float gpu_ms)
+{
+    if (skipped > 0)
+    {
+        skipped--;
+        return false;
+    }
+    if (gpu_ms <= 0.0f)
+    {
+        return false;
+    }
+
+    sample_ms_sum += gpu_ms;
+    if (++samples < SAMPLE_FRAMES)
+    {
+        return false;
+    }
+    float average_ms = sample_ms_sum / samples;
+    sample_ms_sum = 0.0f;
+    samples = 0;
+
+    float next = scale;
+    if (average_ms > target_ms)
+    {
+        // Aim under the target so the next average does not land right on it again
+        float fitting = scale * std::sqrt(target_ms * 0.9f / average_ms);
+        next = std::min(scale - SCALE_STEP, std::floor(fitting / SCALE_STEP) * SCALE_STEP);
+        under_samples = 0;
+    }
+    else
+    {
+        float grown = (scale + SCALE_STEP) / scale;
+        bool under = average_ms * grown * grown < target_ms * 0.85f;
+        under_samples = under ? under_samples + 1 : 0;
+        if (under_samples >= GROW_SAMPLES)
+        {
+            next = scale + SCALE_STEP;
+        }
+    }
+
+    next = std::clamp(next, MIN_SCALE, 1.0f);
+    if (next == scale)
+    {
+        return false;
+    }
+
+    scale = next;
+    under_samples = 0;
+    skipped = LATENCY_FRAMES;
+    return true;
+}
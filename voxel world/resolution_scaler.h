@@ -0,0 +1,41 @@
+#ifndef RESOLUTION_SCALER_H
+#define RESOLUTION_SCALER_H
+
+// Picks the render scale of the scene target (see SceneTarget) that keeps the GPU time of the
+// pixel-bound passes, opaque and transparent, at a target.
+//
+// Fed the newest timer result every frame and decides on the average of every SAMPLE_FRAMES
+// of them. Over the target jumps to the scale the average says fits (pixel work goes with
+// the square of the scale) with some headroom, at least one step down; well under it for a
+// couple of averages in a row grows one step, and only if the larger size is predicted to
+// fit. After a change the next LATENCY_FRAMES results are skipped: timer queries arrive a
+// frame or two late and still measure the old size. Scales are multiples of SCALE_STEP, so
+// what follows the viewport size (the Hi-Z pyramid) is rebuilt only on a change.
+class ResolutionScaler
+{
+public:
+    static constexpr float MIN_SCALE = 0.5f;
+    static constexpr float SCALE_STEP = 0.0625f;
+    static constexpr int SAMPLE_FRAMES = 15;
+    static constexpr int GROW_SAMPLES = 2;
+    static constexpr int LATENCY_FRAMES = 4; // GpuTimer::QUERIES_PER_PASS plus one
+
+    explicit ResolutionScaler(float target_ms) : target_ms(target_ms) {}
+
+    float getTarget() const { return target_ms; }
+    float getScale() const { return scale; }
+
+    // One frame's GPU time of the scaled passes (0: no result yet); returns true if the scale
+    // changed
+    bool update(float gpu_ms);
+
+private:
+    float target_ms;
+    float scale = 1.0f;
+    float sample_ms_sum = 0.0f;
+    int samples = 0;
+    int under_samples = 0;
+    int skipped = 0;
+};
+
+#endif // RESOLUTION_SCALER_H
@@ -0,0 +1,149 @@
+#include "scene_target.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+bool SceneTarget::isSupported()
+{
+#ifdef GL_VERSION_4_5
+    return GLAD_GL_VERSION_4_5 != 0 || GLAD_GL_ARB_clip_control != 0;
+#else
+    return false;
+#endif
+}
+
+SceneTarget::~SceneTarget()
+{
+    release();
+}
+
+void SceneTarget::applyDepthConvention(bool reverse)
+{
+#ifdef GL_VERSION_4_5
+    glClipControl(GL_LOWER_LEFT, reverse ? GL_ZERO_TO_ONE : GL_NEGATIVE_ONE_TO_ONE);
+#endif
+    glClearDepth(reverse ? 0.0 : 1.0);
+    glDepthFunc(reverse ? GL_GREATER : GL_LESS);
+}
+
+glm::mat4 SceneTarget::makeProjection(float fov_y, float aspect, float near_distance)
+{
+    // Limit of the [0, 1] perspective as far goes to infinity, with depth flipped: clip z is
+    // the constant near_distance and w the eye distance, so depth = near_distance / distance
+    float focal = 1.0f / std::tan(fov_y * 0.5f);
+    glm::mat4 projection(0.0f);
+    projection[0][0] = focal / aspect;
+    projection[1][1] = focal;
+    projection[2][3] = -1.0f;
+    projection[3][2] = near_distance;
+    return projection;
+}
+
+bool SceneTarget::setSize(int window_width, int window_height)
+{
+    // A minimized window reports 0: keep the buffers for when it comes back
+    if (window_width <= 0 || window_height <= 0 || (window_width == width && window_height == height && framebuffer != 0))
+    {
+        return framebuffer != 0;
+    }
+    return resize(window_width, window_height);
+}
+
+void SceneTarget::setRenderScale(float scale)
+{
+    render_scale = std::clamp(scale, 0.01f, 1.0f);
+}
+
+bool SceneTarget::bind()
+{
+    if (framebuffer == 0)
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        if (!resize(viewport[2], viewport[3]))
+        {
+            bound = false;
+            return false;
+        }
+    }
+
+    // Rounded to whole pixels once per frame; the projection keeps the window's aspect
+    render_width = std::max(1, static_cast<int>(std::lround(width * render_scale)));
+    render_height = std::max(1, static_cast<int>(std::lround(height * render_scale)));
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, render_width, render_height);
+    bound = true;
+    return true;
+}
+
+void SceneTarget::present()
+{
+    if (!bound)
+    {
+        return;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    bool scaled = render_width != width || render_height != height;
+    glBlitFramebuffer(0, 0, render_width, render_height, 0, 0, width, height, GL_COLOR_BUFFER_BIT,
+                      scaled ? GL_LINEAR : GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+    bound = false;
+}
+
+bool SceneTarget::resize(int new_width, int new_height)
+{
+    release();
+    if (new_width <= 0 || new_height <= 0)
+    {
+        return false;
+    }
+    width = new_width;
+    height = new_height;
+
+    glGenRenderbuffers(1, &color_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, color_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depth_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_buffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_buffer);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "Scene target: framebuffer incomplete (" << status << ")" << std::endl;
+        release();
+        return false;
+    }
+    return true;
+}
+
+void SceneTarget::release()
+{
+    if (framebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+        framebuffer = 0;
+    }
+    GLuint buffers[] = {color_buffer, depth_buffer};
+    for (GLuint buffer : buffers)
+    {
+        if (buffer != 0)
+        {
+            glDeleteRenderbuffers(1, &buffer);
+        }
+    }
+    color_buffer = 0;
+    depth_buffer = 0;
+    width = 0;
+    height = 0;
+}
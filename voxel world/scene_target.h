@@ -0,0 +1,76 @@
+#ifndef SCENE_TARGET_H
+#define SCENE_TARGET_H
+
+#include <glm/glm/glm.hpp>
+#include <glad/glad/glad.h>
+
+// Reverse-Z depth: the near plane maps to depth 1 and an infinite far plane to 0, in the
+// [0, 1] clip depth range of glClipControl (GL 4.5 or ARB_clip_control). Stored in a float
+// buffer the exponent then spends its precision where perspective loses it, so the far
+// terrain and large render distances do not z-fight. Depth tests use GL_GREATER and clear
+// to 0.
+//
+// The window's default framebuffer usually has a 24-bit fixed-point depth buffer, so the
+// world is drawn into this offscreen target (RGBA8 color, 32-bit float depth) and its color
+// copied to the window at the end of the frame. Main thread only.
+//
+// The target is also where dynamic resolution happens: its buffers are allocated at the
+// window size (setSize, from the framebuffer size callback), the frame is drawn into a
+// scaled rectangle in its lower left corner and present stretches that over the window with
+// linear filtering. A new scale only changes the viewport, never the allocation.
+class SceneTarget
+{
+public:
+    static bool isSupported();
+
+    SceneTarget() = default;
+    ~SceneTarget();
+
+    SceneTarget(const SceneTarget &) = delete;
+    SceneTarget &operator=(const SceneTarget &) = delete;
+
+    // Switch clip control, clear depth and depth test to the reversed convention (or back)
+    static void applyDepthConvention(bool reverse);
+
+    // Infinite far plane, depth 1 at near_distance and 0 at infinity (fov_y in radians)
+    static glm::mat4 makeProjection(float fov_y, float aspect, float near_distance);
+
+    // Window framebuffer size: the buffers are recreated right away if it changed (before
+    // the first call bind takes the viewport size)
+    bool setSize(int window_width, int window_height);
+    // Fraction of the window size drawn each frame, clamped to (0, 1]
+    void setRenderScale(float scale);
+    float getRenderScale() const { return render_scale; }
+
+    // Bind for drawing with the viewport on the scaled rectangle; false (default framebuffer
+    // left bound) if the framebuffer is incomplete
+    bool bind();
+    // Copy color to the default framebuffer, scaled up to the window, and bind that again
+    // with a full window viewport
+    void present();
+
+    bool isBound() const { return bound; }
+    // Valid while bound (TranslucencyTarget attaches the depth buffer)
+    GLuint getFramebuffer() const { return framebuffer; }
+    GLuint getDepthBuffer() const { return depth_buffer; }
+    int getWidth() const { return width; } // Allocated (window) size
+    int getHeight() const { return height; }
+    int getRenderWidth() const { return render_width; } // Drawn this frame
+    int getRenderHeight() const { return render_height; }
+
+private:
+    GLuint framebuffer = 0;
+    GLuint color_buffer = 0;
+    GLuint depth_buffer = 0;
+    int width = 0;
+    int height = 0;
+    int render_width = 0;
+    int render_height = 0;
+    float render_scale = 1.0f;
+    bool bound = false;
+
+    bool resize(int new_width, int new_height);
+    void release();
+};
+
+#endif // SCENE_TARGET_H
@@ -0,0 +1,208 @@
+#include "schematic.h"
+#include "voxel_world.h"
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+void writeVarint(std::vector<unsigned char> &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+bool readVarint(const unsigned char *&data, const unsigned char *end, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && data < end; shift += 7)
+    {
+        unsigned char byte = *data++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int floorDiv(int value, int divisor)
+{
+    return value >= 0 ? value / divisor : (value + 1) / divisor - 1;
+}
+
+const glm::ivec3 CHUNK_DIMENSIONS(CHUNK_SIZE, CHUNK_HEIGHT, CHUNK_SIZE);
+}
+
+std::shared_ptr<Schematic> Schematic::capture(const VoxelWorld &world, const glm::ivec3 &min_corner,
+                                              const glm::ivec3 &max_corner)
+{
+    auto schematic = std::make_shared<Schematic>();
+    glm::ivec3 size = max_corner - min_corner + 1;
+    if (size.x <= 0 || size.y <= 0 || size.z <= 0 ||
+        static_cast<size_t>(size.x) * size.y * size.z > MAX_VOLUME)
+    {
+        return schematic; // Empty
+    }
+    schematic->size = size;
+    world.getVoxels(min_corner, max_corner, schematic->voxels);
+    schematic->aligned_slabs = schematic->split(glm::ivec3(0), false);
+    return schematic;
+}
+
+bool Schematic::load(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Schematic: cannot open " << path << std::endl;
+        return false;
+    }
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const unsigned char *cursor = bytes.data();
+    const unsigned char *end = cursor + bytes.size();
+
+    uint32_t magic = 0;
+    for (int shift = 0; shift < 32 && cursor < end; shift += 8)
+    {
+        magic |= static_cast<uint32_t>(*cursor++) << shift;
+    }
+    uint64_t dimensions[3] = {};
+    bool valid = magic == SCHEMATIC_MAGIC;
+    for (uint64_t &dimension : dimensions)
+    {
+        valid = valid && readVarint(cursor, end, dimension) && dimension > 0 && dimension <= MAX_VOLUME;
+    }
+    if (!valid || dimensions[0] * dimensions[1] > MAX_VOLUME || dimensions[0] * dimensions[1] * dimensions[2] > MAX_VOLUME)
+    {
+        std::cerr << "Schematic: " << path << " is not a schematic" << std::endl;
+        return false;
+    }
+
+    // Run decoding checks the voxel types against the registry
+    glm::ivec3 loaded_size(static_cast<int>(dimensions[0]), static_cast<int>(dimensions[1]), static_cast<int>(dimensions[2]));
+    PaletteStorage storage(static_cast<size_t>(dimensions[0] * dimensions[1] * dimensions[2]));
+    if (!storage.decodeRuns(cursor, static_cast<size_t>(end - cursor)))
+    {
+        std::cerr << "Schematic: bad voxel data in " << path << std::endl;
+        return false;
+    }
+
+    size = loaded_size;
+    voxels.resize(storage.size());
+    storage.decodeAll(voxels.data());
+    aligned_slabs = split(glm::ivec3(0), false);
+    return true;
+}
+
+bool Schematic::save(const std::string &path) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file || voxels.empty())
+    {
+        std::cerr << "Schematic: cannot write " << path << std::endl;
+        return false;
+    }
+
+    // Magic, the size, then the voxels' run encoding
+    std::vector<unsigned char> bytes;
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        bytes.push_back(static_cast<unsigned char>(SCHEMATIC_MAGIC >> shift));
+    }
+    for (int axis = 0; axis < 3; axis++)
+    {
+        writeVarint(bytes, static_cast<uint64_t>(size[axis]));
+    }
+    PaletteStorage storage(voxels.size());
+    storage.assign(voxels.data());
+    storage.encodeRuns(bytes);
+    file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(file.flush());
+}
+
+glm::ivec3 Schematic::getAlignment(const glm::ivec3 &origin)
+{
+    return origin - glm::ivec3(floorDiv(origin.x, CHUNK_SIZE), floorDiv(origin.y, CHUNK_HEIGHT), floorDiv(origin.z, CHUNK_SIZE)) *
+                        CHUNK_DIMENSIONS;
+}
+
+bool Schematic::hasSlabs(const glm::ivec3 &origin, bool paste_air) const
+{
+    return !paste_air && getAlignment(origin) == glm::ivec3(0) && aligned_slabs;
+}
+
+std::shared_ptr<const Schematic::Slabs> Schematic::getSlabs(const glm::ivec3 &origin, bool paste_air) const
+{
+    if (hasSlabs(origin, paste_air))
+    {
+        return aligned_slabs;
+    }
+    return split(getAlignment(origin), paste_air);
+}
+
+std::shared_ptr<const Schematic::Slabs> Schematic::split(const glm::ivec3 &alignment, bool paste_air) const
+{
+    auto slabs = std::make_shared<Slabs>();
+    if (voxels.empty())
+    {
+        return slabs;
+    }
+
+    // Chunks from the origin's to the one holding the far corner
+    const glm::ivec3 last(floorDiv(alignment.x + size.x - 1, CHUNK_SIZE), floorDiv(alignment.y + size.y - 1, CHUNK_HEIGHT),
+                          floorDiv(alignment.z + size.z - 1, CHUNK_SIZE));
+    thread_local std::array<VoxelID, CHUNK_VOLUME> chunk_voxels;
+    for (int cx = 0; cx <= last.x; cx++)
+    {
+        for (int cy = 0; cy <= last.y; cy++)
+        {
+            for (int cz = 0; cz <= last.z; cz++)
+            {
+                // The structure's part inside this chunk, in structure coordinates
+                const glm::ivec3 chunk_origin = glm::ivec3(cx, cy, cz) * CHUNK_DIMENSIONS - alignment;
+                const glm::ivec3 low = glm::max(chunk_origin, glm::ivec3(0));
+                const glm::ivec3 high = glm::min(chunk_origin + CHUNK_DIMENSIONS, size) - 1;
+
+                Slab slab;
+                slab.chunk_offset = glm::ivec3(cx, cy, cz);
+                slab.mask.assign(CHUNK_VOLUME / 64, 0);
+                chunk_voxels.fill(VOXEL_AIR);
+                for (int x = low.x; x <= high.x; x++)
+                {
+                    for (int y = low.y; y <= high.y; y++)
+                    {
+                        const VoxelID *row = voxels.data() + sourceIndex(x, y, 0);
+                        for (int z = low.z; z <= high.z; z++)
+                        {
+                            if (row[z] == VOXEL_AIR && !paste_air)
+                            {
+                                continue;
+                            }
+                            int index = ChunkIndexing::index(x - chunk_origin.x, y - chunk_origin.y, z - chunk_origin.z);
+                            chunk_voxels[index] = row[z];
+                            slab.mask[index >> 6] |= uint64_t(1) << (index & 63);
+                            slab.count++;
+                        }
+                    }
+                }
+                if (slab.count > 0)
+                {
+                    slab.voxels.assign(chunk_voxels.data());
+                    slabs->push_back(std::move(slab));
+                }
+            }
+        }
+    }
+    return slabs;
+}
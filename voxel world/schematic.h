@@ -0,0 +1,70 @@
+#ifndef SCHEMATIC_H
+#define SCHEMATIC_H
+
+#include "voxel_types.h"
+#include "palette_storage.h"
+#include <glm/glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class VoxelWorld;
+
+// A prefab structure: a box of voxels, pasted into the world with VoxelWorld::pasteSchematic.
+//
+// The file holds the box size and its voxels as one PaletteStorage run encoding, x-major
+// with z innermost (like VoxelWorld::getVoxels). Pasting does not go voxel by voxel: the
+// structure is split into slabs, one per chunk it covers, each the chunk's share as a
+// palette-compressed chunk storage plus a mask of the voxels it writes (air is skipped
+// unless pasted too). A paste then copies every slab into its chunk in one bulk write
+// (VoxelChunk::pasteVoxels). Slabs depend on where the origin sits in its chunk; the split
+// for a chunk-aligned origin without air is built by load, others on their first paste.
+class Schematic
+{
+public:
+    // One chunk's share of the structure
+    struct Slab
+    {
+        glm::ivec3 chunk_offset; // From the chunk of the paste origin
+        PaletteStorage voxels{CHUNK_VOLUME}; // coordsToIndex order, never packed (read by any thread)
+        std::vector<uint64_t> mask;          // Bit per voxel written, CHUNK_VOLUME bits
+        size_t count = 0;                    // Voxels written
+    };
+    using Slabs = std::vector<Slab>;
+
+    // Largest accepted structure (the voxels are kept decoded, two bytes each)
+    static constexpr size_t MAX_VOLUME = size_t(1) << 26;
+
+    // The voxels of an inclusive box of the world (unloaded chunks read as air)
+    static std::shared_ptr<Schematic> capture(const VoxelWorld &world, const glm::ivec3 &min_corner,
+                                              const glm::ivec3 &max_corner);
+
+    // Replace the structure from a file; false (structure untouched, the reason on stderr)
+    // if it cannot be read, is malformed or holds unregistered voxel types
+    bool load(const std::string &path);
+    bool save(const std::string &path) const;
+
+    glm::ivec3 getSize() const { return size; }
+    size_t getVolume() const { return static_cast<size_t>(size.x) * size.y * size.z; }
+
+    // The slabs for a paste at origin: the prebuilt split if the origin is chunk-aligned and
+    // air is skipped, otherwise a new split (any thread)
+    std::shared_ptr<const Slabs> getSlabs(const glm::ivec3 &origin, bool paste_air) const;
+    // Whether getSlabs has the split ready, i.e. returns without splitting
+    bool hasSlabs(const glm::ivec3 &origin, bool paste_air) const;
+
+private:
+    static constexpr uint32_t SCHEMATIC_MAGIC = 0x31535856; // "VXS1"
+
+    glm::ivec3 size{0};
+    std::vector<VoxelID> voxels; // x-major, z innermost
+    std::shared_ptr<const Slabs> aligned_slabs; // Aligned origin, air skipped
+
+    // Origin position inside its chunk
+    static glm::ivec3 getAlignment(const glm::ivec3 &origin);
+    std::shared_ptr<const Slabs> split(const glm::ivec3 &alignment, bool paste_air) const;
+    size_t sourceIndex(int x, int y, int z) const { return (static_cast<size_t>(x) * size.y + y) * size.z + z; }
+};
+
+#endif // SCHEMATIC_H
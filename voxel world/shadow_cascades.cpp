@@ -0,0 +1,333 @@
+#include "shadow_cascades.h"
+#include "voxel_chunk.h"
+#include "chunk_mesh.h"
+#include "startup_cache.h"
+#include "../shader.h"
+#include <glm/glm/gtc/matrix_transform.hpp>
+#include <glm/glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <tuple>
+
+namespace
+{
+// Casters this far toward the sun from a cascade's square still shade it (well past the world height)
+constexpr float CASTER_DEPTH = 1024.0f;
+// Half the diagonal of a 16x64x16 chunk: a chunk touches a square if its center is this close
+constexpr float CHUNK_BOUNDING_RADIUS = 34.0f;
+// Normal offset of the lookup, in texels of the cascade
+constexpr float NORMAL_OFFSET_TEXELS = 1.5f;
+constexpr float SLOPE_BIAS = 1.5f;
+constexpr float CONSTANT_BIAS = 4.0f;
+
+glm::mat4 makeView(const glm::vec3 &sun)
+{
+    // Rotation only: the origin stays at the world origin, so light space is one fixed frame per sun
+    const glm::vec3 up = std::abs(sun.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    return glm::lookAt(glm::vec3(0.0f), -sun, up);
+}
+
+glm::vec3 chunkCenter(const glm::ivec3 &chunk_pos)
+{
+    // Mesh vertices span voxel center -0.5..+0.5
+    return glm::vec3(chunk_pos.x * CHUNK_SIZE + CHUNK_SIZE * 0.5f - 0.5f, chunk_pos.y * CHUNK_HEIGHT + CHUNK_HEIGHT * 0.5f - 0.5f,
+                     chunk_pos.z * CHUNK_SIZE + CHUNK_SIZE * 0.5f - 0.5f);
+}
+
+bool lessPosition(const glm::ivec3 &a, const glm::ivec3 &b)
+{
+    return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+}
+}
+
+ShadowCascades::ShadowCascades()
+    : depth_texture(0), framebuffer(0), sun_direction(0.0f, 1.0f, 0.0f), zero_to_one_depth(false),
+      cascades_drawn_last_frame(0), previous_framebuffer(0), previous_viewport{0, 0, 0, 0},
+      previous_polygon_mode{GL_FILL, GL_FILL}, previous_depth_func(GL_LESS), previous_clear_depth(1.0f),
+      previous_cull_face(GL_FALSE)
+{
+}
+
+ShadowCascades::~ShadowCascades()
+{
+    if (framebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+    }
+    if (depth_texture != 0)
+    {
+        glDeleteTextures(1, &depth_texture);
+    }
+    if (caster_shader)
+    {
+        glDeleteProgram(caster_shader->ID);
+    }
+}
+
+bool ShadowCascades::initialize()
+{
+    // The voxel vertex shader, so casters land exactly where the chunks are drawn
+    StartupCache cache;
+    for (const char *directory : {"shaders/", "voxel world/"})
+    {
+        std::string base(directory);
+        caster_shader = cache.loadShader("shadow_caster", base + "voxel.vs", base + "voxel_depth.fs");
+        if (caster_shader)
+        {
+            break;
+        }
+    }
+    if (!caster_shader)
+    {
+        std::cerr << "Shadows: caster shaders not found" << std::endl;
+        return false;
+    }
+
+    // Linear filtering with the comparison enabled gives 2x2 percentage-closer filtering
+    glGenTextures(1, &depth_texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depth_texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, RESOLUTION, RESOLUTION, CASCADES, 0, GL_DEPTH_COMPONENT,
+                 GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    GLint previous = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_texture, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previous));
+    if (!complete)
+    {
+        std::cerr << "Shadows: depth framebuffer incomplete" << std::endl;
+        return false;
+    }
+
+    std::cout << "Shadows: " << CASCADES << " cascades of " << RESOLUTION << "x" << RESOLUTION << ", out to "
+              << CASCADE_RADII[CASCADES - 1] << " blocks (" << getMemoryUsage() / (1024 * 1024) << " MB)" << std::endl;
+    return true;
+}
+
+void ShadowCascades::place(Cascade &cascade, int index, const glm::mat4 &view, const glm::vec3 &camera_position) const
+{
+    const float radius = CASCADE_RADII[index];
+    if (index == 0)
+    {
+        cascade.half_extent = radius;
+        cascade.step = 2.0f * radius / RESOLUTION;
+    }
+    else
+    {
+        // A quarter of the square is also a whole number of texels
+        cascade.half_extent = radius * 4.0f / 3.0f;
+        cascade.step = cascade.half_extent / 4.0f;
+    }
+    cascade.view = view;
+    const glm::vec3 light = glm::vec3(view * glm::vec4(camera_position, 1.0f));
+    cascade.origin = glm::floor(light / cascade.step + 0.5f) * cascade.step;
+}
+
+uint32_t ShadowCascades::update(const glm::vec3 &camera_position, const glm::vec3 &sun, bool zero_to_one)
+{
+    if (zero_to_one != zero_to_one_depth)
+    {
+        // Stored depths follow the old range
+        zero_to_one_depth = zero_to_one;
+        for (Cascade &cascade : cascades)
+        {
+            cascade.valid = false;
+        }
+    }
+    sun_direction = sun;
+
+    const glm::mat4 current_view = makeView(sun);
+    const float min_cosine = std::cos(glm::radians(SUN_THRESHOLD_DEGREES));
+    uint32_t drawn = 0;
+    bool cached_drawn = false;
+    for (int i = 0; i < CASCADES; i++)
+    {
+        Cascade &cascade = cascades[i];
+        const bool sun_moved = !cascade.valid || glm::dot(cascade.sun, sun) < min_cosine;
+        const bool cached = i > 0;
+        Cascade placed = cascade;
+        place(placed, i, cached && !sun_moved ? cascade.view : current_view, camera_position);
+        const bool moved = placed.origin != cascade.origin;
+        if (cached && (cached_drawn || (!sun_moved && !moved && !cascade.dirty)))
+        {
+            continue;
+        }
+
+        cascade = placed;
+        if (!cached || sun_moved)
+        {
+            cascade.sun = sun;
+        }
+        const float depth_range = cascade.half_extent + CASTER_DEPTH;
+        glm::mat4 projection = glm::ortho(cascade.origin.x - cascade.half_extent, cascade.origin.x + cascade.half_extent,
+                                          cascade.origin.y - cascade.half_extent, cascade.origin.y + cascade.half_extent,
+                                          -(cascade.origin.z + depth_range), -(cascade.origin.z - depth_range));
+        glm::mat4 to_texture(1.0f);
+        to_texture[0][0] = 0.5f;
+        to_texture[1][1] = 0.5f;
+        to_texture[3][0] = 0.5f;
+        to_texture[3][1] = 0.5f;
+        if (zero_to_one_depth)
+        {
+            // Same box, clip depth squeezed into [0, 1]; the stored depth is clip depth
+            glm::mat4 remap(1.0f);
+            remap[2][2] = 0.5f;
+            remap[3][2] = 0.5f;
+            projection = remap * projection;
+        }
+        else
+        {
+            to_texture[2][2] = 0.5f;
+            to_texture[3][2] = 0.5f;
+        }
+        cascade.projection = projection;
+        cascade.to_texture = to_texture * projection * cascade.view;
+
+        cascade.caster_directions = 0;
+        for (int direction = 0; direction < 6; direction++)
+        {
+            if (glm::dot(glm::vec3(FACE_NORMALS[direction]), cascade.sun) <= 0.0f)
+            {
+                cascade.caster_directions |= static_cast<uint8_t>(1u << direction);
+            }
+        }
+        cascade.valid = true;
+        cascade.dirty = false;
+        drawn |= 1u << i;
+        cached_drawn = cached_drawn || cached;
+    }
+    cascades_drawn_last_frame = std::popcount(drawn);
+    return drawn;
+}
+
+bool ShadowCascades::covers(int index, const glm::ivec3 &chunk_pos) const
+{
+    // Along the sun the box reaches past every loaded chunk, so only the square is tested
+    const Cascade &cascade = cascades[index];
+    const glm::vec3 light = glm::vec3(cascade.view * glm::vec4(chunkCenter(chunk_pos), 1.0f));
+    const float reach = cascade.half_extent + CHUNK_BOUNDING_RADIUS;
+    return std::abs(light.x - cascade.origin.x) <= reach && std::abs(light.y - cascade.origin.y) <= reach;
+}
+
+void ShadowCascades::markChanged(const glm::ivec3 &chunk_pos)
+{
+    // The nearest cascade is drawn every frame anyway
+    for (int i = 1; i < CASCADES; i++)
+    {
+        if (cascades[i].valid && !cascades[i].dirty && covers(i, chunk_pos))
+        {
+            cascades[i].dirty = true;
+        }
+    }
+}
+
+void ShadowCascades::setMembers(const std::vector<std::pair<glm::ivec3, VoxelChunk *>> &chunks)
+{
+    member_scratch.clear();
+    for (const auto &[chunk_pos, chunk] : chunks)
+    {
+        member_scratch.push_back(chunk_pos);
+    }
+    std::sort(member_scratch.begin(), member_scratch.end(), lessPosition);
+    if (member_scratch == members)
+    {
+        return;
+    }
+
+    // Chunks only in one of the two sets came or went
+    std::vector<glm::ivec3> changed;
+    std::set_symmetric_difference(members.begin(), members.end(), member_scratch.begin(), member_scratch.end(),
+                                  std::back_inserter(changed), lessPosition);
+    for (const glm::ivec3 &chunk_pos : changed)
+    {
+        markChanged(chunk_pos);
+    }
+    members.swap(member_scratch);
+}
+
+void ShadowCascades::beginCascade(int index)
+{
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+    glGetIntegerv(GL_VIEWPORT, previous_viewport);
+    glGetIntegerv(GL_POLYGON_MODE, previous_polygon_mode);
+    glGetIntegerv(GL_DEPTH_FUNC, &previous_depth_func);
+    glGetFloatv(GL_DEPTH_CLEAR_VALUE, &previous_clear_depth);
+    previous_cull_face = glIsEnabled(GL_CULL_FACE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_texture, 0, index);
+    glViewport(0, 0, RESOLUTION, RESOLUTION);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); // Wireframe view still casts solid shadows
+
+    // Standard depth whatever the scene uses; the caster directions already picked the faces
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+    glClearDepth(1.0);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(SLOPE_BIAS, CONSTANT_BIAS);
+
+    caster_shader->use();
+    caster_shader->setMat4("view", cascades[index].view);
+    caster_shader->setMat4("projection", cascades[index].projection);
+    caster_shader->setInt("face_records", FACE_RECORD_TEXTURE_UNIT);
+}
+
+void ShadowCascades::endCascade()
+{
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    if (previous_cull_face)
+    {
+        glEnable(GL_CULL_FACE);
+    }
+    glClearDepth(previous_clear_depth);
+    glDepthFunc(static_cast<GLenum>(previous_depth_func));
+    glPolygonMode(GL_FRONT_AND_BACK, static_cast<GLenum>(previous_polygon_mode[0]));
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previous_framebuffer));
+    glViewport(previous_viewport[0], previous_viewport[1], previous_viewport[2], previous_viewport[3]);
+}
+
+void ShadowCascades::bindTexture() const
+{
+    glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depth_texture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void ShadowCascades::setUniforms(const Shader &program) const
+{
+    // Cascades drawn so far, nearest first; the cached ones fill in over the first frames
+    int ready = 0;
+    std::array<glm::mat4, CASCADES> matrices;
+    std::array<float, CASCADES> offsets;
+    for (int i = 0; i < CASCADES && cascades[i].valid; i++, ready++)
+    {
+        matrices[i] = cascades[i].to_texture;
+        offsets[i] = NORMAL_OFFSET_TEXELS * 2.0f * cascades[i].half_extent / RESOLUTION;
+    }
+    program.setInt("shadow_cascade_count", ready);
+    program.setVec3("sun_direction", sun_direction);
+    if (ready > 0)
+    {
+        glUniformMatrix4fv(glGetUniformLocation(program.ID, "shadow_matrices"), ready, GL_FALSE, glm::value_ptr(matrices[0]));
+        glUniform1fv(glGetUniformLocation(program.ID, "shadow_offsets"), ready, offsets.data());
+    }
+}
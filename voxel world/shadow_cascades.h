@@ -0,0 +1,110 @@
+#ifndef SHADOW_CASCADES_H
+#define SHADOW_CASCADES_H
+
+#include <glm/glm/glm.hpp>
+#include <glad/glad/glad.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class Shader;
+class VoxelChunk;
+
+constexpr GLint SHADOW_TEXTURE_UNIT = 4; // Clear of the atlas, Hi-Z, face records and minimap
+
+// Directional sun shadows on the chunk meshes: CASCADES depth maps in one texture array, each
+// an orthographic view along the sun over a square around the camera, the nearest smallest.
+//
+// Only the nearest cascade is drawn every frame. The others are cached and drawn again when
+// the sun turned more than SUN_THRESHOLD_DEGREES since, when their origin moves, or when a
+// chunk inside their square was remeshed, loaded or unloaded (markChanged, setMembers); at
+// most one of them per frame, nearest first. The origin is the camera position in light space
+// snapped to a grid: single texels for the nearest cascade, which keeps its edges from
+// shimmering, and a quarter of the square for the cached ones, whose square is wider than
+// their radius by that step so the camera can move that far before they need drawing again.
+//
+// Casters are the opaque and cutout ranges of the face directions turned away from the sun,
+// the far side of each occluder, so lit faces are free of acne. Cutout texels are not alpha
+// tested: leaves cast solid shadows. Only chunk meshes cast and receive. Main thread only.
+class ShadowCascades
+{
+public:
+    static constexpr int CASCADES = 3;
+    static constexpr int RESOLUTION = 2048;
+    static constexpr float SUN_THRESHOLD_DEGREES = 0.5f;
+    static constexpr std::array<float, CASCADES> CASCADE_RADII = {32.0f, 96.0f, 256.0f}; // Blocks around the camera
+
+    ShadowCascades();
+    ~ShadowCascades();
+
+    ShadowCascades(const ShadowCascades &) = delete;
+    ShadowCascades &operator=(const ShadowCascades &) = delete;
+
+    // Depth texture array, framebuffer and the caster program (voxel.vs with voxel_depth.fs)
+    bool initialize();
+
+    // Start of the shadow pass: place the cascades for this camera and sun (normalized, toward
+    // the sun) and return the cascades to draw now as bits; zero_to_one_depth matches the
+    // glClipControl depth range in use
+    uint32_t update(const glm::vec3 &camera_position, const glm::vec3 &sun_direction, bool zero_to_one_depth);
+
+    // The chunk's mesh was replaced: cached cascades over it are drawn again
+    void markChanged(const glm::ivec3 &chunk_pos);
+    // The drawable chunks as VoxelRenderer culls them; chunks that came or went count as changed
+    void setMembers(const std::vector<std::pair<glm::ivec3, VoxelChunk *>> &chunks);
+
+    // Drawing one cascade: beginCascade binds its layer and the caster program (view and
+    // projection set), the chunks it covers are drawn with its caster directions, then
+    // endCascade puts the framebuffer, viewport and depth state back
+    void beginCascade(int cascade);
+    void endCascade();
+    bool covers(int cascade, const glm::ivec3 &chunk_pos) const;
+    uint8_t getCasterDirections(int cascade) const { return cascades[cascade].caster_directions; }
+
+    // Receivers: the maps on SHADOW_TEXTURE_UNIT and the lookup uniforms of voxel.fs and friends
+    void bindTexture() const;
+    void setUniforms(const Shader &program) const;
+
+    int getCascadesDrawnLastFrame() const { return cascades_drawn_last_frame; }
+    size_t getMemoryUsage() const { return static_cast<size_t>(RESOLUTION) * RESOLUTION * CASCADES * 4; }
+
+private:
+    struct Cascade
+    {
+        glm::mat4 view{1.0f};        // Rotation toward the sun it was drawn for
+        glm::mat4 projection{1.0f};  // Orthographic box around origin
+        glm::mat4 to_texture{1.0f};  // World to texture coordinates and depth
+        glm::vec3 sun{0.0f};
+        glm::vec3 origin{0.0f};      // Light space, snapped
+        float half_extent = 0.0f;    // Of the square, blocks
+        float step = 0.0f;           // Origin snapping grid
+        uint8_t caster_directions = 0;
+        bool valid = false;          // Drawn at least once with the current depth range
+        bool dirty = true;
+    };
+
+    std::unique_ptr<Shader> caster_shader;
+    GLuint depth_texture;
+    GLuint framebuffer;
+    std::array<Cascade, CASCADES> cascades;
+    glm::vec3 sun_direction;
+    bool zero_to_one_depth;
+    int cascades_drawn_last_frame;
+    std::vector<glm::ivec3> members; // Sorted, as of the last setMembers
+    std::vector<glm::ivec3> member_scratch;
+
+    // Saved by beginCascade
+    GLint previous_framebuffer;
+    GLint previous_viewport[4];
+    GLint previous_polygon_mode[2];
+    GLint previous_depth_func;
+    GLfloat previous_clear_depth;
+    GLboolean previous_cull_face;
+
+    void place(Cascade &cascade, int index, const glm::mat4 &view, const glm::vec3 &camera_position) const;
+};
+
+#endif // SHADOW_CASCADES_H
@@ -0,0 +1,102 @@
+#include "simulation_thread.h"
+#include "voxel_world.h"
+#include "profiler.h"
+
+SimulationThread::SimulationThread(VoxelWorld &world)
+    : world(world)
+{
+}
+
+SimulationThread::~SimulationThread()
+{
+    stop();
+}
+
+void SimulationThread::start()
+{
+    if (ticker.joinable())
+    {
+        return;
+    }
+    world.setDeferShellRelease(true);
+    stopping = false;
+    ticker = std::thread([this]() { run(); });
+}
+
+void SimulationThread::stop()
+{
+    if (!ticker.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex);
+        stopping = true;
+    }
+    stop_requested.notify_one();
+    ticker.join();
+    world.setDeferShellRelease(false); // On the render thread: the dropped shells go now
+}
+
+void SimulationThread::setCenter(const glm::vec3 &position)
+{
+    std::lock_guard<std::mutex> lock(center_mutex);
+    center = position;
+}
+
+std::unique_lock<std::mutex> SimulationThread::lockWorld()
+{
+    // Taking the lock straight back after releasing it would starve the ticker when frames
+    // are not paced by vsync
+    while (tick_waiting.load(std::memory_order_acquire))
+    {
+        std::this_thread::yield();
+    }
+    return std::unique_lock<std::mutex>(world_mutex);
+}
+
+void SimulationThread::run()
+{
+    Profiler::setThreadName("Simulation");
+    const auto step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(TICK_SECONDS));
+    auto next_tick = Clock::now();
+    std::unique_lock<std::mutex> lock(stop_mutex);
+    while (!stop_requested.wait_until(lock, next_tick, [this]() { return stopping; }))
+    {
+        lock.unlock();
+        tick();
+        lock.lock();
+
+        // Behind by more than the catch-up allowance: the rest is skipped, not replayed
+        next_tick += step;
+        auto now = Clock::now();
+        if (now - next_tick > step * MAX_CATCH_UP_TICKS)
+        {
+            dropped_ticks.fetch_add(static_cast<uint64_t>((now - next_tick) / step), std::memory_order_relaxed);
+            next_tick = now;
+        }
+    }
+}
+
+void SimulationThread::tick()
+{
+    glm::vec3 position;
+    {
+        std::lock_guard<std::mutex> lock(center_mutex);
+        position = center;
+    }
+
+    tick_waiting.store(true, std::memory_order_release);
+    std::unique_lock<std::mutex> world_lock(world_mutex);
+    tick_waiting.store(false, std::memory_order_release);
+
+    PROFILE_ZONE("SimulationThread::tick");
+    auto start = Clock::now();
+    world.update(position);
+    if (publisher)
+    {
+        publisher(position);
+    }
+    last_tick_ms.store(std::chrono::duration<float, std::milli>(Clock::now() - start).count(), std::memory_order_relaxed);
+    ticks.fetch_add(1, std::memory_order_relaxed);
+}
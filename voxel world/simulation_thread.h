@@ -0,0 +1,87 @@
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include <glm/glm/glm.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+class VoxelWorld;
+
+// World updates at a fixed tick rate on a thread of their own, instead of once per rendered
+// frame on the main thread.
+//
+// Every TICK_SECONDS the thread takes the world lock and runs VoxelWorld::update around the
+// last published center: streaming decisions, integrating generated chunks (and relighting
+// them), pastes, fluids, entities, checkpoints and saves. Ticks missed while the lock was held
+// elsewhere run back to back, at most MAX_CATCH_UP_TICKS of them; older ones are dropped.
+//
+// The world stays single-owner: "main thread only" becomes "whoever holds lockWorld". Before
+// a tick lets go of the lock it runs the publisher, which copies out what the frame draws
+// from (see VoxelRenderer::publishSnapshot), so the render thread only holds the lock for
+// the part of its frame that changes the world or reads voxels: input and edits, mesh
+// dispatch and uploads. Culling and the passes run on the last published snapshot while
+// the next tick runs. A tick that is due goes first: lockWorld waits for it rather than
+// taking the lock straight back. GL objects stay on the render thread (see
+// VoxelWorld::setDeferShellRelease).
+class SimulationThread
+{
+public:
+    static constexpr float TICK_SECONDS = 1.0f / 60.0f; // One integrate budget per tick
+    static constexpr int MAX_CATCH_UP_TICKS = 4;
+
+    explicit SimulationThread(VoxelWorld &world);
+    ~SimulationThread(); // Stops
+
+    SimulationThread(const SimulationThread &) = delete;
+    SimulationThread &operator=(const SimulationThread &) = delete;
+
+    // Runs at the end of every tick with its center, on this thread with the world lock held;
+    // set before start
+    void setPublisher(std::function<void(const glm::vec3 &)> publish) { publisher = std::move(publish); }
+
+    // From the render thread, stop without the world lock; the world defers shell releases
+    // while the thread runs
+    void start();
+    void stop();
+    bool isRunning() const { return ticker.joinable(); }
+
+    // Streaming center for the next tick (the camera position), any thread
+    void setCenter(const glm::vec3 &position);
+
+    // Exclusive use of the world for the render thread, which must not hold it already
+    std::unique_lock<std::mutex> lockWorld();
+
+    uint64_t getTickCount() const { return ticks.load(std::memory_order_relaxed); }
+    uint64_t getDroppedTicks() const { return dropped_ticks.load(std::memory_order_relaxed); }
+    float getLastTickTime() const { return last_tick_ms.load(std::memory_order_relaxed); } // Milliseconds
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    VoxelWorld &world;
+    std::function<void(const glm::vec3 &)> publisher;
+    std::mutex world_mutex;
+    std::atomic<bool> tick_waiting{false}; // The ticker wants world_mutex
+
+    std::mutex center_mutex;
+    glm::vec3 center{0.0f};
+
+    std::thread ticker;
+    std::mutex stop_mutex; // Between stop and the ticker only
+    std::condition_variable stop_requested;
+    bool stopping = false;
+
+    std::atomic<uint64_t> ticks{0};
+    std::atomic<uint64_t> dropped_ticks{0};
+    std::atomic<float> last_tick_ms{0.0f};
+
+    void run();
+    void tick();
+};
+
+#endif // SIMULATION_THREAD_H
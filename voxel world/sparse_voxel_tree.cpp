@@ -0,0 +1,224 @@
+#include "sparse_voxel_tree.h"
+#include "palette_storage.h"
+#include "block_registry.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace
+{
+constexpr int SIZE = SparseVoxelTree::SIZE;
+constexpr int HEIGHT = SparseVoxelTree::HEIGHT;
+constexpr int CELLS4 = SIZE / 4;
+constexpr int CELLS16 = SIZE / 16;
+
+size_t columnIndex(int x, int y, int z)
+{
+    return (static_cast<size_t>(y) * SIZE + z) * SIZE + x;
+}
+
+size_t cell4Index(int x, int y, int z)
+{
+    return (static_cast<size_t>(y >> 2) * CELLS4 + (z >> 2)) * CELLS4 + (x >> 2);
+}
+
+size_t cell16Index(int x, int y, int z)
+{
+    return (static_cast<size_t>(y >> 4) * CELLS16 + (z >> 4)) * CELLS16 + (x >> 4);
+}
+
+// A face of voxel toward a neighbor of this type is visible (ChunkMesh's rule)
+bool showsFace(VoxelID voxel, VoxelID neighbor)
+{
+    return neighbor != voxel && isVoxelTransparent(neighbor);
+}
+
+// Rank of a child among the set bits of its node's mask
+uint32_t rankOf(uint64_t mask, int bit)
+{
+    return static_cast<uint32_t>(std::popcount(mask & ((uint64_t(1) << bit) - 1)));
+}
+}
+
+void SparseVoxelTree::build(const PaletteStorage *const *chunks, const int *border_heights)
+{
+    thread_local std::vector<VoxelID> voxels;
+    thread_local std::vector<uint8_t> kept;
+    thread_local std::array<VoxelID, CHUNK_VOLUME> decoded;
+    voxels.resize(static_cast<size_t>(SIZE) * HEIGHT * SIZE);
+    kept.assign(voxels.size(), 0);
+    std::vector<uint8_t> cells4(static_cast<size_t>(CELLS4) * (HEIGHT / 4) * CELLS4, 0);
+    std::vector<uint8_t> cells16(static_cast<size_t>(CELLS16) * (HEIGHT / 16) * CELLS16, 0);
+
+    // The column in one array; uniform chunks (most of them) are a fill
+    for (int layer = 0; layer < LAYERS; layer++)
+    {
+        for (int cx = 0; cx < 4; cx++)
+        {
+            for (int cz = 0; cz < 4; cz++)
+            {
+                const PaletteStorage *chunk = chunks[(layer * 4 + cx) * 4 + cz];
+                const bool uniform = !chunk || chunk->isUniform();
+                const VoxelID fill = !chunk ? static_cast<VoxelID>(VOXEL_STONE) : chunk->get(0);
+                if (!uniform)
+                {
+                    chunk->decodeAll(decoded.data());
+                }
+                for (int y = 0; y < CHUNK_HEIGHT; y++)
+                {
+                    for (int z = 0; z < CHUNK_SIZE; z++)
+                    {
+                        VoxelID *row = voxels.data() + columnIndex(cx * CHUNK_SIZE, layer * CHUNK_HEIGHT + y, cz * CHUNK_SIZE + z);
+                        for (int x = 0; x < CHUNK_SIZE; x++)
+                        {
+                            row[x] = uniform ? fill : decoded[ChunkIndexing::index(x, y, z)];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Neighbors outside the column: rock below the world, air above it, the terrain height
+    // past the sides
+    auto outside = [&](int x, int y, int z) -> VoxelID
+    {
+        if (y < 0)
+        {
+            return VOXEL_STONE;
+        }
+        if (y >= HEIGHT)
+        {
+            return VOXEL_AIR;
+        }
+        int height = border_heights[(x + 1) * (SIZE + 2) + z + 1];
+        return y < height ? VOXEL_STONE : y <= WATER_LEVEL ? VOXEL_WATER : VOXEL_AIR;
+    };
+    auto neighbor = [&](int x, int y, int z) -> VoxelID
+    {
+        if (x < 0 || x >= SIZE || y < 0 || y >= HEIGHT || z < 0 || z >= SIZE)
+        {
+            return outside(x, y, z);
+        }
+        return voxels[columnIndex(x, y, z)];
+    };
+
+    voxel_count = 0;
+    min_y = HEIGHT;
+    max_y = 0;
+    for (int y = 0; y < HEIGHT; y++)
+    {
+        for (int z = 0; z < SIZE; z++)
+        {
+            for (int x = 0; x < SIZE; x++)
+            {
+                const size_t index = columnIndex(x, y, z);
+                const VoxelID voxel = voxels[index];
+                if (voxel == VOXEL_AIR)
+                {
+                    continue;
+                }
+                if (!showsFace(voxel, neighbor(x - 1, y, z)) && !showsFace(voxel, neighbor(x + 1, y, z)) &&
+                    !showsFace(voxel, neighbor(x, y - 1, z)) && !showsFace(voxel, neighbor(x, y + 1, z)) &&
+                    !showsFace(voxel, neighbor(x, y, z - 1)) && !showsFace(voxel, neighbor(x, y, z + 1)))
+                {
+                    continue;
+                }
+                kept[index] = 1;
+                cells4[cell4Index(x, y, z)] = 1;
+                cells16[cell16Index(x, y, z)] = 1;
+                min_y = std::min(min_y, y);
+                max_y = std::max(max_y, y + 1);
+            }
+        }
+    }
+
+    // Roots, then each node's children depth first
+    words.assign(LAYERS, EMPTY);
+    for (int layer = 0; layer < LAYERS; layer++)
+    {
+        const int y = layer * CHUNK_HEIGHT;
+        auto first = cells16.begin() + static_cast<std::ptrdiff_t>(cell16Index(0, y, 0));
+        auto last = first + CELLS16 * CELLS16 * (CHUNK_HEIGHT / 16);
+        if (std::find(first, last, 1) == last)
+        {
+            continue;
+        }
+        words[layer] = static_cast<uint32_t>(words.size());
+        words.resize(words.size() + 3);
+        fillNode(words[layer], 0, 0, y, 0, voxels.data(), kept.data(), cells4.data(), cells16.data());
+    }
+}
+
+void SparseVoxelTree::fillNode(size_t offset, int level, int x, int y, int z, const VoxelID *voxels, const uint8_t *kept,
+                               const uint8_t *cells4, const uint8_t *cells16)
+{
+    const int cell = 16 >> (2 * level);
+    uint64_t mask = 0;
+    for (int bit = 0; bit < 64; bit++)
+    {
+        const int cx = x + (bit & 3) * cell;
+        const int cy = y + (bit >> 4) * cell;
+        const int cz = z + ((bit >> 2) & 3) * cell;
+        const bool occupied = level == 0   ? cells16[cell16Index(cx, cy, cz)] != 0
+                              : level == 1 ? cells4[cell4Index(cx, cy, cz)] != 0
+                                           : kept[columnIndex(cx, cy, cz)] != 0;
+        mask |= occupied ? uint64_t(1) << bit : 0;
+    }
+
+    const size_t base = words.size();
+    words[offset] = static_cast<uint32_t>(mask);
+    words[offset + 1] = static_cast<uint32_t>(mask >> 32);
+    words[offset + 2] = static_cast<uint32_t>(base);
+    const int stride = level < 2 ? 3 : 1;
+    words.resize(base + static_cast<size_t>(stride) * std::popcount(mask));
+
+    uint32_t rank = 0;
+    for (uint64_t bits = mask; bits != 0; bits &= bits - 1, rank++)
+    {
+        const int bit = std::countr_zero(bits);
+        const int cx = x + (bit & 3) * cell;
+        const int cy = y + (bit >> 4) * cell;
+        const int cz = z + ((bit >> 2) & 3) * cell;
+        if (level < 2)
+        {
+            fillNode(base + 3 * rank, level + 1, cx, cy, cz, voxels, kept, cells4, cells16);
+        }
+        else
+        {
+            words[base + rank] = voxels[columnIndex(cx, cy, cz)];
+            voxel_count++;
+        }
+    }
+}
+
+VoxelID SparseVoxelTree::getSurfaceVoxel(int x, int y, int z) const
+{
+    if (x < 0 || x >= SIZE || y < 0 || y >= HEIGHT || z < 0 || z >= SIZE || words.empty())
+    {
+        return VOXEL_AIR;
+    }
+    uint32_t node = words[y / CHUNK_HEIGHT];
+    if (node == EMPTY)
+    {
+        return VOXEL_AIR;
+    }
+    const int local_y = y % CHUNK_HEIGHT;
+    for (int level = 0; level < 3; level++)
+    {
+        const int shift = 4 - 2 * level;
+        const int bit = ((((local_y >> shift) & 3) * 4) + ((z >> shift) & 3)) * 4 + ((x >> shift) & 3);
+        const uint64_t mask = words[node] | static_cast<uint64_t>(words[node + 1]) << 32;
+        if ((mask & (uint64_t(1) << bit)) == 0)
+        {
+            return VOXEL_AIR;
+        }
+        const uint32_t child = words[node + 2] + (level < 2 ? 3 : 1) * rankOf(mask, bit);
+        if (level == 2)
+        {
+            return static_cast<VoxelID>(words[child]);
+        }
+        node = child;
+    }
+    return VOXEL_AIR;
+}
@@ -0,0 +1,61 @@
+#ifndef SPARSE_VOXEL_TREE_H
+#define SPARSE_VOXEL_TREE_H
+
+#include "voxel_types.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class PaletteStorage;
+
+// Surface voxels of one world column (4x4 chunk columns, every layer) as a sparse 64-tree,
+// the node layout far_voxels.fs raymarches straight out of a shader storage buffer.
+//
+// Each chunk layer is a 64-block cube with three levels below its root: 16-block cells,
+// 4-block cells and voxels, every node a 4x4x4 child mask (bit (y * 4 + z) * 4 + x). A set
+// bit has its child at the node's child base plus the rank of the bit among the set ones, so
+// a node's children are contiguous and an empty cell costs nothing. Only voxels that show a
+// face (the mesher's rule: a transparent neighbor of another type) are kept, so memory
+// follows the surface area rather than the volume; the rays reach nothing else.
+//
+// Words: LAYERS root offsets (EMPTY for a layer without surface), then nodes of three words
+// (mask low, mask high, child base). Children of the voxel level are VoxelIDs, one word each,
+// colored through a table built from the block registry. Any thread.
+class SparseVoxelTree
+{
+public:
+    static constexpr int SIZE = 4 * CHUNK_SIZE; // Column side in blocks
+    static constexpr int LAYERS = TERRAIN_LAYERS;
+    static constexpr int HEIGHT = LAYERS * CHUNK_HEIGHT;
+    static constexpr int CHUNKS = 4 * 4 * LAYERS;
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+    static_assert(CHUNK_HEIGHT == SIZE, "Each chunk layer must be one 64-block cube");
+
+    // Build from the column's chunk voxels, chunks[(layer * 4 + x) * 4 + z]; a null chunk
+    // counts as solid (layers deep under the surface are not generated). The voxels just
+    // outside the column are estimated from terrain heights, border_heights[(x + 1) *
+    // (SIZE + 2) + z + 1] for x and z in [-1, SIZE]: solid below the height, water up to
+    // WATER_LEVEL, air above.
+    void build(const PaletteStorage *const *chunks, const int *border_heights);
+
+    const std::vector<uint32_t> &getWords() const { return words; }
+    size_t getVoxelCount() const { return voxel_count; }
+    size_t getMemoryUsage() const { return words.size() * sizeof(uint32_t); }
+    // Bounds of the kept voxels in column coordinates (max exclusive); min > max if none
+    int getMinY() const { return min_y; }
+    int getMaxY() const { return max_y; }
+
+    // The kept voxel at column coordinates, VOXEL_AIR if none (the shader's lookup)
+    VoxelID getSurfaceVoxel(int x, int y, int z) const;
+
+private:
+    std::vector<uint32_t> words;
+    size_t voxel_count = 0;
+    int min_y = HEIGHT;
+    int max_y = 0;
+
+    void fillNode(size_t offset, int level, int x, int y, int z, const VoxelID *voxels, const uint8_t *kept,
+                  const uint8_t *cells4, const uint8_t *cells16);
+};
+
+#endif // SPARSE_VOXEL_TREE_H
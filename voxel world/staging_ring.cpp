@@ -0,0 +1,158 @@
+#include "staging_ring.h"
+#include "render_backend.h"
+#include <iostream>
+
+namespace
+{
+constexpr size_t STAGING_ALIGNMENT = 16;
+}
+
+bool StagingRing::isSupported()
+{
+#ifdef GL_VERSION_4_4
+    return GLAD_GL_VERSION_4_4 != 0;
+#else
+    return false;
+#endif
+}
+
+StagingRing::StagingRing(size_t capacity_bytes)
+    : buffer(0), mapped(nullptr), capacity(capacity_bytes), head(0), tail(0), next_id(1),
+      current_frame(1), completed_frame(0), copies_this_frame(false)
+{
+    RenderBackend &backend = RenderBackend::get();
+    buffer = backend.createBuffer();
+    mapped = static_cast<unsigned char *>(backend.mapPersistentBuffer(buffer, capacity));
+
+    if (!mapped)
+    {
+        std::cerr << "Staging ring: failed to map " << capacity << " bytes" << std::endl;
+        capacity = 0; // Every allocation fails; callers fall back to direct uploads
+        return;
+    }
+
+    std::cout << "Staging ring: " << (capacity / (1024 * 1024)) << " MB persistently mapped" << std::endl;
+}
+
+StagingRing::~StagingRing()
+{
+    for (FrameFence &fence : fences)
+    {
+        glDeleteSync(fence.sync);
+    }
+    RenderBackend::get().destroyBuffer(buffer); // Unmapped with it
+}
+
+void *StagingRing::allocate(size_t bytes, StagingAllocation &out)
+{
+    out = StagingAllocation();
+    size_t size = (bytes + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+    if (size == 0 || size > capacity)
+    {
+        return nullptr;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Blocks never straddle the end; the skipped tail is owned by the wrapped block
+    size_t offset = static_cast<size_t>(head % capacity);
+    size_t padding = offset + size > capacity ? capacity - offset : 0;
+    if (head + padding + size - tail > capacity)
+    {
+        return nullptr;
+    }
+
+    out.id = next_id++;
+    out.offset = padding > 0 ? 0 : offset;
+    out.size = size;
+
+    head += padding + size;
+    blocks.push_back({out.id, head, 0, BlockState::Written});
+    return mapped + out.offset;
+}
+
+StagingRing::Block *StagingRing::findBlock(uint64_t id)
+{
+    if (blocks.empty() || id < blocks.front().id)
+    {
+        return nullptr;
+    }
+    size_t index = static_cast<size_t>(id - blocks.front().id);
+    return index < blocks.size() ? &blocks[index] : nullptr;
+}
+
+void StagingRing::markCopied(const StagingAllocation &allocation)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (Block *block = findBlock(allocation.id))
+    {
+        block->state = BlockState::Copied;
+        block->frame = current_frame;
+        copies_this_frame = true;
+    }
+}
+
+void StagingRing::discard(const StagingAllocation &allocation)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (Block *block = findBlock(allocation.id))
+    {
+        block->state = BlockState::Discarded;
+    }
+    releaseFinishedBlocks();
+}
+
+void StagingRing::endFrame()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!copies_this_frame)
+    {
+        return;
+    }
+
+    fences.push_back({current_frame, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)});
+    current_frame++;
+    copies_this_frame = false;
+}
+
+void StagingRing::retire()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Poll without blocking; fences signal in submission order
+    while (!fences.empty())
+    {
+        GLenum status = glClientWaitSync(fences.front().sync, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        {
+            break;
+        }
+        completed_frame = fences.front().frame;
+        glDeleteSync(fences.front().sync);
+        fences.pop_front();
+    }
+
+    releaseFinishedBlocks();
+}
+
+void StagingRing::releaseFinishedBlocks()
+{
+    while (!blocks.empty())
+    {
+        const Block &block = blocks.front();
+        bool finished = block.state == BlockState::Discarded ||
+                        (block.state == BlockState::Copied && block.frame <= completed_frame);
+        if (!finished)
+        {
+            break;
+        }
+        tail = block.end;
+        blocks.pop_front();
+    }
+}
+
+size_t StagingRing::getUsedBytes()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return static_cast<size_t>(head - tail);
+}
@@ -0,0 +1,93 @@
+#ifndef STAGING_RING_H
+#define STAGING_RING_H
+
+#include <glad/glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+// Byte range reserved in the staging ring
+struct StagingAllocation
+{
+    uint64_t id = 0; // 0 means no allocation
+    size_t offset = 0;
+    size_t size = 0;
+
+    bool isValid() const { return id != 0; }
+};
+
+// Persistently mapped upload buffer (RenderBackend::mapPersistentBuffer, GL 4.4 buffer
+// storage) shared by all mesh workers.
+//
+// Workers reserve space and write mesh data straight into the mapping; the main thread
+// only issues buffer-to-buffer copies out of it (ChunkArena::upload, through the backend). Space is handed back in allocation order
+// once the copies that read it are behind a signalled fence (or it was never copied).
+class StagingRing
+{
+public:
+    // True when the loaded context provides persistent mapping
+    static bool isSupported();
+
+    explicit StagingRing(size_t capacity_bytes);
+    ~StagingRing();
+
+    StagingRing(const StagingRing &) = delete;
+    StagingRing &operator=(const StagingRing &) = delete;
+
+    // Any thread: reserve bytes and return where to write them, or nullptr when full
+    void *allocate(size_t bytes, StagingAllocation &out);
+
+    // Main thread only
+    GLuint getBuffer() const { return buffer; }
+    void markCopied(const StagingAllocation &allocation); // Copies reading it were issued this frame
+    void discard(const StagingAllocation &allocation);    // Will never be copied
+    void endFrame();                                      // Fence the copies issued since the last call
+    void retire();                                        // Reclaim space the GPU has finished reading
+
+    size_t getCapacity() const { return capacity; }
+    size_t getUsedBytes();
+
+private:
+    enum class BlockState
+    {
+        Written,
+        Copied,
+        Discarded
+    };
+
+    struct Block
+    {
+        uint64_t id;
+        uint64_t end;   // Absolute ring position just past the block (includes wrap padding)
+        uint64_t frame; // Fence frame of the copy (Copied only)
+        BlockState state;
+    };
+
+    struct FrameFence
+    {
+        uint64_t frame;
+        GLsync sync;
+    };
+
+    GLuint buffer;
+    unsigned char *mapped;
+    size_t capacity;
+
+    // Absolute positions; offsets are position % capacity
+    std::mutex mutex;
+    uint64_t head;
+    uint64_t tail;
+    uint64_t next_id;
+    std::deque<Block> blocks; // Allocation order, ids consecutive
+
+    uint64_t current_frame;   // Frame the next markCopied calls belong to
+    uint64_t completed_frame; // Newest frame whose fence has signalled
+    bool copies_this_frame;
+    std::deque<FrameFence> fences;
+
+    Block *findBlock(uint64_t id);
+    void releaseFinishedBlocks();
+};
+
+#endif // STAGING_RING_H
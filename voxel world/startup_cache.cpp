@@ -0,0 +1,200 @@
+#include "startup_cache.h"
+#include "../shader.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+constexpr uint32_t CACHE_MAGIC = 0x31435856; // "VXC1"
+
+struct BlobHeader
+{
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t key;
+    uint64_t size;
+};
+}
+
+StartupCache::StartupCache(std::string directory)
+    : directory(std::move(directory))
+{
+}
+
+uint64_t StartupCache::hash(const void *data, size_t size, uint64_t seed)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; i++)
+    {
+        h ^= bytes[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+uint64_t StartupCache::hashString(const std::string &text, uint64_t seed)
+{
+    return hash(text.data(), text.size(), seed);
+}
+
+uint64_t StartupCache::hashFile(const std::string &path, uint64_t seed)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return hashString(path, seed);
+    }
+    std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return hash(contents.data(), contents.size(), seed);
+}
+
+bool StartupCache::loadBlob(const std::string &name, uint64_t key, std::vector<unsigned char> &data) const
+{
+    std::ifstream file(getPath(name), std::ios::binary);
+    BlobHeader header;
+    if (!file || !file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    {
+        return false;
+    }
+    if (header.magic != CACHE_MAGIC || header.key != key)
+    {
+        return false; // Stale: rewritten by the caller
+    }
+
+    data.resize(static_cast<size_t>(header.size));
+    return static_cast<bool>(file.read(reinterpret_cast<char *>(data.data()), data.size()));
+}
+
+bool StartupCache::storeBlob(const std::string &name, uint64_t key, const void *data, size_t size) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    // Written next to the entry and renamed over it, so a crash never leaves half a blob
+    std::string path = getPath(name);
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        BlobHeader header{CACHE_MAGIC, 0, key, static_cast<uint64_t>(size)};
+        if (!file || !file.write(reinterpret_cast<const char *>(&header), sizeof(header)) ||
+            !file.write(static_cast<const char *>(data), size))
+        {
+            std::cerr << "Startup cache: failed to write " << temp_path << std::endl;
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temp_path, path, error);
+    if (error)
+    {
+        std::cerr << "Startup cache: failed to replace " << path << ": " << error.message() << std::endl;
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+    return true;
+}
+
+bool StartupCache::programBinariesSupported()
+{
+#ifdef GL_VERSION_4_1
+    if (GLAD_GL_VERSION_4_1 == 0)
+    {
+        return false;
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+#else
+    return false;
+#endif
+}
+
+std::unique_ptr<Shader> StartupCache::loadShader(const std::string &name, const std::string &vertex_path,
+                                                 const std::string &fragment_path) const
+{
+    if (!std::filesystem::exists(vertex_path) || !std::filesystem::exists(fragment_path))
+    {
+        return nullptr;
+    }
+
+    // Binaries are only valid for the driver that produced them
+    uint64_t key = hashFile(vertex_path);
+    key = hashFile(fragment_path, key);
+    for (GLenum string : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+    {
+        const GLubyte *value = glGetString(string);
+        key = hashString(value ? reinterpret_cast<const char *>(value) : "", key);
+    }
+
+    if (GLuint program = loadProgram(name, key))
+    {
+        return std::make_unique<Shader>(Shader::fromProgram(program));
+    }
+
+    auto shader = std::make_unique<Shader>(vertex_path.c_str(), fragment_path.c_str());
+    storeProgram(name, key, shader->ID);
+    return shader;
+}
+
+GLuint StartupCache::loadProgram(const std::string &name, uint64_t key) const
+{
+#ifdef GL_VERSION_4_1
+    std::vector<unsigned char> data;
+    if (!programBinariesSupported() || !loadBlob(name, key, data) || data.size() <= sizeof(GLenum))
+    {
+        return 0;
+    }
+
+    // Blob layout: binary format, then the binary
+    GLenum format;
+    std::memcpy(&format, data.data(), sizeof(format));
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, format, data.data() + sizeof(format), static_cast<GLsizei>(data.size() - sizeof(format)));
+
+    // Drivers may reject binaries (e.g. after an update with the same version string)
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+    std::cout << "Startup cache: restored program '" << name << "'" << std::endl;
+    return program;
+#else
+    return 0;
+#endif
+}
+
+void StartupCache::storeProgram(const std::string &name, uint64_t key, GLuint program) const
+{
+#ifdef GL_VERSION_4_1
+    GLint linked = GL_FALSE;
+    GLint length = 0;
+    if (!programBinariesSupported())
+    {
+        return;
+    }
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (!linked || length <= 0)
+    {
+        return;
+    }
+
+    std::vector<unsigned char> data(sizeof(GLenum) + static_cast<size_t>(length));
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, data.data() + sizeof(GLenum));
+    if (written <= 0)
+    {
+        return;
+    }
+    std::memcpy(data.data(), &format, sizeof(format));
+    storeBlob(name, key, data.data(), sizeof(GLenum) + static_cast<size_t>(written));
+#endif
+}
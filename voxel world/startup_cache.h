@@ -0,0 +1,50 @@
+#ifndef STARTUP_CACHE_H
+#define STARTUP_CACHE_H
+
+#include <glad/glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Shader;
+
+// On-disk cache of the work done at startup: the assembled block texture array and linked
+// shader programs (GL 4.1 program binaries).
+//
+// Every entry is stored with a 64-bit key the caller derives from the inputs (file
+// contents, driver strings); an entry whose key does not match is ignored and rewritten,
+// so editing a texture or shader invalidates its entry on the next start.
+class StartupCache
+{
+public:
+    static constexpr uint64_t HASH_SEED = 0xcbf29ce484222325ull; // FNV-1a offset basis
+
+    explicit StartupCache(std::string directory = "cache/");
+
+    // FNV-1a over a byte range, chainable through seed
+    static uint64_t hash(const void *data, size_t size, uint64_t seed = HASH_SEED);
+    static uint64_t hashString(const std::string &text, uint64_t seed = HASH_SEED);
+    // Whole file contents; a missing file hashes as its path so it still changes the key
+    static uint64_t hashFile(const std::string &path, uint64_t seed = HASH_SEED);
+
+    bool loadBlob(const std::string &name, uint64_t key, std::vector<unsigned char> &data) const;
+    bool storeBlob(const std::string &name, uint64_t key, const void *data, size_t size) const;
+
+    // Vertex/fragment program, restored from its binary when the sources and driver are
+    // unchanged, compiled (and stored) otherwise. Null if the sources are missing.
+    std::unique_ptr<Shader> loadShader(const std::string &name, const std::string &vertex_path,
+                                       const std::string &fragment_path) const;
+
+    static bool programBinariesSupported();
+
+private:
+    std::string directory;
+
+    std::string getPath(const std::string &name) const { return directory + name + ".bin"; }
+    GLuint loadProgram(const std::string &name, uint64_t key) const;
+    void storeProgram(const std::string &name, uint64_t key, GLuint program) const;
+};
+
+#endif // STARTUP_CACHE_H
@@ -0,0 +1,187 @@
+#include "terrain_features.h"
+#include "height_field_cache.h"
+#include "palette_storage.h"
+#include "voxel_chunk.h"
+#include "voxel_noise.h"
+#include "profiler.h"
+
+namespace
+{
+constexpr uint32_t TREE_SALT = 0x7265u;
+constexpr uint32_t ORE_SALT = 0x6f72u;
+
+uint64_t hashCoords(uint32_t seed, int x, int y, int z, uint32_t salt)
+{
+    uint64_t h = (static_cast<uint64_t>(seed) << 32 | salt) ^ 0x9E3779B97F4A7C15ull;
+    h ^= static_cast<uint64_t>(static_cast<uint32_t>(x)) * 0xC2B2AE3D27D4EB4Full;
+    h ^= static_cast<uint64_t>(static_cast<uint32_t>(y)) * 0x165667B19E3779F9ull;
+    h ^= static_cast<uint64_t>(static_cast<uint32_t>(z)) * 0x27D4EB2F165667C5ull;
+    // splitmix64 finalizer
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+    return h ^ (h >> 31);
+}
+
+// Writes feature voxels that land inside one chunk
+class ChunkWriter
+{
+public:
+    ChunkWriter(const glm::ivec3 &chunk_pos, PaletteStorage &voxels)
+        : origin(chunk_pos * glm::ivec3(CHUNK_SIZE, CHUNK_HEIGHT, CHUNK_SIZE)), voxels(voxels) {}
+
+    // Wood replaces air and leaves, leaves only air, ore only stone: overlapping features come
+    // out the same whichever is placed first
+    void place(const glm::ivec3 &world_pos, VoxelID voxel)
+    {
+        glm::ivec3 local = world_pos - origin;
+        if (!VoxelChunk::isLocal(local.x, local.y, local.z))
+        {
+            return;
+        }
+        int index = VoxelChunk::coordsToIndex(local.x, local.y, local.z);
+        VoxelID current = voxels.get(index);
+        bool replaces = voxel == VOXEL_WOOD   ? current == VOXEL_AIR || current == VOXEL_LEAVES
+                        : voxel == VOXEL_IRON ? current == VOXEL_STONE
+                                              : current == VOXEL_AIR;
+        if (replaces)
+        {
+            voxels.set(index, voxel);
+            placed++;
+        }
+    }
+
+    const glm::ivec3 origin;
+    int placed = 0;
+
+private:
+    PaletteStorage &voxels;
+};
+
+void plantTree(ChunkWriter &writer, const glm::ivec3 &base, int trunk_height, uint64_t shape)
+{
+    int top = base.y + trunk_height; // First layer above the trunk
+    for (int y = base.y; y < top; y++)
+    {
+        writer.place(glm::ivec3(base.x, y, base.z), VOXEL_WOOD);
+    }
+
+    // Two wide layers around the top of the trunk, two narrow ones above it
+    for (int y = top - 2; y <= top + 1; y++)
+    {
+        int radius = y < top ? TerrainFeatures::TREE_REACH : 1;
+        for (int dx = -radius; dx <= radius; dx++)
+        {
+            for (int dz = -radius; dz <= radius; dz++)
+            {
+                bool corner = (dx == -radius || dx == radius) && (dz == -radius || dz == radius);
+                if (corner && (y == top + 1 || y == top - 1 || ((shape >> (((dx > 0) << 1) | (dz > 0))) & 1)))
+                {
+                    continue; // Rounded off; the lowest layer keeps some corners
+                }
+                writer.place(glm::ivec3(base.x + dx, y, base.z + dz), VOXEL_LEAVES);
+            }
+        }
+    }
+}
+
+int columnHeight(uint32_t seed, HeightFieldCache *heights, const glm::ivec2 &column, int world_x, int world_z,
+                 Biome &biome)
+{
+    if (heights)
+    {
+        // Same tile the chunks of that column read; this chunk just acquired it for its borders
+        HeightFieldCache::TileHandle tile = heights->acquire(column);
+        int x = world_x - column.x * CHUNK_SIZE;
+        int z = world_z - column.y * CHUNK_SIZE;
+        biome = tile->getBiome(x, z);
+        return tile->get(x, z);
+    }
+    int height = 0;
+    uint8_t sampled = BIOME_PLAINS;
+    VoxelNoise::forThread(seed).generateHeightField(world_x, world_z, 1, 1, &height, 1, &sampled);
+    biome = static_cast<Biome>(sampled);
+    return height;
+}
+}
+
+int TerrainFeatures::decorate(uint32_t seed, const glm::ivec3 &chunk_pos, TerrainMode mode, HeightFieldCache *heights,
+                              PaletteStorage &voxels)
+{
+    PROFILE_ZONE("TerrainFeatures::decorate");
+    ChunkWriter writer(chunk_pos, voxels);
+    const glm::ivec3 &origin = writer.origin;
+
+    if (mode == TerrainMode::Heightmap)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            for (int dz = -1; dz <= 1; dz++)
+            {
+                glm::ivec2 column(chunk_pos.x + dx, chunk_pos.z + dz);
+                for (int attempt = 0; attempt < TREE_ATTEMPTS; attempt++)
+                {
+                    uint64_t r = hashCoords(seed, column.x, 0, column.y, TREE_SALT + attempt);
+                    if ((r & 3) != 0)
+                    {
+                        continue;
+                    }
+                    int x = column.x * CHUNK_SIZE + static_cast<int>((r >> 8) & (CHUNK_SIZE - 1));
+                    int z = column.y * CHUNK_SIZE + static_cast<int>((r >> 12) & (CHUNK_SIZE - 1));
+                    if (x + TREE_REACH < origin.x || x - TREE_REACH >= origin.x + CHUNK_SIZE ||
+                        z + TREE_REACH < origin.z || z - TREE_REACH >= origin.z + CHUNK_SIZE)
+                    {
+                        continue; // Cannot reach this chunk
+                    }
+
+                    Biome biome;
+                    int ground = columnHeight(seed, heights, column, x, z, biome);
+                    int trunk_height = MIN_TRUNK_HEIGHT + static_cast<int>((r >> 16) % (MAX_TRUNK_HEIGHT - MIN_TRUNK_HEIGHT + 1));
+                    if (!BIOME_INFO[biome].has_trees || ground + trunk_height + 2 <= origin.y ||
+                        ground >= origin.y + CHUNK_HEIGHT)
+                    {
+                        continue; // Nothing grows in that biome, or not in this chunk's layers
+                    }
+                    plantTree(writer, glm::ivec3(x, ground, z), trunk_height, r >> 24);
+                }
+            }
+        }
+    }
+
+    // Veins of up to 19 voxels around a center at least one voxel from every chunk face
+    for (int vein = 0; vein < ORE_VEINS; vein++)
+    {
+        uint64_t r = hashCoords(seed, chunk_pos.x, chunk_pos.y, chunk_pos.z, ORE_SALT + vein);
+        if ((r & 1) != 0)
+        {
+            continue;
+        }
+        glm::ivec3 center = origin + glm::ivec3(1 + static_cast<int>((r >> 8) % (CHUNK_SIZE - 2)),
+                                                1 + static_cast<int>((r >> 16) % (CHUNK_HEIGHT - 2)),
+                                                1 + static_cast<int>((r >> 24) % (CHUNK_SIZE - 2)));
+        if (center.y < ORE_MIN_Y || center.y >= ORE_MAX_Y)
+        {
+            continue;
+        }
+        uint32_t shape = static_cast<uint32_t>(r >> 32);
+        int bit = 0;
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                for (int dz = -1; dz <= 1; dz++)
+                {
+                    int distance = dx * dx + dy * dy + dz * dz;
+                    if (distance > 2)
+                    {
+                        continue; // Corners
+                    }
+                    if (distance == 0 || ((shape >> bit++) & 1))
+                    {
+                        writer.place(center + glm::ivec3(dx, dy, dz), VOXEL_IRON);
+                    }
+                }
+            }
+        }
+    }
+    return writer.placed;
+}
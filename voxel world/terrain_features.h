@@ -0,0 +1,44 @@
+#ifndef TERRAIN_FEATURES_H
+#define TERRAIN_FEATURES_H
+
+#include "voxel_types.h"
+#include "density_terrain.h"
+#include <glm/glm/glm.hpp>
+#include <cstdint>
+
+class HeightFieldCache;
+class PaletteStorage;
+
+// Decoration pass over freshly generated terrain: trees in the biomes that have them
+// (BiomeInfo::has_trees) and iron veins in the stone of the terrain layers (rock deeper down
+// stays plain, so the world below them is uniform).
+//
+// Everything is placed from hashes of the seed and world coordinates, so no chunk depends on
+// what its neighbors generated or in which order. A tree is anchored in one chunk column but
+// its canopy can reach TREE_REACH voxels into the next: every chunk plants the trees of its
+// own column and of the eight around it and keeps the voxels that fall inside itself, so the
+// parts spilling over are already there when the neighbor generates, and no chunk meshed
+// before has to change. Ore veins stay inside their chunk.
+//
+// Trees need the surface height of their anchor, so they are only planted on height field
+// terrain; density terrain moves the surface by up to OVERHANG_AMPLITUDE.
+class TerrainFeatures
+{
+public:
+    static constexpr int TREE_REACH = 2;        // Canopy radius around the trunk
+    static constexpr int TREE_ATTEMPTS = 3;     // Chances per chunk column, one in four each
+    static constexpr int MIN_TRUNK_HEIGHT = 4;
+    static constexpr int MAX_TRUNK_HEIGHT = 6;
+    static constexpr int ORE_MIN_Y = 0;         // Veins are centered from this world height
+    static constexpr int ORE_MAX_Y = 48;        // up to below this one
+    static constexpr int ORE_VEINS = 4;         // Chances per chunk, one in two each
+    static_assert(TREE_REACH < CHUNK_SIZE, "Trees may only reach into the adjacent columns");
+
+    // Any thread, after the base terrain of the chunk at chunk_pos is written to voxels
+    // (coordsToIndex order). heights serves the height tiles of the surrounding columns; null
+    // samples the noise directly, as VoxelChunk does without a cache. Returns the voxels placed.
+    static int decorate(uint32_t seed, const glm::ivec3 &chunk_pos, TerrainMode mode, HeightFieldCache *heights,
+                        PaletteStorage &voxels);
+};
+
+#endif // TERRAIN_FEATURES_H
@@ -0,0 +1,108 @@
+#ifndef TERRAIN_SPLINE_H
+#define TERRAIN_SPLINE_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+struct SplinePoint
+{
+    float input;  // Noise value
+    float output; // terrain height (y)
+};
+
+// Piecewise-linear curve through N points with increasing inputs, clamped outside them.
+// A literal type, so curves are compile-time constants and can be baked into a SplineLut.
+template <size_t N>
+struct TerrainSpline
+{
+    static_assert(N >= 2, "A spline needs at least two points");
+
+    SplinePoint points[N];
+
+    static constexpr size_t size() { return N; }
+
+    // Exact value at t by scanning for the surrounding segment
+    constexpr float eval(float t) const
+    {
+        if (t <= points[0].input)
+            return points[0].output;
+        for (size_t i = 0; i + 1 < N; ++i)
+        {
+            if (t <= points[i + 1].input)
+            {
+                float local = (t - points[i].input) / (points[i + 1].input - points[i].input);
+                return points[i].output + local * (points[i + 1].output - points[i].output);
+            }
+        }
+        return points[N - 1].output;
+    }
+
+    // Exact values over an array; the inner loops have no data-dependent control flow, so
+    // they vectorize
+    void evalBatch(const float *t, float *out, size_t count) const
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[i] = points[0].output;
+        }
+        // Each segment adds its rise scaled by how far t got through it (0 before, 1 after)
+        for (size_t p = 0; p + 1 < N; ++p)
+        {
+            const float start = points[p].input;
+            const float inv_span = 1.0f / (points[p + 1].input - start);
+            const float rise = points[p + 1].output - points[p].output;
+            for (size_t i = 0; i < count; ++i)
+            {
+                float local = std::min(1.0f, std::max(0.0f, (t[i] - start) * inv_span));
+                out[i] += local * rise;
+            }
+        }
+    }
+};
+
+// A spline resampled at SIZE uniform steps over the noise range [-1, 1]. Evaluation is a clamp,
+// one table lookup pair and a lerp, whatever the number of points; it matches the spline
+// exactly at sample steps and within a fraction of a block in between.
+template <size_t SIZE = 1024>
+struct SplineLut
+{
+    static_assert(SIZE >= 2, "A lookup table needs at least two samples");
+
+    static constexpr float INPUT_LOW = -1.0f;
+    static constexpr float INPUT_HIGH = 1.0f;
+    static constexpr float SAMPLES_PER_UNIT = (SIZE - 1) / (INPUT_HIGH - INPUT_LOW);
+
+    std::array<float, SIZE> values{};
+
+    static constexpr size_t size() { return SIZE; }
+
+    template <size_t N>
+    static constexpr SplineLut build(const TerrainSpline<N> &spline)
+    {
+        SplineLut lut;
+        for (size_t i = 0; i < SIZE; ++i)
+        {
+            lut.values[i] = spline.eval(INPUT_LOW + static_cast<float>(i) / SAMPLES_PER_UNIT);
+        }
+        return lut;
+    }
+
+    float eval(float t) const
+    {
+        float position = (std::min(INPUT_HIGH, std::max(INPUT_LOW, t)) - INPUT_LOW) * SAMPLES_PER_UNIT;
+        size_t index = std::min(static_cast<size_t>(position), SIZE - 2);
+        float local = position - static_cast<float>(index);
+        return values[index] + local * (values[index + 1] - values[index]);
+    }
+
+    void evalBatch(const float *t, float *out, size_t count) const
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[i] = eval(t[i]);
+        }
+    }
+};
+
+#endif // TERRAIN_SPLINE_H
@@ -0,0 +1,149 @@
+#include "translucency_target.h"
+#include "../shader.h"
+#include <iostream>
+
+bool TranslucencyTarget::isSupported()
+{
+#ifdef GL_VERSION_4_0
+    return GLAD_GL_VERSION_4_0 != 0;
+#else
+    return false;
+#endif
+}
+
+TranslucencyTarget::TranslucencyTarget(std::unique_ptr<Shader> composite)
+    : composite_shader(std::move(composite))
+{
+    glGenVertexArrays(1, &empty_vao);
+    composite_shader->use();
+    composite_shader->setInt("accumulation", 0);
+    composite_shader->setInt("revealage", 1);
+}
+
+TranslucencyTarget::~TranslucencyTarget()
+{
+    release();
+    glDeleteVertexArrays(1, &empty_vao);
+}
+
+bool TranslucencyTarget::begin(GLuint depth_buffer, int target_width, int target_height)
+{
+#ifdef GL_VERSION_4_0
+    if ((target_width != width || target_height != height) && !resize(target_width, target_height))
+    {
+        return false;
+    }
+
+    // Attached every frame: a recreated scene buffer may come back under the same name
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_buffer);
+    if (depth_buffer != attached_depth)
+    {
+        attached_depth = depth_buffer;
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cerr << "Translucency target: framebuffer incomplete" << std::endl;
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            attached_depth = 0;
+            return false;
+        }
+    }
+
+    // Nothing accumulated, everything revealed
+    const GLfloat no_color[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    const GLfloat revealed[4] = {1.0f, 0.0f, 0.0f, 0.0f};
+    glClearBufferfv(GL_COLOR, 0, no_color);
+    glClearBufferfv(GL_COLOR, 1, revealed);
+
+    glEnable(GL_BLEND);
+    glBlendFunci(0, GL_ONE, GL_ONE);
+    glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void TranslucencyTarget::resolve(GLuint scene_framebuffer)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, scene_framebuffer);
+
+    // result = average * (1 - revealage) + scene * revealage
+    GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+
+    composite_shader->use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, accumulation_texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, revealage_texture);
+    glBindVertexArray(empty_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glDisable(GL_BLEND);
+    if (depth_test)
+    {
+        glEnable(GL_DEPTH_TEST);
+    }
+}
+
+bool TranslucencyTarget::resize(int new_width, int new_height)
+{
+    release();
+    if (new_width <= 0 || new_height <= 0)
+    {
+        return false;
+    }
+    width = new_width;
+    height = new_height;
+
+    auto createTexture = [this](GLuint &texture, GLint internal_format, GLenum format, GLenum type)
+    {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    };
+    createTexture(accumulation_texture, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
+    createTexture(revealage_texture, GL_R8, GL_RED, GL_UNSIGNED_BYTE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // The depth attachment follows in begin (the scene's buffer is recreated with it)
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumulation_texture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, revealage_texture, 0);
+    const GLenum draw_buffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, draw_buffers);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return true;
+}
+
+void TranslucencyTarget::release()
+{
+    if (framebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+        framebuffer = 0;
+    }
+    GLuint textures[] = {accumulation_texture, revealage_texture};
+    for (GLuint texture : textures)
+    {
+        if (texture != 0)
+        {
+            glDeleteTextures(1, &texture);
+        }
+    }
+    accumulation_texture = 0;
+    revealage_texture = 0;
+    attached_depth = 0;
+    width = 0;
+    height = 0;
+}
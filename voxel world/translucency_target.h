@@ -0,0 +1,51 @@
+#ifndef TRANSLUCENCY_TARGET_H
+#define TRANSLUCENCY_TARGET_H
+
+#include <glad/glad/glad.h>
+#include <memory>
+
+class Shader;
+
+// Weighted blended order-independent transparency (McGuire and Bavoil, 2013) for the
+// translucent pass. Fragments add premultiplied color times a depth weight, and their alpha
+// times that weight, to an RGBA16F accumulation texture, and multiply (1 - alpha) into an R8
+// revealage texture. resolve() then lays the weighted average over the scene, covering it by
+// 1 - revealage. Both sums commute, so translucent quads need no sorting, across chunks or
+// inside one. Per-attachment blending needs OpenGL 4.0.
+//
+// The pass tests against the scene's depth buffer (SceneTarget), attached to this target's
+// framebuffer, without writing it. Main thread only.
+class TranslucencyTarget
+{
+public:
+    static bool isSupported();
+
+    // composite: oit_composite.vs/.fs, which resolve() draws with
+    explicit TranslucencyTarget(std::unique_ptr<Shader> composite);
+    ~TranslucencyTarget();
+
+    TranslucencyTarget(const TranslucencyTarget &) = delete;
+    TranslucencyTarget &operator=(const TranslucencyTarget &) = delete;
+
+    // Bind for the translucent draws with the scene's depth buffer attached, textures cleared
+    // and the accumulation blending set; false (nothing bound) if the framebuffer is incomplete
+    bool begin(GLuint depth_buffer, int width, int height);
+    // Composite the accumulated fragments into scene_framebuffer, which stays bound; blending
+    // is left disabled
+    void resolve(GLuint scene_framebuffer);
+
+private:
+    std::unique_ptr<Shader> composite_shader;
+    GLuint framebuffer = 0;
+    GLuint accumulation_texture = 0;
+    GLuint revealage_texture = 0;
+    GLuint empty_vao = 0; // The composite's fullscreen triangle comes from gl_VertexID
+    GLuint attached_depth = 0; // Depth buffer the framebuffer was last checked complete with
+    int width = 0;
+    int height = 0;
+
+    bool resize(int new_width, int new_height);
+    void release();
+};
+
+#endif // TRANSLUCENCY_TARGET_H
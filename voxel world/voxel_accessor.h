@@ -0,0 +1,92 @@
+#ifndef VOXEL_ACCESSOR_H
+#define VOXEL_ACCESSOR_H
+
+#include "voxel_types.h"
+#include "voxel_chunk.h"
+#include "voxel_world.h"
+#include <glm/glm/glm.hpp>
+#include <algorithm>
+#include <climits>
+
+// World-space voxel reads for loops that walk neighbouring voxels (raycasts, flood fills,
+// collision sweeps). The last chunk looked up is cached, so consecutive reads in the same
+// chunk cost a compare and a mask instead of a chunk lookup.
+//
+// The cached pointer is only valid until the world next loads or unloads chunks: keep an
+// accessor local to one pass and never across VoxelWorld::update (or call invalidate()).
+class VoxelAccessor
+{
+public:
+    explicit VoxelAccessor(const VoxelWorld &world) : world(world) {}
+
+    VoxelID get(int x, int y, int z)
+    {
+        const VoxelChunk *chunk = lookup(glm::ivec3(x >> CHUNK_SIZE_SHIFT, y >> CHUNK_HEIGHT_SHIFT, z >> CHUNK_SIZE_SHIFT));
+        if (!chunk)
+        {
+            return VOXEL_AIR; // Unloaded reads as air, like VoxelWorld::getVoxel
+        }
+        return chunk->voxels.get(
+            VoxelChunk::coordsToIndex(x & CHUNK_SIZE_MASK, y & CHUNK_HEIGHT_MASK, z & CHUNK_SIZE_MASK));
+    }
+
+    VoxelID get(const glm::ivec3 &pos) { return get(pos.x, pos.y, pos.z); }
+
+    // Whether any voxel of the run z0..z1 (inclusive) at x, y is solid, tested a chunk row at
+    // a time on VoxelChunk::getSolidRows. For collision, unloaded chunks count as solid
+    // (nothing falls into terrain still streaming in), except implicit ones, which are as
+    // solid as their voxel.
+    bool anySolid(int x, int y, int z0, int z1)
+    {
+        int chunk_y = y >> CHUNK_HEIGHT_SHIFT;
+        int row = VoxelChunk::solidRowIndex(x & CHUNK_SIZE_MASK, y & CHUNK_HEIGHT_MASK);
+        for (int z = z0; z <= z1;)
+        {
+            int chunk_z = z >> CHUNK_SIZE_SHIFT;
+            int last = std::min(z1, chunk_z * CHUNK_SIZE + CHUNK_SIZE_MASK);
+            const VoxelChunk *chunk = lookup(glm::ivec3(x >> CHUNK_SIZE_SHIFT, chunk_y, chunk_z));
+            if (!chunk)
+            {
+                VoxelID implicit = world.getImplicitVoxel(glm::ivec3(x >> CHUNK_SIZE_SHIFT, chunk_y, chunk_z));
+                if (implicit == VOXEL_NONE || isVoxelSolid(implicit))
+                {
+                    return true;
+                }
+            }
+            else
+            {
+                uint32_t bits = ((1u << (last - z + 1)) - 1) << (z & CHUNK_SIZE_MASK);
+                if (chunk->getSolidRows()[row] & bits)
+                {
+                    return true;
+                }
+            }
+            z = last + 1;
+        }
+        return false;
+    }
+
+    // Drop the cached chunk (after chunks were loaded or unloaded)
+    void invalidate()
+    {
+        cached_pos = glm::ivec3(INT_MIN);
+        cached_chunk = nullptr;
+    }
+
+private:
+    const VoxelChunk *lookup(const glm::ivec3 &chunk_pos)
+    {
+        if (chunk_pos != cached_pos)
+        {
+            cached_pos = chunk_pos;
+            cached_chunk = world.getChunk(chunk_pos);
+        }
+        return cached_chunk;
+    }
+
+    const VoxelWorld &world;
+    glm::ivec3 cached_pos{INT_MIN}; // No chunk; a shifted coordinate is never INT_MIN
+    const VoxelChunk *cached_chunk = nullptr;
+};
+
+#endif // VOXEL_ACCESSOR_H
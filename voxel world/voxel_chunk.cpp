@@ -1,19 +1,30 @@
 #include "voxel_chunk.h"
 #include "voxel_world.h"
 #include "voxel_noise.h"
+#include "height_field_cache.h"
+#if VOXEL_HEADLESS
+#include "headless_mesh.h"
+#else
 #include "chunk_mesh.h"
+#endif
+#include "chunk_snapshot.h"
+#include "terrain_features.h"
+#include "profiler.h"
+#include "log.h"
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <climits>
 #include <cmath>
 #include <chrono>
 #include <string>
+#include <utility>
 
 VoxelChunk::VoxelChunk(const glm::ivec3 &pos)
-    : position(pos), version(0), generation_seed(0), is_generated(false), is_dirty(false), is_mesh_dirty(false), is_meshing(false)
+    : position(pos), version(0), generation_seed(0), is_generated(false), is_dirty(false), is_mesh_dirty(false), is_meshing(false),
+      dirty_mesh_sections(ALL_MESH_SECTIONS), has_pending_edit(false), face_connectivity(FACE_CONNECTIVITY_ALL), voxels(VOLUME, VOXEL_AIR)
 {
-    voxels.fill(VOXEL_AIR);
     neighbors.fill(nullptr);
-    mesh = std::make_unique<ChunkMesh>();
-    has_column_cache = false;
     has_extended_noise_cache = false;
 }
 
@@ -22,13 +33,51 @@ VoxelChunk::~VoxelChunk()
     // ChunkMesh destructor will handle cleanup
 }
 
+void VoxelChunk::reset(const glm::ivec3 &pos)
+{
+    position = pos;
+    version = 0;
+    generation_seed = 0;
+    is_generated = false;
+    is_dirty = false;
+    is_mesh_dirty = false;
+    is_meshing = false;
+    dirty_mesh_sections = ALL_MESH_SECTIONS;
+    pending_edit_sections = 0;
+    has_pending_edit = false;
+    pipeline = {};
+    mesh_dirty_list = nullptr;
+    is_mesh_listed = false;
+    is_loaded = false;
+    predicted_faces = 0;
+    face_connectivity = FACE_CONNECTIVITY_ALL;
+    voxels.reset(VOXEL_AIR);
+    light.reset(0);
+    neighbors.fill(nullptr);
+    has_noise_seed = false;
+    height_cache = nullptr;
+    has_extended_noise_cache = false;
+    min_extended_height = 0;
+    max_extended_height = 0;
+    terrain_mode = TerrainMode::Heightmap;
+    shell_overrides.clear();
+    solid_rows_version = UINT64_MAX;
+    occupancy_version = UINT64_MAX;
+    emitters.clear();
+    emitters_version = UINT64_MAX;
+    last_active = {};
+    last_active_version = UINT64_MAX;
+    voxels_idle_packed = false;
+    light_idle_packed = false;
+}
+
 VoxelID VoxelChunk::getVoxel(int x, int y, int z) const
 {
     if (!isInBounds(x, y, z))
     {
         return VOXEL_AIR;
     }
-    return voxels[coordsToIndex(x, y, z)];
+    return voxels.get(coordsToIndex(x, y, z));
 }
 
 VoxelID VoxelChunk::getVoxel(const glm::ivec3 &pos) const
@@ -38,45 +87,263 @@ VoxelID VoxelChunk::getVoxel(const glm::ivec3 &pos) const
 
 void VoxelChunk::setVoxel(int x, int y, int z, VoxelID voxel)
 {
-    if (!isInBounds(x, y, z))
+    BorderChanges changed_borders;
+    if (setVoxelDeferred(x, y, z, voxel, changed_borders))
     {
-        return;
+        commitEdits(changed_borders);
     }
+}
 
-    int index = coordsToIndex(x, y, z);
-    if (voxels[index] != voxel)
+const uint16_t *VoxelChunk::getSolidRows() const
+{
+    static_assert(SIZE == 16, "Solid rows hold a chunk row along z in 16 bits");
+    static const std::vector<uint16_t> all_solid(SIZE * HEIGHT, 0xFFFF);
+    static const std::vector<uint16_t> none_solid(SIZE * HEIGHT, 0);
+    if (isUniform())
+    {
+        return isVoxelSolid(getUniformVoxel()) ? all_solid.data() : none_solid.data();
+    }
+    if (solid_rows_version == version)
     {
-        voxels[index] = voxel;
-        version++;
-        is_dirty = true;
-        is_mesh_dirty = true;
+        return solid_rows.data();
+    }
 
-        // Mark neighboring chunks as dirty if we're on a boundary
-        if (x == 0 && neighbors[NEIGHBOR_LEFT])
+    // Decoded once instead of a palette lookup per voxel
+    thread_local std::vector<VoxelID> decoded(VOLUME);
+    decodeVoxels(decoded.data());
+    solid_rows.resize(SIZE * HEIGHT);
+    for (int x = 0; x < SIZE; x++)
+    {
+        for (int y = 0; y < HEIGHT; y++)
         {
-            neighbors[NEIGHBOR_LEFT]->is_mesh_dirty = true;
+            const VoxelID *row = decoded.data() + coordsToIndex(x, y, 0);
+            uint16_t bits = 0;
+            for (int z = 0; z < SIZE; z++)
+            {
+                bits |= static_cast<uint16_t>(isVoxelSolid(row[ChunkIndexing::offsetZ(z)])) << z;
+            }
+            solid_rows[solidRowIndex(x, y)] = bits;
         }
-        if (x == SIZE - 1 && neighbors[NEIGHBOR_RIGHT])
+    }
+    solid_rows_version = version;
+    return solid_rows.data();
+}
+
+const ChunkOccupancy &VoxelChunk::getOccupancy() const
+{
+    if (occupancy_version == version)
+    {
+        return *occupancy;
+    }
+    if (!occupancy)
+    {
+        occupancy = std::make_unique<ChunkOccupancy>();
+    }
+
+    if (isUniform())
+    {
+        occupancy->fillUniform(getUniformVoxel());
+    }
+    else
+    {
+        thread_local std::vector<VoxelID> decoded(VOLUME);
+        decodeVoxels(decoded.data());
+        summarizeOccupancy(decoded.data(), *occupancy);
+    }
+    occupancy_version = version;
+    return *occupancy;
+}
+
+const std::vector<VoxelEmitter> &VoxelChunk::getEmitters() const
+{
+    if (emitters_version == version)
+    {
+        return emitters;
+    }
+
+    emitters.clear();
+    const std::vector<VoxelID> &palette = voxels.getPalette();
+    if (std::any_of(palette.begin(), palette.end(), [](VoxelID voxel) { return getLightEmission(voxel) > 0; }))
+    {
+        thread_local std::vector<VoxelID> decoded(VOLUME);
+        decodeVoxels(decoded.data());
+        for (int index = 0; index < VOLUME; index++)
         {
-            neighbors[NEIGHBOR_RIGHT]->is_mesh_dirty = true;
+            if (getLightEmission(decoded[index]) > 0)
+            {
+                emitters.push_back({static_cast<uint16_t>(index), decoded[index]});
+            }
         }
-        if (y == 0 && neighbors[NEIGHBOR_BOTTOM])
+    }
+    emitters_version = version;
+    return emitters;
+}
+
+bool VoxelChunk::setVoxelDeferred(int x, int y, int z, VoxelID voxel, BorderChanges &changed_borders)
+{
+    if (!isInBounds(x, y, z))
+    {
+        return false;
+    }
+
+    // Summarized once before the first edit, then kept current edit by edit (commitEdits
+    // carries it over to the new version)
+    ChunkOccupancy &summary = const_cast<ChunkOccupancy &>(getOccupancy());
+    VoxelID previous = voxels.set(coordsToIndex(x, y, z), voxel);
+    if (previous == voxel)
+    {
+        return false;
+    }
+    summary.update(x, y, z, previous, voxel);
+    if (emitters_version == version)
+    {
+        const uint16_t index = static_cast<uint16_t>(coordsToIndex(x, y, z));
+        if (getLightEmission(previous) > 0)
         {
-            neighbors[NEIGHBOR_BOTTOM]->is_mesh_dirty = true;
+            auto it = std::find_if(emitters.begin(), emitters.end(), [index](const VoxelEmitter &e) { return e.index == index; });
+            *it = emitters.back();
+            emitters.pop_back();
         }
-        if (y == HEIGHT - 1 && neighbors[NEIGHBOR_TOP])
+        if (getLightEmission(voxel) > 0)
         {
-            neighbors[NEIGHBOR_TOP]->is_mesh_dirty = true;
+            emitters.push_back({index, voxel});
         }
-        if (z == 0 && neighbors[NEIGHBOR_BACK])
+    }
+
+    // Faces of this voxel and of the voxels above and below it change
+    pending_edit_sections |= getSectionsAround(y);
+    if (!isSameForMeshing(previous, voxel))
+    {
+        addBorderChange(x, y, z, changed_borders);
+    }
+    return true;
+}
+
+size_t VoxelChunk::pasteVoxels(const PaletteStorage &source, const uint64_t *mask, BorderChanges &changed_borders,
+                               std::vector<VoxelChange> &changes)
+{
+    thread_local std::array<VoxelID, VOLUME> current;
+    thread_local std::array<VoxelID, VOLUME> pasted;
+    voxels.decodeAll(current.data());
+    source.decodeAll(pasted.data());
+
+    const size_t first_change = changes.size();
+    uint64_t changed_layers = 0; // Bit per y
+    for (int word = 0; word < VOLUME / 64; word++)
+    {
+        for (uint64_t bits = mask[word]; bits != 0; bits &= bits - 1)
         {
-            neighbors[NEIGHBOR_BACK]->is_mesh_dirty = true;
+            const int index = word * 64 + std::countr_zero(bits);
+            if (current[index] == pasted[index])
+            {
+                continue;
+            }
+            changes.push_back({static_cast<uint16_t>(index), current[index], pasted[index]});
+            current[index] = pasted[index];
+
+            const int y = ChunkIndexing::getY(index);
+            changed_layers |= uint64_t(1) << y;
+            if (!isSameForMeshing(changes.back().previous, changes.back().voxel))
+            {
+                addBorderChange(ChunkIndexing::getX(index), y, ChunkIndexing::getZ(index), changed_borders);
+            }
         }
-        if (z == SIZE - 1 && neighbors[NEIGHBOR_FRONT])
+    }
+    const size_t changed = changes.size() - first_change;
+    if (changed == 0)
+    {
+        return 0;
+    }
+
+    // One repack for the whole slab; the occupancy summary and emitters are rebuilt rather than updated
+    voxels.assign(current.data());
+    occupancy_version = UINT64_MAX;
+    emitters_version = UINT64_MAX;
+    for (int y = 0; y < HEIGHT; y++)
+    {
+        if (changed_layers & (uint64_t(1) << y))
         {
-            neighbors[NEIGHBOR_FRONT]->is_mesh_dirty = true;
+            pending_edit_sections |= getSectionsAround(y); // Faces of the layer and the layers next to it
         }
     }
+    return changed;
+}
+
+uint8_t VoxelChunk::getSectionsAround(int y)
+{
+    int lowest = std::max(y - 1, 0) / MESH_SECTION_HEIGHT;
+    int highest = std::min(y + 1, HEIGHT - 1) / MESH_SECTION_HEIGHT;
+    uint8_t sections = 0;
+    for (int section = lowest; section <= highest; section++)
+    {
+        sections |= static_cast<uint8_t>(1u << section);
+    }
+    return sections;
+}
+
+void VoxelChunk::addBorderChange(int x, int y, int z, BorderChanges &changes)
+{
+    // Horizontal neighbors mesh the same layers as this chunk; vertical ones only see their
+    // layer next to it
+    const uint8_t around = getSectionsAround(y);
+    changes.sections[NEIGHBOR_LEFT] |= x == 0 ? around : 0;
+    changes.sections[NEIGHBOR_RIGHT] |= x == SIZE - 1 ? around : 0;
+    changes.sections[NEIGHBOR_BACK] |= z == 0 ? around : 0;
+    changes.sections[NEIGHBOR_FRONT] |= z == SIZE - 1 ? around : 0;
+    changes.sections[NEIGHBOR_BOTTOM] |= y == 0 ? static_cast<uint8_t>(1u << (MESH_SECTION_COUNT - 1)) : 0;
+    changes.sections[NEIGHBOR_TOP] |= y == HEIGHT - 1 ? 1 : 0;
+}
+
+void VoxelChunk::commitEdits(const BorderChanges &changed_borders)
+{
+    if (occupancy_version == version)
+    {
+        occupancy_version = version + 1;
+    }
+    if (emitters_version == version)
+    {
+        emitters_version = version + 1;
+    }
+    version++;
+    is_dirty = true;
+    markEditPending();
+    markMeshDirty(pending_edit_sections);
+
+    for (int direction = 0; direction < 6; direction++)
+    {
+        if (changed_borders.sections[direction] != 0 && neighbors[direction])
+        {
+            neighbors[direction]->markEditPending();
+            neighbors[direction]->markMeshDirty(changed_borders.sections[direction]);
+        }
+    }
+    pending_edit_sections = 0;
+}
+
+void VoxelChunk::markEditPending()
+{
+    if (!has_pending_edit)
+    {
+        has_pending_edit = true;
+        edit_time = std::chrono::steady_clock::now();
+    }
+}
+
+void VoxelChunk::markMeshDirty(uint8_t sections)
+{
+    is_mesh_dirty = true;
+    dirty_mesh_sections |= sections;
+    if (mesh_dirty_list && !is_mesh_listed)
+    {
+        is_mesh_listed = true;
+        mesh_dirty_list->push_back(position);
+    }
+}
+
+void VoxelChunk::markEditMeshDirty(uint8_t sections)
+{
+    markEditPending();
+    markMeshDirty(sections);
 }
 
 void VoxelChunk::setVoxel(const glm::ivec3 &pos, VoxelID voxel)
@@ -88,7 +355,7 @@ VoxelID VoxelChunk::getVoxelSafe(int x, int y, int z) const
 {
     if (isInBounds(x, y, z))
     {
-        return voxels[coordsToIndex(x, y, z)];
+        return voxels.get(coordsToIndex(x, y, z));
     }
 
     // Try to get from neighboring chunks
@@ -117,61 +384,95 @@ VoxelChunk *VoxelChunk::getNeighbor(int direction) const
     return nullptr;
 }
 
-void VoxelChunk::generate(uint32_t seed)
+void VoxelChunk::generate(uint32_t seed, HeightFieldCache *heights, TerrainMode mode)
 {
     if (is_generated)
     {
         return;
     }
 
+    PROFILE_ZONE("VoxelChunk::generate");
     auto generation_start = std::chrono::high_resolution_clock::now();
 
     generation_seed = seed;
+    terrain_mode = mode;
 
-    // Create / reset noise generator once
-    noise_generator = std::make_unique<VoxelNoise>(seed);
+    has_noise_seed = true;
+    height_cache = (heights && heights->getSeed() == seed) ? heights : nullptr;
 
     auto noise_cache_start = std::chrono::high_resolution_clock::now();
     // Pre-calculate noise for extended area (chunk + 1 block border on all sides)
-    calculateExtendedNoiseCache();
+    ExtendedColumns &columns = generationColumns();
+    calculateExtendedNoiseCache(columns);
     auto noise_cache_end = std::chrono::high_resolution_clock::now();
 
-    VoxelNoise &noise = *noise_generator;
     glm::ivec3 worldPos = position * glm::ivec3(SIZE, HEIGHT, SIZE);
 
     auto voxel_generation_start = std::chrono::high_resolution_clock::now();
     int voxels_processed = 0;
-    for (int x = 0; x < SIZE; x++)
+
+    // Chunks entirely above or below the terrain surface collapse to a single value. Density
+    // terrain is written after the column loop, which then only records the heights.
+    const bool is_density = terrain_mode == TerrainMode::Density;
+    VoxelID uniform_voxel = is_density ? VOXEL_NONE : classifyUniformChunk();
+    bool is_uniform = uniform_voxel != VOXEL_NONE;
+    if (is_uniform)
     {
-        for (int z = 0; z < SIZE; z++)
-        {
-            // Use cached terrain height instead of recalculating
-            int terrainHeight = getTerrainHeightFromCache(x, z);
-            column_heights[columnIndex(x, z)] = terrainHeight;
+        voxels.fill(uniform_voxel);
+    }
+    else if (!is_density)
+    {
+        voxels.reset(VOXEL_AIR); // Runs below only write the non-air part of each column
+    }
 
-            for (int y = 0; y < HEIGHT; y++)
+    // Writes a run of world heights [bottom, top) of one column straight into storage.
+    // Chunk state (version, dirty flags) is updated once below instead of per voxel.
+    auto fillRun = [&](int x, int z, int bottom, int top, VoxelID voxel)
+    {
+        bottom = std::max(bottom - worldPos.y, 0);
+        top = std::min(top - worldPos.y, HEIGHT);
+        if (bottom < top)
+        {
+            if constexpr (ChunkIndexing::LINEAR)
             {
-                int worldY = worldPos.y + y;
-                VoxelID voxel = VOXEL_AIR;
-                if (worldY < terrainHeight - 3)
-                    voxel = VOXEL_STONE;
-                else if (worldY < terrainHeight - 1)
-                    voxel = VOXEL_DIRT;
-                else if (worldY < terrainHeight)
-                    voxel = VOXEL_GRASS;
-                else if (worldY <= WATER_LEVEL && worldY >= terrainHeight)
-                    voxel = VOXEL_WATER;
-                setVoxel(x, y, z, voxel);
-                voxels_processed++;
+                voxels.setStrided(coordsToIndex(x, bottom, z), top - bottom, ChunkIndexing::offsetY(1), voxel);
             }
+            else
+            {
+                for (int y = bottom; y < top; y++)
+                {
+                    voxels.set(coordsToIndex(x, y, z), voxel);
+                }
+            }
+            voxels_processed += top - bottom;
+        }
+    };
+
+    for (int x = 0; x < SIZE && !is_uniform && !is_density; x++)
+    {
+        for (int z = 0; z < SIZE; z++)
+        {
+            // Stone, then the biome's filler and top block up to the surface, water from there
+            // to sea level; the rest stays air from the reset above
+            int terrainHeight = columns.heights[extendedIndex(x, z)];
+            const BiomeInfo &biome = BIOME_INFO[columns.biomes[extendedIndex(x, z)]];
+            fillRun(x, z, INT_MIN / 2, terrainHeight - SURFACE_DEPTH, VOXEL_STONE);
+            fillRun(x, z, terrainHeight - SURFACE_DEPTH, terrainHeight - 1, biome.filler);
+            fillRun(x, z, terrainHeight - 1, terrainHeight, biome.surface);
+            fillRun(x, z, terrainHeight, WATER_LEVEL + 1, VOXEL_WATER);
         }
     }
+    if (is_density)
+    {
+        voxels_processed = generateDensityVoxels(true, columns);
+    }
+    voxels_processed += TerrainFeatures::decorate(generation_seed, position, terrain_mode, height_cache, voxels);
     auto voxel_generation_end = std::chrono::high_resolution_clock::now();
 
-    has_column_cache = true;
+    LightPropagator::computeChunk(*this);
     is_generated = true;
     is_dirty = false;
-    is_mesh_dirty = true;
+    markMeshDirty();
     is_meshing = false;
     version++;
 
@@ -182,7 +483,11 @@ void VoxelChunk::generate(uint32_t seed)
     float voxel_gen_time = std::chrono::duration<float, std::milli>(voxel_generation_end - voxel_generation_start).count();
     float total_generation_time = std::chrono::duration<float, std::milli>(generation_end - generation_start).count();
 
-    if (total_generation_time > 5.0f) // Only log if generation takes more than 5ms
+    if (total_generation_time > 5.0f) // Only count generations that take more than 5ms
+    {
+        Log::recordSlow("chunk generations", total_generation_time);
+    }
+    if (total_generation_time > 5.0f && Log::isEnabled(LogLevel::Debug))
     {
         std::string log_message =
             "CHUNK GENERATION TIMING for chunk (" + std::to_string(position.x) + ", " +
@@ -191,204 +496,359 @@ void VoxelChunk::generate(uint32_t seed)
             "  Voxel Generation: " + std::to_string(voxel_gen_time) + "ms (" +
             std::to_string(voxels_processed) + " voxels)\n" +
             "  TOTAL GENERATION: " + std::to_string(total_generation_time) + "ms\n" +
-            "  Cache entries: " + std::to_string((SIZE + 2) * (SIZE + 2)) + "\n";
+            "  Cache entries: " + std::to_string((SIZE + 2) * (SIZE + 2));
 
-        std::cout << log_message << std::endl;
+        Log::write(LogLevel::Debug, std::move(log_message));
     }
 }
 
-void VoxelChunk::calculateExtendedNoiseCache()
+void VoxelChunk::markRestored(uint32_t seed, HeightFieldCache *heights, TerrainMode mode)
 {
-    if (!noise_generator)
+    generation_seed = seed;
+    terrain_mode = mode;
+    has_noise_seed = true;
+    height_cache = (heights && heights->getSeed() == seed) ? heights : nullptr;
+
+    // Still needed for predicting unloaded neighbors while meshing
+    ExtendedColumns &columns = generationColumns();
+    calculateExtendedNoiseCache(columns);
+    if (terrain_mode == TerrainMode::Density)
     {
-        return;
+        generateDensityVoxels(false, columns);
     }
 
-    VoxelNoise &noise = *noise_generator;
-    glm::ivec3 worldPos = position * glm::ivec3(SIZE, HEIGHT, SIZE);
+    LightPropagator::computeChunk(*this);
+    is_generated = true;
+    is_dirty = false; // Matches what is saved
+    markMeshDirty();
+    is_meshing = false;
+    version++;
+}
 
-    // Static splines
-    static const std::vector<SplinePoint> continentalSpline = {
-        {-1.0f, 30.0f}, {-0.5f, 50.0f}, {0.0f, 80.0f}, {0.3f, 100.0f}, {0.6f, 130.0f}, {1.0f, 160.0f}};
-    static const std::vector<SplinePoint> erosionSpline = {
-        {-1.0f, 0.0f}, {0.0f, 10.0f}, {0.5f, 25.0f}, {1.0f, 40.0f}};
+bool VoxelChunk::isColumnOpenToSky(int x, int z) const
+{
+    // Ground stops below the column height; overhangs reach up to OVERHANG_AMPLITUDE above it.
+    // The clamped surface still compares the same against the top of the chunk.
+    int surface = terrain_columns[extendedIndex(x, z)].ground_top;
+    if (terrain_mode == TerrainMode::Density)
+    {
+        return HEIGHT >= surface + DensityTerrain::OVERHANG_AMPLITUDE;
+    }
+    return HEIGHT >= surface;
+}
 
-    float noiseScale = 0.005f;
+VoxelChunk::ExtendedColumns &VoxelChunk::generationColumns()
+{
+    thread_local ExtendedColumns columns;
+    return columns;
+}
 
-    // Pre-allocate arrays for batch noise processing if available
-    const int cacheSize = (SIZE + 2) * (SIZE + 2);
+void VoxelChunk::calculateExtendedNoiseCache(ExtendedColumns &columns)
+{
+    if (!has_noise_seed)
+    {
+        return;
+    }
 
+    PROFILE_ZONE("VoxelChunk::calculateExtendedNoiseCache");
+    const int noise_calculations = (SIZE + 2) * (SIZE + 2);
     auto noise_calculation_start = std::chrono::high_resolution_clock::now();
-    int noise_calculations = 0;
 
-    // Calculate for minimal extended area: -1 to SIZE (inclusive) in both X and Z
-    // Only cache the 1-block border we actually need for meshing
-    for (int x = -1; x <= SIZE; x++)
+    // Minimal extended area: -1 to SIZE (inclusive) in both X and Z, i.e. the 1-block border
+    // meshing needs. Indexing matches the cache: (x + 1) * (SIZE + 2) + (z + 1)
+    if (height_cache)
     {
-        for (int z = -1; z <= SIZE; z++)
+        // Own column plus the edge (and corner) columns of the 8 surrounding tiles
+        HeightFieldCache::TileHandle tiles[3][3];
+        for (int dx = -1; dx <= 1; dx++)
         {
-            int worldX = worldPos.x + x;
-            int worldZ = worldPos.z + z;
-
-            auto clamp = [](float v) -> float
-            { return std::max(-1.0f, std::min(1.0f, v)); };
-
-            // Use faster noise lookups with reduced precision where possible
-            float noiseX = worldX * noiseScale;
-            float noiseZ = worldZ * noiseScale;
-
-            float continentalness = clamp(noise.getContinentalness(noiseX, noiseZ));
-            float erosion = clamp(noise.getErosion(noiseX, noiseZ));
-
-            float baseHeight = noise.evalSpline(continentalSpline, continentalness);
-            float erosionEffect = noise.evalSpline(erosionSpline, erosion);
-            float terrainHeightF = (baseHeight - erosionEffect);
+            for (int dz = -1; dz <= 1; dz++)
+            {
+                tiles[dx + 1][dz + 1] = height_cache->acquire(glm::ivec2(position.x + dx, position.z + dz));
+            }
+        }
 
-            // Only calculate expensive peaks/valleys for areas that need it
-            if (erosion < 0.3f)
+        for (int x = -1; x <= SIZE; x++)
+        {
+            int tileX = x < 0 ? 0 : (x < SIZE ? 1 : 2);
+            int localX = x - (tileX - 1) * SIZE;
+            for (int z = -1; z <= SIZE; z++)
             {
-                float peaksAndValleys = clamp(noise.getPeaksandValleysGenerator(noiseX, noiseZ));
-                float mountainFactor = std::max(0.0f, peaksAndValleys - erosion);
-                // Use faster approximation instead of pow(x, 1.5)
-                mountainFactor = mountainFactor * mountainFactor * sqrtf(mountainFactor);
-                terrainHeightF += mountainFactor * 50.0f;
+                int tileZ = z < 0 ? 0 : (z < SIZE ? 1 : 2);
+                int localZ = z - (tileZ - 1) * SIZE;
+                columns.heights[extendedIndex(x, z)] = tiles[tileX][tileZ]->get(localX, localZ);
+                columns.biomes[extendedIndex(x, z)] = tiles[tileX][tileZ]->getBiome(localX, localZ);
             }
+        }
+    }
+    else
+    {
+        glm::ivec3 worldPos = position * glm::ivec3(SIZE, HEIGHT, SIZE);
+        VoxelNoise::forThread(generation_seed).generateHeightField(worldPos.x - 1, worldPos.z - 1, SIZE + 2, SIZE + 2,
+                                                                   columns.heights.data(), 1, columns.biomes.data());
+    }
 
-            int terrainHeight = (int)terrainHeightF;
+    auto bounds = std::minmax_element(columns.heights.begin(), columns.heights.end());
+    min_extended_height = *bounds.first;
+    max_extended_height = *bounds.second;
 
-            // Store in extended cache (convert local coords to cache index)
-            int cacheX = x + 1; // -1 becomes 0, 0 becomes 1, etc.
-            int cacheZ = z + 1;
-            extended_terrain_heights[cacheX * (SIZE + 2) + cacheZ] = terrainHeight;
-            noise_calculations++;
-        }
+    // Beyond a few voxels outside the shell the exact height no longer changes the runs
+    const int bottom_y = position.y * HEIGHT;
+    for (int column = 0; column < EXTENDED_COLUMNS; column++)
+    {
+        int top = std::min(std::max(columns.heights[column] - bottom_y, -SURFACE_DEPTH - 1), HEIGHT + SURFACE_DEPTH + 1);
+        terrain_columns[column] = {static_cast<int8_t>(top), columns.biomes[column]};
     }
+
     auto noise_calculation_end = std::chrono::high_resolution_clock::now();
 
     has_extended_noise_cache = true;
 
-    // Log detailed noise timing if it's slow
+    // Count slow noise caches; the periodic summary reports them
     float noise_calc_time = std::chrono::duration<float, std::milli>(noise_calculation_end - noise_calculation_start).count();
     if (noise_calc_time > 8.0f)
     {
-        std::cout << "SLOW NOISE CACHE for chunk (" << position.x << ", " << position.y << ", " << position.z
-                  << "): " << noise_calc_time << "ms for " << noise_calculations << " calculations" << std::endl;
+        Log::recordSlow("noise caches", noise_calc_time);
     }
 }
 
-int VoxelChunk::getTerrainHeightFromCache(int x, int z) const
+VoxelID VoxelChunk::classifyUniformChunk() const
 {
     if (!has_extended_noise_cache)
     {
-        // Fallback to live calculation
-        return calculateTerrainHeightAt(x, z);
+        return VOXEL_NONE;
     }
 
-    // Convert to cache coordinates
-    int cacheX = x + 1;
-    int cacheZ = z + 1;
+    int bottomY = position.y * HEIGHT;
+    int topY = bottomY + HEIGHT - 1;
+
+    // Above every column (border included) and above the water line: all air
+    if (bottomY >= max_extended_height && bottomY > WATER_LEVEL)
+    {
+        return VOXEL_AIR;
+    }
 
-    if (cacheX >= 0 && cacheX < (SIZE + 2) && cacheZ >= 0 && cacheZ < (SIZE + 2))
+    // Below the stone line of every column (border included): all stone, and the
+    // predicted horizontal neighbors are stone as well
+    if (topY < min_extended_height - SURFACE_DEPTH)
     {
-        return extended_terrain_heights[cacheX * (SIZE + 2) + cacheZ];
+        return VOXEL_STONE;
     }
 
-    // Outside cache bounds - fallback
-    return calculateTerrainHeightAt(x, z);
+    return VOXEL_NONE; // Mixed
 }
 
-int VoxelChunk::calculateTerrainHeightAt(int x, int z) const
+int VoxelChunk::generateDensityVoxels(bool write_voxels, const ExtendedColumns &columns)
 {
-    if (!noise_generator)
+    shell_overrides.clear();
+    if (DensityTerrain::isAboveTerrain(position.y * HEIGHT, max_extended_height))
     {
-        return 64; // Default height
+        // All air, as the height field predicts
+        if (write_voxels)
+        {
+            voxels.fill(VOXEL_AIR);
+        }
+        return 0;
     }
 
-    VoxelNoise &noise = *noise_generator;
-    glm::ivec3 chunkBase = position * glm::ivec3(SIZE, HEIGHT, SIZE);
-    int worldX = chunkBase.x + x;
-    int worldZ = chunkBase.z + z;
+    thread_local std::vector<VoxelID> padded(ChunkSnapshot::PADDED_VOLUME);
+    DensityTerrain::generate(generation_seed, position, columns.heights.data(), columns.biomes.data(), padded.data());
 
-    static const std::vector<SplinePoint> continentalSpline = {
-        {-1.0f, 30.0f}, {-0.5f, 50.0f}, {0.0f, 80.0f}, {0.3f, 100.0f}, {0.6f, 130.0f}, {1.0f, 160.0f}};
-    static const std::vector<SplinePoint> erosionSpline = {
-        {-1.0f, 0.0f}, {0.0f, 10.0f}, {0.5f, 25.0f}, {1.0f, 40.0f}};
+    // Neighbors are predicted from the height field: keep the shell voxels where that is
+    // wrong, visited in padded index order
+    const int bottom_y = position.y * HEIGHT;
+    auto shell = [&](int x, int y, int z)
+    {
+        int index = ChunkSnapshot::paddedIndex(x, y, z);
+        int column = extendedIndex(x, z);
+        Biome biome = static_cast<Biome>(columns.biomes[column]);
+        if (padded[index] != predictHeightFieldVoxel(bottom_y + y, columns.heights[column], biome))
+        {
+            shell_overrides.push_back({static_cast<uint16_t>(index), padded[index]});
+        }
+    };
+    for (int x = -1; x <= SIZE; x++)
+    {
+        for (int y = -1; y <= HEIGHT; y++)
+        {
+            if (x < 0 || x == SIZE || y < 0 || y == HEIGHT)
+            {
+                for (int z = -1; z <= SIZE; z++)
+                {
+                    shell(x, y, z);
+                }
+            }
+            else
+            {
+                shell(x, y, -1);
+                shell(x, y, SIZE);
+            }
+        }
+    }
 
-    float noiseScale = 0.005f;
-    auto clamp = [](float v) -> float
-    { return std::max(-1.0f, std::min(1.0f, v)); };
+    if (!write_voxels)
+    {
+        return 0;
+    }
 
-    // Use faster noise lookups
-    float noiseX = worldX * noiseScale;
-    float noiseZ = worldZ * noiseScale;
+    // Interior rows into chunk order, then one packing pass
+    thread_local std::vector<VoxelID> interior(VOLUME);
+    int voxels_written = 0;
+    for (int x = 0; x < SIZE; x++)
+    {
+        for (int y = 0; y < HEIGHT; y++)
+        {
+            const VoxelID *row = padded.data() + ChunkSnapshot::paddedIndex(x, y, 0);
+            VoxelID *target = interior.data() + coordsToIndex(x, y, 0);
+            for (int z = 0; z < SIZE; z++)
+            {
+                target[ChunkIndexing::offsetZ(z)] = row[z];
+            }
+            voxels_written += SIZE - static_cast<int>(std::count(row, row + SIZE, VOXEL_AIR));
+        }
+    }
+    voxels.assign(interior.data());
+    if (voxels.isUniform())
+    {
+        voxels.fill(getUniformVoxel()); // Releases the index storage, as generate() does
+    }
+    return voxels_written;
+}
 
-    float continentalness = clamp(noise.getContinentalness(noiseX, noiseZ));
-    float erosion = clamp(noise.getErosion(noiseX, noiseZ));
+bool VoxelChunk::canSkipMeshing() const
+{
+    if (!is_generated)
+    {
+        return false;
+    }
+    if (!isUniform())
+    {
+        // Dug out to air: only known when the occupancy summary is current
+        return occupancy_version == version && occupancy->getFill() == ChunkFill::Empty;
+    }
 
-    float baseHeight = noise.evalSpline(continentalSpline, continentalness);
-    float erosionEffect = noise.evalSpline(erosionSpline, erosion);
-    float terrainHeightF = (baseHeight - erosionEffect);
+    VoxelID voxel = getUniformVoxel();
+    if (voxel == VOXEL_AIR)
+    {
+        return true;
+    }
 
-    // Only calculate expensive peaks/valleys for areas that need it
-    if (erosion < 0.3f)
+    if (isVoxelTransparent(voxel))
     {
-        float peaksAndValleys = clamp(noise.getPeaksandValleysGenerator(noiseX, noiseZ));
-        float mountainFactor = std::max(0.0f, peaksAndValleys - erosion);
-        // Use faster approximation: x^1.5 ≈ x * x * sqrt(x)
-        mountainFactor = mountainFactor * mountainFactor * sqrtf(mountainFactor);
-        terrainHeightF += mountainFactor * 50.0f;
+        return false;
     }
 
-    return (int)terrainHeightF;
+    // Opaque: every face must be covered by an opaque uniform neighbor, or by the
+    // terrain prediction when the neighbor is not loaded
+    int topY = position.y * HEIGHT + HEIGHT - 1;
+    for (int dir = 0; dir < 6; dir++)
+    {
+        const VoxelChunk *neighbor = neighbors[dir];
+        if (neighbor)
+        {
+            if (!neighbor->isUniform() || isVoxelTransparent(neighbor->getUniformVoxel()))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        if (!has_extended_noise_cache || !shell_overrides.empty())
+        {
+            return false;
+        }
+
+        // Predicted layer just above the chunk must still be below the stone line
+        if (dir == NEIGHBOR_TOP && topY + 1 >= min_extended_height - SURFACE_DEPTH)
+        {
+            return false;
+        }
+        if (dir != NEIGHBOR_TOP && dir != NEIGHBOR_BOTTOM && topY >= min_extended_height - SURFACE_DEPTH)
+        {
+            return false;
+        }
+    }
+
+    return true;
 }
 
-VoxelID VoxelChunk::getVoxelWithNeighbors(int x, int y, int z) const
+void VoxelChunk::markMeshSkipped()
 {
-    if (isInBounds(x, y, z))
+    if (mesh)
     {
-        return voxels[coordsToIndex(x, y, z)];
+        mesh->markEmpty();
     }
-
-    // Fast reject if more than 1 block out
-    if (x < -1 || x > SIZE || y < -1 || y > HEIGHT || z < -1 || z > SIZE)
+    // Skipped chunks are all air (uniform or not) or uniform: air is fully see-through,
+    // anything else here is opaque
+    bool is_air = !isUniform() || getUniformVoxel() == VOXEL_AIR;
+    face_connectivity = is_air ? FACE_CONNECTIVITY_ALL : FACE_CONNECTIVITY_NONE;
+
+    // An opaque chunk was skipped on the prediction of the faces without a neighbor
+    predicted_faces = 0;
+    for (int dir = 0; dir < 6 && !is_air; dir++)
     {
-        return VOXEL_STONE;
+        predicted_faces |= neighbors[dir] ? 0u : 1u << dir;
     }
+    is_mesh_dirty = false;
+    dirty_mesh_sections = 0;
+    has_pending_edit = false;
+}
 
-    VoxelChunk *neighbor = nullptr;
-    glm::ivec3 neighborPos(x, y, z);
+ChunkMesh *VoxelChunk::ensureMesh()
+{
+    if (!mesh)
+    {
+        mesh = std::make_unique<ChunkMesh>();
+    }
+    return mesh.get();
+}
 
-    if (x == -1)
+int VoxelChunk::calculateTerrainHeightAt(int x, int z) const
+{
+    if (!has_noise_seed)
     {
-        neighbor = neighbors[NEIGHBOR_LEFT];
-        neighborPos.x = SIZE - 1;
+        return 64; // Default height
     }
-    else if (x == SIZE)
+
+    glm::ivec3 chunkBase = position * glm::ivec3(SIZE, HEIGHT, SIZE);
+    if (height_cache)
     {
-        neighbor = neighbors[NEIGHBOR_RIGHT];
-        neighborPos.x = 0;
+        return height_cache->getHeight(chunkBase.x + x, chunkBase.z + z);
     }
-    else if (y == -1)
+    return VoxelNoise::forThread(generation_seed).sampleTerrainHeight(chunkBase.x + x, chunkBase.z + z);
+}
+
+Biome VoxelChunk::calculateBiomeAt(int x, int z) const
+{
+    if (!has_noise_seed)
     {
-        neighbor = neighbors[NEIGHBOR_BOTTOM];
-        neighborPos.y = HEIGHT - 1;
+        return BIOME_PLAINS; // Matches the default height
     }
-    else if (y == HEIGHT)
+
+    glm::ivec3 chunkBase = position * glm::ivec3(SIZE, HEIGHT, SIZE);
+    if (height_cache)
     {
-        neighbor = neighbors[NEIGHBOR_TOP];
-        neighborPos.y = 0;
+        return height_cache->getBiome(chunkBase.x + x, chunkBase.z + z);
     }
-    else if (z == -1)
+    return VoxelNoise::forThread(generation_seed).sampleBiome(chunkBase.x + x, chunkBase.z + z);
+}
+
+VoxelID VoxelChunk::getVoxelWithNeighbors(int x, int y, int z) const
+{
+    if (isInBounds(x, y, z))
     {
-        neighbor = neighbors[NEIGHBOR_BACK];
-        neighborPos.z = SIZE - 1;
+        return voxels.get(coordsToIndex(x, y, z));
     }
-    else if (z == SIZE)
+
+    // Fast reject if more than 1 block out
+    if (x < -1 || x > SIZE || y < -1 || y > HEIGHT || z < -1 || z > SIZE)
     {
-        neighbor = neighbors[NEIGHBOR_FRONT];
-        neighborPos.z = 0;
+        return VOXEL_STONE;
     }
 
+    glm::ivec3 neighborPos;
+    int dir = borderNeighbor(x, y, z, neighborPos);
+    VoxelChunk *neighbor = dir >= 0 ? neighbors[dir] : nullptr;
     if (neighbor && neighbor->isInBounds(neighborPos))
     {
         return neighbor->getVoxel(neighborPos);
@@ -398,30 +858,207 @@ VoxelID VoxelChunk::getVoxelWithNeighbors(int x, int y, int z) const
     return generateExpectedVoxelFromCache(x, y, z);
 }
 
+int VoxelChunk::borderNeighbor(int x, int y, int z, glm::ivec3 &neighbor_pos)
+{
+    neighbor_pos = glm::ivec3(x, y, z);
+    if (x == -1)
+    {
+        neighbor_pos.x = SIZE - 1;
+        return NEIGHBOR_LEFT;
+    }
+    if (x == SIZE)
+    {
+        neighbor_pos.x = 0;
+        return NEIGHBOR_RIGHT;
+    }
+    if (y == -1)
+    {
+        neighbor_pos.y = HEIGHT - 1;
+        return NEIGHBOR_BOTTOM;
+    }
+    if (y == HEIGHT)
+    {
+        neighbor_pos.y = 0;
+        return NEIGHBOR_TOP;
+    }
+    if (z == -1)
+    {
+        neighbor_pos.z = SIZE - 1;
+        return NEIGHBOR_BACK;
+    }
+    if (z == SIZE)
+    {
+        neighbor_pos.z = 0;
+        return NEIGHBOR_FRONT;
+    }
+    return -1;
+}
+
 VoxelID VoxelChunk::generateExpectedVoxelFromCache(int x, int y, int z) const
 {
     if (isInBounds(x, y, z))
     {
-        return voxels[coordsToIndex(x, y, z)];
+        return voxels.get(coordsToIndex(x, y, z));
     }
 
-    // Get terrain height from cache (works for x,z in range [-1, SIZE])
-    int terrainHeight = getTerrainHeightFromCache(x, z);
+    // Density terrain shell voxels the height field gets wrong
+    if (!shell_overrides.empty() && x >= -1 && x <= SIZE && y >= -1 && y <= HEIGHT && z >= -1 && z <= SIZE)
+    {
+        uint16_t index = static_cast<uint16_t>(ChunkSnapshot::paddedIndex(x, y, z));
+        auto it = std::lower_bound(shell_overrides.begin(), shell_overrides.end(), index,
+                                   [](const ShellOverride &entry, uint16_t value)
+                                   { return entry.padded_index < value; });
+        if (it != shell_overrides.end() && it->padded_index == index)
+        {
+            return it->voxel;
+        }
+    }
 
-    glm::ivec3 chunkBase = position * glm::ivec3(SIZE, HEIGHT, SIZE);
-    int worldY = chunkBase.y + y;
+    // The generated column summary covers x,z in [-1, SIZE] and y in [-1, HEIGHT]
+    const int bottom_y = position.y * HEIGHT;
+    if (has_extended_noise_cache && x >= -1 && x <= SIZE && y >= -1 && y <= HEIGHT && z >= -1 && z <= SIZE)
+    {
+        const TerrainColumn &column = terrain_columns[extendedIndex(x, z)];
+        return predictHeightFieldVoxel(bottom_y + y, bottom_y + column.ground_top, static_cast<Biome>(column.biome));
+    }
+    return predictHeightFieldVoxel(bottom_y + y, calculateTerrainHeightAt(x, z), calculateBiomeAt(x, z));
+}
 
-    if (worldY < terrainHeight - 3)
-        return VOXEL_STONE;
-    if (worldY < terrainHeight - 1)
-        return VOXEL_DIRT;
+VoxelID VoxelChunk::predictHeightFieldVoxel(int worldY, int terrainHeight, Biome biome)
+{
     if (worldY < terrainHeight)
-        return VOXEL_GRASS;
-    if (worldY <= WATER_LEVEL && worldY >= terrainHeight)
+        return getBiomeLayer(biome, terrainHeight - 1 - worldY);
+    if (worldY <= WATER_LEVEL)
         return VOXEL_WATER;
     return VOXEL_AIR;
 }
 
+void VoxelChunk::predictShell(VoxelID *padded, uint8_t vertical_faces) const
+{
+    if (!has_extended_noise_cache)
+    {
+        // Never generated: the voxel by voxel fallback
+        forEachBorderColumn([&](int x, int z)
+                            {
+                                for (int y = -1; y <= HEIGHT; y++)
+                                {
+                                    padded[ChunkSnapshot::paddedIndex(x, y, z)] = generateExpectedVoxelFromCache(x, y, z);
+                                } });
+        for (int x = 0; x < SIZE; x++)
+        {
+            for (int z = 0; z < SIZE; z++)
+            {
+                padded[ChunkSnapshot::paddedIndex(x, -1, z)] = generateExpectedVoxelFromCache(x, -1, z);
+                padded[ChunkSnapshot::paddedIndex(x, HEIGHT, z)] = generateExpectedVoxelFromCache(x, HEIGHT, z);
+            }
+        }
+        return;
+    }
+
+    // Ring columns: stone, the biome's filler and top block, water, air, one run each; y is
+    // the padded buffer's second coordinate, so a column is strided by PADDED_SIZE
+    const int bottom_y = position.y * HEIGHT;
+    const int water_top = std::min(std::max(WATER_LEVEL + 1 - bottom_y, -1), HEIGHT + 1);
+    forEachBorderColumn([&](int x, int z)
+                        {
+                            const TerrainColumn &column = terrain_columns[extendedIndex(x, z)];
+                            const BiomeInfo &biome = BIOME_INFO[column.biome];
+                            const std::pair<int, VoxelID> runs[] = {{column.ground_top - SURFACE_DEPTH, VOXEL_STONE},
+                                                                    {column.ground_top - 1, biome.filler},
+                                                                    {column.ground_top, biome.surface},
+                                                                    {water_top, VOXEL_WATER},
+                                                                    {HEIGHT + 1, VOXEL_AIR}};
+                            VoxelID *out = padded + ChunkSnapshot::paddedIndex(x, -1, z);
+                            int y = -1;
+                            for (const auto &[end, voxel] : runs)
+                            {
+                                for (; y < std::min(end, HEIGHT + 1); y++)
+                                {
+                                    out[(y + 1) * ChunkSnapshot::PADDED_SIZE] = voxel;
+                                }
+                            } });
+
+    // Layers above and below, from the chunk's own columns
+    for (int y : {-1, HEIGHT})
+    {
+        if ((vertical_faces & (1u << (y < 0 ? NEIGHBOR_BOTTOM : NEIGHBOR_TOP))) == 0)
+        {
+            continue;
+        }
+        for (int x = 0; x < SIZE; x++)
+        {
+            for (int z = 0; z < SIZE; z++)
+            {
+                const TerrainColumn &column = terrain_columns[extendedIndex(x, z)];
+                padded[ChunkSnapshot::paddedIndex(x, y, z)] =
+                    predictHeightFieldVoxel(bottom_y + y, bottom_y + column.ground_top, static_cast<Biome>(column.biome));
+            }
+        }
+    }
+
+    // Density terrain where the height field is wrong
+    for (const ShellOverride &entry : shell_overrides)
+    {
+        padded[entry.padded_index] = entry.voxel;
+    }
+}
+
+bool VoxelChunk::verifyPredictedFace(int direction)
+{
+    const uint8_t face = static_cast<uint8_t>(1u << direction);
+    VoxelChunk *neighbor = neighbors[direction];
+    if ((predicted_faces & face) == 0 || !neighbor)
+    {
+        return false;
+    }
+    predicted_faces &= static_cast<uint8_t>(~face);
+
+    // Shell positions of the face from its two in-plane coordinates
+    const bool vertical = direction == NEIGHBOR_TOP || direction == NEIGHBOR_BOTTOM;
+    auto shellPosition = [direction](int a, int b)
+    {
+        switch (direction)
+        {
+        case NEIGHBOR_FRONT:
+            return glm::ivec3(a, b, SIZE);
+        case NEIGHBOR_BACK:
+            return glm::ivec3(a, b, -1);
+        case NEIGHBOR_RIGHT:
+            return glm::ivec3(SIZE, b, a);
+        case NEIGHBOR_LEFT:
+            return glm::ivec3(-1, b, a);
+        case NEIGHBOR_TOP:
+            return glm::ivec3(a, HEIGHT, b);
+        default:
+            return glm::ivec3(a, -1, b);
+        }
+    };
+
+    uint8_t sections = 0;
+    for (int a = 0; a < SIZE; a++)
+    {
+        for (int b = 0; b < (vertical ? SIZE : HEIGHT); b++)
+        {
+            glm::ivec3 shell = shellPosition(a, b);
+            glm::ivec3 inside;
+            borderNeighbor(shell.x, shell.y, shell.z, inside);
+            if (!isSameForMeshing(generateExpectedVoxelFromCache(shell.x, shell.y, shell.z), neighbor->getVoxel(inside)))
+            {
+                // Faces next to it read the voxel, and occlusion one layer up or down
+                for (int y = std::max(shell.y - 1, 0); y <= std::min(shell.y + 1, HEIGHT - 1); y++)
+                {
+                    sections |= static_cast<uint8_t>(1u << (y / MESH_SECTION_HEIGHT));
+                }
+            }
+        }
+    }
+    if (sections != 0)
+    {
+        markMeshDirty(sections);
+    }
+    return sections != 0;
+}
+
 // Keep the old function for backward compatibility but mark it as expensive
 VoxelID VoxelChunk::generateExpectedVoxel(int x, int y, int z) const
 {
@@ -439,18 +1076,37 @@ bool VoxelChunk::isInBounds(const glm::ivec3 &pos) const
     return isInBounds(pos.x, pos.y, pos.z);
 }
 
-void VoxelChunk::buildMesh()
+bool VoxelChunk::needsMeshRebuild() const
 {
-    if (!mesh)
-    {
-        return;
-    }
-
-    mesh->buildMesh(*this);
-    is_mesh_dirty = false;
+    return is_mesh_dirty || (mesh && !mesh->isBuilt());
 }
 
-bool VoxelChunk::needsMeshRebuild() const
+size_t VoxelChunk::packIfIdle(std::chrono::steady_clock::time_point now, float idle_seconds)
 {
-    return is_mesh_dirty || !mesh || !mesh->isBuilt();
+    // Storage packed here and unpacked since was touched (or replaced)
+    bool unpacked = (voxels_idle_packed && !voxels.isPacked()) || (light_idle_packed && !light.isPacked());
+    if (!is_generated || is_meshing || has_pending_edit || needsMeshRebuild() || version != last_active_version ||
+        unpacked)
+    {
+        last_active = now;
+        last_active_version = version;
+        voxels_idle_packed = false;
+        light_idle_packed = false;
+        return 0;
+    }
+    if (voxels_idle_packed || light_idle_packed ||
+        std::chrono::duration<float>(now - last_active).count() < idle_seconds)
+    {
+        return 0;
+    }
+
+    size_t before = getMemoryUsage();
+    voxels_idle_packed = voxels.pack();
+    light_idle_packed = light.pack();
+    if (!voxels_idle_packed && !light_idle_packed)
+    {
+        last_active = now; // Nothing to gain: check again after another idle period
+        return 0;
+    }
+    return before - getMemoryUsage();
 }
\ No newline at end of file
@@ -2,15 +2,55 @@
 #define VOXEL_CHUNK_H
 
 #include "voxel_types.h"
+#include "palette_storage.h"
+#include "density_terrain.h"
+#include "voxel_light.h"
+#include "chunk_occupancy.h"
 #include <glm/glm.hpp>
 #include <vector>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <memory>
 
 // Forward declarations
 class VoxelWorld;
 class ChunkMesh;
-class VoxelNoise; // forward declare to avoid heavy include in header
+class HeightFieldCache;
+
+// A voxel a bulk write changed (VoxelChunk::pasteVoxels)
+struct VoxelChange
+{
+    uint16_t index; // coordsToIndex
+    VoxelID previous;
+    VoxelID voxel;
+};
+
+// Mesh sections of each neighbor whose faces a batch of edits changed, a section mask per
+// NeighborDirection (see VoxelChunk::setVoxelDeferred)
+struct BorderChanges
+{
+    std::array<uint8_t, 6> sections{};
+};
+
+// A voxel giving off block light (getLightEmission above 0), see VoxelChunk::getEmitters
+struct VoxelEmitter
+{
+    uint16_t index; // coordsToIndex
+    VoxelID voxel;
+};
+
+// When a streamed-in chunk passed each stage on its way to the screen (see PipelineStage).
+// Only its first mesh counts: later remeshes are not pop-in.
+struct ChunkPipelineTimes
+{
+    std::chrono::steady_clock::time_point requested; // Entered the load queue
+    std::chrono::steady_clock::time_point generated; // Generated or restored
+    std::chrono::steady_clock::time_point mesh_queued;
+    std::chrono::steady_clock::time_point meshed;
+    std::chrono::steady_clock::time_point uploaded;
+    bool pending = false; // Streamed in and not drawn yet; chunks created by edits never are
+};
 
 class VoxelChunk
 {
@@ -22,51 +62,159 @@ public:
     // Chunk position in world chunk coordinates
     glm::ivec3 position;
 
-    // Version number for tracking changes
-    uint64_t version;
+    // Version number for tracking changes: bumped by every edit (main thread), read by jobs
+    // to tell whether their snapshot is still current
+    std::atomic<uint64_t> version;
 
     // World seed used for generation
     uint32_t generation_seed;
 
     // Chunk state flags
     bool is_generated;
-    bool is_dirty;
+    bool is_dirty; // Edited since generated or restored; saved to the region files on unload
     bool is_mesh_dirty;
     bool is_meshing;
+    // Sections to remesh (bit per mesh section); all of them unless only edits dirtied the mesh
+    uint8_t dirty_mesh_sections;
+    // Mesh dirtied by an edit (here or on a shared border) and not remeshed yet: bypasses the
+    // streaming throttle. edit_time is the first such edit, for edit-to-visible latency.
+    bool has_pending_edit;
+    std::chrono::steady_clock::time_point edit_time;
+
+    // Main thread only, once the chunk is in the world
+    ChunkPipelineTimes pipeline;
+
+    // Set by the world while the chunk is loaded: markMeshDirty appends the position there
+    // unless it is listed already (see VoxelWorld::takeMeshDirtyChunks)
+    std::vector<glm::ivec3> *mesh_dirty_list = nullptr;
+    bool is_mesh_listed = false;
+
+    // Stored in the world and not unloaded since; mesh jobs read it to drop work nobody will upload
+    std::atomic<bool> is_loaded{false};
 
-    // Voxel data storage
-    std::array<VoxelID, VOLUME> voxels;
+    // Faces (bit per NeighborDirection) whose shell the last dispatched mesh job predicted
+    // because the neighbor was not loaded; verifyPredictedFace clears them
+    uint8_t predicted_faces = 0;
+
+    // Faces connected through see-through voxels, from the last mesh build (all until then)
+    uint16_t face_connectivity;
+
+    // Voxel data storage (palette-compressed, see PaletteStorage)
+    PaletteStorage voxels;
+
+    // Sky and block light per voxel, computed with the voxels and kept up to date by the
+    // world's LightPropagator (edits through VoxelChunk::setVoxel alone do not relight)
+    LightStorage light;
 
     // Neighboring chunks (for mesh generation)
     std::array<VoxelChunk *, 6> neighbors;
 
-    // Mesh data
+    // Mesh data (allocated lazily; uniform chunks without exposed faces never get one)
     std::unique_ptr<ChunkMesh> mesh;
 
 private:
-    // Cached terrain column heights (world ground height for each local x,z)
-    std::array<int, SIZE * SIZE> column_heights{}; // filled during generate()
-    bool has_column_cache = false;
-    // Cached noise generator (lazily re-created if needed)
-    std::unique_ptr<VoxelNoise> noise_generator;
-
-    // Extended noise cache for neighboring block lookups
-    // Covers area from (-1,-1) to (SIZE,SIZE) in local coordinates
-    std::array<int, (SIZE + 2) * (SIZE + 2)> extended_terrain_heights;
+    // Set once generate() has chosen a seed; noise comes from VoxelNoise::forThread
+    bool has_noise_seed = false;
+    // World height tiles (shared by the column and its neighbors); null generates standalone
+    HeightFieldCache *height_cache = nullptr;
+
+    // Terrain heights and biomes of the chunk's columns and the 1-block border around them,
+    // (-1,-1) to (SIZE,SIZE) in local coordinates at (x + 1) * (SIZE + 2) + (z + 1). Only
+    // generation needs the exact heights: it fills a per-thread copy (see generate) and the
+    // chunk keeps terrain_columns.
+    static constexpr int EXTENDED_COLUMNS = (SIZE + 2) * (SIZE + 2);
+    struct ExtendedColumns
+    {
+        std::array<int, EXTENDED_COLUMNS> heights;
+        std::array<uint8_t, EXTENDED_COLUMNS> biomes;
+    };
+    static int extendedIndex(int x, int z) { return (x + 1) * (SIZE + 2) + (z + 1); }
+
+    // Height field prediction of the same columns, kept for predicting unloaded neighbors
+    // and sky exposure: the surface in chunk-local y (clamped, beyond a few voxels outside
+    // -1..HEIGHT the exact height no longer changes a prediction) and the column's biome
+    struct TerrainColumn
+    {
+        int8_t ground_top; // First local y above the ground
+        uint8_t biome;
+    };
+    std::array<TerrainColumn, EXTENDED_COLUMNS> terrain_columns{}; // filled during generate()
     bool has_extended_noise_cache;
 
-    inline int columnIndex(int x, int z) const { return x * SIZE + z; }
+    // Height bounds of the extended columns, used to detect single-value chunks
+    int min_extended_height = 0;
+    int max_extended_height = 0;
+
+    // Density terrain: the shell voxels whose generated value differs from the height field
+    // prediction, sorted by ChunkSnapshot::paddedIndex. Always empty for height field terrain.
+    struct ShellOverride
+    {
+        uint16_t padded_index;
+        VoxelID voxel;
+    };
+    TerrainMode terrain_mode = TerrainMode::Heightmap;
+    std::vector<ShellOverride> shell_overrides;
+
+    // Sections touched by setVoxelDeferred since the last commitEdits
+    uint8_t pending_edit_sections = 0;
+    // Sections holding faces next to layer y: a voxel shades the corners of the layers
+    // above and below it
+    static uint8_t getSectionsAround(int y);
+    // Neighbor sections facing a changed border voxel
+    static void addBorderChange(int x, int y, int z, BorderChanges &changes);
+
+    // getSolidRows of a non-uniform chunk, built for this version
+    mutable std::vector<uint16_t> solid_rows;
+    mutable uint64_t solid_rows_version = UINT64_MAX;
+
+    // getOccupancy, valid for occupancy_version: built lazily, then kept current by
+    // setVoxelDeferred
+    mutable std::unique_ptr<ChunkOccupancy> occupancy;
+    mutable uint64_t occupancy_version = UINT64_MAX;
+    // getEmitters, valid for emitters_version; kept current by setVoxelDeferred like occupancy
+    mutable std::vector<VoxelEmitter> emitters;
+    mutable uint64_t emitters_version = UINT64_MAX;
+    void markEditPending(); // Sets has_pending_edit, keeping the first edit_time
+
+    // packIfIdle state: when the chunk was last seen in use, at which version, and which
+    // storage it packed since
+    std::chrono::steady_clock::time_point last_active{};
+    uint64_t last_active_version = UINT64_MAX;
+    bool voxels_idle_packed = false;
+    bool light_idle_packed = false;
 
 public:
     VoxelChunk(const glm::ivec3 &pos);
     ~VoxelChunk();
 
+    // Return a pooled shell to the freshly constructed state at a new position. Voxel
+    // storage capacity and the mesh object (with its GL buffers) are kept for reuse.
+    void reset(const glm::ivec3 &pos);
+
     // Voxel access
     VoxelID getVoxel(int x, int y, int z) const;
     VoxelID getVoxel(const glm::ivec3 &pos) const;
     void setVoxel(int x, int y, int z, VoxelID voxel);
     void setVoxel(const glm::ivec3 &pos, VoxelID voxel);
 
+    // Batch edits: write without setVoxel's per-change bookkeeping, or-ing the neighbor
+    // sections a change on a border affects into changed_borders; commitEdits then bumps
+    // version and flags this chunk and those sections for remeshing once. A neighbor only
+    // sees whether a border voxel hides its faces and shades their corners, so a change
+    // between voxels that mesh alike (isSameForMeshing: two opaque types) leaves it alone.
+    bool setVoxelDeferred(int x, int y, int z, VoxelID voxel, BorderChanges &changed_borders);
+    void commitEdits(const BorderChanges &changed_borders);
+    // Bulk setVoxelDeferred: write source's voxel wherever mask (bit per coordsToIndex entry)
+    // is set, repacking the storage once instead of per voxel. Appends each change to
+    // changes and returns their number; commitEdits as for setVoxelDeferred.
+    size_t pasteVoxels(const PaletteStorage &source, const uint64_t *mask, BorderChanges &changed_borders,
+                       std::vector<VoxelChange> &changes);
+
+    // Flag the mesh for a rebuild of these sections (all by default)
+    void markMeshDirty(uint8_t sections = ALL_MESH_SECTIONS);
+    // Same, for a side effect of an edit (light it moved here): bypasses the throttle like the edit
+    void markEditMeshDirty(uint8_t sections);
+
     // Safe voxel access (checks bounds)
     VoxelID getVoxelSafe(int x, int y, int z) const;
     VoxelID getVoxelSafe(const glm::ivec3 &pos) const;
@@ -75,9 +223,15 @@ public:
     void setNeighbor(int direction, VoxelChunk *neighbor);
     VoxelChunk *getNeighbor(int direction) const;
 
-    // Generation and mesh building
-    void generate(uint32_t seed);
-    void buildMesh();
+    // Generation and mesh state (meshes are built from a ChunkSnapshot, see chunk_snapshot.h)
+    void generate(uint32_t seed, HeightFieldCache *heights = nullptr, TerrainMode mode = TerrainMode::Heightmap);
+    // Voxels were filled from saved data (RegionStorage): enter the generated state with the
+    // same noise setup generate() does, without writing terrain
+    void markRestored(uint32_t seed, HeightFieldCache *heights = nullptr, TerrainMode mode = TerrainMode::Heightmap);
+    TerrainMode getTerrainMode() const { return terrain_mode; }
+    // Nothing generates above this column of the chunk (density terrain: not even an
+    // overhang), so sky light enters it from the top
+    bool isColumnOpenToSky(int x, int z) const;
     bool needsMeshRebuild() const;
 
     // Utility functions
@@ -86,38 +240,141 @@ public:
     glm::ivec3 worldToLocal(const glm::ivec3 &worldPos) const;
     glm::ivec3 localToWorld(const glm::ivec3 &localPos) const;
 
+    // Bulk decode of all voxels in coordsToIndex order (for meshing)
+    void decodeVoxels(VoxelID *out) const { voxels.decodeAll(out); }
+
     // Get voxel from neighboring chunk if needed
     VoxelID getVoxelWithNeighbors(int x, int y, int z) const;
 
     // Generate expected voxel at position using terrain generation logic
     VoxelID generateExpectedVoxel(int x, int y, int z) const;
 
+    // Fill the shell of a padded buffer (ChunkSnapshot::paddedIndex order) with what
+    // generateExpectedVoxel returns there: the border ring columns whole, a run per layer, and
+    // the layers above and below the chunk where vertical_faces has NEIGHBOR_TOP /
+    // NEIGHBOR_BOTTOM set. Faces of loaded neighbors are the caller's to overwrite.
+    void predictShell(VoxelID *padded, uint8_t vertical_faces) const;
+
+    // Main thread, once the neighbor in direction is linked. If the last mesh predicted that
+    // face, compare the prediction with the neighbor's voxels and remesh the sections where
+    // they differ for meshing; true if any did
+    bool verifyPredictedFace(int direction);
+
     // Meshing status
     bool isMeshing() const { return is_meshing; }
     void setMeshing(bool status) { is_meshing = status; }
 
-private:
+    // Single-value chunks (storage holds no index data until the first differing setVoxel)
+    bool isUniform() const { return voxels.isUniform(); }
+    VoxelID getUniformVoxel() const { return voxels.getPalette()[0]; }
+
+    // Solid voxels (isVoxelSolid) as bits for collision queries: a row along z per x, y
+    // (solidRowIndex), bit z set where the voxel is solid. Rebuilt on the first call after an
+    // edit; uniform chunks share a constant table. Main thread, like edits.
+    const uint16_t *getSolidRows() const;
+    static int solidRowIndex(int x, int y) { return x * HEIGHT + y; }
+
+    // Non-air count, per-column opacity masks and fill of the voxels (chunk_occupancy.h).
+    // Built by the first call or edit after the voxels are replaced (generation, loads), then
+    // updated by each setVoxel. Main thread, like edits.
+    const ChunkOccupancy &getOccupancy() const;
+
+    // The emitting voxels, in no particular order. Found by the first call after the voxels
+    // are replaced (no decode unless the palette holds an emitting type), then updated by
+    // each setVoxel. Main thread, like edits.
+    const std::vector<VoxelEmitter> &getEmitters() const;
+
+    // O(1) check: chunk with no face that can be exposed (all air, uniform or emptied by
+    // edits, or uniform opaque and enclosed by opaque neighbors / predicted terrain)
+    bool canSkipMeshing() const;
+    void markMeshSkipped();
+
+    // Create the mesh object on demand (main thread, before dispatching a mesh job)
+    ChunkMesh *ensureMesh();
+
+    // Main thread, from the world's idle scan: pack the voxel and light storage (see
+    // PaletteStorage::pack) once the chunk has gone idle_seconds without an edit, a remesh
+    // or an unpack. The mesh is untouched. Returns the bytes saved.
+    size_t packIfIdle(std::chrono::steady_clock::time_point now, float idle_seconds);
+    bool isPacked() const { return voxels.isPacked() || light.isPacked(); }
+    // Main thread, before work that reads the chunk voxel by voxel: const reads of packed
+    // storage stay correct but walk the runs every time
+    void unpack()
+    {
+        voxels.unpack();
+        light.unpack();
+    }
+
+    // Memory accounting (the mesh is counted separately): the chunk object, of which the
+    // terrain column summary is getCacheBytes, plus the voxel and light storage
+    // and the density terrain shell overrides
+    size_t getMemoryUsage() const
+    {
+        return sizeof(VoxelChunk) - sizeof(PaletteStorage) + voxels.getMemoryUsage() + light.getMemoryUsage() +
+               shell_overrides.capacity() * sizeof(ShellOverride) + solid_rows.capacity() * sizeof(uint16_t) +
+               (occupancy ? sizeof(ChunkOccupancy) : 0) + emitters.capacity() * sizeof(VoxelEmitter);
+    }
+    static constexpr size_t getCacheBytes()
+    {
+        return sizeof(terrain_columns);
+    }
+
     // Convert 3D coordinates to 1D array index
-    inline int coordsToIndex(int x, int y, int z) const
+    static int coordsToIndex(int x, int y, int z)
+    {
+        return ChunkIndexing::index(x, y, z);
+    }
+    static bool isLocal(int x, int y, int z)
     {
-        return x * HEIGHT * SIZE + y * SIZE + z;
+        return x >= 0 && x < SIZE && y >= 0 && y < HEIGHT && z >= 0 && z < SIZE;
     }
 
+    // Neighbor direction owning a position one block outside the chunk, with the position
+    // translated into that neighbor's local space (may still be out of bounds on edges)
+    static int borderNeighbor(int x, int y, int z, glm::ivec3 &neighbor_pos);
+
+    // Calls f(x, z) for each border ring column, x-major
+    template <typename F>
+    static void forEachBorderColumn(F &&f)
+    {
+        for (int x = -1; x <= SIZE; x++)
+        {
+            if (x < 0 || x == SIZE)
+            {
+                for (int z = -1; z <= SIZE; z++)
+                {
+                    f(x, z);
+                }
+            }
+            else
+            {
+                f(x, -1);
+                f(x, SIZE);
+            }
+        }
+    }
+
+private:
+
     // Convert 1D array index to 3D coordinates
     inline glm::ivec3 indexToCoords(int index) const
     {
-        int x = index / (HEIGHT * SIZE);
-        int remainder = index % (HEIGHT * SIZE);
-        int y = remainder / SIZE;
-        int z = remainder % SIZE;
-        return glm::ivec3(x, y, z);
+        return glm::ivec3(ChunkIndexing::getX(index), ChunkIndexing::getY(index), ChunkIndexing::getZ(index));
     }
 
     // Helper functions
-    void calculateExtendedNoiseCache();
-    int getTerrainHeightFromCache(int x, int z) const;
+    // The calling thread's extended columns, valid until its next generation
+    static ExtendedColumns &generationColumns();
+    // Fills columns and the summary kept from them (terrain_columns, height bounds)
+    void calculateExtendedNoiseCache(ExtendedColumns &columns);
+    VoxelID classifyUniformChunk() const;
+    // Density terrain through DensityTerrain; fills shell_overrides, and the voxels unless
+    // only the prediction is wanted (restored chunks). Returns the non-air voxels written.
+    int generateDensityVoxels(bool write_voxels, const ExtendedColumns &columns);
     int calculateTerrainHeightAt(int x, int z) const;
+    Biome calculateBiomeAt(int x, int z) const;
     VoxelID generateExpectedVoxelFromCache(int x, int y, int z) const;
+    static VoxelID predictHeightFieldVoxel(int world_y, int terrain_height, Biome biome); // Height field terrain
 };
 
 // Neighbor directions
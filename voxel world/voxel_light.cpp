@@ -0,0 +1,608 @@
+#include "voxel_light.h"
+#include "voxel_chunk.h"
+#include "profiler.h"
+#include <algorithm>
+#include <array>
+
+namespace
+{
+// Varint run length of a packed LightStorage, advancing data
+size_t readRunLength(const uint8_t *&data)
+{
+    size_t length = 0;
+    for (int shift = 0;; shift += 7)
+    {
+        uint8_t byte = *data++;
+        length |= static_cast<size_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return length;
+        }
+    }
+}
+
+// Level light at `level` leaves in a voxel one step away in NeighborDirection direction; 0
+// if the voxel blocks light. Full sky light falls straight down clear voxels without loss.
+int arrivingLevel(int level, VoxelID voxel, int direction, bool sky)
+{
+    int opacity = getLightOpacity(voxel);
+    if (opacity >= MAX_LIGHT)
+    {
+        return 0;
+    }
+    if (sky && direction == NEIGHBOR_BOTTOM && level == MAX_LIGHT && opacity == 0)
+    {
+        return MAX_LIGHT;
+    }
+    return std::max(level - std::max(opacity, 1), 0);
+}
+
+int levelOf(uint8_t light, bool sky)
+{
+    return sky ? getSkyLight(light) : getBlockLight(light);
+}
+
+uint8_t withLevel(uint8_t light, int level, bool sky)
+{
+    return sky ? static_cast<uint8_t>((level << 4) | (light & 15)) : static_cast<uint8_t>((light & 0xF0) | level);
+}
+
+glm::ivec3 indexToCoords(int index)
+{
+    return glm::ivec3(ChunkIndexing::getX(index), ChunkIndexing::getY(index), ChunkIndexing::getZ(index));
+}
+
+// The voxel one step from index in a direction, in this chunk or a loaded neighbor
+bool step(VoxelChunk *chunk, int index, int direction, VoxelChunk *&next_chunk, int &next_index)
+{
+    glm::ivec3 pos = indexToCoords(index) + FACE_NORMALS[direction];
+    if (!VoxelChunk::isLocal(pos.x, pos.y, pos.z))
+    {
+        chunk = chunk->neighbors[direction];
+        if (!chunk)
+        {
+            return false;
+        }
+        pos = glm::ivec3(pos.x & CHUNK_SIZE_MASK, pos.y & CHUNK_HEIGHT_MASK, pos.z & CHUNK_SIZE_MASK);
+    }
+    next_chunk = chunk;
+    next_index = VoxelChunk::coordsToIndex(pos.x, pos.y, pos.z);
+    return true;
+}
+
+// Calls visit(index) for every voxel of the chunk layer on the side facing direction
+template <typename Visit>
+void forEachLayerVoxel(int direction, Visit visit)
+{
+    switch (direction)
+    {
+    case NEIGHBOR_FRONT:
+    case NEIGHBOR_BACK:
+        for (int x = 0; x < CHUNK_SIZE; x++)
+            for (int y = 0; y < CHUNK_HEIGHT; y++)
+                visit(VoxelChunk::coordsToIndex(x, y, direction == NEIGHBOR_FRONT ? CHUNK_SIZE - 1 : 0));
+        break;
+    case NEIGHBOR_RIGHT:
+    case NEIGHBOR_LEFT:
+        for (int y = 0; y < CHUNK_HEIGHT; y++)
+            for (int z = 0; z < CHUNK_SIZE; z++)
+                visit(VoxelChunk::coordsToIndex(direction == NEIGHBOR_RIGHT ? CHUNK_SIZE - 1 : 0, y, z));
+        break;
+    default:
+        for (int x = 0; x < CHUNK_SIZE; x++)
+            for (int z = 0; z < CHUNK_SIZE; z++)
+                visit(VoxelChunk::coordsToIndex(x, direction == NEIGHBOR_TOP ? CHUNK_HEIGHT - 1 : 0, z));
+        break;
+    }
+}
+
+// In-chunk flood fill of one channel over flat arrays, from the queued indices
+void floodChunk(const VoxelID *voxels, uint8_t *light, std::vector<uint16_t> &queue, bool sky)
+{
+    for (size_t next = 0; next < queue.size(); next++)
+    {
+        int index = queue[next];
+        int level = levelOf(light[index], sky);
+        if (level <= 1)
+        {
+            continue;
+        }
+        glm::ivec3 pos = indexToCoords(index);
+        for (int direction = 0; direction < 6; direction++)
+        {
+            glm::ivec3 to = pos + FACE_NORMALS[direction];
+            if (!VoxelChunk::isLocal(to.x, to.y, to.z))
+            {
+                continue;
+            }
+            int target = VoxelChunk::coordsToIndex(to.x, to.y, to.z);
+            int arriving = arrivingLevel(level, voxels[target], direction, sky);
+            if (arriving > levelOf(light[target], sky))
+            {
+                light[target] = withLevel(light[target], arriving, sky);
+                queue.push_back(static_cast<uint16_t>(target));
+            }
+        }
+    }
+    queue.clear();
+}
+}
+
+void LightStorage::set(int index, uint8_t value)
+{
+    if (!packed_runs.empty())
+    {
+        unpack();
+    }
+    if (values.empty())
+    {
+        if (value == uniform_value)
+        {
+            return;
+        }
+        values.assign(CHUNK_VOLUME, uniform_value);
+    }
+    values[index] = value;
+}
+
+void LightStorage::fill(uint8_t value)
+{
+    uniform_value = value;
+    std::vector<uint8_t>().swap(values);
+    std::vector<uint8_t>().swap(packed_runs);
+}
+
+void LightStorage::reset(uint8_t value)
+{
+    uniform_value = value;
+    values.clear();
+    std::vector<uint8_t>().swap(packed_runs);
+}
+
+void LightStorage::assign(const uint8_t *source)
+{
+    if (std::all_of(source, source + CHUNK_VOLUME, [source](uint8_t value) { return value == source[0]; }))
+    {
+        reset(source[0]);
+        return;
+    }
+    std::vector<uint8_t>().swap(packed_runs);
+    values.assign(source, source + CHUNK_VOLUME);
+}
+
+void LightStorage::decodeAll(uint8_t *out) const
+{
+    if (!packed_runs.empty())
+    {
+        const uint8_t *data = packed_runs.data();
+        for (uint8_t *out_end = out + CHUNK_VOLUME; out < out_end;)
+        {
+            uint8_t value = *data++;
+            out = std::fill_n(out, readRunLength(data), value);
+        }
+        return;
+    }
+    if (values.empty())
+    {
+        std::fill(out, out + CHUNK_VOLUME, uniform_value);
+        return;
+    }
+    std::copy(values.begin(), values.end(), out);
+}
+
+bool LightStorage::pack()
+{
+    if (values.empty())
+    {
+        return false;
+    }
+
+    // Sky light is constant down open columns and darkness fills the ground, so runs are long
+    std::vector<uint8_t> runs;
+    for (size_t i = 0; i < values.size();)
+    {
+        size_t run_end = i + 1;
+        while (run_end < values.size() && values[run_end] == values[i])
+        {
+            run_end++;
+        }
+        runs.push_back(values[i]);
+        for (size_t length = run_end - i; ; length >>= 7)
+        {
+            if (length < 0x80)
+            {
+                runs.push_back(static_cast<uint8_t>(length));
+                break;
+            }
+            runs.push_back(static_cast<uint8_t>(length | 0x80));
+        }
+        if (runs.size() >= values.capacity())
+        {
+            return false;
+        }
+        i = run_end;
+    }
+
+    runs.shrink_to_fit();
+    packed_runs = std::move(runs);
+    std::vector<uint8_t>().swap(values);
+    return true;
+}
+
+uint8_t LightStorage::getPacked(int index) const
+{
+    const uint8_t *data = packed_runs.data();
+    size_t remaining = static_cast<size_t>(index);
+    while (true)
+    {
+        uint8_t value = *data++;
+        size_t length = readRunLength(data);
+        if (remaining < length)
+        {
+            return value;
+        }
+        remaining -= length;
+    }
+}
+
+void LightStorage::unpack()
+{
+    if (packed_runs.empty())
+    {
+        return;
+    }
+    values.resize(CHUNK_VOLUME);
+    decodeAll(values.data());
+    std::vector<uint8_t>().swap(packed_runs);
+}
+
+void LightPropagator::computeChunk(VoxelChunk &chunk)
+{
+    PROFILE_ZONE("LightPropagator::computeChunk");
+
+    int open_columns = 0;
+    for (int x = 0; x < CHUNK_SIZE; x++)
+    {
+        for (int z = 0; z < CHUNK_SIZE; z++)
+        {
+            open_columns += chunk.isColumnOpenToSky(x, z) ? 1 : 0;
+        }
+    }
+
+    // Single-value chunks without emitters: fully lit open air, or dark
+    if (chunk.isUniform() && getLightEmission(chunk.getUniformVoxel()) == 0)
+    {
+        int opacity = getLightOpacity(chunk.getUniformVoxel());
+        if (opacity >= MAX_LIGHT || open_columns == 0)
+        {
+            chunk.light.fill(0);
+            return;
+        }
+        if (opacity == 0 && open_columns == CHUNK_SIZE * CHUNK_SIZE)
+        {
+            chunk.light.fill(FULL_SKY_LIGHT);
+            return;
+        }
+    }
+
+    thread_local std::array<VoxelID, CHUNK_VOLUME> voxels;
+    thread_local std::array<uint8_t, CHUNK_VOLUME> light;
+    thread_local std::vector<uint16_t> queue;
+    chunk.decodeVoxels(voxels.data());
+
+    // Sky columns top down, with the emitters' own block light; the layers holding anything
+    // are noted on the way
+    int lowest_solid = CHUNK_HEIGHT;
+    int highest_solid = -1;
+    for (int x = 0; x < CHUNK_SIZE; x++)
+    {
+        for (int z = 0; z < CHUNK_SIZE; z++)
+        {
+            int level = chunk.isColumnOpenToSky(x, z) ? MAX_LIGHT : 0;
+            for (int y = CHUNK_HEIGHT - 1; y >= 0; y--)
+            {
+                int index = VoxelChunk::coordsToIndex(x, y, z);
+                if (voxels[index] != VOXEL_AIR)
+                {
+                    lowest_solid = std::min(lowest_solid, y);
+                    highest_solid = std::max(highest_solid, y);
+                }
+                level = arrivingLevel(level, voxels[index], NEIGHBOR_BOTTOM, true);
+                light[index] = static_cast<uint8_t>((level << 4) | getLightEmission(voxels[index]));
+            }
+        }
+    }
+
+    // Sideways and upwards from there: only voxels that can light a neighbor seed the fill
+    // (straight down was the column pass). With every column open, the air over the highest
+    // occupied layer is evenly lit and seeds nothing.
+    int seed_top = open_columns == CHUNK_SIZE * CHUNK_SIZE ? std::min(highest_solid, CHUNK_HEIGHT - 1) : CHUNK_HEIGHT - 1;
+    for (int x = 0; x < CHUNK_SIZE; x++)
+    {
+        for (int y = 0; y <= seed_top; y++)
+        {
+            for (int z = 0; z < CHUNK_SIZE; z++)
+            {
+                int index = VoxelChunk::coordsToIndex(x, y, z);
+                int level = getSkyLight(light[index]);
+                if (level <= 1)
+                {
+                    continue;
+                }
+                glm::ivec3 pos(x, y, z);
+                for (int direction = 0; direction < NEIGHBOR_BOTTOM; direction++)
+                {
+                    glm::ivec3 to = pos + FACE_NORMALS[direction];
+                    if (VoxelChunk::isLocal(to.x, to.y, to.z))
+                    {
+                        int target = VoxelChunk::coordsToIndex(to.x, to.y, to.z);
+                        if (arrivingLevel(level, voxels[target], direction, true) > getSkyLight(light[target]))
+                        {
+                            queue.push_back(static_cast<uint16_t>(index));
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    floodChunk(voxels.data(), light.data(), queue, true);
+
+    // Block light starts at emitters, which are never air
+    for (int x = 0; x < CHUNK_SIZE; x++)
+    {
+        for (int y = lowest_solid; y <= highest_solid; y++)
+        {
+            for (int z = 0; z < CHUNK_SIZE; z++)
+            {
+                int index = VoxelChunk::coordsToIndex(x, y, z);
+                if (getBlockLight(light[index]) > 1)
+                {
+                    queue.push_back(static_cast<uint16_t>(index));
+                }
+            }
+        }
+    }
+    floodChunk(voxels.data(), light.data(), queue, false);
+
+    chunk.light.assign(light.data());
+}
+
+void LightPropagator::voxelChanged(VoxelChunk &chunk, int x, int y, int z)
+{
+    int index = VoxelChunk::coordsToIndex(x, y, z);
+    uint8_t previous = chunk.light.get(index);
+    int emission = getLightEmission(chunk.voxels.get(index));
+
+    // Whatever came through the old voxel is taken back, then the neighbors refill it
+    setLevel(chunk, index, 0, true);
+    setLevel(chunk, index, emission, false);
+    if (getSkyLight(previous) > 0)
+    {
+        sky_removals.push_back({&chunk, static_cast<uint16_t>(index), static_cast<uint8_t>(getSkyLight(previous))});
+    }
+    if (getBlockLight(previous) > emission)
+    {
+        block_removals.push_back({&chunk, static_cast<uint16_t>(index), static_cast<uint8_t>(getBlockLight(previous))});
+    }
+    if (emission > 0)
+    {
+        block_additions.push_back({&chunk, static_cast<uint16_t>(index), 0});
+    }
+    for (int direction = 0; direction < 6; direction++)
+    {
+        VoxelChunk *next_chunk;
+        int next_index;
+        if (step(&chunk, index, direction, next_chunk, next_index))
+        {
+            sky_additions.push_back({next_chunk, static_cast<uint16_t>(next_index), 0});
+            block_additions.push_back({next_chunk, static_cast<uint16_t>(next_index), 0});
+        }
+    }
+}
+
+void LightPropagator::chunkLinked(VoxelChunk &chunk)
+{
+    for (int direction = 0; direction < 6; direction++)
+    {
+        VoxelChunk *neighbor = chunk.neighbors[direction];
+        if (!neighbor)
+        {
+            continue;
+        }
+        // The lower chunk assumed its open columns lit from above
+        if (direction == NEIGHBOR_TOP)
+        {
+            correctSkyEntry(chunk, *neighbor);
+        }
+        else if (direction == NEIGHBOR_BOTTOM)
+        {
+            correctSkyEntry(*neighbor, chunk);
+        }
+        queueFace(chunk, direction);
+    }
+}
+
+void LightPropagator::propagate(bool from_edit)
+{
+    PROFILE_ZONE("LightPropagator::propagate");
+    removeLight(sky_removals, sky_additions, true);
+    removeLight(block_removals, block_additions, false);
+    addLight(sky_additions, true);
+    addLight(block_additions, false);
+
+    for (const auto &[chunk, sections] : relit_sections)
+    {
+        if (from_edit)
+        {
+            chunk->markEditMeshDirty(sections);
+        }
+        else
+        {
+            chunk->markMeshDirty(sections);
+        }
+    }
+    relit_sections.clear();
+}
+
+void LightPropagator::removeLight(std::vector<Node> &removals, std::vector<Node> &additions, bool sky)
+{
+    // Neighbors lit below the removed level got their light through it (as did full sky light
+    // straight below full sky light); brighter ones are lit from elsewhere and refill the gap
+    for (size_t next = 0; next < removals.size(); next++)
+    {
+        Node node = removals[next];
+        for (int direction = 0; direction < 6; direction++)
+        {
+            VoxelChunk *next_chunk;
+            int next_index;
+            if (!step(node.chunk, node.index, direction, next_chunk, next_index))
+            {
+                continue;
+            }
+            int level = levelOf(next_chunk->light.get(next_index), sky);
+            if (level == 0)
+            {
+                continue;
+            }
+
+            bool fed_through = level < node.level || (sky && direction == NEIGHBOR_BOTTOM && node.level == MAX_LIGHT);
+            int own = sky ? 0 : getLightEmission(next_chunk->voxels.get(next_index));
+            if (fed_through && own < level)
+            {
+                setLevel(*next_chunk, next_index, own, sky);
+                removals.push_back({next_chunk, static_cast<uint16_t>(next_index), static_cast<uint8_t>(level)});
+                if (own > 0)
+                {
+                    additions.push_back({next_chunk, static_cast<uint16_t>(next_index), 0});
+                }
+            }
+            else
+            {
+                additions.push_back({next_chunk, static_cast<uint16_t>(next_index), 0});
+            }
+        }
+    }
+    removals.clear();
+}
+
+void LightPropagator::addLight(std::vector<Node> &additions, bool sky)
+{
+    for (size_t next = 0; next < additions.size(); next++)
+    {
+        Node node = additions[next];
+        int level = levelOf(node.chunk->light.get(node.index), sky);
+        if (level <= 1)
+        {
+            continue;
+        }
+        for (int direction = 0; direction < 6; direction++)
+        {
+            VoxelChunk *next_chunk;
+            int next_index;
+            if (!step(node.chunk, node.index, direction, next_chunk, next_index))
+            {
+                continue;
+            }
+            int arriving = arrivingLevel(level, next_chunk->voxels.get(next_index), direction, sky);
+            if (arriving > levelOf(next_chunk->light.get(next_index), sky))
+            {
+                setLevel(*next_chunk, next_index, arriving, sky);
+                additions.push_back({next_chunk, static_cast<uint16_t>(next_index), 0});
+            }
+        }
+    }
+    additions.clear();
+}
+
+void LightPropagator::setLevel(VoxelChunk &chunk, int index, int level, bool sky)
+{
+    uint8_t light = chunk.light.get(index);
+    if (levelOf(light, sky) == level)
+    {
+        return;
+    }
+    chunk.light.set(index, withLevel(light, level, sky));
+    glm::ivec3 pos = indexToCoords(index);
+    noteRelit(chunk, pos.x, pos.y, pos.z);
+}
+
+void LightPropagator::queueFace(VoxelChunk &chunk, int direction)
+{
+    // The layers on both sides of the shared face, wherever they have light to give
+    auto queueLayer = [this](VoxelChunk &target, int side)
+    {
+        if (target.light.isUniform() && target.light.getUniformValue() == 0)
+        {
+            return;
+        }
+        forEachLayerVoxel(side, [&](int index)
+                          {
+                              uint8_t light = target.light.get(index);
+                              if (getSkyLight(light) > 1)
+                                  sky_additions.push_back({&target, static_cast<uint16_t>(index), 0});
+                              if (getBlockLight(light) > 1)
+                                  block_additions.push_back({&target, static_cast<uint16_t>(index), 0}); });
+    };
+    queueLayer(chunk, direction);
+    queueLayer(*chunk.neighbors[direction], direction ^ 1); // Directions come in opposite pairs
+}
+
+void LightPropagator::correctSkyEntry(VoxelChunk &lower, VoxelChunk &upper)
+{
+    // Open columns were seeded as if full sky light entered at the top; where less comes out
+    // of the chunk above, the surplus is removed (the layer above is queued to refill it)
+    for (int x = 0; x < CHUNK_SIZE; x++)
+    {
+        for (int z = 0; z < CHUNK_SIZE; z++)
+        {
+            if (!lower.isColumnOpenToSky(x, z))
+            {
+                continue;
+            }
+            int top = VoxelChunk::coordsToIndex(x, CHUNK_HEIGHT - 1, z);
+            int above = VoxelChunk::coordsToIndex(x, 0, z);
+            int entering = arrivingLevel(getSkyLight(upper.light.get(above)), lower.voxels.get(top), NEIGHBOR_BOTTOM, true);
+            int current = getSkyLight(lower.light.get(top));
+            if (current > entering)
+            {
+                setLevel(lower, top, 0, true);
+                sky_removals.push_back({&lower, static_cast<uint16_t>(top), static_cast<uint8_t>(current)});
+            }
+        }
+    }
+}
+
+void LightPropagator::noteRelit(VoxelChunk &chunk, int x, int y, int z)
+{
+    // Faces of the voxel's six neighbors read its light: the sections of the layers around
+    // it here, and the section across in a neighbor sharing its border
+    int lowest = std::max(y - 1, 0) / MESH_SECTION_HEIGHT;
+    int highest = std::min(y + 1, CHUNK_HEIGHT - 1) / MESH_SECTION_HEIGHT;
+    uint8_t &sections = relit_sections[&chunk];
+    for (int section = lowest; section <= highest; section++)
+    {
+        sections |= static_cast<uint8_t>(1u << section);
+    }
+
+    const uint8_t own_section = static_cast<uint8_t>(1u << (y / MESH_SECTION_HEIGHT));
+    auto across = [&](int direction, uint8_t neighbor_sections)
+    {
+        if (VoxelChunk *neighbor = chunk.neighbors[direction])
+        {
+            relit_sections[neighbor] |= neighbor_sections;
+        }
+    };
+    if (x == 0)
+        across(NEIGHBOR_LEFT, own_section);
+    if (x == CHUNK_SIZE - 1)
+        across(NEIGHBOR_RIGHT, own_section);
+    if (z == 0)
+        across(NEIGHBOR_BACK, own_section);
+    if (z == CHUNK_SIZE - 1)
+        across(NEIGHBOR_FRONT, own_section);
+    if (y == 0)
+        across(NEIGHBOR_BOTTOM, static_cast<uint8_t>(1u << (MESH_SECTION_COUNT - 1)));
+    if (y == CHUNK_HEIGHT - 1)
+        across(NEIGHBOR_TOP, 1u);
+}
@@ -0,0 +1,123 @@
+#ifndef VOXEL_LIGHT_H
+#define VOXEL_LIGHT_H
+
+#include "voxel_types.h"
+#include "block_registry.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class VoxelChunk;
+
+// Light levels run from 0 (dark) to MAX_LIGHT. Every voxel stores two: sky light in the high
+// nibble and block light (from emitting voxels) in the low one.
+constexpr int MAX_LIGHT = 15;
+constexpr uint8_t FULL_SKY_LIGHT = static_cast<uint8_t>(MAX_LIGHT << 4);
+
+inline int getSkyLight(uint8_t light) { return light >> 4; }
+inline int getBlockLight(uint8_t light) { return light & 15; }
+
+// Level meshes bake into their vertices: no day cycle weighs the two channels apart
+inline int getCombinedLight(uint8_t light) { return getSkyLight(light) > getBlockLight(light) ? getSkyLight(light) : getBlockLight(light); }
+
+inline int getLightOpacity(VoxelID voxel)
+{
+    return BlockRegistry::get().getLightOpacity(voxel);
+}
+
+inline int getLightEmission(VoxelID voxel)
+{
+    return BlockRegistry::get().getLightEmission(voxel);
+}
+
+// Per-voxel light of one chunk in VoxelChunk::coordsToIndex order. Chunks with one value
+// everywhere (open sky above the terrain, darkness inside it) hold no array. Idle chunks
+// can hold their light run-length encoded instead (pack) until the owner unpacks it or
+// writes; const reads leave it packed, as with PaletteStorage::pack.
+class LightStorage
+{
+public:
+    uint8_t get(int index) const
+    {
+        if (values.empty())
+        {
+            return packed_runs.empty() ? uniform_value : getPacked(index);
+        }
+        return values[index];
+    }
+    void set(int index, uint8_t value);
+
+    // Every voxel to one value, releasing the array
+    void fill(uint8_t value);
+    // Same as fill, but keeps the array's capacity for the next writes (pooled chunks)
+    void reset(uint8_t value);
+    // Replace the contents from CHUNK_VOLUME values, uniform if they all match
+    void assign(const uint8_t *source);
+    void decodeAll(uint8_t *out) const; // Leaves it packed
+
+    // Run-length encode the array until unpack or the next write; false (left as is) if
+    // uniform, packed already or the runs would not be smaller
+    bool pack();
+    void unpack(); // Back to the array (nothing if not packed)
+    bool isPacked() const { return !packed_runs.empty(); }
+
+    bool isUniform() const { return values.empty() && packed_runs.empty(); }
+    uint8_t getUniformValue() const { return uniform_value; }
+    size_t getMemoryUsage() const { return values.capacity() + packed_runs.capacity(); }
+
+private:
+    uint8_t uniform_value = 0;
+    std::vector<uint8_t> values;
+    std::vector<uint8_t> packed_runs; // (value, varint length) pairs while packed, else empty
+
+    uint8_t getPacked(int index) const; // From the runs, leaving them packed
+};
+
+// Sky and block light flood fill.
+//
+// A chunk's own light is computed on the generating worker: sky light falls straight down
+// the columns open to the sky at full level and both channels then spread one level lost per
+// step (more through water and leaves, none through opaque voxels). Once it is in the world,
+// the main thread links it up: light flows across its borders both ways, and columns the
+// chunk above turns out to shade are darkened again. Edits do not recompute chunks; the
+// changed voxels seed a removal pass (light that came through them) followed by an addition
+// pass refilling from what is left, both crossing into loaded neighbors only.
+//
+// Chunks whose light changed have the affected mesh sections flagged for a rebuild.
+class LightPropagator
+{
+public:
+    // Any thread, on a chunk not in the world yet: light from its own voxels and its sky
+    // columns (VoxelChunk::isColumnOpenToSky)
+    static void computeChunk(VoxelChunk &chunk);
+
+    // Main thread. Queue work, then run it with propagate.
+    void voxelChanged(VoxelChunk &chunk, int x, int y, int z); // After the new voxel is written
+    void chunkLinked(VoxelChunk &chunk);                       // After linkChunkNeighbors
+
+    // Run the queued removals and additions. Edits flag the sections they relit like the edit
+    // itself (bypassing the streaming throttle); links only mark them dirty.
+    void propagate(bool from_edit);
+
+private:
+    struct Node
+    {
+        VoxelChunk *chunk;
+        uint16_t index;
+        uint8_t level; // Removal: the level the voxel had
+    };
+
+    std::vector<Node> sky_removals, block_removals;
+    std::vector<Node> sky_additions, block_additions;
+    std::unordered_map<VoxelChunk *, uint8_t> relit_sections; // Sections per chunk to remesh
+
+    void removeLight(std::vector<Node> &removals, std::vector<Node> &additions, bool sky);
+    void addLight(std::vector<Node> &additions, bool sky);
+    void setLevel(VoxelChunk &chunk, int index, int level, bool sky);
+    void queueFace(VoxelChunk &chunk, int direction); // A border layer and the layer across it
+    void correctSkyEntry(VoxelChunk &lower, VoxelChunk &upper);
+    void noteRelit(VoxelChunk &chunk, int x, int y, int z);
+};
+
+#endif // VOXEL_LIGHT_H
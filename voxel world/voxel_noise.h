@@ -1,23 +1,114 @@
 #ifndef VOXEL_NOISE_H
 #define VOXEL_NOISE_H
 
+#include "terrain_spline.h"
+#include "voxel_types.h"
 #include <cstdint>
 #include <FastNoise/FastNoise.h>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <memory>
+#include <utility>
 #include <vector>
 #include <iostream>
 
-struct SplinePoint
-{
-    float input;  // Noise value
-    float output; // terrain height (y)
-};
-
 class VoxelNoise
 {
+public:
+    // Terrain shape shared by every height lookup
+    static constexpr float TERRAIN_FREQUENCY = 0.005f;      // World units -> noise space
+    static constexpr float MOUNTAIN_EROSION_LIMIT = 0.3f;   // Peaks only rise where erosion is lower
+    static constexpr float MOUNTAIN_HEIGHT = 50.0f;
+    static constexpr float OVERHANG_FREQUENCY = 0.03f; // 3D fields of density terrain
+    static constexpr float CAVE_FREQUENCY = 0.04f;
+    static constexpr int ROCK_LINE = 110;             // Columns this high are mountains
+    static constexpr float DESERT_EROSION = 0.35f;    // Flat, heavily eroded inland columns are desert
+    static constexpr float DESERT_CONTINENTAL = 0.0f; // ... if this far from the coast
+    static constexpr TerrainSpline<6> CONTINENTAL_SPLINE{{
+        {-1.0f, 30.0f}, // Ocean floors
+        {-0.5f, 50.0f}, // Coastal areas
+        {0.0f, 80.0f},  // Plains
+        {0.3f, 100.0f}, // Hills
+        {0.6f, 130.0f}, // Mountains
+        {1.0f, 160.0f}  // High peaks
+    }};
+    static constexpr TerrainSpline<4> EROSION_SPLINE{{
+        {-1.0f, 0.0f}, // No erosion effect
+        {0.0f, 10.0f}, // Light erosion
+        {0.5f, 25.0f}, // Medium erosion
+        {1.0f, 40.0f}  // Heavy erosion (carves valleys)
+    }};
+    using TerrainLut = SplineLut<1024>;
+
+    // Octaves, lacunarity and gain of a terrain layer's FBm over the shared simplex source
+    struct FractalSettings
+    {
+        int octaves;
+        float lacunarity;
+        float gain;
+    };
+    static constexpr FractalSettings CONTINENTAL_LAYER{3, 1.5f, 0.5f};
+    static constexpr FractalSettings EROSION_LAYER{4, 2.0f, 0.5f};
+    static constexpr FractalSettings PEAKS_LAYER{4, 2.0f, 0.5f};
+    // Same source, settings and seed give the same noise: peaks are then the erosion grid
+    // copied rather than a third FBm evaluation
+    static constexpr bool PEAKS_SHARE_EROSION = PEAKS_LAYER.octaves == EROSION_LAYER.octaves &&
+                                                PEAKS_LAYER.lacunarity == EROSION_LAYER.lacunarity &&
+                                                PEAKS_LAYER.gain == EROSION_LAYER.gain;
+
+    // Bump when the node graph or the blend changes in a way the constants above do not
+    // capture; terrain cached on disk is keyed by getGeneratorHash
+    static constexpr uint32_t GENERATOR_VERSION = 3; // 2: splines sampled through TerrainLut, 3: biomes
+
+    // FNV-1a over the seed, GENERATOR_VERSION and the terrain shape constants
+    static uint64_t getGeneratorHash(uint32_t seed)
+    {
+        uint64_t h = 0xcbf29ce484222325ull;
+        auto mix = [&h](const void *data, size_t size)
+        {
+            const unsigned char *bytes = static_cast<const unsigned char *>(data);
+            for (size_t i = 0; i < size; i++)
+            {
+                h ^= bytes[i];
+                h *= 0x100000001b3ull;
+            }
+        };
+        const float shape[] = {TERRAIN_FREQUENCY, MOUNTAIN_EROSION_LIMIT, MOUNTAIN_HEIGHT,
+                               static_cast<float>(ROCK_LINE), DESERT_EROSION, DESERT_CONTINENTAL};
+        mix(&seed, sizeof(seed));
+        mix(&GENERATOR_VERSION, sizeof(GENERATOR_VERSION));
+        mix(shape, sizeof(shape));
+        mix(&CONTINENTAL_SPLINE, sizeof(CONTINENTAL_SPLINE));
+        mix(&EROSION_SPLINE, sizeof(EROSION_SPLINE));
+        const size_t lut_size = TerrainLut::size();
+        mix(&lut_size, sizeof(lut_size));
+        return h;
+    }
+
+    // The terrain splines baked at compile time, used by blendTerrainHeights
+    static const TerrainLut &getContinentalLut()
+    {
+        static constexpr TerrainLut lut = TerrainLut::build(CONTINENTAL_SPLINE);
+        return lut;
+    }
+    static const TerrainLut &getErosionLut()
+    {
+        static constexpr TerrainLut lut = TerrainLut::build(EROSION_SPLINE);
+        return lut;
+    }
+
 private:
     uint32_t seed;
 
+    // Scratch grids for generateHeightField, kept between calls (one instance per thread)
+    size_t tracked_bytes = 0; // This instance's share of getLiveBytes
+    std::vector<float> grid_continental;
+    std::vector<float> grid_erosion;
+    std::vector<float> grid_peaks;
+    std::vector<float> grid_erosion_effect;
+    std::vector<float> grid_heights;
+
     // FastNoise generators
     FastNoise::SmartNode<FastNoise::Generator> simplexGenerator;
     FastNoise::SmartNode<FastNoise::Generator> perlinGenerator;
@@ -27,6 +118,10 @@ private:
     FastNoise::SmartNode<FastNoise::FractalFBm> erosionGenerator;
     FastNoise::SmartNode<FastNoise::FractalFBm> peaksValleysGenerator;
 
+    // 3D fields of density terrain (see DensityTerrain)
+    FastNoise::SmartNode<FastNoise::FractalFBm> overhangGenerator;
+    FastNoise::SmartNode<FastNoise::FractalFBm> caveGenerator;
+
     // Simple hash function for generating pseudo-random values
     static inline uint32_t hash(uint32_t x)
     {
@@ -66,9 +161,65 @@ private:
         return t * t * (3.0f - 2.0f * t);
     }
 
+    static std::atomic<size_t> &liveInstanceCounter()
+    {
+        static std::atomic<size_t> count{0};
+        return count;
+    }
+    static std::atomic<size_t> &liveByteCounter()
+    {
+        static std::atomic<size_t> bytes{0};
+        return bytes;
+    }
+
+    FastNoise::SmartNode<FastNoise::FractalFBm> makeTerrainLayer(const FractalSettings &settings) const
+    {
+        auto layer = FastNoise::New<FastNoise::FractalFBm>();
+        layer->SetSource(simplexGenerator);
+        layer->SetOctaveCount(settings.octaves);
+        layer->SetLacunarity(settings.lacunarity);
+        layer->SetGain(settings.gain);
+        return layer;
+    }
+
+    // Peaks & valleys noise at a point in noise space, given the erosion there
+    float getPeaks(float x, float z, float erosion) const
+    {
+        return PEAKS_SHARE_EROSION ? erosion : peaksValleysGenerator->GenSingle2D(x, z, seed);
+    }
+
+    // Recount this instance's object and scratch grid bytes (FastNoise node graphs excluded)
+    void trackMemory()
+    {
+        size_t bytes = sizeof(*this) + (grid_continental.capacity() + grid_erosion.capacity() + grid_peaks.capacity() +
+                                        grid_erosion_effect.capacity() + grid_heights.capacity()) *
+                                           sizeof(float);
+        liveByteCounter() += bytes - tracked_bytes;
+        tracked_bytes = bytes;
+    }
+
 public:
+    // Instances alive across all threads and the memory they hold, for memory statistics
+    static size_t getLiveInstances() { return liveInstanceCounter().load(std::memory_order_relaxed); }
+    static size_t getLiveBytes() { return liveByteCounter().load(std::memory_order_relaxed); }
+
+    // Generator owned by the calling thread, rebuilt only when the seed changes. Building
+    // the FastNoise node graph per chunk was the main allocation cost of generation.
+    static VoxelNoise &forThread(uint32_t seed)
+    {
+        thread_local std::unique_ptr<VoxelNoise> instance;
+        if (!instance || instance->seed != seed)
+        {
+            instance = std::make_unique<VoxelNoise>(seed);
+        }
+        return *instance;
+    }
+
     explicit VoxelNoise(uint32_t seed) : seed(seed)
     {
+        liveInstanceCounter()++;
+        trackMemory();
+
         // Initialize FastNoise generators
         simplexGenerator = FastNoise::New<FastNoise::Simplex>();
         perlinGenerator = FastNoise::New<FastNoise::Perlin>();
@@ -81,27 +232,38 @@ public:
         fractalGenerator->SetGain(0.5f);
 
         // Continental Generator (Large, smooth features)
-        continentalGenerator = FastNoise::New<FastNoise::FractalFBm>();
-        continentalGenerator->SetSource(simplexGenerator);
-        continentalGenerator->SetOctaveCount(3);
-        continentalGenerator->SetLacunarity(1.5f);
-        continentalGenerator->SetGain(0.5f);
+        continentalGenerator = makeTerrainLayer(CONTINENTAL_LAYER);
 
         // Erosion Generator (Smaller, rougher features)
-        erosionGenerator = FastNoise::New<FastNoise::FractalFBm>();
-        erosionGenerator->SetSource(simplexGenerator);
-        erosionGenerator->SetOctaveCount(4);
-        erosionGenerator->SetLacunarity(2.0f);
-        erosionGenerator->SetGain(0.5f);
+        erosionGenerator = makeTerrainLayer(EROSION_LAYER);
 
         // Peaks & Valleys Generator (medium scale)
-        peaksValleysGenerator = FastNoise::New<FastNoise::FractalFBm>();
-        peaksValleysGenerator->SetSource(simplexGenerator);
-        peaksValleysGenerator->SetOctaveCount(4);
-        peaksValleysGenerator->SetLacunarity(2.0f);
-        peaksValleysGenerator->SetGain(0.5f);
+        peaksValleysGenerator = makeTerrainLayer(PEAKS_LAYER);
+
+        // Overhang Generator (bends the surface; low octaves keep the folds large)
+        overhangGenerator = FastNoise::New<FastNoise::FractalFBm>();
+        overhangGenerator->SetSource(simplexGenerator);
+        overhangGenerator->SetOctaveCount(2);
+        overhangGenerator->SetLacunarity(2.0f);
+        overhangGenerator->SetGain(0.5f);
+
+        // Cave Generator (sampled with an offset seed so caves do not follow the overhangs)
+        caveGenerator = FastNoise::New<FastNoise::FractalFBm>();
+        caveGenerator->SetSource(simplexGenerator);
+        caveGenerator->SetOctaveCount(2);
+        caveGenerator->SetLacunarity(2.0f);
+        caveGenerator->SetGain(0.5f);
     }
 
+    ~VoxelNoise()
+    {
+        liveInstanceCounter()--;
+        liveByteCounter() -= tracked_bytes;
+    }
+
+    VoxelNoise(const VoxelNoise &) = delete;
+    VoxelNoise &operator=(const VoxelNoise &) = delete;
+
     // Sample noise at 2D coordinates using FastNoise
     float sample2D(float x, float y) const
     {
@@ -130,7 +292,8 @@ public:
         return erosionGenerator->GenSingle2D(x, y, seed);
     }
 
-    float getPeaksandValleysGenerator(float x, float y){
+    float getPeaksandValleysGenerator(float x, float y) const
+    {
         return peaksValleysGenerator->GenSingle2D(x, y, seed);
     }
 
@@ -140,24 +303,179 @@ public:
         return fractalGenerator->GenSingle3D(x * frequency, y * frequency, z * frequency, seed);
     }
 
-    float evalSpline(const std::vector<SplinePoint> &spline, float t)
+    // Clamp raw noise in place and blend it into terrain heights (before truncation)
+    static void blendTerrainHeights(float *continental, float *erosion, float *peaks, float *erosion_effect,
+                                    float *heights, size_t count)
     {
-        // Clamp t to the spline's input range
-        if (t <= spline.front().input)
-            return spline.front().output;
-        if (t >= spline.back().input)
-            return spline.back().output;
+        for (size_t i = 0; i < count; ++i)
+        {
+            continental[i] = std::min(1.0f, std::max(-1.0f, continental[i]));
+            erosion[i] = std::min(1.0f, std::max(-1.0f, erosion[i]));
+            peaks[i] = std::min(1.0f, std::max(-1.0f, peaks[i]));
+        }
+
+        getContinentalLut().evalBatch(continental, heights, count);
+        getErosionLut().evalBatch(erosion, erosion_effect, count);
 
-        // Find the two points surrounding t
-        for (size_t i = 0; i < spline.size() - 1; ++i)
+        for (size_t i = 0; i < count; ++i)
         {
-            if (t >= spline[i].input && t <= spline[i + 1].input)
+            // x^1.5 as x * x * sqrt(x)
+            float mountain = std::max(0.0f, peaks[i] - erosion[i]);
+            mountain = mountain * mountain * std::sqrt(mountain) * MOUNTAIN_HEIGHT;
+            float height = heights[i] - erosion_effect[i];
+            heights[i] = erosion[i] < MOUNTAIN_EROSION_LIMIT ? height + mountain : height;
+        }
+    }
+
+    // Biome of a column from its truncated height and its clamped noise (as blendTerrainHeights
+    // leaves them): water and shore by height, rock above ROCK_LINE, desert on eroded inland flats
+    static Biome classifyBiome(int height, float continental, float erosion)
+    {
+        if (height <= WATER_LEVEL)
+        {
+            return BIOME_OCEAN;
+        }
+        if (height - 1 <= WATER_LEVEL + BEACH_HEIGHT)
+        {
+            return BIOME_BEACH;
+        }
+        if (height >= ROCK_LINE)
+        {
+            return BIOME_MOUNTAINS;
+        }
+        return erosion >= DESERT_EROSION && continental >= DESERT_CONTINENTAL ? BIOME_DESERT : BIOME_PLAINS;
+    }
+
+    // Terrain heights of a size_x by size_z block of columns starting at world (start_x, start_z),
+    // written x-major (heights[x * size_z + z]). The three noise layers are filled with
+    // GenUniformGrid2D, which runs FastNoise2's SIMD path, instead of per-column GenSingle2D.
+    // With step > 1 only every step-th column is sampled (start must be a multiple of step):
+    // that is the unit grid at step times the frequency. biomes, when given, receives each
+    // column's Biome in the same order, classified from the same noise.
+    void generateHeightField(int start_x, int start_z, int size_x, int size_z, int *heights, int step = 1,
+                             uint8_t *biomes = nullptr)
+    {
+        const float frequency = TERRAIN_FREQUENCY * step;
+        start_x /= step;
+        start_z /= step;
+
+        const size_t count = static_cast<size_t>(size_x) * size_z;
+        grid_continental.resize(count);
+        grid_erosion.resize(count);
+        grid_peaks.resize(count);
+        grid_erosion_effect.resize(count);
+        grid_heights.resize(count);
+        trackMemory();
+
+        // FastNoise grids are x-fastest: index z * size_x + x
+        continentalGenerator->GenUniformGrid2D(grid_continental.data(), start_x, start_z, size_x, size_z, frequency, seed);
+        erosionGenerator->GenUniformGrid2D(grid_erosion.data(), start_x, start_z, size_x, size_z, frequency, seed);
+        if (PEAKS_SHARE_EROSION)
+        {
+            std::copy(grid_erosion.begin(), grid_erosion.end(), grid_peaks.begin());
+        }
+        else
+        {
+            peaksValleysGenerator->GenUniformGrid2D(grid_peaks.data(), start_x, start_z, size_x, size_z, frequency, seed);
+        }
+
+        blendTerrainHeights(grid_continental.data(), grid_erosion.data(), grid_peaks.data(),
+                            grid_erosion_effect.data(), grid_heights.data(), count);
+
+        for (int z = 0; z < size_z; z++)
+        {
+            for (int x = 0; x < size_x; x++)
+            {
+                heights[x * size_z + z] = static_cast<int>(grid_heights[z * size_x + x]);
+            }
+        }
+        if (biomes)
+        {
+            for (int z = 0; z < size_z; z++)
             {
-                float localT = (t - spline[i].input) / (spline[i + 1].input - spline[i].input);
-                return VoxelNoise::lerp(spline[i].output, spline[i + 1].output, localT);
+                for (int x = 0; x < size_x; x++)
+                {
+                    size_t source = static_cast<size_t>(z) * size_x + x;
+                    biomes[x * size_z + z] =
+                        classifyBiome(heights[x * size_z + z], grid_continental[source], grid_erosion[source]);
+                }
             }
         }
-        return 0.0f; // Should never happen
+    }
+
+    // Raw noise of the terrain layers on a size_x by size_y grid of world positions (start + i)
+    // at TERRAIN_FREQUENCY, x fastest, one GenUniformGrid2D per layer. A null output skips
+    // that layer. For maps of the layers; chunks go through generateHeightField.
+    void generateNoiseLayers(int start_x, int start_y, int size_x, int size_y, float *continental, float *erosion,
+                             float *peaks, float *simplex, float *fractal) const
+    {
+        const std::pair<const FastNoise::Generator *, float *> layers[] = {
+            {continentalGenerator.get(), continental},
+            {erosionGenerator.get(), erosion},
+            {peaksValleysGenerator.get(), peaks},
+            {simplexGenerator.get(), simplex},
+            {fractalGenerator.get(), fractal}};
+        const bool copy_peaks = PEAKS_SHARE_EROSION && erosion && peaks;
+        for (const auto &layer : layers)
+        {
+            if (layer.second && !(copy_peaks && layer.second == peaks))
+            {
+                layer.first->GenUniformGrid2D(layer.second, start_x, start_y, size_x, size_y, TERRAIN_FREQUENCY, seed);
+            }
+        }
+        if (copy_peaks)
+        {
+            std::copy_n(erosion, static_cast<size_t>(size_x) * size_y, peaks);
+        }
+    }
+
+    // Terrain height before truncation at a point in noise space (world units times
+    // TERRAIN_FREQUENCY); same blend as generateHeightField
+    float getTerrainHeight(float x, float z) const
+    {
+        float continental = getContinentalness(x, z);
+        float erosion = getErosion(x, z);
+        float peaks = getPeaks(x, z, erosion);
+        float erosion_effect, height;
+        blendTerrainHeights(&continental, &erosion, &peaks, &erosion_effect, &height, 1);
+        return height;
+    }
+
+    // Terrain height of a single column
+    int sampleTerrainHeight(int world_x, int world_z) const
+    {
+        return static_cast<int>(getTerrainHeight(world_x * TERRAIN_FREQUENCY, world_z * TERRAIN_FREQUENCY));
+    }
+
+    // Biome of a single column; same classification as generateHeightField
+    Biome sampleBiome(int world_x, int world_z) const
+    {
+        float x = world_x * TERRAIN_FREQUENCY;
+        float z = world_z * TERRAIN_FREQUENCY;
+        float continental = getContinentalness(x, z);
+        float erosion = getErosion(x, z);
+        float peaks = getPeaks(x, z, erosion);
+        float erosion_effect, height;
+        blendTerrainHeights(&continental, &erosion, &peaks, &erosion_effect, &height, 1);
+        return classifyBiome(static_cast<int>(height), continental, erosion);
+    }
+
+    // 3D lattices for density terrain: size_x * size_y * size_z points, x fastest, then y, then z,
+    // at lattice coordinates start + i, which are world positions (start + i) * step. A null
+    // output skips that field.
+    void generateDensityLattice(int start_x, int start_y, int start_z, int size_x, int size_y, int size_z, int step,
+                                float *overhang, float *caves) const
+    {
+        if (overhang)
+        {
+            overhangGenerator->GenUniformGrid3D(overhang, start_x, start_y, start_z, size_x, size_y, size_z,
+                                                OVERHANG_FREQUENCY * step, seed);
+        }
+        if (caves)
+        {
+            caveGenerator->GenUniformGrid3D(caves, start_x, start_y, start_z, size_x, size_y, size_z,
+                                            CAVE_FREQUENCY * step, seed + 1);
+        }
     }
 
     // Generate height map using FastNoise2
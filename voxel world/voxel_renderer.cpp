@@ -1,49 +1,63 @@
 #include "voxel_renderer.h"
 #include "chunk_mesh.h"
+#include "render_backend.h"
+#include "entity_store.h"
 #include "../camera.h"
 #include "../shader.h"
 #include "../includes/stb_image.h"
+#include "startup_cache.h"
+#include "voxel_noise.h"
+#include "profiler.h"
+#include "log.h"
 #include <iostream>
 #include <algorithm>
 #include <filesystem>
 #include <vector>
 #include <chrono>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
 #include <string>
-
-VoxelRenderer::VoxelRenderer(uint32_t seed, int render_distance)
-    : chunks_rendered_last_frame(0), vertices_rendered_last_frame(0), block_texture_atlas(0),
-      instance_vbo(0), last_frame_time(0.0f), total_triangles_rendered(0),
-      uniform_model(-1), uniform_view(-1), uniform_projection(-1), uniform_texture_atlas(-1), uniform_time(-1),
-      water_frame_start(0), water_frame_count(0), water_animation_time(0.0f), stop_workers(false)
+#include <thread>
+#include <tuple>
+
+VoxelRenderer::VoxelRenderer(uint32_t seed, int render_distance, unsigned int worker_threads, bool pin_workers)
+    : chunks_rendered_last_frame(0), vertices_rendered_last_frame(0), chunks_visible_last_frame(0),
+      chunks_culled_last_frame(0), chunks_occluded_last_frame(0), occlusion_culling_enabled(true),
+      lod_meshing_enabled(true), direction_culling_enabled(true), gpu_occlusion_enabled(true), depth_prepass_enabled(true),
+      reverse_depth_enabled(true), oit_enabled(true), block_textures(0),
+      instance_vbo(0), last_frame_time(0.0f), total_triangles_rendered(0), total_unmerged_triangles(0),
+      uniform_view(-1), uniform_projection(-1), uniform_block_textures(-1), uniform_time(-1),
+      uniform_view_count(-1), uniform_eye_views(-1), water_frame_start(0), water_frame_count(0),
+      water_animation_time(0.0f), far_terrain_scale(4.0f),
+      upload_budget_bytes(2 * 1024 * 1024), bytes_uploaded_last_frame(0), upload_target_frame_ms(16.6f),
+      last_update_time(0.0f), lod_scale(1.0f), budget_frame_ms_sum(0.0f), budget_frame_samples(0)
 {
-    world = std::make_unique<VoxelWorld>(seed, render_distance);
-
-    // Start worker threads - increased to 10 threads
-    unsigned int num_threads = 10;
-    std::cout << "Starting " << num_threads << " mesh worker threads" << std::endl;
-
-    for (unsigned int i = 0; i < num_threads; ++i)
-    {
-        mesh_workers.emplace_back(&VoxelRenderer::workerLoop, this);
-    }
+    JobSystemConfig jobs;
+    jobs.thread_count = worker_threads;
+    jobs.reserved_threads = RESERVED_RENDER_THREADS;
+    jobs.lower_priority = true;
+    jobs.isolate_caller = pin_workers;
+    job_system = std::make_unique<JobSystem>(jobs);
+    world = std::make_unique<VoxelWorld>(seed, *job_system, render_distance);
+    world->enableMeshDirtyList();
 }
 
 VoxelRenderer::~VoxelRenderer()
 {
-    // Signal workers to stop and join them
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        stop_workers = true;
-    }
-    condition.notify_all();
-    for (std::thread &worker : mesh_workers)
-    {
-        if (worker.joinable())
-        {
-            worker.join();
-        }
-    }
+    setSimulationThread(false, glm::vec3(0.0f)); // Its ticks use the world and the job system; the snapshots hold chunks
+
+    // Finish queued generation/mesh jobs; both reference the world and this renderer
+    job_system->shutdown();
 
+    // Drop finished results first: they may hold the last handle to an unloaded chunk
+    completed_meshes.clear();
+    chunks_to_upload_queue = {};
+    edit_upload_queue = {};
+    gpu_mesh_queue.clear();
+
+    // Chunk meshes hand their ranges back to the arena, so they must go first
+    world.reset();
     cleanup();
 }
 
@@ -72,391 +86,1217 @@ bool VoxelRenderer::initialize()
     setupShaderUniforms();
     std::cout << "Shader uniforms set up!" << std::endl;
 
-    // Check for OpenGL errors
-    GLenum error = glGetError();
-    if (error != GL_NO_ERROR)
+    // Batch every chunk into one arena when multi-draw indirect is available
+    if (ChunkArena::isSupported())
     {
-        std::cerr << "OpenGL error during initialization: " << error << std::endl;
-        return false;
-    }
-
-    std::cout << "VoxelRenderer initialized successfully!" << std::endl;
-    return true;
-}
+        chunk_arena = std::make_unique<ChunkArena>(4 * 1024 * 1024);
+        std::cout << "Rendering path: shared arena + glMultiDrawElementsIndirect" << std::endl;
 
-// Add the worker loop implementation
-void VoxelRenderer::workerLoop()
-{
-    while (true)
-    {
-        VoxelChunk *chunk_to_mesh;
-        float chunk_distance;
+        if (StagingRing::isSupported())
         {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            condition.wait(lock, [this]
-                           { return stop_workers || !chunks_to_mesh_queue.empty(); });
-            if (stop_workers && chunks_to_mesh_queue.empty())
-            {
-                return;
-            }
-
-            auto chunk_pair = chunks_to_mesh_queue.top(); // Get nearest chunk
-            chunks_to_mesh_queue.pop();
-            chunk_distance = chunk_pair.first;
-            chunk_to_mesh = chunk_pair.second;
+            staging_ring = std::make_unique<StagingRing>(16 * 1024 * 1024);
         }
-
-        // std::cout << "Processing chunk at distance: " << chunk_distance << std::endl;
-
-        // Only process if chunk still needs meshing (avoid redundant work)
-        if (!chunk_to_mesh->needsMeshRebuild())
+        else
         {
-            chunk_to_mesh->setMeshing(false);
-            continue;
+            std::cout << "Mesh uploads: glBufferSubData (persistent staging requires OpenGL 4.4)" << std::endl;
         }
 
-        // Time the mesh building to identify slow chunks with timeout
-        auto mesh_start = std::chrono::high_resolution_clock::now();
-        bool mesh_success = false;
-        bool timed_out = false;
-
-        try
-        {
-            chunk_to_mesh->buildMesh();
-            mesh_success = true;
-        }
-        catch (const std::exception &e)
+        if (HiZCuller::isSupported())
         {
-            std::cerr << "Mesh building failed: " << e.what() << std::endl;
+            hiz_culler = std::make_unique<HiZCuller>();
+            if (hiz_culler->loadShaders())
+            {
+                std::cout << "Occlusion culling: GPU Hi-Z test of the opaque batch" << std::endl;
+            }
+            else
+            {
+                hiz_culler.reset();
+            }
         }
-        catch (...)
+
+        if (GpuMesher::isSupported())
         {
-            std::cerr << "Mesh building failed with unknown error" << std::endl;
+            gpu_mesher = std::make_unique<GpuMesher>();
+            if (!gpu_mesher->loadShaders())
+            {
+                gpu_mesher.reset();
+            }
+            else if (gpu_meshing_enabled)
+            {
+                std::cout << "Meshing: compute shaders for streamed chunks, CPU for edits and LOD" << std::endl;
+            }
         }
+    }
+    else
+    {
+        region_batcher = std::make_unique<RegionBatcher>();
+        std::cout << "Rendering path: per-chunk draws (" << RenderBackend::get().getName() << " backend), settled " << RegionBatcher::REGION_COLUMNS << "x"
+                  << RegionBatcher::REGION_COLUMNS << " regions batched (multi-draw indirect requires OpenGL 4.3)" << std::endl;
+    }
+
+    applyDepthMode();
+    std::cout << (isReverseDepth() ? "Depth: reverse-Z, 32-bit float, infinite far plane"
+                                   : "Depth: standard (reverse-Z requires OpenGL 4.5 or ARB_clip_control)")
+              << std::endl;
+    if (translucency_target)
+    {
+        std::cout << "Translucency: weighted blended OIT"
+                  << (scene_target ? "" : " (inactive with standard depth at full resolution)") << std::endl;
+    }
+    if (resolution_scaler)
+    {
+        std::cout << "Resolution: dynamic, " << ResolutionScaler::MIN_SCALE << "x to 1x for "
+                  << resolution_scaler->getTarget() << "ms of opaque and transparent GPU time" << std::endl;
+    }
 
-        auto mesh_end = std::chrono::high_resolution_clock::now();
-        float mesh_time = std::chrono::duration<float, std::milli>(mesh_end - mesh_start).count();
+    gpu_timer = std::make_unique<GpuTimer>();
 
-        // Check for timeout (anything over 500ms is problematic)
-        if (mesh_time > 500.0f)
+    if (far_voxels_enabled && FarVoxels::isSupported())
+    {
+        far_voxels = std::make_unique<FarVoxels>(world->getSeed(), *job_system);
+        if (!far_voxels->initialize())
         {
-            timed_out = true;
-            std::cout << "TIMEOUT: Mesh build took " << mesh_time << "ms for chunk at ("
-                      << chunk_to_mesh->position.x << ", " << chunk_to_mesh->position.y
-                      << ", " << chunk_to_mesh->position.z << ") - marking chunk as problematic" << std::endl;
+            far_voxels.reset(); // The heightfield instead
         }
-        else if (mesh_time > 50.0f) // Log if mesh building takes more than 50ms
+    }
+    if (!far_voxels)
+    {
+        far_terrain = std::make_unique<FarTerrain>(world->getSeed(), *job_system);
+        if (!far_terrain->initialize())
         {
-            std::cout << "Slow mesh build: " << mesh_time << "ms for chunk at ("
-                      << chunk_to_mesh->position.x << ", " << chunk_to_mesh->position.y
-                      << ", " << chunk_to_mesh->position.z << ")" << std::endl;
+            far_terrain.reset(); // Nothing is drawn past the render distance
         }
+    }
 
-        // Only queue for upload if mesh building was successful and didn't timeout
-        if (mesh_success && !timed_out)
+    if (shadows_enabled)
+    {
+        shadow_cascades = std::make_unique<ShadowCascades>();
+        if (!shadow_cascades->initialize())
         {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            chunks_to_upload_queue.push(chunk_to_mesh);
+            shadow_cascades.reset(); // Baked light only
         }
-        else
+    }
+    if (block_lights_enabled)
+    {
+        clustered_lights = std::make_unique<ClusteredLights>(*job_system);
+        if (!clustered_lights->initialize())
         {
-            // Reset meshing flag so problematic chunks can be retried later (but not immediately)
-            chunk_to_mesh->setMeshing(false);
+            clustered_lights.reset();
         }
     }
-}
 
-void VoxelRenderer::cleanup()
-{
-    if (block_texture_atlas != 0)
+    minimap = std::make_unique<Minimap>(world->getHeightFieldCache());
+    if (!minimap->initialize())
     {
-        glDeleteTextures(1, &block_texture_atlas);
-        block_texture_atlas = 0;
+        minimap.reset();
     }
 
-    if (instance_vbo != 0)
+    hud = std::make_unique<PerformanceHud>();
+    if (!hud->initialize())
     {
-        glDeleteBuffers(1, &instance_vbo);
-        instance_vbo = 0;
+        hud.reset();
     }
-}
 
-void VoxelRenderer::update(const Camera &camera)
-{
-    if (!world)
+    entity_renderer = std::make_unique<EntityRenderer>();
+    if (!entity_renderer->initialize())
     {
-        return;
+        entity_renderer.reset();
     }
 
-    // Update animation time (increment by 1/60 second)
-    water_animation_time += 1.0f / 60.0f;
+    // Check for OpenGL errors
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR)
+    {
+        std::cerr << "OpenGL error during initialization: " << error << std::endl;
+        return false;
+    }
 
-    // Update world based on camera position
-    world->update(camera.Position);
+    std::cout << "VoxelRenderer initialized successfully!" << std::endl;
+    return true;
+}
 
-    // --- Dispatch meshing jobs to worker threads ---
-    std::vector<std::pair<float, VoxelChunk *>> chunks_needing_mesh;
-    int total_chunks = 0;
-    int chunks_need_mesh = 0;
-    int chunks_already_meshing = 0;
+void VoxelRenderer::runMeshJob(MeshJob &job)
+{
+    // Build into a fresh mesh from the snapshot; the live chunk and its mesh are only
+    // touched again on the main thread
+    auto mesh_start = std::chrono::high_resolution_clock::now();
+    auto built = std::make_unique<ChunkMesh>();
+    std::unique_ptr<GpuMeshInput> gpu_input;
+    bool mesh_success = false;
+    bool timed_out = false;
 
-    for (const auto &[chunk_pos, chunk] : world->getChunks())
+    try
     {
-        total_chunks++;
-        if (chunk->needsMeshRebuild())
+        // Unloaded while the job was queued: the main thread would only discard the mesh.
+        // Edited since the snapshot: the edit queued a remesh in the fast lane, which would
+        // replace this one at once. Edit jobs are always built, so steady edits (flowing
+        // water) still show.
+        if (!job.chunk->is_loaded)
+        {
+            mesh_jobs_dropped++;
+        }
+        else if (!job.edit && job.chunk->version != job.snapshot->version)
         {
-            chunks_need_mesh++;
-            if (!chunk->isMeshing())
+            mesh_jobs_stale++;
+        }
+        else
+        {
+            if (job.gpu)
             {
-                glm::vec3 chunk_world_pos = glm::vec3(
-                    chunk_pos.x * CHUNK_SIZE,
-                    chunk_pos.y * CHUNK_HEIGHT,
-                    chunk_pos.z * CHUNK_SIZE);
-                float distance = glm::distance(camera.Position, chunk_world_pos);
-                chunks_needing_mesh.emplace_back(distance, chunk.get());
+                gpu_input = std::make_unique<GpuMeshInput>();
+                if (!GpuMesher::prepareInput(*job.snapshot, *gpu_input))
+                {
+                    gpu_input.reset();
+                }
             }
-            else
+            if (!gpu_input)
             {
-                chunks_already_meshing++;
+                built->buildMesh(*job.snapshot, job.lod, job.sectioned ? &job.rebuild : nullptr);
             }
+            mesh_success = true;
         }
     }
-
-    // Limit and sort - NEAREST FIRST for meshing priority
-    const int max_chunks_to_queue_per_frame = 8;
-    if (chunks_needing_mesh.size() > max_chunks_to_queue_per_frame)
+    catch (const std::exception &e)
+    {
+        Log::writeLimited(LogLevel::Error, "Mesh build failures", std::string("Mesh building failed: ") + e.what());
+    }
+    catch (...)
     {
-        chunks_needing_mesh.resize(max_chunks_to_queue_per_frame);
+        Log::writeLimited(LogLevel::Error, "Mesh build failures", "Mesh building failed with unknown error");
     }
 
-    // Sort by distance - NEAREST FIRST (ascending order)
-    std::sort(chunks_needing_mesh.begin(), chunks_needing_mesh.end());
+    auto mesh_end = std::chrono::high_resolution_clock::now();
+    float mesh_time = std::chrono::duration<float, std::milli>(mesh_end - mesh_start).count();
+    const glm::ivec3 &chunk_position = job.snapshot->position;
 
-    // Queue nearest chunks first
-    int current_queue_size = 0;
+    // Check for timeout (anything over 500ms is problematic)
+    if (mesh_time > 500.0f)
+    {
+        timed_out = true;
+        Log::writeLimited(LogLevel::Warning, "Mesh timeouts",
+                          "TIMEOUT: Mesh build took " + std::to_string(mesh_time) + "ms for chunk at (" +
+                              std::to_string(chunk_position.x) + ", " + std::to_string(chunk_position.y) + ", " +
+                              std::to_string(chunk_position.z) + ") - marking chunk as problematic");
+    }
+    else if (mesh_time > 50.0f) // Count mesh jobs that take more than 50ms
     {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        current_queue_size = chunks_to_mesh_queue.size();
+        Log::recordSlow("mesh jobs", mesh_time);
+    }
 
-        if (current_queue_size < 10) // Reduced queue size to prevent backlog
+    // Release the snapshot's handle before the result is visible, so the main thread
+    // holds the last reference to the chunk
+    job.snapshot.reset();
+
+    // Failed results still go back so the main thread can clear the meshing flag
+    auto result = std::make_unique<MeshResult>();
+    result->chunk = std::move(job.chunk);
+    result->edit = job.edit;
+    result->edit_time = job.edit_time;
+    if (job.sectioned)
+    {
+        result->sections = job.rebuild.dirty_sections;
+    }
+    result->built_at = std::chrono::steady_clock::now();
+    if (mesh_success && !timed_out && gpu_input)
+    {
+        result->gpu_input = std::move(gpu_input);
+    }
+    else if (mesh_success && !timed_out)
+    {
+        // Write straight into mapped GPU memory; when the ring is full the main thread
+        // uploads from the CPU copy instead
+        if (staging_ring && built->hasData())
         {
-            for (const auto &[distance, chunk] : chunks_needing_mesh)
+            if (void *destination = staging_ring->allocate(built->getUploadBytes(), result->staging))
             {
-                chunk->setMeshing(true);
-                chunks_to_mesh_queue.push({distance, chunk}); // Push distance + chunk pair
-                // std::cout << "Queued chunk at distance: " << distance << std::endl;
+                built->writeUploadData(destination);
             }
         }
+        result->mesh = std::move(built);
     }
-    condition.notify_all();
 
-    // --- Upload finished meshes on the main thread ---
-    auto frame_start = std::chrono::high_resolution_clock::now();
-    const float max_upload_time_ms = 1.0f;
-    int meshes_uploaded_this_frame = 0;
+    completed_meshes.push(result.release());
+    mesh_jobs_pending--;
+}
 
-    std::unique_lock<std::mutex> lock(queue_mutex);
-    while (!chunks_to_upload_queue.empty() && meshes_uploaded_this_frame < 1) // Only 1 upload per frame
+void VoxelRenderer::takeCompletedMeshes()
+{
+    for (MeshResult *node = completed_meshes.takeAll(); node != nullptr;)
     {
-        VoxelChunk *chunk = chunks_to_upload_queue.front();
-        chunks_to_upload_queue.pop();
-        lock.unlock();
-
-        auto upload_start = std::chrono::high_resolution_clock::now();
-
-        if (chunk->mesh && chunk->mesh->hasData())
+        std::unique_ptr<MeshResult> result(node);
+        node = node->next;
+        if (result->gpu_input)
         {
-            chunk->mesh->uploadToGPU();
-
-            auto upload_end = std::chrono::high_resolution_clock::now();
-            float upload_time = std::chrono::duration<float, std::milli>(upload_end - upload_start).count();
-
-            if (upload_time > 2.0f) // Log uploads that take more than 2ms
-            {
-                std::cout << "GPU UPLOAD TIMING for chunk (" << chunk->position.x << ", "
-                          << chunk->position.y << ", " << chunk->position.z << "): "
-                          << upload_time << "ms (vertices: " << chunk->mesh->vertex_count
-                          << ", indices: " << chunk->mesh->index_count << ")" << std::endl;
-            }
-            meshes_uploaded_this_frame++;
+            gpu_mesh_queue.push_back(std::move(*result));
         }
-        chunk->setMeshing(false);
-
-        auto upload_end = std::chrono::high_resolution_clock::now();
-        float upload_time = std::chrono::duration<float, std::milli>(upload_end - upload_start).count();
+        else
+        {
+            (result->edit ? edit_upload_queue : chunks_to_upload_queue).push(std::move(*result));
+        }
+    }
+}
 
-        // Check if we've used up time budget
-        auto current_time = std::chrono::high_resolution_clock::now();
-        float total_time = std::chrono::duration<float, std::milli>(current_time - frame_start).count();
+void VoxelRenderer::runGpuMeshing()
+{
+    // Emitted builds go on to the upload queue as meshes already placed in the arena
+    gpu_mesh_outputs.clear();
+    gpu_mesher->poll(*chunk_arena, gpu_mesh_outputs);
+    for (const GpuMeshOutput &output : gpu_mesh_outputs)
+    {
+        MeshResult result = std::move(gpu_mesh_queue.front());
+        gpu_mesh_queue.pop_front();
+        gpu_meshes_submitted--;
+        result.mesh = std::make_unique<ChunkMesh>();
+        result.mesh->adoptGpuGeometry(*chunk_arena, output);
+        result.built_at = std::chrono::steady_clock::now();
+        chunks_to_upload_queue.push(std::move(result));
+    }
 
-        if (total_time >= max_upload_time_ms)
+    while (gpu_meshes_submitted < gpu_mesh_queue.size())
+    {
+        auto waiting = gpu_mesh_queue.begin() + gpu_meshes_submitted;
+        if (!waiting->chunk->is_loaded)
+        {
+            // Unloaded while waiting: the upload loop drops it like a failed build
+            waiting->gpu_input.reset();
+            chunks_to_upload_queue.push(std::move(*waiting));
+            gpu_mesh_queue.erase(waiting);
+            continue;
+        }
+        if (!gpu_mesher->submit(*waiting->gpu_input))
         {
-            lock.lock();
             break;
         }
+        waiting->gpu_input.reset();
+        gpu_meshes_submitted++;
+    }
+}
+
+bool VoxelRenderer::dispatchMeshJob(std::shared_ptr<VoxelChunk> chunk, const Camera &camera, bool edit)
+{
+    chunk->setMeshing(true);
+    chunk->unpack(); // The job reads it per voxel
+    chunk->is_mesh_dirty = false;
+    uint8_t dirty_sections = chunk->dirty_mesh_sections;
+    chunk->dirty_mesh_sections = 0;
 
-        lock.lock();
+    if (chunk->pipeline.pending && chunk->pipeline.mesh_queued == std::chrono::steady_clock::time_point{})
+    {
+        chunk->pipeline.mesh_queued = std::chrono::steady_clock::now();
     }
 
-    // Print debug info occasionally
-    static int debug_counter = 0;
-    if (++debug_counter % 60 == 0) // Every 60 frames (1 second at 60fps)
+    MeshJob job;
+    job.lod = getMeshLOD(chunk->position, camera, chunk->mesh->isBuilt() ? chunk->mesh->lod : -1);
+    // Chunks go sectioned on their first edit-driven rebuild and stay that way, so
+    // later edits only remesh the sections they touched
+    if (job.lod == 0 && (chunk->mesh->sections || dirty_sections != ALL_MESH_SECTIONS))
     {
-        std::cout << "Chunks: Total=" << total_chunks
-                  << " NeedMesh=" << chunks_need_mesh
-                  << " Meshing=" << chunks_already_meshing
-                  << " QueueSize=" << current_queue_size << std::endl;
+        job.sectioned = true;
+        job.rebuild.previous = chunk->mesh->sections;
+        job.rebuild.dirty_sections = dirty_sections;
     }
+    job.edit = edit;
+    job.edit_time = chunk->edit_time;
+    // Edits stay on the CPU: sectioned rebuilds are cheaper and skip the counts readback
+    job.gpu = isGpuMeshingEnabled() && !edit && job.lod == 0 && !job.sectioned && getMeshFormat() == MeshFormat::Indexed;
+    chunk->has_pending_edit = false;
+
+    job.snapshot = std::make_shared<const ChunkSnapshot>(chunk);
+    chunk->predicted_faces = job.snapshot->getPredictedFaces();
+    job.chunk = std::move(chunk);
+    mesh_jobs_pending++;
+    bool partial = job.rebuild.previous && dirty_sections != ALL_MESH_SECTIONS;
+    job_system->submit([this, job]() mutable
+                       { runMeshJob(job); },
+                       edit ? JobPriority::High : JobPriority::Normal);
+    return partial;
 }
 
-void VoxelRenderer::render(const Camera &camera, const glm::mat4 &projection)
+void VoxelRenderer::cleanup()
 {
-    if (!shader || !world)
+    if (block_textures != 0)
     {
-        std::cerr << "Render called but shader or world is null!" << std::endl;
-        return;
+        glDeleteTextures(1, &block_textures);
+        block_textures = 0;
     }
 
-    // Track frame timing
-    auto frame_start = std::chrono::high_resolution_clock::now();
-
-    // Reset statistics
-    chunks_rendered_last_frame = 0;
-    vertices_rendered_last_frame = 0;
-    total_triangles_rendered = 0;
-
-    // Use shader and set common uniforms
-    shader->use();
-    glm::mat4 view = camera.GetViewMatrix();
-    glUniformMatrix4fv(uniform_projection, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniformMatrix4fv(uniform_view, 1, GL_FALSE, glm::value_ptr(view));
-    if (uniform_time != -1)
+    if (instance_vbo != 0)
     {
-        glUniform1f(uniform_time, water_animation_time);
+        glDeleteBuffers(1, &instance_vbo);
+        instance_vbo = 0;
     }
 
-    // Bind texture atlas
-    if (block_texture_atlas != 0)
+    far_terrain.reset();
+    far_voxels.reset();
+    shadow_cascades.reset();
+    clustered_lights.reset();
+    minimap.reset();
+    hud.reset();
+    entity_renderer.reset();
+    gpu_timer.reset();
+    hiz_culler.reset();
+    translucency_target.reset();
+    oit_shader.reset();
+    scene_target.reset();
+    staging_ring.reset();
+    region_batcher.reset();
+    gpu_mesher.reset();
+    chunk_arena.reset();
+    RenderBackend::get().releaseShared();
+}
+
+void VoxelRenderer::update(const Camera &camera, float delta_seconds)
+{
+    if (!world)
     {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, block_texture_atlas);
-        glUniform1i(uniform_texture_atlas, 0);
+        return;
     }
+    finishVisibility(); // Chunks are about to change under it
 
-    // ========== PASS 1: OPAQUE BLOCKS ==========
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);   // Enable writing to the depth buffer
-    glDisable(GL_BLEND);    // No blending needed for opaque blocks
-    glEnable(GL_CULL_FACE); // Cull back-faces for performance
+    // By the frame's time step, not per frame, so water moves at the same speed at any frame rate
+    water_animation_time += std::clamp(delta_seconds, 0.0f, MAX_ANIMATION_STEP);
+    hud_frame_seconds = delta_seconds;
 
-    glUniform1i(uniform_render_pass, 0); // Tell shader this is the opaque pass
+    PROFILE_ZONE("VoxelRenderer::update");
+    if (!prewarming)
+    {
+        updateRenderBudget(); // Prewarm passes are not frames
+    }
+    auto update_start = std::chrono::high_resolution_clock::now();
 
-    // Collect and sort chunks by distance for better batching
-    struct ChunkDistance
+    // Update world based on camera position, unless the simulation thread ticks it; shells it
+    // dropped are recycled here, where their GL objects live, and the frame draws what the
+    // last tick published
+    if (simulation)
+    {
+        simulation->setCenter(camera.Position);
+        world->releaseDroppedShells();
+        takeSnapshot();
+    }
+    else
+    {
+        world->update(camera.Position);
+    }
+    if (far_terrain)
+    {
+        far_terrain->update(camera.Position, getFarTerrainInnerRadius(), getFarTerrainOuterRadius());
+    }
+    if (far_voxels)
     {
-        float distance;
-        glm::ivec3 position;
-        VoxelChunk *chunk;
+        far_voxels->update(camera.Position, getFarTerrainInnerRadius(), getFarTerrainOuterRadius(), world->getTerrainMode());
+    }
+    if (minimap)
+    {
+        minimap->update(camera.Position);
+    }
 
-        bool operator<(const ChunkDistance &other) const
+    // --- Dispatch meshing jobs to worker threads ---
+    chunks_needing_mesh.clear();
+    edited_chunks.clear();
+    int chunks_need_mesh = 0;
+    int chunks_already_meshing = 0;
+    int chunks_skipped = 0;
+    int chunks_deferred = 0;
+    int partial_remeshes = 0;
+    int lod_transitions = rescanMeshLods(camera);
+    int total_chunks = static_cast<int>(world->getChunks().size());
+
+    // Only chunks the world listed as changed since last frame and the ones still waiting
+    // from earlier frames (throttled, deferred or meshing) are looked at, never every loaded one
+    world->takeMeshDirtyChunks(mesh_dirty_chunks);
+    std::sort(mesh_dirty_chunks.begin(), mesh_dirty_chunks.end(), [](const glm::ivec3 &a, const glm::ivec3 &b)
+              { return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z); });
+    mesh_dirty_chunks.erase(std::unique(mesh_dirty_chunks.begin(), mesh_dirty_chunks.end()), mesh_dirty_chunks.end());
+
+    size_t still_dirty = 0;
+    for (const glm::ivec3 &chunk_pos : mesh_dirty_chunks)
+    {
+        VoxelChunk *chunk = world->getChunk(chunk_pos);
+        if (!chunk)
         {
-            return distance < other.distance;
+            continue; // Unloaded since it was listed
         }
-    };
-
-    std::vector<ChunkDistance> opaque_chunks;
-    glm::vec3 camera_pos = camera.Position;
-
-    for (const auto &[chunk_pos, chunk] : world->getChunks())
-    {
-        if (chunk->mesh && chunk->mesh->isUploaded() && !chunk->mesh->isEmpty())
+        if (!chunk->needsMeshRebuild())
         {
-            // Frustum culling
-            if (!isChunkInFrustum(chunk_pos, camera, projection))
-                continue;
+            chunk->is_mesh_listed = false;
+            continue;
+        }
 
-            // Calculate distance for sorting
-            glm::vec3 chunk_world_pos = glm::vec3(chunk_pos.x * CHUNK_SIZE, chunk_pos.y * CHUNK_HEIGHT, chunk_pos.z * CHUNK_SIZE);
-            float distance = glm::distance(camera_pos, chunk_world_pos);
-            opaque_chunks.push_back({distance, chunk_pos, chunk.get()});
+        chunks_need_mesh++;
+        if (chunk->isMeshing())
+        {
+            chunks_already_meshing++;
+        }
+        else if (chunk->canSkipMeshing())
+        {
+            // Uniform chunk with no exposed face: resolved here without a mesh job
+            chunk->markMeshSkipped();
+            chunk->is_mesh_listed = false;
+            chunks_skipped++;
+            continue;
+        }
+        else if (chunk->has_pending_edit)
+        {
+            chunk->ensureMesh();
+            edited_chunks.push_back(world->getChunkHandle(chunk_pos));
+        }
+        else if (isWaitingForNeighbors(*chunk))
+        {
+            chunks_deferred++;
         }
+        else
+        {
+            chunk->ensureMesh();
+            chunks_needing_mesh.push_back(scoreMeshCandidate(*chunk, camera));
+            chunks_needing_mesh.back().chunk = world->getChunkHandle(chunk_pos);
+        }
+        // Stays listed until a frame finds nothing left to do for it
+        mesh_dirty_chunks[still_dirty++] = chunk_pos;
     }
+    mesh_dirty_chunks.resize(still_dirty);
 
-    // Sort front to back for early Z-rejection
-    std::sort(opaque_chunks.begin(), opaque_chunks.end());
-
-    for (const auto &chunk_data : opaque_chunks)
+    // Edits first and past the throttle below; a huge edit spreads over a few frames
+    size_t edit_dispatches = std::min(edited_chunks.size(), MAX_EDIT_MESHES_PER_FRAME);
+    for (size_t i = 0; i < edit_dispatches; i++)
     {
-        glm::mat4 model = getChunkModelMatrix(chunk_data.position);
-        glUniformMatrix4fv(uniform_model, 1, GL_FALSE, glm::value_ptr(model));
-        chunk_data.chunk->mesh->render();
-        chunks_rendered_last_frame++;
-        vertices_rendered_last_frame += chunk_data.chunk->mesh->vertex_count;
-        total_triangles_rendered += chunk_data.chunk->mesh->index_count / 3;
+        partial_remeshes += dispatchMeshJob(std::move(edited_chunks[i]), camera, true) ? 1 : 0;
     }
 
-    // ========== PASS 2: TRANSPARENT BLOCKS ==========
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDepthMask(GL_FALSE); // IMPORTANT: Read from depth buffer but DO NOT write to it
-
-    glUniform1i(uniform_render_pass, 1); // Tell shader this is the transparent pass
-
-    // Collect transparent chunks and sort back to front
-    std::vector<ChunkDistance> transparent_chunks;
-
-    for (const auto &[chunk_pos, chunk] : world->getChunks())
+    // The best few, scored for where the camera is now; the rest stay listed and are scored
+    // again next frame. Prewarm keeps every worker busy instead.
+    const size_t max_mesh_backlog = prewarming ? job_system->getWorkerCount() * 4 : 10;
+    const size_t max_chunks_to_queue_per_frame = prewarming ? max_mesh_backlog : 8;
+    size_t queued_count = std::min(chunks_needing_mesh.size(), max_chunks_to_queue_per_frame);
+    std::partial_sort(chunks_needing_mesh.begin(), chunks_needing_mesh.begin() + queued_count, chunks_needing_mesh.end());
+    chunks_needing_mesh.resize(queued_count);
+
+    // Queue the best chunks first
+    int current_queue_size = mesh_jobs_pending.load();
+    if (current_queue_size < static_cast<int>(max_mesh_backlog)) // Reduced queue size to prevent backlog
     {
-        if (chunk->mesh && chunk->mesh->isUploaded() && !chunk->mesh->isEmpty())
+        // Snapshots are taken here on the main thread: from now on edits only mark the
+        // chunk dirty again and are picked up by the next job
+        for (MeshCandidate &candidate : chunks_needing_mesh)
         {
-            // TODO: Add hasTransparentBlocks() method to VoxelChunk for optimization
-            if (!isChunkInFrustum(chunk_pos, camera, projection))
-                continue;
-
-            glm::vec3 chunk_world_pos = glm::vec3(chunk_pos.x * CHUNK_SIZE, chunk_pos.y * CHUNK_HEIGHT, chunk_pos.z * CHUNK_SIZE);
-            float distance = glm::distance(camera_pos, chunk_world_pos);
-            transparent_chunks.push_back({distance, chunk_pos, chunk.get()});
+            partial_remeshes += dispatchMeshJob(std::move(candidate.chunk), camera, false) ? 1 : 0;
         }
     }
+    chunks_needing_mesh.clear(); // Handles are not held past the frame; the capacity is
+    edited_chunks.clear();
 
-    // Sort back to front for proper transparency
-    std::sort(transparent_chunks.rbegin(), transparent_chunks.rend());
-
-    for (const auto &chunk_data : transparent_chunks)
+    // --- Upload finished meshes on the main thread ---
+    // Staged meshes cost the main thread only two copy commands each; the byte budget
+    // bounds how much copy/upload work lands on one frame
+    if (staging_ring)
     {
-        glm::mat4 model = getChunkModelMatrix(chunk_data.position);
-        glUniformMatrix4fv(uniform_model, 1, GL_FALSE, glm::value_ptr(model));
-        chunk_data.chunk->mesh->render();
-        total_triangles_rendered += chunk_data.chunk->mesh->index_count / 3;
+        staging_ring->retire();
     }
+    adaptUploadBudget();
 
-    // ========== RESET OPENGL STATE ==========
-    glDepthMask(GL_TRUE);
-    glDisable(GL_BLEND);
+    size_t bytes_uploaded = 0;
+    int meshes_uploaded_this_frame = 0;
 
-    // Calculate frame time
-    auto frame_end = std::chrono::high_resolution_clock::now();
-    last_frame_time = std::chrono::duration<float, std::milli>(frame_end - frame_start).count();
+    if (gpu_timer)
+    {
+        gpu_timer->begin(GpuPass::Upload);
+    }
+    takeCompletedMeshes();
+    if (gpu_mesher)
+    {
+        runGpuMeshing();
+    }
+    while (true)
+    {
+        // Edit results ignore the budget (they are few and the player waits on them) but
+        // still count against it
+        bool from_edits = !edit_upload_queue.empty();
+        if (!from_edits && (chunks_to_upload_queue.empty() ||
+                            (!prewarming && bytes_uploaded >= upload_budget_bytes && meshes_uploaded_this_frame > 0)))
+        {
+            break;
+        }
+        std::queue<MeshResult> &source = from_edits ? edit_upload_queue : chunks_to_upload_queue;
+        MeshResult result = std::move(source.front());
+        source.pop();
 
-    // Log rendering performance periodically
-    static int render_debug_counter = 0;
-    static float total_render_time = 0.0f;
-    static int render_samples = 0;
+        VoxelChunk *chunk = result.chunk.get();
+        chunk->setMeshing(false);
 
-    total_render_time += last_frame_time;
+        bool still_loaded = world->getChunk(chunk->position) == chunk;
+        if (!still_loaded || !result.mesh)
+        {
+            if (result.staging.isValid())
+            {
+                staging_ring->discard(result.staging);
+            }
+            if (still_loaded)
+            {
+                chunk->markMeshDirty(result.sections); // No mesh: retry on a later frame
+                if (result.edit && !chunk->has_pending_edit)
+                {
+                    chunk->has_pending_edit = true; // Back into the fast lane, latency still counting
+                    chunk->edit_time = result.edit_time;
+                }
+            }
+
+            // Unloaded while meshing: dropping the result frees the chunk here, on the main thread
+            result = {};
+            continue;
+        }
+
+        chunk->ensureMesh()->adoptGeometry(*result.mesh);
+        draw_lists_dirty = true;
+        if (region_batcher)
+        {
+            region_batcher->markChanged(chunk->position); // Split until the region settles again
+        }
+        if (shadow_cascades)
+        {
+            shadow_cascades->markChanged(chunk->position); // Cached cascades over it are drawn again
+        }
+        if (chunk->mesh->isBuilt() && !chunk->mesh->isEmpty() &&
+            chunk->mesh->lod != getMeshLOD(chunk->position, camera, chunk->mesh->lod))
+        {
+            chunk->markMeshDirty(); // The camera moved on while it was meshing; rescans skip meshing chunks
+        }
+        chunk->face_connectivity = chunk->mesh->face_connectivity;
+
+        auto upload_start = std::chrono::high_resolution_clock::now();
+
+        if (chunk->mesh->isUploaded())
+        {
+            // Emitted into the arena by the GPU mesher: nothing left to copy
+            meshes_uploaded_this_frame++;
+            if (chunk->pipeline.pending && chunk->pipeline.uploaded == std::chrono::steady_clock::time_point{})
+            {
+                chunk->pipeline.meshed = result.built_at;
+                chunk->pipeline.uploaded = std::chrono::steady_clock::now();
+            }
+        }
+        else if (chunk->mesh->hasData())
+        {
+            bool uploaded = false;
+            if (chunk_arena && result.staging.isValid())
+            {
+                uploaded = chunk->mesh->uploadToArena(*chunk_arena, staging_ring->getBuffer(), result.staging.offset);
+                if (uploaded)
+                {
+                    staging_ring->markCopied(result.staging);
+                }
+                else
+                {
+                    staging_ring->discard(result.staging);
+                }
+            }
+            else if (chunk_arena)
+            {
+                uploaded = chunk->mesh->uploadToArena(*chunk_arena);
+            }
+
+            if (!uploaded)
+            {
+                chunk->mesh->uploadToGPU();
+            }
+
+            auto upload_end = std::chrono::high_resolution_clock::now();
+            float upload_time = std::chrono::duration<float, std::milli>(upload_end - upload_start).count();
+
+            if (upload_time > 2.0f) // Count uploads that take more than 2ms
+            {
+                Log::recordSlow("chunk uploads", upload_time);
+            }
+            bytes_uploaded += chunk->mesh->getUploadBytes();
+            meshes_uploaded_this_frame++;
+
+            if (chunk->pipeline.pending && chunk->pipeline.uploaded == std::chrono::steady_clock::time_point{})
+            {
+                chunk->pipeline.meshed = result.built_at;
+                chunk->pipeline.uploaded = std::chrono::steady_clock::now();
+            }
+        }
+        else
+        {
+            chunk->pipeline.pending = false; // Nothing to draw, so no pop-in to time
+
+            // Rebuilt to nothing: give its old arena space back
+            chunk->mesh->releaseArena();
+            if (result.staging.isValid())
+            {
+                staging_ring->discard(result.staging);
+            }
+        }
+
+        if (result.edit)
+        {
+            edit_latency.record(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - result.edit_time).count());
+        }
+    }
+    size_t uploads_waiting = chunks_to_upload_queue.size() + edit_upload_queue.size() + completed_meshes.size();
+
+    if (staging_ring)
+    {
+        staging_ring->endFrame();
+    }
+    if (gpu_timer)
+    {
+        gpu_timer->end(GpuPass::Upload);
+    }
+    bytes_uploaded_last_frame = bytes_uploaded;
+
+    if (clustered_lights)
+    {
+        clustered_lights->gather(*world, camera.Position); // Emitters as of this frame's edits and loads
+    }
+
+    streaming_stats.loaded_chunks = total_chunks;
+    streaming_stats.chunks_need_mesh = chunks_need_mesh;
+    streaming_stats.chunks_meshing = chunks_already_meshing;
+    streaming_stats.uploads_waiting = uploads_waiting;
+    streaming_stats.meshes_uploaded = meshes_uploaded_this_frame;
+    streaming_stats.bytes_uploaded = bytes_uploaded;
+    streaming_stats.pending_loads = world->getPendingLoadCount();
+
+    auto update_end = std::chrono::high_resolution_clock::now();
+    last_update_time = std::chrono::duration<float, std::milli>(update_end - update_start).count();
+
+    // Streaming stats once a second via the logger
+    static int debug_counter = 0;
+    if (++debug_counter % 60 == 0) // Every 60 frames (1 second at 60fps)
+    {
+        std::ostringstream out;
+        out << "Chunks: Total=" << total_chunks
+            << " NeedMesh=" << chunks_need_mesh
+            << " Meshing=" << chunks_already_meshing
+            << " Skipped=" << chunks_skipped
+            << " Deferred=" << chunks_deferred
+            << " Partial=" << partial_remeshes
+            << " LodRemesh=" << lod_transitions
+            << " QueueSize=" << current_queue_size
+            << " DroppedUnloaded=" << mesh_jobs_dropped.load()
+            << " DroppedStale=" << mesh_jobs_stale.load() << "\n";
+
+        out << "Uploads: Budget=" << upload_budget_bytes / 1024 << "KB"
+            << " LastFrame=" << bytes_uploaded_last_frame / 1024 << "KB"
+            << " Waiting=" << uploads_waiting;
+        if (staging_ring)
+        {
+            out << " Staging=" << staging_ring->getUsedBytes() / 1024 << "/"
+                << staging_ring->getCapacity() / 1024 << "KB";
+        }
+
+        if (edit_latency.total > 0)
+        {
+            out << "\nEdit latency:";
+            for (int bucket = 0; bucket < EditLatencyHistogram::BUCKETS; bucket++)
+            {
+                if (bucket + 1 < EditLatencyHistogram::BUCKETS)
+                {
+                    out << " <" << EditLatencyHistogram::getBucketLimit(bucket) << "ms=" << edit_latency.counts[bucket];
+                }
+                else
+                {
+                    out << " more=" << edit_latency.counts[bucket];
+                }
+            }
+            out << " Max=" << edit_latency.max_ms << "ms";
+        }
+
+        ChunkGenerationStats gen_stats = world->getGenerationStats();
+        streaming_stats.generation_queued = gen_stats.queued;
+        streaming_stats.generation_in_flight = gen_stats.in_flight;
+        streaming_stats.chunk_load_ms = gen_stats.avg_queue_wait_ms + gen_stats.avg_generate_ms + gen_stats.avg_handoff_ms;
+        out << "\nGeneration: Queued=" << gen_stats.queued
+            << " InFlight=" << gen_stats.in_flight
+            << " AwaitingInsert=" << gen_stats.awaiting_insert
+            << " Wait=" << gen_stats.avg_queue_wait_ms << "ms"
+            << " Generate=" << gen_stats.avg_generate_ms << "ms (max " << gen_stats.max_generate_ms << "ms)"
+            << " Handoff=" << gen_stats.avg_handoff_ms << "ms"
+            << " Integrate=" << gen_stats.last_integrate_ms << "ms"
+            << " Generated=" << gen_stats.total_generated
+            << " (restored " << gen_stats.total_restored << ", saving " << gen_stats.pending_saves
+            << ", unsaved " << gen_stats.unsaved_chunks << ")"
+            << " Discarded=" << gen_stats.total_discarded
+            << " Implicit=" << gen_stats.implicit_chunks << " (total " << gen_stats.total_implicit << ")"
+            << " BorderChecks=" << gen_stats.predicted_faces_checked << " (wrong " << gen_stats.predicted_faces_wrong << ")"
+            << " Pooled=" << gen_stats.pooled_chunks
+            << " Retired=" << gen_stats.retired_chunks
+            << " Allocated=" << gen_stats.chunks_allocated
+            << " HeightTiles=" << gen_stats.height_tiles
+            << " (hits " << gen_stats.height_tile_hits << ", misses " << gen_stats.height_tile_misses
+            << ", from disk " << gen_stats.height_tiles_loaded << ")\n";
+
+        JobSystemStats job_stats = job_system->getStats();
+        out << "Jobs: Workers=" << job_stats.workers
+            << " Queued=" << job_stats.queued
+            << " Executed=" << job_stats.jobs_executed
+            << " Stolen=" << job_stats.jobs_stolen
+            << " LockContention=" << job_stats.lock_contentions
+            << " Idle=" << job_stats.idle_fraction * 100.0f << "%";
+
+        const LatencyHistogram &total_latency = pipeline_latency.get(PipelineStage::Total);
+        if (total_latency.getCount() > 0)
+        {
+            out << "\nPop-in p95:";
+            for (int stage = 0; stage < static_cast<int>(PipelineStage::Count); stage++)
+            {
+                out << " " << getPipelineStageName(static_cast<PipelineStage>(stage)) << "="
+                    << pipeline_latency.stages[stage].getPercentile(0.95f) << "ms";
+            }
+            out << " (" << total_latency.getCount() << " chunks)";
+        }
+        Log::write(LogLevel::Info, out.str());
+    }
+}
+
+void VoxelRenderer::render(const Camera &camera, const glm::mat4 &projection)
+{
+    if (!shader || !world)
+    {
+        std::cerr << "Render called but shader or world is null!" << std::endl;
+        return;
+    }
+
+    // Track frame timing
+    PROFILE_ZONE("VoxelRenderer::render");
+    auto frame_start = std::chrono::high_resolution_clock::now();
+
+    // Reset statistics
+    chunks_rendered_last_frame = 0;
+    vertices_rendered_last_frame = 0;
+    total_triangles_rendered = 0;
+    total_unmerged_triangles = 0;
+
+    if (hiz_culler)
+    {
+        hiz_culler->beginFrame();
+    }
+
+    // Use shader and set common uniforms
+    shader->use();
+    glm::mat4 view = camera.GetViewMatrix();
+    glUniformMatrix4fv(uniform_projection, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniformMatrix4fv(uniform_view, 1, GL_FALSE, glm::value_ptr(view));
+    const int view_count = isStereoEnabled() ? STEREO_VIEWS : 1;
+    glUniform1i(uniform_view_count, view_count);
+    if (view_count > 1)
+    {
+        eye_views = getEyeViews(view);
+        glUniformMatrix4fv(uniform_eye_views, STEREO_VIEWS, GL_FALSE, glm::value_ptr(eye_views[0]));
+    }
+    if (uniform_time != -1)
+    {
+        glUniform1f(uniform_time, water_animation_time);
+    }
+    glUniform1i(uniform_render_pass, 0); // Also draws the opaque range when voxel_opaque.fs is missing
+
+    // Bind texture atlas
+    if (block_textures != 0)
+    {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, block_textures);
+        glUniform1i(uniform_block_textures, 0);
+    }
+
+    // ========== PASS 1: OPAQUE BLOCKS ==========
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);   // Enable writing to the depth buffer
+    glDisable(GL_BLEND);    // No blending needed for opaque blocks
+    glEnable(GL_CULL_FACE); // Cull back-faces for performance
+
+    // Visible chunks in draw order; the GL setup above overlapped the prepared frame's job
+    if (visibility_pending)
+    {
+        finishVisibility();
+    }
+    else
+    {
+        buildDrawLists(projection * getCullView(camera, projection), camera.Position);
+    }
+
+    // Light binning runs on a worker under the sun depth pass, which needs the loaded chunks
+    // rather than this frame's culling; both are done before any color
+    if (clustered_lights)
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        // Side-by-side views bin one eye's width around the camera; the grid repeats per view
+        clustered_lights->schedule(view, projection, viewport[2] / view_count, viewport[3]);
+    }
+    if (shadow_cascades)
+    {
+        renderShadows(camera.Position);
+        shader->use();
+    }
+    if (clustered_lights)
+    {
+        clustered_lights->finish();
+        clustered_lights->bindTextures();
+    }
+    setLightingUniforms(*shader);
+
+    region_drawn.assign(opaque_chunks.size(), 0);
+    if (region_batcher)
+    {
+        if (region_members_stale)
+        {
+            region_batcher->setMembers(cull_candidates);
+            region_members_stale = false;
+        }
+        region_batcher->update(REGION_PACKS_PER_FRAME);
+        region_batcher->beginFrame();
+        for (size_t i = 0; i < opaque_chunks.size(); i++)
+        {
+            region_drawn[i] = region_batcher->claim(opaque_chunks[i].position);
+        }
+    }
+
+    for (const auto &chunk_data : opaque_chunks)
+    {
+        const ChunkMesh &mesh = *chunk_data.chunk->mesh;
+        chunks_rendered_last_frame++;
+        vertices_rendered_last_frame += mesh.vertex_count;
+        total_unmerged_triangles += mesh.face_count * 2;
+        if (chunk_data.chunk->pipeline.pending)
+        {
+            recordFirstDraw(*chunk_data.chunk);
+        }
+    }
+
+    // Draws one range of every visible chunk; arena draws are queued for the caller to flush.
+    // A replay only redraws per-chunk meshes and regions, the arena resubmits its last batch itself.
+    auto drawPass = [&](MeshPass pass, bool replay)
+    {
+        for (size_t i = 0; i < opaque_chunks.size(); i++)
+        {
+            const ChunkDistance &chunk_data = opaque_chunks[i];
+            if (region_drawn[i] && pass != MeshPass::Translucent)
+            {
+                continue;
+            }
+            const ChunkMesh &mesh = *chunk_data.chunk->mesh;
+            size_t submitted = 0;
+            if (mesh.isInArena())
+            {
+                if (!replay)
+                {
+                    submitted = mesh.queueArenaDraw(*chunk_arena, pass, getChunkOrigin(chunk_data.position), chunk_data.directions);
+                }
+            }
+            else if (mesh.getIndexCount(pass) > 0)
+            {
+                setChunkOrigin(chunk_data.position);
+                submitted = mesh.renderRange(pass, chunk_data.directions);
+            }
+            if (!replay)
+            {
+                total_triangles_rendered += submitted / 3;
+            }
+        }
+        if (region_batcher)
+        {
+            size_t submitted = region_batcher->draw(pass, camera.Position, direction_culling_enabled && view_count == 1);
+            if (!replay)
+            {
+                total_triangles_rendered += submitted / 3;
+            }
+        }
+    };
+
+    // Chunk draws of a stereo frame carry an instance per eye (see voxel.vs); the layers drawn
+    // between the chunk passes do not, and draw once per eye into its half of the target
+    auto setChunkViews = [&](bool enabled)
+    {
+        if (view_count == 1)
+        {
+            return;
+        }
+        ChunkMesh::setViewCount(enabled ? view_count : 1);
+        if (enabled)
+        {
+            glEnable(GL_CLIP_DISTANCE0);
+        }
+        else
+        {
+            glDisable(GL_CLIP_DISTANCE0);
+        }
+    };
+    auto drawPerView = [&](auto &&draw)
+    {
+        if (view_count == 1)
+        {
+            draw(view);
+            return;
+        }
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLint half = viewport[2] / 2;
+        glViewport(viewport[0], viewport[1], half, viewport[3]);
+        draw(eye_views[0]);
+        glViewport(viewport[0] + half, viewport[1], viewport[2] - half, viewport[3]);
+        draw(eye_views[1]);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    };
+
+    // Fully opaque range: a shader without discard keeps early-Z. With the pre-pass, depth is
+    // laid down first by a shader that samples nothing and the color pass then only shades
+    // the fragments that won (GL_EQUAL, no depth writes).
+    Shader &opaque_program = opaque_shader ? *opaque_shader : *shader;
+    if (gpu_timer)
+    {
+        gpu_timer->begin(GpuPass::Opaque);
+    }
+    if (chunk_arena)
+    {
+        chunk_arena->beginBatch();
+    }
+    setChunkViews(true);
+    if (isDepthPrepassEnabled())
+    {
+        depth_shader->use();
+        setPassMatrices(*depth_shader, view, projection);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        drawPass(MeshPass::Opaque, false);
+        flushArenaBatch(true);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+        opaque_program.use();
+        setPassMatrices(opaque_program, view, projection);
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+        if (chunk_arena)
+        {
+            chunk_arena->redrawBatch(); // Same culled indirect commands as the pre-pass
+        }
+        drawPass(MeshPass::Opaque, true);
+        glDepthFunc(isReverseDepth() ? GL_GREATER : GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+    else
+    {
+        opaque_program.use();
+        setPassMatrices(opaque_program, view, projection);
+        drawPass(MeshPass::Opaque, false);
+        flushArenaBatch(true);
+    }
+
+    // Alpha-tested leaves and glass write depth for the transparent pass and Hi-Z capture
+    shader->use();
+    drawPass(MeshPass::Cutout, false);
+    flushArenaBatch();
+    setChunkViews(false);
+
+    // Terrain past the loaded chunks; it sits under the voxels wherever the two overlap
+    if (far_terrain)
+    {
+        drawPerView([&](const glm::mat4 &eye_view) { far_terrain->render(eye_view, projection, frustum); });
+        shader->use();
+    }
+    if (far_voxels)
+    {
+        drawPerView([&](const glm::mat4 &eye_view) { far_voxels->render(eye_view, projection, frustum, isReverseDepth()); });
+        shader->use();
+    }
+    if (entity_renderer)
+    {
+        drawPerView([&](const glm::mat4 &eye_view)
+                    {
+                        if (simulation)
+                        {
+                            entity_renderer->render(snapshot_front.entity_kinds, snapshot_front.entity_positions,
+                                                    snapshot_front.entity_kind_indices, eye_view, projection, frustum);
+                        }
+                        else
+                        {
+                            entity_renderer->render(world->getEntities(), eye_view, projection, frustum);
+                        }
+                    });
+        shader->use();
+    }
+    if (gpu_timer)
+    {
+        gpu_timer->end(GpuPass::Opaque);
+    }
+
+    // Opaque depth is complete: it becomes the occluder set for the next frame's batch (one
+    // view's depth only, so stereo frames neither capture nor test)
+    if (hiz_culler && gpu_occlusion_enabled && view_count == 1)
+    {
+        hiz_culler->captureDepth(projection * view);
+    }
+
+    // ========== PASS 2: TRANSPARENT BLOCKS ==========
+    if (gpu_timer)
+    {
+        gpu_timer->begin(GpuPass::Transparent);
+    }
+    glDepthMask(GL_FALSE); // IMPORTANT: Read from depth buffer but DO NOT write to it
+
+    // Weighted blended OIT needs no order; otherwise draws inside one multi-draw call execute
+    // in order, so the back-to-front chunk order still holds (quads inside a chunk stay unsorted)
+    setChunkViews(true);
+    bool weighted_blend = !transparent_chunks.empty() && isOrderIndependentTransparencyEnabled() && scene_target->isBound() &&
+                          translucency_target->begin(scene_target->getDepthBuffer(), scene_target->getWidth(),
+                                                     scene_target->getHeight());
+    if (weighted_blend)
+    {
+        oit_shader->use();
+        setPassMatrices(*oit_shader, view, projection);
+        oit_shader->setFloat("time", water_animation_time);
+    }
+    else
+    {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glUniform1i(uniform_render_pass, 1); // Tell shader this is the transparent pass
+    }
+
+    for (const auto &chunk_data : transparent_chunks)
+    {
+        const ChunkMesh &mesh = *chunk_data.chunk->mesh;
+        if (mesh.isInArena())
+        {
+            total_triangles_rendered += mesh.queueArenaDraw(*chunk_arena, MeshPass::Translucent,
+                                                            getChunkOrigin(chunk_data.position), chunk_data.directions) / 3;
+            continue;
+        }
+
+        setChunkOrigin(chunk_data.position);
+        total_triangles_rendered += mesh.renderRange(MeshPass::Translucent, chunk_data.directions) / 3;
+    }
+    flushArenaBatch();
+    setChunkViews(false);
+    if (weighted_blend)
+    {
+        translucency_target->resolve(scene_target->getFramebuffer());
+    }
+    if (gpu_timer)
+    {
+        gpu_timer->end(GpuPass::Transparent);
+    }
+
+    // ========== RESET OPENGL STATE ==========
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    if (scene_target)
+    {
+        scene_target->present(); // The minimap draws straight into the window
+    }
+    // Next frame's size from the newest timer results; the upload phase does not scale
+    if (resolution_scaler && scene_target &&
+        resolution_scaler->update(getGpuPassTime(GpuPass::Opaque) + getGpuPassTime(GpuPass::Transparent)))
+    {
+        scene_target->setRenderScale(resolution_scaler->getScale());
+    }
+
+    if (isMinimapEnabled())
+    {
+        minimap->render(camera.Position, camera.Yaw);
+    }
+    if (isHudEnabled())
+    {
+        renderHud();
+    }
+
+    // Calculate frame time
+    auto frame_end = std::chrono::high_resolution_clock::now();
+    last_frame_time = std::chrono::duration<float, std::milli>(frame_end - frame_start).count();
+
+    // Log rendering performance periodically
+    static int render_debug_counter = 0;
+    static float total_render_time = 0.0f;
+    static float total_gpu_time[static_cast<int>(GpuPass::Count)] = {};
+    static int render_samples = 0;
+
+    total_render_time += last_frame_time;
+    for (int pass = 0; pass < static_cast<int>(GpuPass::Count); pass++)
+    {
+        total_gpu_time[pass] += getGpuPassTime(static_cast<GpuPass>(pass));
+    }
     render_samples++;
 
     if (++render_debug_counter % 300 == 0) // Every 5 seconds at 60fps
     {
         float avg_render_time = total_render_time / render_samples;
         std::cout << "RENDER PERFORMANCE SUMMARY:" << std::endl;
-        std::cout << "  Average render time: " << avg_render_time << "ms" << std::endl;
-        std::cout << "  Chunks rendered: " << chunks_rendered_last_frame << std::endl;
+        std::cout << "  Average render time: " << avg_render_time << "ms (CPU submission)" << std::endl;
+        if (gpu_timer)
+        {
+            float opaque_ms = total_gpu_time[static_cast<int>(GpuPass::Opaque)] / render_samples;
+            float transparent_ms = total_gpu_time[static_cast<int>(GpuPass::Transparent)] / render_samples;
+            float upload_ms = total_gpu_time[static_cast<int>(GpuPass::Upload)] / render_samples;
+            std::cout << "  Average GPU time: " << opaque_ms + transparent_ms + upload_ms << "ms (opaque " << opaque_ms
+                      << "ms, transparent " << transparent_ms << "ms, upload " << upload_ms << "ms)" << std::endl;
+        }
+        if (resolution_scaler && scene_target)
+        {
+            std::cout << "  Render scale: " << scene_target->getRenderScale() << " (" << scene_target->getRenderWidth()
+                      << "x" << scene_target->getRenderHeight() << " of " << scene_target->getWidth() << "x"
+                      << scene_target->getHeight() << ", target " << resolution_scaler->getTarget() << "ms)" << std::endl;
+        }
+        std::cout << "  Chunks rendered: " << chunks_rendered_last_frame
+                  << " (" << chunks_occluded_last_frame << " occluded, "
+                  << chunks_culled_last_frame << " frustum culled)" << std::endl;
+        std::cout << "  Cull tree: " << cull_tree.getNodeCount() << " nodes, " << cull_tree.getBoxesTestedLastCull()
+                  << " of " << chunk_bounds.size() << " boxes tested" << std::endl;
+        if (hiz_culler && gpu_occlusion_enabled)
+        {
+            std::cout << "  GPU occluded (Hi-Z): " << hiz_culler->getOccludedCount() << " opaque chunk draws" << std::endl;
+        }
+        if (far_terrain)
+        {
+            std::cout << "  Far terrain: " << far_terrain->getTilesRendered() << " / " << far_terrain->getTileCount()
+                      << " tiles (" << far_terrain->getTrianglesRendered() << " triangles)" << std::endl;
+        }
+        if (far_voxels)
+        {
+            std::cout << "  Far voxels: " << far_voxels->getColumnsRendered() << " / " << far_voxels->getColumnCount()
+                      << " columns (" << far_voxels->getMemoryUsage() / 1024 << " KB of trees)" << std::endl;
+        }
+        if (shadow_cascades)
+        {
+            std::cout << "  Shadows: " << shadow_cascades->getCascadesDrawnLastFrame() << " / " << ShadowCascades::CASCADES
+                      << " cascades drawn last frame" << std::endl;
+        }
+        if (clustered_lights && clustered_lights->getLightCount() > 0)
+        {
+            std::cout << "  Block lights: " << clustered_lights->getLightCount() << " lights, "
+                      << clustered_lights->getIndexCount() << " cluster entries" << std::endl;
+        }
+        if (entity_renderer)
+        {
+            std::cout << "  Entities: " << entity_renderer->getEntitiesRendered() << " / "
+                      << (simulation ? snapshot_front.entity_positions.size() : world->getEntities().getCount())
+                      << " drawn" << std::endl;
+        }
+        if (simulation)
+        {
+            std::cout << "  Simulation: " << simulation->getTickCount() << " ticks (" << simulation->getDroppedTicks()
+                      << " dropped), last " << simulation->getLastTickTime() << "ms" << std::endl;
+        }
         std::cout << "  Vertices rendered: " << vertices_rendered_last_frame << std::endl;
         std::cout << "  Triangles rendered: " << total_triangles_rendered << std::endl;
+        if (chunk_arena)
+        {
+            std::cout << "  Arena: " << chunk_arena->getUsedBytes() / 1024 << " / "
+                      << chunk_arena->getCapacityBytes() / 1024 << " KB (multi-draw indirect)" << std::endl;
+        }
+        if (gpu_mesher)
+        {
+            std::cout << "  GPU meshing: " << gpu_mesher->getBuildsCompleted() << " built, " << gpu_meshes_submitted
+                      << " in flight, " << gpu_mesh_queue.size() - gpu_meshes_submitted << " waiting" << std::endl;
+        }
+        if (region_batcher)
+        {
+            std::cout << "  Regions: " << region_batcher->getPackedRegionCount() << " / " << region_batcher->getRegionCount()
+                      << " packed (" << region_batcher->getGpuBytes() / 1024 << " KB)" << std::endl;
+        }
+        std::cout << "  Mesher: " << getMeshingModeName(getMeshingMode()) << ", " << getMeshFormatName(getMeshFormat())
+                  << " (" << total_unmerged_triangles << " unmerged triangles, "
+                  << getTriangleReduction() * 100.0f << "% reduction)" << std::endl;
 
         // Reset counters
         total_render_time = 0.0f;
+        std::fill(std::begin(total_gpu_time), std::end(total_gpu_time), 0.0f);
         render_samples = 0;
     }
 }
@@ -479,11 +1319,291 @@ void VoxelRenderer::setVoxel(int x, int y, int z, VoxelID voxel)
     world->setVoxel(x, y, z, voxel);
 }
 
+size_t VoxelRenderer::applyEdits(const std::vector<VoxelEdit> &edits)
+{
+    return world ? world->applyEdits(edits) : 0;
+}
+
+size_t VoxelRenderer::fillBox(const glm::ivec3 &min_corner, const glm::ivec3 &max_corner, VoxelID voxel)
+{
+    return world ? world->fillBox(min_corner, max_corner, voxel) : 0;
+}
+
+size_t VoxelRenderer::fillSphere(const glm::vec3 &center, float radius, VoxelID voxel)
+{
+    return world ? world->fillSphere(center, radius, voxel) : 0;
+}
+
+void VoxelRenderer::setEditJournal(EditJournal *journal)
+{
+    if (world)
+    {
+        world->setEditJournal(journal);
+    }
+}
+
+bool VoxelRenderer::undoEdit()
+{
+    return world && world->undoEdit();
+}
+
+bool VoxelRenderer::redoEdit()
+{
+    return world && world->redoEdit();
+}
+
+VoxelRayHit VoxelRenderer::raycast(const VoxelRay &ray) const
+{
+    return world ? world->raycast(ray) : VoxelRayHit{};
+}
+
+void VoxelRenderer::setSimulationThread(bool enabled, const glm::vec3 &center)
+{
+    if (!world || enabled == (simulation != nullptr))
+    {
+        return;
+    }
+    finishVisibility(); // The culling job reads the snapshot, or the chunks the ticks change
+    if (!enabled)
+    {
+        simulation.reset();
+        snapshot_front = {};
+        snapshot_back = {};
+        snapshot_ready = {};
+        snapshot_fresh = false;
+        return;
+    }
+
+    simulation = std::make_unique<SimulationThread>(*world);
+    simulation->setCenter(center);
+    simulation->setPublisher([this](const glm::vec3 &tick_center) { publishSnapshot(tick_center); });
+    publishSnapshot(center); // The first frame does not wait for a tick
+    takeSnapshot();
+    simulation->start();
+    std::cout << "World updates: simulation thread, " << 1.0f / SimulationThread::TICK_SECONDS << " ticks per second"
+              << std::endl;
+}
+
+std::unique_lock<std::mutex> VoxelRenderer::lockWorld()
+{
+    return simulation ? simulation->lockWorld() : std::unique_lock<std::mutex>();
+}
+
+void VoxelRenderer::publishSnapshot(const glm::vec3 &center)
+{
+    PROFILE_ZONE("VoxelRenderer::publishSnapshot");
+    FrameSnapshot &snapshot = snapshot_back;
+    snapshot.center = center;
+    snapshot.chunks.clear(); // Drops the handles of the snapshot before last
+    for (const auto &[chunk_pos, chunk] : world->getChunks())
+    {
+        if (chunk->mesh)
+        {
+            snapshot.chunks.emplace_back(chunk_pos, chunk);
+        }
+    }
+
+    // Walked from where the world was streamed around, a tick behind the camera at most
+    if (occlusion_culling_enabled)
+    {
+        snapshot.visibility.update(*world, center);
+    }
+    else
+    {
+        snapshot.visibility.disable();
+    }
+
+    const EntityStore &entities = world->getEntities();
+    snapshot.entity_kinds = entities.getKinds();
+    snapshot.entity_positions = entities.getPositions();
+    snapshot.entity_kind_indices = entities.getKindIndices();
+
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    std::swap(snapshot_back, snapshot_ready);
+    snapshot_fresh = true;
+}
+
+void VoxelRenderer::takeSnapshot()
+{
+    std::lock_guard<std::mutex> lock(snapshot_mutex);
+    if (snapshot_fresh)
+    {
+        std::swap(snapshot_front, snapshot_ready);
+        snapshot_fresh = false;
+    }
+}
+
+void VoxelRenderer::saveWorld()
+{
+    if (world)
+    {
+        world->flushSaves();
+    }
+}
+
 size_t VoxelRenderer::getLoadedChunkCount() const
 {
     return world ? world->getLoadedChunkCount() : 0;
 }
 
+MemoryStats VoxelRenderer::getMemoryStats()
+{
+    MemoryStats stats;
+    if (!world)
+    {
+        return stats;
+    }
+
+    for (const auto &[chunk_pos, chunk] : world->getChunks())
+    {
+        stats.chunks++;
+        stats.chunk_bytes += chunk->getMemoryUsage();
+        stats.packed_chunks += chunk->isPacked() ? 1 : 0;
+        if (chunk->mesh)
+        {
+            stats.mesh_cpu_bytes += chunk->mesh->getCpuMemoryUsage();
+        }
+    }
+    stats.chunk_cache_bytes = stats.chunks * VoxelChunk::getCacheBytes();
+    stats.pooled_chunk_bytes = world->getPooledChunkBytes();
+    stats.noise_instances = VoxelNoise::getLiveInstances();
+    stats.noise_bytes = VoxelNoise::getLiveBytes();
+    stats.mesh_pool_bytes = MeshBufferPool::instance().getPooledBytes();
+
+    stats.gpu_mesh_bytes = ChunkMesh::getGpuBufferBytes();
+    stats.gpu_arena_bytes = chunk_arena ? chunk_arena->getCapacityBytes() : 0;
+    stats.gpu_region_bytes = region_batcher ? region_batcher->getGpuBytes() : 0;
+    stats.gpu_staging_bytes = staging_ring ? staging_ring->getCapacity() : 0;
+
+    stats.upload_queue = chunks_to_upload_queue.size() + edit_upload_queue.size() + completed_meshes.size();
+    stats.generation_queue = streaming_stats.generation_queued;
+    return stats;
+}
+
+ChunkGenerationStats VoxelRenderer::getGenerationStats()
+{
+    return world ? world->getGenerationStats() : ChunkGenerationStats{};
+}
+
+void VoxelRenderer::adaptUploadBudget()
+{
+    // CPU time of the previous frame; uploads grow while there is headroom below the
+    // target and back off quickly once a frame runs over it
+    float frame_work_ms = last_update_time + last_frame_time;
+    float headroom_ms = upload_target_frame_ms - frame_work_ms;
+
+    if (headroom_ms < 0.0f)
+    {
+        upload_budget_bytes /= 2;
+    }
+    else if (headroom_ms > upload_target_frame_ms * 0.25f && bytes_uploaded_last_frame >= upload_budget_bytes)
+    {
+        // Only grow while the budget is actually the limit
+        upload_budget_bytes += upload_budget_bytes / 4;
+    }
+    upload_budget_bytes = std::clamp(upload_budget_bytes, MIN_UPLOAD_BUDGET_BYTES, MAX_UPLOAD_BUDGET_BYTES);
+}
+
+float VoxelRenderer::getFarTerrainInnerRadius() const
+{
+    // Loaded chunks reach render_distance chunks out; the last one may still be streaming in
+    return std::max(0, getRenderDistance() - 1) * static_cast<float>(CHUNK_SIZE);
+}
+
+float VoxelRenderer::getFarTerrainOuterRadius() const
+{
+    return far_terrain_scale > 1.0f ? getRenderDistance() * far_terrain_scale * CHUNK_SIZE : 0.0f;
+}
+
+void VoxelRenderer::setReverseDepth(bool enabled)
+{
+    reverse_depth_enabled = enabled;
+    if (shader)
+    {
+        applyDepthMode(); // Already initialized: switch now
+    }
+}
+
+void VoxelRenderer::setFramebufferSize(int width, int height)
+{
+    framebuffer_width = width;
+    framebuffer_height = height;
+    if (scene_target)
+    {
+        scene_target->setSize(width, height); // A failure shows up as a failed bind
+    }
+}
+
+void VoxelRenderer::setDynamicResolution(float target_ms)
+{
+    if (target_ms > 0.0f)
+    {
+        resolution_scaler = std::make_unique<ResolutionScaler>(target_ms);
+    }
+    else
+    {
+        resolution_scaler.reset();
+    }
+    if (shader)
+    {
+        applyDepthMode(); // Already initialized: the scene target may come or go
+    }
+}
+
+void VoxelRenderer::applyDepthMode()
+{
+    bool reverse = reverse_depth_enabled && SceneTarget::isSupported();
+    bool offscreen = reverse || resolution_scaler != nullptr;
+    if (offscreen && !scene_target)
+    {
+        scene_target = std::make_unique<SceneTarget>();
+        if (framebuffer_width > 0 && framebuffer_height > 0)
+        {
+            scene_target->setSize(framebuffer_width, framebuffer_height);
+        }
+    }
+    else if (!offscreen)
+    {
+        scene_target.reset();
+    }
+    if (scene_target)
+    {
+        scene_target->setRenderScale(resolution_scaler ? resolution_scaler->getScale() : 1.0f);
+    }
+    reverse_depth = reverse;
+    if (reverse || SceneTarget::isSupported())
+    {
+        SceneTarget::applyDepthConvention(reverse);
+    }
+    if (hiz_culler)
+    {
+        hiz_culler->setReverseDepth(reverse);
+    }
+}
+
+glm::mat4 VoxelRenderer::getProjection(float fov_y_degrees, float aspect) const
+{
+    if (isReverseDepth())
+    {
+        return SceneTarget::makeProjection(glm::radians(fov_y_degrees), aspect, NEAR_PLANE);
+    }
+    return glm::perspective(glm::radians(fov_y_degrees), aspect, NEAR_PLANE, getViewDistance());
+}
+
+float VoxelRenderer::getViewDistance() const
+{
+    // The far plane has to reach past the far terrain ring's corners
+    float terrain = far_terrain  ? getFarTerrainOuterRadius() + FarTerrain::TILE_SIZE
+                    : far_voxels ? getFarTerrainOuterRadius() + FarVoxels::COLUMN_SIZE
+                                 : 0.0f;
+    return std::max(1000.0f, terrain);
+}
+
+JobSystemStats VoxelRenderer::getJobStats()
+{
+    return job_system->getStats();
+}
+
 void VoxelRenderer::setRenderDistance(int distance)
 {
     if (world)
@@ -497,181 +1617,409 @@ int VoxelRenderer::getRenderDistance() const
     return world ? world->getRenderDistance() : 0;
 }
 
-bool VoxelRenderer::loadShaders()
+void VoxelRenderer::setTerrainMode(TerrainMode mode)
 {
-    try
+    if (world)
     {
-        shader = std::make_unique<Shader>("shaders/voxel.vs", "shaders/voxel.fs");
-        return true;
+        world->setTerrainMode(mode);
     }
-    catch (const std::exception &e)
+}
+
+TerrainMode VoxelRenderer::getTerrainMode() const
+{
+    return world ? world->getTerrainMode() : TerrainMode::Heightmap;
+}
+
+void VoxelRenderer::setRenderBudget(const RenderBudget &budget)
+{
+    budget_controller = std::make_unique<RenderBudgetController>(budget);
+    budget_frame_ms_sum = 0.0f;
+    budget_frame_samples = 0;
+}
+
+void VoxelRenderer::updateRenderBudget()
+{
+    if (!budget_controller || !world)
+    {
+        return;
+    }
+
+    // Work of the previous frame, not its wall time: vsync would hide any headroom
+    budget_frame_ms_sum += std::max(last_update_time + last_frame_time, getGpuFrameTime());
+    if (++budget_frame_samples < BUDGET_SAMPLE_FRAMES)
+    {
+        return;
+    }
+
+    float average_frame_ms = budget_frame_ms_sum / budget_frame_samples;
+    budget_frame_ms_sum = 0.0f;
+    budget_frame_samples = 0;
+
+    MemoryStats memory = getMemoryStats();
+    int distance = world->getRenderDistance();
+    float previous_lod_scale = lod_scale;
+    if (!budget_controller->update(distance, lod_scale, memory.getCpuBytes(), memory.getGpuBytes(), average_frame_ms))
+    {
+        return;
+    }
+
+    std::cout << "Render budget: distance " << world->getRenderDistance() << " -> " << distance << ", LOD scale "
+              << previous_lod_scale << " -> " << lod_scale << " (" << average_frame_ms << "ms, "
+              << memory.getCpuBytes() / (1024 * 1024) << "MB CPU, " << memory.getGpuBytes() / (1024 * 1024) << "MB GPU)"
+              << std::endl;
+    world->setRenderDistance(distance);
+}
+
+void VoxelRenderer::setMeshingMode(MeshingMode mode)
+{
+    if (mode == ChunkMesh::getMeshingMode())
+    {
+        return;
+    }
+
+    ChunkMesh::setMeshingMode(mode);
+    if (world)
+    {
+        world->markAllMeshesDirty();
+    }
+    std::cout << "Meshing mode: " << getMeshingModeName(mode) << std::endl;
+}
+
+MeshingMode VoxelRenderer::getMeshingMode() const
+{
+    return ChunkMesh::getMeshingMode();
+}
+
+void VoxelRenderer::setMeshFormat(MeshFormat format)
+{
+    if (format == ChunkMesh::getMeshFormat())
+    {
+        return;
+    }
+
+    // Meshes keep drawing in their old format until their rebuild lands
+    ChunkMesh::setMeshFormat(format);
+    if (world)
+    {
+        world->markAllMeshesDirty();
+    }
+    std::cout << "Mesh format: " << getMeshFormatName(format) << std::endl;
+}
+
+MeshFormat VoxelRenderer::getMeshFormat() const
+{
+    return ChunkMesh::getMeshFormat();
+}
+
+void EditLatencyHistogram::record(float milliseconds)
+{
+    int bucket = 0;
+    while (bucket + 1 < BUCKETS && milliseconds >= getBucketLimit(bucket))
+    {
+        bucket++;
+    }
+    counts[bucket]++;
+    total++;
+    max_ms = std::max(max_ms, milliseconds);
+}
+
+const char *getPipelineStageName(PipelineStage stage)
+{
+    switch (stage)
+    {
+    case PipelineStage::Generate:
+        return "generate";
+    case PipelineStage::MeshWait:
+        return "mesh_wait";
+    case PipelineStage::Mesh:
+        return "mesh";
+    case PipelineStage::Upload:
+        return "upload";
+    case PipelineStage::Draw:
+        return "draw";
+    case PipelineStage::Total:
+        return "total";
+    default:
+        return "unknown";
+    }
+}
+
+void VoxelRenderer::recordFirstDraw(VoxelChunk &chunk)
+{
+    ChunkPipelineTimes &times = chunk.pipeline;
+    if (times.uploaded == std::chrono::steady_clock::time_point{})
+    {
+        return; // Drawn from a mesh uploaded before it was tracked
+    }
+    times.pending = false;
+
+    auto now = std::chrono::steady_clock::now();
+    auto milliseconds = [](std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+    {
+        return std::chrono::duration<float, std::milli>(to - from).count();
+    };
+    pipeline_latency.get(PipelineStage::Generate).record(milliseconds(times.requested, times.generated));
+    pipeline_latency.get(PipelineStage::MeshWait).record(milliseconds(times.generated, times.mesh_queued));
+    pipeline_latency.get(PipelineStage::Mesh).record(milliseconds(times.mesh_queued, times.meshed));
+    pipeline_latency.get(PipelineStage::Upload).record(milliseconds(times.meshed, times.uploaded));
+    pipeline_latency.get(PipelineStage::Draw).record(milliseconds(times.uploaded, now));
+    pipeline_latency.get(PipelineStage::Total).record(milliseconds(times.requested, now));
+}
+
+float VoxelRenderer::getTriangleReduction() const
+{
+    if (total_unmerged_triangles == 0)
+    {
+        return 0.0f;
+    }
+    return 1.0f - static_cast<float>(total_triangles_rendered) / static_cast<float>(total_unmerged_triangles);
+}
+
+float VoxelRenderer::getGpuFrameTime() const
+{
+    float total = 0.0f;
+    for (int pass = 0; pass < static_cast<int>(GpuPass::Count); pass++)
     {
-        std::cerr << "Shader loading error: " << e.what() << std::endl;
+        total += getGpuPassTime(static_cast<GpuPass>(pass));
+    }
+    return total;
+}
+
+void VoxelRenderer::renderHud()
+{
+    // Last frame's times: this one is still being submitted
+    float cpu_ms = last_update_time + last_frame_time;
+    hud->recordFrame(cpu_ms, gpu_timer ? getGpuFrameTime() : 0.0f);
 
-        // Try alternative paths
-        try
+    if (hud->needsText())
+    {
+        char line[128];
+        std::vector<std::string> text;
+        auto add = [&text, &line]() { text.emplace_back(line); };
+
+        std::snprintf(line, sizeof(line), "FPS %.0f  CPU %.2f MS (UPDATE %.2f, RENDER %.2f)",
+                      hud_frame_seconds > 0.0f ? 1.0f / hud_frame_seconds : 0.0f, cpu_ms, last_update_time, last_frame_time);
+        add();
+        if (gpu_timer)
         {
-            shader = std::make_unique<Shader>("voxel world/voxel.vs", "voxel world/voxel.fs");
-            return true;
+            std::snprintf(line, sizeof(line), "GPU %.2f MS (OPAQUE %.2f, TRANSPARENT %.2f, UPLOAD %.2f)",
+                          getGpuFrameTime(), getGpuPassTime(GpuPass::Opaque), getGpuPassTime(GpuPass::Transparent),
+                          getGpuPassTime(GpuPass::Upload));
+            add();
+        }
+        std::snprintf(line, sizeof(line), "CHUNKS %zu DRAWN, %zu CULLED, %zu OCCLUDED", chunks_rendered_last_frame,
+                      chunks_culled_last_frame, chunks_occluded_last_frame);
+        add();
+        std::snprintf(line, sizeof(line), "VERTICES %zu  TRIANGLES %zu", vertices_rendered_last_frame,
+                      total_triangles_rendered);
+        add();
+        std::snprintf(line, sizeof(line), "STREAMING %zu LOADED, %zu LOADING, %zu MESHING, %zu UPLOADS",
+                      streaming_stats.loaded_chunks, streaming_stats.pending_loads + streaming_stats.generation_in_flight,
+                      streaming_stats.chunks_need_mesh, streaming_stats.uploads_waiting);
+        add();
+        MemoryStats memory;
+        {
+            std::unique_lock<std::mutex> world_lock = lockWorld(); // render runs without it
+            memory = getMemoryStats(); // At the text rate only, it walks the chunks
         }
-        catch (const std::exception &e2)
+        std::snprintf(line, sizeof(line), "MEMORY %.1f MB CPU, %.1f MB GPU", memory.getCpuBytes() / (1024.0 * 1024.0),
+                      memory.getGpuBytes() / (1024.0 * 1024.0));
+        add();
+        hud->setText(std::move(text));
+    }
+
+    hud->render();
+}
+
+bool VoxelRenderer::loadShaders()
+{
+    // Chunk pipelines come from the render backend; the composite is a plain GL program
+    RenderBackend &backend = RenderBackend::get();
+    StartupCache cache;
+    for (const char *directory : {"shaders/", "voxel world/"})
+    {
+        std::string base(directory);
+        shader = backend.loadPipeline("voxel", base + "voxel.vs", base + "voxel.fs");
+        if (shader)
         {
-            std::cerr << "Alternative shader loading error: " << e2.what() << std::endl;
-            return false;
+            // Optional: without them the opaque range falls back to the alpha-tested shader
+            opaque_shader = backend.loadPipeline("voxel_opaque", base + "voxel.vs", base + "voxel_opaque.fs");
+            depth_shader = backend.loadPipeline("voxel_depth", base + "voxel.vs", base + "voxel_depth.fs");
+            if (!opaque_shader)
+            {
+                depth_shader.reset(); // The GL_EQUAL pass needs the same vertex shader on both programs
+            }
+            if (TranslucencyTarget::isSupported())
+            {
+                oit_shader = backend.loadPipeline("voxel_oit", base + "voxel.vs", base + "voxel_oit.fs");
+                std::unique_ptr<Shader> composite =
+                    cache.loadShader("oit_composite", base + "oit_composite.vs", base + "oit_composite.fs");
+                if (oit_shader && composite)
+                {
+                    translucency_target = std::make_unique<TranslucencyTarget>(std::move(composite));
+                }
+                else
+                {
+                    oit_shader.reset();
+                }
+            }
+            return true;
         }
     }
+    std::cerr << "Shader loading error: voxel.vs/voxel.fs not found" << std::endl;
+    return false;
 }
 
 bool VoxelRenderer::loadTextures()
 {
-    // Define the texture files we need in order
-    std::vector<std::string> texture_files = {
-        "air.png",              // 0 - placeholder (not used)
-        "stone.png",            // 1 - Stone
-        "dirt.png",             // 2 - Dirt
-        "grass_block_top.png",  // 3 - Grass top
-        "grass_block_side.png", // 4 - Grass side
-        "cobblestone.png",      // 5 - Cobblestone
-        "spruce_log_top.png",   // 6 - Wood log top
-        "spruce_log.png",       // 7 - Wood log side
-        "spruce_leaves.png",    // 8 - Leaves
-        "sand.png",             // 9 - Sand
-        "water_still.png",      // 10 - 41 - Water frames (will be extracted)
-        "glass.png",            // 42 - Glass
-        "iron_block.png"        // 43 - Iron
+    // Texture files and the array layer each one starts at (layer == texture id in the mesh)
+    struct TextureFile
+    {
+        const char *name;
+        int layer;
+    };
+    const std::vector<TextureFile> texture_files = {
+        {"air.png", 0},                                 // Placeholder (not used)
+        {"stone.png", 1},                               // Stone
+        {"dirt.png", 2},                                // Dirt
+        {"grass_block_top.png", 3},                     // Grass top
+        {"grass_block_side.png", 4},                    // Grass side
+        {"cobblestone.png", 5},                         // Cobblestone
+        {"spruce_log_top.png", 6},                      // Wood log top
+        {"spruce_log.png", 7},                          // Wood log side
+        {"spruce_leaves.png", 8},                       // Leaves
+        {"sand.png", 9},                                // Sand
+        {"water_still.png", WATER_TEXTURE_FIRST},       // Animated strip, one layer per frame
+        {"glass.png", 42},                              // Glass
+        {"iron_block.png", 43}                          // Iron
     };
 
     const int texture_size = 16; // Each Minecraft texture is 16x16
-    const int atlas_width = 9;   // 8 textures per row (increased for water frames)
-    const int atlas_height = 5;  // 5 rows
-    const int atlas_pixel_width = atlas_width * texture_size;
-    const int atlas_pixel_height = atlas_height * texture_size;
+    const int layer_bytes = texture_size * texture_size * 4;
+    const int water_layers = WATER_TEXTURE_LAST - WATER_TEXTURE_FIRST + 1;
 
-    // Create atlas data
-    std::vector<unsigned char> atlas_data(((atlas_pixel_width * atlas_pixel_height) - 2) * 4, 255); // RGBA
+    std::vector<unsigned char> layer_data(static_cast<size_t>(layer_bytes) * BLOCK_TEXTURE_LAYERS, 255); // RGBA
 
     // Base path to your textures
     std::string texture_base_path = "voxel world/Textures/";
 
-    int current_atlas_index = 0;
+    // The assembled layers are cached as one blob keyed by the PNG contents and layout;
+    // a hit skips every decode and copy below. Blob: water frame count, then the layers.
+    StartupCache cache;
+    uint64_t cache_key = StartupCache::hash(&BLOCK_TEXTURE_LAYERS, sizeof(BLOCK_TEXTURE_LAYERS));
+    for (const TextureFile &file : texture_files)
+    {
+        cache_key = StartupCache::hash(&file.layer, sizeof(file.layer), cache_key);
+        cache_key = StartupCache::hashFile(texture_base_path + file.name, cache_key);
+    }
+
+    std::vector<unsigned char> cached;
+    bool from_cache = cache.loadBlob("block_textures", cache_key, cached) &&
+                      cached.size() == sizeof(int32_t) + layer_data.size();
+    if (from_cache)
+    {
+        int32_t frame_count;
+        std::memcpy(&frame_count, cached.data(), sizeof(frame_count));
+        std::memcpy(layer_data.data(), cached.data() + sizeof(frame_count), layer_data.size());
+        water_frame_start = WATER_TEXTURE_FIRST;
+        water_frame_count = frame_count;
+    }
+
+    // Copy one 16x16 tile starting at source row first_row into a layer
+    auto copyTile = [&](const unsigned char *image, int width, int height, int first_row, int layer)
+    {
+        unsigned char *destination = layer_data.data() + static_cast<size_t>(layer) * layer_bytes;
+        for (int y = 0; y < texture_size && first_row + y < height; y++)
+        {
+            for (int x = 0; x < texture_size && x < width; x++)
+            {
+                const unsigned char *source = image + ((first_row + y) * width + x) * 4;
+                std::copy(source, source + 4, destination + (y * texture_size + x) * 4);
+            }
+        }
+    };
 
-    // Load each texture into atlas
-    for (size_t i = 0; i < texture_files.size(); i++)
+    stbi_set_flip_vertically_on_load(true);
+    for (size_t i = 0; i < texture_files.size() && !from_cache; i++)
     {
-        std::string texture_path = texture_base_path + texture_files[i];
+        const TextureFile &file = texture_files[i];
+        std::string texture_path = texture_base_path + file.name;
+        bool is_water = file.layer == WATER_TEXTURE_FIRST;
+        int layers = is_water ? water_layers : 1;
 
         int width, height, channels;
-        stbi_set_flip_vertically_on_load(true);
         unsigned char *image_data = stbi_load(texture_path.c_str(), &width, &height, &channels, 4); // Force RGBA
 
         if (!image_data)
         {
             std::cerr << "Failed to load texture: " << texture_path << std::endl;
             // Create a fallback colored texture
-            int atlas_x = current_atlas_index % atlas_width;
-            int atlas_y = current_atlas_index / atlas_width;
-
-            for (int y = 0; y < texture_size; y++)
+            for (int layer = file.layer; layer < file.layer + layers; layer++)
             {
-                for (int x = 0; x < texture_size; x++)
+                unsigned char *destination = layer_data.data() + static_cast<size_t>(layer) * layer_bytes;
+                for (int pixel = 0; pixel < texture_size * texture_size; pixel++)
                 {
-                    int atlas_pixel_x = atlas_x * texture_size + x;
-                    int atlas_pixel_y = atlas_y * texture_size + y;
-                    int atlas_index = (atlas_pixel_y * atlas_pixel_width + atlas_pixel_x) * 4;
-
-                    // Create different colored fallback for each texture
-                    atlas_data[atlas_index + 0] = (i * 50) % 255;  // R
-                    atlas_data[atlas_index + 1] = (i * 80) % 255;  // G
-                    atlas_data[atlas_index + 2] = (i * 120) % 255; // B
-                    atlas_data[atlas_index + 3] = 255;             // A
+                    destination[pixel * 4 + 0] = (i * 50) % 255;  // R
+                    destination[pixel * 4 + 1] = (i * 80) % 255;  // G
+                    destination[pixel * 4 + 2] = (i * 120) % 255; // B
+                    destination[pixel * 4 + 3] = 255;             // A
                 }
             }
-            current_atlas_index++;
             continue;
         }
 
-        // Special handling for water texture (animated strip)
-        if (texture_files[i] == "water_still.png")
+        if (is_water)
         {
-            // Water texture is a vertical strip of frames
-            int frame_count = height / width;
+            // Water texture is a vertical strip of frames; the flipped load puts frame 0 at
+            // the bottom rows. Short strips repeat so every water layer holds a frame.
+            int frame_count = std::max(1, height / width);
             std::cout << "Water texture has " << frame_count << " frames" << std::endl;
-
-            // Extract each frame
-            for (int frame = 0; frame < frame_count && current_atlas_index < atlas_width * atlas_height; frame++)
+            for (int layer = 0; layer < water_layers; layer++)
             {
-                int atlas_x = current_atlas_index % atlas_width;
-                int atlas_y = current_atlas_index / atlas_width;
-
-                // Extract frame from the strip
-                for (int y = 0; y < texture_size && y < width; y++)
-                {
-                    for (int x = 0; x < texture_size && x < width; x++)
-                    {
-                        int src_index = ((frame * width + y) * width + x) * 4;
-                        int atlas_pixel_x = atlas_x * texture_size + x;
-                        int atlas_pixel_y = atlas_y * texture_size + y;
-                        int atlas_index = (atlas_pixel_y * atlas_pixel_width + atlas_pixel_x) * 4;
-
-                        atlas_data[atlas_index + 0] = image_data[src_index + 0]; // R
-                        atlas_data[atlas_index + 1] = image_data[src_index + 1]; // G
-                        atlas_data[atlas_index + 2] = image_data[src_index + 2]; // B
-                        atlas_data[atlas_index + 3] = image_data[src_index + 3]; // A
-                    }
-                }
-
-                std::cout << "Loaded water frame " << frame << " to atlas index " << current_atlas_index << std::endl;
-                current_atlas_index++;
+                copyTile(image_data, width, height, (layer % frame_count) * width, file.layer + layer);
             }
 
             // Store water animation info
-            water_frame_start = 10; // First water frame index
-            water_frame_count = frame_count;
+            water_frame_start = WATER_TEXTURE_FIRST;
+            water_frame_count = std::min(frame_count, water_layers);
         }
         else
         {
-            // Regular texture loading
-            int atlas_x = current_atlas_index % atlas_width;
-            int atlas_y = current_atlas_index / atlas_width;
-
-            for (int y = 0; y < texture_size && y < height; y++)
-            {
-                for (int x = 0; x < texture_size && x < width; x++)
-                {
-                    int src_index = (y * width + x) * 4;
-                    int atlas_pixel_x = atlas_x * texture_size + x;
-                    int atlas_pixel_y = atlas_y * texture_size + y;
-                    int atlas_index = (atlas_pixel_y * atlas_pixel_width + atlas_pixel_x) * 4;
-
-                    atlas_data[atlas_index + 0] = image_data[src_index + 0]; // R
-                    atlas_data[atlas_index + 1] = image_data[src_index + 1]; // G
-                    atlas_data[atlas_index + 2] = image_data[src_index + 2]; // B
-                    atlas_data[atlas_index + 3] = image_data[src_index + 3]; // A
-                }
-            }
-
-            std::cout << "Loaded texture: " << texture_files[i] << " to atlas index " << current_atlas_index << std::endl;
-            current_atlas_index++;
+            copyTile(image_data, width, height, 0, file.layer);
+            std::cout << "Loaded texture: " << file.name << " to layer " << file.layer << std::endl;
         }
 
         stbi_image_free(image_data);
     }
 
-    // Create OpenGL texture
-    glGenTextures(1, &block_texture_atlas);
-    glBindTexture(GL_TEXTURE_2D, block_texture_atlas);
+    if (!from_cache)
+    {
+        int32_t frame_count = water_frame_count;
+        cached.resize(sizeof(frame_count) + layer_data.size());
+        std::memcpy(cached.data(), &frame_count, sizeof(frame_count));
+        std::memcpy(cached.data() + sizeof(frame_count), layer_data.data(), layer_data.size());
+        cache.storeBlob("block_textures", cache_key, cached.data(), cached.size());
+    }
+
+    // One layer per tile: UVs repeat inside the layer (greedy quads span many voxels) and
+    // the mip chain never bleeds between neighbouring tiles the way an atlas would
+    glGenTextures(1, &block_textures);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, block_textures);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas_pixel_width, atlas_pixel_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, atlas_data.data());
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, texture_size, texture_size, BLOCK_TEXTURE_LAYERS, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, layer_data.data());
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
 
-    // Set texture parameters for pixel art
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // Pixel art up close, filtered mips in the distance
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 
-    std::cout << "Texture atlas created successfully!" << std::endl;
+    std::cout << "Block texture array created: " << BLOCK_TEXTURE_LAYERS << " layers with mipmaps"
+              << (from_cache ? " (from startup cache)" : "") << std::endl;
     return true;
 }
 
@@ -685,36 +2033,40 @@ void VoxelRenderer::setupShaderUniforms()
     shader->use();
 
     // Get uniform locations
-    uniform_model = glGetUniformLocation(shader->ID, "model");
     uniform_view = glGetUniformLocation(shader->ID, "view");
     uniform_projection = glGetUniformLocation(shader->ID, "projection");
-    uniform_texture_atlas = glGetUniformLocation(shader->ID, "texture_atlas");
+    uniform_block_textures = glGetUniformLocation(shader->ID, "block_textures");
     uniform_time = glGetUniformLocation(shader->ID, "time");
     uniform_render_pass = glGetUniformLocation(shader->ID, "renderPass"); // ADD THIS
+    uniform_view_count = glGetUniformLocation(shader->ID, "view_count");
+    uniform_eye_views = glGetUniformLocation(shader->ID, "eye_views");
 
-    if (uniform_model == -1)
-        std::cerr << "Warning: 'model' uniform not found in shader" << std::endl;
     if (uniform_view == -1)
         std::cerr << "Warning: 'view' uniform not found in shader" << std::endl;
     if (uniform_projection == -1)
         std::cerr << "Warning: 'projection' uniform not found in shader" << std::endl;
-    if (uniform_texture_atlas == -1)
-        std::cerr << "Warning: 'texture_atlas' uniform not found in shader" << std::endl;
+    if (uniform_block_textures == -1)
+        std::cerr << "Warning: 'block_textures' uniform not found in shader" << std::endl;
     if (uniform_time == -1)
         std::cerr << "Warning: 'time' uniform not found in shader" << std::endl;
     if (uniform_render_pass == -1)
         std::cerr << "Warning: 'renderPass' uniform not found in shader" << std::endl;
+
+    shader->setInt("face_records", FACE_RECORD_TEXTURE_UNIT);
+
+    // Draws of MeshFormat::Faces meshes leave attribute 0 without an array; this value tells
+    // voxel.vs to pull face records instead
+    glVertexAttribI4ui(0, FACE_RECORD_SENTINEL, 0, 0, 0);
 }
 
-void VoxelRenderer::renderChunk(const VoxelChunk &chunk, const glm::mat4 &model_matrix)
+void VoxelRenderer::renderChunk(const VoxelChunk &chunk)
 {
     if (!chunk.mesh || !chunk.mesh->isUploaded())
     {
         return;
     }
 
-    // Set model matrix
-    glUniformMatrix4fv(uniform_model, 1, GL_FALSE, glm::value_ptr(model_matrix));
+    setChunkOrigin(chunk.position);
 
     // Render the mesh
     chunk.mesh->render();
@@ -724,14 +2076,147 @@ void VoxelRenderer::renderChunk(const VoxelChunk &chunk, const glm::mat4 &model_
     vertices_rendered_last_frame += chunk.mesh->vertex_count;
 }
 
-glm::mat4 VoxelRenderer::getChunkModelMatrix(const glm::ivec3 &chunk_pos) const
+void VoxelRenderer::setChunkOrigin(const glm::ivec3 &chunk_pos) const
+{
+    RenderBackend::get().setDrawOrigin(getChunkOrigin(chunk_pos));
+}
+
+glm::vec3 VoxelRenderer::getChunkOrigin(const glm::ivec3 &chunk_pos) const
 {
-    glm::vec3 world_pos = glm::vec3(
+    return glm::vec3(
         chunk_pos.x * CHUNK_SIZE,
         chunk_pos.y * CHUNK_HEIGHT,
         chunk_pos.z * CHUNK_SIZE);
+}
+
+void VoxelRenderer::flushArenaBatch(bool occlusion_cull)
+{
+    if (!chunk_arena)
+    {
+        return;
+    }
+
+    chunk_arena->flushBatch(occlusion_cull && gpu_occlusion_enabled && !isStereoEnabled() ? hiz_culler.get() : nullptr);
+}
+
+glm::mat4 VoxelRenderer::getCullView(const Camera &camera, const glm::mat4 &projection) const
+{
+    if (!isStereoEnabled())
+    {
+        return camera.GetViewMatrix();
+    }
+    // Eyes on the side planes: half the separation over the tangent of half the horizontal
+    // field of view, which projection[0][0] is the inverse of. The far plane comes closer by
+    // that distance, a fraction of a block.
+    float back_off = stereo_separation * 0.5f * projection[0][0];
+    return glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -back_off)) * camera.GetViewMatrix();
+}
+
+std::array<glm::mat4, VoxelRenderer::STEREO_VIEWS> VoxelRenderer::getEyeViews(const glm::mat4 &view) const
+{
+    // Half the separation to the camera's left, then to its right
+    float half = stereo_separation * 0.5f;
+    return {glm::translate(glm::mat4(1.0f), glm::vec3(half, 0.0f, 0.0f)) * view,
+            glm::translate(glm::mat4(1.0f), glm::vec3(-half, 0.0f, 0.0f)) * view};
+}
+
+void VoxelRenderer::setPassMatrices(Shader &program, const glm::mat4 &view, const glm::mat4 &projection) const
+{
+    if (&program == shader.get())
+    {
+        // Already set at the start of the frame (cached uniform locations)
+        return;
+    }
+    program.setMat4("view", view);
+    program.setMat4("projection", projection);
+    program.setInt("view_count", ChunkMesh::getViewCount());
+    if (ChunkMesh::getViewCount() > 1)
+    {
+        glUniformMatrix4fv(glGetUniformLocation(program.ID, "eye_views"), STEREO_VIEWS, GL_FALSE,
+                           glm::value_ptr(eye_views[0]));
+    }
+    program.setInt("face_records", FACE_RECORD_TEXTURE_UNIT);
+    if (&program == opaque_shader.get() || &program == oit_shader.get())
+    {
+        program.setInt("block_textures", 0);
+        setLightingUniforms(program);
+    }
+}
+
+void VoxelRenderer::setLightingUniforms(Shader &program) const
+{
+    // Units are set even while unused: two sampler types must not share unit 0
+    program.setInt("shadow_maps", SHADOW_TEXTURE_UNIT);
+    program.setInt("cluster_lights", CLUSTER_LIGHT_TEXTURE_UNIT);
+    program.setInt("cluster_ranges", CLUSTER_RANGE_TEXTURE_UNIT);
+    program.setInt("cluster_indices", CLUSTER_INDEX_TEXTURE_UNIT);
+    if (shadow_cascades)
+    {
+        shadow_cascades->setUniforms(program);
+    }
+    else
+    {
+        program.setInt("shadow_cascade_count", 0);
+    }
+    if (clustered_lights)
+    {
+        clustered_lights->setUniforms(program);
+    }
+    else
+    {
+        program.setInt("cluster_light_count", 0);
+    }
+}
+
+void VoxelRenderer::renderShadows(const glm::vec3 &camera_position)
+{
+    PROFILE_ZONE("VoxelRenderer::renderShadows");
+    if (shadow_members_stale)
+    {
+        shadow_cascades->setMembers(cull_candidates);
+        shadow_members_stale = false;
+    }
+
+    uint32_t cascades = shadow_cascades->update(camera_position, sun_direction, isReverseDepth());
+    for (int cascade = 0; cascade < ShadowCascades::CASCADES; cascade++)
+    {
+        if ((cascades & (1u << cascade)) == 0)
+        {
+            continue;
+        }
 
-    return glm::translate(glm::mat4(1.0f), world_pos);
+        // Every loaded chunk in the cascade's square, not just the visible ones: shadows fall
+        // from off screen. Region batches are skipped, their members' buffers are still there.
+        shadow_cascades->beginCascade(cascade);
+        const uint8_t directions = shadow_cascades->getCasterDirections(cascade);
+        if (chunk_arena)
+        {
+            chunk_arena->beginBatch();
+        }
+        for (const auto &[chunk_pos, chunk] : cull_candidates)
+        {
+            if (!shadow_cascades->covers(cascade, chunk_pos))
+            {
+                continue;
+            }
+            const ChunkMesh &mesh = *chunk->mesh;
+            for (MeshPass pass : {MeshPass::Opaque, MeshPass::Cutout})
+            {
+                if (mesh.isInArena())
+                {
+                    mesh.queueArenaDraw(*chunk_arena, pass, getChunkOrigin(chunk_pos), directions);
+                }
+                else if (mesh.getIndexCount(pass) > 0)
+                {
+                    setChunkOrigin(chunk_pos);
+                    mesh.renderRange(pass, directions);
+                }
+            }
+        }
+        flushArenaBatch();
+        shadow_cascades->endCascade();
+    }
+    shadow_cascades->bindTexture();
 }
 
 int VoxelRenderer::getCurrentWaterTextureIndex() const
@@ -745,23 +2230,354 @@ int VoxelRenderer::getCurrentWaterTextureIndex() const
     return water_frame_start + current_frame;
 }
 
-bool VoxelRenderer::isChunkInFrustum(const glm::ivec3 &chunk_pos, const Camera &camera, const glm::mat4 &projection) const
+size_t VoxelRenderer::cullChunks(const glm::mat4 &view_projection, const glm::vec3 &camera_position)
 {
-    glm::vec3 chunk_world_pos = glm::vec3(
-        chunk_pos.x * CHUNK_SIZE + CHUNK_SIZE * 0.5f,
-        chunk_pos.y * CHUNK_HEIGHT + CHUNK_HEIGHT * 0.5f,
-        chunk_pos.z * CHUNK_SIZE + CHUNK_SIZE * 0.5f);
+    frustum.update(view_projection, isReverseDepth());
+    has_culled_view = true;
+
+    // Chunks the connectivity walk from the camera cannot reach are buried; they are dropped
+    // before the frustum test counts (all chunks pass when disabled or the camera chunk is
+    // missing). With the simulation thread the last tick walked it from its center, which
+    // only stands in for the camera while both are in the same chunk.
+    const ChunkVisibility *visibility = &chunk_visibility;
+    if (simulation)
+    {
+        visibility = &snapshot_front.visibility;
+        if (VoxelWorld::worldToChunk(snapshot_front.center) != VoxelWorld::worldToChunk(camera_position))
+        {
+            chunk_visibility.disable();
+            visibility = &chunk_visibility;
+        }
+    }
+    else if (occlusion_culling_enabled)
+    {
+        chunk_visibility.update(*world, camera_position);
+    }
+    else
+    {
+        chunk_visibility.disable();
+    }
 
-    float distance = glm::distance(camera.Position, chunk_world_pos);
+    // Drawable chunks in map order, which only changes as chunks come and go; the boxes and
+    // the draw order are kept while it matches last frame's
+    cull_scratch.clear();
+    auto gather = [this](const glm::ivec3 &chunk_pos, VoxelChunk *chunk)
+    {
+        if (chunk->mesh && chunk->mesh->isUploaded() && !chunk->mesh->isEmpty())
+        {
+            cull_scratch.emplace_back(chunk_pos, chunk);
+        }
+    };
+    if (simulation)
+    {
+        for (const auto &[chunk_pos, chunk] : snapshot_front.chunks)
+        {
+            gather(chunk_pos, chunk.get());
+        }
+    }
+    else
+    {
+        for (const auto &[chunk_pos, chunk] : world->getChunks())
+        {
+            gather(chunk_pos, chunk.get());
+        }
+    }
+    bool candidates_changed = draw_lists_dirty || cull_scratch != cull_candidates;
+    if (candidates_changed)
+    {
+        // Mesh vertices span voxel center -0.5..+0.5, so boxes are offset by half a voxel,
+        // and they only cover the layers the mesh occupies
+        cull_candidates.swap(cull_scratch);
+        chunk_bounds.clear();
+        for (const auto &[chunk_pos, chunk] : cull_candidates)
+        {
+            const ChunkMesh &mesh = *chunk->mesh;
+            chunk_bounds.push(glm::vec3(chunk_pos.x * CHUNK_SIZE + CHUNK_SIZE * 0.5f - 0.5f,
+                                        chunk_pos.y * CHUNK_HEIGHT + (mesh.min_occupied_y + mesh.max_occupied_y) * 0.5f,
+                                        chunk_pos.z * CHUNK_SIZE + CHUNK_SIZE * 0.5f - 0.5f),
+                              (mesh.max_occupied_y - mesh.min_occupied_y + 1) * 0.5f);
+        }
+        cull_tree.build(cull_candidates, chunk_bounds, glm::vec3(CHUNK_SIZE * 0.5f, 0.0f, CHUNK_SIZE * 0.5f));
+        draw_lists_dirty = false;
+        region_members_stale = true;
+        shadow_members_stale = true;
+    }
 
-    // Fix: Use chunk distance, not block distance
-    float chunk_distance = distance / CHUNK_SIZE;
-    float max_render_distance_chunks = (float)getRenderDistance() * 1.2f; // 20% margin
+    // Nearest first, by the chunk corner, for early Z-rejection (and back to front for blending)
+    if (candidates_changed || glm::distance(camera_position, draw_order_camera) > DRAW_ORDER_RESORT_DISTANCE)
+    {
+        draw_order_camera = camera_position;
+        draw_distances.resize(cull_candidates.size());
+        draw_order.resize(cull_candidates.size());
+        for (size_t i = 0; i < cull_candidates.size(); i++)
+        {
+            const glm::ivec3 &chunk_pos = cull_candidates[i].first;
+            draw_distances[i] = glm::distance(camera_position, glm::vec3(chunk_pos.x * CHUNK_SIZE, chunk_pos.y * CHUNK_HEIGHT,
+                                                                         chunk_pos.z * CHUNK_SIZE));
+            draw_order[i] = static_cast<uint32_t>(i);
+        }
+        std::sort(draw_order.begin(), draw_order.end(),
+                  [this](uint32_t a, uint32_t b) { return draw_distances[a] < draw_distances[b]; });
+    }
+
+    chunk_bounds.visible.resize(chunk_bounds.size());
+    chunks_visible_last_frame = cull_tree.cull(frustum, chunk_bounds.visible.data());
+    chunks_occluded_last_frame = 0;
+    for (size_t i = 0; i < cull_candidates.size(); i++)
+    {
+        if (!visibility->isVisible(cull_candidates[i].second))
+        {
+            chunks_occluded_last_frame++;
+            chunks_visible_last_frame -= chunk_bounds.visible[i];
+            chunk_bounds.visible[i] = 0;
+        }
+    }
+    chunks_culled_last_frame = chunk_bounds.size() - chunks_occluded_last_frame - chunks_visible_last_frame;
+    return chunks_visible_last_frame;
+}
+
+void VoxelRenderer::buildDrawLists(const glm::mat4 &view_projection, const glm::vec3 &camera_position)
+{
+    PROFILE_ZONE("VoxelRenderer::buildDrawLists");
+    cullChunks(view_projection, camera_position);
+
+    opaque_chunks.clear();
+    for (uint32_t i : draw_order)
+    {
+        if (!chunk_bounds.visible[i])
+        {
+            continue;
+        }
+        const glm::ivec3 &chunk_pos = cull_candidates[i].first;
+        const ChunkMesh &mesh = *cull_candidates[i].second->mesh;
+        // Judged from the camera, which neither eye of a stereo frame is at
+        uint8_t directions = direction_culling_enabled && !isStereoEnabled()
+                                 ? ChunkMesh::getFacingDirections(camera_position - getChunkOrigin(chunk_pos),
+                                                                  mesh.min_occupied_y, mesh.max_occupied_y)
+                                 : ALL_FACE_DIRECTIONS;
+        opaque_chunks.push_back({draw_distances[i], chunk_pos, cull_candidates[i].second, directions});
+    }
+
+    transparent_chunks.clear();
+    for (auto it = opaque_chunks.rbegin(); it != opaque_chunks.rend(); ++it)
+    {
+        if (it->chunk->mesh->hasTranslucent())
+        {
+            transparent_chunks.push_back(*it);
+        }
+    }
+}
+
+bool VoxelRenderer::prewarm(const Camera &camera, int radius, float target_seconds,
+                            const std::function<bool(float)> &progress)
+{
+    if (!world)
+    {
+        return false;
+    }
+    PROFILE_ZONE("VoxelRenderer::prewarm");
+
+    // Beyond the render distance nothing would ever load
+    radius = std::clamp(radius, 0, getRenderDistance());
+    const glm::ivec3 center = VoxelWorld::worldToChunk(camera.Position);
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                      std::chrono::duration<float>(target_seconds));
+
+    const float integrate_budget = world->getIntegrateBudget();
+    world->setIntegrateBudget(PREWARM_INTEGRATE_BUDGET_MS);
+    prewarming = true;
+
+    size_t total = 0;
+    size_t ready = 0;
+    bool finished = false;
+    while (true)
+    {
+        update(camera, 0.0f);
+        glFlush(); // No frame is swapped: mesher and staging fences must still signal
+
+        ready = countPrewarmReady(center, radius, total);
+        finished = ready >= total;
+        if (progress && !progress(total > 0 ? static_cast<float>(ready) / total : 1.0f))
+        {
+            break;
+        }
+        if (finished || std::chrono::steady_clock::now() >= deadline)
+        {
+            break;
+        }
+        // The workers do the work; a pass only collects their results
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    prewarming = false;
+    world->setIntegrateBudget(integrate_budget);
+
+    float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Spawn area: " << ready << "/" << total << " chunks ready in " << seconds << " s"
+              << (finished ? "" : " (the rest streams in)") << std::endl;
+    return finished;
+}
+
+size_t VoxelRenderer::countPrewarmReady(const glm::ivec3 &center, int radius, size_t &total) const
+{
+    // The chunks the world loads within radius, meshed (or needing no mesh) and uploaded
+    total = 0;
+    size_t ready = 0;
+    for (int x = -radius; x <= radius; x++)
+    {
+        for (int z = -radius; z <= radius; z++)
+        {
+            for (int y = -VoxelWorld::LOAD_LAYERS; y <= VoxelWorld::LOAD_LAYERS; y++)
+            {
+                glm::ivec3 chunk_pos(center.x + x, center.y + y, center.z + z);
+                if (!VoxelWorld::isLoadOffset(chunk_pos - center, radius))
+                {
+                    continue;
+                }
+                total++;
+                if (world->isChunkImplicit(chunk_pos))
+                {
+                    ready++;
+                    continue;
+                }
+                const VoxelChunk *chunk = world->getChunk(chunk_pos);
+                if (chunk && !chunk->needsMeshRebuild() && !chunk->isMeshing())
+                {
+                    ready++;
+                }
+            }
+        }
+    }
+    return ready;
+}
+
+void VoxelRenderer::prepareFrame(const Camera &camera, const glm::mat4 &projection)
+{
+    finishVisibility(); // A frame that was prepared but never rendered
+    if (!world || !shader)
+    {
+        return;
+    }
+
+    if (scene_target && !scene_target->bind())
+    {
+        std::cerr << "Scene target unavailable, falling back to standard depth at full resolution" << std::endl;
+        resolution_scaler.reset();
+        setReverseDepth(false);
+    }
+
+    visibility_view_projection = projection * getCullView(camera, projection);
+    visibility_camera = camera.Position;
+    uint64_t frame = ++visibility_frame;
+    visibility_pending = true;
+    auto pass = [this, frame]()
+    {
+        if (claimVisibility(frame))
+        {
+            buildDrawLists(visibility_view_projection, visibility_camera);
+        }
+    };
+    if (visibility_job && JobSystem::isDone(visibility_job))
+    {
+        job_system->resubmit(visibility_job, pass, JobPriority::High);
+    }
+    else
+    {
+        visibility_job = job_system->submit(pass, JobPriority::High); // The last one is still queued
+    }
+}
+
+bool VoxelRenderer::claimVisibility(uint64_t frame)
+{
+    uint64_t claimed = visibility_claimed.load();
+    while (claimed < frame)
+    {
+        if (visibility_claimed.compare_exchange_weak(claimed, frame))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void VoxelRenderer::finishVisibility()
+{
+    if (!visibility_pending)
+    {
+        return;
+    }
+    visibility_pending = false;
+
+    // Workers busy with long generation jobs may not have started it: then it runs here, and
+    // the job finds it claimed whenever it comes up
+    if (claimVisibility(visibility_frame))
+    {
+        buildDrawLists(visibility_view_projection, visibility_camera);
+        return;
+    }
+    while (!JobSystem::isDone(visibility_job))
+    {
+        std::this_thread::yield();
+    }
+}
+
+VoxelRenderer::MeshCandidate VoxelRenderer::scoreMeshCandidate(const VoxelChunk &chunk, const Camera &camera) const
+{
+    // Rings around the camera's chunk (a layer counts as many rings as it is chunks tall), so
+    // scores only change when the camera enters another chunk
+    glm::ivec3 offset = glm::abs(chunk.position - VoxelWorld::worldToChunk(camera.Position));
+    MeshCandidate candidate;
+    candidate.priority = std::max({offset.x, offset.z, offset.y * (CHUNK_HEIGHT / CHUNK_SIZE)});
+
+    // Out of view waits behind the visible chunks a few rings further out; a chunk with
+    // nothing drawn yet leaves a hole, and goes ahead of rebuilds of meshes already on screen
+    glm::vec3 center = getChunkOrigin(chunk.position) + glm::vec3(CHUNK_SIZE * 0.5f - 0.5f, CHUNK_HEIGHT * 0.5f - 0.5f,
+                                                                  CHUNK_SIZE * 0.5f - 0.5f);
+    if (has_culled_view &&
+        !frustum.isBoxVisible(center, glm::vec3(CHUNK_SIZE * 0.5f, CHUNK_HEIGHT * 0.5f, CHUNK_SIZE * 0.5f)))
+    {
+        candidate.priority += MESH_OFF_VIEW_RINGS;
+    }
+    if (!chunk.mesh || !chunk.mesh->isBuilt())
+    {
+        candidate.priority -= MESH_HOLE_RINGS;
+    }
+    candidate.distance = glm::distance(camera.Position, center);
+    return candidate;
+}
 
-    return chunk_distance <= max_render_distance_chunks;
+int VoxelRenderer::rescanMeshLods(const Camera &camera)
+{
+    // Levels follow the camera distance, but the hysteresis in getChunkLOD is half a chunk:
+    // every loaded chunk is only rechecked once the camera has moved LOD_RESCAN_DISTANCE or the
+    // LOD settings changed, not every frame
+    if (lod_scan_valid && glm::distance(camera.Position, lod_scan_camera) < LOD_RESCAN_DISTANCE &&
+        lod_scan_scale == lod_scale && lod_scan_enabled == lod_meshing_enabled)
+    {
+        return 0;
+    }
+    lod_scan_valid = true;
+    lod_scan_camera = camera.Position;
+    lod_scan_scale = lod_scale;
+    lod_scan_enabled = lod_meshing_enabled;
+
+    // Detail level changed: rebuild in the background, the current mesh draws until then
+    int transitions = 0;
+    for (const auto &[chunk_pos, chunk] : world->getChunks())
+    {
+        const ChunkMesh *mesh = chunk->mesh.get();
+        if (!chunk->isMeshing() && mesh && mesh->isBuilt() && !mesh->isEmpty() &&
+            mesh->lod != getMeshLOD(chunk_pos, camera, mesh->lod))
+        {
+            chunk->markMeshDirty();
+            transitions++;
+        }
+    }
+    return transitions;
 }
 
-int VoxelRenderer::getChunkLOD(const glm::ivec3 &chunk_pos, const Camera &camera) const
+int VoxelRenderer::getChunkLOD(const glm::ivec3 &chunk_pos, const Camera &camera, int current_lod) const
 {
     glm::vec3 chunk_world_pos = glm::vec3(
         chunk_pos.x * CHUNK_SIZE + CHUNK_SIZE * 0.5f,
@@ -771,10 +2587,38 @@ int VoxelRenderer::getChunkLOD(const glm::ivec3 &chunk_pos, const Camera &camera
     float distance = glm::distance(camera.Position, chunk_world_pos);
     float chunk_size_f = (float)CHUNK_SIZE;
 
-    if (distance < chunk_size_f * 4.0f)
+    // Move each boundary half a chunk away from the current level, so a camera hovering
+    // near one does not remesh the chunk back and forth
+    float hysteresis = current_lod < 0 ? 0.0f : chunk_size_f * 0.5f;
+    float full_limit = chunk_size_f * 4.0f * lod_scale + (current_lod == 0 ? hysteresis : -hysteresis);
+    float half_limit = chunk_size_f * 8.0f * lod_scale + (current_lod <= 1 ? hysteresis : -hysteresis);
+
+    if (distance < full_limit)
         return 0; // Full detail
-    else if (distance < chunk_size_f * 8.0f)
+    else if (distance < half_limit)
         return 1; // Half detail
     else
         return 2; // Quarter detail
 }
+
+int VoxelRenderer::getMeshLOD(const glm::ivec3 &chunk_pos, const Camera &camera, int current_lod) const
+{
+    return lod_meshing_enabled ? std::min(getChunkLOD(chunk_pos, camera, current_lod), MAX_MESH_LOD) : 0;
+}
+
+bool VoxelRenderer::isWaitingForNeighbors(const VoxelChunk &chunk)
+{
+    // Chunks with a mesh rebuild right away, so edits never wait on loading
+    if (chunk.mesh && chunk.mesh->isBuilt())
+    {
+        return false;
+    }
+    for (int dir : {NEIGHBOR_FRONT, NEIGHBOR_BACK, NEIGHBOR_RIGHT, NEIGHBOR_LEFT})
+    {
+        if (!chunk.getNeighbor(dir) && world->isChunkPending(chunk.position + FACE_NORMALS[dir]))
+        {
+            return true;
+        }
+    }
+    return false;
+}
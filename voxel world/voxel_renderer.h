@@ -3,10 +3,39 @@
 
 #include "voxel_world.h"
 #include "voxel_types.h"
+#include "chunk_mesh.h"
+#include "frustum.h"
+#include "chunk_visibility.h"
+#include "chunk_column_tree.h"
+#include "chunk_arena.h"
+#include "chunk_snapshot.h"
+#include "job_system.h"
+#include "staging_ring.h"
+#include "hiz_culler.h"
+#include "scene_target.h"
+#include "translucency_target.h"
+#include "region_batcher.h"
+#include "gpu_mesher.h"
+#include "gpu_timer.h"
+#include "far_terrain.h"
+#include "far_voxels.h"
+#include "shadow_cascades.h"
+#include "clustered_lights.h"
+#include "minimap.h"
+#include "performance_hud.h"
+#include "entity_renderer.h"
+#include "entity_store.h"
+#include "render_budget.h"
+#include "resolution_scaler.h"
+#include "latency_histogram.h"
+#include "completion_queue.h"
+#include "simulation_thread.h"
 #include <glm/glm/glm.hpp>
 #include <glm/glm/gtc/matrix_transform.hpp>
 #include <glm/glm/gtc/type_ptr.hpp>
 #include <glad/glad/glad.h>
+#include <array>
+#include <deque>
 #include <memory>
 #include <string>
 
@@ -16,7 +45,7 @@
 #include <vector>
 #include <chrono>
 #include <thread>
-#include <mutex>
+#include <atomic>
 #include <condition_variable>
 #include <queue>
 #include <functional>
@@ -25,67 +54,501 @@
 class Camera;
 class Shader;
 
+// Edit-to-visible latency: from a chunk's first edit not yet meshed to the upload of the mesh
+// that shows it
+struct EditLatencyHistogram
+{
+    static constexpr int BUCKETS = 8; // Under 1, 2, 4 ... 64 ms, then 64 ms and more
+    std::array<uint32_t, BUCKETS> counts{};
+    uint32_t total = 0;
+    float max_ms = 0.0f;
+
+    void record(float milliseconds);
+    static float getBucketLimit(int bucket) { return static_cast<float>(1 << bucket); } // Exclusive, all but the last
+};
+
+// Stages a streamed-in chunk goes through before it is first seen, timed from the end of the
+// previous one (Total spans them all)
+enum class PipelineStage
+{
+    Generate, // Load request -> generated or restored (load queue, generation queue, job)
+    MeshWait, // -> mesh job queued (insertion, waiting for neighbors and the mesh throttle)
+    Mesh,     // -> mesh built (job system queue and buildMesh)
+    Upload,   // -> uploaded (upload queue and budget)
+    Draw,     // -> first drawn (culled chunks wait until they come into view)
+    Total,
+    Count
+};
+
+const char *getPipelineStageName(PipelineStage stage);
+
+struct PipelineLatency
+{
+    std::array<LatencyHistogram, static_cast<int>(PipelineStage::Count)> stages;
+
+    const LatencyHistogram &get(PipelineStage stage) const { return stages[static_cast<int>(stage)]; }
+    LatencyHistogram &get(PipelineStage stage) { return stages[static_cast<int>(stage)]; }
+};
+
+// Streaming load seen by the last update: mesh backlog every frame, generation figures as of
+// the last periodic stats sample (about once a second)
+struct StreamingStats
+{
+    size_t loaded_chunks = 0;
+    size_t chunks_need_mesh = 0; // Dirty chunks (chunks_meshing of them already in a job)
+    size_t chunks_meshing = 0;
+    size_t uploads_waiting = 0; // Built meshes queued for the main thread
+    size_t meshes_uploaded = 0; // This frame
+    size_t bytes_uploaded = 0;  // This frame
+    size_t pending_loads = 0;   // Chunks waiting in the load queue
+    size_t generation_queued = 0;
+    size_t generation_in_flight = 0;
+    float chunk_load_ms = 0.0f; // Average request -> inserted over the last sample period
+};
+
+// Memory the world holds, by owner. CPU vectors count capacity, not size.
+struct MemoryStats
+{
+    size_t chunks = 0;
+    size_t chunk_bytes = 0;       // Loaded chunk objects and voxel storage
+    size_t chunk_cache_bytes = 0; // Of chunk_bytes, the per-chunk height caches
+    size_t packed_chunks = 0;     // Idle chunks with packed voxels or light (VoxelChunk::packIfIdle)
+    size_t pooled_chunk_bytes = 0;
+    size_t noise_instances = 0;   // Per-thread VoxelNoise generators
+    size_t noise_bytes = 0;       // Their objects and scratch grids (FastNoise nodes excluded)
+    size_t mesh_cpu_bytes = 0;    // Mesh vectors of loaded chunks
+    size_t mesh_pool_bytes = 0;   // Vectors waiting in MeshBufferPool
+    size_t gpu_mesh_bytes = 0;    // Per-chunk VBO storage
+    size_t gpu_arena_bytes = 0;   // Shared multi-draw arena capacity
+    size_t gpu_region_bytes = 0;  // Packed region copies of per-chunk meshes
+    size_t gpu_staging_bytes = 0; // Persistently mapped staging ring
+    size_t upload_queue = 0;      // Built meshes waiting for upload (their vectors are in mesh_cpu_bytes)
+    size_t generation_queue = 0;  // As of the last stats sample
+
+    size_t getCpuBytes() const { return chunk_bytes + pooled_chunk_bytes + noise_bytes + mesh_cpu_bytes + mesh_pool_bytes; }
+    size_t getGpuBytes() const { return gpu_mesh_bytes + gpu_arena_bytes + gpu_region_bytes + gpu_staging_bytes; }
+};
+
 class VoxelRenderer
 {
 private:
+    std::unique_ptr<JobSystem> job_system; // Shared by chunk generation and meshing
+    static constexpr unsigned int RESERVED_RENDER_THREADS = 2; // Render thread and the GL driver's
     std::unique_ptr<VoxelWorld> world;
-    std::unique_ptr<Shader> shader;
+    std::unique_ptr<SimulationThread> simulation; // Ticks the world instead of update (setSimulationThread)
+    std::unique_ptr<Shader> shader;        // Alpha-tested cutout and translucent passes
+    std::unique_ptr<Shader> opaque_shader; // Opaque range without discard (null: shader draws it)
+    std::unique_ptr<Shader> depth_shader;  // Depth-only pre-pass of the opaque range (null: no pre-pass)
+    bool depth_prepass_enabled;
 
     // Rendering statistics
     mutable size_t chunks_rendered_last_frame;
     mutable size_t vertices_rendered_last_frame;
+    mutable size_t chunks_visible_last_frame;
+    mutable size_t chunks_culled_last_frame;
+    mutable size_t chunks_occluded_last_frame; // Dropped by the connectivity walk before frustum tests
+
+    // Chunks that may need meshing: taken from the world each frame, kept until resolved
+    std::vector<glm::ivec3> mesh_dirty_chunks;
+    // Mesh jobs go out best score first (scoreMeshCandidate): lower priority, then nearer
+    static constexpr int MESH_OFF_VIEW_RINGS = 4; // Penalty of a chunk outside last frame's frustum
+    static constexpr int MESH_HOLE_RINGS = 2;     // Bonus of a chunk with no mesh drawn yet
+    struct MeshCandidate
+    {
+        int priority = 0;
+        float distance = 0.0f;
+        std::shared_ptr<VoxelChunk> chunk;
+
+        bool operator<(const MeshCandidate &other) const
+        {
+            return priority != other.priority ? priority < other.priority : distance < other.distance;
+        }
+    };
+    bool has_culled_view = false; // frustum holds a frame's planes
+    std::atomic<uint64_t> mesh_jobs_dropped{0}; // Skipped by workers: their chunk unloaded first
+    std::atomic<uint64_t> mesh_jobs_stale{0};   // Skipped by workers: their chunk was edited since the snapshot
+
+    // Scratch of update(), kept so steady frames do not allocate
+    std::vector<MeshCandidate> chunks_needing_mesh;
+    std::vector<std::shared_ptr<VoxelChunk>> edited_chunks;
+
+    // Where and with which settings the loaded chunks' LOD levels were last checked
+    static constexpr float LOD_RESCAN_DISTANCE = 4.0f;
+    bool lod_scan_valid = false;
+    glm::vec3 lod_scan_camera{0.0f};
+    float lod_scan_scale = 0.0f;
+    bool lod_scan_enabled = false;
 
-    // Batching and optimization
-    mutable std::vector<glm::mat4> instance_matrices;
-    mutable std::vector<VoxelChunk *> batch_chunks;
     GLuint instance_vbo;
 
+    // Shared mesh arena for multi-draw indirect rendering (null on GL < 4.3: per-chunk VAO path)
+    std::unique_ptr<ChunkArena> chunk_arena;
+
+    // Settled neighbourhoods of the per-chunk path drawn as one region each (null with the arena).
+    // region_drawn parallels opaque_chunks: the chunk's opaque and cutout ranges come from its region.
+    static constexpr size_t REGION_PACKS_PER_FRAME = 1;
+    std::unique_ptr<RegionBatcher> region_batcher;
+    bool region_members_stale = true; // cull_candidates changed since the batcher last saw them
+    std::vector<uint8_t> region_drawn;
+
+    // Persistently mapped buffer mesh workers stage uploads in (null on GL < 4.4 or without the arena)
+    std::unique_ptr<StagingRing> staging_ring;
+
+    // Compute-shader meshing of streamed full-detail chunks into the arena (null without the
+    // arena or its shader). Decoded results wait in gpu_mesh_queue in submission order; the
+    // first gpu_meshes_submitted of them are on the GPU.
+    std::unique_ptr<GpuMesher> gpu_mesher;
+    bool gpu_meshing_enabled = false;
+    size_t gpu_meshes_submitted = 0;
+    std::vector<GpuMeshOutput> gpu_mesh_outputs; // Scratch for GpuMesher::poll
+    void runGpuMeshing();
+
+    // GPU Hi-Z occlusion test of the opaque arena batch (null without the arena or compute shaders)
+    std::unique_ptr<HiZCuller> hiz_culler;
+    bool gpu_occlusion_enabled;
+
+    // Offscreen float depth target, for reverse-Z and dynamic resolution (null with neither)
+    std::unique_ptr<SceneTarget> scene_target;
+    bool reverse_depth_enabled;
+    bool reverse_depth = false; // In use: enabled and glClipControl available
+    static constexpr float NEAR_PLANE = 0.1f;
+    void applyDepthMode(); // Creates or drops scene_target and sets the GL depth state to match
+
+    // Scales the scene target's drawn size to a GPU time target (null: full resolution)
+    std::unique_ptr<ResolutionScaler> resolution_scaler;
+    int framebuffer_width = 0; // Window size as last reported (0: the viewport at the first bind)
+    int framebuffer_height = 0;
+
+    // Weighted blended translucent pass (null before GL 4.0 or without its shaders); it needs
+    // the scene target's depth buffer, so standard depth sorts chunks back to front instead
+    std::unique_ptr<Shader> oit_shader;
+    std::unique_ptr<TranslucencyTarget> translucency_target;
+    bool oit_enabled;
+
+    // GPU time of the opaque, transparent and upload phases (results arrive a frame or two late)
+    std::unique_ptr<GpuTimer> gpu_timer;
+
+    // Heightfield impostor from the render distance out to far_terrain_scale times it
+    std::unique_ptr<FarTerrain> far_terrain;
+    float far_terrain_scale;
+    // Raymarched voxel columns over the same ring instead (GL 4.3, off by default)
+    std::unique_ptr<FarVoxels> far_voxels;
+    bool far_voxels_enabled = false;
+
+    // Sun shadows on the chunk meshes (null when disabled or the caster shaders are missing)
+    std::unique_ptr<ShadowCascades> shadow_cascades;
+    bool shadows_enabled = true;
+    bool shadow_members_stale = true; // cull_candidates changed since the cascades last saw them
+    glm::vec3 sun_direction = glm::normalize(glm::vec3(1.0f, 2.0f, 1.0f)); // Where the old point light sat
+    void renderShadows(const glm::vec3 &camera_position);
+
+    // Point lights of emitting voxels, binned into froxels each frame (null when disabled)
+    std::unique_ptr<ClusteredLights> clustered_lights;
+    bool block_lights_enabled = true;
+
+    // Shadow and block light samplers and uniforms of a chunk shader
+    void setLightingUniforms(Shader &program) const;
+
+    // Corner map fed by the height-field cache (null if its shaders are missing)
+    std::unique_ptr<Minimap> minimap;
+    bool minimap_enabled = true;
+
+    // Frame statistics and graph over the top left corner (null if its shaders are missing)
+    std::unique_ptr<PerformanceHud> hud;
+    bool hud_enabled = false;
+    float hud_frame_seconds = 0.0f; // Last update's time step, for the frame rate
+    void renderHud();
+
+    // Side-by-side stereo, 0 for a single view (see setStereo)
+    static constexpr int STEREO_VIEWS = 2;
+    float stereo_separation = 0.0f;
+    std::array<glm::mat4, STEREO_VIEWS> eye_views; // This frame's, while stereo
+    // A view whose frustum contains both eyes' (the camera moved back until its side planes
+    // pass through them), or the camera's own view with a single view
+    glm::mat4 getCullView(const Camera &camera, const glm::mat4 &projection) const;
+    std::array<glm::mat4, STEREO_VIEWS> getEyeViews(const glm::mat4 &view) const;
+
+    // Boxes for the world's entities (null if its shaders are missing)
+    std::unique_ptr<EntityRenderer> entity_renderer;
+
+    // Adaptive per-frame upload budget, driven by the CPU headroom of the previous frame
+    static constexpr size_t MIN_UPLOAD_BUDGET_BYTES = 256 * 1024;
+    static constexpr size_t MAX_UPLOAD_BUDGET_BYTES = 32 * 1024 * 1024;
+    size_t upload_budget_bytes;
+    size_t bytes_uploaded_last_frame;
+    float upload_target_frame_ms;
+    float last_update_time;
+
+    // Set while prewarm pumps update(): mesh dispatch and uploads run unthrottled
+    bool prewarming = false;
+    static constexpr float PREWARM_INTEGRATE_BUDGET_MS = 50.0f;
+    size_t countPrewarmReady(const glm::ivec3 &center, int radius, size_t &total) const;
+
+    // Chunks dirtied by edits skip the streaming throttle: meshed at high priority and
+    // uploaded ahead of (and regardless of) the streaming budget
+    static constexpr size_t MAX_EDIT_MESHES_PER_FRAME = 64;
+    EditLatencyHistogram edit_latency;
+
+    // Load request to first draw of streamed-in chunks (see ChunkPipelineTimes)
+    PipelineLatency pipeline_latency;
+    void recordFirstDraw(VoxelChunk &chunk);
+
+    StreamingStats streaming_stats;
+
+    // Optional controller trading render distance and LOD range for memory and frame time;
+    // fed the average frame work of every BUDGET_SAMPLE_FRAMES frames
+    static constexpr int BUDGET_SAMPLE_FRAMES = 60;
+    std::unique_ptr<RenderBudgetController> budget_controller;
+    float lod_scale; // Scales the LOD distances in getChunkLOD (1 = default)
+    float budget_frame_ms_sum;
+    int budget_frame_samples;
+
+    void updateRenderBudget();
+
+    // Frustum culling (chunk centers are gathered contiguously; cull_tree rejects and accepts
+    // whole groups of columns and tests the rest in bulk)
+    Frustum frustum;
+    ChunkBoundsSoA chunk_bounds;
+    ChunkColumnTree cull_tree;
+    std::vector<std::pair<glm::ivec3, VoxelChunk *>> cull_candidates;
+    std::vector<std::pair<glm::ivec3, VoxelChunk *>> cull_scratch; // This frame's, compared against them
+
+    // Draw lists, kept across frames. cull_candidates and their boxes are only regathered
+    // when the drawable chunks change, and draw_order (candidate indices, nearest first) is
+    // only re-sorted when they do or the camera has moved DRAW_ORDER_RESORT_DISTANCE from
+    // where it was sorted; the visible lists come out of it already in order.
+    static constexpr float DRAW_ORDER_RESORT_DISTANCE = CHUNK_SIZE * 0.5f;
+    struct ChunkDistance
+    {
+        float distance;
+        glm::ivec3 position;
+        VoxelChunk *chunk;
+        uint8_t directions; // Face direction buckets that can face the camera
+    };
+    std::vector<uint32_t> draw_order;
+    std::vector<float> draw_distances; // By candidate, as of the last sort
+    glm::vec3 draw_order_camera{0.0f};
+    bool draw_lists_dirty = true; // A mesh was uploaded: boxes and order are stale
+    std::vector<ChunkDistance> opaque_chunks;      // Visible, front to back
+    std::vector<ChunkDistance> transparent_chunks; // Visible with translucent geometry, back to front (any order with OIT)
+
+    // Visibility of the prepared frame, run by whichever of its job and render() claims it
+    // first. The world is not touched by the main thread between the two. Frames are
+    // numbered so a job left queued by an earlier frame finds its pass claimed.
+    JobSystem::JobHandle visibility_job; // Resubmitted once done
+    uint64_t visibility_frame = 0;
+    std::atomic<uint64_t> visibility_claimed{0}; // Latest frame whose pass was claimed
+    bool visibility_pending = false;             // Prepared, not yet picked up by render()
+    glm::mat4 visibility_view_projection;
+    glm::vec3 visibility_camera;
+
+    // Occlusion culling through chunk face connectivity
+    ChunkVisibility chunk_visibility;
+    bool occlusion_culling_enabled;
+
+    // What the frame draws from while the simulation thread runs, copied out at the end of
+    // every tick with the world lock held (publishSnapshot), so culling and the passes never
+    // touch the world: the chunks with a mesh, kept alive and out of the shell pool by their
+    // handles, the connectivity walk from the tick's center and the entities. Meshes stay
+    // the render thread's; they only change in update. The ticker fills snapshot_back and
+    // hands it over as snapshot_ready, and update swaps that in as snapshot_front once the
+    // last frame's culling is done with it.
+    struct FrameSnapshot
+    {
+        glm::vec3 center{0.0f};
+        std::vector<std::pair<glm::ivec3, std::shared_ptr<VoxelChunk>>> chunks; // Map order
+        ChunkVisibility visibility;
+        std::vector<EntityKind> entity_kinds;
+        std::vector<glm::vec3> entity_positions;
+        std::vector<uint16_t> entity_kind_indices;
+    };
+    FrameSnapshot snapshot_front; // Render thread and its culling job
+    FrameSnapshot snapshot_back;  // Simulation thread
+    FrameSnapshot snapshot_ready; // Guarded by snapshot_mutex
+    bool snapshot_fresh = false;  // snapshot_ready was published after update last took one
+    std::mutex snapshot_mutex;
+
+    void publishSnapshot(const glm::vec3 &center); // Simulation thread, world lock held
+    void takeSnapshot();
+
+    // Far chunks are meshed at the coarser levels getChunkLOD picks
+    bool lod_meshing_enabled;
+
+    // Skip face direction buckets that point away from the camera for the whole chunk
+    bool direction_culling_enabled;
+
     // Performance tracking
     mutable float last_frame_time;
     mutable size_t total_triangles_rendered;
+    mutable size_t total_unmerged_triangles; // Triangles the naive mesher would have produced
 
     // Texture management
-    GLuint block_texture_atlas;
+    GLuint block_textures;
 
-    // Water animation
+    // Water animation, in seconds of frame time (a stalled frame advances it at most
+    // MAX_ANIMATION_STEP)
+    static constexpr float MAX_ANIMATION_STEP = 0.25f;
     int water_frame_start;
     int water_frame_count;
     float water_animation_time;
 
     // Shader uniform locations
-    GLint uniform_model;
     GLint uniform_view;
     GLint uniform_projection;
-    GLint uniform_texture_atlas;
+    GLint uniform_block_textures;
     GLint uniform_time;
     GLint uniform_render_pass; // ADD THIS LINE
+    GLint uniform_view_count;
+    GLint uniform_eye_views;
 
 public:
-    explicit VoxelRenderer(uint32_t seed, int render_distance = 16);
+    // worker_threads 0 means one job system worker per hardware core, less the cores reserved
+    // for the render and driver threads. Workers run below the render thread's priority;
+    // pin_workers also keeps them off the core the render thread is pinned to.
+    explicit VoxelRenderer(uint32_t seed, int render_distance = 16, unsigned int worker_threads = 0,
+                           bool pin_workers = false);
     ~VoxelRenderer();
 
     // Initialization
     bool initialize();
     void cleanup();
 
-    // Main update and render loop
-    void update(const Camera &camera);
+    // Main update and render loop. prepareFrame (after update, before the frame is cleared)
+    // starts the frame's culling and draw lists on a worker and binds the reverse-Z target the
+    // clear then lands in; render picks the lists up, or builds them itself when the frame was
+    // not prepared. Both take the projection of getProjection, which culling uses as well.
+    // delta_seconds is the frame's time step, which animations advance by (0 holds them).
+    void update(const Camera &camera, float delta_seconds);
+    void prepareFrame(const Camera &camera, const glm::mat4 &projection);
     void render(const Camera &camera, const glm::mat4 &projection);
 
     // Voxel manipulation
     VoxelID getVoxel(int x, int y, int z) const;
     void setVoxel(int x, int y, int z, VoxelID voxel);
+    // Batch edits (see VoxelWorld::applyEdits); return the number of voxels changed
+    size_t applyEdits(const std::vector<VoxelEdit> &edits);
+    size_t fillBox(const glm::ivec3 &min_corner, const glm::ivec3 &max_corner, VoxelID voxel);
+    size_t fillSphere(const glm::vec3 &center, float radius, VoxelID voxel);
+    VoxelRayHit raycast(const VoxelRay &ray) const; // See VoxelWorld::raycast
+    // Edit history (see VoxelWorld::setEditJournal)
+    void setEditJournal(EditJournal *journal);
+    bool undoEdit();
+    bool redoEdit();
+
+    // Write every unsaved edit and wait for it (shutdown, before the renderer is destroyed)
+    void saveWorld();
+
+    // Startup, before the first frame: stream in and mesh the chunks within radius chunks of
+    // the camera with the streaming throttles lifted (all workers meshing, uploads and chunk
+    // integration unbudgeted). progress gets the ready fraction after every pass and stops
+    // early by returning false. Returns whether everything was ready within target_seconds;
+    // whatever is left streams in as usual.
+    bool prewarm(const Camera &camera, int radius, float target_seconds,
+                 const std::function<bool(float)> &progress = {});
+
+    // World updates at a fixed rate on a thread of their own (see SimulationThread), started
+    // after prewarm: update then publishes the camera position instead of updating the world,
+    // and the caller holds lockWorld from before its input until update returns (and around
+    // any other call that reads the world, such as getMemoryStats). prepareFrame and render
+    // draw the snapshot the last tick published without it. Without the thread lockWorld
+    // returns a lock that owns nothing. center is streamed around until the first update
+    // publishes the camera. Turn it off without the lock held.
+    void setSimulationThread(bool enabled, const glm::vec3 &center);
+    bool isSimulationThreadEnabled() const { return simulation != nullptr; }
+    std::unique_lock<std::mutex> lockWorld();
 
     // Statistics
     size_t getChunksRendered() const { return chunks_rendered_last_frame; }
     size_t getVerticesRendered() const { return vertices_rendered_last_frame; }
+    size_t getChunksVisible() const { return chunks_visible_last_frame; }
+    size_t getChunksCulled() const { return chunks_culled_last_frame; }
+    size_t getChunksOccluded() const { return chunks_occluded_last_frame; }
+    size_t getChunksOccludedGpu() const { return hiz_culler ? hiz_culler->getOccludedCount() : 0; } // Reported a frame late
     size_t getTotalTriangles() const { return total_triangles_rendered; }
-    float getLastFrameTime() const { return last_frame_time; }
+    size_t getTotalUnmergedTriangles() const { return total_unmerged_triangles; }
+    float getTriangleReduction() const; // Fraction of triangles removed by face merging (0..1)
+    float getLastFrameTime() const { return last_frame_time; } // CPU submission only
+    float getLastUpdateTime() const { return last_update_time; }
+    float getGpuPassTime(GpuPass pass) const { return gpu_timer ? gpu_timer->getTime(pass) : 0.0f; }
+    float getGpuFrameTime() const; // Sum of the timed GPU phases
+    size_t getUploadBudget() const { return upload_budget_bytes; }
     size_t getLoadedChunkCount() const;
+    ChunkGenerationStats getGenerationStats();
+    JobSystemStats getJobStats();
+    const EditLatencyHistogram &getEditLatency() const { return edit_latency; } // Since the last reset
+    void resetEditLatency() { edit_latency = {}; }
+    const PipelineLatency &getPipelineLatency() const { return pipeline_latency; } // Since the last reset
+    void resetPipelineLatency() { pipeline_latency = {}; }
+    const StreamingStats &getStreamingStats() const { return streaming_stats; }
+    MemoryStats getMemoryStats(); // Walks the loaded chunks: sample it, not every frame
 
     // Settings
     void setRenderDistance(int distance);
     int getRenderDistance() const;
+    void setTerrainMode(TerrainMode mode); // See VoxelWorld::setTerrainMode
+    TerrainMode getTerrainMode() const;
+    void setRenderBudget(const RenderBudget &budget); // Adjusts distance and LOD from now on
+    void disableRenderBudget() { budget_controller.reset(); } // Keeps the current settings
+    bool isRenderBudgetEnabled() const { return budget_controller != nullptr; }
+    float getLodScale() const { return lod_scale; }
+    void setMeshingMode(MeshingMode mode);
+    MeshingMode getMeshingMode() const;
+    void setMeshFormat(MeshFormat format); // Remeshes every chunk in the new layout
+    MeshFormat getMeshFormat() const;
+    bool isUsingMultiDraw() const { return chunk_arena != nullptr; }
+    void setOcclusionCulling(bool enabled) { occlusion_culling_enabled = enabled; }
+    bool isOcclusionCullingEnabled() const { return occlusion_culling_enabled; }
+    void setGpuOcclusionCulling(bool enabled) { gpu_occlusion_enabled = enabled; }
+    // Mesh streamed chunks with compute shaders where supported (see GpuMesher); off by default
+    void setGpuMeshing(bool enabled) { gpu_meshing_enabled = enabled; }
+    bool isGpuMeshingEnabled() const { return gpu_meshing_enabled && gpu_mesher != nullptr; }
+    bool isGpuOcclusionCullingAvailable() const { return hiz_culler != nullptr; }
+    void setLodMeshing(bool enabled) { lod_meshing_enabled = enabled; } // Chunks remesh as they change level
+    bool isLodMeshingEnabled() const { return lod_meshing_enabled; }
+    void setDirectionCulling(bool enabled) { direction_culling_enabled = enabled; } // Back faces still culled by GL_CULL_FACE
+    bool isDirectionCullingEnabled() const { return direction_culling_enabled; }
+    void setDepthPrepass(bool enabled) { depth_prepass_enabled = enabled; }
+    bool isDepthPrepassEnabled() const { return depth_prepass_enabled && depth_shader != nullptr; }
+    void setOrderIndependentTransparency(bool enabled) { oit_enabled = enabled; }
+    bool isOrderIndependentTransparencyEnabled() const { return oit_enabled && translucency_target && scene_target; }
+    void setFarTerrainScale(float scale) { far_terrain_scale = std::max(1.0f, scale); } // 1 turns the far terrain off
+    // Draw the far ring as raymarched voxels (see FarVoxels) where supported, before initialize
+    void setFarVoxels(bool enabled) { far_voxels_enabled = enabled; }
+    bool isFarVoxelsEnabled() const { return far_voxels != nullptr; }
+    // Cascaded sun shadows (see ShadowCascades), on by default; before initialize
+    void setShadows(bool enabled) { shadows_enabled = enabled; }
+    bool isShadowsEnabled() const { return shadow_cascades != nullptr; }
+    void setSunDirection(const glm::vec3 &direction) { sun_direction = glm::normalize(direction); } // Toward the sun
+    // Clustered point lights from emitting voxels (see ClusteredLights), on by default; before initialize
+    void setBlockLights(bool enabled) { block_lights_enabled = enabled; }
+    bool isBlockLightsEnabled() const { return clustered_lights != nullptr; }
+    float getViewDistance() const; // World blocks to the farthest drawn terrain (standard depth's far plane)
+    // Reverse-Z with a float depth buffer and an infinite far plane where glClipControl is
+    // available (on by default), else standard depth out to getViewDistance
+    void setReverseDepth(bool enabled);
+    bool isReverseDepth() const { return reverse_depth; }
+    // Window framebuffer size (framebuffer size callback); the scene target is resized to it
+    void setFramebufferSize(int width, int height);
+    // Draw at down to ResolutionScaler::MIN_SCALE of the window size while the opaque and
+    // transparent passes take longer than target_ms on the GPU, upscaled when presented;
+    // 0 keeps full resolution
+    void setDynamicResolution(float target_ms);
+    bool isDynamicResolutionEnabled() const { return resolution_scaler != nullptr && scene_target != nullptr; }
+    float getRenderScale() const { return scene_target ? scene_target->getRenderScale() : 1.0f; }
+    glm::mat4 getProjection(float fov_y_degrees, float aspect) const;
+    void setMinimapEnabled(bool enabled) { minimap_enabled = enabled; } // Kept up to date while hidden
+    bool isMinimapEnabled() const { return minimap_enabled && minimap != nullptr; }
+    void setHudEnabled(bool enabled) { hud_enabled = enabled; }
+    bool isHudEnabled() const { return hud_enabled && hud != nullptr; }
+    // Side-by-side stereo with the eyes eye_separation blocks apart, either side of the
+    // camera (0 returns to a single view). The frame is culled and its draw lists built once,
+    // against a frustum containing both eyes; each chunk draw then has an instance per eye,
+    // so the second view costs raster time only. The projection passed to prepareFrame and
+    // render is one eye's, for half the target's width. Hi-Z occlusion and face direction
+    // culling are off meanwhile, and the far terrain, far voxels and entities draw per eye.
+    void setStereo(float eye_separation) { stereo_separation = std::max(0.0f, eye_separation); }
+    bool isStereoEnabled() const { return stereo_separation > 0.0f; }
+    void setUploadTargetFrameTime(float milliseconds) { upload_target_frame_ms = std::max(1.0f, milliseconds); }
 
 private:
     // Initialization helpers
@@ -94,28 +557,69 @@ private:
     void setupShaderUniforms();
 
     // Rendering helpers
-    void renderChunk(const VoxelChunk &chunk, const glm::mat4 &model_matrix);
-    glm::mat4 getChunkModelMatrix(const glm::ivec3 &chunk_pos) const;
+    void renderChunk(const VoxelChunk &chunk);
+    void setChunkOrigin(const glm::ivec3 &chunk_pos) const; // Origin for the next per-chunk VAO draw
+    glm::vec3 getChunkOrigin(const glm::ivec3 &chunk_pos) const;
+    void flushArenaBatch(bool occlusion_cull = false);
+    void setPassMatrices(Shader &program, const glm::mat4 &view, const glm::mat4 &projection) const;
+    void adaptUploadBudget();
+    float getFarTerrainInnerRadius() const;
+    float getFarTerrainOuterRadius() const;
 
     // Animation functions
     int getCurrentWaterTextureIndex() const;
 
     // Culling and LOD
-    bool isChunkInFrustum(const glm::ivec3 &chunk_pos, const Camera &camera, const glm::mat4 &projection) const;
-    int getChunkLOD(const glm::ivec3 &chunk_pos, const Camera &camera) const;
+    size_t cullChunks(const glm::mat4 &view_projection, const glm::vec3 &camera_position);
+    void buildDrawLists(const glm::mat4 &view_projection, const glm::vec3 &camera_position);
+    void finishVisibility(); // Waits for the prepared frame's lists, or builds them here
+    bool claimVisibility(uint64_t frame);
+    int rescanMeshLods(const Camera &camera); // Flags chunks whose level changed; returns their count
+    MeshCandidate scoreMeshCandidate(const VoxelChunk &chunk, const Camera &camera) const; // Without the handle
+    // current_lod (the level the chunk is meshed at, -1 if none) adds hysteresis at the boundaries
+    int getChunkLOD(const glm::ivec3 &chunk_pos, const Camera &camera, int current_lod = -1) const;
+    int getMeshLOD(const glm::ivec3 &chunk_pos, const Camera &camera, int current_lod) const; // 0 with LOD meshing off
+    // First meshes wait for horizontal neighbors that are still loading, so their border
+    // faces are not built against a prediction and rebuilt once the neighbor arrives
+    bool isWaitingForNeighbors(const VoxelChunk &chunk);
 
     // For multithreading
-    std::vector<std::thread> mesh_workers;
-    std::priority_queue<std::pair<float, VoxelChunk *>,
-                        std::vector<std::pair<float, VoxelChunk *>>,
-                        std::greater<std::pair<float, VoxelChunk *>>>
-        chunks_to_mesh_queue; // Min-heap (nearest first)
-    std::queue<VoxelChunk *> chunks_to_upload_queue;
-    std::mutex queue_mutex;
-    std::condition_variable condition;
-    bool stop_workers = false;
-
-    void workerLoop();
+    // Jobs and results hold chunk handles, so unloading never frees a chunk a worker is
+    // using; the last handle is always dropped on the main thread (GL cleanup)
+    struct MeshJob
+    {
+        std::shared_ptr<VoxelChunk> chunk;
+        std::shared_ptr<const ChunkSnapshot> snapshot; // Workers read only this
+        int lod = 0;
+        bool sectioned = false; // Build per mesh section, remeshing only rebuild.dirty_sections
+        MeshSectionRebuild rebuild;
+        bool edit = false; // Fast lane; edit_time is the chunk's first pending edit
+        std::chrono::steady_clock::time_point edit_time;
+        bool gpu = false; // Decode for the GPU mesher instead of building (unless there is nothing to mesh)
+    };
+    struct MeshResult
+    {
+        std::shared_ptr<VoxelChunk> chunk;
+        std::unique_ptr<ChunkMesh> mesh; // Null if the build failed, timed out or was skipped
+        uint8_t sections = ALL_MESH_SECTIONS; // The job's, dirtied again when it returns no mesh
+        std::unique_ptr<GpuMeshInput> gpu_input; // Instead of mesh, until the GPU mesher takes it
+        StagingAllocation staging;       // Mesh data already in the staging ring, if any
+        bool edit = false;
+        std::chrono::steady_clock::time_point edit_time;
+        std::chrono::steady_clock::time_point built_at;
+        MeshResult *next = nullptr; // Link in completed_meshes
+    };
+
+    std::atomic<int> mesh_jobs_pending{0}; // Submitted and not yet back in completed_meshes
+    CompletionQueue<MeshResult> completed_meshes; // Workers push, update() drains into the queues below
+    std::queue<MeshResult> chunks_to_upload_queue; // Main thread only
+    std::queue<MeshResult> edit_upload_queue;      // Fast lane results, uploaded first
+    std::deque<MeshResult> gpu_mesh_queue;         // Decoded for the GPU mesher, oldest first
+    void takeCompletedMeshes();
+
+    // Snapshot the chunk and submit its mesh job; true if only some sections are rebuilt
+    bool dispatchMeshJob(std::shared_ptr<VoxelChunk> chunk, const Camera &camera, bool edit);
+    void runMeshJob(MeshJob &job);
 };
 
 #endif // VOXEL_RENDERER_H
@@ -11,9 +11,230 @@ using ChunkCoord = int32_t;
 constexpr int CHUNK_SIZE = 16;
 constexpr int CHUNK_HEIGHT = 64;
 constexpr int CHUNK_VOLUME = CHUNK_SIZE * CHUNK_HEIGHT * CHUNK_SIZE;
+
+// World -> chunk coordinates by arithmetic shift (floors negatives), world -> local by mask
+constexpr int CHUNK_SIZE_SHIFT = 4;
+constexpr int CHUNK_HEIGHT_SHIFT = 6;
+constexpr int CHUNK_SIZE_MASK = CHUNK_SIZE - 1;
+constexpr int CHUNK_HEIGHT_MASK = CHUNK_HEIGHT - 1;
+static_assert((1 << CHUNK_SIZE_SHIFT) == CHUNK_SIZE && (1 << CHUNK_HEIGHT_SHIFT) == CHUNK_HEIGHT,
+              "Chunk dimensions must be the powers of two the shifts describe");
+
+// Order of a chunk's flat arrays (voxels, light, meshing input)
+enum class ChunkAxisOrder
+{
+    XYZ,   // x outermost, z innermost: rows along z are contiguous
+    XZY,   // y innermost: columns are contiguous, matching the meshers' 64-bit column masks
+    Morton // Coordinate bits interleaved (z, y, x from the lowest): 3D neighborhoods share lines
+};
+
+inline const char *getChunkAxisOrderName(ChunkAxisOrder order)
+{
+    switch (order)
+    {
+    case ChunkAxisOrder::XYZ:
+        return "xyz";
+    case ChunkAxisOrder::XZY:
+        return "xzy";
+    default:
+        return "morton";
+    }
+}
+
+// Where ChunkAxisOrder::Morton puts the bits of each coordinate: one bit of each axis in
+// turn from the lowest, z first, skipping axes that have run out of bits (y keeps going
+// once x and z are spent)
+template <int SIZE_X, int SIZE_Y, int SIZE_Z>
+struct ChunkMortonBits
+{
+    static constexpr int MAX_BITS = 16;
+    int bits[3] = {};                   // Per axis (0 x, 1 y, 2 z)
+    int position[3][MAX_BITS] = {};     // Index bit of each coordinate bit
+    int offset_x[SIZE_X] = {};          // Index bits of each coordinate value
+    int offset_y[SIZE_Y] = {};
+    int offset_z[SIZE_Z] = {};
+
+    constexpr ChunkMortonBits()
+    {
+        const int sizes[3] = {SIZE_X, SIZE_Y, SIZE_Z};
+        for (int axis = 0; axis < 3; axis++)
+        {
+            while ((1 << bits[axis]) < sizes[axis])
+            {
+                bits[axis]++;
+            }
+        }
+        int next = 0;
+        for (int level = 0; level < MAX_BITS; level++)
+        {
+            for (int axis = 2; axis >= 0; axis--)
+            {
+                if (level < bits[axis])
+                {
+                    position[axis][level] = next++;
+                }
+            }
+        }
+        int *offsets[3] = {offset_x, offset_y, offset_z};
+        for (int axis = 0; axis < 3; axis++)
+        {
+            for (int value = 0; value < sizes[axis]; value++)
+            {
+                for (int bit = 0; bit < bits[axis]; bit++)
+                {
+                    offsets[axis][value] |= ((value >> bit) & 1) << position[axis][bit];
+                }
+            }
+        }
+    }
+
+    constexpr int gather(int axis, int index) const
+    {
+        int value = 0;
+        for (int bit = 0; bit < bits[axis]; bit++)
+        {
+            value |= ((index >> position[axis][bit]) & 1) << bit;
+        }
+        return value;
+    }
+};
+
+// Flat index of a voxel in a SIZE_X x SIZE_Y x SIZE_Z chunk stored in ORDER. Everything that
+// indexes flat chunk data goes through this, so the layout is resolved at compile time and
+// changes in one place. Saved regions and the stream protocol carry indices in this order:
+// worlds and peers only mix with builds of the same layout.
+//
+// In every order the index is the sum of one offset per axis, so a row or column is walked
+// from its first voxel by adding that axis' offsets (a constant stride in the linear orders).
+template <int SIZE_X, int SIZE_Y, int SIZE_Z, ChunkAxisOrder ORDER>
+struct ChunkLayout
+{
+    static constexpr int VOLUME = SIZE_X * SIZE_Y * SIZE_Z;
+    static constexpr bool LINEAR = ORDER != ChunkAxisOrder::Morton;
+    static_assert(LINEAR || ((SIZE_X & (SIZE_X - 1)) == 0 && (SIZE_Y & (SIZE_Y - 1)) == 0 && (SIZE_Z & (SIZE_Z - 1)) == 0),
+                  "Morton order needs power of two dimensions");
+
+    static constexpr int offsetX(int x)
+    {
+        if constexpr (LINEAR)
+        {
+            return x * SIZE_Y * SIZE_Z;
+        }
+        else
+        {
+            return MORTON.offset_x[x];
+        }
+    }
+    static constexpr int offsetY(int y)
+    {
+        if constexpr (ORDER == ChunkAxisOrder::XYZ)
+        {
+            return y * SIZE_Z;
+        }
+        else if constexpr (ORDER == ChunkAxisOrder::XZY)
+        {
+            return y;
+        }
+        else
+        {
+            return MORTON.offset_y[y];
+        }
+    }
+    static constexpr int offsetZ(int z)
+    {
+        if constexpr (ORDER == ChunkAxisOrder::XYZ)
+        {
+            return z;
+        }
+        else if constexpr (ORDER == ChunkAxisOrder::XZY)
+        {
+            return z * SIZE_Y;
+        }
+        else
+        {
+            return MORTON.offset_z[z];
+        }
+    }
+
+    static constexpr int index(int x, int y, int z)
+    {
+        return offsetX(x) + offsetY(y) + offsetZ(z);
+    }
+    static constexpr int getX(int index)
+    {
+        if constexpr (LINEAR)
+        {
+            return index / offsetX(1);
+        }
+        else
+        {
+            return MORTON.gather(0, index);
+        }
+    }
+    static constexpr int getY(int index)
+    {
+        if constexpr (LINEAR)
+        {
+            return (index / offsetY(1)) % SIZE_Y;
+        }
+        else
+        {
+            return MORTON.gather(1, index);
+        }
+    }
+    static constexpr int getZ(int index)
+    {
+        if constexpr (LINEAR)
+        {
+            return (index / offsetZ(1)) % SIZE_Z;
+        }
+        else
+        {
+            return MORTON.gather(2, index);
+        }
+    }
+
+    // The z row starting at row (index of z = 0) into SIZE_Z contiguous values
+    template <typename T>
+    static void copyRowZ(const T *row, T *out)
+    {
+        for (int z = 0; z < SIZE_Z; z++)
+        {
+            out[z] = row[offsetZ(z)];
+        }
+    }
+
+private:
+    static constexpr ChunkMortonBits<SIZE_X, SIZE_Y, SIZE_Z> MORTON{};
+};
+
+// VOXEL_CHUNK_LAYOUT (CMake cache variable of the same name) picks the order per build
+#ifndef VOXEL_CHUNK_LAYOUT
+#define VOXEL_CHUNK_LAYOUT XYZ
+#endif
+using ChunkIndexing = ChunkLayout<CHUNK_SIZE, CHUNK_HEIGHT, CHUNK_SIZE, ChunkAxisOrder::VOXEL_CHUNK_LAYOUT>;
+
+// Edited chunks keep their mesh per vertical section of MESH_SECTION_HEIGHT layers, so an
+// edit only remeshes the sections it touches (bit per section in the masks)
+constexpr int MESH_SECTION_HEIGHT = 16;
+constexpr int MESH_SECTION_COUNT = CHUNK_HEIGHT / MESH_SECTION_HEIGHT;
+constexpr uint8_t ALL_MESH_SECTIONS = static_cast<uint8_t>((1u << MESH_SECTION_COUNT) - 1);
+static_assert(CHUNK_HEIGHT % MESH_SECTION_HEIGHT == 0 && MESH_SECTION_COUNT <= 8,
+              "Mesh sections must tile the chunk height and fit a byte mask");
 constexpr int WATER_LEVEL = 55;
+// Layers the terrain is shaped in (world y 0 to TERRAIN_LAYERS * CHUNK_HEIGHT - 1). The world
+// has no height limit: below is rock, above is sky, and tools that cover "the terrain" (the
+// far LOD, pregeneration, benchmarks) stop here.
+constexpr int TERRAIN_LAYERS = 8;
+constexpr int BEACH_HEIGHT = 2;  // Columns whose top block is up to this far above WATER_LEVEL are beach
+constexpr int SURFACE_DEPTH = 3; // Biome layers over stone: the top block and the filler below it
+
+// Face-to-face connectivity of a chunk, one bit per pair of faces (see chunk_visibility.h)
+constexpr uint16_t FACE_CONNECTIVITY_NONE = 0;
+constexpr uint16_t FACE_CONNECTIVITY_ALL = 0x7FFF;
 
-// Voxel types
+// Built-in voxel types: placed by generation, registered first by BlockRegistry (data files
+// can add more after them)
 enum VoxelType : VoxelID
 {
     VOXEL_AIR = 0,
@@ -27,50 +248,75 @@ enum VoxelType : VoxelID
     VOXEL_WATER = 8,
     VOXEL_GLASS = 9,
     VOXEL_IRON = 10,
-    VOXEL_COUNT = 11
+    VOXEL_COUNT = 11 // Built-in types; BlockRegistry::getTypeCount() counts every registered one
 };
 
-// Voxel properties
-struct VoxelInfo
+// Not a voxel: no registry has this many types
+constexpr VoxelID VOXEL_NONE = 0xFFFF;
+
+// Biome of a terrain column, classified once per column together with its height (see
+// VoxelNoise::classifyBiomes). It only picks the layers over stone and what grows there.
+enum Biome : uint8_t
+{
+    BIOME_OCEAN = 0,
+    BIOME_BEACH = 1,
+    BIOME_PLAINS = 2,
+    BIOME_DESERT = 3,
+    BIOME_MOUNTAINS = 4,
+    BIOME_COUNT = 5
+};
+
+struct BiomeInfo
 {
     const char *name;
-    bool is_solid;
-    bool is_transparent;
-    float texture_top;    // Top face texture index
-    float texture_bottom; // Bottom face texture index
-    float texture_sides;  // Side faces texture index
+    VoxelID surface; // Top block of the column
+    VoxelID filler;  // The SURFACE_DEPTH - 1 blocks below it
+    bool has_trees;
 };
 
-// Voxel database - properties for each voxel type
-static const VoxelInfo VOXEL_INFO[VOXEL_COUNT] = {
-    //   Name Solid  Transp  Top    Bottom Sides
-    {"Air", false, true, 0.0f, 0.0f, 0.0f},         // VOXEL_AIR
-    {"Stone", true, false, 1.0f, 1.0f, 1.0f},       // VOXEL_STONE (stone.png)
-    {"Dirt", true, false, 2.0f, 2.0f, 2.0f},        // VOXEL_DIRT (dirt.png)
-    {"Grass", true, false, 3.0f, 2.0f, 4.0f},       // VOXEL_GRASS (grass_top, dirt, grass_side)
-    {"Cobblestone", true, false, 5.0f, 5.0f, 5.0f}, // VOXEL_COBBLESTONE
-    {"Wood", true, false, 6.0f, 6.0f, 7.0f},        // VOXEL_WOOD (oak_log_top, oak_log_top, oak_log)
-    {"Leaves", true, true, 8.0f, 8.0f, 8.0f},       // VOXEL_LEAVES
-    {"Sand", true, false, 9.0f, 9.0f, 9.0f},        // VOXEL_SAND
-    {"Water", false, true, 10.0f, 10.0f, 10.0f},    // VOXEL_WATER (animated, base frame)
-    {"Glass", true, true, 42.0f, 42.0f, 42.0f},     // VOXEL_GLASS (moved after water frames)
-    {"Iron", true, false, 43.0f, 43.0f, 43.0f}      // VOXEL_IRON (moved after water frames)
+static const BiomeInfo BIOME_INFO[BIOME_COUNT] = {
+    //   Name Surface Filler Trees
+    {"Ocean", VOXEL_SAND, VOXEL_SAND, false},      // BIOME_OCEAN (sea floor)
+    {"Beach", VOXEL_SAND, VOXEL_SAND, false},      // BIOME_BEACH
+    {"Plains", VOXEL_GRASS, VOXEL_DIRT, true},     // BIOME_PLAINS
+    {"Desert", VOXEL_SAND, VOXEL_SAND, false},     // BIOME_DESERT
+    {"Mountains", VOXEL_STONE, VOXEL_STONE, false} // BIOME_MOUNTAINS (bare rock)
 };
 
+// Animated water frames occupy this texture range; they are the only blended geometry
+constexpr int WATER_TEXTURE_FIRST = 10;
+constexpr int WATER_TEXTURE_LAST = 41;
+
+// Layers of the block texture array (texture ids 0..43)
+constexpr int BLOCK_TEXTURE_LAYERS = 44;
+
 // Helper functions
-inline bool isVoxelSolid(VoxelID voxel)
+inline bool isTranslucentTexture(int texture_id)
+{
+    return texture_id >= WATER_TEXTURE_FIRST && texture_id <= WATER_TEXTURE_LAST;
+}
+
+// Textures with cut-out texels (leaves, glass): alpha tested in their own pass so fully
+// opaque geometry can use a shader without discard
+inline bool isAlphaTestedTexture(int texture_id)
 {
-    return voxel < VOXEL_COUNT && VOXEL_INFO[voxel].is_solid;
+    return texture_id == 8 || texture_id == 42;
 }
 
-inline bool isVoxelTransparent(VoxelID voxel)
+// Ground voxel with depth ground voxels above it in a column of this biome
+inline VoxelID getBiomeLayer(Biome biome, int depth)
 {
-    return voxel >= VOXEL_COUNT || VOXEL_INFO[voxel].is_transparent;
+    if (depth >= SURFACE_DEPTH)
+    {
+        return VOXEL_STONE;
+    }
+    const BiomeInfo &info = BIOME_INFO[biome < BIOME_COUNT ? biome : BIOME_PLAINS];
+    return depth == 0 ? info.surface : info.filler;
 }
 
-inline const char *getVoxelName(VoxelID voxel)
+inline const char *getBiomeName(Biome biome)
 {
-    return voxel < VOXEL_COUNT ? VOXEL_INFO[voxel].name : "Unknown";
+    return biome < BIOME_COUNT ? BIOME_INFO[biome].name : "Unknown";
 }
 
 #endif // VOXEL_TYPES_H
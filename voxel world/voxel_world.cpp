@@ -1,63 +1,1088 @@
 #include "voxel_world.h"
+#if VOXEL_HEADLESS
+#include "headless_mesh.h"
+#else
+#include "chunk_mesh.h"
+#endif
+#include "fluid_simulator.h"
+#include "entity_store.h"
+#include "edit_journal.h"
+#include "voxel_accessor.h"
+#include "height_tile_store.h"
+#include "terrain_features.h"
+#include "voxel_noise.h"
+#include "profiler.h"
+#include "log.h"
 #include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <climits>
+#include <iterator>
+#include <limits>
 
-VoxelWorld::VoxelWorld(uint32_t seed, int render_distance)
-    : world_seed(seed), render_distance(render_distance), last_center_chunk(INT_MAX)
+namespace
 {
+    VoxelRayHit traceRay(const VoxelRay &ray, VoxelAccessor &accessor)
+    {
+        VoxelRayHit hit;
+        float length = glm::length(ray.direction);
+        if (!(length > 0.0f) || !(ray.max_distance >= 0.0f))
+        {
+            return hit;
+        }
+        glm::vec3 direction = ray.direction / length;
+
+        // Per axis: the step direction, the ray distance to the next voxel boundary and the
+        // distance between boundaries. Axes the ray does not move along never advance.
+        glm::ivec3 voxel(glm::floor(ray.origin));
+        glm::ivec3 step(0);
+        glm::vec3 next_boundary(INFINITY);
+        glm::vec3 boundary_spacing(INFINITY);
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (direction[axis] > 0.0f)
+            {
+                step[axis] = 1;
+                next_boundary[axis] = (static_cast<float>(voxel[axis] + 1) - ray.origin[axis]) / direction[axis];
+                boundary_spacing[axis] = 1.0f / direction[axis];
+            }
+            else if (direction[axis] < 0.0f)
+            {
+                step[axis] = -1;
+                next_boundary[axis] = (static_cast<float>(voxel[axis]) - ray.origin[axis]) / direction[axis];
+                boundary_spacing[axis] = -1.0f / direction[axis];
+            }
+        }
+
+        glm::ivec3 normal(0);
+        float distance = 0.0f;
+        while (true)
+        {
+            VoxelID id = accessor.get(voxel);
+            if (id != VOXEL_AIR)
+            {
+                hit.hit = true;
+                hit.position = voxel;
+                hit.normal = normal;
+                hit.distance = distance;
+                hit.voxel = id;
+                return hit;
+            }
+
+            // Cross whichever boundary comes first
+            int axis = 0;
+            if (next_boundary.y < next_boundary[axis])
+            {
+                axis = 1;
+            }
+            if (next_boundary.z < next_boundary[axis])
+            {
+                axis = 2;
+            }
+            distance = next_boundary[axis];
+            if (distance > ray.max_distance)
+            {
+                return hit;
+            }
+            voxel[axis] += step[axis];
+            next_boundary[axis] += boundary_spacing[axis];
+            normal = glm::ivec3(0);
+            normal[axis] = -step[axis];
+        }
+    }
+
+    // Slack for float drift: a box this close to a voxel face counts as touching it
+    constexpr float SWEEP_EPSILON = 1e-4f;
+
+    // Voxel range a box spans on an axis, faces it only touches excluded
+    void boxCells(const glm::vec3 &min, const glm::vec3 &max, int axis, int &first, int &last)
+    {
+        first = static_cast<int>(std::floor(min[axis] + SWEEP_EPSILON));
+        last = static_cast<int>(std::ceil(max[axis] - SWEEP_EPSILON)) - 1;
+    }
+
+    // Whether the layer of voxels at cell along axis, across the box's other two axes, holds
+    // a solid voxel. z is always the run tested per row.
+    bool isLayerSolid(VoxelAccessor &accessor, int axis, int cell, const glm::ivec3 &first, const glm::ivec3 &last)
+    {
+        glm::ivec3 low = first;
+        glm::ivec3 high = last;
+        low[axis] = cell;
+        high[axis] = cell;
+        for (int x = low.x; x <= high.x; x++)
+        {
+            for (int y = low.y; y <= high.y; y++)
+            {
+                if (accessor.anySolid(x, y, low.z, high.z))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Displacement along axis before the box's leading face reaches a solid layer
+    float sweepAxis(VoxelAccessor &accessor, const glm::vec3 &min, const glm::vec3 &max, int axis, float motion)
+    {
+        glm::ivec3 first;
+        glm::ivec3 last;
+        for (int other = 0; other < 3; other++)
+        {
+            boxCells(min, max, other, first[other], last[other]);
+        }
+
+        if (motion > 0.0f)
+        {
+            // Layers from the one the leading face touches to the one it would enter last
+            int start = static_cast<int>(std::ceil(max[axis] - SWEEP_EPSILON));
+            int end = static_cast<int>(std::ceil(max[axis] + motion)) - 1;
+            for (int cell = start; cell <= end; cell++)
+            {
+                if (isLayerSolid(accessor, axis, cell, first, last))
+                {
+                    return std::max(0.0f, static_cast<float>(cell) - max[axis]);
+                }
+            }
+        }
+        else if (motion < 0.0f)
+        {
+            int start = static_cast<int>(std::floor(min[axis] + SWEEP_EPSILON)) - 1;
+            int end = static_cast<int>(std::floor(min[axis] + motion));
+            for (int cell = start; cell >= end; cell--)
+            {
+                if (isLayerSolid(accessor, axis, cell, first, last))
+                {
+                    return std::min(0.0f, static_cast<float>(cell + 1) - min[axis]);
+                }
+            }
+        }
+        return motion;
+    }
+
+    VoxelSweepResult resolveSweep(const VoxelSweep &sweep, VoxelAccessor &accessor)
+    {
+        // Vertical first, so a box walking into a step lands on it before moving sideways
+        static constexpr int AXIS_ORDER[3] = {1, 0, 2};
+        VoxelSweepResult result;
+        glm::vec3 min = sweep.min;
+        glm::vec3 max = sweep.max;
+        for (int axis : AXIS_ORDER)
+        {
+            float wanted = sweep.motion[axis];
+            if (wanted == 0.0f || !std::isfinite(wanted))
+            {
+                continue;
+            }
+            float moved = sweepAxis(accessor, min, max, axis, wanted);
+            if (moved != wanted)
+            {
+                result.blocked_axes |= static_cast<uint8_t>(1u << axis);
+                result.on_ground = result.on_ground || (axis == 1 && wanted < 0.0f);
+            }
+            result.motion[axis] = moved;
+            min[axis] += moved;
+            max[axis] += moved;
+        }
+        return result;
+    }
+}
+
+VoxelWorld::VoxelWorld(uint32_t seed, JobSystem &job_system, int render_distance)
+    : world_seed(seed), render_distance(render_distance), last_center_chunk(INT_MAX), height_cache(seed),
+      job_system(job_system), region_storage("saves/" + std::to_string(seed) + "/", job_system)
+{
+    fluids = std::make_unique<FluidSimulator>(*this);
+    entities = std::make_unique<EntityStore>(*this, "saves/" + std::to_string(seed) + "/entities/", job_system);
+    height_cache.setCapacity(getHeightCacheCapacity());
+    setTerrainDiskCache(true);
+    chunk_grid.resize(getChunkGridRadius(), CHUNK_GRID_LAYER_RADIUS);
+    rebuildOffsetTables();
+}
+
+VoxelWorld::~VoxelWorld()
+{
+    // Tasks still running reference this world: cancel them so their workers skip the
+    // generation, then resume each on this thread until it has finished (and recycled its
+    // chunk) before any chunk storage goes away
+    cancelGenerations();
+    while (generation_tasks > 0)
+    {
+        if (main_thread_tasks.resumeAll() == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1)); // Still on a worker
+        }
+    }
+
+    // Edits still loaded would otherwise be lost; region_storage waits for the writes
+    saveModifiedChunks();
+
+    // Chunks still referenced elsewhere (mesh jobs) outlive the map
+}
+
+void VoxelWorld::update(const glm::vec3 &center_position)
+{
+    PROFILE_ZONE("VoxelWorld::update");
+    if (streaming_viewers)
+    {
+        // Other viewers were added: the center is one of them now
+        if (viewers.find(center_viewer) == viewers.end())
+        {
+            center_viewer = addViewer(center_position);
+        }
+        else
+        {
+            moveViewer(center_viewer, center_position);
+        }
+        updateViewers();
+        return;
+    }
+    updateChunksAroundPosition(center_position);
+    processPipeline();
+}
+
+void VoxelWorld::updateViewers()
+{
+    PROFILE_ZONE("VoxelWorld::updateViewers");
+    // Viewer moves already queued their loads and unloads. Queued chunks keep the distance of
+    // the nearest viewer that wanted them; after moves it is recomputed once per tick
+    if (viewers_moved)
+    {
+        viewers_moved = false;
+        chunks_to_load.reprioritize([this](const glm::ivec3 &chunk_pos)
+                                    { return nearestViewerDistance(chunk_pos); });
+    }
+    processPipeline();
+}
+
+void VoxelWorld::processPipeline()
+{
+    if (implicit_stale)
+    {
+        implicit_stale = false;
+        refreshImplicitChunks();
+    }
+    integrateGeneratedChunks();
+    processPastes();
+    journal_edits = false; // Flow follows the recorded edits, undone or not
+    fluids->update();
+    journal_edits = true;
+    entities->update();
+    processChunkLoadingQueue();
+    processChunkUnloadingQueue();
+    processCheckpoint();
+    processAutosave();
+    processIdlePacking();
+    recycleRetiredChunks();
+}
+
+Task VoxelWorld::streamChunk(GenerationRequest request, CancelToken token)
+{
+    generation_tasks++;
+    GenerationResult result;
+    result.position = request.position;
+    result.requested_at = request.requested_at;
+
+    // On a worker: chunks are built standalone and only become visible to the world on the
+    // main thread. Skipped if the chunk left range while the job was queued.
+    if (co_await resumeOn(job_system, JobPriority::Low, token))
+    {
+        generation_in_flight++;
+        result.started_at = Clock::now();
+        result.chunk = acquireChunk(request.position);
+        try
+        {
+            result.restored = restoreChunk(*result.chunk);
+            if (!result.restored)
+            {
+                result.chunk->generate(world_seed, &height_cache, getTerrainMode());
+            }
+        }
+        catch (const std::exception &e)
+        {
+            Log::writeLimited(LogLevel::Error, "Chunk generation failures", std::string("Chunk generation failed: ") + e.what());
+            result.chunk->is_generated = false;
+        }
+
+        result.finished_at = Clock::now();
+        result.chunk->pipeline.requested = request.load_requested_at;
+        result.chunk->pipeline.generated = std::chrono::steady_clock::now();
+        result.chunk->pipeline.pending = true;
+        generation_in_flight--;
+    }
+    generation_jobs_outstanding--;
+
+    // On the main thread, within the integrate budget; a pooled shell may own GL objects,
+    // so even failed chunks are recycled there
+    co_await main_thread_tasks.nextFrame();
+    auto entry = chunks_generating.find(request.position);
+    if (entry != chunks_generating.end() && entry->second == token)
+    {
+        chunks_generating.erase(entry);
+    }
+    if (result.chunk)
+    {
+        integrateGeneratedChunk(result);
+    }
+    generation_tasks--;
+}
+
+void VoxelWorld::integrateGeneratedChunk(GenerationResult &result)
+{
+    const glm::ivec3 &chunk_pos = result.position;
+
+    // Failed generation
+    if (!result.chunk->is_generated)
+    {
+        recycleChunk(std::move(result.chunk));
+        return;
+    }
+
+    // The chunk may have been created synchronously (e.g. by setVoxel) or left range meanwhile
+    if (isChunkLoaded(chunk_pos) || !isWithinLoadRange(chunk_pos))
+    {
+        generation_stats.total_discarded++;
+        recycleChunk(std::move(result.chunk));
+        return;
+    }
+
+    // Uniform sky or rock out of sight: only the position is kept
+    if (!result.restored && result.chunk->isUniform() &&
+        isImplicitSection(chunk_pos, result.chunk->getUniformVoxel()))
+    {
+        implicit_chunks[chunk_pos] = result.chunk->getUniformVoxel();
+        generation_stats.total_implicit++;
+        recycleChunk(std::move(result.chunk));
+        return;
+    }
+
+    VoxelChunk *stored = storeChunk(std::move(result.chunk));
+    linkChunkNeighbors(stored);
+    light_propagator.chunkLinked(*stored);
+
+    auto inserted_at = Clock::now();
+    queue_wait_sum_ms += std::chrono::duration<double, std::milli>(result.started_at - result.requested_at).count();
+    float generate_ms = std::chrono::duration<float, std::milli>(result.finished_at - result.started_at).count();
+    generate_sum_ms += generate_ms;
+    handoff_sum_ms += std::chrono::duration<double, std::milli>(inserted_at - result.finished_at).count();
+    latency_samples++;
+    generation_stats.total_generated++;
+    generation_stats.total_restored += result.restored ? 1 : 0;
+    generation_stats.max_generate_ms = std::max(generation_stats.max_generate_ms, generate_ms);
+}
+
+void VoxelWorld::integrateGeneratedChunks()
+{
+    // Spread large batches over several frames; at least one chunk always goes in and the
+    // rest keep their place in front of newer results
+    auto integrate_start = Clock::now();
+    main_thread_tasks.resumeAll(integrate_budget_ms);
+
+    // Light across the new borders, once for the batch
+    light_propagator.propagate(false);
+
+    auto integrate_end = Clock::now();
+    generation_stats.last_integrate_ms = std::chrono::duration<float, std::milli>(integrate_end - integrate_start).count();
+}
+
+void VoxelWorld::cancelGenerations(const std::function<bool(const glm::ivec3 &)> &unwanted)
+{
+    for (auto it = chunks_generating.begin(); it != chunks_generating.end();)
+    {
+        if (!unwanted || unwanted(it->first))
+        {
+            it->second.cancel();
+            it = chunks_generating.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+bool VoxelWorld::getViewerLayers(int &low, int &high) const
+{
+    if (!streaming_viewers)
+    {
+        low = last_center_chunk.y;
+        high = last_center_chunk.y;
+        return last_center_chunk.x != INT_MAX;
+    }
+    low = INT_MAX;
+    high = INT_MIN;
+    for (const auto &[viewer, state] : viewers)
+    {
+        low = std::min(low, state.center.y);
+        high = std::max(high, state.center.y);
+    }
+    return !viewers.empty();
+}
+
+bool VoxelWorld::isImplicitSection(const glm::ivec3 &chunk_pos, VoxelID voxel) const
+{
+    int low, high;
+    if (!getViewerLayers(low, high))
+    {
+        return false;
+    }
+
+    // Air between a viewer and the ground below stays, so the visibility walk can cross it
+    if (voxel == VOXEL_AIR)
+    {
+        return chunk_pos.y > high + VIEWER_BAND_LAYERS;
+    }
+    return !isVoxelTransparent(voxel) && chunk_pos.y < low - VIEWER_BAND_LAYERS;
+}
+
+void VoxelWorld::refreshImplicitChunks()
+{
+    // Once the viewers' layers change, stored sections that left every band go implicit too,
+    // unless edited since the last save (their saved copy is what a later request restores)
+    int low, high;
+    if (getViewerLayers(low, high) && (low != implicit_band_low || high != implicit_band_high))
+    {
+        implicit_band_low = low;
+        implicit_band_high = high;
+        std::vector<glm::ivec3> leaving;
+        for (const auto &[chunk_pos, chunk] : chunks)
+        {
+            if (chunk->is_generated && !chunk->is_dirty && chunk->isUniform() &&
+                isImplicitSection(chunk_pos, chunk->getUniformVoxel()))
+            {
+                leaving.push_back(chunk_pos);
+            }
+        }
+        for (const glm::ivec3 &chunk_pos : leaving)
+        {
+            VoxelID voxel = chunks[chunk_pos]->getUniformVoxel();
+            unloadChunk(chunk_pos);
+            implicit_chunks[chunk_pos] = voxel;
+        }
+    }
+
+    for (auto it = implicit_chunks.begin(); it != implicit_chunks.end();)
+    {
+        glm::ivec3 chunk_pos = it->first;
+        if (isWithinLoadRange(chunk_pos) && isImplicitSection(chunk_pos, it->second))
+        {
+            ++it;
+            continue;
+        }
+        it = implicit_chunks.erase(it);
+
+        // A band reached it: requested like any missing chunk
+        auto interest = chunk_interest.find(chunk_pos);
+        bool wanted = streaming_viewers ? interest != chunk_interest.end() && interest->second.load > 0
+                                        : isLoadOffset(chunk_pos - last_center_chunk);
+        if (wanted && needsRequest(chunk_pos))
+        {
+            chunks_to_load.pushMin(chunk_pos, streaming_viewers ? nearestViewerDistance(chunk_pos)
+                                                               : chunkDistance(chunk_pos - last_center_chunk));
+        }
+    }
+}
+
+VoxelID VoxelWorld::predictUniformSection(const glm::ivec3 &chunk_pos)
+{
+    if (getTerrainMode() != TerrainMode::Heightmap)
+    {
+        return VOXEL_NONE; // Overhangs move the surface away from the heights
+    }
+
+    // Heights of the column and of the neighbors whose trees and borders reach into it
+    int low = INT_MAX;
+    int high = INT_MIN;
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        for (int dz = -1; dz <= 1; dz++)
+        {
+            HeightFieldCache::TileHandle tile = height_cache.peek(glm::ivec2(chunk_pos.x + dx, chunk_pos.z + dz));
+            if (!tile)
+            {
+                return VOXEL_NONE; // Generation fetches it
+            }
+            auto bounds = std::minmax_element(tile->heights.begin(), tile->heights.end());
+            low = std::min(low, *bounds.first);
+            high = std::max(high, *bounds.second);
+        }
+    }
+
+    // The same tests as VoxelChunk::classifyUniformChunk, with the decoration on top: trees
+    // grow up to MAX_TRUNK_HEIGHT + 2 over the ground, veins only from ORE_MIN_Y
+    int bottom = chunk_pos.y * CHUNK_HEIGHT;
+    int top = bottom + CHUNK_HEIGHT - 1;
+    if (bottom >= high + TerrainFeatures::MAX_TRUNK_HEIGHT + 2 && bottom > WATER_LEVEL)
+    {
+        return VOXEL_AIR;
+    }
+    if (top < low - SURFACE_DEPTH && top < TerrainFeatures::ORE_MIN_Y)
+    {
+        return VOXEL_STONE;
+    }
+    return VOXEL_NONE;
+}
+
+VoxelID VoxelWorld::getImplicitVoxel(const glm::ivec3 &chunk_pos) const
+{
+    auto it = implicit_chunks.find(chunk_pos);
+    return it != implicit_chunks.end() ? it->second : VOXEL_NONE;
+}
+
+bool VoxelWorld::isWithinLoadRange(const glm::ivec3 &chunk_pos) const
+{
+    if (streaming_viewers)
+    {
+        return isViewerKept(chunk_pos);
+    }
+    return isKeepOffset(chunk_pos - last_center_chunk); // Same hysteresis as unloading
+}
+
+float VoxelWorld::chunkDistance(const glm::ivec3 &offset)
+{
+    // Vertical distance counts half, matching the flatter load volume
+    return std::sqrt(offset.x * offset.x + offset.y * offset.y * 0.25f + offset.z * offset.z);
+}
+
+bool VoxelWorld::isLoadOffset(const glm::ivec3 &offset, int distance)
+{
+    return std::abs(offset.y) <= LOAD_LAYERS && chunkDistance(offset) <= distance;
+}
+
+bool VoxelWorld::isKeepOffset(const glm::ivec3 &offset, int distance)
+{
+    // +1.5 (and a layer) for hysteresis to prevent thrashing
+    return std::abs(offset.y) <= LOAD_LAYERS + 1 && chunkDistance(offset) <= distance + 1.5f;
+}
+
+ChunkGenerationStats VoxelWorld::getGenerationStats()
+{
+    ChunkGenerationStats stats = generation_stats;
+    stats.in_flight = generation_in_flight.load();
+    stats.queued = generation_jobs_outstanding.load() - std::min(stats.in_flight, generation_jobs_outstanding.load());
+    stats.awaiting_insert = main_thread_tasks.size();
+    stats.retired_chunks = retired_chunks.size();
+    stats.implicit_chunks = implicit_chunks.size();
+    {
+        std::unique_lock<std::mutex> pool_lock(chunk_pool_mutex);
+        stats.pooled_chunks = chunk_pool.size();
+        stats.chunks_allocated = chunks_allocated;
+        chunks_allocated = 0;
+    }
+    stats.pending_saves = region_storage.getPendingWriteCount();
+    stats.unsaved_chunks = unsaved_chunks.size();
+    stats.height_tiles = height_cache.size();
+    height_cache.takeStats(stats.height_tile_hits, stats.height_tile_misses, stats.height_tiles_loaded);
+
+    if (latency_samples > 0)
+    {
+        stats.avg_queue_wait_ms = static_cast<float>(queue_wait_sum_ms / latency_samples);
+        stats.avg_generate_ms = static_cast<float>(generate_sum_ms / latency_samples);
+        stats.avg_handoff_ms = static_cast<float>(handoff_sum_ms / latency_samples);
+    }
+
+    // Start a new sampling period
+    queue_wait_sum_ms = 0.0;
+    generate_sum_ms = 0.0;
+    handoff_sum_ms = 0.0;
+    latency_samples = 0;
+    generation_stats.max_generate_ms = 0.0f;
+
+    return stats;
+}
+
+size_t VoxelWorld::getPooledChunkBytes()
+{
+    std::unique_lock<std::mutex> lock(chunk_pool_mutex);
+    size_t bytes = 0;
+    for (const auto &chunk : chunk_pool)
+    {
+        bytes += chunk->getMemoryUsage() + (chunk->mesh ? chunk->mesh->getCpuMemoryUsage() : 0);
+    }
+    return bytes;
+}
+
+void VoxelWorld::updateChunksAroundPosition(const glm::vec3 &position)
+{
+    glm::ivec3 center_chunk = worldToChunk(position);
+
+    // Only update if the center chunk has changed
+    if (center_chunk == last_center_chunk)
+    {
+        return;
+    }
+
+    glm::ivec3 previous_center = last_center_chunk;
+    last_center_chunk = center_chunk;
+    chunk_grid.setCenter(center_chunk);
+    implicit_stale = true;
+
+    // One-chunk steps (the common case while walking) only touch the shells that change;
+    // first load, teleports and render distance changes rescan everything
+    bool has_previous = previous_center.x != INT_MAX;
+    bool small_move = has_previous &&
+                      std::abs(static_cast<long long>(center_chunk.x) - previous_center.x) <= 1 &&
+                      std::abs(static_cast<long long>(center_chunk.y) - previous_center.y) <= 1 &&
+                      std::abs(static_cast<long long>(center_chunk.z) - previous_center.z) <= 1;
+
+    if (small_move)
+    {
+        updateChunkSetsIncremental(previous_center, center_chunk - previous_center);
+    }
+    else
+    {
+        updateChunkSetsFull();
+    }
+}
+
+void VoxelWorld::updateChunkSetsFull()
+{
+    const glm::ivec3 &center_chunk = last_center_chunk;
+    rebuildChunkGrid();
+
+    // Cancel requests that left the load range; a worker that has not picked one up yet skips
+    // it. Generations already running finish and are filtered on insertion.
+    cancelGenerations([&](const glm::ivec3 &chunk_pos)
+                      { return !isLoadOffset(chunk_pos - center_chunk); });
+
+    // Walk the precomputed table and queue everything missing by distance
+    chunks_to_load.clear();
+    for (const auto &offset : render_tables->load)
+    {
+        glm::ivec3 chunk_pos = center_chunk + offset;
+        if (needsRequest(chunk_pos))
+        {
+            chunks_to_load.push(chunk_pos, chunkDistance(offset));
+        }
+    }
+
+    // Find chunks to unload (chunks that are too far away)
+    chunks_to_unload.clear();
+    for (const auto &[chunk_pos, chunk] : chunks)
+    {
+        if (!isKeepOffset(chunk_pos - center_chunk))
+        {
+            chunks_to_unload.push_back(chunk_pos);
+        }
+    }
+}
+
+void VoxelWorld::updateChunkSetsIncremental(const glm::ivec3 &previous_center, const glm::ivec3 &delta)
+{
+    const glm::ivec3 &center_chunk = last_center_chunk;
+    const ShellDelta &shell = getShellDelta(*render_tables, delta);
+
+    // Every chunk kept around the old center is still inside the moved grid window and keeps
+    // its slot; only far-away outliers may need slotting in
+    for (auto it = grid_outliers.begin(); it != grid_outliers.end();)
+    {
+        if (chunk_grid.contains(*it))
+        {
+            auto owned = chunks.find(*it);
+            if (owned != chunks.end())
+            {
+                chunk_grid.insert(owned->second.get());
+            }
+            it = grid_outliers.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    // Requests stay unless they fell out of the load range
+    cancelGenerations([&](const glm::ivec3 &chunk_pos)
+                      { return !isLoadOffset(chunk_pos - center_chunk); });
+
+    // Cancel pending loads the player walked away from, then re-key the rest by new distance
+    for (const auto &offset : shell.load_leaving)
+    {
+        chunks_to_load.erase(previous_center + offset);
+    }
+    chunks_to_load.reprioritize([&](const glm::ivec3 &chunk_pos)
+                                { return chunkDistance(chunk_pos - center_chunk); });
+
+    // Newly entering shell
+    for (const auto &offset : shell.entering)
+    {
+        glm::ivec3 chunk_pos = center_chunk + offset;
+        if (needsRequest(chunk_pos))
+        {
+            chunks_to_load.push(chunk_pos, chunkDistance(offset));
+        }
+    }
+
+    // Only the leaving shell of the old keep range can hold chunks that are now too far
+    chunks_to_unload.clear();
+    for (const auto &offset : shell.leaving)
+    {
+        glm::ivec3 chunk_pos = previous_center + offset;
+        if (isChunkLoaded(chunk_pos))
+        {
+            chunks_to_unload.push_back(chunk_pos);
+        }
+    }
+    for (const auto &chunk_pos : grid_outliers)
+    {
+        if (!isKeepOffset(chunk_pos - center_chunk))
+        {
+            chunks_to_unload.push_back(chunk_pos);
+        }
+    }
+}
+
+uint32_t VoxelWorld::addViewer(const glm::vec3 &position, int distance)
+{
+    bool first = !streaming_viewers;
+    streaming_viewers = true;
+    if (first)
+    {
+        // Whatever update loaded around its single center only stays if a viewer wants it
+        chunks_to_load.clear();
+        cancelGenerations();
+
+        // update already streams around a center: keep it as a viewer so it does not go away
+        // until update's next call moves it
+        if (last_center_chunk.x != INT_MAX)
+        {
+            center_viewer = registerViewer(last_center_chunk, 0);
+        }
+    }
+
+    uint32_t viewer = registerViewer(worldToChunk(position), distance);
+    if (grid_viewer == 0)
+    {
+        centerGridOnViewer(center_viewer != 0 ? center_viewer : viewer);
+    }
+
+    if (first)
+    {
+        for (const auto &[chunk_pos, chunk] : chunks)
+        {
+            if (!isViewerKept(chunk_pos))
+            {
+                chunks_to_unload.push_back(chunk_pos);
+            }
+        }
+    }
+    return viewer;
+}
+
+uint32_t VoxelWorld::registerViewer(const glm::ivec3 &center_chunk, int distance)
+{
+    uint32_t viewer = next_viewer_id++;
+    Viewer &state = viewers[viewer];
+    state.center = center_chunk;
+    state.distance = std::max(0, distance);
+    height_cache.setCapacity(getHeightCacheCapacity());
+
+    RangeTables &tables = getViewerTables(state);
+    addInterest(center_chunk, tables.keep, false);
+    addInterest(center_chunk, tables.load, true);
+    return viewer;
+}
+
+void VoxelWorld::moveViewer(uint32_t viewer, const glm::vec3 &position)
+{
+    auto it = viewers.find(viewer);
+    if (it == viewers.end())
+    {
+        return;
+    }
+    glm::ivec3 center_chunk = worldToChunk(position);
+    glm::ivec3 previous_center = it->second.center;
+    if (center_chunk == previous_center)
+    {
+        return;
+    }
+    it->second.center = center_chunk;
+    viewers_moved = true;
+    implicit_stale = true;
+
+    // New interest is counted before the old is released, so chunks both ranges share never
+    // drop to zero and unload
+    RangeTables &tables = getViewerTables(it->second);
+    glm::ivec3 delta = center_chunk - previous_center;
+    if (std::abs(delta.x) <= 1 && std::abs(delta.y) <= 1 && std::abs(delta.z) <= 1)
+    {
+        const ShellDelta &shell = getShellDelta(tables, delta);
+        addInterest(center_chunk, shell.keep_entering, false);
+        addInterest(center_chunk, shell.entering, true);
+        releaseInterest(previous_center, shell.load_leaving, true);
+        releaseInterest(previous_center, shell.leaving, false);
+    }
+    else
+    {
+        addInterest(center_chunk, tables.keep, false);
+        addInterest(center_chunk, tables.load, true);
+        releaseInterest(previous_center, tables.load, true);
+        releaseInterest(previous_center, tables.keep, false);
+    }
+
+    if (viewer == grid_viewer)
+    {
+        centerGridOnViewer(viewer);
+    }
+}
+
+void VoxelWorld::setViewerDistance(uint32_t viewer, int distance)
+{
+    auto it = viewers.find(viewer);
+    distance = std::max(0, distance);
+    if (it == viewers.end() || it->second.distance == distance)
+    {
+        return;
+    }
+    const glm::ivec3 &center_chunk = it->second.center;
+    RangeTables &previous = getViewerTables(it->second);
+    it->second.distance = distance;
+    RangeTables &tables = getViewerTables(it->second);
+
+    addInterest(center_chunk, tables.keep, false);
+    addInterest(center_chunk, tables.load, true);
+    releaseInterest(center_chunk, previous.load, true);
+    releaseInterest(center_chunk, previous.keep, false);
+    height_cache.setCapacity(getHeightCacheCapacity());
+    viewers_moved = true;
+    implicit_stale = true;
+    rebuildOffsetTables();
+}
+
+void VoxelWorld::removeViewer(uint32_t viewer)
+{
+    auto it = viewers.find(viewer);
+    if (it == viewers.end())
+    {
+        return;
+    }
+    const glm::ivec3 center_chunk = it->second.center;
+    RangeTables &tables = getViewerTables(it->second);
+    viewers.erase(it);
+    releaseInterest(center_chunk, tables.load, true);
+    releaseInterest(center_chunk, tables.keep, false);
+    height_cache.setCapacity(getHeightCacheCapacity());
+    viewers_moved = true;
+    implicit_stale = true;
+    rebuildOffsetTables();
+    if (viewer == center_viewer)
+    {
+        center_viewer = 0;
+    }
+
+    if (viewer == grid_viewer)
+    {
+        grid_viewer = 0;
+        if (center_viewer != 0)
+        {
+            centerGridOnViewer(center_viewer);
+        }
+        else if (!viewers.empty())
+        {
+            centerGridOnViewer(viewers.begin()->first);
+        }
+    }
+}
+
+void VoxelWorld::centerGridOnViewer(uint32_t viewer)
+{
+    grid_viewer = viewer;
+    last_center_chunk = viewers[viewer].center;
+    chunk_grid.setCenter(last_center_chunk);
+    rebuildChunkGrid();
+}
+
+void VoxelWorld::addInterest(const glm::ivec3 &center, const std::vector<glm::ivec3> &offsets, bool load)
+{
+    for (const auto &offset : offsets)
+    {
+        glm::ivec3 chunk_pos = center + offset;
+        ChunkInterest &interest = chunk_interest[chunk_pos];
+        if (!load)
+        {
+            interest.keep++;
+            continue;
+        }
+        // A chunk already queued for another viewer moves up if this one is nearer
+        bool wanted = interest.load++ == 0 ? needsRequest(chunk_pos) : chunks_to_load.contains(chunk_pos);
+        if (wanted)
+        {
+            chunks_to_load.pushMin(chunk_pos, chunkDistance(offset));
+        }
+    }
+}
+
+void VoxelWorld::releaseInterest(const glm::ivec3 &center, const std::vector<glm::ivec3> &offsets, bool load)
+{
+    for (const auto &offset : offsets)
+    {
+        auto it = chunk_interest.find(center + offset);
+        if (it == chunk_interest.end())
+        {
+            continue;
+        }
+        ChunkInterest &interest = it->second;
+        if (load)
+        {
+            if (interest.load > 0 && --interest.load == 0)
+            {
+                chunks_to_load.erase(it->first);
+                auto generating = chunks_generating.find(it->first);
+                if (generating != chunks_generating.end())
+                {
+                    generating->second.cancel();
+                    chunks_generating.erase(generating);
+                }
+            }
+        }
+        else if (interest.keep > 0 && --interest.keep == 0 && isChunkLoaded(it->first))
+        {
+            chunks_to_unload.push_back(it->first); // Skipped if another viewer comes first
+        }
+
+        if (interest.load == 0 && interest.keep == 0)
+        {
+            chunk_interest.erase(it);
+        }
+    }
 }
 
-VoxelWorld::~VoxelWorld()
+bool VoxelWorld::isViewerKept(const glm::ivec3 &chunk_pos) const
 {
-    // Unique pointers will automatically clean up
+    auto it = chunk_interest.find(chunk_pos);
+    return it != chunk_interest.end() && it->second.keep > 0;
 }
 
-void VoxelWorld::update(const glm::vec3 &center_position)
+float VoxelWorld::nearestViewerDistance(const glm::ivec3 &chunk_pos) const
 {
-    updateChunksAroundPosition(center_position);
-    processChunkLoadingQueue();
-    processChunkUnloadingQueue();
+    float nearest = std::numeric_limits<float>::max();
+    for (const auto &[viewer, state] : viewers)
+    {
+        nearest = std::min(nearest, chunkDistance(chunk_pos - state.center));
+    }
+    return nearest;
 }
 
-void VoxelWorld::updateChunksAroundPosition(const glm::vec3 &position)
+void VoxelWorld::rebuildOffsetTables()
 {
-    glm::ivec3 center_chunk = worldToChunk(position);
+    render_tables = &getRangeTables(render_distance);
+    for (auto it = range_tables.begin(); it != range_tables.end();)
+    {
+        bool used = it->first == render_distance;
+        for (const auto &[viewer, state] : viewers)
+        {
+            used = used || state.distance == it->first;
+        }
+        it = used ? std::next(it) : range_tables.erase(it);
+    }
+}
 
-    // Only update if the center chunk has changed
-    if (center_chunk == last_center_chunk)
+VoxelWorld::RangeTables &VoxelWorld::getRangeTables(int distance)
+{
+    std::unique_ptr<RangeTables> &tables = range_tables[distance];
+    if (tables)
     {
-        return;
+        return *tables;
     }
+    tables = std::make_unique<RangeTables>();
+    tables->distance = distance;
 
-    last_center_chunk = center_chunk;
+    // Structure to hold distance and offset with proper comparison
+    struct OffsetDistance
+    {
+        float distance;
+        glm::ivec3 offset;
+
+        // Comparison operator for sorting (nearest first)
+        bool operator<(const OffsetDistance &other) const
+        {
+            return distance < other.distance;
+        }
+    };
 
-    // Get chunks that should be loaded (now sorted by distance)
-    std::vector<glm::ivec3> desired_chunks = getChunksInRange(center_chunk, render_distance);
+    std::vector<OffsetDistance> load;
+    std::vector<OffsetDistance> keep;
+    int keep_extent = distance + 2;
+    int max_dy = LOAD_LAYERS + 1;
 
-    // Find chunks to load (they're already in priority order)
-    chunks_to_load.clear();
-    for (const auto &chunk_pos : desired_chunks)
+    for (int x = -keep_extent; x <= keep_extent; x++)
     {
-        if (!isChunkLoaded(chunk_pos))
+        for (int y = -max_dy; y <= max_dy; y++)
         {
-            chunks_to_load.push_back(chunk_pos);
+            for (int z = -keep_extent; z <= keep_extent; z++)
+            {
+                glm::ivec3 offset(x, y, z);
+                float offset_distance = chunkDistance(offset);
+                if (isLoadOffset(offset, distance))
+                {
+                    load.push_back({offset_distance, offset});
+                }
+                if (isKeepOffset(offset, distance))
+                {
+                    keep.push_back({offset_distance, offset});
+                }
+            }
         }
     }
 
-    // Find chunks to unload (chunks that are too far away)
-    chunks_to_unload.clear();
-    for (const auto &[chunk_pos, chunk] : chunks)
+    std::stable_sort(load.begin(), load.end());
+
+    tables->load.reserve(load.size());
+    for (const auto &entry : load)
     {
-        glm::ivec3 diff = chunk_pos - center_chunk;
-        // Use proper distance calculation for unloading too
-        float distance = std::sqrt(diff.x * diff.x + diff.y * diff.y * 0.25f + diff.z * diff.z);
+        tables->load.push_back(entry.offset);
+    }
 
-        if (distance > render_distance + 1.5f)
-        { // +1.5 for hysteresis to prevent thrashing
-            chunks_to_unload.push_back(chunk_pos);
+    tables->keep.reserve(keep.size());
+    for (const auto &entry : keep)
+    {
+        tables->keep.push_back(entry.offset);
+    }
+    return *tables;
+}
+
+const VoxelWorld::ShellDelta &VoxelWorld::getShellDelta(RangeTables &tables, const glm::ivec3 &delta)
+{
+    auto it = tables.shells.find(delta);
+    if (it != tables.shells.end())
+    {
+        return it->second;
+    }
+
+    // A chunk at new_center + o was already wanted iff o + delta was a load offset;
+    // a chunk at old_center + o is still kept (wanted) iff o - delta is a keep (load) offset
+    int distance = tables.distance;
+    ShellDelta shell;
+    for (const auto &offset : tables.load)
+    {
+        if (!isLoadOffset(offset + delta, distance))
+        {
+            shell.entering.push_back(offset);
+        }
+    }
+    for (const auto &offset : tables.keep)
+    {
+        if (!isKeepOffset(offset - delta, distance))
+        {
+            shell.leaving.push_back(offset);
+        }
+    }
+    for (const auto &offset : tables.load)
+    {
+        if (!isLoadOffset(offset - delta, distance))
+        {
+            shell.load_leaving.push_back(offset);
+        }
+    }
+    for (const auto &offset : tables.keep)
+    {
+        if (!isKeepOffset(offset + delta, distance))
+        {
+            shell.keep_entering.push_back(offset);
         }
     }
+
+    return tables.shells.emplace(delta, std::move(shell)).first->second;
 }
 
 VoxelID VoxelWorld::getVoxel(int x, int y, int z) const
@@ -79,6 +1104,54 @@ VoxelID VoxelWorld::getVoxel(const glm::ivec3 &pos) const
     return chunk->getVoxel(local_pos);
 }
 
+void VoxelWorld::getVoxels(const glm::ivec3 &min_corner, const glm::ivec3 &max_corner, std::vector<VoxelID> &out) const
+{
+    if (min_corner.x > max_corner.x || min_corner.y > max_corner.y || min_corner.z > max_corner.z)
+    {
+        out.clear();
+        return;
+    }
+
+    glm::ivec3 size = max_corner - min_corner + 1;
+    out.assign(static_cast<size_t>(size.x) * size.y * size.z, VOXEL_AIR);
+
+    // One lookup per chunk; its part of the box is copied in z runs
+    glm::ivec3 first_chunk = worldToChunk(min_corner);
+    glm::ivec3 last_chunk = worldToChunk(max_corner);
+    for (int cx = first_chunk.x; cx <= last_chunk.x; cx++)
+    {
+        for (int cy = first_chunk.y; cy <= last_chunk.y; cy++)
+        {
+            for (int cz = first_chunk.z; cz <= last_chunk.z; cz++)
+            {
+                glm::ivec3 chunk_pos(cx, cy, cz);
+                const VoxelChunk *chunk = getChunk(chunk_pos);
+                if (!chunk)
+                {
+                    continue; // Unloaded reads as air, like getVoxel
+                }
+
+                glm::ivec3 origin = chunkToWorld(chunk_pos);
+                glm::ivec3 low = glm::max(min_corner, origin);
+                glm::ivec3 high = glm::min(max_corner, origin + glm::ivec3(CHUNK_SIZE - 1, CHUNK_HEIGHT - 1, CHUNK_SIZE - 1));
+                for (int x = low.x; x <= high.x; x++)
+                {
+                    for (int y = low.y; y <= high.y; y++)
+                    {
+                        VoxelID *row = &out[(static_cast<size_t>(x - min_corner.x) * size.y + (y - min_corner.y)) * size.z +
+                                            (low.z - min_corner.z)];
+                        int first = VoxelChunk::coordsToIndex(x - origin.x, y - origin.y, 0);
+                        for (int z = low.z; z <= high.z; z++)
+                        {
+                            row[z - low.z] = chunk->voxels.get(first + ChunkIndexing::offsetZ(z - origin.z));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
 void VoxelWorld::setVoxel(int x, int y, int z, VoxelID voxel)
 {
     setVoxel(glm::ivec3(x, y, z), voxel);
@@ -92,40 +1165,448 @@ void VoxelWorld::setVoxel(const glm::ivec3 &pos, VoxelID voxel)
     if (chunk)
     {
         glm::ivec3 local_pos = worldToLocal(pos);
+        uint64_t version = chunk->version;
+        VoxelID previous = isJournaling() ? chunk->getVoxel(local_pos) : voxel;
         chunk->setVoxel(local_pos, voxel);
+        if (chunk->version != version)
+        {
+            light_propagator.voxelChanged(*chunk, local_pos.x, local_pos.y, local_pos.z);
+            noteVoxelChanged(pos, previous, voxel, getRecordingJournal());
+        }
+        light_propagator.propagate(true);
+        noteChunkEdited(chunk_pos, *chunk);
+    }
+    commitJournal();
+}
+
+void VoxelWorld::noteVoxelChanged(const glm::ivec3 &position, VoxelID previous, VoxelID voxel, EditJournal *journal)
+{
+    fluids->voxelEdited(position);
+    if (edit_listener)
+    {
+        edit_listener(position, voxel);
+    }
+    if (journal)
+    {
+        journal->record(position, previous, voxel);
+    }
+}
+
+void VoxelWorld::commitJournal()
+{
+    if (edit_journal)
+    {
+        edit_journal->commit();
+    }
+}
+
+bool VoxelWorld::undoEdit()
+{
+    std::vector<VoxelEdit> edits;
+    if (!edit_journal || !edit_journal->takeUndo(edits))
+    {
+        return false;
+    }
+    journal_edits = false;
+    applyEdits(edits);
+    journal_edits = true;
+    return true;
+}
+
+bool VoxelWorld::redoEdit()
+{
+    std::vector<VoxelEdit> edits;
+    if (!edit_journal || !edit_journal->takeRedo(edits))
+    {
+        return false;
+    }
+    journal_edits = false;
+    applyEdits(edits);
+    journal_edits = true;
+    return true;
+}
+
+size_t VoxelWorld::replayEdits(const EditJournal &journal)
+{
+    std::vector<VoxelEdit> edits;
+    journal.collectApplied(edits);
+    journal_edits = false;
+    size_t changed = applyEdits(edits);
+    journal_edits = true;
+    return changed;
+}
+
+void VoxelWorld::noteChunkEdited(const glm::ivec3 &chunk_pos, const VoxelChunk &chunk)
+{
+    // Every edit restarts the quiet window; the first one also starts the max delay
+    if (chunk.is_dirty && !remote_chunks)
+    {
+        auto now = Clock::now();
+        auto [it, inserted] = unsaved_chunks.try_emplace(chunk_pos, UnsavedChunk{chunk.version, now, now});
+        if (!inserted && it->second.version != chunk.version)
+        {
+            it->second.version = chunk.version;
+            it->second.last_edit = now;
+        }
+    }
+}
+
+size_t VoxelWorld::applyEdits(const std::vector<VoxelEdit> &edits)
+{
+    struct LocalEdit
+    {
+        glm::ivec3 chunk_pos;
+        glm::ivec3 local_pos;
+        VoxelID voxel;
+    };
+    std::vector<LocalEdit> sorted;
+    sorted.reserve(edits.size());
+    for (const VoxelEdit &edit : edits)
+    {
+        glm::ivec3 chunk_pos = worldToChunk(edit.position);
+        sorted.push_back({chunk_pos, edit.position - chunkToWorld(chunk_pos), edit.voxel});
+    }
+
+    // Stable, so edits of one position keep their order and the last one lands
+    std::stable_sort(sorted.begin(), sorted.end(), [](const LocalEdit &a, const LocalEdit &b)
+                     {
+                         if (a.chunk_pos.x != b.chunk_pos.x)
+                             return a.chunk_pos.x < b.chunk_pos.x;
+                         if (a.chunk_pos.y != b.chunk_pos.y)
+                             return a.chunk_pos.y < b.chunk_pos.y;
+                         return a.chunk_pos.z < b.chunk_pos.z; });
+
+    EditJournal *journal = getRecordingJournal();
+    size_t changed = 0;
+    for (size_t first = 0, last = 0; first < sorted.size(); first = last)
+    {
+        const glm::ivec3 chunk_pos = sorted[first].chunk_pos;
+        while (last < sorted.size() && sorted[last].chunk_pos == chunk_pos)
+        {
+            last++;
+        }
+
+        VoxelChunk *chunk = getOrCreateChunk(chunk_pos);
+        if (!chunk)
+        {
+            continue;
+        }
+        BorderChanges changed_borders;
+        size_t chunk_changed = 0;
+        for (size_t i = first; i < last; i++)
+        {
+            const glm::ivec3 &local = sorted[i].local_pos;
+            VoxelID previous = journal ? chunk->getVoxel(local) : VOXEL_AIR;
+            if (chunk->setVoxelDeferred(local.x, local.y, local.z, sorted[i].voxel, changed_borders))
+            {
+                light_propagator.voxelChanged(*chunk, local.x, local.y, local.z);
+                noteVoxelChanged(chunkToWorld(chunk_pos) + local, previous, sorted[i].voxel, journal);
+                chunk_changed++;
+            }
+        }
+        if (chunk_changed > 0)
+        {
+            chunk->commitEdits(changed_borders);
+            noteChunkEdited(chunk_pos, *chunk);
+            changed += chunk_changed;
+        }
+    }
+    light_propagator.propagate(true);
+    commitJournal();
+    return changed;
+}
+
+template <typename Inside>
+size_t VoxelWorld::fillRegion(const glm::ivec3 &min_corner, const glm::ivec3 &max_corner, VoxelID voxel, Inside inside)
+{
+    if (min_corner.x > max_corner.x || min_corner.y > max_corner.y || min_corner.z > max_corner.z)
+    {
+        return 0;
+    }
+
+    // Chunk by chunk over the box, writing each chunk's part in storage order (z fastest);
+    // chunks are only created once a voxel of theirs is inside
+    glm::ivec3 first_chunk = worldToChunk(min_corner);
+    glm::ivec3 last_chunk = worldToChunk(max_corner);
+    EditJournal *journal = getRecordingJournal();
+    size_t changed = 0;
+    for (int cx = first_chunk.x; cx <= last_chunk.x; cx++)
+    {
+        for (int cy = first_chunk.y; cy <= last_chunk.y; cy++)
+        {
+            for (int cz = first_chunk.z; cz <= last_chunk.z; cz++)
+            {
+                glm::ivec3 chunk_pos(cx, cy, cz);
+                glm::ivec3 origin = chunkToWorld(chunk_pos);
+                glm::ivec3 low = glm::max(min_corner - origin, glm::ivec3(0));
+                glm::ivec3 high = glm::min(max_corner - origin, glm::ivec3(CHUNK_SIZE - 1, CHUNK_HEIGHT - 1, CHUNK_SIZE - 1));
+
+                VoxelChunk *chunk = nullptr;
+                BorderChanges changed_borders;
+                size_t chunk_changed = 0;
+                for (int x = low.x; x <= high.x; x++)
+                {
+                    for (int y = low.y; y <= high.y; y++)
+                    {
+                        for (int z = low.z; z <= high.z; z++)
+                        {
+                            if (!inside(origin + glm::ivec3(x, y, z)))
+                            {
+                                continue;
+                            }
+                            if (!chunk && !(chunk = getOrCreateChunk(chunk_pos)))
+                            {
+                                continue; // Not received from the server
+                            }
+                            VoxelID previous = journal ? chunk->getVoxel(x, y, z) : VOXEL_AIR;
+                            if (chunk->setVoxelDeferred(x, y, z, voxel, changed_borders))
+                            {
+                                light_propagator.voxelChanged(*chunk, x, y, z);
+                                noteVoxelChanged(origin + glm::ivec3(x, y, z), previous, voxel, journal);
+                                chunk_changed++;
+                            }
+                        }
+                    }
+                }
+
+                if (chunk_changed > 0)
+                {
+                    chunk->commitEdits(changed_borders);
+                    noteChunkEdited(chunk_pos, *chunk);
+                    changed += chunk_changed;
+                }
+            }
+        }
+    }
+    light_propagator.propagate(true);
+    commitJournal();
+    return changed;
+}
+
+size_t VoxelWorld::fillBox(const glm::ivec3 &min_corner, const glm::ivec3 &max_corner, VoxelID voxel)
+{
+    return fillRegion(min_corner, max_corner, voxel, [](const glm::ivec3 &)
+                      { return true; });
+}
+
+size_t VoxelWorld::fillSphere(const glm::vec3 &center, float radius, VoxelID voxel)
+{
+    if (radius <= 0.0f)
+    {
+        return 0;
+    }
+    glm::ivec3 min_corner(glm::floor(center - radius));
+    glm::ivec3 max_corner(glm::floor(center + radius));
+    float radius_squared = radius * radius;
+    return fillRegion(min_corner, max_corner, voxel, [&](const glm::ivec3 &pos)
+                      {
+                          glm::vec3 offset = glm::vec3(pos) + 0.5f - center;
+                          return glm::dot(offset, offset) <= radius_squared; });
+}
+
+size_t VoxelWorld::pasteSchematic(const Schematic &schematic, const glm::ivec3 &origin, bool paste_air)
+{
+    std::shared_ptr<const Schematic::Slabs> slabs = schematic.getSlabs(origin, paste_air);
+    const glm::ivec3 origin_chunk = worldToChunk(origin);
+    EditJournal *journal = getRecordingJournal();
+    size_t changed = 0;
+    for (const Schematic::Slab &slab : *slabs)
+    {
+        changed += pasteSlab(origin_chunk + slab.chunk_offset, slab, journal);
+    }
+    light_propagator.propagate(true);
+    commitJournal();
+    return changed;
+}
+
+void VoxelWorld::pasteSchematicAsync(std::shared_ptr<const Schematic> schematic, const glm::ivec3 &origin, bool paste_air)
+{
+    PendingPaste paste;
+    paste.origin_chunk = worldToChunk(origin);
+    paste.split = std::make_shared<PasteSplit>();
+    if (isJournaling())
+    {
+        paste.journal = std::make_shared<EditJournal>();
+    }
+
+    if (schematic->hasSlabs(origin, paste_air))
+    {
+        paste.split->slabs = schematic->getSlabs(origin, paste_air);
+        paste.split->ready.store(true, std::memory_order_relaxed);
+    }
+    else
+    {
+        // The job holds the schematic and the split, so neither depends on the world
+        job_system.submit([schematic, origin, paste_air, split = paste.split]
+                          {
+                              split->slabs = schematic->getSlabs(origin, paste_air);
+                              split->ready.store(true, std::memory_order_release); },
+                          JobPriority::Normal);
+    }
+    pending_pastes.push_back(std::move(paste));
+}
+
+void VoxelWorld::processPastes()
+{
+    if (pending_pastes.empty())
+    {
+        return;
+    }
+    PROFILE_ZONE("VoxelWorld::processPastes");
+    size_t budget = MAX_PASTE_SLABS_PER_FRAME;
+    while (budget > 0 && !pending_pastes.empty())
+    {
+        PendingPaste &paste = pending_pastes.front();
+        if (!paste.split->ready.load(std::memory_order_acquire))
+        {
+            break; // Later pastes wait, so overlapping ones land in order
+        }
+
+        const Schematic::Slabs &slabs = *paste.split->slabs;
+        for (; budget > 0 && paste.next_slab < slabs.size(); paste.next_slab++, budget--)
+        {
+            pasteSlab(paste.origin_chunk + slabs[paste.next_slab].chunk_offset, slabs[paste.next_slab], paste.journal.get());
+        }
+        if (paste.next_slab < slabs.size())
+        {
+            break;
+        }
+
+        // Undone as a whole, whatever was edited while it was spread over frames
+        if (paste.journal && edit_journal)
+        {
+            paste.journal->commit();
+            edit_journal->append(*paste.journal);
+        }
+        pending_pastes.pop_front();
+    }
+    light_propagator.propagate(true);
+}
+
+size_t VoxelWorld::pasteSlab(const glm::ivec3 &chunk_pos, const Schematic::Slab &slab, EditJournal *journal)
+{
+    VoxelChunk *chunk = getOrCreateChunk(chunk_pos);
+    if (!chunk)
+    {
+        return 0; // Not received from the server
+    }
+
+    thread_local std::vector<VoxelChange> changes;
+    changes.clear();
+    BorderChanges changed_borders;
+    if (chunk->pasteVoxels(slab.voxels, slab.mask.data(), changed_borders, changes) == 0)
+    {
+        return 0;
+    }
+
+    const glm::ivec3 origin = chunkToWorld(chunk_pos);
+    for (const VoxelChange &change : changes)
+    {
+        const int x = ChunkIndexing::getX(change.index);
+        const int y = ChunkIndexing::getY(change.index);
+        const int z = ChunkIndexing::getZ(change.index);
+        light_propagator.voxelChanged(*chunk, x, y, z);
+        noteVoxelChanged(origin + glm::ivec3(x, y, z), change.previous, change.voxel, journal);
+    }
+    chunk->commitEdits(changed_borders);
+    noteChunkEdited(chunk_pos, *chunk);
+    return changes.size();
+}
+
+VoxelRayHit VoxelWorld::raycast(const VoxelRay &ray) const
+{
+    VoxelAccessor accessor(*this);
+    return traceRay(ray, accessor);
+}
+
+void VoxelWorld::raycast(const std::vector<VoxelRay> &rays, std::vector<VoxelRayHit> &hits) const
+{
+    // One accessor for the batch: rays from nearby origins mostly stay in the same chunks
+    VoxelAccessor accessor(*this);
+    hits.resize(rays.size());
+    for (size_t i = 0; i < rays.size(); i++)
+    {
+        hits[i] = traceRay(rays[i], accessor);
+    }
+}
+
+VoxelSweepResult VoxelWorld::sweepBox(const VoxelSweep &sweep) const
+{
+    VoxelAccessor accessor(*this);
+    return resolveSweep(sweep, accessor);
+}
+
+void VoxelWorld::sweepBoxes(const std::vector<VoxelSweep> &sweeps, std::vector<VoxelSweepResult> &results) const
+{
+    // One accessor for the batch, as for raycasts: entities near each other share chunks
+    VoxelAccessor accessor(*this);
+    results.resize(sweeps.size());
+    for (size_t i = 0; i < sweeps.size(); i++)
+    {
+        results[i] = resolveSweep(sweeps[i], accessor);
+    }
+}
+
+VoxelChunk *VoxelWorld::getChunk(const glm::ivec3 &chunk_pos)
+{
+    // Inside the window the grid is authoritative; the map only serves far-away chunks
+    if (chunk_grid.contains(chunk_pos))
+    {
+        return chunk_grid.get(chunk_pos);
+    }
+
+    auto it = chunks.find(chunk_pos);
+    return (it != chunks.end()) ? it->second.get() : nullptr;
+}
+
+void VoxelWorld::touchChunk(const glm::ivec3 &chunk_pos)
+{
+    if (VoxelChunk *chunk = getChunk(chunk_pos))
+    {
+        chunk->unpack();
     }
 }
 
-VoxelChunk *VoxelWorld::getChunk(const glm::ivec3 &chunk_pos)
+const VoxelChunk *VoxelWorld::getChunk(const glm::ivec3 &chunk_pos) const
 {
+    if (chunk_grid.contains(chunk_pos))
+    {
+        return chunk_grid.get(chunk_pos);
+    }
+
     auto it = chunks.find(chunk_pos);
     return (it != chunks.end()) ? it->second.get() : nullptr;
 }
 
-const VoxelChunk *VoxelWorld::getChunk(const glm::ivec3 &chunk_pos) const
+std::shared_ptr<VoxelChunk> VoxelWorld::getChunkHandle(const glm::ivec3 &chunk_pos) const
 {
     auto it = chunks.find(chunk_pos);
-    return (it != chunks.end()) ? it->second.get() : nullptr;
+    return (it != chunks.end()) ? it->second : nullptr;
 }
 
 VoxelChunk *VoxelWorld::getOrCreateChunk(const glm::ivec3 &chunk_pos)
 {
-    auto it = chunks.find(chunk_pos);
-    if (it != chunks.end())
+    if (VoxelChunk *existing = getChunk(chunk_pos))
+    {
+        return existing;
+    }
+    if (remote_chunks)
     {
-        return it->second.get();
+        return nullptr; // Only the server makes chunks
     }
 
     // Create new chunk
-    auto chunk = std::make_unique<VoxelChunk>(chunk_pos);
-    VoxelChunk *chunk_ptr = chunk.get();
-    chunks[chunk_pos] = std::move(chunk);
+    VoxelChunk *chunk_ptr = storeChunk(acquireChunk(chunk_pos));
 
-    // Generate the chunk
-    chunk_ptr->generate(world_seed);
+    // Saved edits first, generation otherwise
+    if (!restoreChunk(*chunk_ptr))
+    {
+        chunk_ptr->generate(world_seed, &height_cache, getTerrainMode());
+    }
 
     // Update neighbors
     updateChunkNeighbors(chunk_pos);
+    light_propagator.chunkLinked(*chunk_ptr);
 
     return chunk_ptr;
 }
@@ -138,6 +1619,7 @@ void VoxelWorld::loadChunk(const glm::ivec3 &chunk_pos)
     }
 
     getOrCreateChunk(chunk_pos);
+    light_propagator.propagate(false);
 }
 
 void VoxelWorld::unloadChunk(const glm::ivec3 &chunk_pos)
@@ -156,23 +1638,234 @@ void VoxelWorld::unloadChunk(const glm::ivec3 &chunk_pos)
                 int opposite_dir = (i % 2 == 0) ? i + 1 : i - 1;
                 neighbor->setNeighbor(opposite_dir, nullptr);
             }
+            chunk->setNeighbor(i, nullptr);
+        }
+
+        // Written in the background; a reload before the write lands reads the queued copy
+        if (chunk->is_dirty && !remote_chunks)
+        {
+            saveChunk(chunk_pos, *chunk);
         }
+        unsaved_chunks.erase(chunk_pos);
+        fluids->chunkUnloaded(chunk_pos);
+        entities->chunkUnloaded(chunk_pos);
 
+        chunk->mesh_dirty_list = nullptr; // Its list entry goes stale
+        chunk->is_loaded = false;
+        chunk_grid.erase(chunk);
+        grid_outliers.erase(chunk_pos);
+        retired_chunks.push_back(std::move(it->second));
         chunks.erase(it);
     }
 }
 
+void VoxelWorld::setRemoteChunks(bool remote)
+{
+    remote_chunks = remote;
+    if (remote)
+    {
+        chunks_to_load.clear();
+        cancelGenerations();
+    }
+}
+
+bool VoxelWorld::receiveChunk(const glm::ivec3 &chunk_pos, const unsigned char *runs, size_t size)
+{
+    std::shared_ptr<VoxelChunk> chunk = acquireChunk(chunk_pos);
+    if (!chunk->voxels.decodeRuns(runs, size))
+    {
+        recycleChunk(std::move(chunk));
+        return false;
+    }
+    unloadChunk(chunk_pos); // A resent chunk replaces the copy held
+
+    // Same seed as the server, so the noise still predicts the borders not received yet
+    chunk->markRestored(world_seed, &height_cache, getTerrainMode());
+    chunk->pipeline.requested = std::chrono::steady_clock::now();
+    chunk->pipeline.generated = chunk->pipeline.requested;
+    chunk->pipeline.pending = true;
+
+    VoxelChunk *stored = storeChunk(std::move(chunk));
+    linkChunkNeighbors(stored);
+    light_propagator.chunkLinked(*stored);
+    light_propagator.propagate(false);
+    generation_stats.total_generated++;
+    return true;
+}
+
+bool VoxelWorld::restoreChunk(VoxelChunk &chunk)
+{
+    if (!region_storage.load(chunk.position, chunk.voxels))
+    {
+        return false;
+    }
+    chunk.markRestored(world_seed, &height_cache, getTerrainMode());
+    return true;
+}
+
+std::shared_ptr<VoxelChunk> VoxelWorld::acquireChunk(const glm::ivec3 &chunk_pos)
+{
+    std::shared_ptr<VoxelChunk> chunk;
+    {
+        std::unique_lock<std::mutex> lock(chunk_pool_mutex);
+        if (chunk_pool.empty())
+        {
+            chunks_allocated++;
+        }
+        else
+        {
+            chunk = std::move(chunk_pool.back());
+            chunk_pool.pop_back();
+        }
+    }
+
+    if (!chunk)
+    {
+        return std::make_shared<VoxelChunk>(chunk_pos);
+    }
+    chunk->reset(chunk_pos);
+    return chunk;
+}
+
+void VoxelWorld::recycleChunk(std::shared_ptr<VoxelChunk> chunk)
+{
+    // While update runs off the GL thread the render thread may still be drawing the mesh
+    // without the world lock: the whole shell waits for releaseDroppedShells
+    {
+        std::unique_lock<std::mutex> lock(chunk_pool_mutex);
+        if (defer_shell_release)
+        {
+            dropped_shells.push_back(std::move(chunk));
+            return;
+        }
+    }
+    poolChunk(std::move(chunk));
+}
+
+void VoxelWorld::poolChunk(std::shared_ptr<VoxelChunk> chunk)
+{
+    // Arena ranges and CPU geometry go back now; the backend buffer and geometry stay with
+    // the shell so the next mesh built in it refills them in place
+    if (chunk->mesh)
+    {
+        chunk->mesh->recycle();
+    }
+
+    // When the pool is full the shell (and its GL objects) is destroyed here, on the GL thread
+    std::unique_lock<std::mutex> lock(chunk_pool_mutex);
+    if (chunk_pool.size() < MAX_POOLED_CHUNKS)
+    {
+        chunk_pool.push_back(std::move(chunk));
+    }
+}
+
+void VoxelWorld::setDeferShellRelease(bool defer)
+{
+    {
+        std::unique_lock<std::mutex> lock(chunk_pool_mutex);
+        defer_shell_release = defer;
+    }
+    if (!defer)
+    {
+        releaseDroppedShells();
+    }
+}
+
+void VoxelWorld::releaseDroppedShells()
+{
+    std::vector<std::shared_ptr<VoxelChunk>> shells;
+    {
+        std::unique_lock<std::mutex> lock(chunk_pool_mutex);
+        shells.swap(dropped_shells);
+    }
+    // Outside the lock generation jobs take for shells
+    for (std::shared_ptr<VoxelChunk> &shell : shells)
+    {
+        poolChunk(std::move(shell));
+    }
+}
+
+void VoxelWorld::recycleRetiredChunks()
+{
+    // A mesh job or pending upload may still hold an unloaded chunk; it is only reused
+    // once the world holds the last reference
+    size_t kept = 0;
+    for (size_t i = 0; i < retired_chunks.size(); i++)
+    {
+        if (retired_chunks[i].use_count() == 1)
+        {
+            recycleChunk(std::move(retired_chunks[i]));
+        }
+        else
+        {
+            retired_chunks[kept++] = std::move(retired_chunks[i]);
+        }
+    }
+    retired_chunks.resize(kept);
+}
+
 bool VoxelWorld::isChunkLoaded(const glm::ivec3 &chunk_pos) const
 {
-    return chunks.find(chunk_pos) != chunks.end();
+    return getChunk(chunk_pos) != nullptr;
+}
+
+bool VoxelWorld::isChunkPending(const glm::ivec3 &chunk_pos)
+{
+    if (chunks_to_load.contains(chunk_pos))
+    {
+        return true;
+    }
+    return chunks_generating.find(chunk_pos) != chunks_generating.end();
+}
+
+VoxelChunk *VoxelWorld::storeChunk(std::shared_ptr<VoxelChunk> chunk)
+{
+    VoxelChunk *chunk_ptr = chunk.get();
+    chunks[chunk_ptr->position] = std::move(chunk);
+    chunk_ptr->is_loaded = true;
+    implicit_chunks.erase(chunk_ptr->position); // Created by an edit, or brought back by a band
+
+    // Listed once on arrival, whatever its state; later changes list it through markMeshDirty
+    if (mesh_dirty_list_enabled)
+    {
+        chunk_ptr->mesh_dirty_list = &mesh_dirty_chunks;
+        chunk_ptr->is_mesh_listed = true;
+        mesh_dirty_chunks.push_back(chunk_ptr->position);
+    }
+    if (chunk_grid.contains(chunk_ptr->position))
+    {
+        chunk_grid.insert(chunk_ptr);
+    }
+    else
+    {
+        grid_outliers.insert(chunk_ptr->position);
+    }
+    entities->chunkLoaded(chunk_ptr->position);
+    return chunk_ptr;
+}
+
+void VoxelWorld::rebuildChunkGrid()
+{
+    // Re-slot every chunk that falls inside the (moved or resized) window; slots that wrapped
+    // around are overwritten, and stale ones fail the grid's position check
+    chunk_grid.clear();
+    grid_outliers.clear();
+    for (auto &[pos, chunk] : chunks)
+    {
+        if (chunk_grid.contains(pos))
+        {
+            chunk_grid.insert(chunk.get());
+        }
+        else
+        {
+            grid_outliers.insert(pos);
+        }
+    }
 }
 
 glm::ivec3 VoxelWorld::worldToChunk(const glm::ivec3 &world_pos)
 {
-    return glm::ivec3(
-        world_pos.x >= 0 ? world_pos.x / CHUNK_SIZE : (world_pos.x + 1) / CHUNK_SIZE - 1,
-        world_pos.y >= 0 ? world_pos.y / CHUNK_HEIGHT : (world_pos.y + 1) / CHUNK_HEIGHT - 1,
-        world_pos.z >= 0 ? world_pos.z / CHUNK_SIZE : (world_pos.z + 1) / CHUNK_SIZE - 1);
+    return glm::ivec3(world_pos.x >> CHUNK_SIZE_SHIFT, world_pos.y >> CHUNK_HEIGHT_SHIFT, world_pos.z >> CHUNK_SIZE_SHIFT);
 }
 
 glm::ivec3 VoxelWorld::worldToChunk(const glm::vec3 &world_pos)
@@ -182,9 +1875,7 @@ glm::ivec3 VoxelWorld::worldToChunk(const glm::vec3 &world_pos)
 
 glm::ivec3 VoxelWorld::worldToLocal(const glm::ivec3 &world_pos)
 {
-    glm::ivec3 chunk_pos = worldToChunk(world_pos);
-    glm::ivec3 chunk_world_pos = chunkToWorld(chunk_pos);
-    return world_pos - chunk_world_pos;
+    return glm::ivec3(world_pos.x & CHUNK_SIZE_MASK, world_pos.y & CHUNK_HEIGHT_MASK, world_pos.z & CHUNK_SIZE_MASK);
 }
 
 glm::ivec3 VoxelWorld::chunkToWorld(const glm::ivec3 &chunk_pos)
@@ -214,87 +1905,317 @@ void VoxelWorld::updateAllNeighbors()
     }
 }
 
-void VoxelWorld::setRenderDistance(int distance)
+void VoxelWorld::markAllMeshesDirty()
 {
-    render_distance = std::max(1, distance);
-    last_center_chunk = glm::ivec3(INT_MAX); // Force update
+    for (auto &[pos, chunk] : chunks)
+    {
+        chunk->markMeshDirty();
+    }
 }
 
-void VoxelWorld::processChunkLoadingQueue()
+void VoxelWorld::enableMeshDirtyList()
+{
+    if (mesh_dirty_list_enabled)
+    {
+        return;
+    }
+    mesh_dirty_list_enabled = true;
+    for (auto &[pos, chunk] : chunks)
+    {
+        chunk->mesh_dirty_list = &mesh_dirty_chunks;
+        chunk->is_mesh_listed = true;
+        mesh_dirty_chunks.push_back(pos);
+    }
+}
+
+void VoxelWorld::takeMeshDirtyChunks(std::vector<glm::ivec3> &out)
 {
-    // Load a few chunks per frame to avoid frame drops
-    int chunks_to_load_per_frame = 2;
-    int loaded_count = 0;
+    out.insert(out.end(), mesh_dirty_chunks.begin(), mesh_dirty_chunks.end());
+    mesh_dirty_chunks.clear();
+}
 
-    auto it = chunks_to_load.begin();
-    while (it != chunks_to_load.end() && loaded_count < chunks_to_load_per_frame)
+void VoxelWorld::saveChunk(const glm::ivec3 &chunk_pos, VoxelChunk &chunk)
+{
+    if (region_storage.store(chunk_pos, chunk.voxels))
     {
-        loadChunk(*it);
-        it = chunks_to_load.erase(it);
-        loaded_count++;
+        chunk.is_dirty = false; // Until the next edit
     }
 }
 
-void VoxelWorld::processChunkUnloadingQueue()
+void VoxelWorld::saveModifiedChunks()
 {
-    // Unload chunks immediately
-    for (const auto &chunk_pos : chunks_to_unload)
+    for (auto &[pos, chunk] : chunks)
     {
-        unloadChunk(chunk_pos);
+        if (chunk->is_dirty && !remote_chunks)
+        {
+            saveChunk(pos, *chunk);
+        }
     }
-    chunks_to_unload.clear();
+    unsaved_chunks.clear();
+    entities->saveAll();
+}
+
+void VoxelWorld::flushSaves()
+{
+    saveModifiedChunks();
+    region_storage.flush();
+    entities->flush();
 }
 
-std::vector<glm::ivec3> VoxelWorld::getChunksInRange(const glm::ivec3 &center, int range) const
+size_t VoxelWorld::checkpoint()
 {
-    // Structure to hold distance and chunk position with proper comparison
-    struct ChunkDistance
+    PROFILE_ZONE("VoxelWorld::checkpoint");
+    last_checkpoint = Clock::now();
+    if (remote_chunks)
     {
-        float distance;
-        glm::ivec3 position;
+        return 0;
+    }
 
-        // Comparison operator for sorting (nearest first)
-        bool operator<(const ChunkDistance &other) const
+    // Every dirty chunk is tracked here from its first edit until it is saved, so unlike
+    // saveModifiedChunks this never walks the clean ones
+    size_t queued = 0;
+    for (const auto &[chunk_pos, unsaved] : unsaved_chunks)
+    {
+        VoxelChunk *chunk = getChunk(chunk_pos);
+        if (chunk && chunk->is_dirty)
         {
-            return distance < other.distance;
+            saveChunk(chunk_pos, *chunk);
+            queued++;
         }
-    };
+    }
+    unsaved_chunks.clear();
+    entities->saveAll();
+    return queued;
+}
+
+void VoxelWorld::processCheckpoint()
+{
+    if (checkpoint_interval_seconds > 0.0f &&
+        Clock::now() - last_checkpoint >= std::chrono::duration<float>(checkpoint_interval_seconds))
+    {
+        checkpoint();
+    }
+}
+
+void VoxelWorld::processAutosave()
+{
+    if (unsaved_chunks.empty())
+    {
+        return;
+    }
+
+    auto now = Clock::now();
+    auto quiet = std::chrono::duration<float>(autosave_quiet_seconds);
+    auto max_delay = std::chrono::duration<float>(autosave_max_delay_seconds);
+    size_t saved = 0;
+    for (auto it = unsaved_chunks.begin(); it != unsaved_chunks.end() && saved < MAX_AUTOSAVES_PER_FRAME;)
+    {
+        if (now - it->second.last_edit < quiet && now - it->second.first_edit < max_delay)
+        {
+            ++it;
+            continue;
+        }
+
+        VoxelChunk *chunk = getChunk(it->first);
+        if (chunk && chunk->is_dirty)
+        {
+            saveChunk(it->first, *chunk);
+            saved++;
+        }
+        it = unsaved_chunks.erase(it);
+    }
+}
+
+void VoxelWorld::processIdlePacking()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (idle_pack_seconds <= 0.0f ||
+        std::chrono::duration<float>(now - last_idle_scan).count() < IDLE_SCAN_INTERVAL_SECONDS)
+    {
+        return;
+    }
+    last_idle_scan = now;
+
+    // Chunks packed already return at once, so a scan cut short by the budget moves on to
+    // the next ones
+    PROFILE_ZONE("VoxelWorld::processIdlePacking");
+    size_t packed = 0;
+    for (auto &[chunk_pos, chunk] : chunks)
+    {
+        if (chunk->packIfIdle(now, idle_pack_seconds) > 0 && ++packed == MAX_IDLE_PACKS_PER_SCAN)
+        {
+            break;
+        }
+    }
+}
+
+void VoxelWorld::setTerrainDiskCache(bool enabled)
+{
+    terrain_disk_cache_enabled = enabled;
+    height_cache.setDiskStore(enabled ? std::make_shared<HeightTileStore>("cache/terrain/" + std::to_string(world_seed) + "/",
+                                                                          VoxelNoise::getGeneratorHash(world_seed))
+                                      : nullptr);
+}
+
+void VoxelWorld::setRenderDistance(int distance)
+{
+    int previous_distance = render_distance;
+    render_distance = std::max(1, distance);
+    if (render_distance == previous_distance)
+    {
+        return;
+    }
+    implicit_stale = true;
+
+    // Ranges of viewers following the render distance are recounted with the new tables;
+    // chunks still kept survive the unload
+    for (const auto &[viewer, state] : viewers)
+    {
+        if (state.distance == 0)
+        {
+            releaseInterest(state.center, render_tables->load, true);
+            releaseInterest(state.center, render_tables->keep, false);
+        }
+    }
 
-    std::vector<ChunkDistance> chunks_with_distance;
+    height_cache.setCapacity(getHeightCacheCapacity());
+    chunk_grid.resize(getChunkGridRadius(), CHUNK_GRID_LAYER_RADIUS);
+    rebuildChunkGrid();
+    rebuildOffsetTables();
 
-    for (int x = center.x - range; x <= center.x + range; x++)
+    if (streaming_viewers)
     {
-        for (int y = std::max(0, center.y - 2); y <= std::min(7, center.y + 2); y++)
-        { // Limit Y range
-            for (int z = center.z - range; z <= center.z + range; z++)
+        for (const auto &[viewer, state] : viewers)
+        {
+            if (state.distance == 0)
             {
-                glm::ivec3 chunk_pos(x, y, z);
-                glm::ivec3 diff = chunk_pos - center;
+                addInterest(state.center, render_tables->keep, false);
+                addInterest(state.center, render_tables->load, true);
+            }
+        }
+        viewers_moved = true;
+    implicit_stale = true;
+        return;
+    }
+
+    // Before the first update there is no center yet: that update loads everything anyway
+    if (last_center_chunk.x != INT_MAX)
+    {
+        applyRenderDistanceChange(previous_distance);
+    }
+}
 
-                // Use proper distance calculation (Euclidean distance)
-                float distance = std::sqrt(diff.x * diff.x + diff.y * diff.y * 0.25f + diff.z * diff.z);
+void VoxelWorld::applyRenderDistanceChange(int previous_distance)
+{
+    const glm::ivec3 &center_chunk = last_center_chunk;
 
-                // Only include chunks within the circular range
-                if (distance <= range)
-                {
-                    chunks_with_distance.push_back({distance, chunk_pos});
-                }
+    if (render_distance > previous_distance)
+    {
+        // Growing: only the new outer shell is missing, nothing leaves the keep range
+        for (const auto &offset : render_tables->load)
+        {
+            glm::ivec3 chunk_pos = center_chunk + offset;
+            if (isLoadOffset(offset, previous_distance))
+            {
+                continue;
+            }
+            if (needsRequest(chunk_pos))
+            {
+                chunks_to_load.push(chunk_pos, chunkDistance(offset));
             }
         }
+        return;
+    }
+
+    // Shrinking: cancel loads past the new range and unload what is past the new keep range
+    chunks_to_load.eraseIf([&](const glm::ivec3 &chunk_pos)
+                           { return !isLoadOffset(chunk_pos - center_chunk); });
+    cancelGenerations([&](const glm::ivec3 &chunk_pos)
+                      { return !isLoadOffset(chunk_pos - center_chunk); });
+
+    // A resize is rare, so one pass over the loaded set is fine here
+    chunks_to_unload.clear();
+    for (const auto &[chunk_pos, chunk] : chunks)
+    {
+        if (!isKeepOffset(chunk_pos - center_chunk))
+        {
+            chunks_to_unload.push_back(chunk_pos);
+        }
+    }
+}
+
+size_t VoxelWorld::getHeightCacheCapacity() const
+{
+    // One window per viewer, widened by the block alignment of batched misses; overlapping
+    // viewers just leave some of it unused
+    const size_t batch_margin = 2 * (HeightFieldCache::TILE_BATCH - 1);
+    size_t side = static_cast<size_t>(2 * (getChunkGridRadius() + 1) + 1) + batch_margin;
+    size_t capacity = viewers.empty() ? side * side : 0;
+    for (const auto &[viewer, state] : viewers)
+    {
+        size_t viewer_side = state.distance > 0 ? static_cast<size_t>(2 * (state.distance + 3) + 1) + batch_margin : side;
+        capacity += viewer_side * viewer_side;
+    }
+    return capacity;
+}
+
+void VoxelWorld::processChunkLoadingQueue()
+{
+    if (remote_chunks)
+    {
+        chunks_to_load.clear();
+        return;
     }
 
-    // Sort chunks by distance (nearest first)
-    std::sort(chunks_with_distance.begin(), chunks_with_distance.end());
+    // Start a task per request, nearest first, keeping only a short backlog in the job system
+    // so the rest can still be re-prioritized cheaply by a center change. Cancelled tasks
+    // count until their worker skips them, so the backlog stays bounded.
+    const size_t max_queued_requests = job_system.getWorkerCount() * 4;
+    auto now = Clock::now();
+    while (!chunks_to_load.empty() && generation_jobs_outstanding < max_queued_requests)
+    {
+        std::chrono::steady_clock::time_point load_requested_at;
+        glm::ivec3 chunk_pos = chunks_to_load.pop(&load_requested_at); // Nearest to the current center
+        if (isChunkLoaded(chunk_pos) || chunks_generating.find(chunk_pos) != chunks_generating.end())
+        {
+            continue;
+        }
+
+        // Sky or rock out of sight: no chunk and no job. A saved copy may hold edits, so it
+        // is restored like any other.
+        VoxelID predicted = predictUniformSection(chunk_pos);
+        if (predicted != VOXEL_NONE && isImplicitSection(chunk_pos, predicted) && !region_storage.contains(chunk_pos))
+        {
+            implicit_chunks[chunk_pos] = predicted;
+            generation_stats.total_implicit++;
+            continue;
+        }
+
+        CancelToken token;
+        chunks_generating.emplace(chunk_pos, token);
+        generation_jobs_outstanding++;
+        streamChunk({chunk_pos, now, load_requested_at}, token);
+    }
+}
 
-    // Extract just the chunk positions in distance order
-    std::vector<glm::ivec3> result;
-    result.reserve(chunks_with_distance.size());
-    for (const auto &chunk_data : chunks_with_distance)
+void VoxelWorld::processChunkUnloadingQueue()
+{
+    if (remote_chunks)
     {
-        result.push_back(chunk_data.position);
+        chunks_to_unload.clear(); // The server unloads
+        return;
     }
 
-    return result;
+    // Unload chunks immediately
+    for (const auto &chunk_pos : chunks_to_unload)
+    {
+        if (streaming_viewers && isViewerKept(chunk_pos))
+        {
+            continue; // Released by one viewer and wanted again by another since
+        }
+        unloadChunk(chunk_pos);
+    }
+    chunks_to_unload.clear();
 }
 
 void VoxelWorld::linkChunkNeighbors(VoxelChunk *chunk)
@@ -328,6 +2249,13 @@ void VoxelWorld::linkChunkNeighbors(VoxelChunk *chunk)
         {
             int opposite_dir = (i % 2 == 0) ? i + 1 : i - 1;
             neighbor->setNeighbor(opposite_dir, chunk);
+
+            // Its mesh may have guessed this chunk's border; remesh only if the guess was wrong
+            if (neighbor->predicted_faces & (1u << opposite_dir))
+            {
+                generation_stats.predicted_faces_checked++;
+                generation_stats.predicted_faces_wrong += neighbor->verifyPredictedFace(opposite_dir) ? 1 : 0;
+            }
         }
     }
 }
@@ -3,65 +3,437 @@
 
 #include "voxel_types.h"
 #include "voxel_chunk.h"
+#include "chunk_grid.h"
+#include "chunk_load_queue.h"
+#include "height_field_cache.h"
+#include "job_system.h"
+#include "coroutine_task.h"
+#include "region_storage.h"
+#include "voxel_light.h"
+#include "schematic.h"
 #include <glm/glm/glm.hpp>
+#include <atomic>
 #include <unordered_map>
 #include <memory>
 #include <vector>
 #include <functional>
+#include <deque>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <climits>
 
 // Forward declarations
 class Camera;
+class FluidSimulator;
+class EntityStore;
+class EditJournal;
 
 // Hash function for glm::ivec3 to use as key in unordered_map
+// (per-axis prime multipliers plus a final mix, so neighboring coordinates do not collide)
 struct Vec3Hash
 {
     std::size_t operator()(const glm::ivec3 &v) const
     {
-        std::size_t h1 = std::hash<int>{}(v.x);
-        std::size_t h2 = std::hash<int>{}(v.y);
-        std::size_t h3 = std::hash<int>{}(v.z);
-        return h1 ^ (h2 << 1) ^ (h3 << 2);
+        uint64_t h = static_cast<uint64_t>(static_cast<uint32_t>(v.x)) * 0x9E3779B185EBCA87ull;
+        h ^= static_cast<uint64_t>(static_cast<uint32_t>(v.y)) * 0xC2B2AE3D27D4EB4Full;
+        h ^= static_cast<uint64_t>(static_cast<uint32_t>(v.z)) * 0x165667B19E3779F9ull;
+        h ^= h >> 29;
+        return static_cast<std::size_t>(h);
     }
 };
 
+// Statistics for the asynchronous generation pipeline (all times in milliseconds)
+struct ChunkGenerationStats
+{
+    size_t queued = 0;           // Requests waiting for a generation worker
+    size_t in_flight = 0;        // Requests currently being generated
+    size_t awaiting_insert = 0;  // Finished chunks waiting for the main thread
+    uint64_t total_generated = 0;
+    uint64_t total_discarded = 0; // Finished chunks that left range before insertion
+    uint64_t total_implicit = 0;  // Finished uniform sections left implicit instead (VoxelWorld::implicit_chunks)
+    size_t implicit_chunks = 0;   // Positions implicit right now
+    uint64_t total_restored = 0;  // Of total_generated, read back from region files instead
+    uint64_t predicted_faces_checked = 0; // Predicted mesh borders compared once the neighbor arrived
+    uint64_t predicted_faces_wrong = 0;   // Of those, remeshed because the prediction was off
+    size_t pending_saves = 0;     // Edited chunks queued for writing
+    size_t unsaved_chunks = 0;    // Edited chunks waiting out the autosave window
+
+    float avg_queue_wait_ms = 0.0f; // Request -> worker picked it up
+    float avg_generate_ms = 0.0f;   // VoxelChunk::generate on the worker
+    float avg_handoff_ms = 0.0f;    // Worker finished -> inserted by the main thread
+    float max_generate_ms = 0.0f;
+    float last_integrate_ms = 0.0f; // Main thread time spent inserting/linking last frame
+
+    size_t pooled_chunks = 0;      // Recycled shells ready for reuse
+    size_t retired_chunks = 0;     // Unloaded chunks still referenced by mesh jobs
+    uint64_t chunks_allocated = 0; // Shells created because the pool was empty (since last sample)
+
+    size_t height_tiles = 0;         // Column height tiles currently cached
+    uint64_t height_tile_hits = 0;   // Since last sample
+    uint64_t height_tile_misses = 0; // Tiles filled since last sample
+    uint64_t height_tiles_loaded = 0; // Of those, read from the disk cache instead of generated
+};
+
+// One voxel write of a batch (VoxelWorld::applyEdits), in world coordinates
+struct VoxelEdit
+{
+    glm::ivec3 position;
+    VoxelID voxel;
+};
+
+// Ray for VoxelWorld::raycast; direction need not be normalized, distances are along it in
+// world units
+struct VoxelRay
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+    float max_distance;
+};
+
+struct VoxelRayHit
+{
+    bool hit = false;
+    glm::ivec3 position{0};   // Voxel hit
+    glm::ivec3 normal{0};     // Face entered through, so position + normal is the voxel in front
+    float distance = 0.0f;    // To the entry point (0 when the origin starts inside the voxel)
+    VoxelID voxel = VOXEL_AIR;
+};
+
+// Box moved by VoxelWorld::sweepBox, in world units: voxel (x, y, z) fills [x, x + 1) on each
+// axis, so a box resting on it has min.y == y + 1
+struct VoxelSweep
+{
+    glm::vec3 min;
+    glm::vec3 max;
+    glm::vec3 motion; // Wanted displacement this step
+};
+
+struct VoxelSweepResult
+{
+    glm::vec3 motion{0.0f};   // Displacement that stays clear of solid voxels
+    uint8_t blocked_axes = 0; // Bit per axis (x 1, y 2, z 4) whose motion a voxel cut short
+    bool on_ground = false;   // Blocked moving down
+};
+
 class VoxelWorld
 {
 public:
-    using ChunkMap = std::unordered_map<glm::ivec3, std::unique_ptr<VoxelChunk>, Vec3Hash>;
+    // Shared so mesh jobs can hold a chunk past its unload; the world only drops its reference
+    using ChunkMap = std::unordered_map<glm::ivec3, std::shared_ptr<VoxelChunk>, Vec3Hash>;
+    using Clock = std::chrono::high_resolution_clock;
 
 private:
-    ChunkMap chunks;
+    ChunkMap chunks;      // Owns every loaded chunk
+    ChunkGrid chunk_grid; // O(1) lookup window around last_center_chunk
     uint32_t world_seed;
     int render_distance;
     glm::ivec3 last_center_chunk;
 
+    // Terrain heights per chunk column, shared by generation jobs (thread-safe)
+    HeightFieldCache height_cache;
+    bool terrain_disk_cache_enabled = false;
+    std::atomic<TerrainMode> terrain_mode{TerrainMode::Heightmap}; // Read by generation jobs
+
     // Chunk loading/unloading queues
-    std::vector<glm::ivec3> chunks_to_load;
+    ChunkLoadQueue<Vec3Hash> chunks_to_load; // Keyed by distance to the current center
     std::vector<glm::ivec3> chunks_to_unload;
+    float integrate_budget_ms = 2.0f;       // Main-thread time for inserting finished chunks per frame
+
+    // Loaded chunks outside the grid window (e.g. edited far away); checked on every move
+    std::unordered_set<glm::ivec3, Vec3Hash> grid_outliers;
+
+    // The load range reaches LOAD_LAYERS up and down, but away from the viewers only the
+    // sections that hold terrain are kept: a uniform section of air above every viewer's band,
+    // or of opaque rock below it, is never seen and stays implicit. Its position and voxel are
+    // remembered instead of the chunk (neighbors predict it as terrain), and it is requested
+    // again once a band reaches it. Where the column heights already show a section is
+    // uniform (predictUniformSection), it goes implicit without a chunk or a generation job.
+    static constexpr int VIEWER_BAND_LAYERS = 2; // Layers above and below a viewer always stored
+    std::unordered_map<glm::ivec3, VoxelID, Vec3Hash> implicit_chunks;
+    bool implicit_stale = false; // A viewer changed layer or range since the last refresh
+    int implicit_band_low = INT_MIN; // Viewer layers at the last refresh
+    int implicit_band_high = INT_MIN;
+
+    // Relights edits and newly linked chunks (main thread only)
+    LightPropagator light_propagator;
+
+    // Flowing water around edits, ticked from update (main thread only)
+    std::unique_ptr<FluidSimulator> fluids;
+
+    // Mobs and dropped items, saved and unloaded with their chunks (main thread only)
+    std::unique_ptr<EntityStore> entities;
+
+    // Offsets that enter the load range / leave the keep range for a one-chunk center move
+    struct ShellDelta
+    {
+        std::vector<glm::ivec3> entering;     // Relative to the new center
+        std::vector<glm::ivec3> leaving;      // Relative to the old center
+        std::vector<glm::ivec3> load_leaving; // Load offsets of the old center no longer wanted
+        std::vector<glm::ivec3> keep_entering; // Keep offsets of the new center not kept before
+    };
+
+    // Offsets from a center chunk for one range distance, nearest first
+    struct RangeTables
+    {
+        int distance = 0;
+        std::vector<glm::ivec3> load; // Load range (distance <= distance, LOAD_LAYERS up and down)
+        std::vector<glm::ivec3> keep; // Keep range (distance <= distance + 1.5)
+        std::unordered_map<glm::ivec3, ShellDelta, Vec3Hash> shells; // By move, built on first use
+    };
+    // The render distance's tables plus one set per viewer distance in use; dropped once unused
+    std::unordered_map<int, std::unique_ptr<RangeTables>> range_tables;
+    RangeTables *render_tables = nullptr;
+
+    // Streaming around viewers (addViewer): how many viewers have a chunk in their load and
+    // keep ranges. A chunk is requested when its load count leaves 0 and unloaded once its
+    // keep count drops back to 0.
+    struct ChunkInterest
+    {
+        uint32_t load = 0;
+        uint32_t keep = 0;
+    };
+    bool streaming_viewers = false; // Set by the first addViewer; update's center is unused then
+
+    // Chunks arrive from a server (receiveChunk) instead of being generated or read back
+    bool remote_chunks = false;
+    std::function<void(const glm::ivec3 &, VoxelID)> edit_listener;
+    EditJournal *edit_journal = nullptr; // Not owned
+    bool journal_edits = true;           // Off while water flows and the journal is being applied
+
+    // Structure pastes spread over frames (pasteSchematicAsync), applied in order
+    struct PasteSplit // Filled by a job when the schematic has no split for the origin yet
+    {
+        std::atomic<bool> ready{false};
+        std::shared_ptr<const Schematic::Slabs> slabs;
+    };
+    struct PendingPaste
+    {
+        glm::ivec3 origin_chunk;
+        std::shared_ptr<PasteSplit> split;
+        size_t next_slab = 0;
+        std::shared_ptr<EditJournal> journal; // The paste's changes, one operation once done
+    };
+    std::deque<PendingPaste> pending_pastes;
+    static constexpr size_t MAX_PASTE_SLABS_PER_FRAME = 8; // Each is a chunk repack and its relighting
+    std::unordered_map<glm::ivec3, ChunkInterest, Vec3Hash> chunk_interest;
+    struct Viewer
+    {
+        glm::ivec3 center; // Chunk it stands in
+        int distance;      // Range distance, 0 follows the render distance
+    };
+    std::unordered_map<uint32_t, Viewer> viewers;
+    uint32_t next_viewer_id = 1;
+    uint32_t grid_viewer = 0;   // The grid window follows this viewer; around the others chunks are outliers
+    uint32_t center_viewer = 0; // update's center once other viewers are added
+    bool viewers_moved = false; // Queued load priorities need the nearest viewer recomputed
+
+    // Async generation pipeline: one streamChunk task per requested chunk, generated (or
+    // read back) on a worker, then integrated on the main thread
+    struct GenerationRequest
+    {
+        glm::ivec3 position;
+        Clock::time_point requested_at;
+        std::chrono::steady_clock::time_point load_requested_at; // Entered chunks_to_load
+    };
+
+    struct GenerationResult
+    {
+        glm::ivec3 position;
+        std::shared_ptr<VoxelChunk> chunk;
+        bool restored = false; // Loaded from region storage rather than generated
+        Clock::time_point requested_at;
+        Clock::time_point started_at;
+        Clock::time_point finished_at;
+    };
+
+    JobSystem &job_system;
+    RegionStorage region_storage; // Edited chunks, saved on unload and read back before generating
+
+    // Autosave: edited chunks are saved once they have been left alone for the quiet window,
+    // or at the latest max delay after their first unsaved edit, so a burst of placements
+    // in one chunk is written once
+    struct UnsavedChunk
+    {
+        uint64_t version;             // Chunk version after the last edit seen
+        Clock::time_point first_edit; // Oldest unsaved edit
+        Clock::time_point last_edit;
+    };
+    std::unordered_map<glm::ivec3, UnsavedChunk, Vec3Hash> unsaved_chunks;
+    float autosave_quiet_seconds = 2.0f;
+    float autosave_max_delay_seconds = 10.0f;
+    static constexpr size_t MAX_AUTOSAVES_PER_FRAME = 16; // Each is a storage copy on the main thread
+
+    // Periodic checkpoints (see checkpoint); 0 leaves saving to the autosave
+    float checkpoint_interval_seconds = 0.0f;
+    Clock::time_point last_checkpoint = Clock::now();
+
+    // Idle residency: loaded chunks left alone this long have their voxels and light packed
+    // (VoxelChunk::packIfIdle) while their meshes keep drawing; 0 turns it off
+    float idle_pack_seconds = 30.0f;
+    static constexpr float IDLE_SCAN_INTERVAL_SECONDS = 1.0f;
+    static constexpr size_t MAX_IDLE_PACKS_PER_SCAN = 64; // Each encodes a chunk on the main thread
+    std::chrono::steady_clock::time_point last_idle_scan{};
+    // Positions with a live task and the token that cancels it (main thread only). A
+    // cancelled task leaves the map at once, so the position can be requested again.
+    std::unordered_map<glm::ivec3, CancelToken, Vec3Hash> chunks_generating;
+    MainThreadQueue main_thread_tasks;                   // Generated chunks waiting to be integrated
+    std::atomic<size_t> generation_jobs_outstanding{0}; // Tasks not done on their worker yet
+    std::atomic<size_t> generation_in_flight{0};        // Of those, generating right now
+    size_t generation_tasks = 0;                         // Live tasks (main thread only)
+
+    // Running latency sums, reset whenever stats are sampled
+    ChunkGenerationStats generation_stats;
+    double queue_wait_sum_ms = 0.0;
+    double generate_sum_ms = 0.0;
+    double handoff_sum_ms = 0.0;
+    uint64_t latency_samples = 0;
+
+    // Recycled chunk shells. Unloaded chunks wait in retired_chunks until no mesh job holds
+    // them, then have their mesh recycled on the GL thread (GL objects kept) and join the
+    // pool; generation jobs reset and refill them instead of allocating new chunks.
+    static constexpr size_t MAX_POOLED_CHUNKS = 256; // Extra shells are destroyed
+    std::vector<std::shared_ptr<VoxelChunk>> retired_chunks; // Main thread only
+    std::vector<glm::ivec3> mesh_dirty_chunks;                // Main thread only, see takeMeshDirtyChunks
+    bool mesh_dirty_list_enabled = false;
+    std::vector<std::shared_ptr<VoxelChunk>> chunk_pool;
+    std::vector<std::shared_ptr<VoxelChunk>> dropped_shells; // Not yet recycled, see setDeferShellRelease
+    bool defer_shell_release = false;
+    std::mutex chunk_pool_mutex; // Guards chunk_pool, dropped_shells and chunks_allocated
+    uint64_t chunks_allocated = 0;
 
 public:
-    explicit VoxelWorld(uint32_t seed, int render_distance = 8);
+    VoxelWorld(uint32_t seed, JobSystem &job_system, int render_distance = 8);
     ~VoxelWorld();
 
     // World management
     void update(const glm::vec3 &center_position);
     void updateChunksAroundPosition(const glm::vec3 &position);
 
+    // While update runs off the GL thread (SimulationThread), recycled shells are kept as they
+    // are instead of pooled or destroyed where they are dropped, since the render thread may
+    // still draw their meshes and a mesh may own GL objects; releaseDroppedShells recycles
+    // their meshes and pools or destroys them on the GL thread. Turning it off releases them too.
+    void setDeferShellRelease(bool defer);
+    void releaseDroppedShells();
+
+    // Streaming around several viewers instead of one center (e.g. the players of a dedicated
+    // server, spectator cameras, portals). The loaded set is the union of their load ranges,
+    // reference counted per chunk: a chunk stays while any viewer keeps it and loads by its
+    // distance to the nearest viewer. A viewer's distance of 0 follows the render distance.
+    // Moves only count the shells of one-chunk steps, whatever the number of viewers.
+    // Without update, call updateViewers every tick; with it, update's center becomes one more
+    // viewer once another is added and update keeps moving it.
+    uint32_t addViewer(const glm::vec3 &position, int distance = 0);
+    void moveViewer(uint32_t viewer, const glm::vec3 &position);
+    void setViewerDistance(uint32_t viewer, int distance);
+    void removeViewer(uint32_t viewer);
+    void updateViewers();
+    size_t getViewerCount() const { return viewers.size(); }
+
+    // Client of a server (see ChunkStreamClient), set before the first update: nothing is
+    // generated, restored, saved or unloaded by range any more; chunks only come through
+    // receiveChunk and go through unloadChunk. receiveChunk takes a PaletteStorage run encoding
+    // and sends the chunk down the path a generated one takes (linking, light, meshing),
+    // replacing a loaded one; false if the payload is malformed.
+    void setRemoteChunks(bool remote);
+    bool isRemoteChunks() const { return remote_chunks; }
+    bool receiveChunk(const glm::ivec3 &chunk_pos, const unsigned char *runs, size_t size);
+
+    // Called for every voxel an edit changed, whichever call made it (main thread)
+    void setEditListener(std::function<void(const glm::ivec3 &position, VoxelID voxel)> listener)
+    {
+        edit_listener = std::move(listener);
+    }
+
+    // Edit history (null detaches): every voxel an edit call changes is recorded in the
+    // journal, one operation per setVoxel, applyEdits or fill call. Flowing water is not
+    // recorded, nor are undo, redo and replay themselves.
+    void setEditJournal(EditJournal *journal) { edit_journal = journal; }
+    EditJournal *getEditJournal() const { return edit_journal; }
+    // Write back the journal's last operation / apply the one undone last, through applyEdits
+    // (one remesh per chunk, light once); false if there is none
+    bool undoEdit();
+    bool redoEdit();
+    // Apply every operation of a journal in order, e.g. one loaded from a file onto the
+    // world it was recorded in, regenerated; chunks it touches are created like applyEdits
+    // does. Returns the number of voxels changed.
+    size_t replayEdits(const EditJournal &journal);
+
     // Voxel access
     VoxelID getVoxel(int x, int y, int z) const;
     VoxelID getVoxel(const glm::ivec3 &pos) const;
+    // Copy an inclusive box into out, x-major with z innermost whatever the chunk layout
+    // (((x * size_y) + y) * size_z + z relative to min_corner); unloaded chunks read as air
+    void getVoxels(const glm::ivec3 &min_corner, const glm::ivec3 &max_corner, std::vector<VoxelID> &out) const;
+    // Edits relight incrementally around the changed voxels (see LightPropagator) and wake
+    // the water next to them (see FluidSimulator)
     void setVoxel(int x, int y, int z, VoxelID voxel);
     void setVoxel(const glm::ivec3 &pos, VoxelID voxel);
 
+    // Batch edits: grouped by chunk, so each touched chunk is looked up (or created) once,
+    // bumps its version once and is flagged for one remesh; neighbors are only flagged when
+    // their shared border changed. Light is propagated once for the whole batch. Return the
+    // number of voxels that changed.
+    size_t applyEdits(const std::vector<VoxelEdit> &edits); // Later edits of a position win
+    size_t fillBox(const glm::ivec3 &min_corner, const glm::ivec3 &max_corner, VoxelID voxel); // Inclusive
+    size_t fillSphere(const glm::vec3 &center, float radius, VoxelID voxel); // Voxel centers within radius
+    // Paste a structure with its minimum corner at origin, one bulk write per chunk it
+    // covers (see Schematic); air voxels of the structure are skipped unless paste_air.
+    // Chunks are created like applyEdits does; one journal operation, light once.
+    size_t pasteSchematic(const Schematic &schematic, const glm::ivec3 &origin, bool paste_air = false);
+    // The same spread over frames: update applies a few chunks of the oldest paste per frame,
+    // splitting on a job first when the schematic has no split for the origin. Journaled as
+    // one operation when the paste finishes.
+    void pasteSchematicAsync(std::shared_ptr<const Schematic> schematic, const glm::ivec3 &origin,
+                             bool paste_air = false);
+    size_t getPendingPasteCount() const { return pending_pastes.size(); }
+
+    // First non-air voxel along the ray (Amanatides-Woo voxel traversal, each voxel crossed
+    // visited once); unloaded chunks are treated as air
+    VoxelRayHit raycast(const VoxelRay &ray) const;
+    void raycast(const std::vector<VoxelRay> &rays, std::vector<VoxelRayHit> &hits) const; // hits[i] for rays[i]
+
+    // Move a box against solid voxels (isVoxelSolid), an axis at a time (y, then x, then z),
+    // each stopping at the first solid layer of the volume it sweeps; a box touching a
+    // voxel face does not collide with it. Only the voxels of the swept volume are tested,
+    // as bits per chunk row (VoxelChunk::getSolidRows); unloaded chunks block (see
+    // VoxelAccessor::anySolid). Main thread.
+    VoxelSweepResult sweepBox(const VoxelSweep &sweep) const;
+    void sweepBoxes(const std::vector<VoxelSweep> &sweeps, std::vector<VoxelSweepResult> &results) const; // results[i] for sweeps[i]
+
     // Chunk access
     VoxelChunk *getChunk(const glm::ivec3 &chunk_pos);
     const VoxelChunk *getChunk(const glm::ivec3 &chunk_pos) const;
+    std::shared_ptr<VoxelChunk> getChunkHandle(const glm::ivec3 &chunk_pos) const; // For work that may outlive the chunk's stay
+    // Unpacks an idle-packed chunk (VoxelChunk::unpack) ahead of per-voxel reads; nothing if
+    // not loaded
+    void touchChunk(const glm::ivec3 &chunk_pos);
+    // Generates missing chunks on the spot; their light link is queued for the caller's next
+    // light_propagator.propagate (edits and loadChunk run it)
     VoxelChunk *getOrCreateChunk(const glm::ivec3 &chunk_pos);
 
     // Chunk management
     void loadChunk(const glm::ivec3 &chunk_pos);
     void unloadChunk(const glm::ivec3 &chunk_pos);
     bool isChunkLoaded(const glm::ivec3 &chunk_pos) const;
+    // In range but left implicit (uniform sky or rock away from the viewers, never stored)
+    bool isChunkImplicit(const glm::ivec3 &chunk_pos) const { return implicit_chunks.count(chunk_pos) != 0; }
+    VoxelID getImplicitVoxel(const glm::ivec3 &chunk_pos) const; // VOXEL_NONE if not implicit
+    size_t getImplicitChunkCount() const { return implicit_chunks.size(); }
+    // Queued to load or being generated, i.e. it will show up without another request
+    bool isChunkPending(const glm::ivec3 &chunk_pos);
+
+    // Range tests for a chunk offset from a center at a render distance. The world has no
+    // height limit; the load range reaches LOAD_LAYERS above and below the center, the keep
+    // range one more.
+    static constexpr int LOAD_LAYERS = 7;
+    static bool isLoadOffset(const glm::ivec3 &offset, int distance);
+    static bool isKeepOffset(const glm::ivec3 &offset, int distance);
+    static float chunkDistance(const glm::ivec3 &offset);
+    // Load range offsets at the current render distance, nearest first
+    const std::vector<glm::ivec3> &getLoadOffsets() const { return render_tables->load; }
 
     // Coordinate conversion
     static glm::ivec3 worldToChunk(const glm::ivec3 &world_pos);
@@ -73,21 +445,136 @@ public:
     void updateChunkNeighbors(const glm::ivec3 &chunk_pos);
     void updateAllNeighbors();
 
+    // Force every loaded chunk to be remeshed (e.g. after switching mesher)
+    void markAllMeshesDirty();
+
+    // Positions of the chunks stored or flagged with markMeshDirty since the last call,
+    // appended to out; each chunk is listed once until the caller clears its is_mesh_listed.
+    // Entries can be stale (chunk unloaded) or repeat a position (unloaded and loaded again).
+    // Off until enabled (worlds nobody meshes would only grow the list); enabling lists every
+    // loaded chunk.
+    void enableMeshDirtyList();
+    void takeMeshDirtyChunks(std::vector<glm::ivec3> &out);
+
+    // Queue every loaded chunk with unsaved edits for writing (also done on destruction)
+    void saveModifiedChunks();
+    // Save everything and wait for the writes; call while the job system is still running
+    void flushSaves();
+    // Consistent cut of the edited state for crash recovery: every chunk whose version moved
+    // since it was last saved and every entity bucket with changes, queued for writing in one
+    // main thread call. Linear in the chunks edited since the previous save, each a storage
+    // copy whose words stay shared until the next edit (see PaletteStorage); encoding and
+    // writing happen on the region writers. Returns the chunks queued.
+    size_t checkpoint();
+
     // Getters
     const ChunkMap &getChunks() const { return chunks; }
     int getRenderDistance() const { return render_distance; }
     uint32_t getSeed() const { return world_seed; }
+    HeightFieldCache &getHeightFieldCache() { return height_cache; } // Thread-safe
+    FluidSimulator &getFluidSimulator() { return *fluids; }
+    EntityStore &getEntities() { return *entities; }
+    const EntityStore &getEntities() const { return *entities; }
     size_t getLoadedChunkCount() const { return chunks.size(); }
+    size_t getPooledChunkBytes(); // Recycled shells, their kept meshes included
+
+    // Generation pipeline statistics; averages cover the period since the previous call
+    ChunkGenerationStats getGenerationStats();
 
     // Settings
     void setRenderDistance(int distance);
+    // Keep generated height tiles on disk (cache/terrain/<seed>/) for later sessions; on by default
+    void setTerrainDiskCache(bool enabled);
+    bool isTerrainDiskCacheEnabled() const { return terrain_disk_cache_enabled; }
+    // For chunks generated from now on; set it before the first update for a consistent world
+    void setTerrainMode(TerrainMode mode) { terrain_mode.store(mode, std::memory_order_relaxed); }
+    TerrainMode getTerrainMode() const { return terrain_mode.load(std::memory_order_relaxed); }
+    void setIntegrateBudget(float milliseconds) { integrate_budget_ms = std::max(0.1f, milliseconds); }
+    float getIntegrateBudget() const { return integrate_budget_ms; }
+    void setAutosaveDelay(float quiet_seconds, float max_seconds)
+    {
+        autosave_quiet_seconds = std::max(0.0f, quiet_seconds);
+        autosave_max_delay_seconds = std::max(autosave_quiet_seconds, max_seconds);
+    }
+    size_t getPendingLoadCount() const { return chunks_to_load.size(); }
+    void setIdlePackDelay(float seconds) { idle_pack_seconds = std::max(0.0f, seconds); }
+    // Take a checkpoint from update every seconds; 0 turns it off
+    void setCheckpointInterval(float seconds) { checkpoint_interval_seconds = std::max(0.0f, seconds); }
 
 private:
     // Internal helper functions
+    void processPipeline(); // Everything update does after moving the center
     void processChunkLoadingQueue();
     void processChunkUnloadingQueue();
-    std::vector<glm::ivec3> getChunksInRange(const glm::ivec3 &center, int range) const;
+    void processAutosave();
+    void processCheckpoint();
+    void processIdlePacking();
+    void saveChunk(const glm::ivec3 &chunk_pos, VoxelChunk &chunk);
+    void noteChunkEdited(const glm::ivec3 &chunk_pos, const VoxelChunk &chunk); // Autosave tracking
+    // Water, the edit listener and the journal
+    void noteVoxelChanged(const glm::ivec3 &position, VoxelID previous, VoxelID voxel, EditJournal *journal);
+    void commitJournal();
+    bool isJournaling() const { return edit_journal && journal_edits; }
+    EditJournal *getRecordingJournal() const { return isJournaling() ? edit_journal : nullptr; }
+    // One slab of a paste into its chunk; returns the voxels changed (light not propagated)
+    size_t pasteSlab(const glm::ivec3 &chunk_pos, const Schematic::Slab &slab, EditJournal *journal);
+    void processPastes();
+    template <typename Inside>
+    size_t fillRegion(const glm::ivec3 &min_corner, const glm::ivec3 &max_corner, VoxelID voxel, Inside inside);
+    void integrateGeneratedChunks();
+    void integrateGeneratedChunk(GenerationResult &result); // Main thread, within integrateGeneratedChunks
+    // Cancel the tasks of chunks no longer wanted (all of them without a predicate)
+    void cancelGenerations(const std::function<bool(const glm::ivec3 &)> &unwanted = nullptr);
+    bool isWithinLoadRange(const glm::ivec3 &chunk_pos) const;
+    Task streamChunk(GenerationRequest request, CancelToken token);
+    bool restoreChunk(VoxelChunk &chunk); // Any thread; false if nothing is saved there
+    std::shared_ptr<VoxelChunk> acquireChunk(const glm::ivec3 &chunk_pos); // Any thread
+    void recycleChunk(std::shared_ptr<VoxelChunk> chunk);                  // Main thread
+    void poolChunk(std::shared_ptr<VoxelChunk> chunk);                     // GL thread
+    void recycleRetiredChunks();
+
+    // Center-change handling: full rescan for jumps, shell deltas for one-chunk moves
+    void rebuildOffsetTables(); // For the render distance; drops tables no viewer uses
+    RangeTables &getRangeTables(int distance);
+    RangeTables &getViewerTables(const Viewer &viewer)
+    {
+        return viewer.distance > 0 ? getRangeTables(viewer.distance) : *render_tables;
+    }
+    static const ShellDelta &getShellDelta(RangeTables &tables, const glm::ivec3 &delta);
+    void updateChunkSetsFull();
+    // Not loaded, generating or implicit: a load request would bring something new
+    bool needsRequest(const glm::ivec3 &chunk_pos) const
+    {
+        return !isChunkLoaded(chunk_pos) && chunks_generating.find(chunk_pos) == chunks_generating.end() &&
+               !isChunkImplicit(chunk_pos);
+    }
+    // Lowest and highest layer a viewer (or update's center) stands in; false if none does
+    bool getViewerLayers(int &low, int &high) const;
+    // A uniform section of this voxel at chunk_pos is out of every viewer's sight (see implicit_chunks)
+    bool isImplicitSection(const glm::ivec3 &chunk_pos, VoxelID voxel) const;
+    // The voxel filling the section at chunk_pos if the resident height tiles of its column
+    // and the eight around it (trees included) show it is uniform, else VOXEL_NONE. Height
+    // field terrain only; no noise work.
+    VoxelID predictUniformSection(const glm::ivec3 &chunk_pos);
+    // Drop implicit positions that left range; request those a viewer's band now reaches
+    void refreshImplicitChunks();
+    void updateChunkSetsIncremental(const glm::ivec3 &previous_center, const glm::ivec3 &delta);
+    bool isLoadOffset(const glm::ivec3 &offset) const { return isLoadOffset(offset, render_distance); }
+    bool isKeepOffset(const glm::ivec3 &offset) const { return isKeepOffset(offset, render_distance); }
+    void applyRenderDistanceChange(int previous_distance); // Around the current center
+    // Viewer interest around a chunk: offsets are the load or keep table entries to count
+    void addInterest(const glm::ivec3 &center, const std::vector<glm::ivec3> &offsets, bool load);
+    void releaseInterest(const glm::ivec3 &center, const std::vector<glm::ivec3> &offsets, bool load);
+    bool isViewerKept(const glm::ivec3 &chunk_pos) const;
+    float nearestViewerDistance(const glm::ivec3 &chunk_pos) const;
+    uint32_t registerViewer(const glm::ivec3 &center_chunk, int distance);
+    void centerGridOnViewer(uint32_t viewer);
     void linkChunkNeighbors(VoxelChunk *chunk);
+    VoxelChunk *storeChunk(std::shared_ptr<VoxelChunk> chunk);
+    void rebuildChunkGrid();
+    int getChunkGridRadius() const { return render_distance + 2; } // Covers the unload hysteresis
+    static constexpr int CHUNK_GRID_LAYER_RADIUS = LOAD_LAYERS + 2;
+    size_t getHeightCacheCapacity() const; // Grid window plus the border ring generation reads
 };
 
 #endif // VOXEL_WORLD_H
@@ -0,0 +1,994 @@
+// Headless generation and meshing benchmark.
+//
+// Generates a fixed block of chunk columns for one seed, relights it (per chunk, then across
+// the links between chunks) and meshes every chunk with each mesher and mesh format. Chunk
+// storage order is a build setting (VOXEL_CHUNK_LAYOUT): results record it, so runs of
+// builds with different layouts can be compared, and so is the instruction set of the mesher's occupancy kernel
+// (VOXEL_SIMD). Nothing touches OpenGL (meshes are built but never uploaded), so
+// this runs without a window or GL context. Results go to a JSON or CSV file for comparing
+// runs; the same seed and chunk count always generate the same terrain.
+//
+// --stress SECONDS runs a soak test instead: a full VoxelWorld streams around an observer
+// that flies at --speed blocks/s, teleports to a random spot every --teleport seconds and
+// applies --edits random voxel edits per second in batches, in real time. Every --sample
+// seconds it records chunk counts, queue depths, the world's memory and the process's
+// resident size, generation throughput and the p99 request-to-generated latency. It fails
+// if the second half of the run peaks at more memory than the first half allows
+// (STRESS_MEMORY_GROWTH) or generates markedly slower (STRESS_THROUGHPUT_DROP). Edits are
+// saved like the game's, under saves/<seed>/ (seed STRESS_SEED unless --seed is given).
+// GPU memory is not covered: nothing is uploaded.
+//
+// --verify checks correctness instead of timing. It digests the linked block's voxels, light,
+// face connectivity and meshes (every mesher and format) in coordinate order, so the digests
+// do not depend on the chunk layout, and writes them to --output. With --against, the digests
+// must equal those of an earlier --verify run, e.g. of a build with another VOXEL_CHUNK_LAYOUT.
+// Every chunk also makes a stream round trip (ChunkProtocol's ChunkData and ChunkDelta), which
+// must give back the same voxels and delta coordinates. Any mismatch fails the run.
+//
+// Usage: voxel_bench [--seed N] [--columns N] [--repeat N] [--csv] [--output path]
+//        voxel_bench --stress SECONDS [--seed N] [--distance N] [--speed N] [--teleport SECONDS]
+//                    [--edits N] [--sample SECONDS] [--csv] [--output path]
+//        voxel_bench --verify [--seed N] [--columns N] [--against path] [--output path]
+
+#include "voxel world/voxel_chunk.h"
+#include "voxel world/chunk_mesh.h"
+#include "voxel world/chunk_snapshot.h"
+#include "voxel world/chunk_occupancy.h"
+#include "voxel world/voxel_types.h"
+#include "voxel world/voxel_light.h"
+#include "voxel world/height_field_cache.h"
+#include "voxel world/latency_histogram.h"
+#include "voxel world/voxel_world.h"
+#include "voxel world/job_system.h"
+#include "voxel world/chunk_protocol.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+// Every heap allocation in the process is counted, so suites report what they allocate
+namespace
+{
+std::atomic<uint64_t> allocation_count{0};
+std::atomic<uint64_t> allocation_bytes{0};
+}
+
+void *operator new(std::size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *memory = std::malloc(size ? size : 1))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace
+{
+struct BenchOptions
+{
+    uint32_t seed = 12345;
+    int columns = 8; // Side of the square block of chunk columns
+    int repeat = 3;  // Meshing passes per variant (best one is reported)
+    bool csv = false;
+    std::string output = "voxel_bench.json";
+    bool seed_given = false;
+
+    // Stress mode (stress_seconds > 0)
+    float stress_seconds = 0.0f;
+    int distance = 8;
+    float speed = 100.0f;           // Blocks per second
+    float teleport_seconds = 30.0f;
+    float edits_per_second = 2000.0f;
+    float sample_seconds = 10.0f;
+
+    // Verify mode
+    bool verify = false;
+    std::string against; // Digest file to match, empty to only write one
+};
+
+struct BenchResult
+{
+    std::string suite;
+    size_t chunks = 0;
+    double seconds = 0.0;
+    size_t vertices = 0;
+    size_t faces = 0;
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+    LatencyHistogram chunk_ms; // Per-chunk time, for the tail the averages hide
+
+    double chunksPerSecond() const { return seconds > 0.0 ? chunks / seconds : 0.0; }
+    double nsPerVoxel() const { return chunks ? seconds * 1e9 / (static_cast<double>(chunks) * CHUNK_VOLUME) : 0.0; }
+    double verticesPerChunk() const { return chunks ? static_cast<double>(vertices) / chunks : 0.0; }
+};
+
+bool parseOptions(int argc, char **argv, BenchOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--seed" && has_value)
+        {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            options.seed_given = true;
+        }
+        else if (arg == "--columns" && has_value)
+        {
+            options.columns = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--repeat" && has_value)
+        {
+            options.repeat = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--csv")
+        {
+            options.csv = true;
+        }
+        else if (arg == "--output" && has_value)
+        {
+            options.output = argv[++i];
+        }
+        else if (arg == "--stress" && has_value)
+        {
+            options.stress_seconds = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else if (arg == "--distance" && has_value)
+        {
+            options.distance = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--speed" && has_value)
+        {
+            options.speed = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else if (arg == "--teleport" && has_value)
+        {
+            options.teleport_seconds = std::max(1.0f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else if (arg == "--edits" && has_value)
+        {
+            options.edits_per_second = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else if (arg == "--sample" && has_value)
+        {
+            options.sample_seconds = std::max(1.0f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else if (arg == "--verify")
+        {
+            options.verify = true;
+        }
+        else if (arg == "--against" && has_value)
+        {
+            options.against = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Usage: voxel_bench [--seed N] [--columns N] [--repeat N] [--csv] [--output path]\n"
+                         "       voxel_bench --stress SECONDS [--seed N] [--distance N] [--speed N] [--teleport SECONDS]\n"
+                         "                   [--edits N] [--sample SECONDS] [--csv] [--output path]\n"
+                         "       voxel_bench --verify [--seed N] [--columns N] [--against path] [--output path]"
+                      << std::endl;
+            return false;
+        }
+    }
+    if (options.stress_seconds > 0.0f && options.output == "voxel_bench.json")
+    {
+        options.output = options.csv ? "voxel_stress.csv" : "voxel_stress.json";
+    }
+    else if (options.verify && options.output == "voxel_bench.json")
+    {
+        options.output = "voxel_verify.txt";
+    }
+    return true;
+}
+
+// Chunks of the block, stored x-major then layer then z
+class ChunkBlock
+{
+public:
+    explicit ChunkBlock(int columns) : columns(columns) {}
+
+    size_t index(int x, int y, int z) const { return (static_cast<size_t>(x) * TERRAIN_LAYERS + y) * columns + z; }
+
+    VoxelChunk *find(const glm::ivec3 &pos) const
+    {
+        if (pos.x < 0 || pos.z < 0 || pos.x >= columns || pos.z >= columns || pos.y < 0 || pos.y >= TERRAIN_LAYERS)
+        {
+            return nullptr;
+        }
+        return chunks[index(pos.x, pos.y, pos.z)].get();
+    }
+
+    const int columns;
+    std::vector<std::shared_ptr<VoxelChunk>> chunks;
+};
+
+BenchResult runGeneration(const BenchOptions &options, ChunkBlock &block)
+{
+    HeightFieldCache heights(options.seed, static_cast<size_t>(options.columns + 2) * (options.columns + 2));
+
+    BenchResult result;
+    result.suite = "generate";
+    uint64_t allocations_before = allocation_count.load();
+    uint64_t bytes_before = allocation_bytes.load();
+    auto start = std::chrono::steady_clock::now();
+
+    block.chunks.resize(static_cast<size_t>(options.columns) * TERRAIN_LAYERS * options.columns);
+    for (int x = 0; x < options.columns; x++)
+    {
+        for (int y = 0; y < TERRAIN_LAYERS; y++)
+        {
+            for (int z = 0; z < options.columns; z++)
+            {
+                auto chunk_start = std::chrono::steady_clock::now();
+                auto chunk = std::make_shared<VoxelChunk>(glm::ivec3(x, y, z));
+                chunk->generate(options.seed, &heights);
+                block.chunks[block.index(x, y, z)] = std::move(chunk);
+                result.chunk_ms.record(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - chunk_start).count());
+            }
+        }
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.allocations = allocation_count.load() - allocations_before;
+    result.allocated_bytes = allocation_bytes.load() - bytes_before;
+    result.chunks = block.chunks.size();
+
+    // Link neighbors like VoxelWorld does, so meshing reads real border voxels
+    for (const auto &chunk : block.chunks)
+    {
+        for (int dir = 0; dir < 6; dir++)
+        {
+            chunk->setNeighbor(dir, block.find(chunk->position + FACE_NORMALS[dir]));
+        }
+    }
+    return result;
+}
+
+// Best of repeat passes over every chunk; flood is the timed part of a pass, prepare runs first
+template <typename Prepare, typename Flood>
+BenchResult runLightPasses(const BenchOptions &options, const ChunkBlock &block, const char *suite, Prepare &&prepare,
+                           Flood &&flood)
+{
+    BenchResult best;
+    best.suite = suite;
+    for (int pass = 0; pass < options.repeat; pass++)
+    {
+        prepare();
+        BenchResult result = best;
+        result.chunks = block.chunks.size();
+        uint64_t allocations_before = allocation_count.load();
+        uint64_t bytes_before = allocation_bytes.load();
+        auto start = std::chrono::steady_clock::now();
+        flood();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.allocations = allocation_count.load() - allocations_before;
+        result.allocated_bytes = allocation_bytes.load() - bytes_before;
+
+        if (pass == 0 || result.seconds < best.seconds)
+        {
+            best = result;
+        }
+    }
+    return best;
+}
+
+// Each chunk's own light (done by generation too, timed alone here)
+BenchResult runChunkLight(const BenchOptions &options, ChunkBlock &block)
+{
+    return runLightPasses(
+        options, block, "light/chunk", [] {},
+        [&]
+        {
+            for (const auto &chunk : block.chunks)
+            {
+                LightPropagator::computeChunk(*chunk);
+            }
+        });
+}
+
+// Light crossing the borders as every chunk joins the block, like streaming into the world
+BenchResult runLinkLight(const BenchOptions &options, ChunkBlock &block)
+{
+    LightPropagator propagator;
+    return runLightPasses(
+        options, block, "light/link",
+        [&]
+        {
+            for (const auto &chunk : block.chunks)
+            {
+                LightPropagator::computeChunk(*chunk);
+            }
+        },
+        [&]
+        {
+            for (const auto &chunk : block.chunks)
+            {
+                propagator.chunkLinked(*chunk);
+            }
+            propagator.propagate(false);
+        });
+}
+
+BenchResult runMeshing(const BenchOptions &options, const std::vector<std::unique_ptr<ChunkSnapshot>> &snapshots,
+                       MeshingMode mode, MeshFormat format)
+{
+    ChunkMesh::setMeshingMode(mode);
+    ChunkMesh::setMeshFormat(format);
+
+    BenchResult best;
+    best.suite = std::string("mesh/") + getMeshingModeName(mode) + "/" + getMeshFormatName(format);
+    for (int pass = 0; pass < options.repeat; pass++)
+    {
+        BenchResult result = best;
+        result.chunks = snapshots.size();
+        result.vertices = 0;
+        result.faces = 0;
+        result.chunk_ms.clear();
+
+        uint64_t allocations_before = allocation_count.load();
+        uint64_t bytes_before = allocation_bytes.load();
+        auto start = std::chrono::steady_clock::now();
+        for (const auto &snapshot : snapshots)
+        {
+            // A fresh mesh per chunk like the renderer's mesh jobs; its buffers go back to the pool
+            auto chunk_start = std::chrono::steady_clock::now();
+            ChunkMesh mesh;
+            mesh.buildMesh(*snapshot);
+            result.vertices += mesh.vertex_count;
+            result.faces += mesh.face_count;
+            result.chunk_ms.record(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - chunk_start).count());
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.allocations = allocation_count.load() - allocations_before;
+        result.allocated_bytes = allocation_bytes.load() - bytes_before;
+
+        if (pass == 0 || result.seconds < best.seconds)
+        {
+            best = result;
+        }
+    }
+    return best;
+}
+
+bool writeResults(const BenchOptions &options, const std::vector<BenchResult> &results)
+{
+    std::ofstream out(options.output, std::ios::trunc);
+    if (!out)
+    {
+        std::cerr << "Failed to open " << options.output << std::endl;
+        return false;
+    }
+
+    if (options.csv)
+    {
+        const char *layout = getChunkAxisOrderName(ChunkAxisOrder::VOXEL_CHUNK_LAYOUT);
+        out << "layout,suite,chunks,seconds,chunks_per_s,ns_per_voxel,vertices_per_chunk,faces,allocations,allocated_bytes,"
+               "chunk_p50_ms,chunk_p99_ms,chunk_max_ms\n";
+        for (const BenchResult &result : results)
+        {
+            out << layout << "," << result.suite << "," << result.chunks << "," << result.seconds << "," << result.chunksPerSecond() << ","
+                << result.nsPerVoxel() << "," << result.verticesPerChunk() << "," << result.faces << ","
+                << result.allocations << "," << result.allocated_bytes << "," << result.chunk_ms.getPercentile(0.50f) << ","
+                << result.chunk_ms.getPercentile(0.99f) << "," << result.chunk_ms.getMax() << "\n";
+        }
+    }
+    else
+    {
+        out << "{\n  \"seed\": " << options.seed << ",\n  \"columns\": " << options.columns << ",\n  \"repeat\": "
+            << options.repeat << ",\n  \"layout\": \"" << getChunkAxisOrderName(ChunkAxisOrder::VOXEL_CHUNK_LAYOUT)
+            << "\",\n  \"simd\": \"" << getOccupancyKernelName() << "\",\n  \"results\": [";
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const BenchResult &result = results[i];
+            out << (i ? "," : "") << "\n    {\"suite\": \"" << result.suite << "\", \"chunks\": " << result.chunks
+                << ", \"seconds\": " << result.seconds << ", \"chunks_per_s\": " << result.chunksPerSecond()
+                << ", \"ns_per_voxel\": " << result.nsPerVoxel() << ", \"vertices_per_chunk\": " << result.verticesPerChunk()
+                << ", \"faces\": " << result.faces << ", \"allocations\": " << result.allocations
+                << ", \"allocated_bytes\": " << result.allocated_bytes << ", \"chunk_ms\": {\"p50\": "
+                << result.chunk_ms.getPercentile(0.50f) << ", \"p99\": " << result.chunk_ms.getPercentile(0.99f)
+                << ", \"max\": " << result.chunk_ms.getMax() << "}}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    if (!out)
+    {
+        std::cerr << "Failed to write " << options.output << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Stress mode
+constexpr uint32_t STRESS_SEED = 424242;         // Keeps its saves apart from the game's default world
+constexpr float STRESS_TICK_SECONDS = 1.0f / 60.0f;
+constexpr float STRESS_MEMORY_GROWTH = 0.15f;     // Second-half peak over first-half peak
+constexpr float STRESS_THROUGHPUT_DROP = 0.5f;    // Second-half median chunks/s below the first half's
+constexpr int STRESS_EDIT_BATCH = 64;             // Voxels per applyEdits call
+constexpr int STRESS_EDIT_SPAN = 8;               // Side of the box a batch lands in
+constexpr float STRESS_TELEPORT_RANGE = 20000.0f; // Blocks from the origin
+constexpr float STRESS_FLY_HEIGHT = 100.0f;
+
+struct StressSample
+{
+    double seconds = 0.0;
+    size_t loaded_chunks = 0;
+    size_t pending_loads = 0;
+    size_t queued = 0;
+    size_t in_flight = 0;
+    size_t awaiting_insert = 0;
+    size_t pending_saves = 0;
+    size_t pooled_chunks = 0;
+    size_t world_bytes = 0;    // Loaded chunks (VoxelChunk::getMemoryUsage) and pooled shells
+    size_t resident_bytes = 0; // 0 where the platform does not report it
+    double generated_per_second = 0.0;
+    float latency_p99_ms = 0.0f; // Load requested -> generated or restored, this sample
+    uint64_t edits = 0;          // Voxels changed this sample
+};
+
+size_t getResidentBytes()
+{
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0;
+    size_t resident = 0;
+    if (statm >> pages >> resident)
+    {
+        return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    return 0;
+}
+
+// Random edits in a box near the observer: stone, air and water, so fluids run as well
+size_t applyRandomEdits(VoxelWorld &world, const glm::vec3 &observer, std::mt19937 &rng, std::vector<VoxelEdit> &batch)
+{
+    const float reach = static_cast<float>(world.getRenderDistance() * CHUNK_SIZE) * 0.5f;
+    std::uniform_real_distribution<float> horizontal(-reach, reach);
+    std::uniform_int_distribution<int> height(0, TERRAIN_LAYERS * CHUNK_HEIGHT - STRESS_EDIT_SPAN);
+    std::uniform_int_distribution<int> offset(0, STRESS_EDIT_SPAN - 1);
+    const VoxelID voxels[] = {VOXEL_AIR, VOXEL_STONE, VOXEL_WATER};
+    std::uniform_int_distribution<int> voxel(0, 2);
+
+    glm::ivec3 corner(static_cast<int>(std::floor(observer.x + horizontal(rng))), height(rng),
+                      static_cast<int>(std::floor(observer.z + horizontal(rng))));
+    if (rng() % 8 == 0)
+    {
+        // Dig now and then: whole runs of chunks change at once
+        return world.fillSphere(glm::vec3(corner) + glm::vec3(STRESS_EDIT_SPAN * 0.5f), STRESS_EDIT_SPAN * 0.5f, VOXEL_AIR);
+    }
+    batch.clear();
+    for (int i = 0; i < STRESS_EDIT_BATCH; i++)
+    {
+        batch.push_back({corner + glm::ivec3(offset(rng), offset(rng), offset(rng)), voxels[voxel(rng)]});
+    }
+    return world.applyEdits(batch);
+}
+
+// generated_before: total generated at the previous sample, moved on to this one's
+StressSample sampleWorld(VoxelWorld &world, double seconds, LatencyHistogram &latency, uint64_t &generated_before,
+                         float sample_seconds)
+{
+    // Streamed chunks not timed yet; nothing draws them here, so they are marked done
+    for (const auto &[chunk_pos, chunk] : world.getChunks())
+    {
+        if (chunk->pipeline.pending)
+        {
+            if (chunk->pipeline.generated > chunk->pipeline.requested) // Equal for chunks created by edits
+            {
+                latency.record(std::chrono::duration<float, std::milli>(chunk->pipeline.generated - chunk->pipeline.requested).count());
+            }
+            chunk->pipeline.pending = false;
+        }
+    }
+
+    ChunkGenerationStats generation = world.getGenerationStats();
+    StressSample sample;
+    sample.seconds = seconds;
+    sample.loaded_chunks = world.getLoadedChunkCount();
+    sample.pending_loads = world.getPendingLoadCount();
+    sample.queued = generation.queued;
+    sample.in_flight = generation.in_flight;
+    sample.awaiting_insert = generation.awaiting_insert;
+    sample.pending_saves = generation.pending_saves;
+    sample.pooled_chunks = generation.pooled_chunks;
+    sample.world_bytes = world.getPooledChunkBytes();
+    for (const auto &[chunk_pos, chunk] : world.getChunks())
+    {
+        sample.world_bytes += chunk->getMemoryUsage();
+    }
+    sample.resident_bytes = getResidentBytes();
+    sample.generated_per_second = (generation.total_generated - generated_before) / sample_seconds;
+    generated_before = generation.total_generated;
+    sample.latency_p99_ms = latency.getPercentile(0.99f);
+    return sample;
+}
+
+// The stress verdict: false (with the reason on stderr) if memory or throughput drifted
+bool checkStressSamples(const std::vector<StressSample> &samples)
+{
+    // The first sample holds the initial load; fewer than two per half says nothing
+    if (samples.size() < 5)
+    {
+        std::cout << "Stress: too few samples to judge the trend" << std::endl;
+        return true;
+    }
+    const size_t middle = 1 + (samples.size() - 1) / 2;
+    auto peak = [&](size_t first, size_t last, size_t StressSample::*field)
+    {
+        size_t value = 0;
+        for (size_t i = first; i < last; i++)
+        {
+            value = std::max(value, samples[i].*field);
+        }
+        return value;
+    };
+    auto median = [&](size_t first, size_t last)
+    {
+        std::vector<double> values;
+        for (size_t i = first; i < last; i++)
+        {
+            values.push_back(samples[i].generated_per_second);
+        }
+        std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+        return values[values.size() / 2];
+    };
+
+    bool passed = true;
+    // Resident size sees what the world's own accounting misses (fragmentation, leaks)
+    size_t StressSample::*memory = samples.back().resident_bytes ? &StressSample::resident_bytes : &StressSample::world_bytes;
+    size_t first_peak = peak(1, middle, memory);
+    size_t second_peak = peak(middle, samples.size(), memory);
+    if (second_peak > first_peak * (1.0 + STRESS_MEMORY_GROWTH))
+    {
+        std::cerr << "Stress: memory kept growing, peak " << first_peak / (1024 * 1024) << " MB in the first half, "
+                  << second_peak / (1024 * 1024) << " MB in the second" << std::endl;
+        passed = false;
+    }
+    double first_rate = median(1, middle);
+    double second_rate = median(middle, samples.size());
+    if (second_rate < first_rate * (1.0 - STRESS_THROUGHPUT_DROP))
+    {
+        std::cerr << "Stress: generation slowed down, median " << first_rate << " chunks/s in the first half, "
+                  << second_rate << " in the second" << std::endl;
+        passed = false;
+    }
+    return passed;
+}
+
+bool writeStressSamples(const BenchOptions &options, const std::vector<StressSample> &samples, bool passed)
+{
+    std::ofstream out(options.output, std::ios::trunc);
+    if (!out)
+    {
+        std::cerr << "Failed to open " << options.output << std::endl;
+        return false;
+    }
+
+    if (options.csv)
+    {
+        out << "seconds,loaded_chunks,pending_loads,queued,in_flight,awaiting_insert,pending_saves,pooled_chunks,world_bytes,"
+               "resident_bytes,generated_per_s,latency_p99_ms,edits\n";
+        for (const StressSample &sample : samples)
+        {
+            out << sample.seconds << "," << sample.loaded_chunks << "," << sample.pending_loads << "," << sample.queued << ","
+                << sample.in_flight << "," << sample.awaiting_insert << "," << sample.pending_saves << ","
+                << sample.pooled_chunks << "," << sample.world_bytes << "," << sample.resident_bytes << ","
+                << sample.generated_per_second << "," << sample.latency_p99_ms << "," << sample.edits << "\n";
+        }
+    }
+    else
+    {
+        out << "{\n  \"seed\": " << options.seed << ",\n  \"distance\": " << options.distance << ",\n  \"seconds\": "
+            << options.stress_seconds << ",\n  \"passed\": " << (passed ? "true" : "false") << ",\n  \"samples\": [";
+        for (size_t i = 0; i < samples.size(); i++)
+        {
+            const StressSample &sample = samples[i];
+            out << (i ? "," : "") << "\n    {\"seconds\": " << sample.seconds << ", \"loaded_chunks\": " << sample.loaded_chunks
+                << ", \"pending_loads\": " << sample.pending_loads << ", \"queued\": " << sample.queued
+                << ", \"in_flight\": " << sample.in_flight << ", \"awaiting_insert\": " << sample.awaiting_insert
+                << ", \"pending_saves\": " << sample.pending_saves << ", \"pooled_chunks\": " << sample.pooled_chunks
+                << ", \"world_bytes\": " << sample.world_bytes << ", \"resident_bytes\": " << sample.resident_bytes
+                << ", \"generated_per_s\": " << sample.generated_per_second << ", \"latency_p99_ms\": "
+                << sample.latency_p99_ms << ", \"edits\": " << sample.edits << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    if (!out)
+    {
+        std::cerr << "Failed to write " << options.output << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int runStress(BenchOptions options)
+{
+    if (!options.seed_given)
+    {
+        options.seed = STRESS_SEED;
+    }
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<float> teleport(-STRESS_TELEPORT_RANGE, STRESS_TELEPORT_RANGE);
+    std::uniform_real_distribution<float> heading(0.0f, 6.2831853f);
+
+    std::vector<StressSample> samples;
+    {
+        JobSystem job_system(JobSystemConfig{0, 1, true});
+        VoxelWorld world(options.seed, job_system, options.distance);
+
+        glm::vec3 observer(0.0f, STRESS_FLY_HEIGHT, 0.0f);
+        glm::vec3 direction(1.0f, 0.0f, 0.0f);
+        std::vector<VoxelEdit> batch;
+        LatencyHistogram latency;
+        uint64_t generated_before = 0;
+        uint64_t edits = 0;
+        float edit_budget = 0.0f;
+
+        const auto start = std::chrono::steady_clock::now();
+        auto next_tick = start;
+        double next_teleport = 0.0;
+        double next_sample = options.sample_seconds;
+        std::cout << "Stress: " << options.stress_seconds << " s at distance " << options.distance << ", seed "
+                  << options.seed << " (saves under saves/" << options.seed << "/)" << std::endl;
+        while (true)
+        {
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (elapsed >= options.stress_seconds)
+            {
+                break;
+            }
+
+            if (elapsed >= next_teleport)
+            {
+                next_teleport += options.teleport_seconds;
+                observer = glm::vec3(teleport(rng), STRESS_FLY_HEIGHT, teleport(rng));
+                float angle = heading(rng);
+                direction = glm::vec3(std::cos(angle), 0.0f, std::sin(angle));
+            }
+            observer += direction * options.speed * STRESS_TICK_SECONDS;
+            world.update(observer);
+
+            edit_budget += options.edits_per_second * STRESS_TICK_SECONDS;
+            while (edit_budget >= STRESS_EDIT_BATCH)
+            {
+                edit_budget -= STRESS_EDIT_BATCH;
+                edits += applyRandomEdits(world, observer, rng, batch);
+            }
+
+            if (elapsed >= next_sample)
+            {
+                next_sample += options.sample_seconds;
+                StressSample sample = sampleWorld(world, elapsed, latency, generated_before, options.sample_seconds);
+                sample.edits = edits;
+                latency.clear();
+                edits = 0;
+                std::cout << "Stress " << static_cast<int>(elapsed) << " s: " << sample.loaded_chunks << " chunks, "
+                          << sample.pending_loads + sample.queued << " queued, " << sample.world_bytes / (1024 * 1024)
+                          << " MB world, " << sample.resident_bytes / (1024 * 1024) << " MB resident, "
+                          << sample.generated_per_second << " chunks/s, p99 " << sample.latency_p99_ms << " ms" << std::endl;
+                samples.push_back(sample);
+            }
+
+            next_tick += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<float>(STRESS_TICK_SECONDS));
+            std::this_thread::sleep_until(next_tick);
+        }
+
+        // Saves are written by jobs, so they go before the workers stop
+        world.flushSaves();
+        job_system.shutdown();
+    }
+
+    bool passed = checkStressSamples(samples);
+    if (!writeStressSamples(options, samples, passed))
+    {
+        return 1;
+    }
+    std::cout << "Stress " << (passed ? "passed" : "FAILED") << ", samples written to " << options.output << std::endl;
+    return passed ? 0 : 1;
+}
+
+// Verify mode
+constexpr int VERIFY_DELTA_STEP = 7; // Every 7th column of a chunk goes into its round-trip delta
+
+// FNV-1a over values fed in a fixed order
+struct Digest
+{
+    uint64_t value = 14695981039346656037ull;
+
+    void add(uint64_t data)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            value = (value ^ ((data >> (i * 8)) & 0xFF)) * 1099511628211ull;
+        }
+    }
+};
+
+// Mesh contents regardless of quad order: the sum of the mixed vertices, and their count
+uint64_t digestVertices(const std::vector<VoxelVertex> &vertices)
+{
+    uint64_t sum = vertices.size();
+    for (const VoxelVertex &vertex : vertices)
+    {
+        uint64_t mixed = (vertex.data + 0x9E3779B97F4A7C15ull) * 0xBF58476D1CE4E5B9ull;
+        sum += mixed ^ (mixed >> 31);
+    }
+    return sum;
+}
+
+// Named digests, one "name value" line each
+using VerifyDigests = std::vector<std::pair<std::string, uint64_t>>;
+
+VerifyDigests digestBlock(const ChunkBlock &block)
+{
+    Digest voxels;
+    Digest light;
+    Digest connectivity;
+    for (const auto &chunk : block.chunks)
+    {
+        for (int x = 0; x < VoxelChunk::SIZE; x++)
+        {
+            for (int y = 0; y < VoxelChunk::HEIGHT; y++)
+            {
+                for (int z = 0; z < VoxelChunk::SIZE; z++)
+                {
+                    int index = VoxelChunk::coordsToIndex(x, y, z);
+                    voxels.add(chunk->voxels.get(index));
+                    light.add(chunk->light.get(index));
+                }
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<ChunkSnapshot>> snapshots;
+    for (const auto &chunk : block.chunks)
+    {
+        snapshots.push_back(std::make_unique<ChunkSnapshot>(chunk));
+    }
+    VerifyDigests digests = {{"voxels", voxels.value}, {"light", light.value}};
+    for (int format = 0; format < static_cast<int>(MeshFormat::Count); format++)
+    {
+        for (int mode = 0; mode < static_cast<int>(MeshingMode::Count); mode++)
+        {
+            ChunkMesh::setMeshingMode(static_cast<MeshingMode>(mode));
+            ChunkMesh::setMeshFormat(static_cast<MeshFormat>(format));
+            Digest meshes;
+            for (const auto &snapshot : snapshots)
+            {
+                ChunkMesh mesh;
+                mesh.buildMesh(*snapshot);
+                meshes.add(digestVertices(mesh.vertices));
+                if (mode == 0 && format == 0)
+                {
+                    connectivity.add(mesh.face_connectivity);
+                }
+            }
+            digests.emplace_back(std::string("mesh/") + getMeshingModeName(static_cast<MeshingMode>(mode)) + "/" +
+                                     getMeshFormatName(static_cast<MeshFormat>(format)),
+                                 meshes.value);
+        }
+    }
+    digests.emplace_back("connectivity", connectivity.value);
+    return digests;
+}
+
+// Every chunk through ChunkData and a ChunkDelta and back; false at the first mismatch
+bool verifyStreamRoundTrip(const ChunkBlock &block)
+{
+    std::vector<unsigned char> bytes;
+    std::vector<ChunkDeltaEdit> edits;
+    std::vector<glm::ivec3> edited;
+    PaletteStorage received(CHUNK_VOLUME);
+    for (const auto &chunk : block.chunks)
+    {
+        bytes.clear();
+        ChunkProtocol::writeChunkData(bytes, chunk->position, 1, chunk->voxels);
+        size_t offset = 0;
+        ChunkProtocol::Message message;
+        if (ChunkProtocol::readMessage(bytes.data(), bytes.size(), offset, message) != ChunkProtocol::ReadStatus::Ok ||
+            message.type != StreamMessage::ChunkData || message.position != chunk->position ||
+            !received.decodeRuns(message.runs, message.runs_size))
+        {
+            std::cerr << "Stream round trip: chunk (" << chunk->position.x << ", " << chunk->position.y << ", "
+                      << chunk->position.z << ") does not decode" << std::endl;
+            return false;
+        }
+        for (int i = 0; i < CHUNK_VOLUME; i++)
+        {
+            if (received.get(i) != chunk->voxels.get(i))
+            {
+                std::cerr << "Stream round trip: chunk (" << chunk->position.x << ", " << chunk->position.y << ", "
+                          << chunk->position.z << ") differs at index " << i << std::endl;
+                return false;
+            }
+        }
+
+        // Deltas carry coordsToIndex indices: they have to land on the same coordinates
+        edits.clear();
+        edited.clear();
+        for (int column = 0; column < VoxelChunk::SIZE * VoxelChunk::SIZE; column += VERIFY_DELTA_STEP)
+        {
+            glm::ivec3 local(column / VoxelChunk::SIZE, column % VoxelChunk::HEIGHT, column % VoxelChunk::SIZE);
+            edits.push_back({static_cast<uint16_t>(VoxelChunk::coordsToIndex(local.x, local.y, local.z)),
+                             static_cast<VoxelID>(column % VOXEL_COUNT)});
+            edited.push_back(local);
+        }
+        bytes.clear();
+        ChunkProtocol::writeChunkDelta(bytes, chunk->position, 1, 2, edits);
+        offset = 0;
+        if (ChunkProtocol::readMessage(bytes.data(), bytes.size(), offset, message) != ChunkProtocol::ReadStatus::Ok ||
+            message.type != StreamMessage::ChunkDelta || message.edits.size() != edits.size())
+        {
+            std::cerr << "Stream round trip: delta of chunk (" << chunk->position.x << ", " << chunk->position.y
+                      << ", " << chunk->position.z << ") does not decode" << std::endl;
+            return false;
+        }
+        for (size_t i = 0; i < edits.size(); i++)
+        {
+            const ChunkDeltaEdit &edit = message.edits[i];
+            glm::ivec3 local(ChunkIndexing::getX(edit.index), ChunkIndexing::getY(edit.index), ChunkIndexing::getZ(edit.index));
+            if (local != edited[i] || edit.voxel != edits[i].voxel)
+            {
+                std::cerr << "Stream round trip: delta edit " << i << " of chunk (" << chunk->position.x << ", "
+                          << chunk->position.y << ", " << chunk->position.z << ") lands elsewhere" << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool readDigests(const std::string &path, VerifyDigests &digests)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+    std::string name;
+    std::string value;
+    while (in >> name >> value)
+    {
+        digests.emplace_back(name, std::strtoull(value.c_str(), nullptr, 16));
+    }
+    return true;
+}
+
+int runVerify(const BenchOptions &options)
+{
+    ChunkBlock block(options.columns);
+    runGeneration(options, block);
+    LightPropagator propagator;
+    for (const auto &chunk : block.chunks)
+    {
+        LightPropagator::computeChunk(*chunk);
+    }
+    for (const auto &chunk : block.chunks)
+    {
+        propagator.chunkLinked(*chunk);
+    }
+    propagator.propagate(false);
+
+    bool passed = verifyStreamRoundTrip(block);
+    VerifyDigests digests = digestBlock(block);
+
+    if (!options.against.empty())
+    {
+        VerifyDigests expected;
+        if (!readDigests(options.against, expected))
+        {
+            return 1;
+        }
+        for (const auto &[name, value] : digests)
+        {
+            auto match = std::find_if(expected.begin(), expected.end(), [&](const auto &entry) { return entry.first == name; });
+            if (match == expected.end() || match->second != value)
+            {
+                std::cerr << "Verify: " << name << " differs from " << options.against << std::endl;
+                passed = false;
+            }
+        }
+    }
+
+    std::ofstream out(options.output);
+    out << std::hex << std::setfill('0');
+    for (const auto &[name, value] : digests)
+    {
+        out << name << " " << std::setw(16) << value << "\n";
+    }
+    if (!out)
+    {
+        std::cerr << "Failed to write " << options.output << std::endl;
+        return 1;
+    }
+    std::cout << "Verify " << (passed ? "passed" : "FAILED") << " (chunk layout "
+              << getChunkAxisOrderName(ChunkAxisOrder::VOXEL_CHUNK_LAYOUT) << ", " << block.chunks.size()
+              << " chunks), digests written to " << options.output << std::endl;
+    return passed ? 0 : 1;
+}
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 1;
+    }
+    if (options.stress_seconds > 0.0f)
+    {
+        return runStress(options);
+    }
+    if (options.verify)
+    {
+        return runVerify(options);
+    }
+
+    std::vector<BenchResult> results;
+    ChunkBlock block(options.columns);
+    results.push_back(runGeneration(options, block));
+    results.push_back(runChunkLight(options, block));
+    results.push_back(runLinkLight(options, block));
+
+    // Snapshots are taken once: every variant meshes identical input
+    std::vector<std::unique_ptr<ChunkSnapshot>> snapshots;
+    snapshots.reserve(block.chunks.size());
+    for (const auto &chunk : block.chunks)
+    {
+        snapshots.push_back(std::make_unique<ChunkSnapshot>(chunk));
+    }
+
+    for (int format = 0; format < static_cast<int>(MeshFormat::Count); format++)
+    {
+        for (int mode = 0; mode < static_cast<int>(MeshingMode::Count); mode++)
+        {
+            results.push_back(runMeshing(options, snapshots, static_cast<MeshingMode>(mode), static_cast<MeshFormat>(format)));
+        }
+    }
+
+    std::cout << "Chunk layout: " << getChunkAxisOrderName(ChunkAxisOrder::VOXEL_CHUNK_LAYOUT)
+              << ", occupancy kernel: " << getOccupancyKernelName() << std::endl;
+    for (const BenchResult &result : results)
+    {
+        std::cout << result.suite << ": " << result.chunksPerSecond() << " chunks/s, " << result.nsPerVoxel()
+                  << " ns/voxel, " << result.verticesPerChunk() << " vertices/chunk, " << result.allocations
+                  << " allocations" << std::endl;
+    }
+
+    if (!writeResults(options, results))
+    {
+        return 1;
+    }
+    std::cout << "Results written to " << options.output << std::endl;
+    return 0;
+}
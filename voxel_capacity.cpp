@@ -0,0 +1,514 @@
+// Capacity planning: how much CPU, memory and disk a number of players costs a server.
+//
+// Drives VoxelWorld streaming the way the dedicated server does (one viewer per player,
+// updateViewers every tick, no OpenGL) in simulated time: players move one tick, then the
+// world runs until every chunk they asked for is loaded, so the result is the work the
+// movement demands rather than what this machine kept up with. Players either wander at
+// --speed blocks/s from spots --spread blocks apart, or follow a recorded camera path
+// (--trace, the window's C key: one "x y z yaw pitch" line per 1/60 s), each starting at
+// its own point along it and shifted --spread blocks sideways. --edits random voxel edits
+// per player and second exercise saving; a checkpoint every simulated second counts the
+// chunk writes (edited chunks saved as they leave range are on top of those).
+//
+// Every simulated second is a window: chunks generated, restored (disk reads) and written,
+// and the resident chunks at its end. Stage costs are the per-chunk load time measured on
+// the workers during the run (or --generate-ms, e.g. from voxel_bench, per chunk on one
+// worker) and the main thread's integration time. Workers needed for a window are its load
+// work over --utilization of a core. The summary reports peaks and means, per player too;
+// --output writes the windows as CSV.
+//
+// Saves go to saves/<seed>/ like the game's (seed CAPACITY_SEED unless --seed is given), so
+// a second run of the same seed restores what the first one edited.
+//
+// Usage: voxel_capacity [--players N] [--seconds N] [--distance N] [--seed N] [--threads N]
+//                       [--tick-rate N] [--speed N] [--spread N] [--trace FILE] [--edits N]
+//                       [--generate-ms MS] [--utilization FRACTION] [--output FILE]
+
+#include "voxel world/voxel_world.h"
+#include "voxel world/chunk_grid.h"
+#include "voxel world/job_system.h"
+#include "voxel world/block_registry.h"
+#include "voxel world/log.h"
+#include <glm/glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace
+{
+constexpr uint32_t CAPACITY_SEED = 515151;
+constexpr float TRACE_STEP_SECONDS = 1.0f / 60.0f; // CameraPath::STEP_SECONDS
+constexpr float WANDER_HEIGHT = 100.0f;
+constexpr float WANDER_TURN_RATE = 0.5f;     // Radians per second, at most
+constexpr float SETTLE_TIMEOUT_SECONDS = 60.0f; // Per tick, before the pipeline is taken as stuck
+
+struct CapacityOptions
+{
+    uint32_t seed = CAPACITY_SEED;
+    int players = 8;
+    float seconds = 120.0f; // Simulated
+    int render_distance = 8;
+    unsigned int threads = 0; // One worker per core, less one for the tick thread
+    int tick_rate = 20;
+    float speed = 10.0f;   // Blocks per second
+    float spread = 512.0f; // Blocks between players
+    std::string trace;
+    float edits_per_player = 0.0f; // Per second
+    float generate_ms = 0.0f;      // 0: measured
+    float utilization = 0.7f;      // Of a core, for the worker count
+    std::string output;
+};
+
+bool parseOptions(int argc, char **argv, CapacityOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--seed" && has_value)
+        {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--players" && has_value)
+        {
+            options.players = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--seconds" && has_value)
+        {
+            options.seconds = std::max(1.0f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else if (arg == "--distance" && has_value)
+        {
+            options.render_distance = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--threads" && has_value)
+        {
+            options.threads = static_cast<unsigned int>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (arg == "--tick-rate" && has_value)
+        {
+            options.tick_rate = std::clamp(std::atoi(argv[++i]), 1, 1000);
+        }
+        else if (arg == "--speed" && has_value)
+        {
+            options.speed = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else if (arg == "--spread" && has_value)
+        {
+            options.spread = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else if (arg == "--trace" && has_value)
+        {
+            options.trace = argv[++i];
+        }
+        else if (arg == "--edits" && has_value)
+        {
+            options.edits_per_player = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else if (arg == "--generate-ms" && has_value)
+        {
+            options.generate_ms = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else if (arg == "--utilization" && has_value)
+        {
+            options.utilization = std::clamp(static_cast<float>(std::atof(argv[++i])), 0.05f, 1.0f);
+        }
+        else if (arg == "--output" && has_value)
+        {
+            options.output = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Usage: voxel_capacity [--players N] [--seconds N] [--distance N] [--seed N] [--threads N]\n"
+                         "                      [--tick-rate N] [--speed N] [--spread N] [--trace FILE] [--edits N]\n"
+                         "                      [--generate-ms MS] [--utilization FRACTION] [--output FILE]"
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Positions of a recorded camera path; false (with the reason on stderr) if there are none
+bool loadTrace(const std::string &path, std::vector<glm::vec3> &positions)
+{
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream fields(line);
+        glm::vec3 position;
+        if (fields >> position.x >> position.y >> position.z)
+        {
+            positions.push_back(position);
+        }
+    }
+    if (positions.empty())
+    {
+        std::cerr << "Capacity: no camera positions in " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+size_t getResidentBytes()
+{
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0;
+    size_t resident = 0;
+    if (statm >> pages >> resident)
+    {
+        return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    return 0;
+}
+
+uint64_t getDirectoryBytes(const std::string &directory)
+{
+    std::error_code error;
+    uint64_t bytes = 0;
+    for (auto it = std::filesystem::recursive_directory_iterator(directory, error);
+         !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+    {
+        if (it->is_regular_file(error))
+        {
+            bytes += it->file_size(error);
+        }
+    }
+    return bytes;
+}
+
+// One player's movement: along the trace from its own start, or wandering
+class Player
+{
+public:
+    Player(const std::vector<glm::vec3> *trace, size_t trace_start, const glm::vec3 &offset, float heading)
+        : trace(trace), trace_step(static_cast<double>(trace_start)), position(offset), offset(offset), heading(heading)
+    {
+        if (trace)
+        {
+            position = (*trace)[trace_start] + offset;
+        }
+    }
+
+    const glm::vec3 &getPosition() const { return position; }
+
+    void move(float seconds, float speed, std::mt19937 &rng)
+    {
+        if (trace)
+        {
+            // Wraps around; the jump back to the start is a teleport, as after a respawn
+            trace_step = std::fmod(trace_step + seconds / TRACE_STEP_SECONDS, static_cast<double>(trace->size()));
+            position = (*trace)[static_cast<size_t>(trace_step)] + offset;
+            return;
+        }
+        std::uniform_real_distribution<float> turn(-WANDER_TURN_RATE, WANDER_TURN_RATE);
+        heading += turn(rng) * seconds;
+        position += glm::vec3(std::cos(heading), 0.0f, std::sin(heading)) * speed * seconds;
+    }
+
+private:
+    const std::vector<glm::vec3> *trace; // Null when wandering
+    double trace_step;
+    glm::vec3 position;
+    glm::vec3 offset;
+    float heading; // Wandering direction, radians
+};
+
+struct CapacityWindow
+{
+    double seconds = 0.0; // Simulated, at the end of the window
+    size_t loaded_chunks = 0;
+    size_t world_bytes = 0; // Loaded chunks (VoxelChunk::getMemoryUsage)
+    size_t resident_bytes = 0;
+    uint64_t generated = 0; // Chunks loaded by the workers, restored included
+    uint64_t restored = 0;
+    uint64_t written = 0;
+    double load_ms = 0.0;      // Worker time those loads cost
+    double integrate_ms = 0.0; // Main thread time inserting them
+    double workers = 0.0;      // Needed to keep up with the window
+};
+
+// Running totals of the world's sampled statistics
+struct PipelineTotals
+{
+    uint64_t generated = 0;
+    uint64_t restored = 0;
+    double measured_load_ms = 0.0; // Sum over the sampled loads
+    uint64_t measured_loads = 0;
+    double integrate_ms = 0.0;
+    size_t busy = 0; // Loads waiting or running at the last sample
+};
+
+// getGenerationStats averages over the period since the previous call, so every call is folded in
+void samplePipeline(VoxelWorld &world, PipelineTotals &totals)
+{
+    ChunkGenerationStats stats = world.getGenerationStats();
+    uint64_t loads = stats.total_generated - totals.generated;
+    totals.measured_load_ms += static_cast<double>(stats.avg_generate_ms) * loads;
+    totals.measured_loads += loads;
+    totals.generated = stats.total_generated;
+    totals.restored = stats.total_restored;
+    totals.integrate_ms += stats.last_integrate_ms;
+    totals.busy = world.getPendingLoadCount() + stats.queued + stats.in_flight + stats.awaiting_insert;
+}
+
+// Random single voxel edits near a player, on the ground layers
+void addEdits(const Player &player, int count, int render_distance, std::mt19937 &rng, std::vector<VoxelEdit> &edits)
+{
+    const float reach = static_cast<float>(render_distance * CHUNK_SIZE) * 0.5f;
+    std::uniform_real_distribution<float> horizontal(-reach, reach);
+    std::uniform_int_distribution<int> height(WATER_LEVEL - 16, WATER_LEVEL + 48);
+    for (int i = 0; i < count; i++)
+    {
+        glm::vec3 position = player.getPosition() + glm::vec3(horizontal(rng), 0.0f, horizontal(rng));
+        edits.push_back({glm::ivec3(static_cast<int>(std::floor(position.x)), height(rng),
+                                    static_cast<int>(std::floor(position.z))),
+                         (rng() & 1) ? VOXEL_STONE : VOXEL_AIR});
+    }
+}
+
+bool writeWindows(const std::string &path, const std::vector<CapacityWindow> &windows)
+{
+    std::ofstream out(path);
+    if (!out)
+    {
+        std::cerr << "Capacity: cannot write " << path << std::endl;
+        return false;
+    }
+    out << "seconds,loaded_chunks,world_bytes,resident_bytes,generated,restored,written,load_ms,integrate_ms,workers\n";
+    for (const CapacityWindow &window : windows)
+    {
+        out << window.seconds << "," << window.loaded_chunks << "," << window.world_bytes << "," << window.resident_bytes
+            << "," << window.generated << "," << window.restored << "," << window.written << "," << window.load_ms << ","
+            << window.integrate_ms << "," << window.workers << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+void printSummary(const CapacityOptions &options, const std::vector<CapacityWindow> &windows, double load_ms,
+                  uint64_t disk_growth)
+{
+    // The first window holds the initial load around every player: peaks include it, means do not
+    size_t peak_chunks = 0, peak_world = 0, peak_resident = 0;
+    double peak_workers = 0.0, peak_generated = 0.0;
+    double mean_generated = 0.0, mean_restored = 0.0, mean_written = 0.0, mean_workers = 0.0, mean_integrate = 0.0;
+    size_t steady = 0;
+    for (size_t i = 0; i < windows.size(); i++)
+    {
+        const CapacityWindow &window = windows[i];
+        peak_chunks = std::max(peak_chunks, window.loaded_chunks);
+        peak_world = std::max(peak_world, window.world_bytes);
+        peak_resident = std::max(peak_resident, window.resident_bytes);
+        peak_workers = std::max(peak_workers, window.workers);
+        peak_generated = std::max(peak_generated, static_cast<double>(window.generated));
+        if (i > 0 || windows.size() == 1)
+        {
+            mean_generated += window.generated;
+            mean_restored += window.restored;
+            mean_written += window.written;
+            mean_workers += window.workers;
+            mean_integrate += window.integrate_ms;
+            steady++;
+        }
+    }
+    if (steady > 0)
+    {
+        mean_generated /= steady;
+        mean_restored /= steady;
+        mean_written /= steady;
+        mean_workers /= steady;
+        mean_integrate /= steady;
+    }
+
+    const double players = options.players;
+    const double mb = 1024.0 * 1024.0;
+    std::cout << "Capacity: " << options.players << " players, distance " << options.render_distance << ", "
+              << windows.size() << " s simulated, " << (options.trace.empty() ? "wandering" : "trace " + options.trace)
+              << std::endl;
+    std::cout << "  Resident chunks: peak " << peak_chunks << " (" << peak_chunks / players << " per player), world "
+              << peak_world / mb << " MB (" << peak_world / mb / players << " MB per player), process "
+              << peak_resident / mb << " MB" << std::endl;
+    std::cout << "  Chunk loads: " << mean_generated << " per s (" << mean_generated / players << " per player), peak "
+              << peak_generated << " per s" << std::endl;
+    std::cout << "  Disk: " << mean_restored << " chunk reads per s, " << mean_written << " chunk writes per s, region files grew "
+              << disk_growth / mb << " MB" << std::endl;
+    std::cout << "  Stage costs: " << load_ms << " ms per chunk load on a worker ("
+              << (options.generate_ms > 0.0f ? "given" : "measured") << "), " << mean_integrate
+              << " ms per s integrating on the main thread" << std::endl;
+    std::cout << "  Workers at " << static_cast<int>(options.utilization * 100.0f + 0.5f) << "% utilization: "
+              << std::ceil(mean_workers) << " on average (" << mean_workers / players << " per player), "
+              << std::ceil(peak_workers) << " at peak" << std::endl;
+}
+
+int runCapacity(const CapacityOptions &options)
+{
+    std::vector<glm::vec3> trace;
+    if (!options.trace.empty() && !loadTrace(options.trace, trace))
+    {
+        return 1;
+    }
+
+    std::mt19937 rng(options.seed);
+    std::vector<Player> players;
+    std::uniform_real_distribution<float> scatter(-0.5f, 0.5f);
+    for (int i = 0; i < options.players; i++)
+    {
+        if (!trace.empty())
+        {
+            size_t start = trace.size() * static_cast<size_t>(i) / static_cast<size_t>(options.players);
+            players.emplace_back(&trace, start, glm::vec3(options.spread * i, 0.0f, 0.0f), 0.0f);
+        }
+        else
+        {
+            float reach = options.spread * std::sqrt(static_cast<float>(options.players));
+            glm::vec3 start(scatter(rng) * reach, WANDER_HEIGHT, scatter(rng) * reach);
+            players.emplace_back(nullptr, 0, start, (scatter(rng) + 0.5f) * 6.2831853f);
+        }
+    }
+
+    const std::string save_directory = "saves/" + std::to_string(options.seed) + "/";
+    const uint64_t disk_before = getDirectoryBytes(save_directory);
+    std::vector<CapacityWindow> windows;
+    double load_ms = options.generate_ms;
+    {
+        JobSystem job_system(JobSystemConfig{options.threads, 1, true});
+        VoxelWorld world(options.seed, job_system, options.render_distance);
+        world.setAutosaveDelay(1e9f, 1e9f); // Saving is the checkpoints' alone, once per simulated second
+
+        std::vector<uint32_t> viewers;
+        for (const Player &player : players)
+        {
+            viewers.push_back(world.addViewer(player.getPosition()));
+        }
+
+        const float tick_seconds = 1.0f / options.tick_rate;
+        const int ticks = static_cast<int>(std::ceil(options.seconds * options.tick_rate));
+        PipelineTotals totals;
+        PipelineTotals window_start;
+        uint64_t written = 0;
+        float edit_budget = 0.0f;
+        std::vector<VoxelEdit> edits;
+        std::cout << "Capacity: " << options.players << " players for " << options.seconds << " s at "
+                  << options.tick_rate << " ticks/s, seed " << options.seed << std::endl;
+
+        for (int tick = 1; tick <= ticks; tick++)
+        {
+            for (size_t i = 0; i < players.size(); i++)
+            {
+                players[i].move(tick_seconds, options.speed, rng);
+                world.moveViewer(viewers[i], players[i].getPosition());
+            }
+            edit_budget += options.edits_per_player * tick_seconds;
+            if (edit_budget >= 1.0f)
+            {
+                int count = static_cast<int>(edit_budget);
+                edit_budget -= count;
+                edits.clear();
+                for (const Player &player : players)
+                {
+                    addEdits(player, count, options.render_distance, rng, edits);
+                }
+                world.applyEdits(edits);
+            }
+
+            // Until everything the players asked for is in
+            auto settle_start = std::chrono::steady_clock::now();
+            world.updateViewers();
+            samplePipeline(world, totals);
+            while (totals.busy > 0)
+            {
+                if (std::chrono::duration<float>(std::chrono::steady_clock::now() - settle_start).count() >
+                    SETTLE_TIMEOUT_SECONDS)
+                {
+                    std::cerr << "Capacity: " << totals.busy << " loads still pending after " << SETTLE_TIMEOUT_SECONDS
+                              << " s, moving on" << std::endl;
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                world.updateViewers();
+                samplePipeline(world, totals);
+            }
+
+            if (tick % options.tick_rate == 0 || tick == ticks)
+            {
+                written += world.checkpoint();
+                CapacityWindow window;
+                window.seconds = static_cast<double>(tick) / options.tick_rate;
+                window.loaded_chunks = world.getLoadedChunkCount();
+                for (const auto &[chunk_pos, chunk] : world.getChunks())
+                {
+                    window.world_bytes += chunk->getMemoryUsage();
+                }
+                window.resident_bytes = getResidentBytes();
+                window.generated = totals.generated - window_start.generated;
+                window.restored = totals.restored - window_start.restored;
+                window.written = written;
+                window.integrate_ms = totals.integrate_ms - window_start.integrate_ms;
+                if (options.generate_ms > 0.0f)
+                {
+                    window.load_ms = static_cast<double>(window.generated) * options.generate_ms;
+                }
+                else
+                {
+                    window.load_ms = totals.measured_load_ms - window_start.measured_load_ms;
+                    load_ms = totals.measured_loads ? totals.measured_load_ms / totals.measured_loads : 0.0;
+                }
+                windows.push_back(window);
+                window_start = totals;
+                written = 0;
+            }
+        }
+
+        // Saves are written by jobs, so they go before the workers stop
+        world.flushSaves();
+        job_system.shutdown();
+    }
+
+    // Worker counts once the windows are in: a window's seconds are simulated, so its load
+    // work over one second of a core at the given utilization
+    for (CapacityWindow &window : windows)
+    {
+        window.workers = window.load_ms / (1000.0 * options.utilization);
+    }
+
+    uint64_t disk_after = getDirectoryBytes(save_directory);
+    printSummary(options, windows, load_ms, disk_after > disk_before ? disk_after - disk_before : 0);
+    if (!options.output.empty())
+    {
+        if (!writeWindows(options.output, windows))
+        {
+            return 1;
+        }
+        std::cout << "Windows written to " << options.output << std::endl;
+    }
+    return 0;
+}
+}
+
+int main(int argc, char **argv)
+{
+    CapacityOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 1;
+    }
+    BlockRegistry::load("voxel world/blocks.txt");
+    int result = runCapacity(options);
+    Log::flush();
+    return result;
+}
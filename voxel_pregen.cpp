@@ -0,0 +1,362 @@
+// World pre-generation: fills the region files of a seed out to a radius before the world is
+// opened, so players (or the dedicated server) restore chunks instead of generating them.
+//
+// Works one region file at a time, nearest region first. Every chunk column of the region
+// inside the radius is a job; it generates the column's layers with VoxelChunk::generate
+// and queues the non-uniform ones on RegionStorage, whose writer batches them into that
+// region's file. Uniform sections are not written: they are cheap to generate and the world
+// keeps those out of sight implicit anyway. Nothing touches OpenGL.
+//
+// Resuming: a finished region is appended to pregen.progress next to the region files and
+// skipped by the next run of the same (or a smaller) radius. Chunks already saved are never
+// generated again, which also keeps edits of a world that is already being played.
+//
+// The terrain mode must match the one the world is opened with.
+//
+// Usage: voxel_pregen --radius N [--seed N] [--threads N] [--terrain heightmap|density]
+
+#include "voxel world/voxel_chunk.h"
+#include "voxel world/voxel_types.h"
+#include "voxel world/height_field_cache.h"
+#include "voxel world/region_storage.h"
+#include "voxel world/job_system.h"
+#include "voxel world/block_registry.h"
+#include "voxel world/log.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct PregenOptions
+{
+    uint32_t seed = 12345;
+    int radius = 0;           // Chunk columns from the origin column
+    unsigned int threads = 0; // One worker per core
+    TerrainMode terrain = TerrainMode::Heightmap;
+};
+
+bool parseOptions(int argc, char **argv, PregenOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--seed" && has_value)
+        {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--radius" && has_value)
+        {
+            options.radius = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (arg == "--threads" && has_value)
+        {
+            options.threads = static_cast<unsigned int>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (arg == "--terrain" && has_value && std::string(argv[i + 1]) == "density")
+        {
+            options.terrain = TerrainMode::Density;
+            i++;
+        }
+        else if (arg == "--terrain" && has_value && std::string(argv[i + 1]) == "heightmap")
+        {
+            options.terrain = TerrainMode::Heightmap;
+            i++;
+        }
+        else
+        {
+            options.radius = 0;
+            break;
+        }
+    }
+
+    if (options.radius <= 0)
+    {
+        std::cerr << "Usage: voxel_pregen --radius N [--seed N] [--threads N] [--terrain heightmap|density]" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int floorDiv(int value, int divisor)
+{
+    return value >= 0 ? value / divisor : (value + 1) / divisor - 1;
+}
+
+bool isInRadius(int x, int z, int radius)
+{
+    return x * x + z * z <= radius * radius;
+}
+
+// Squared distance from the origin column to the nearest column of a region
+int64_t regionDistance2(const glm::ivec2 &region)
+{
+    const int size = RegionStorage::REGION_SIZE;
+    int64_t dx = std::clamp(0, region.x * size, region.x * size + size - 1);
+    int64_t dz = std::clamp(0, region.y * size, region.y * size + size - 1);
+    return dx * dx + dz * dz;
+}
+
+// Regions finished by earlier runs, with the radius they were generated to
+class PregenProgress
+{
+public:
+    explicit PregenProgress(std::string path) : path(std::move(path))
+    {
+        std::ifstream file(this->path);
+        Entry entry;
+        while (file >> entry.region.x >> entry.region.y >> entry.radius)
+        {
+            entries.push_back(entry);
+        }
+    }
+
+    // A region is done once a run of at least this radius finished all of it
+    bool isDone(const glm::ivec2 &region, int radius) const
+    {
+        return std::any_of(entries.begin(), entries.end(), [&](const Entry &entry)
+                           { return entry.region == region && entry.radius >= radius; });
+    }
+
+    bool markDone(const glm::ivec2 &region, int radius)
+    {
+        std::error_code error; // A run that wrote no chunk yet has no directory
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+        std::ofstream file(path, std::ios::app);
+        file << region.x << " " << region.y << " " << radius << "\n";
+        entries.push_back({region, radius});
+        return static_cast<bool>(file.flush());
+    }
+
+private:
+    struct Entry
+    {
+        glm::ivec2 region{0};
+        int radius = 0;
+    };
+
+    std::string path;
+    std::vector<Entry> entries;
+};
+
+struct RegionCounts
+{
+    std::atomic<size_t> generated{0}; // Written to the region file
+    std::atomic<size_t> uniform{0};   // Generated, left to the world
+    std::atomic<size_t> skipped{0};   // Already saved
+};
+
+class WorldPregenerator
+{
+public:
+    explicit WorldPregenerator(const PregenOptions &options)
+        : options(options), directory("saves/" + std::to_string(options.seed) + "/"),
+          job_system(JobSystemConfig{options.threads, 0, false}), heights(options.seed),
+          storage(directory, job_system), progress(directory + "pregen.progress")
+    {
+        // A region and its border ring, plus the blocks a miss generates around it
+        const int side = RegionStorage::REGION_SIZE + 2 + 2 * (HeightFieldCache::TILE_BATCH - 1);
+        heights.setCapacity(static_cast<size_t>(side) * side);
+    }
+
+    ~WorldPregenerator()
+    {
+        // Writes are jobs, so they go before the workers stop
+        storage.flush();
+        job_system.shutdown();
+    }
+
+    void run()
+    {
+        std::vector<glm::ivec2> regions = collectRegions();
+        std::cout << "Pre-generating seed " << options.seed << " to radius " << options.radius << ": " << regions.size()
+                  << " regions, " << job_system.getWorkerCount() << " workers" << std::endl;
+
+        const auto start = std::chrono::steady_clock::now();
+        size_t total_generated = 0;
+        size_t total_chunks = 0;
+        size_t resumed = 0;
+        for (size_t i = 0; i < regions.size(); i++)
+        {
+            const glm::ivec2 &region = regions[i];
+            if (progress.isDone(region, options.radius))
+            {
+                resumed++;
+                continue;
+            }
+
+            const auto region_start = std::chrono::steady_clock::now();
+            RegionCounts counts;
+            generateRegion(region, counts);
+            storage.flush();
+            if (storage.getPendingWriteCount() > 0)
+            {
+                // Failed writes stay queued; the region is redone by the next run
+                std::cerr << "Pre-generation: region (" << region.x << ", " << region.y << ") not fully written"
+                          << std::endl;
+            }
+            else if (!progress.markDone(region, options.radius))
+            {
+                std::cerr << "Pre-generation: failed to record progress in " << directory << std::endl;
+            }
+
+            size_t chunks = counts.generated + counts.uniform;
+            total_generated += counts.generated;
+            total_chunks += chunks;
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - region_start).count();
+            std::cout << "Region (" << region.x << ", " << region.y << ") " << i + 1 << "/" << regions.size() << ": "
+                      << counts.generated << " chunks written, " << counts.uniform << " uniform, " << counts.skipped
+                      << " already saved, " << static_cast<int>(chunks / std::max(seconds, 1e-6)) << " chunks/s"
+                      << std::endl;
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Done: " << total_chunks << " chunks generated (" << total_generated << " written) in " << seconds
+                  << " s, " << static_cast<int>(total_chunks / std::max(seconds, 1e-6)) << " chunks/s";
+        if (resumed > 0)
+        {
+            std::cout << ", " << resumed << " regions already done";
+        }
+        std::cout << std::endl;
+    }
+
+private:
+    const PregenOptions options;
+    const std::string directory;
+    JobSystem job_system; // Declared first: storage's writer jobs must not outlive it
+    HeightFieldCache heights;
+    RegionStorage storage;
+    PregenProgress progress;
+
+    std::vector<glm::ivec2> collectRegions() const
+    {
+        const int low = floorDiv(-options.radius, RegionStorage::REGION_SIZE);
+        const int high = floorDiv(options.radius, RegionStorage::REGION_SIZE);
+        const int64_t radius2 = static_cast<int64_t>(options.radius) * options.radius;
+
+        std::vector<glm::ivec2> regions;
+        for (int x = low; x <= high; x++)
+        {
+            for (int z = low; z <= high; z++)
+            {
+                if (regionDistance2({x, z}) <= radius2)
+                {
+                    regions.push_back({x, z});
+                }
+            }
+        }
+        std::sort(regions.begin(), regions.end(), [](const glm::ivec2 &a, const glm::ivec2 &b)
+                  { return regionDistance2(a) < regionDistance2(b); });
+        return regions;
+    }
+
+    // Queue every column of the region in the radius and wait for them
+    void generateRegion(const glm::ivec2 &region, RegionCounts &counts)
+    {
+        std::mutex mutex;
+        std::condition_variable finished;
+        size_t remaining = 0;
+
+        const int size = RegionStorage::REGION_SIZE;
+        for (int x = region.x * size; x < region.x * size + size; x++)
+        {
+            for (int z = region.y * size; z < region.y * size + size; z++)
+            {
+                if (!isInRadius(x, z, options.radius))
+                {
+                    continue;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    remaining++;
+                }
+                job_system.submit([this, x, z, &counts, &mutex, &finished, &remaining]
+                                  {
+                                      generateColumn(x, z, counts);
+                                      std::lock_guard<std::mutex> lock(mutex);
+                                      if (--remaining == 0)
+                                      {
+                                          finished.notify_all();
+                                      }
+                                  },
+                                  JobPriority::Low);
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&remaining]
+                      { return remaining == 0; });
+    }
+
+    void generateColumn(int x, int z, RegionCounts &counts)
+    {
+        // One chunk per worker, reset for every layer like the world's chunk pool
+        thread_local std::unique_ptr<VoxelChunk> chunk;
+        for (int y = 0; y < TERRAIN_LAYERS; y++)
+        {
+            glm::ivec3 position(x, y, z);
+            if (storage.contains(position))
+            {
+                counts.skipped++;
+                continue;
+            }
+
+            if (chunk)
+            {
+                chunk->reset(position);
+            }
+            else
+            {
+                chunk = std::make_unique<VoxelChunk>(position);
+            }
+
+            try
+            {
+                chunk->generate(options.seed, &heights, options.terrain);
+            }
+            catch (const std::exception &e)
+            {
+                Log::writeLimited(LogLevel::Error, "Chunk generation failures", std::string("Chunk generation failed: ") + e.what());
+                continue;
+            }
+
+            if (chunk->voxels.isUniform())
+            {
+                counts.uniform++;
+            }
+            else if (storage.store(position, chunk->voxels))
+            {
+                counts.generated++;
+            }
+        }
+    }
+};
+}
+
+int main(int argc, char **argv)
+{
+    PregenOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 1;
+    }
+    BlockRegistry::load("voxel world/blocks.txt"); // Saved palettes are checked against it
+
+    {
+        WorldPregenerator pregenerator(options);
+        pregenerator.run();
+    }
+
+    Log::flush();
+    return 0;
+}
@@ -0,0 +1,509 @@
+// Headless dedicated server: the voxel world without a window, renderer or OpenGL.
+//
+// Streams chunks around every connected client (VoxelWorld::addViewer), generates them on the
+// job system and applies edits, ticking at a fixed rate. Commands arrive one per line on
+// stdin, so a network front end or a test script can drive it the same way. Each client gets
+// a chunk stream (ChunkStreamServer); there is no socket transport here yet, so the bytes
+// queued for clients are only counted (see stats).
+//
+//   join x y z                  -> "viewer <id>"
+//   move <id> x y z
+//   leave <id>
+//   set x y z <voxel>           Edits of one tick are applied as one batch
+//   fill x0 y0 z0 x1 y1 z1 <voxel>
+//   get x y z                   -> "voxel x y z <voxel>" (air while the chunk is not loaded)
+//   copy x0 y0 z0 x1 y1 z1 <file>  Save the box as a schematic
+//   paste <file> x y z [air]    Structure with its minimum corner at x y z, over the next ticks
+//   checkpoint                  Queue every unsaved edit for writing now -> "checkpoint <chunks>"
+//   stats
+//   quit                        (end of input quits as well)
+//
+// Usage: voxel_server [--seed N] [--distance N] [--threads N] [--tick-rate N] [--checkpoint SECONDS]
+//                     [--metrics FILE] [--metrics-interval SECONDS]
+//
+// --checkpoint takes a checkpoint (VoxelWorld::checkpoint) every SECONDS on top of the autosave,
+// bounding what a crash can lose.
+//
+// --metrics keeps FILE up to date with the server's counters in the Prometheus text format
+// (MetricsExporter), every 5 seconds unless --metrics-interval says otherwise; point the node
+// exporter's textfile collector at its directory to scrape it.
+
+#include "voxel world/voxel_world.h"
+#include "voxel world/chunk_stream_server.h"
+#include "voxel world/job_system.h"
+#include "voxel world/block_registry.h"
+#include "voxel world/schematic.h"
+#include "voxel world/log.h"
+#include "voxel world/metrics_exporter.h"
+#include "voxel world/latency_histogram.h"
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+struct ServerOptions
+{
+    uint32_t seed = 12345;
+    int render_distance = 8;
+    unsigned int threads = 0; // One worker per core, less one for the tick thread
+    int tick_rate = 20;       // Ticks per second
+    float checkpoint_seconds = 0.0f; // 0: autosave only
+    std::string metrics_path; // Empty: no metrics file
+    float metrics_interval = MetricsExporter::DEFAULT_INTERVAL_SECONDS;
+};
+
+bool parseOptions(int argc, char **argv, ServerOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--seed" && has_value)
+        {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--distance" && has_value)
+        {
+            options.render_distance = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--threads" && has_value)
+        {
+            options.threads = static_cast<unsigned int>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (arg == "--tick-rate" && has_value)
+        {
+            options.tick_rate = std::clamp(std::atoi(argv[++i]), 1, 1000);
+        }
+        else if (arg == "--checkpoint" && has_value)
+        {
+            options.checkpoint_seconds = static_cast<float>(std::max(0.0, std::atof(argv[++i])));
+        }
+        else if (arg == "--metrics" && has_value)
+        {
+            options.metrics_path = argv[++i];
+        }
+        else if (arg == "--metrics-interval" && has_value)
+        {
+            options.metrics_interval = static_cast<float>(std::atof(argv[++i]));
+        }
+        else
+        {
+            std::cerr << "Usage: voxel_server [--seed N] [--distance N] [--threads N] [--tick-rate N] "
+                         "[--checkpoint SECONDS] [--metrics FILE] [--metrics-interval SECONDS]"
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Lines read on their own thread, so a tick never waits for input
+class CommandQueue
+{
+public:
+    void push(std::string line)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        lines.push_back(std::move(line));
+    }
+
+    void takeAll(std::vector<std::string> &out)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        out.assign(std::make_move_iterator(lines.begin()), std::make_move_iterator(lines.end()));
+        lines.clear();
+    }
+
+private:
+    std::mutex mutex;
+    std::deque<std::string> lines;
+};
+
+class DedicatedServer
+{
+public:
+    explicit DedicatedServer(const ServerOptions &options)
+        : job_system(JobSystemConfig{options.threads, 1, true}), world(options.seed, job_system, options.render_distance), stream(world)
+    {
+        world.setCheckpointInterval(options.checkpoint_seconds);
+        if (!options.metrics_path.empty())
+        {
+            startMetrics(options.metrics_path, options.metrics_interval);
+        }
+    }
+
+    ~DedicatedServer()
+    {
+        if (metrics)
+        {
+            publishMetrics();
+            metrics->stop();
+        }
+        // Saves are written by jobs, so they go before the workers stop
+        world.flushSaves();
+        job_system.shutdown();
+    }
+
+    // False once the command asks the server to stop
+    bool handle(const std::string &line)
+    {
+        std::istringstream input(line);
+        std::string command;
+        if (!(input >> command))
+        {
+            return true;
+        }
+
+        if (command == "quit")
+        {
+            return false;
+        }
+        if (command == "join")
+        {
+            glm::vec3 position;
+            if (input >> position.x >> position.y >> position.z)
+            {
+                uint32_t client = stream.connect(position);
+                clients.push_back(client);
+                std::cout << "viewer " << client << std::endl;
+                return true;
+            }
+        }
+        else if (command == "move")
+        {
+            uint32_t viewer;
+            glm::vec3 position;
+            if (input >> viewer >> position.x >> position.y >> position.z)
+            {
+                stream.move(viewer, position);
+                return true;
+            }
+        }
+        else if (command == "leave")
+        {
+            uint32_t viewer;
+            if (input >> viewer)
+            {
+                stream.disconnect(viewer);
+                clients.erase(std::remove(clients.begin(), clients.end(), viewer), clients.end());
+                return true;
+            }
+        }
+        else if (command == "set")
+        {
+            glm::ivec3 position;
+            int voxel;
+            if (input >> position.x >> position.y >> position.z >> voxel && isValidVoxel(voxel))
+            {
+                pending_edits.push_back({position, static_cast<VoxelID>(voxel)});
+                return true;
+            }
+        }
+        else if (command == "fill")
+        {
+            glm::ivec3 min_corner, max_corner;
+            int voxel;
+            if (input >> min_corner.x >> min_corner.y >> min_corner.z >> max_corner.x >> max_corner.y >> max_corner.z >>
+                    voxel &&
+                isValidVoxel(voxel))
+            {
+                flushEdits(); // Keeps the order of edits the client sent
+                world.fillBox(glm::min(min_corner, max_corner), glm::max(min_corner, max_corner), static_cast<VoxelID>(voxel));
+                return true;
+            }
+        }
+        else if (command == "get")
+        {
+            glm::ivec3 position;
+            if (input >> position.x >> position.y >> position.z)
+            {
+                flushEdits();
+                std::cout << "voxel " << position.x << " " << position.y << " " << position.z << " "
+                          << static_cast<int>(world.getVoxel(position)) << std::endl;
+                return true;
+            }
+        }
+        else if (command == "copy")
+        {
+            glm::ivec3 min_corner, max_corner;
+            std::string path;
+            if (input >> min_corner.x >> min_corner.y >> min_corner.z >> max_corner.x >> max_corner.y >> max_corner.z >>
+                path)
+            {
+                flushEdits();
+                std::shared_ptr<Schematic> schematic =
+                    Schematic::capture(world, glm::min(min_corner, max_corner), glm::max(min_corner, max_corner));
+                if (schematic->getVolume() > 0 && schematic->save(path))
+                {
+                    schematics[path] = schematic;
+                }
+                return true;
+            }
+        }
+        else if (command == "paste")
+        {
+            std::string path;
+            glm::ivec3 origin;
+            if (input >> path >> origin.x >> origin.y >> origin.z)
+            {
+                std::string air;
+                input >> air;
+                std::shared_ptr<Schematic> &schematic = schematics[path];
+                if (!schematic)
+                {
+                    schematic = std::make_shared<Schematic>();
+                    if (!schematic->load(path))
+                    {
+                        schematics.erase(path);
+                        return true;
+                    }
+                }
+                flushEdits();
+                world.pasteSchematicAsync(schematic, origin, air == "air");
+                return true;
+            }
+        }
+        else if (command == "checkpoint")
+        {
+            flushEdits();
+            std::cout << "checkpoint " << world.checkpoint() << std::endl;
+            return true;
+        }
+        else if (command == "stats")
+        {
+            printStats();
+            return true;
+        }
+
+        Log::write(LogLevel::Warning, "Bad server command: " + line);
+        return true;
+    }
+
+    void tick()
+    {
+        auto tick_start = std::chrono::steady_clock::now();
+        flushEdits();
+        world.updateViewers();
+        stream.update();
+
+        // A transport would send these
+        for (uint32_t client : clients)
+        {
+            outgoing.clear();
+            stream.takeOutput(client, outgoing);
+        }
+
+        auto tick_end = std::chrono::steady_clock::now();
+        tick_times.record(std::chrono::duration<float, std::milli>(tick_end - tick_start).count());
+        if (metrics && tick_end - last_metrics_sample >= METRICS_SAMPLE_PERIOD)
+        {
+            publishMetrics();
+            last_metrics_sample = tick_end;
+        }
+    }
+
+private:
+    JobSystem job_system; // Declared first: the world's jobs must not outlive it
+    VoxelWorld world;
+    ChunkStreamServer stream; // After the world, which it listens to
+    std::vector<uint32_t> clients;
+    std::vector<VoxelEdit> pending_edits;
+    std::vector<unsigned char> outgoing;
+    std::unordered_map<std::string, std::shared_ptr<Schematic>> schematics; // Loaded once per file
+
+    // Counters are sampled on the tick thread, more often than the file is written; the
+    // exporter's writer only reads what was published
+    static constexpr std::chrono::seconds METRICS_SAMPLE_PERIOD{1};
+    struct ServerMetrics
+    {
+        MetricsExporter::Metric viewers;
+        MetricsExporter::Metric chunks_loaded;
+        MetricsExporter::Metric chunks_generated;
+        MetricsExporter::Metric chunks_restored;
+        MetricsExporter::Metric chunks_discarded;
+        MetricsExporter::Metric generation_queued;
+        MetricsExporter::Metric generation_in_flight;
+        MetricsExporter::Metric generate_ms;
+        MetricsExporter::Metric queue_wait_ms;
+        MetricsExporter::Metric unsaved_chunks;
+        MetricsExporter::Metric pending_saves;
+        MetricsExporter::Metric pooled_chunks;
+        MetricsExporter::Metric jobs_queued;
+        MetricsExporter::Metric jobs_executed;
+        MetricsExporter::Metric jobs_stolen;
+        MetricsExporter::Metric worker_idle;
+        MetricsExporter::Metric stream_chunks_sent;
+        MetricsExporter::Metric stream_chunks_reused;
+        MetricsExporter::Metric stream_deltas_sent;
+        MetricsExporter::Metric stream_bytes_sent;
+        MetricsExporter::Metric tick_ms;
+    };
+    std::unique_ptr<MetricsExporter> metrics; // Null without --metrics
+    ServerMetrics metric_ids{};
+    LatencyHistogram tick_times; // Since start
+    uint64_t jobs_executed_total = 0; // JobSystem::getStats resets its counters
+    uint64_t jobs_stolen_total = 0;
+    std::chrono::steady_clock::time_point last_metrics_sample;
+
+    static bool isValidVoxel(int voxel) { return BlockRegistry::get().isRegistered(voxel); }
+
+    void flushEdits()
+    {
+        if (!pending_edits.empty())
+        {
+            world.applyEdits(pending_edits);
+            pending_edits.clear();
+        }
+    }
+
+    void startMetrics(const std::string &path, float interval_seconds)
+    {
+        metrics = std::make_unique<MetricsExporter>(path, interval_seconds);
+        MetricsExporter &m = *metrics;
+        metric_ids.viewers = m.addGauge("voxel_server_viewers", "Connected viewers.");
+        metric_ids.chunks_loaded = m.addGauge("voxel_server_chunks_loaded", "Chunks loaded in the world.");
+        metric_ids.chunks_generated = m.addCounter("voxel_server_chunks_generated_total", "Chunks generated or restored.");
+        metric_ids.chunks_restored = m.addCounter("voxel_server_chunks_restored_total", "Chunks read back from region files.");
+        metric_ids.chunks_discarded =
+            m.addCounter("voxel_server_chunks_discarded_total", "Generated chunks that left range before insertion.");
+        metric_ids.generation_queued =
+            m.addGauge("voxel_server_generation_queued", "Chunk loads waiting for a generation worker.");
+        metric_ids.generation_in_flight = m.addGauge("voxel_server_generation_in_flight", "Chunks being generated.");
+        metric_ids.generate_ms =
+            m.addGauge("voxel_server_chunk_generate_ms", "Average chunk generation time over the last sample.");
+        metric_ids.queue_wait_ms =
+            m.addGauge("voxel_server_chunk_queue_wait_ms", "Average wait for a generation worker over the last sample.");
+        metric_ids.unsaved_chunks = m.addGauge("voxel_server_unsaved_chunks", "Edited chunks waiting out the autosave window.");
+        metric_ids.pending_saves = m.addGauge("voxel_server_pending_saves", "Edited chunks queued for writing.");
+        metric_ids.pooled_chunks = m.addGauge("voxel_server_pooled_chunks", "Recycled chunk shells ready for reuse.");
+        metric_ids.jobs_queued = m.addGauge("voxel_server_jobs_queued", "Jobs waiting in worker queues.");
+        metric_ids.jobs_executed = m.addCounter("voxel_server_jobs_executed_total", "Jobs run by the workers.");
+        metric_ids.jobs_stolen = m.addCounter("voxel_server_jobs_stolen_total", "Jobs taken from another worker's queue.");
+        metric_ids.worker_idle =
+            m.addGauge("voxel_server_worker_idle_ratio", "Fraction of worker time spent asleep over the last sample.");
+        metric_ids.stream_chunks_sent = m.addCounter("voxel_server_stream_chunks_sent_total", "Whole chunks sent to clients.");
+        metric_ids.stream_chunks_reused =
+            m.addCounter("voxel_server_stream_chunks_reused_total", "Chunks announced from a client cache instead of sent.");
+        metric_ids.stream_deltas_sent = m.addCounter("voxel_server_stream_deltas_sent_total", "Chunk deltas sent to clients.");
+        metric_ids.stream_bytes_sent = m.addCounter("voxel_server_stream_bytes_sent_total", "Bytes queued for clients.");
+        metric_ids.tick_ms = m.addSummary("voxel_server_tick_ms", "Server tick duration in milliseconds.");
+        if (!m.start())
+        {
+            metrics.reset();
+            return;
+        }
+        last_metrics_sample = std::chrono::steady_clock::now();
+    }
+
+    // Also starts a new sampling period of the averages the stats command prints
+    void publishMetrics()
+    {
+        MetricsExporter &m = *metrics;
+        ChunkGenerationStats generation = world.getGenerationStats();
+        m.set(metric_ids.viewers, static_cast<double>(world.getViewerCount()));
+        m.set(metric_ids.chunks_loaded, static_cast<double>(world.getLoadedChunkCount()));
+        m.set(metric_ids.chunks_generated, static_cast<double>(generation.total_generated));
+        m.set(metric_ids.chunks_restored, static_cast<double>(generation.total_restored));
+        m.set(metric_ids.chunks_discarded, static_cast<double>(generation.total_discarded));
+        m.set(metric_ids.generation_queued, static_cast<double>(world.getPendingLoadCount() + generation.queued));
+        m.set(metric_ids.generation_in_flight, static_cast<double>(generation.in_flight));
+        m.set(metric_ids.generate_ms, generation.avg_generate_ms);
+        m.set(metric_ids.queue_wait_ms, generation.avg_queue_wait_ms);
+        m.set(metric_ids.unsaved_chunks, static_cast<double>(generation.unsaved_chunks));
+        m.set(metric_ids.pending_saves, static_cast<double>(generation.pending_saves));
+        m.set(metric_ids.pooled_chunks, static_cast<double>(generation.pooled_chunks));
+
+        JobSystemStats jobs = job_system.getStats();
+        jobs_executed_total += jobs.jobs_executed;
+        jobs_stolen_total += jobs.jobs_stolen;
+        m.set(metric_ids.jobs_queued, static_cast<double>(jobs.queued));
+        m.set(metric_ids.jobs_executed, static_cast<double>(jobs_executed_total));
+        m.set(metric_ids.jobs_stolen, static_cast<double>(jobs_stolen_total));
+        m.set(metric_ids.worker_idle, jobs.idle_fraction);
+
+        const ChunkStreamServer::Stats &sent = stream.getStats();
+        m.set(metric_ids.stream_chunks_sent, static_cast<double>(sent.chunks_sent));
+        m.set(metric_ids.stream_chunks_reused, static_cast<double>(sent.chunks_reused));
+        m.set(metric_ids.stream_deltas_sent, static_cast<double>(sent.deltas_sent));
+        m.set(metric_ids.stream_bytes_sent, static_cast<double>(sent.bytes_sent));
+        m.setSummary(metric_ids.tick_ms, tick_times);
+    }
+
+    void printStats()
+    {
+        ChunkGenerationStats stats = world.getGenerationStats();
+        std::cout << "viewers " << world.getViewerCount() << ", chunks " << world.getLoadedChunkCount() << ", pending "
+                  << world.getPendingLoadCount() + stats.queued + stats.in_flight << ", generated "
+                  << stats.total_generated << " (" << stats.total_restored << " restored), avg generate "
+                  << stats.avg_generate_ms << " ms, unsaved " << stats.unsaved_chunks << ", pastes "
+                  << world.getPendingPasteCount() << std::endl;
+        const ChunkStreamServer::Stats &sent = stream.getStats();
+        std::cout << "stream: " << sent.chunks_sent << " chunks (" << sent.chunks_reused << " reused), "
+                  << sent.deltas_sent << " deltas, " << sent.bytes_sent << " bytes" << std::endl;
+    }
+};
+}
+
+int main(int argc, char **argv)
+{
+    ServerOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 1;
+    }
+    BlockRegistry::load("voxel world/blocks.txt"); // Clients must load the same types
+
+    CommandQueue commands;
+    std::thread reader([&commands]
+                       {
+                           std::string line;
+                           while (std::getline(std::cin, line) && line != "quit")
+                           {
+                               commands.push(line);
+                           }
+                           commands.push("quit");
+                       });
+
+    {
+        DedicatedServer server(options);
+        std::cout << "Server running: seed " << options.seed << ", distance " << options.render_distance << ", "
+                  << options.tick_rate << " ticks/s" << std::endl;
+
+        const auto tick_interval = std::chrono::nanoseconds(1000000000LL / options.tick_rate);
+        auto next_tick = std::chrono::steady_clock::now();
+        std::vector<std::string> lines;
+        bool running = true;
+        while (running)
+        {
+            commands.takeAll(lines);
+            for (const std::string &line : lines)
+            {
+                running = running && server.handle(line);
+            }
+            server.tick();
+
+            // Fixed rate; a tick that ran long is not made up for
+            next_tick += tick_interval;
+            auto now = std::chrono::steady_clock::now();
+            if (next_tick < now)
+            {
+                next_tick = now;
+            }
+            std::this_thread::sleep_until(next_tick);
+        }
+    }
+
+    reader.join();
+    Log::flush();
+    return 0;
+}
@@ -0,0 +1,159 @@
+// Python module (pybind11) over the terrain generator, for prototyping terrain shapes on the
+// real noise graph instead of a Python copy of it.
+//
+// Tiles are filled in place: the output arrays are NumPy arrays the caller owns (or the module
+// allocates and returns), written through their buffers without a copy, so they must be C
+// contiguous and of the exact dtype; other arrays are rejected rather than converted. Every
+// call releases the GIL while it generates and uses the calling thread's VoxelNoise
+// (VoxelNoise::forThread), so tiles from a thread pool run in parallel.
+//
+//   import numpy as np, voxel_terrain
+//   heights = voxel_terrain.height_field(12345, 0, 0, 512, 512)      # int32 (x, z)
+//   layers = np.empty((5, 512, 512), np.float32)                     # (layer, y, x)
+//   voxel_terrain.noise_layers(12345, 0, 0, *layers)
+//
+// Built as voxel_terrain when CMake finds pybind11 (pip install pybind11, then configure
+// with -Dpybind11_DIR=$(python -m pybind11 --cmakedir)).
+
+#include "voxel world/voxel_noise.h"
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+namespace py = pybind11;
+
+namespace
+{
+using HeightArray = py::array_t<int32_t, py::array::c_style>;
+using BiomeArray = py::array_t<uint8_t, py::array::c_style>;
+using NoiseArray = py::array_t<float, py::array::c_style>;
+
+void requireShape(const py::array &array, py::ssize_t rows, py::ssize_t columns, const char *name)
+{
+    if (array.ndim() != 2 || array.shape(0) != rows || array.shape(1) != columns)
+    {
+        throw std::invalid_argument(std::string(name) + " must have shape (" + std::to_string(rows) + ", " +
+                                    std::to_string(columns) + ")");
+    }
+}
+
+// Final terrain heights of the columns (start + i * step), as the chunks generate them;
+// heights[x, z] with x the first axis, as VoxelNoise::generateHeightField writes them
+void fillHeightField(uint32_t seed, int start_x, int start_z, HeightArray &heights, int step,
+                     std::optional<BiomeArray> &biomes)
+{
+    if (heights.ndim() != 2)
+    {
+        throw std::invalid_argument("heights must be two-dimensional (x, z)");
+    }
+    if (step < 1 || start_x % step != 0 || start_z % step != 0)
+    {
+        throw std::invalid_argument("step must be positive and divide start_x and start_z");
+    }
+    const int size_x = static_cast<int>(heights.shape(0));
+    const int size_z = static_cast<int>(heights.shape(1));
+    if (biomes)
+    {
+        requireShape(*biomes, size_x, size_z, "biomes");
+    }
+
+    int32_t *height_data = heights.mutable_data();
+    uint8_t *biome_data = biomes ? biomes->mutable_data() : nullptr;
+    py::gil_scoped_release release;
+    VoxelNoise::forThread(seed).generateHeightField(start_x, start_z, size_x, size_z, height_data, step, biome_data);
+}
+} // namespace
+
+PYBIND11_MODULE(voxel_terrain, module)
+{
+    static_assert(sizeof(int) == sizeof(int32_t), "generateHeightField writes int");
+
+    module.doc() = "Batched terrain sampling on the C++ voxel terrain generator";
+
+    module.attr("TERRAIN_FREQUENCY") = VoxelNoise::TERRAIN_FREQUENCY;
+    module.attr("WATER_LEVEL") = WATER_LEVEL;
+    module.attr("GENERATOR_VERSION") = VoxelNoise::GENERATOR_VERSION;
+    py::list biome_names;
+    for (int biome = 0; biome < BIOME_COUNT; biome++)
+    {
+        biome_names.append(getBiomeName(static_cast<Biome>(biome)));
+    }
+    module.attr("BIOME_NAMES") = biome_names;
+
+    module.def("generator_hash", &VoxelNoise::getGeneratorHash, py::arg("seed"),
+               "Hash of the seed and terrain shape that keys terrain cached on disk");
+
+    module.def(
+        "height_field_into",
+        [](uint32_t seed, int start_x, int start_z, HeightArray heights, int step, std::optional<BiomeArray> biomes)
+        { fillHeightField(seed, start_x, start_z, heights, step, biomes); },
+        py::arg("seed"), py::arg("start_x"), py::arg("start_z"), py::arg("heights").noconvert(), py::arg("step") = 1,
+        py::arg("biomes").noconvert() = py::none(),
+        "Fill an int32 (size_x, size_z) array with the terrain heights of the columns start + i * step, and "
+        "optionally a uint8 array of the same shape with their biomes");
+
+    module.def(
+        "height_field",
+        [](uint32_t seed, int start_x, int start_z, int size_x, int size_z, int step)
+        {
+            if (size_x <= 0 || size_z <= 0)
+            {
+                throw std::invalid_argument("size_x and size_z must be positive");
+            }
+            HeightArray heights({size_x, size_z});
+            std::optional<BiomeArray> no_biomes;
+            fillHeightField(seed, start_x, start_z, heights, step, no_biomes);
+            return heights;
+        },
+        py::arg("seed"), py::arg("start_x"), py::arg("start_z"), py::arg("size_x"), py::arg("size_z"),
+        py::arg("step") = 1, "New int32 (size_x, size_z) array of terrain heights");
+
+    module.def(
+        "noise_layers",
+        [](uint32_t seed, int start_x, int start_y, std::optional<NoiseArray> continental,
+           std::optional<NoiseArray> erosion, std::optional<NoiseArray> peaks, std::optional<NoiseArray> simplex,
+           std::optional<NoiseArray> fractal)
+        {
+            std::optional<NoiseArray> *layers[] = {&continental, &erosion, &peaks, &simplex, &fractal};
+            const char *names[] = {"continental", "erosion", "peaks", "simplex", "fractal"};
+            py::ssize_t rows = -1, columns = -1;
+            float *data[5] = {};
+            for (int layer = 0; layer < 5; layer++)
+            {
+                if (!*layers[layer])
+                {
+                    continue;
+                }
+                NoiseArray &array = **layers[layer];
+                if (rows < 0)
+                {
+                    if (array.ndim() != 2)
+                    {
+                        throw std::invalid_argument(std::string(names[layer]) + " must be two-dimensional (y, x)");
+                    }
+                    rows = array.shape(0);
+                    columns = array.shape(1);
+                }
+                requireShape(array, rows, columns, names[layer]);
+                data[layer] = array.mutable_data();
+            }
+            if (rows <= 0 || columns <= 0)
+            {
+                return;
+            }
+
+            py::gil_scoped_release release;
+            VoxelNoise::forThread(seed).generateNoiseLayers(start_x, start_y, static_cast<int>(columns),
+                                                            static_cast<int>(rows), data[0], data[1], data[2],
+                                                            data[3], data[4]);
+        },
+        py::arg("seed"), py::arg("start_x"), py::arg("start_y"), py::arg("continental").noconvert() = py::none(),
+        py::arg("erosion").noconvert() = py::none(), py::arg("peaks").noconvert() = py::none(),
+        py::arg("simplex").noconvert() = py::none(), py::arg("fractal").noconvert() = py::none(),
+        "Fill float32 (size_y, size_x) arrays with the raw terrain noise layers at world positions start + i "
+        "(x fastest); None skips a layer");
+}
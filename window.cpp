@@ -10,21 +10,59 @@
 #include "shader.h"
 #include "camera.h"
 #include "voxel world/voxel_renderer.h"
+#include "voxel world/block_registry.h"
+#include "voxel world/edit_journal.h"
+#include "voxel world/profiler.h"
 #include "heightmap_generator.h"
+#include "flythrough.h"
+#include "hitch_monitor.h"
+#include "frame_capture.h"
 
 #include <iostream>
 #include <sstream>
 #include <array>
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+
+// Every heap allocation is counted, so flythroughs report what the update and render of a
+// frame allocate
+std::atomic<uint64_t> allocationCount{0};
+
+void *operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = std::malloc(size ? size : 1))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
+void updateMemoryOverlay(GLFWwindow *window, float now);
 
 // settings
 const unsigned int SCR_WIDTH = 1200;
 const unsigned int SCR_HEIGHT = 800;
+const float STEREO_EYE_SEPARATION = 0.065f; // Blocks (a block is a meter)
 
 // camera
 Camera camera(glm::vec3(0.0f, 80.0f, 10.0f));
@@ -50,13 +88,127 @@ bool rightMousePressed = false;
 
 // Voxel renderer
 std::unique_ptr<VoxelRenderer> voxelRenderer;
+EditJournal editJournal; // Placements and removals, for undo / redo
+
+// memory overlay toggle (window title, refreshed twice a second)
+bool memoryOverlayEnabled = false;
+float memoryOverlayUpdatedAt = 0.0f;
+
+// Camera path recording (C key) and scripted replay (--replay)
+CameraPathRecorder pathRecorder;
+std::string recordPath = "camera_path.txt";
+std::unique_ptr<FlythroughBenchmark> flythrough;
+
+// Hitch reports (hitches/); off during replays, which have their own report
+std::unique_ptr<HitchMonitor> hitchMonitor;
+
+// F12 screenshots (screenshots/) and --capture frame sequences of replays
+std::unique_ptr<FrameCapture> frameCapture;
 
-int main()
+int main(int argc, char **argv)
 {
+    // --replay <path> flies the recorded path and exits with a report; --record <path> is
+    // where the C key saves paths; --terrain density adds overhangs and caves.
+    // --heightmaps <size> writes size x size maps of the terrain layers to heightmaps/ and
+    // exits; --export-heightmaps <size> does the same as tiles, for maps too big for memory.
+    // --workers <count> sizes the job system (0: cores less two for rendering); --pin-workers on
+    // pins this thread to the first core and keeps the workers off it; --reverse-z off keeps
+    // standard depth with a far plane at the view distance; --gpu-meshing on meshes streamed
+    // chunks with compute shaders (OpenGL 4.3); --prewarm <radius> meshes that many chunks
+    // around the spawn before the first frame (0 streams everything in during play);
+    // --far-field voxels raymarches generated voxels past the render distance (OpenGL 4.3)
+    // instead of the heightfield; --shadows off leaves the chunks without sun shadows and
+    // --block-lights off without the point lights of emitting blocks; --dynamic-resolution <ms>
+    // lowers the drawn resolution while the chunk passes take longer than that on the GPU
+    // (off: always the window's; replays always draw at full resolution); --capture <directory>
+    // writes every replayed frame there as a PNG. --simulation-thread off updates the world
+    // once per frame on this thread instead of at a fixed rate on a thread of its own (replays
+    // always do, so their frames stay reproducible).
+    std::string replayPath;
+    int heightmapSize = 0;
+    bool tiledHeightmaps = false;
+    std::string reportPath = "flythrough_report.json";
+    std::string captureDirectory;
+    TerrainMode terrainMode = TerrainMode::Heightmap;
+    unsigned int workerThreads = 0;
+    bool pinWorkers = false;
+    bool reverseDepth = true;
+    bool gpuMeshing = false;
+    int prewarmRadius = 8;
+    bool farVoxels = false;
+    bool shadows = true;
+    bool blockLights = true;
+    float resolutionTargetMs = 12.0f;
+    bool simulationThread = true;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        if (option == "--replay")
+            replayPath = argv[i + 1];
+        else if (option == "--report")
+            reportPath = argv[i + 1];
+        else if (option == "--record")
+            recordPath = argv[i + 1];
+        else if (option == "--capture")
+            captureDirectory = argv[i + 1];
+        else if (option == "--terrain" && std::string(argv[i + 1]) == "density")
+            terrainMode = TerrainMode::Density;
+        else if (option == "--terrain" && std::string(argv[i + 1]) == "heightmap")
+            terrainMode = TerrainMode::Heightmap;
+        else if (option == "--workers")
+            workerThreads = static_cast<unsigned int>(std::max(0, std::atoi(argv[i + 1])));
+        else if (option == "--pin-workers")
+            pinWorkers = std::string(argv[i + 1]) == "on";
+        else if (option == "--reverse-z")
+            reverseDepth = std::string(argv[i + 1]) != "off";
+        else if (option == "--gpu-meshing")
+            gpuMeshing = std::string(argv[i + 1]) == "on";
+        else if (option == "--prewarm")
+            prewarmRadius = std::max(0, std::atoi(argv[i + 1]));
+        else if (option == "--far-field")
+            farVoxels = std::string(argv[i + 1]) == "voxels";
+        else if (option == "--shadows")
+            shadows = std::string(argv[i + 1]) != "off";
+        else if (option == "--block-lights")
+            blockLights = std::string(argv[i + 1]) != "off";
+        else if (option == "--simulation-thread")
+            simulationThread = std::string(argv[i + 1]) != "off";
+        else if (option == "--dynamic-resolution")
+            resolutionTargetMs = std::string(argv[i + 1]) == "off" ? 0.0f : static_cast<float>(std::atof(argv[i + 1]));
+        else if (option == "--heightmaps" || option == "--export-heightmaps")
+        {
+            heightmapSize = std::atoi(argv[i + 1]);
+            tiledHeightmaps = option == "--export-heightmaps";
+        }
+        else
+            std::cout << "Ignoring unknown option " << option << std::endl;
+    }
+
+    // Block types before anything meshes or generates; the built-ins stay if the file is bad
+    BlockRegistry::load("voxel world/blocks.txt");
+    if (heightmapSize > 0)
+    {
+        if (!tiledHeightmaps)
+        {
+            HeightmapGenerator::generateAllHeightmaps(12345, heightmapSize, heightmapSize);
+            return 0;
+        }
+        return HeightmapGenerator::exportTiledHeightmaps(12345, heightmapSize, heightmapSize) ? 0 : -1;
+    }
+    if (!replayPath.empty())
+    {
+        CameraPath path;
+        if (!path.load(replayPath))
+        {
+            return -1;
+        }
+        flythrough = std::make_unique<FlythroughBenchmark>(std::move(path));
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
@@ -66,8 +218,16 @@ int main()
 
     // glfw window creation
     // --------------------
+    // Prefer 4.3 (multi-draw indirect); fall back to 3.3 core on older drivers
     GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Voxel World - OpenGL", NULL, NULL);
     if (window == NULL)
+    {
+        std::cout << "OpenGL 4.3 context unavailable, falling back to 3.3" << std::endl;
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Voxel World - OpenGL", NULL, NULL);
+    }
+    if (window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -89,6 +249,12 @@ int main()
         return -1;
     }
 
+    // Replays measure how fast frames can go, not the display refresh
+    if (flythrough)
+    {
+        glfwSwapInterval(0);
+    }
+
     // configure global opengl state
     // -----------------------------
     glEnable(GL_DEPTH_TEST);
@@ -104,25 +270,84 @@ int main()
     std::cout << "Mouse: Look around" << std::endl;
     std::cout << "Left Click: Remove voxel" << std::endl;
     std::cout << "Right Click: Place stone voxel" << std::endl;
+    std::cout << "Z / Y: Undo / redo the last edit" << std::endl;
     std::cout << "F: Toggle face culling" << std::endl;
     std::cout << "G: Toggle wireframe mode" << std::endl;
     std::cout << "R: Print camera position" << std::endl;
+    std::cout << "M: Cycle mesher (naive / greedy)" << std::endl;
+    std::cout << "V: Toggle mesh format (indexed quads / face records)" << std::endl;
+    std::cout << "P: Start / stop profiler capture (writes profile_trace.json)" << std::endl;
+    std::cout << "O: Toggle memory overlay (window title)" << std::endl;
+    std::cout << "N: Toggle minimap" << std::endl;
+    std::cout << "H: Toggle performance HUD" << std::endl;
+    std::cout << "B: Toggle side-by-side stereo" << std::endl;
+    std::cout << "C: Start / stop recording a camera path (writes " << recordPath << ")" << std::endl;
+    std::cout << "F12: Save a screenshot (screenshots/)" << std::endl;
     std::cout << "ESC: Exit" << std::endl;
     std::cout << "=============================" << std::endl;
 
+    Profiler::setThreadName("Main");
+
     // Initialize voxel renderer
-    voxelRenderer = std::make_unique<VoxelRenderer>(12345); // Using seed 12345
+    voxelRenderer = std::make_unique<VoxelRenderer>(12345, 16, workerThreads, pinWorkers); // Using seed 12345
+    voxelRenderer->setReverseDepth(reverseDepth);
+    voxelRenderer->setGpuMeshing(gpuMeshing);
+    voxelRenderer->setFarVoxels(farVoxels);
+    voxelRenderer->setShadows(shadows);
+    voxelRenderer->setBlockLights(blockLights);
+    voxelRenderer->setDynamicResolution(flythrough ? 0.0f : resolutionTargetMs);
+    int framebufferWidth = 0, framebufferHeight = 0;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    voxelRenderer->setFramebufferSize(framebufferWidth, framebufferHeight);
 
     if (!voxelRenderer->initialize())
     {
         std::cout << "Failed to initialize voxel renderer!" << std::endl;
         return -1;
     }
+    voxelRenderer->setTerrainMode(terrainMode);
+    voxelRenderer->setEditJournal(&editJournal);
+
+    // Spawn area on every worker before the first frame, progress in the title; closing the
+    // window stops it
+    if (prewarmRadius > 0)
+    {
+        voxelRenderer->prewarm(camera, prewarmRadius, 5.0f, [window](float progress)
+                               {
+                                   std::string title = "Voxel World - loading " + std::to_string(static_cast<int>(progress * 100.0f)) + "%";
+                                   glfwSetWindowTitle(window, title.c_str());
+                                   glfwPollEvents();
+                                   return !glfwWindowShouldClose(window);
+                               });
+        glfwSetWindowTitle(window, "Voxel World - OpenGL");
+    }
 
-    // Generate heightmaps for analysis (optional - comment out if not needed)
-    std::cout << "Generating heightmaps..." << std::endl;
-    // HeightmapGenerator::generateAllHeightmaps(12345, 512, 512);
-    std::cout << "Heightmaps saved to 'heightmaps/' directory!" << std::endl;
+    // Trade render distance for memory and frame time, up to the configured distance; a
+    // replay keeps a fixed setting so runs stay comparable
+    if (!flythrough)
+    {
+        RenderBudget budget;
+        budget.max_cpu_bytes = size_t(3) * 1024 * 1024 * 1024;
+        budget.max_gpu_bytes = size_t(1536) * 1024 * 1024;
+        budget.max_render_distance = voxelRenderer->getRenderDistance();
+        voxelRenderer->setRenderBudget(budget);
+
+        // Capture runs from the start so each hitch report comes with its profiler zones
+        hitchMonitor = std::make_unique<HitchMonitor>();
+        Profiler::setEnabled(true);
+    }
+
+    // World ticks run beside the frames from here; the frame holds the world while it changes it
+    if (simulationThread && !flythrough)
+    {
+        voxelRenderer->setSimulationThread(true, camera.Position);
+    }
+
+    frameCapture = std::make_unique<FrameCapture>();
+    if (flythrough && !captureDirectory.empty() && frameCapture->startSequence(captureDirectory))
+    {
+        std::cout << "Capturing every replayed frame to " << captureDirectory << std::endl;
+    }
 
     std::cout << "Voxel world initialized successfully!" << std::endl;
     std::cout << "Starting position: " << camera.Position.x << ", " << camera.Position.y << ", " << camera.Position.z << std::endl;
@@ -136,15 +361,48 @@ int main()
         float currentFrame = static_cast<float>(glfwGetTime());
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
+        if (hitchMonitor)
+        {
+            hitchMonitor->beginFrame();
+        }
+        // Only held while the frame changes the world (input, edits and update); the ticks
+        // run while it culls, draws and presents the snapshot the last one published
+        std::unique_lock<std::mutex> worldLock = voxelRenderer->lockWorld();
 
         // input
         // -----
-        processInput(window);
+        if (flythrough)
+        {
+            // Fixed steps from the path instead of input; ESC still aborts
+            if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+                glfwSetWindowShouldClose(window, true);
+            deltaTime = CameraPath::STEP_SECONDS;
+            flythrough->applyNextPose(camera);
+        }
+        else
+        {
+            processInput(window);
+            pathRecorder.update(camera, deltaTime);
+        }
 
-        // Update voxel world
+        // Update voxel world, then start culling the frame on a worker while it is cleared
+        uint64_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+        glm::mat4 projection(1.0f);
+        if (voxelRenderer)
+        {
+            voxelRenderer->update(camera, deltaTime);
+        }
+        updateMemoryOverlay(window, currentFrame); // Walks the chunks
+        if (worldLock.owns_lock())
+        {
+            worldLock.unlock();
+        }
         if (voxelRenderer)
         {
-            voxelRenderer->update(camera);
+            // Stereo draws each eye into half the window
+            float aspect = (float)SCR_WIDTH / (float)SCR_HEIGHT;
+            projection = voxelRenderer->getProjection(camera.Zoom, voxelRenderer->isStereoEnabled() ? aspect * 0.5f : aspect);
+            voxelRenderer->prepareFrame(camera, projection);
         }
 
         // render
@@ -156,21 +414,61 @@ int main()
         // Render voxel world
         if (voxelRenderer)
         {
-            glm::mat4 projection = glm::perspective(
-                glm::radians(camera.Zoom),
-                (float)SCR_WIDTH / (float)SCR_HEIGHT,
-                0.1f, 1000.0f);
-
             voxelRenderer->render(camera, projection);
         }
+        uint64_t frameAllocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+        if (frameCapture)
+        {
+            int framebufferWidth = 0, framebufferHeight = 0;
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+            frameCapture->endFrame(framebufferWidth, framebufferHeight);
+        }
 
         // glfw: swap buffers and poll IO events
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        if (hitchMonitor && voxelRenderer)
+        {
+            hitchMonitor->endFrame((static_cast<float>(glfwGetTime()) - currentFrame) * 1000.0f, *voxelRenderer);
+        }
+
+        if (flythrough && voxelRenderer)
+        {
+            flythrough->recordFrame((static_cast<float>(glfwGetTime()) - currentFrame) * 1000.0f, frameAllocations,
+                                    *voxelRenderer);
+            if (flythrough->isFinished())
+            {
+                flythrough->writeReport(reportPath, *voxelRenderer);
+                glfwSetWindowShouldClose(window, true);
+            }
+        }
     }
 
-    // Cleanup
+    if (pathRecorder.isRecording())
+    {
+        pathRecorder.stop(recordPath);
+    }
+
+    // Captures still in flight are written while the context is alive
+    if (frameCapture)
+    {
+        frameCapture->finish();
+        if (frameCapture->getFramesCaptured() > 0)
+        {
+            std::cout << "Frame capture: " << frameCapture->getFramesWritten() << " of "
+                      << frameCapture->getFramesCaptured() << " frames written" << std::endl;
+        }
+        frameCapture.reset();
+    }
+
+    // Cleanup: unsaved edits are written first, while the job system still runs
+    if (voxelRenderer)
+    {
+        voxelRenderer->setSimulationThread(false, camera.Position);
+        voxelRenderer->saveWorld();
+    }
     voxelRenderer.reset();
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
@@ -241,6 +539,32 @@ void processInput(GLFWwindow *window)
         wireframeKeyPressed = false;
     }
 
+    // Cycle meshing mode with M key
+    static bool mKeyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS && !mKeyPressed && voxelRenderer)
+    {
+        int next_mode = (static_cast<int>(voxelRenderer->getMeshingMode()) + 1) % static_cast<int>(MeshingMode::Count);
+        voxelRenderer->setMeshingMode(static_cast<MeshingMode>(next_mode));
+        mKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_RELEASE)
+    {
+        mKeyPressed = false;
+    }
+
+    // Toggle indexed quads / vertex-pulled face records with V key
+    static bool vKeyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS && !vKeyPressed && voxelRenderer)
+    {
+        int next_format = (static_cast<int>(voxelRenderer->getMeshFormat()) + 1) % static_cast<int>(MeshFormat::Count);
+        voxelRenderer->setMeshFormat(static_cast<MeshFormat>(next_format));
+        vKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_V) == GLFW_RELEASE)
+    {
+        vKeyPressed = false;
+    }
+
     // Print camera position with R key
     static bool rKeyPressed = false;
     if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS && !rKeyPressed)
@@ -257,6 +581,140 @@ void processInput(GLFWwindow *window)
         rKeyPressed = false;
     }
 
+    // Start / stop a profiler capture with P key; stopping writes the trace (and leaves hitch
+    // reports without zones until the next capture starts)
+    static bool pKeyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && !pKeyPressed)
+    {
+        if (Profiler::isEnabled())
+        {
+            Profiler::setEnabled(false);
+            Profiler::writeChromeTrace("profile_trace.json");
+        }
+        else
+        {
+            Profiler::clear();
+            Profiler::setEnabled(true);
+            std::cout << "Profiler capture started" << std::endl;
+        }
+        pKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE)
+    {
+        pKeyPressed = false;
+    }
+
+    // Toggle the minimap with N key
+    static bool nKeyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS && !nKeyPressed && voxelRenderer)
+    {
+        voxelRenderer->setMinimapEnabled(!voxelRenderer->isMinimapEnabled());
+        nKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_N) == GLFW_RELEASE)
+    {
+        nKeyPressed = false;
+    }
+
+    // Toggle the performance HUD with H key
+    static bool hKeyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS && !hKeyPressed && voxelRenderer)
+    {
+        voxelRenderer->setHudEnabled(!voxelRenderer->isHudEnabled());
+        hKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_H) == GLFW_RELEASE)
+    {
+        hKeyPressed = false;
+    }
+
+    // Toggle side-by-side stereo with B key
+    static bool bKeyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS && !bKeyPressed && voxelRenderer)
+    {
+        voxelRenderer->setStereo(voxelRenderer->isStereoEnabled() ? 0.0f : STEREO_EYE_SEPARATION);
+        bKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_B) == GLFW_RELEASE)
+    {
+        bKeyPressed = false;
+    }
+
+    // Screenshot of the next finished frame with F12
+    static bool f12KeyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS && !f12KeyPressed && frameCapture)
+    {
+        static int screenshotCount = 0;
+        char stamp[32];
+        std::time_t now = std::time(nullptr);
+        std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", std::localtime(&now));
+        frameCapture->requestScreenshot(std::string("screenshots/") + stamp + "_" + std::to_string(screenshotCount++) + ".png");
+        f12KeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_F12) == GLFW_RELEASE)
+    {
+        f12KeyPressed = false;
+    }
+
+    // Toggle the memory overlay with O key
+    static bool oKeyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS && !oKeyPressed)
+    {
+        memoryOverlayEnabled = !memoryOverlayEnabled;
+        memoryOverlayUpdatedAt = 0.0f;
+        if (!memoryOverlayEnabled)
+        {
+            glfwSetWindowTitle(window, "Voxel World - OpenGL");
+        }
+        oKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_RELEASE)
+    {
+        oKeyPressed = false;
+    }
+
+    // Start / stop recording the camera path with C key
+    static bool cKeyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS && !cKeyPressed)
+    {
+        if (pathRecorder.isRecording())
+        {
+            pathRecorder.stop(recordPath);
+        }
+        else
+        {
+            pathRecorder.start(camera);
+            std::cout << "Recording camera path" << std::endl;
+        }
+        cKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_RELEASE)
+    {
+        cKeyPressed = false;
+    }
+
+    // Undo / redo edits with Z and Y keys
+    static bool zKeyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS && !zKeyPressed && voxelRenderer)
+    {
+        std::cout << (voxelRenderer->undoEdit() ? "Undid the last edit" : "Nothing to undo") << std::endl;
+        zKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_RELEASE)
+    {
+        zKeyPressed = false;
+    }
+    static bool yKeyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_Y) == GLFW_PRESS && !yKeyPressed && voxelRenderer)
+    {
+        std::cout << (voxelRenderer->redoEdit() ? "Redid the edit" : "Nothing to redo") << std::endl;
+        yKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_Y) == GLFW_RELEASE)
+    {
+        yKeyPressed = false;
+    }
+
     // Voxel placement/removal with mouse clicks
     bool leftMouse = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
     bool rightMouse = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
@@ -264,56 +722,27 @@ void processInput(GLFWwindow *window)
     if (leftMouse && !leftMousePressed && voxelRenderer)
     {
         // Raycast from camera to find voxel to remove
-        glm::vec3 rayStart = camera.Position;
-        glm::vec3 rayDir = camera.Front;
-        glm::ivec3 lastAirPos;
-        bool blockFound = false;
-
-        for (float t = 0.0f; t < 10.0f; t += 0.05f)
+        VoxelRayHit hit = voxelRenderer->raycast(VoxelRay{camera.Position, camera.Front, 10.0f});
+        if (hit.hit)
         {
-            glm::vec3 rayPos = rayStart + rayDir * t;
-            glm::ivec3 blockPos = glm::ivec3(floor(rayPos.x), floor(rayPos.y), floor(rayPos.z));
-
-            VoxelID voxel = voxelRenderer->getVoxel(blockPos.x, blockPos.y, blockPos.z);
-
-            if (voxel != VOXEL_AIR)
-            {
-                voxelRenderer->setVoxel(blockPos.x, blockPos.y, blockPos.z, VOXEL_AIR);
-                std::cout << "Removed voxel at (" << blockPos.x
-                          << ", " << blockPos.y
-                          << ", " << blockPos.z << ")" << std::endl;
-                blockFound = true;
-                break;
-            }
-            lastAirPos = blockPos;
+            voxelRenderer->setVoxel(hit.position.x, hit.position.y, hit.position.z, VOXEL_AIR);
+            std::cout << "Removed voxel at (" << hit.position.x
+                      << ", " << hit.position.y
+                      << ", " << hit.position.z << ")" << std::endl;
         }
     }
 
     if (rightMouse && !rightMousePressed && voxelRenderer)
     {
-        // Raycast to find where to place voxel
-        glm::vec3 rayStart = camera.Position;
-        glm::vec3 rayDir = camera.Front;
-        glm::ivec3 lastAirPos;
-        bool blockFound = false;
-
-        for (float t = 0.0f; t < 10.0f; t += 0.05f)
+        // Raycast to find where to place voxel: in front of the face the ray entered through
+        VoxelRayHit hit = voxelRenderer->raycast(VoxelRay{camera.Position, camera.Front, 10.0f});
+        if (hit.hit && hit.normal != glm::ivec3(0))
         {
-            glm::vec3 rayPos = rayStart + rayDir * t;
-            glm::ivec3 blockPos = glm::ivec3(floor(rayPos.x), floor(rayPos.y), floor(rayPos.z));
-
-            VoxelID voxel = voxelRenderer->getVoxel(blockPos.x, blockPos.y, blockPos.z);
-
-            if (voxel != VOXEL_AIR)
-            {
-                voxelRenderer->setVoxel(lastAirPos.x, lastAirPos.y, lastAirPos.z, VOXEL_STONE);
-                std::cout << "Placed stone voxel at (" << lastAirPos.x
-                          << ", " << lastAirPos.y
-                          << ", " << lastAirPos.z << ")" << std::endl;
-                blockFound = true;
-                break;
-            }
-            lastAirPos = blockPos;
+            glm::ivec3 placePos = hit.position + hit.normal;
+            voxelRenderer->setVoxel(placePos.x, placePos.y, placePos.z, VOXEL_STONE);
+            std::cout << "Placed stone voxel at (" << placePos.x
+                      << ", " << placePos.y
+                      << ", " << placePos.z << ")" << std::endl;
         }
     }
 
@@ -328,6 +757,10 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height)
     // make sure the viewport matches the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
+    if (voxelRenderer)
+    {
+        voxelRenderer->setFramebufferSize(width, height); // Offscreen targets follow once, not every frame
+    }
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -359,3 +792,26 @@ void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
 {
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
+
+// Memory use in the window title while the overlay is on
+// ------------------------------------------------------
+void updateMemoryOverlay(GLFWwindow *window, float now)
+{
+    if (!memoryOverlayEnabled || !voxelRenderer || now - memoryOverlayUpdatedAt < 0.5f)
+        return;
+    memoryOverlayUpdatedAt = now;
+
+    MemoryStats stats = voxelRenderer->getMemoryStats();
+    auto mb = [](size_t bytes)
+    { return static_cast<float>(bytes) / (1024.0f * 1024.0f); };
+
+    std::ostringstream title;
+    title.precision(1);
+    title << std::fixed << "Voxel World - RAM " << mb(stats.getCpuBytes()) << " MB (" << stats.chunks << " chunks "
+          << mb(stats.chunk_bytes) << ", " << stats.packed_chunks << " packed, pooled " << mb(stats.pooled_chunk_bytes) << ", meshes "
+          << mb(stats.mesh_cpu_bytes + stats.mesh_pool_bytes) << ", noise " << mb(stats.noise_bytes) << ") | VRAM "
+          << mb(stats.getGpuBytes()) << " MB (meshes " << mb(stats.gpu_mesh_bytes) << ", arena " << mb(stats.gpu_arena_bytes)
+          << ", regions " << mb(stats.gpu_region_bytes) << ", staging " << mb(stats.gpu_staging_bytes) << ") | queues: upload " << stats.upload_queue << ", generate "
+          << stats.generation_queue;
+    glfwSetWindowTitle(window, title.str().c_str());
+}